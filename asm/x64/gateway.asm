@@ -22,26 +22,55 @@ extern discord_ws_close
 extern discord_ws_free_message
 extern discord_json_parse_opcode
 extern discord_json_parse_hello
-extern discord_json_create_identify
+extern discord_json_create_identify_sharded
 extern discord_json_create_heartbeat
+extern discord_json_parse_sequence
+extern discord_json_match_event
+extern discord_json_parse_ready
+extern discord_json_create_resume
 extern discord_json_free
 extern discord_time_now_ms
 extern discord_sleep_ms
+extern discord_session_store_sequence
+extern discord_session_store_identity
+extern discord_session_load
+extern discord_session_connect_url
+extern discord_session_invalidate
+extern discord_dispatch_frame
+extern discord_qos_pending
+extern discord_qos_poll
+extern discord_coord_identify_slot
+extern discord_coord_identify_shard
+
+%include "trace.inc"
 
 ; Constants from opcodes.h
+%define DISCORD_OP_DISPATCH      0
 %define DISCORD_OP_HEARTBEAT     1
 %define DISCORD_OP_IDENTIFY      2
+%define DISCORD_OP_RESUME        6
+%define DISCORD_OP_INVALID_SESSION 9
 %define DISCORD_OP_HELLO        10
 %define DISCORD_OP_HEARTBEAT_ACK 11
 
 %define DISCORD_OK               0
 %define DISCORD_ERROR_TIMEOUT   -6
+%define DISCORD_ERROR_NOT_FOUND -8
+
+; Constants from abi.h
+%define DISCORD_SESSION_RESUME_WINDOW_MS 120000
+%define GATEWAY_URL_MAX          320
 
 ; Structure offsets (must match structs.h)
 %define WS_MESSAGE_DATA_OFFSET   0
 %define WS_MESSAGE_LENGTH_OFFSET 8
 %define WS_MESSAGE_BINARY_OFFSET 16
 
+; discord_session_state_t offsets (must match abi.h)
+%define SESSION_STATE_SEQ_OFFSET 8
+%define SESSION_STATE_ID_OFFSET  12
+%define SESSION_STATE_SIZE       400
+
 section .data
     ; Gateway URL for Discord
     gateway_url db 'wss://gateway.discord.gg/?v=10&encoding=json', 0
@@ -50,8 +79,15 @@ section .data
     gateway_ptr dq 0                ; Pointer to gateway structure
     heartbeat_interval dd 0         ; Heartbeat interval in ms
     last_heartbeat dq 0            ; Last heartbeat timestamp
+    identify_at dq 0               ; When the deferred IDENTIFY may go
+    identify_pending db 0          ; IDENTIFY waiting for its coordinator slot
     sequence_number dd -1          ; Current sequence number
     is_ready db 0                  ; Ready state flag
+    bot_token dq 0                 ; Bot token saved by gateway_run
+    session_ptr dq 0               ; Optional session snapshot (discord_session_t*)
+    
+    ; Event names matched on dispatch
+    ready_event db 'READY', 0
     
     ; Message buffer
     message_buffer times 4096 db 0
@@ -60,12 +96,19 @@ section .bss
     ; WebSocket message structure
     ws_message resb 24             ; discord_ws_message_t structure
     
+    ; Resume state loaded from the session snapshot
+    session_state resb SESSION_STATE_SIZE
+    
+    ; Gateway URL actually connected to (resume URL or default)
+    connect_url resb GATEWAY_URL_MAX
+    
 section .text
 
 ; Export main gateway functions
 global discord_gateway_connect
 global discord_gateway_run
 global discord_gateway_disconnect
+global discord_gateway_set_session
 
 ;------------------------------------------------------------------------------
 ; discord_gateway_connect: Connect to Discord Gateway
@@ -84,18 +127,34 @@ discord_gateway_connect:
     mov [rbp-8], rdi               ; Save token parameter  
 %endif
     
+    ; Pick the resume URL from the session snapshot when one is attached
+%ifdef WINDOWS
+    mov rcx, [session_ptr]         ; Session (may be NULL)
+    mov rdx, gateway_url           ; Fallback URL
+    lea r8, [connect_url]          ; Output buffer
+    mov r9d, GATEWAY_URL_MAX       ; Buffer size
+%else
+    mov rdi, [session_ptr]         ; Session (may be NULL)
+    mov rsi, gateway_url           ; Fallback URL
+    lea rdx, [connect_url]         ; Output buffer
+    mov ecx, GATEWAY_URL_MAX       ; Buffer size
+%endif
+    call discord_session_connect_url
+    test eax, eax
+    jnz .connect_failed
+    
     ; Connect to WebSocket
 %ifdef WINDOWS
-    mov rcx, gateway_url           ; URL parameter
+    lea rcx, [connect_url]         ; URL parameter
     lea rdx, [gateway_ptr]         ; Output gateway pointer
 %else
-    mov rdi, gateway_url           ; URL parameter
+    lea rdi, [connect_url]         ; URL parameter
     lea rsi, [gateway_ptr]         ; Output gateway pointer
 %endif
     call discord_ws_connect
     
     ; Check connection result
-    test rax, rax
+    test eax, eax
     jnz .connect_failed
     
     ; Connection successful
@@ -104,7 +163,7 @@ discord_gateway_connect:
 
 .connect_failed:
     ; Connection failed, return error code
-    ; RAX already contains the error code
+    movsxd rax, eax                ; Sign-extend the C result code
     
 .cleanup:
     add rsp, SHADOW_SPACE + 16
@@ -127,6 +186,8 @@ discord_gateway_run:
 %else
     mov [rbp-8], rdi               ; Save token parameter
 %endif
+    mov rax, [rbp-8]
+    mov [bot_token], rax           ; IDENTIFY/RESUME read it from here
     
     ; Check if gateway is connected
     mov rax, [gateway_ptr]
@@ -134,27 +195,46 @@ discord_gateway_run:
     jz .not_connected
     
 .main_loop:
-    ; Receive message with 1 second timeout
+    ; Block for up to 1 second (50 ms while an IDENTIFY waits for its
+    ; slot), or only take frames already queued while the QoS scheduler
+    ; holds events
+    call discord_qos_pending
+    test eax, eax
+    jnz .no_wait
+    mov eax, 1000                  ; 1 second timeout
+    cmp byte [identify_pending], 0
+    je .receive
+    mov eax, 50
+    jmp .receive
+    
+.no_wait:
+    xor eax, eax                   ; Don't block
+    
+.receive:
 %ifdef WINDOWS
     mov rcx, [gateway_ptr]         ; Gateway parameter
     lea rdx, [ws_message]          ; Message structure
-    mov r8d, 1000                  ; 1 second timeout
+    mov r8d, eax                   ; Timeout
 %else
     mov rdi, [gateway_ptr]         ; Gateway parameter
     lea rsi, [ws_message]          ; Message structure  
-    mov edx, 1000                  ; 1 second timeout
+    mov edx, eax                   ; Timeout
 %endif
     call discord_ws_receive
     
     ; Check receive result
-    cmp rax, DISCORD_ERROR_TIMEOUT
-    je .check_heartbeat            ; Timeout is normal, check if heartbeat needed
-    test rax, rax
+    cmp eax, DISCORD_ERROR_TIMEOUT
+    je .idle                       ; Timeout is normal, check if heartbeat needed
+    test eax, eax
     jnz .receive_error             ; Other errors are fatal
     
     ; Process received message
+    TRACE_BEGIN [rbp-16]
     call process_message
-    test rax, rax
+    mov [rbp-24], rax              ; Save process result
+    TRACE_END [rbp-16], TRACE_PROCESS_MESSAGE
+    mov rax, [rbp-24]
+    test eax, eax
     jnz .process_error
     
     ; Free the message data
@@ -165,10 +245,33 @@ discord_gateway_run:
 %endif
     call discord_ws_free_message
     
+    ; Let queued events run once enough frames have been pulled
+%ifdef WINDOWS
+    xor ecx, ecx                   ; idle = 0
+%else
+    xor edi, edi                   ; idle = 0
+%endif
+    call discord_qos_poll
+    jmp .check_heartbeat
+    
+.idle:
+    ; Nothing left on the socket: run a batch of queued events
+%ifdef WINDOWS
+    mov ecx, 1                     ; idle = 1
+%else
+    mov edi, 1                     ; idle = 1
+%endif
+    call discord_qos_poll
+    
 .check_heartbeat:
     ; Check if we need to send heartbeat
     call check_and_send_heartbeat
     
+    ; Send a deferred IDENTIFY once its slot has come
+    call send_pending_identify
+    test eax, eax
+    jnz .process_error
+    
     ; Continue main loop
     jmp .main_loop
 
@@ -179,6 +282,7 @@ discord_gateway_run:
 .receive_error:
 .process_error:
     ; Error occurred, cleanup and return error code
+    movsxd rax, eax                ; Sign-extend the C result code
     jmp .cleanup
 
 .cleanup:
@@ -210,28 +314,55 @@ process_message:
 %endif
     call discord_json_parse_opcode
     
-    test rax, rax
+    test eax, eax
     jnz .parse_error
     
     ; Switch on opcode
     mov eax, [rbp-4]               ; Load parsed opcode
     
+    cmp eax, DISCORD_OP_DISPATCH
+    je .handle_dispatch
+    
     cmp eax, DISCORD_OP_HELLO
     je .handle_hello
     
+    cmp eax, DISCORD_OP_INVALID_SESSION
+    je .handle_invalid_session
+    
     cmp eax, DISCORD_OP_HEARTBEAT_ACK  
     je .handle_heartbeat_ack
     
-    ; For now, ignore other opcodes
-    mov rax, DISCORD_OK
-    jmp .cleanup
+    ; Other opcodes only go to user handlers
+    jmp .dispatch
+
+.handle_dispatch:
+    call handle_dispatch_message
+    jmp .handled
 
 .handle_hello:
     call handle_hello_message
-    jmp .cleanup
+    jmp .handled
+
+.handle_invalid_session:
+    call handle_invalid_session_message
+    jmp .handled
     
 .handle_heartbeat_ack:
     call handle_heartbeat_ack_message
+    
+.handled:
+    test eax, eax
+    jnz .cleanup                   ; Protocol error; skip user handlers
+    
+.dispatch:
+    ; Hand the frame to the registered event handlers
+%ifdef WINDOWS
+    mov rcx, [ws_message + WS_MESSAGE_DATA_OFFSET]
+%else
+    mov rdi, [ws_message + WS_MESSAGE_DATA_OFFSET]
+%endif
+    call discord_dispatch_frame
+    movsxd rax, eax                ; Sign-extend the C result code
     jmp .cleanup
 
 .invalid_message:
@@ -265,34 +396,173 @@ handle_hello_message:
 %endif
     call discord_json_parse_hello
     
-    test rax, rax
+    test eax, eax
     jnz .parse_failed
     
     ; Store heartbeat interval
     mov eax, [rbp-4]
     mov [heartbeat_interval], eax
     
-    ; Send IDENTIFY message
-    call send_identify_message
-    test rax, rax
-    jnz .identify_failed
-    
-    ; Set up heartbeat timer
+    ; Start the heartbeat clock first: IDENTIFY may wait for a
+    ; coordinator slot, and the main loop heartbeats meanwhile
     call discord_time_now_ms
     mov [last_heartbeat], rax
     
+    ; RESUME from the snapshot when possible, IDENTIFY otherwise
+    call send_resume_message
+    test eax, eax
+    jz .identified
+    
+    call send_identify_message
+    test eax, eax
+    jnz .identify_failed
+    
+.identified:
     mov rax, DISCORD_OK
     jmp .cleanup
 
 .parse_failed:
 .identify_failed:
-    ; RAX already contains error code
+    movsxd rax, eax                ; Sign-extend the C result code
     
 .cleanup:
     add rsp, SHADOW_SPACE + 16
     pop rbp
     ret
 
+;------------------------------------------------------------------------------
+; handle_dispatch_message: Process DISPATCH opcode (op 0)
+; Tracks the sequence number and mirrors it, plus READY's session fields,
+; into the session snapshot when one is attached.
+; Input: ws_message contains the DISPATCH message
+; Output: RAX = result code
+;------------------------------------------------------------------------------
+handle_dispatch_message:
+    push rbp
+    mov rbp, rsp
+    sub rsp, SHADOW_SPACE + 32
+    
+    ; Parse "s" from the payload
+%ifdef WINDOWS
+    mov rcx, [ws_message + WS_MESSAGE_DATA_OFFSET]
+    lea rdx, [rbp-4]               ; Sequence output
+%else
+    mov rdi, [ws_message + WS_MESSAGE_DATA_OFFSET]
+    lea rsi, [rbp-4]               ; Sequence output
+%endif
+    call discord_json_parse_sequence
+    test eax, eax
+    jnz .done                      ; Malformed dispatch; keep the last sequence
+    
+    mov eax, [rbp-4]
+    test eax, eax
+    js .check_ready
+    mov [sequence_number], eax
+    
+    ; Hot path: a single atomic store into the snapshot mapping
+    mov rax, [session_ptr]
+    test rax, rax
+    jz .done
+    
+%ifdef WINDOWS
+    mov rcx, rax                   ; Session
+    mov edx, [rbp-4]               ; Sequence
+%else
+    mov rdi, rax                   ; Session
+    mov esi, [rbp-4]               ; Sequence
+%endif
+    call discord_session_store_sequence
+    
+.check_ready:
+    mov rax, [session_ptr]
+    test rax, rax
+    jz .done
+    
+%ifdef WINDOWS
+    mov rcx, [ws_message + WS_MESSAGE_DATA_OFFSET]
+    mov rdx, ready_event
+%else
+    mov rdi, [ws_message + WS_MESSAGE_DATA_OFFSET]
+    mov rsi, ready_event
+%endif
+    call discord_json_match_event
+    test eax, eax
+    jz .done
+    
+    ; READY: persist session_id and resume_gateway_url
+%ifdef WINDOWS
+    mov rcx, [ws_message + WS_MESSAGE_DATA_OFFSET]
+    lea rdx, [rbp-16]              ; session_id output
+    lea r8, [rbp-24]               ; resume_gateway_url output
+%else
+    mov rdi, [ws_message + WS_MESSAGE_DATA_OFFSET]
+    lea rsi, [rbp-16]              ; session_id output
+    lea rdx, [rbp-24]              ; resume_gateway_url output
+%endif
+    call discord_json_parse_ready
+    test eax, eax
+    jnz .done
+    
+%ifdef WINDOWS
+    mov rcx, [session_ptr]
+    mov rdx, [rbp-16]
+    mov r8, [rbp-24]
+%else
+    mov rdi, [session_ptr]
+    mov rsi, [rbp-16]
+    mov rdx, [rbp-24]
+%endif
+    call discord_session_store_identity
+    
+%ifdef WINDOWS
+    mov rcx, [rbp-16]
+%else
+    mov rdi, [rbp-16]
+%endif
+    call discord_json_free
+    
+%ifdef WINDOWS
+    mov rcx, [rbp-24]
+%else
+    mov rdi, [rbp-24]
+%endif
+    call discord_json_free
+    
+.done:
+    mov rax, DISCORD_OK
+    add rsp, SHADOW_SPACE + 32
+    pop rbp
+    ret
+
+;------------------------------------------------------------------------------
+; handle_invalid_session_message: Process INVALID_SESSION opcode (op 9)
+; The snapshot can no longer be resumed, so drop it and IDENTIFY again.
+; Output: RAX = result code
+;------------------------------------------------------------------------------
+handle_invalid_session_message:
+    push rbp
+    mov rbp, rsp
+    sub rsp, SHADOW_SPACE + 16
+    
+    mov rax, [session_ptr]
+    test rax, rax
+    jz .identify
+    
+%ifdef WINDOWS
+    mov rcx, rax
+%else
+    mov rdi, rax
+%endif
+    call discord_session_invalidate
+    
+.identify:
+    mov dword [sequence_number], -1
+    call send_identify_message
+    
+    add rsp, SHADOW_SPACE + 16
+    pop rbp
+    ret
+
 ;------------------------------------------------------------------------------
 ; handle_heartbeat_ack_message: Process HEARTBEAT_ACK opcode
 ; Output: RAX = result code  
@@ -304,63 +574,228 @@ handle_heartbeat_ack_message:
     ret
 
 ;------------------------------------------------------------------------------
-; send_identify_message: Send IDENTIFY message to gateway
-; Uses the saved bot token from gateway_run
-; Output: RAX = result code
+; send_identify_message: Schedule IDENTIFY for the coordinator's slot
+; Sends at once when the slot is now (always, without a coordinator);
+; otherwise the main loop sends it when the slot comes, heartbeating
+; until then.
+; Output: RAX = result code; DISCORD_ERROR_NOT_FOUND when the coordinator
+;         no longer assigns this shard, which ends the loop
 ;------------------------------------------------------------------------------
 send_identify_message:
     push rbp
     mov rbp, rsp
     sub rsp, SHADOW_SPACE + 16
     
-    ; Create IDENTIFY JSON
-    mov rax, [rbp-8]               ; Get saved token from parent frame
+    mov rax, [bot_token]
     test rax, rax
     jz .no_token
     
+    ; Take the coordinator's IDENTIFY slot (now without one, or when the
+    ; coordinator is unreachable)
+%ifdef WINDOWS
+    lea rcx, [rbp-8]               ; Slot time output
+%else
+    lea rdi, [rbp-8]               ; Slot time output
+%endif
+    call discord_coord_identify_slot
+    cmp eax, DISCORD_ERROR_NOT_FOUND
+    je .not_owned
+    
+    mov rax, [rbp-8]
+    mov [identify_at], rax
+    mov byte [identify_pending], 1
+    call send_pending_identify
+    jmp .cleanup
+
+.no_token:
+    mov rax, -1                    ; No token to identify with
+    jmp .cleanup
+
+.not_owned:
+    mov byte [identify_pending], 0
+    mov rax, DISCORD_ERROR_NOT_FOUND
+    
+.cleanup:
+    add rsp, SHADOW_SPACE + 16
+    pop rbp
+    ret
+
+;------------------------------------------------------------------------------
+; send_pending_identify: Send the scheduled IDENTIFY if its slot has come
+; Uses the bot token saved by gateway_run and the attached shard pair
+; Output: RAX = result code (DISCORD_OK when nothing is due)
+;------------------------------------------------------------------------------
+send_pending_identify:
+    push rbp
+    mov rbp, rsp
+    sub rsp, SHADOW_SPACE + 16
+    
+    cmp byte [identify_pending], 0
+    je .not_due
+    
+    call discord_time_now_ms
+    cmp rax, [identify_at]
+    jb .not_due
+    mov byte [identify_pending], 0
+    
+    ; "shard":[id,count] from the coordinator (0, 0 = unsharded)
+%ifdef WINDOWS
+    lea rcx, [rbp-16]             ; Shard id output
+    lea rdx, [rbp-12]             ; Shard count output
+%else
+    lea rdi, [rbp-16]             ; Shard id output
+    lea rsi, [rbp-12]             ; Shard count output
+%endif
+    call discord_coord_identify_shard
+    
+    ; Create IDENTIFY JSON
+    mov rax, [bot_token]
 %ifdef WINDOWS
     mov rcx, rax                   ; Token parameter
-    lea rdx, [rbp-8]              ; JSON output pointer
+    mov edx, [rbp-16]             ; Shard id
+    mov r8d, [rbp-12]             ; Shard count
+    lea r9, [rbp-8]               ; JSON output pointer
 %else
     mov rdi, rax                   ; Token parameter
-    lea rsi, [rbp-8]              ; JSON output pointer
+    mov esi, [rbp-16]             ; Shard id
+    mov edx, [rbp-12]             ; Shard count
+    lea rcx, [rbp-8]              ; JSON output pointer
 %endif
-    call discord_json_create_identify
+    call discord_json_create_identify_sharded
     
-    test rax, rax
+    test eax, eax
     jnz .json_failed
     
-    ; Send the IDENTIFY message
-    mov rax, [rbp-8]               ; Get created JSON
+    ; Send the IDENTIFY message (frees the JSON)
+%ifdef WINDOWS
+    mov rcx, [rbp-8]
+%else
+    mov rdi, [rbp-8]
+%endif
+    call send_owned_json
+    jmp .cleanup
+
+.not_due:
+    mov rax, DISCORD_OK
+    jmp .cleanup
+
+.json_failed:
+    movsxd rax, eax                ; Sign-extend the C result code
+    
+.cleanup:
+    add rsp, SHADOW_SPACE + 16
+    pop rbp
+    ret
+
+;------------------------------------------------------------------------------
+; send_resume_message: Send RESUME from the attached session snapshot
+; Output: RAX = DISCORD_OK if RESUME was sent, non-zero if the caller
+;         should IDENTIFY instead (no snapshot, stale snapshot, send error)
+;------------------------------------------------------------------------------
+send_resume_message:
+    push rbp
+    mov rbp, rsp
+    sub rsp, SHADOW_SPACE + 16
+    
+    mov rax, [session_ptr]
+    test rax, rax
+    jz .no_session
     
+    mov rax, [bot_token]
+    test rax, rax
+    jz .no_session
+    
+    ; Load resume state written by this or a previous process
 %ifdef WINDOWS
-    mov rcx, [gateway_ptr]         ; Gateway
-    mov rdx, rax                   ; JSON data
-    mov r8, -1                     ; Let strlen calculate length
+    mov rcx, [session_ptr]
+    mov edx, DISCORD_SESSION_RESUME_WINDOW_MS
+    lea r8, [session_state]
 %else
-    mov rdi, [gateway_ptr]         ; Gateway
-    mov rsi, rax                   ; JSON data
-    ; Calculate length
-    push rax
-    call strlen                    ; Assume strlen is available or implement inline
-    mov rdx, rax                   ; Length
-    pop rsi                        ; Restore JSON data pointer
+    mov rdi, [session_ptr]
+    mov esi, DISCORD_SESSION_RESUME_WINDOW_MS
+    lea rdx, [session_state]
+%endif
+    call discord_session_load
+    test eax, eax
+    jnz .failed
+    
+    ; Continue heartbeats from the restored sequence
+    mov eax, [session_state + SESSION_STATE_SEQ_OFFSET]
+    mov [sequence_number], eax
+    
+%ifdef WINDOWS
+    mov rcx, [bot_token]                                ; Token
+    lea rdx, [session_state + SESSION_STATE_ID_OFFSET]  ; Session ID
+    mov r8d, [session_state + SESSION_STATE_SEQ_OFFSET] ; Sequence
+    lea r9, [rbp-8]                                     ; JSON output
+%else
+    mov rdi, [bot_token]                                ; Token
+    lea rsi, [session_state + SESSION_STATE_ID_OFFSET]  ; Session ID
+    mov edx, [session_state + SESSION_STATE_SEQ_OFFSET] ; Sequence
+    lea rcx, [rbp-8]                                    ; JSON output
 %endif
+    call discord_json_create_resume
+    test eax, eax
+    jnz .failed
     
-    ; For simplicity, calculate length inline (basic strlen)
-    push rsi
-    mov rcx, 0
+%ifdef WINDOWS
+    mov rcx, [rbp-8]
+%else
+    mov rdi, [rbp-8]
+%endif
+    call send_owned_json
+    jmp .cleanup
+
+.no_session:
+    mov rax, -1
+    jmp .cleanup
+
+.failed:
+    movsxd rax, eax                ; Sign-extend the C result code
+    
+.cleanup:
+    add rsp, SHADOW_SPACE + 16
+    pop rbp
+    ret
+
+;------------------------------------------------------------------------------
+; send_owned_json: Send a shim-allocated JSON string and free it
+; Input: RDI/RCX = null-terminated JSON (always freed)
+; Output: RAX = result code from discord_ws_send
+;------------------------------------------------------------------------------
+send_owned_json:
+    push rbp
+    mov rbp, rsp
+    sub rsp, SHADOW_SPACE + 16
+    
+%ifdef WINDOWS
+    mov [rbp-8], rcx               ; Save JSON pointer
+%else
+    mov [rbp-8], rdi               ; Save JSON pointer
+%endif
+    
+    ; Calculate length inline (basic strlen)
+    mov rax, [rbp-8]
+    xor ecx, ecx
 .strlen_loop:
-    cmp byte [rsi + rcx], 0
+    cmp byte [rax + rcx], 0
     je .strlen_done
     inc rcx
     jmp .strlen_loop
 .strlen_done:
-    mov rdx, rcx                   ; Length in RDX
-    pop rsi                        ; Restore JSON data
     
+%ifdef WINDOWS
+    mov r8, rcx                    ; Length
+    mov rdx, rax                   ; JSON data
+    mov rcx, [gateway_ptr]         ; Gateway
+%else
+    mov rdx, rcx                   ; Length
+    mov rsi, rax                   ; JSON data
+    mov rdi, [gateway_ptr]         ; Gateway
+%endif
     call discord_ws_send
-    push rax                       ; Save send result
+    movsxd rax, eax
+    mov [rbp-16], rax              ; Save send result
     
     ; Free the JSON
 %ifdef WINDOWS
@@ -370,14 +805,7 @@ send_identify_message:
 %endif
     call discord_json_free
     
-    pop rax                        ; Restore send result
-    jmp .cleanup
-
-.no_token:
-.json_failed:
-    ; RAX contains error code
-    
-.cleanup:
+    mov rax, [rbp-16]              ; Restore send result
     add rsp, SHADOW_SPACE + 16
     pop rbp
     ret
@@ -398,16 +826,15 @@ check_and_send_heartbeat:
     
     ; Get current time
     call discord_time_now_ms
-    mov rbx, rax                   ; Current time in RBX
     
     ; Calculate when next heartbeat is due
-    mov rax, [last_heartbeat]
+    mov rdx, [last_heartbeat]
     mov ecx, [heartbeat_interval]
-    add rax, rcx                   ; last_heartbeat + interval
+    add rdx, rcx                   ; last_heartbeat + interval
     
     ; Check if heartbeat is due
-    cmp rbx, rax
-    jl .no_heartbeat_needed
+    cmp rax, rdx
+    jb .no_heartbeat_needed
     
     ; Send heartbeat
     mov eax, [sequence_number]
@@ -421,54 +848,32 @@ check_and_send_heartbeat:
 %endif
     call discord_json_create_heartbeat
     
-    test rax, rax
+    test eax, eax
     jnz .heartbeat_failed
     
-    ; Send heartbeat message
-    mov rax, [rbp-8]               ; JSON data
-    
-%ifdef WINDOWS
-    mov rcx, [gateway_ptr]         ; Gateway
-    mov rdx, rax                   ; JSON data
-%else
-    mov rdi, [gateway_ptr]         ; Gateway
-    mov rsi, rax                   ; JSON data
-%endif
-    
-    ; Calculate length (inline strlen again)
-    push rsi
-    mov rcx, 0
-.hb_strlen_loop:
-    cmp byte [rsi + rcx], 0
-    je .hb_strlen_done
-    inc rcx
-    jmp .hb_strlen_loop
-.hb_strlen_done:
-    mov rdx, rcx
-    pop rsi
-    
-    call discord_ws_send
-    push rax                       ; Save result
-    
-    ; Free JSON
+    ; Send heartbeat message (frees the JSON)
 %ifdef WINDOWS
     mov rcx, [rbp-8]
 %else
     mov rdi, [rbp-8]
 %endif
-    call discord_json_free
+    call send_owned_json
+    mov [rbp-16], rax              ; Save result
     
     ; Update last heartbeat time
     call discord_time_now_ms
     mov [last_heartbeat], rax
     
-    pop rax                        ; Restore send result
+    mov rax, [rbp-16]              ; Restore send result
     jmp .cleanup
 
 .no_heartbeat_needed:
     mov rax, DISCORD_OK
+    jmp .cleanup
 
 .heartbeat_failed:
+    movsxd rax, eax                ; Sign-extend the C result code
+
 .cleanup:
     add rsp, SHADOW_SPACE + 16
     pop rbp
@@ -502,6 +907,7 @@ discord_gateway_disconnect:
     ; Reset state
     mov dword [heartbeat_interval], 0
     mov qword [last_heartbeat], 0
+    mov byte [identify_pending], 0
     mov dword [sequence_number], -1
     mov byte [is_ready], 0
     
@@ -514,4 +920,19 @@ discord_gateway_disconnect:
 .cleanup:
     add rsp, SHADOW_SPACE
     pop rbp
+    ret
+
+;------------------------------------------------------------------------------
+; discord_gateway_set_session: Attach a session snapshot to the gateway
+; Call before discord_gateway_connect so a restarted process can RESUME.
+; Input: RDI/RCX = discord_session_t* from discord_session_open (NULL detaches)
+; Output: RAX = result code
+;------------------------------------------------------------------------------
+discord_gateway_set_session:
+%ifdef WINDOWS
+    mov [session_ptr], rcx
+%else
+    mov [session_ptr], rdi
+%endif
+    mov rax, DISCORD_OK
     ret
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "abi.h"
+#include "archive.h"
+
+// Message archive benchmark.
+// Generates MESSAGE_CREATE events shaped like gateway traffic (ids two
+// milliseconds apart, a few hundred channels, thousands of authors, chat
+// drawn from a small vocabulary) and appends them through
+// discord_archive_append, so JSON field extraction is part of the ingest
+// cost. Then the archive is reopened read-only and queried: a full scan,
+// one channel, one author, both, and a 1% time window. Around 3 million
+// messages make a gigabyte of event JSON.
+
+static uint64_t message_count = 1000000;
+static uint32_t channel_count = 500;
+static uint32_t author_count = 5000;
+static const char* archive_dir = "/tmp/discord-archive-bench";
+static int keep = 0;
+
+#define BASE_MS 1700000000000ULL
+
+static const char* words[] = {
+    "the", "a", "to", "and", "is", "it", "you", "that", "of", "in", "for", "on", "this", "lol", "yeah", "just",
+    "what", "with", "have", "but", "not", "so", "be", "are", "was", "like", "can", "if", "do", "my", "me", "no",
+    "game", "server", "bot", "anyone", "tonight", "update", "patch", "raid", "join", "voice", "stream", "build",
+    "thanks", "nice", "gg", "wait", "really", "think", "know", "time", "people", "good", "new", "play", "last",
+};
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static uint64_t message_id(uint64_t n) {
+    return ((BASE_MS + n * 2 - DISCORD_SNOWFLAKE_EPOCH_MS) << 22) | (n & 0xfff);
+}
+
+// The event JSON for message n; returns its length
+static size_t make_event(uint64_t n, uint64_t* state, char* buffer, size_t size) {
+    uint64_t channel = 800000000000000000ULL + next_random(state) % channel_count;
+    uint64_t author = 300000000000000000ULL + next_random(state) % author_count;
+    int length = snprintf(buffer, size,
+                          "{\"type\":0,\"tts\":false,\"timestamp\":\"2023-11-14T22:13:20.000000+00:00\","
+                          "\"pinned\":false,\"mentions\":[],\"mention_roles\":[],\"mention_everyone\":false,"
+                          "\"id\":\"%llu\",\"flags\":0,\"embeds\":[],\"edited_timestamp\":null,"
+                          "\"channel_id\":\"%llu\",\"author\":{\"username\":\"user%llu\",\"public_flags\":0,"
+                          "\"id\":\"%llu\",\"global_name\":null,\"discriminator\":\"0\",\"avatar\":null},"
+                          "\"attachments\":[],\"guild_id\":\"900000000000000000\",\"content\":\"",
+                          (unsigned long long)message_id(n), (unsigned long long)channel,
+                          (unsigned long long)(author % 100000), (unsigned long long)author);
+    int word_count = 3 + (int)(next_random(state) % 20);
+    for (int i = 0; i < word_count && (size_t)length + 32 < size; i++) {
+        const char* word = words[next_random(state) % (sizeof(words) / sizeof(words[0]))];
+        length += snprintf(buffer + length, size - (size_t)length, i ? " %s" : "%s", word);
+    }
+    length += snprintf(buffer + length, size - (size_t)length, "\"}");
+    return (size_t)length;
+}
+
+static void remove_archive(void) {
+    DIR* dir = opendir(archive_dir);
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s", archive_dir, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(dir);
+    rmdir(archive_dir);
+}
+
+typedef struct {
+    uint64_t rows;
+    uint64_t content_bytes;
+} scan_t;
+
+static int count_row(void* user, const discord_archive_row_t* row) {
+    scan_t* scan = user;
+    scan->rows++;
+    scan->content_bytes += row->content_length;
+    return 0;
+}
+
+static void run_query(discord_archive_reader_t* reader, const char* name, const discord_archive_query_t* query) {
+    scan_t scan = {0};
+    discord_archive_query_stats_t stats;
+    uint64_t start = discord_time_now_ns();
+    discord_result_t result = discord_archive_query(reader, query, count_row, &scan, &stats);
+    double seconds = (double)(discord_time_now_ns() - start) / 1e9;
+    if (result != DISCORD_OK) {
+        printf("  %-16s failed: %d\n", name, result);
+        return;
+    }
+    printf("  %-16s %10llu rows %9.1f ms  %6.1f M rows/s scanned  groups %llu/%llu decoded/scanned\n", name,
+           (unsigned long long)scan.rows, seconds * 1000, seconds > 0 ? (double)stats.rows_scanned / seconds / 1e6 : 0,
+           (unsigned long long)stats.groups_decoded, (unsigned long long)stats.groups_scanned);
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--messages N] [--channels N] [--authors N] [--dir PATH] [--keep]\n", program_name);
+    printf("  --messages N   Messages to archive (default 1000000)\n");
+    printf("  --channels N   Distinct channels (default 500)\n");
+    printf("  --authors N    Distinct authors (default 5000)\n");
+    printf("  --dir PATH     Archive directory, emptied first (default /tmp/discord-archive-bench)\n");
+    printf("  --keep         Leave the archive in place for discord-asm-archive\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+            message_count = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            channel_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--authors") == 0 && i + 1 < argc) {
+            author_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            archive_dir = argv[++i];
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (message_count == 0 || message_count > 0x3fffffULL << 10 || channel_count == 0 || author_count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    remove_archive();
+    discord_archive_t* archive = NULL;
+    if (discord_archive_open(archive_dir, NULL, &archive) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not create the archive at %s\n", archive_dir);
+        return 1;
+    }
+
+    printf("Archive: %llu messages, %u channels, %u authors, %ld CPUs\n", (unsigned long long)message_count,
+           channel_count, author_count, sysconf(_SC_NPROCESSORS_ONLN));
+    char buffer[2048];
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t input_bytes = 0;
+    uint64_t generate_ns = 0;
+    uint64_t start = discord_time_now_ns();
+    for (uint64_t n = 0; n < message_count; n++) {
+        uint64_t before = discord_time_now_ns();
+        discord_event_t event = { 0, buffer, 0, (int)n, "MESSAGE_CREATE" };
+        event.data_length = make_event(n, &state, buffer, sizeof(buffer));
+        generate_ns += discord_time_now_ns() - before;
+        input_bytes += event.data_length;
+        if (discord_archive_append(archive, &event) != DISCORD_OK) {
+            fprintf(stderr, "Error: append failed at message %llu\n", (unsigned long long)n);
+            return 1;
+        }
+    }
+    if (discord_archive_flush(archive) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not write the archive\n");
+        return 1;
+    }
+    // Generating the JSON is not the archive's cost
+    double seconds = (double)(discord_time_now_ns() - start - generate_ns) / 1e9;
+    discord_archive_stats_t stats;
+    discord_archive_get_stats(archive, &stats);
+    discord_archive_close(archive);
+
+    printf("Ingest\n");
+    printf("  %.0f messages/s, %.1f MB/s of event JSON (%.1f MB in %.2f s)\n", (double)message_count / seconds,
+           (double)input_bytes / seconds / 1e6, (double)input_bytes / 1e6, seconds);
+    printf("  %llu segments, %llu groups, %llu appends waited for the writer\n", (unsigned long long)stats.segments,
+           (unsigned long long)stats.groups, (unsigned long long)stats.stalls);
+    printf("  on disk %.1f MB (%.1f%% of the JSON), content %.1f MB packed to %.1f MB (%.2fx)\n",
+           (double)stats.file_bytes / 1e6, (double)stats.file_bytes * 100 / (double)input_bytes,
+           (double)stats.content_bytes / 1e6, (double)stats.content_packed / 1e6,
+           stats.content_packed ? (double)stats.content_bytes / (double)stats.content_packed : 0);
+
+    discord_archive_reader_t* reader = NULL;
+    if (discord_archive_reader_open(archive_dir, &reader) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not open the archive\n");
+        return 1;
+    }
+    // Recreate the ids of one message to query for
+    uint64_t probe_state = 0x9e3779b97f4a7c15ULL;
+    uint64_t channel = 800000000000000000ULL + next_random(&probe_state) % channel_count;
+    uint64_t author = 300000000000000000ULL + next_random(&probe_state) % author_count;
+
+    printf("Queries\n");
+    discord_archive_query_t query = {0};
+    run_query(reader, "full scan", &query);
+    run_query(reader, "full scan (warm)", &query);
+    query.channel_id = channel;
+    run_query(reader, "channel", &query);
+    query.channel_id = 0;
+    query.author_id = author;
+    run_query(reader, "author", &query);
+    query.channel_id = channel;
+    run_query(reader, "channel+author", &query);
+    memset(&query, 0, sizeof(query));
+    query.since_ms = BASE_MS + message_count;       // 1% window from the middle
+    query.until_ms = query.since_ms + message_count * 2 / 100;
+    run_query(reader, "1% time window", &query);
+    discord_archive_reader_close(reader);
+
+    if (!keep) {
+        remove_archive();
+    } else {
+        printf("Archive kept in %s\n", archive_dir);
+    }
+    return 0;
+}
@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "automod.h"
+
+// Automod benchmark.
+// Builds a rule set of --keywords keywords (a tenth of them "word*" and,
+// with --substrings, a twentieth "*word*") and --domains link domains. Half
+// the keywords are chat words with a few letters added, so the automaton
+// follows ordinary text several bytes deep before giving up and most words
+// begin like some keyword; with --unrelated all of them are random letters. The corpus is
+// chat with links, emoji escapes and accented words, where about one
+// message in a hundred breaks a rule. Measures, in MB/s of content:
+//   naive     what moderation handlers do by hand: lower-case the content,
+//             then strstr for every keyword and every domain
+//   scalar    discord_automod_scan, one table step per byte
+//   skip      discord_automod_scan skipping words no keyword begins like
+//   dispatch  whole frames through discord_dispatch_frame with the rule
+//             set installed (envelope parse + content lookup + scan)
+// then the compile time and how long installing a new rule set takes.
+
+#define CORPUS_SIZE 4096
+
+static int keyword_count = 5000;
+static int domain_count = 500;
+static int message_count = 1000000;
+static int substrings = 0;
+static int unrelated = 0;
+
+static char (*keywords)[32];
+static int* keyword_any;
+static char (*domains)[32];
+static char* frames[CORPUS_SIZE];
+static const char* contents[CORPUS_SIZE];
+static size_t content_lengths[CORPUS_SIZE];
+static size_t corpus_bytes = 0;
+
+static const char* chat[] = {
+    "the", "and", "you", "that", "was", "for", "are", "with", "his", "they", "this", "have", "from",
+    "one", "had", "word", "but", "not", "what", "all", "were", "when", "your", "can", "said", "there",
+    "use", "each", "which", "she", "how", "their", "will", "other", "about", "out", "many", "then",
+    "them", "these", "some", "her", "would", "make", "like", "him", "into", "time", "has", "look",
+    "more", "write", "see", "number", "way", "could", "people", "than", "first", "water", "been",
+    "call", "who", "now", "find", "long", "down", "day", "did", "get", "come", "made", "may", "part",
+    "game", "raid", "build", "patch", "server", "lol", "gg", "thanks", "anyone", "help", "stream",
+    "tonight", "queue", "match", "lag", "update", "voice", "channel", "role", "event", "clip"
+};
+#define CHAT_WORDS (sizeof(chat) / sizeof(chat[0]))
+
+static const char* hosts[] = {
+    "youtube.com", "www.youtube.com", "github.com", "tenor.com", "cdn.discordapp.com", "twitch.tv",
+    "en.wikipedia.org", "x.com", "imgur.com", "store.steampowered.com"
+};
+
+static uint32_t rng_state = 2463534242u;
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void random_letters(char* out, int count) {
+    for (int i = 0; i < count; i++) {
+        out[i] = (char)('a' + rng() % 26);
+    }
+    out[count] = '\0';
+}
+
+static void build_rules(void) {
+    keywords = calloc((size_t)keyword_count, sizeof(*keywords));
+    keyword_any = calloc((size_t)keyword_count, sizeof(int));
+    for (int i = 0; i < keyword_count; i++) {
+        char tail[8];
+        random_letters(tail, 2 + (int)(rng() % 3));
+        if (i % 2 && !unrelated) {
+            snprintf(keywords[i], sizeof(keywords[i]), "%s%s", chat[rng() % CHAT_WORDS], tail);
+        } else {
+            char head[8];
+            random_letters(head, 3 + (int)(rng() % 4));
+            snprintf(keywords[i], sizeof(keywords[i]), "%s%s", head, tail);
+        }
+        keyword_any[i] = substrings && i % 20 == 0 ? 2 : (i % 10 == 0 ? 1 : 0);
+    }
+
+    domains = calloc((size_t)domain_count, sizeof(*domains));
+    for (int i = 0; i < domain_count; i++) {
+        char name[12];
+        random_letters(name, 5 + (int)(rng() % 6));
+        snprintf(domains[i], sizeof(domains[i]), "%s.%s", name, i % 3 ? "com" : "gift");
+    }
+}
+
+static void build_corpus(void) {
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        char content[1024];
+        size_t length = 0;
+        int words = 3 + (int)(rng() % 40);
+        for (int w = 0; w < words; w++) {
+            const char* word = chat[rng() % CHAT_WORDS];
+            uint32_t roll = rng() % 1000;
+            if (roll < 15) {
+                word = "\\ud83d\\ude02";
+            } else if (roll < 25) {
+                word = "caf\xC3\xA9";
+            }
+            length += (size_t)snprintf(content + length, sizeof(content) - length, "%s%s%s",
+                                       w ? " " : "", w == 0 && roll % 7 == 0 ? "Hey" : word,
+                                       roll % 11 == 0 ? "," : (roll % 13 == 0 ? "!" : ""));
+        }
+
+        uint32_t roll = rng() % 100;
+        if (roll < 8) {
+            const char* host = roll == 0 ? domains[rng() % (uint32_t)domain_count] : hosts[rng() % 10];
+            length += (size_t)snprintf(content + length, sizeof(content) - length,
+                                       " https://%s/watch?v=%u", host, rng() % 100000);
+        } else if (roll == 8 && keyword_count > 0) {
+            int k = (int)(rng() % (uint32_t)keyword_count);
+            length += (size_t)snprintf(content + length, sizeof(content) - length, " %s", keywords[k]);
+        }
+
+        frames[i] = malloc(length + 512);
+        int prefix = snprintf(frames[i], length + 512,
+            "{\"t\":\"MESSAGE_CREATE\",\"s\":%d,\"op\":0,\"d\":{\"id\":\"1200000000000000%04d\","
+            "\"channel_id\":\"1100000000000000000\",\"author\":{\"id\":\"1000000000000000001\","
+            "\"username\":\"someone\",\"bot\":false},\"content\":\"", i + 1, i);
+        snprintf(frames[i] + prefix, length + 512 - (size_t)prefix,
+                 "%s\",\"tts\":false,\"mentions\":[],\"attachments\":[]}}", content);
+        contents[i] = frames[i] + prefix;
+        content_lengths[i] = length;
+        corpus_bytes += length;
+    }
+}
+
+static int is_word(unsigned char c) {
+    return c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+// Lower-case copy, then one strstr per keyword and per domain
+static int naive_scan(const char* content, size_t length) {
+    char text[1024];
+    for (size_t i = 0; i < length; i++) {
+        char c = content[i];
+        text[i] = c >= 'A' && c <= 'Z' ? (char)(c + 32) : c;
+    }
+    text[length] = '\0';
+
+    int hits = 0;
+    for (int k = 0; k < keyword_count; k++) {
+        size_t n = strlen(keywords[k]);
+        for (const char* p = strstr(text, keywords[k]); p; p = strstr(p + 1, keywords[k])) {
+            int left = keyword_any[k] == 2 || p == text || !is_word((unsigned char)p[-1]);
+            int right = keyword_any[k] != 0 || !is_word((unsigned char)p[n]);
+            if (left && right) {
+                hits++;
+                break;
+            }
+        }
+    }
+    for (const char* link = strstr(text, "://"); link; link = strstr(link + 1, "://")) {
+        for (int d = 0; d < domain_count; d++) {
+            const char* host = strstr(link + 3, domains[d]);
+            size_t n = strlen(domains[d]);
+            if (host && (host == link + 3 || host[-1] == '.') && !is_word((unsigned char)host[n])) {
+                hits++;
+            }
+        }
+    }
+    return hits;
+}
+
+static void report(const char* label, uint64_t elapsed_ns, int messages, uint64_t bytes) {
+    double seconds = (double)elapsed_ns / 1e9;
+    printf("  %-9s %9.1f MB/s  %10.0f msgs/sec  %8.1f ns/msg\n", label,
+           seconds > 0 ? (double)bytes / seconds / 1e6 : 0.0,
+           seconds > 0 ? (double)messages / seconds : 0.0,
+           (double)elapsed_ns / (double)messages);
+}
+
+static discord_automod_t* build_automod(int scalar_only) {
+    discord_automod_config_t config = { NULL, NULL, 0, scalar_only };
+    discord_automod_t* automod = NULL;
+    if (discord_automod_create(&config, &automod) != DISCORD_OK) {
+        return NULL;
+    }
+    for (int i = 0; i < keyword_count; i++) {
+        char pattern[40];
+        snprintf(pattern, sizeof(pattern), "%s%s%s", keyword_any[i] == 2 ? "*" : "", keywords[i],
+                 keyword_any[i] ? "*" : "");
+        discord_automod_rule_t rule = { DISCORD_AUTOMOD_KEYWORD, pattern, DISCORD_AUTOMOD_FLAG, (uint32_t)i };
+        discord_automod_add(automod, &rule);
+    }
+    for (int i = 0; i < domain_count; i++) {
+        discord_automod_rule_t rule = { DISCORD_AUTOMOD_DOMAIN, domains[i], DISCORD_AUTOMOD_BLOCK, (uint32_t)i };
+        discord_automod_add(automod, &rule);
+    }
+    if (discord_automod_compile(automod) != DISCORD_OK) {
+        discord_automod_destroy(automod);
+        return NULL;
+    }
+    return automod;
+}
+
+static uint64_t run_scan(discord_automod_t* automod, uint64_t* matched) {
+    discord_automod_verdict_t verdict;
+    uint64_t start = discord_time_now_ns();
+    for (int i = 0; i < message_count; i++) {
+        int slot = i & (CORPUS_SIZE - 1);
+        discord_automod_scan(automod, contents[slot], content_lengths[slot], &verdict);
+        *matched += verdict.match_count != 0;
+    }
+    return discord_time_now_ns() - start;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--keywords N] [--domains N] [--messages N] [--substrings] [--unrelated]\n",
+           program_name);
+    printf("  --keywords N    Keyword rules (default 5000)\n");
+    printf("  --domains N     Domain rules (default 500)\n");
+    printf("  --messages N    Messages per measurement (default 1000000; naive runs 1/100)\n");
+    printf("  --substrings    Make 1 keyword in 20 a \"*word*\" rule (turns the word skip off)\n");
+    printf("  --unrelated     Build no keyword on a chat word\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--keywords") == 0 && i + 1 < argc) {
+            keyword_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--domains") == 0 && i + 1 < argc) {
+            domain_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+            message_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--substrings") == 0) {
+            substrings = 1;
+        } else if (strcmp(argv[i], "--unrelated") == 0) {
+            unrelated = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (keyword_count < 0 || domain_count <= 0 || message_count < 100) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    build_rules();
+    build_corpus();
+
+    uint64_t compile_start = discord_time_now_ns();
+    discord_automod_t* automod = build_automod(0);
+    uint64_t compile_ns = discord_time_now_ns() - compile_start;
+    discord_automod_t* scalar = build_automod(1);
+    if (!automod || !scalar) {
+        fprintf(stderr, "Error: could not build the rule set\n");
+        return 1;
+    }
+
+    // Bytes per measurement follow the corpus average
+    double average = (double)corpus_bytes / CORPUS_SIZE;
+    printf("Automod: %d%s keywords%s, %d domains, %d messages of %.0f bytes on average\n",
+           keyword_count, unrelated ? " unrelated" : "", substrings ? " (5% \"*word*\")" : "",
+           domain_count, message_count, average);
+
+    int naive_messages = message_count / 100;
+    uint64_t naive_bytes = 0;
+    int naive_hits = 0;
+    uint64_t start = discord_time_now_ns();
+    for (int i = 0; i < naive_messages; i++) {
+        int slot = i & (CORPUS_SIZE - 1);
+        naive_hits += naive_scan(contents[slot], content_lengths[slot]) != 0;
+        naive_bytes += content_lengths[slot];
+    }
+    report("naive", discord_time_now_ns() - start, naive_messages, naive_bytes);
+
+    uint64_t bytes = (uint64_t)(average * message_count);
+    uint64_t scalar_matched = 0;
+    uint64_t skip_matched = 0;
+    report("scalar", run_scan(scalar, &scalar_matched), message_count, bytes);
+    report("skip", run_scan(automod, &skip_matched), message_count, bytes);
+
+    discord_dispatch_clear();
+    discord_automod_t* previous = NULL;
+    discord_automod_install(automod, 1000, &previous);
+    start = discord_time_now_ns();
+    for (int i = 0; i < message_count; i++) {
+        discord_dispatch_frame(frames[i & (CORPUS_SIZE - 1)]);
+    }
+    report("dispatch", discord_time_now_ns() - start, message_count, bytes);
+
+    uint64_t install_start = discord_time_now_ns();
+    discord_automod_install(scalar, 1000, &previous);
+    uint64_t install_ns = discord_time_now_ns() - install_start;
+
+    discord_automod_stats_t stats;
+    discord_automod_get_stats(automod, &stats);
+    printf("  compile   %.2f ms, %u states x %u classes, %.1f MB, word skip %s\n",
+           (double)compile_ns / 1e6, stats.states, stats.classes, (double)stats.table_bytes / 1e6,
+           stats.word_skip ? "on" : "off");
+    printf("  install   %.3f ms to swap in a new rule set\n", (double)install_ns / 1e6);
+    printf("  outcomes  %.2f%% of messages matched (naive %.2f%%), %.0f%% of bytes skipped, %llu blocked\n",
+           100.0 * (double)skip_matched / message_count, 100.0 * naive_hits / naive_messages,
+           stats.bytes ? 100.0 * (double)stats.skipped_bytes / (double)stats.bytes : 0.0,
+           (unsigned long long)stats.blocked);
+    if (scalar_matched != skip_matched) {
+        fprintf(stderr, "Error: scalar and skip scans disagree (%llu vs %llu)\n",
+                (unsigned long long)scalar_matched, (unsigned long long)skip_matched);
+        return 1;
+    }
+
+    discord_automod_install(NULL, 1000, &previous);
+    discord_automod_destroy(automod);
+    discord_automod_destroy(scalar);
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        free(frames[i]);
+    }
+    free(keywords);
+    free(keyword_any);
+    free(domains);
+    return 0;
+}
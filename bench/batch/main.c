@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "qos.h"
+
+// Batched dispatch benchmark.
+// Replays a reaction storm (MESSAGE_REACTION_ADD across many guilds, with
+// a share of MESSAGE_CREATE mixed in) through discord_dispatch_frame, with
+// discord_qos_poll(1) after every --burst frames the way the gateway loop
+// calls it once the socket is drained. Each handler call pays a fixed
+// commit cost (--commit-ns, standing in for a cache write or a database
+// round trip) and every event pays for pulling out its user id and
+// counting it. Per-event handlers commit once per event; batch handlers
+// once per batch.
+
+static int event_count = 1000000;
+static int guild_count = 200;
+static int mix_percent = 5;
+static int burst = 256;
+static uint64_t commit_ns = 2000;
+static uint32_t batch_sizes[8] = { 8, 64, 256 };
+static int batch_runs = 3;
+
+#define COUNTER_SLOTS 4096
+
+static uint64_t counters[COUNTER_SLOTS];
+static uint64_t commits = 0;
+static uint64_t events_seen = 0;
+
+static void commit(void) {
+    uint64_t until = discord_time_now_ns() + commit_ns;
+    while (commit_ns && discord_time_now_ns() < until) {
+    }
+    commits++;
+}
+
+static void count_user(const discord_event_t* event) {
+    const char* cursor = event->data;
+    const char* end = event->data + event->data_length;
+    const char* key;
+    const char* value;
+    size_t key_length;
+    size_t value_length;
+    while (discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK) {
+        if (key_length == 7 && memcmp(key, "user_id", 7) == 0) {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < value_length; i++) {
+                hash = (hash ^ (unsigned char)value[i]) * 16777619u;
+            }
+            counters[hash % COUNTER_SLOTS]++;
+            break;
+        }
+    }
+    events_seen++;
+}
+
+static void on_reaction(const discord_event_t* event) {
+    count_user(event);
+    commit();
+}
+
+static void on_reactions(const discord_event_t* events, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        count_user(&events[i]);
+    }
+    commit();
+}
+
+static void on_message(const discord_event_t* event) {
+    (void)event;
+}
+
+static char** make_frames(void) {
+    char** frames = malloc((size_t)event_count * sizeof(char*));
+    if (!frames) {
+        return NULL;
+    }
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    for (int i = 0; i < event_count; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        unsigned guild = (unsigned)(state % (uint64_t)guild_count);
+        unsigned user = (unsigned)((state >> 20) % 100000);
+        char frame[512];
+        if ((int)((state >> 40) % 100) < mix_percent) {
+            snprintf(frame, sizeof(frame),
+                     "{\"t\":\"MESSAGE_CREATE\",\"s\":%d,\"op\":0,\"d\":{\"id\":\"%d\",\"channel_id\":\"%u\","
+                     "\"guild_id\":\"%u\",\"author\":{\"id\":\"%u\"},\"content\":\"hello\"}}",
+                     i + 1, i, guild * 10, guild, user);
+        } else {
+            snprintf(frame, sizeof(frame),
+                     "{\"t\":\"MESSAGE_REACTION_ADD\",\"s\":%d,\"op\":0,\"d\":{\"user_id\":\"%u\",\"type\":0,"
+                     "\"message_id\":\"%d\",\"message_author_id\":\"1\",\"member\":{\"roles\":[]},"
+                     "\"emoji\":{\"name\":\"\\ud83d\\udc4d\",\"id\":null},\"channel_id\":\"%u\",\"burst\":false,"
+                     "\"guild_id\":\"%u\"}}",
+                     i + 1, user, i, guild * 10, guild);
+        }
+        frames[i] = strdup(frame);
+        if (!frames[i]) {
+            return NULL;
+        }
+    }
+    return frames;
+}
+
+static double run(char** frames) {
+    events_seen = 0;
+    commits = 0;
+    uint64_t start = discord_time_now_ns();
+    for (int i = 0; i < event_count; i++) {
+        discord_dispatch_frame(frames[i]);
+        if ((i + 1) % burst == 0) {
+            discord_qos_poll(1);
+        }
+    }
+    discord_qos_poll(1);
+    return (double)(discord_time_now_ns() - start) / 1e9;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--events N] [--guilds N] [--mix PCT] [--burst N] [--commit-ns NS] [--batch N[,N...]]\n",
+           program_name);
+    printf("  --events N        Frames to dispatch (default 1000000)\n");
+    printf("  --guilds N        Guilds the events are spread over (default 200)\n");
+    printf("  --mix PCT         Share of MESSAGE_CREATE frames, not batched (default 5)\n");
+    printf("  --burst N         Frames between drained-socket polls (default 256)\n");
+    printf("  --commit-ns NS    Fixed cost of each handler call (default 2000)\n");
+    printf("  --batch N,N,...   max_events values to run (default 8,64,256)\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            event_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--guilds") == 0 && i + 1 < argc) {
+            guild_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+            mix_percent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            burst = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--commit-ns") == 0 && i + 1 < argc) {
+            commit_ns = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            char* p = argv[++i];
+            batch_runs = 0;
+            while (*p && batch_runs < 8) {
+                batch_sizes[batch_runs++] = (uint32_t)strtoul(p, &p, 10);
+                if (*p == ',') {
+                    p++;
+                }
+            }
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (event_count <= 0 || guild_count <= 0 || mix_percent < 0 || mix_percent > 100 || burst <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    for (int i = 0; i < batch_runs; i++) {
+        if (batch_sizes[i] == 0 || batch_sizes[i] > DISCORD_DISPATCH_BATCH_MAX) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    char** frames = make_frames();
+    if (!frames) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    printf("Batch dispatch: %d frames, %d guilds, %d%% MESSAGE_CREATE, drained every %d, commit %llu ns\n",
+           event_count, guild_count, mix_percent, burst, (unsigned long long)commit_ns);
+    discord_dispatch_on("MESSAGE_CREATE", on_message);
+
+    discord_dispatch_on("MESSAGE_REACTION_ADD", on_reaction);
+    double seconds = run(frames);
+    double per_event = (double)event_count / seconds;
+    printf("  per event        %10.0f events/s  %7.1f ns/event  %llu commits\n", per_event,
+           seconds * 1e9 / event_count, (unsigned long long)commits);
+
+    for (int i = 0; i < batch_runs; i++) {
+        discord_batch_config_t config = { batch_sizes[i], 0 };
+        discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, &config);
+        discord_batch_stats_t before;
+        discord_dispatch_get_batch_stats(&before);
+        seconds = run(frames);
+        discord_batch_stats_t stats;
+        discord_dispatch_get_batch_stats(&stats);
+        uint64_t batches = stats.batches - before.batches;
+        printf("  batch of %-6u %10.0f events/s  %7.1f ns/event  %llu commits, %.1f events/batch "
+               "(%llu full, %llu drained, %llu for order)  %.2fx\n",
+               batch_sizes[i], (double)event_count / seconds, seconds * 1e9 / event_count,
+               (unsigned long long)commits, batches ? (double)(stats.events - before.events) / (double)batches : 0,
+               (unsigned long long)(stats.full - before.full), (unsigned long long)(stats.drained - before.drained),
+               (unsigned long long)(stats.ordered - before.ordered), (double)event_count / seconds / per_event);
+    }
+
+    discord_dispatch_clear();
+    for (int i = 0; i < event_count; i++) {
+        free(frames[i]);
+    }
+    free(frames);
+    return 0;
+}
@@ -0,0 +1,494 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <openssl/evp.h>
+#include "abi.h"
+#include "shard.h"
+#include "coord.h"
+#include "wsframe.h"
+
+// Cross-process identify benchmark.
+// Forks --processes worker processes that run --shards shards between
+// them against a mock gateway on loopback (plain ws:// on the io_uring
+// transport, in real time). Like Discord, the gateway allows one IDENTIFY
+// per bucket (shard_id % --concurrency) per DISCORD_IDENTIFY_WINDOW_MS and
+// answers any other with op 9; the shard waits 1-5 s and tries again.
+//
+// Uncoordinated, each process takes a fixed range and paces IDENTIFY with
+// its own limiter, so processes collide in the shared buckets. Coordinated,
+// the processes get their ranges and IDENTIFY slots from a coordinator
+// running in this process. Reported: time from starting the processes to
+// every shard READY, IDENTIFYs rejected, and with the coordinator the time
+// to get the shards of a killed process READY again elsewhere.
+
+#define MAX_SHARDS      1024
+#define MAX_PROCESSES   64
+#define RUN_TIMEOUT_MS  300000
+#define WINDOW_SLACK_MS 100             // Send jitter the gateway forgives in a bucket window
+
+static int shard_count = 16;
+static int max_concurrency = 4;
+static int process_count = 4;
+static int run_baseline = 1;
+
+typedef struct {
+    int listener;
+    int port;
+    volatile int stop;
+    uint64_t bucket_next_ms[MAX_SHARDS];
+    uint64_t first_ready_ms[MAX_SHARDS];    // 0 = not READY yet
+    uint64_t last_ready_ms[MAX_SHARDS];
+    uint32_t ready_shards;                  // With a first READY
+    uint64_t identifies;
+    uint64_t rejected;
+} mock_gateway_t;
+
+typedef struct {
+    int fd;
+    int upgraded;
+    size_t used;
+    uint8_t data[8192];
+} mock_conn_t;
+
+static mock_gateway_t gateway;
+static char socket_path[64];
+
+// Gateway
+
+static void mock_send(mock_conn_t* conn, const char* json) {
+    uint8_t header[DISCORD_WSFRAME_HEADER_MAX];
+    size_t length = strlen(json);
+    size_t header_length = discord_wsframe_header(header, DISCORD_WSFRAME_TEXT, 1, length, NULL);
+    if (send(conn->fd, header, header_length, MSG_NOSIGNAL) < 0 || send(conn->fd, json, length, MSG_NOSIGNAL) < 0) {
+        return;
+    }
+}
+
+static int mock_upgrade(mock_conn_t* conn) {
+    conn->data[conn->used] = '\0';
+    char* end = strstr((char*)conn->data, "\r\n\r\n");
+    if (!end) {
+        return conn->used < sizeof(conn->data) - 1 ? 0 : -1;
+    }
+    const char* key = strstr((char*)conn->data, "Sec-WebSocket-Key:");
+    if (!key) {
+        return -1;
+    }
+    key += 18;
+    while (*key == ' ') {
+        key++;
+    }
+    char concatenated[128], accept_key[64], response[256];
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned digest_length = 0;
+    int key_length = (int)strcspn(key, "\r\n");
+    snprintf(concatenated, sizeof(concatenated), "%.*s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key_length, key);
+    EVP_Digest(concatenated, strlen(concatenated), digest, &digest_length, EVP_sha1(), NULL);
+    EVP_EncodeBlock((unsigned char*)accept_key, digest, (int)digest_length);
+    int n = snprintf(response, sizeof(response), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                     "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept_key);
+    if (send(conn->fd, response, (size_t)n, MSG_NOSIGNAL) != n) {
+        return -1;
+    }
+    mock_send(conn, "{\"t\":null,\"s\":null,\"op\":10,\"d\":{\"heartbeat_interval\":41250}}");
+
+    size_t consumed = (size_t)(end + 4 - (char*)conn->data);
+    memmove(conn->data, conn->data + consumed, conn->used - consumed);
+    conn->used -= consumed;
+    conn->upgraded = 1;
+    return 0;
+}
+
+static void mock_identify(mock_conn_t* conn, const char* json) {
+    const char* shard = strstr(json, "\"shard\":[");
+    int id = shard ? atoi(shard + 9) : 0;
+    if (id < 0 || id >= MAX_SHARDS) {
+        return;
+    }
+
+    uint64_t now = discord_time_now_ms();
+    uint64_t* bucket = &gateway.bucket_next_ms[id % max_concurrency];
+    if (*bucket > now) {
+        __atomic_add_fetch(&gateway.rejected, 1, __ATOMIC_RELAXED);
+        mock_send(conn, "{\"t\":null,\"s\":null,\"op\":9,\"d\":false}");
+        return;
+    }
+    *bucket = now + DISCORD_IDENTIFY_WINDOW_MS - WINDOW_SLACK_MS;
+    __atomic_add_fetch(&gateway.identifies, 1, __ATOMIC_RELAXED);
+
+    char ready[256];
+    snprintf(ready, sizeof(ready),
+             "{\"t\":\"READY\",\"s\":1,\"op\":0,\"d\":{\"v\":10,\"session_id\":\"session-%d\","
+             "\"resume_gateway_url\":\"ws://127.0.0.1:%d\",\"shard\":[%d,%d]}}",
+             id, gateway.port, id, shard_count);
+    mock_send(conn, ready);
+    __atomic_store_n(&gateway.last_ready_ms[id], now, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&gateway.first_ready_ms[id], __ATOMIC_ACQUIRE) == 0) {
+        __atomic_store_n(&gateway.first_ready_ms[id], now, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&gateway.ready_shards, 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+// 0 to keep the connection
+static int mock_frames(mock_conn_t* conn) {
+    size_t offset = 0;
+    discord_wsframe_t frame;
+    int parsed;
+    while ((parsed = discord_wsframe_parse(conn->data + offset, conn->used - offset, &frame)) == 1) {
+        size_t total = frame.header_length + (size_t)frame.payload_length;
+        if (conn->used - offset < total) {
+            break;
+        }
+        uint8_t* payload = conn->data + offset + frame.header_length;
+        size_t length = (size_t)frame.payload_length;
+        if (frame.masked) {
+            discord_wsframe_mask(payload, length, frame.mask, 0);
+        }
+        if (frame.opcode == DISCORD_WSFRAME_CLOSE) {
+            return -1;
+        }
+        if (frame.opcode == DISCORD_WSFRAME_TEXT) {
+            char json[2048];
+            if (length >= sizeof(json)) {
+                return -1;
+            }
+            memcpy(json, payload, length);
+            json[length] = '\0';
+            int op = -1;
+            discord_json_parse_root_int(json, length, "op", &op);
+            if (op == DISCORD_OP_IDENTIFY) {
+                mock_identify(conn, json);
+            } else if (op == DISCORD_OP_HEARTBEAT) {
+                mock_send(conn, "{\"t\":null,\"s\":null,\"op\":11,\"d\":null}");
+            } else if (op == DISCORD_OP_RESUME) {
+                mock_send(conn, "{\"t\":\"RESUMED\",\"s\":2,\"op\":0,\"d\":{}}");
+            }
+        }
+        offset += total;
+    }
+    if (parsed < 0) {
+        return -1;
+    }
+    memmove(conn->data, conn->data + offset, conn->used - offset);
+    conn->used -= offset;
+    return 0;
+}
+
+static void* mock_gateway_thread(void* arg) {
+    (void)arg;
+    mock_conn_t* conns[MAX_SHARDS * 2];
+    struct pollfd pollfds[MAX_SHARDS * 2 + 1];
+    int count = 0;
+
+    while (!gateway.stop) {
+        pollfds[0] = (struct pollfd){ gateway.listener, POLLIN, 0 };
+        for (int i = 0; i < count; i++) {
+            pollfds[i + 1] = (struct pollfd){ conns[i]->fd, POLLIN, 0 };
+        }
+        if (poll(pollfds, (nfds_t)count + 1, 10) <= 0) {
+            continue;
+        }
+
+        for (int i = count - 1; i >= 0; i--) {
+            if (!pollfds[i + 1].revents) {
+                continue;
+            }
+            mock_conn_t* conn = conns[i];
+            ssize_t n = recv(conn->fd, conn->data + conn->used, sizeof(conn->data) - 1 - conn->used, 0);
+            int keep = n > 0;
+            if (keep) {
+                conn->used += (size_t)n;
+                if (!conn->upgraded) {
+                    keep = mock_upgrade(conn) == 0;
+                }
+                if (keep && conn->upgraded) {
+                    keep = mock_frames(conn) == 0;
+                }
+            }
+            if (!keep) {
+                close(conn->fd);
+                free(conn);
+                conns[i] = conns[--count];
+            }
+        }
+
+        if (pollfds[0].revents && count < MAX_SHARDS * 2) {
+            int fd = accept(gateway.listener, NULL, NULL);
+            mock_conn_t* conn = fd >= 0 ? calloc(1, sizeof(mock_conn_t)) : NULL;
+            if (conn) {
+                conn->fd = fd;
+                conns[count++] = conn;
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        close(conns[i]->fd);
+        free(conns[i]);
+    }
+    return NULL;
+}
+
+static int mock_gateway_listen(void) {
+    gateway.listener = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(gateway.listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(gateway.listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(gateway.listener, 1024) != 0 ||
+        getsockname(gateway.listener, (struct sockaddr*)&address, &length) != 0) {
+        return -1;
+    }
+    gateway.port = ntohs(address.sin_port);
+    return 0;
+}
+
+// Workers
+
+static void worker_poll_shards(discord_shard_t** shards) {
+    for (int id = 0; id < shard_count; id++) {
+        if (shards[id]) {
+            discord_shard_poll(shards[id], 0);
+        }
+    }
+    usleep(1000);
+}
+
+static discord_shard_t* worker_shard(int id, discord_identify_limiter_t* limiter, discord_coord_t* coord) {
+    char url[64];
+    snprintf(url, sizeof(url), "ws://127.0.0.1:%d/?v=10&encoding=json", gateway.port);
+    discord_ws_options_t ws = {0};
+    ws.transport = DISCORD_WS_TRANSPORT_URING;
+    discord_shard_config_t config = {0};
+    config.token = "bench-token";
+    config.url = url;
+    config.shard_id = id;
+    config.shard_count = shard_count;
+    config.ws = &ws;
+    config.limiter = limiter;
+    config.coord = coord;
+    discord_shard_t* shard = NULL;
+    return discord_shard_create(&config, &shard) == DISCORD_OK ? shard : NULL;
+}
+
+// Runs until killed
+static void worker_main(int index, int coordinated) {
+    discord_shard_t* shards[MAX_SHARDS] = {0};
+    close(gateway.listener);
+
+    if (!coordinated) {
+        discord_identify_limiter_t* limiter = NULL;
+        discord_identify_limiter_create((uint32_t)max_concurrency, &limiter);
+        int first = index * shard_count / process_count;
+        int last = (index + 1) * shard_count / process_count;
+        for (int id = first; id < last; id++) {
+            shards[id] = worker_shard(id, limiter, NULL);
+        }
+        for (;;) {
+            worker_poll_shards(shards);
+        }
+    }
+
+    discord_coord_t* coord = NULL;
+    if (discord_coord_connect(socket_path, &coord) != DISCORD_OK) {
+        _exit(1);
+    }
+    for (;;) {
+        discord_result_t result = discord_coord_poll(coord, 0);
+        if (result == DISCORD_ERROR_NETWORK) {
+            _exit(0);
+        }
+        if (result == DISCORD_OK) {
+            for (int id = 0; id < shard_count; id++) {
+                if (discord_coord_owns(coord, id) && !shards[id]) {
+                    shards[id] = worker_shard(id, NULL, coord);
+                } else if (!discord_coord_owns(coord, id) && shards[id]) {
+                    discord_shard_destroy(shards[id]);
+                    shards[id] = NULL;
+                }
+            }
+            discord_coord_confirm(coord);
+        }
+        worker_poll_shards(shards);
+    }
+}
+
+// Parent
+
+typedef struct {
+    double all_ready_ms;
+    double recover_ms;              // Coordinated only
+    uint64_t identifies;
+    uint64_t rejected;
+    discord_coord_server_stats_t coord;
+} run_result_t;
+
+static int run(int coordinated, run_result_t* result) {
+    memset(result, 0, sizeof(*result));
+    memset(gateway.bucket_next_ms, 0, sizeof(gateway.bucket_next_ms));
+    memset(gateway.first_ready_ms, 0, sizeof(gateway.first_ready_ms));
+    memset(gateway.last_ready_ms, 0, sizeof(gateway.last_ready_ms));
+    gateway.ready_shards = 0;
+    gateway.identifies = 0;
+    gateway.rejected = 0;
+    gateway.stop = 0;
+
+    discord_coord_server_t* server = NULL;
+    if (coordinated) {
+        discord_coord_server_config_t config = { socket_path, (uint32_t)shard_count, (uint32_t)max_concurrency,
+                                                 (uint32_t)process_count, 0 };
+        if (discord_coord_server_create(&config, &server) != DISCORD_OK) {
+            return -1;
+        }
+    }
+
+    // Workers are forked before the gateway thread starts, so they hold
+    // none of its connections
+    uint64_t start = discord_time_now_ms();
+    pid_t workers[MAX_PROCESSES];
+    for (int w = 0; w < process_count; w++) {
+        workers[w] = fork();
+        if (workers[w] == 0) {
+            worker_main(w, coordinated);
+            _exit(0);
+        }
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, mock_gateway_thread, NULL);
+
+    int failed = 0;
+    while (__atomic_load_n(&gateway.ready_shards, __ATOMIC_ACQUIRE) < (uint32_t)shard_count) {
+        if (discord_time_now_ms() - start > RUN_TIMEOUT_MS) {
+            failed = 1;
+            break;
+        }
+        if (server) {
+            discord_coord_server_poll(server, 5);
+        } else {
+            usleep(5000);
+        }
+    }
+    uint64_t all_ready = 0;
+    for (int id = 0; id < shard_count; id++) {
+        all_ready = gateway.first_ready_ms[id] > all_ready ? gateway.first_ready_ms[id] : all_ready;
+    }
+    result->all_ready_ms = failed ? -1 : (double)(all_ready - start);
+
+    if (server && !failed) {
+        // Let the coordinator see every READY, then kill the first worker
+        discord_coord_server_stats_t stats;
+        do {
+            discord_coord_server_poll(server, 5);
+            discord_coord_server_get_stats(server, &stats);
+        } while (!stats.all_ready_ms);
+        uint64_t killed = discord_time_now_ms();
+        kill(workers[0], SIGKILL);
+        waitpid(workers[0], NULL, 0);
+        workers[0] = 0;
+        do {
+            discord_coord_server_poll(server, 5);
+            discord_coord_server_get_stats(server, &stats);
+            if (discord_time_now_ms() - killed > RUN_TIMEOUT_MS) {
+                failed = 1;
+                break;
+            }
+        } while (!stats.leaves || !stats.all_ready_ms);
+        result->recover_ms = failed ? -1 : (double)(stats.all_ready_ms - killed);
+        result->coord = stats;
+    }
+
+    for (int w = 0; w < process_count; w++) {
+        if (workers[w]) {
+            kill(workers[w], SIGKILL);
+            waitpid(workers[w], NULL, 0);
+        }
+    }
+    gateway.stop = 1;
+    pthread_join(thread, NULL);
+    discord_coord_server_destroy(server);
+    result->identifies = gateway.identifies;
+    result->rejected = gateway.rejected;
+    return failed ? -1 : 0;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--shards N] [--concurrency N] [--processes N] [--coordinated-only]\n", program_name);
+    printf("  --shards N          Shards of the bot (default 16)\n");
+    printf("  --concurrency N     max_concurrency the gateway enforces (default 4)\n");
+    printf("  --processes N       Worker processes (default 4)\n");
+    printf("  --coordinated-only  Skip the run without a coordinator\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shard_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            max_concurrency = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--processes") == 0 && i + 1 < argc) {
+            process_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--coordinated-only") == 0) {
+            run_baseline = 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (shard_count <= 0 || shard_count > MAX_SHARDS || max_concurrency <= 0 || process_count <= 1 ||
+        process_count > MAX_PROCESSES || process_count > shard_count) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    snprintf(socket_path, sizeof(socket_path), "/tmp/discord-coord-bench-%d.sock", (int)getpid());
+    if (mock_gateway_listen() != 0) {
+        fprintf(stderr, "Error: cannot listen on loopback\n");
+        return 1;
+    }
+
+    int buckets = max_concurrency < shard_count ? max_concurrency : shard_count;
+    int rounds = (shard_count + buckets - 1) / buckets;
+    printf("Cold start: %d shards over %d processes, max_concurrency %d, %d ms identify window "
+           "(at best %d ms to all READY)\n", shard_count, process_count, max_concurrency,
+           DISCORD_IDENTIFY_WINDOW_MS, (rounds - 1) * DISCORD_IDENTIFY_WINDOW_MS);
+
+    run_result_t result;
+    if (run_baseline) {
+        if (run(0, &result) != 0) {
+            printf("  per-process limiters  not all READY after %d s (%llu rejected)\n", RUN_TIMEOUT_MS / 1000,
+                   (unsigned long long)result.rejected);
+        } else {
+            printf("  per-process limiters  all READY in %8.0f ms  %4llu IDENTIFY, %4llu rejected with op 9\n",
+                   result.all_ready_ms, (unsigned long long)result.identifies, (unsigned long long)result.rejected);
+        }
+    }
+
+    if (run(1, &result) != 0) {
+        printf("  coordinator           not all READY after %d s\n", RUN_TIMEOUT_MS / 1000);
+        close(gateway.listener);
+        return 1;
+    }
+    printf("  coordinator           all READY in %8.0f ms  %4llu IDENTIFY, %4llu rejected with op 9\n",
+           result.all_ready_ms, (unsigned long long)result.identifies, (unsigned long long)result.rejected);
+    printf("  worker killed         its shards READY elsewhere in %.0f ms (%llu moved, %llu of %llu grants delayed)\n",
+           result.recover_ms, (unsigned long long)result.coord.shards_moved,
+           (unsigned long long)result.coord.grants_delayed, (unsigned long long)result.coord.grants);
+    close(gateway.listener);
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "abi.h"
+#include "fanout.h"
+
+// Shared-memory fan-out benchmark.
+// For each consumer count the publisher forks that many consumer
+// processes on a fresh ring and publishes MESSAGE_CREATE-sized events:
+// first as fast as the ring allows (throughput), then paced at --rate
+// (latency without a standing queue). Each consumer measures publish to
+// receive time from the record timestamp (CLOCK_MONOTONIC is shared by
+// all processes) and reports back over a pipe. The worst consumer's
+// percentiles are printed.
+
+static int event_count = 200000;
+static int payload_size = 700;
+static uint32_t rate = 50000;
+static discord_fanout_mode_t mode = DISCORD_FANOUT_BLOCK;
+static const char* ring_path = "/tmp/discord-fanout-bench";
+static int consumer_counts[16] = { 1, 2, 4, 8, 16 };
+static int consumer_runs = 5;
+
+typedef struct {
+    uint64_t received;
+    uint64_t lost;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+} consumer_result_t;
+
+typedef struct {
+    double events_per_sec;
+    uint64_t dropped;
+    uint64_t waits;
+    consumer_result_t worst;
+} phase_result_t;
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--events N] [--size BYTES] [--rate N] [--consumers N[,N...]] [--drop]\n", program_name);
+    printf("  --events N            Events per phase (default 200000)\n");
+    printf("  --size BYTES          Payload size (default 700)\n");
+    printf("  --rate N              Events/sec in the latency phase (default 50000)\n");
+    printf("  --consumers N,N,...   Consumer counts to run (default 1,2,4,8,16)\n");
+    printf("  --drop                DROP consumers instead of BLOCK\n");
+}
+
+// Consumer process: read until the ring closes, report through fd
+static int run_consumer(int fd, int ready_fd) {
+    discord_fanout_consumer_t* consumer = NULL;
+    char ready = discord_fanout_consumer_open(ring_path, mode, &consumer) == DISCORD_OK;
+    if (write(ready_fd, &ready, 1) != 1 || !ready) {
+        return 1;
+    }
+
+    uint64_t* latencies = malloc((size_t)event_count * sizeof(uint64_t));
+    if (!latencies) {
+        return 1;
+    }
+    consumer_result_t result = {0};
+    discord_fanout_event_t event;
+    while (discord_fanout_next(consumer, -1, &event) == DISCORD_OK) {
+        uint64_t latency = discord_time_now_ns() - event.published_ns;
+        if (result.received < (uint64_t)event_count) {
+            latencies[result.received] = latency;
+        }
+        result.received++;
+    }
+
+    discord_fanout_consumer_stats_t stats;
+    discord_fanout_consumer_get_stats(consumer, &stats);
+    result.lost = stats.lost;
+    size_t samples = result.received < (uint64_t)event_count ? (size_t)result.received : (size_t)event_count;
+    if (samples > 0) {
+        qsort(latencies, samples, sizeof(uint64_t), compare_u64);
+        result.p50_ns = latencies[samples / 2];
+        result.p99_ns = latencies[(samples * 99) / 100];
+        result.max_ns = latencies[samples - 1];
+    }
+    discord_fanout_consumer_close(consumer);
+    free(latencies);
+    return write(fd, &result, sizeof(result)) == (ssize_t)sizeof(result) ? 0 : 1;
+}
+
+static int run_phase(int consumers, uint32_t pace, phase_result_t* out) {
+    discord_fanout_config_t config = { 0, DISCORD_FANOUT_CONSUMERS_MAX, UINT32_MAX };
+    discord_fanout_t* fanout = NULL;
+    if (discord_fanout_create(ring_path, &config, &fanout) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not create the ring at %s\n", ring_path);
+        return 1;
+    }
+
+    int results[2], ready[2];
+    if (pipe(results) != 0 || pipe(ready) != 0) {
+        return 1;
+    }
+    pid_t* pids = calloc((size_t)consumers, sizeof(pid_t));
+    for (int i = 0; i < consumers; i++) {
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            close(results[0]);
+            close(ready[0]);
+            _exit(run_consumer(results[1], ready[1]));
+        }
+        char ok = 0;
+        if (pids[i] < 0 || read(ready[0], &ok, 1) != 1 || !ok) {
+            fprintf(stderr, "Error: consumer %d did not attach\n", i);
+            return 1;
+        }
+    }
+    close(results[1]);
+    close(ready[0]);
+    close(ready[1]);
+
+    char* payload = malloc((size_t)payload_size + 1);
+    memset(payload, 'x', (size_t)payload_size);
+    payload[payload_size] = '\0';
+    discord_event_t event = { 0, payload, (size_t)payload_size, 0, "MESSAGE_CREATE" };
+
+    uint64_t interval_ns = pace ? 1000000000ull / pace : 0;
+    uint64_t start = discord_time_now_ns();
+    for (int i = 0; i < event_count; i++) {
+        if (interval_ns) {
+            uint64_t due = start + (uint64_t)i * interval_ns;
+            while (discord_time_now_ns() < due) {
+            }
+        }
+        event.sequence = i;
+        discord_fanout_publish(fanout, &event);
+    }
+    uint64_t elapsed = discord_time_now_ns() - start;
+
+    discord_fanout_stats_t stats;
+    discord_fanout_get_stats(fanout, &stats);
+    discord_fanout_destroy(fanout);
+
+    memset(out, 0, sizeof(*out));
+    out->events_per_sec = elapsed ? (double)stats.published * 1e9 / (double)elapsed : 0.0;
+    out->dropped = stats.dropped;
+    out->waits = stats.waits;
+    out->worst.received = UINT64_MAX;
+    int failed = 0;
+    for (int i = 0; i < consumers; i++) {
+        consumer_result_t result;
+        if (read(results[0], &result, sizeof(result)) != (ssize_t)sizeof(result)) {
+            failed = 1;
+            continue;
+        }
+        if (result.received < out->worst.received) {
+            out->worst.received = result.received;
+        }
+        if (result.lost > out->worst.lost) {
+            out->worst.lost = result.lost;
+        }
+        if (result.p50_ns > out->worst.p50_ns) {
+            out->worst.p50_ns = result.p50_ns;
+        }
+        if (result.p99_ns > out->worst.p99_ns) {
+            out->worst.p99_ns = result.p99_ns;
+        }
+        if (result.max_ns > out->worst.max_ns) {
+            out->worst.max_ns = result.max_ns;
+        }
+    }
+    for (int i = 0; i < consumers; i++) {
+        int status = 0;
+        waitpid(pids[i], &status, 0);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    close(results[0]);
+    free(pids);
+    free(payload);
+    unlink(ring_path);
+    return failed;
+}
+
+static void print_phase(const char* name, const phase_result_t* result) {
+    printf("  %-10s %10.0f events/s  p50 %7.1f us  p99 %8.1f us  max %9.1f us",
+           name, result->events_per_sec, (double)result->worst.p50_ns / 1000.0,
+           (double)result->worst.p99_ns / 1000.0, (double)result->worst.max_ns / 1000.0);
+    if (result->worst.lost || result->dropped) {
+        printf("  lost %llu, dropped %llu", (unsigned long long)result->worst.lost,
+               (unsigned long long)result->dropped);
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            event_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            payload_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--consumers") == 0 && i + 1 < argc) {
+            char* p = argv[++i];
+            consumer_runs = 0;
+            while (*p && consumer_runs < 16) {
+                consumer_counts[consumer_runs++] = (int)strtol(p, &p, 10);
+                if (*p == ',') {
+                    p++;
+                }
+            }
+        } else if (strcmp(argv[i], "--drop") == 0) {
+            mode = DISCORD_FANOUT_DROP;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (event_count <= 0 || payload_size <= 0 || payload_size > 65536 || rate == 0 || consumer_runs == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    for (int i = 0; i < consumer_runs; i++) {
+        if (consumer_counts[i] <= 0 || consumer_counts[i] > DISCORD_FANOUT_CONSUMERS_MAX) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    printf("Fan-out: %d events of %d bytes, %s consumers, %ld CPUs\n", event_count, payload_size,
+           mode == DISCORD_FANOUT_BLOCK ? "BLOCK" : "DROP", sysconf(_SC_NPROCESSORS_ONLN));
+    int failed = 0;
+    for (int i = 0; i < consumer_runs; i++) {
+        phase_result_t throughput, paced;
+        printf("%d consumer%s\n", consumer_counts[i], consumer_counts[i] == 1 ? "" : "s");
+        failed |= run_phase(consumer_counts[i], 0, &throughput);
+        print_phase("max rate", &throughput);
+        failed |= run_phase(consumer_counts[i], rate, &paced);
+        char name[32];
+        snprintf(name, sizeof(name), "%u/s", rate);
+        print_phase(name, &paced);
+    }
+    return failed;
+}
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <openssl/evp.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "interactions.h"
+
+// Load generator for the HTTP interactions endpoint.
+// Starts the server in-process with a fresh Ed25519 key, then opens
+// keep-alive connections from client threads that replay pre-signed
+// APPLICATION_COMMAND requests and time each round trip. Signing happens
+// before the clock starts, so the numbers are server-side cost plus
+// loopback latency.
+
+#define SIGNED_REQUESTS 64
+
+static char public_key_hex[DISCORD_INTERACTIONS_KEY_HEX_LEN + 1];
+static char* requests[SIGNED_REQUESTS];
+static size_t request_lengths[SIGNED_REQUESTS];
+static char* forged_request;
+static size_t forged_length;
+
+static int port = 18931;
+static int connection_count = 8;
+static int requests_per_connection = 5000;
+static int worker_threads = 4;
+static volatile int stop_service = 0;
+
+typedef struct {
+    uint64_t* latencies;
+    int completed;
+    int failures;
+} client_result_t;
+
+static void on_interaction(const discord_event_t* event) {
+    (void)event;
+    static const char reply[] = "{\"type\":4,\"data\":{\"content\":\"pong\"}}";
+    char* out = discord_interactions_response_buffer(sizeof(reply) - 1);
+    if (out) {
+        memcpy(out, reply, sizeof(reply) - 1);
+        discord_interactions_respond(sizeof(reply) - 1);
+    }
+}
+
+static void to_hex(const unsigned char* in, size_t len, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0xF];
+    }
+    out[2 * len] = '\0';
+}
+
+static char* build_request(EVP_PKEY* key, int id, int forge, size_t* length) {
+    char body[256];
+    int body_len = snprintf(body, sizeof(body),
+        "{\"type\":2,\"id\":\"%d\",\"token\":\"t%d\",\"channel\":{\"type\":1},"
+        "\"data\":{\"name\":\"ping\",\"type\":1}}", id, id);
+    const char* timestamp = "1700000000";
+
+    char message[320];
+    size_t message_len = (size_t)snprintf(message, sizeof(message), "%s%s", timestamp, body);
+    if (forge) {
+        message[message_len - 2] ^= 1;
+    }
+
+    unsigned char signature[64];
+    size_t signature_len = sizeof(signature);
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+    EVP_DigestSignInit(md, NULL, NULL, NULL, key);
+    EVP_DigestSign(md, signature, &signature_len, (const unsigned char*)message, message_len);
+    EVP_MD_CTX_free(md);
+
+    char signature_hex[DISCORD_INTERACTIONS_SIG_HEX_LEN + 1];
+    to_hex(signature, signature_len, signature_hex);
+
+    char* request = malloc(1024);
+    *length = (size_t)snprintf(request, 1024,
+        "POST /interactions HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Content-Type: application/json\r\n"
+        "X-Signature-Ed25519: %s\r\n"
+        "X-Signature-Timestamp: %s\r\n"
+        "Content-Length: %d\r\n"
+        "\r\n%s", signature_hex, timestamp, body_len, body);
+    return request;
+}
+
+static int prepare_requests(void) {
+    EVP_PKEY* key = NULL;
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, NULL);
+    if (!ctx || EVP_PKEY_keygen_init(ctx) != 1 || EVP_PKEY_keygen(ctx, &key) != 1) {
+        EVP_PKEY_CTX_free(ctx);
+        return -1;
+    }
+    EVP_PKEY_CTX_free(ctx);
+
+    unsigned char raw[32];
+    size_t raw_len = sizeof(raw);
+    EVP_PKEY_get_raw_public_key(key, raw, &raw_len);
+    to_hex(raw, raw_len, public_key_hex);
+
+    for (int i = 0; i < SIGNED_REQUESTS; i++) {
+        requests[i] = build_request(key, i, 0, &request_lengths[i]);
+    }
+    forged_request = build_request(key, 0, 1, &forged_length);
+
+    EVP_PKEY_free(key);
+    return 0;
+}
+
+// Send one request and read one response; returns the HTTP status
+static int round_trip(int fd, const char* request, size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        ssize_t n = send(fd, request + sent, length - sent, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+
+    char response[2048];
+    size_t received = 0;
+    const char* header_end = NULL;
+    while (!header_end) {
+        ssize_t n = recv(fd, response + received, sizeof(response) - 1 - received, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        received += (size_t)n;
+        response[received] = '\0';
+        header_end = strstr(response, "\r\n\r\n");
+    }
+
+    int status = atoi(response + 9);
+    const char* length_header = strstr(response, "content-length:");
+    if (!length_header) {
+        length_header = strstr(response, "Content-Length:");
+    }
+    size_t body_length = length_header ? (size_t)atoi(length_header + 15) : 0;
+    size_t have = received - (size_t)(header_end + 4 - response);
+
+    while (have < body_length) {
+        char sink[1024];
+        ssize_t n = recv(fd, sink, sizeof(sink), 0);
+        if (n <= 0) {
+            return -1;
+        }
+        have += (size_t)n;
+    }
+
+    return status;
+}
+
+static int open_connection(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void* client_thread(void* arg) {
+    client_result_t* result = arg;
+
+    int fd = open_connection();
+    if (fd < 0) {
+        result->failures = requests_per_connection;
+        return NULL;
+    }
+
+    // A forged request must be refused before any timing starts
+    if (round_trip(fd, forged_request, forged_length) != 401) {
+        result->failures++;
+    }
+
+    for (int i = 0; i < requests_per_connection; i++) {
+        int slot = i % SIGNED_REQUESTS;
+        uint64_t start = discord_time_now_ns();
+        int status = round_trip(fd, requests[slot], request_lengths[slot]);
+        uint64_t end = discord_time_now_ns();
+        if (status != 200) {
+            result->failures++;
+            if (status < 0) {
+                break;
+            }
+            continue;
+        }
+        result->latencies[result->completed++] = end - start;
+    }
+
+    close(fd);
+    return NULL;
+}
+
+static void* service_thread(void* arg) {
+    discord_interactions_t* server = arg;
+    while (!stop_service) {
+        discord_interactions_service(server, 50);
+    }
+    return NULL;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--port N] [--connections N] [--requests N] [--workers N]\n", program_name);
+    printf("  --port N         Listen port (default 18931)\n");
+    printf("  --connections N  Concurrent keep-alive clients (default 8)\n");
+    printf("  --requests N     Requests per client (default 5000)\n");
+    printf("  --workers N      Verification threads (default 4)\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+            connection_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            requests_per_connection = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            worker_threads = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (connection_count <= 0 || requests_per_connection <= 0 || worker_threads <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (prepare_requests() != 0) {
+        fprintf(stderr, "Error: could not generate an Ed25519 key\n");
+        return 1;
+    }
+
+    discord_dispatch_clear();
+    discord_dispatch_on("INTERACTION_CREATE", on_interaction);
+
+    discord_interactions_config_t config = {0};
+    config.port = port;
+    config.public_key = public_key_hex;
+    config.worker_threads = worker_threads;
+
+    discord_interactions_t* server = NULL;
+    discord_result_t result = discord_interactions_start(&config, &server);
+    if (result != DISCORD_OK) {
+        fprintf(stderr, "Error: could not start interactions server on port %d: %d\n", port, result);
+        return 1;
+    }
+
+    pthread_t service;
+    pthread_create(&service, NULL, service_thread, server);
+
+    client_result_t* results = calloc((size_t)connection_count, sizeof(client_result_t));
+    pthread_t* clients = calloc((size_t)connection_count, sizeof(pthread_t));
+    for (int i = 0; i < connection_count; i++) {
+        results[i].latencies = calloc((size_t)requests_per_connection, sizeof(uint64_t));
+    }
+
+    uint64_t start = discord_time_now_ns();
+    for (int i = 0; i < connection_count; i++) {
+        pthread_create(&clients[i], NULL, client_thread, &results[i]);
+    }
+    for (int i = 0; i < connection_count; i++) {
+        pthread_join(clients[i], NULL);
+    }
+    uint64_t elapsed = discord_time_now_ns() - start;
+
+    stop_service = 1;
+    pthread_join(service, NULL);
+
+    discord_interactions_stats_t stats;
+    discord_interactions_get_stats(server, &stats);
+    discord_interactions_stop(server);
+
+    // Merge latencies
+    size_t total = 0;
+    int failures = 0;
+    for (int i = 0; i < connection_count; i++) {
+        total += (size_t)results[i].completed;
+        failures += results[i].failures;
+    }
+    uint64_t* all = malloc((total ? total : 1) * sizeof(uint64_t));
+    size_t pos = 0;
+    for (int i = 0; i < connection_count; i++) {
+        memcpy(all + pos, results[i].latencies, (size_t)results[i].completed * sizeof(uint64_t));
+        pos += (size_t)results[i].completed;
+        free(results[i].latencies);
+    }
+    qsort(all, total, sizeof(uint64_t), compare_u64);
+
+    printf("Interactions endpoint: %d connections x %d requests, %d workers\n",
+           connection_count, requests_per_connection, worker_threads);
+    printf("  completed        %zu (%d failures)\n", total, failures);
+    printf("  requests/sec     %.0f\n", elapsed ? (double)total * 1e9 / (double)elapsed : 0.0);
+    if (total > 0) {
+        printf("  latency p50      %.1f us\n", (double)all[total / 2] / 1000.0);
+        printf("  latency p99      %.1f us\n", (double)all[(total * 99) / 100] / 1000.0);
+        printf("  latency max      %.1f us\n", (double)all[total - 1] / 1000.0);
+    }
+    printf("  verified         %llu, rejected %llu\n",
+           (unsigned long long)stats.verified, (unsigned long long)stats.rejected);
+    printf("  requests/batch   %.2f\n", stats.batches ? (double)stats.requests / (double)stats.batches : 0.0);
+
+    free(all);
+    free(results);
+    free(clients);
+    for (int i = 0; i < SIGNED_REQUESTS; i++) {
+        free(requests[i]);
+    }
+    free(forged_request);
+    return failures ? 1 : 0;
+}
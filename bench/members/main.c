@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "members.h"
+
+// Member request benchmark against a synthetic guild.
+// Issues one op 8 request through the tracker (the send is captured, not
+// put on a socket), then plays the GUILD_MEMBERS_CHUNK frames Discord would
+// answer with through discord_dispatch_frame, generating each frame just
+// before it is dispatched. Only one frame exists at a time, so peak RSS
+// shows what the tracker holds rather than the size of the guild.
+// --record also writes the frames to a capture for discord-asm-replay.
+
+#define CHUNK_MEMBERS 1000
+#define GUILD_ID      "81384788765712384"
+
+static int guild_members = 250000;
+static const char* record_path = NULL;
+static uint32_t cache_pages = 0;
+
+static char nonce[DISCORD_MEMBERS_NONCE_MAX];
+static uint64_t sink_bytes = 0;
+static int finished = 0;
+static discord_members_result_t final_result;
+
+static discord_result_t capture_send(void* user, const char* data, size_t length) {
+    (void)user;
+    (void)data;
+    (void)length;
+    return DISCORD_OK;
+}
+
+static void counting_sink(void* user, const char* guild_id, const char* member, size_t member_length) {
+    (void)user;
+    (void)guild_id;
+    (void)member;
+    sink_bytes += member_length;
+}
+
+static void on_done(void* user, const discord_members_result_t* result) {
+    (void)user;
+    final_result = *result;
+    finished = 1;
+}
+
+static size_t build_chunk_frame(char* out, size_t capacity, int sequence, int index, int count, int first, int members) {
+    size_t pos = (size_t)snprintf(out, capacity,
+        "{\"t\":\"GUILD_MEMBERS_CHUNK\",\"s\":%d,\"op\":0,\"d\":{\"guild_id\":\"" GUILD_ID "\",\"members\":[",
+        sequence);
+    for (int i = 0; i < members; i++) {
+        long long id = 100000000000000000LL + first + i;
+        pos += (size_t)snprintf(out + pos, capacity - pos,
+            "%s{\"user\":{\"id\":\"%lld\",\"username\":\"member%d\",\"global_name\":null,"
+            "\"avatar\":null,\"discriminator\":\"0\"},\"roles\":[\"%lld\"],\"nick\":null,"
+            "\"joined_at\":\"2024-01-01T00:00:00.000000+00:00\",\"deaf\":false,\"mute\":false,\"flags\":0}",
+            i ? "," : "", id, first + i, 200000000000000000LL + (i % 8));
+    }
+    pos += (size_t)snprintf(out + pos, capacity - pos,
+        "],\"chunk_index\":%d,\"chunk_count\":%d,\"nonce\":\"%s\"}}", index, count, nonce);
+    return pos;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // Bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--members N] [--cache PAGES] [--record PATH]\n", program_name);
+    printf("  --members N      Guild size (default 250000)\n");
+    printf("  --cache PAGES    Stream into a session snapshot with this many cache pages\n");
+    printf("  --record PATH    Also write the chunk frames to a capture file\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--members") == 0 && i + 1 < argc) {
+            guild_members = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_pages = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (guild_members <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    discord_session_t* session = NULL;
+    discord_members_cache_t cache;
+    if (cache_pages > 0) {
+        remove("bench-members.snap");
+        if (discord_session_open("bench-members.snap", 0, cache_pages, &session) != DISCORD_OK ||
+            discord_members_cache_init(&cache, session) != DISCORD_OK) {
+            fprintf(stderr, "Error: could not create a snapshot with %u cache pages\n", cache_pages);
+            return 1;
+        }
+    }
+
+    discord_recorder_t* recorder = NULL;
+    if (record_path && discord_record_open(record_path, &recorder) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not open capture %s\n", record_path);
+        return 1;
+    }
+
+    discord_members_config_t config = {0};
+    config.send = capture_send;
+    discord_members_t* members = NULL;
+    if (discord_members_create(&config, &members) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not create member tracker\n");
+        return 1;
+    }
+
+    discord_dispatch_clear();
+    discord_members_attach(members);
+
+    long rss_before = peak_rss_kb();
+
+    discord_members_request_t request = {0};
+    request.guild_id = GUILD_ID;
+    request.sink = session ? discord_members_cache_sink : counting_sink;
+    request.user = session ? (void*)&cache : NULL;
+    request.done = on_done;
+    if (discord_members_request(members, &request, nonce) != DISCORD_OK) {
+        fprintf(stderr, "Error: request was not accepted\n");
+        return 1;
+    }
+
+    int chunk_count = (guild_members + CHUNK_MEMBERS - 1) / CHUNK_MEMBERS;
+    size_t frame_capacity = 512 + (size_t)CHUNK_MEMBERS * 320;
+    char* frame = malloc(frame_capacity);
+    uint64_t frame_bytes = 0;
+    uint64_t generate_ns = 0;
+
+    uint64_t start = discord_time_now_ns();
+    for (int index = 0; index < chunk_count; index++) {
+        int first = index * CHUNK_MEMBERS;
+        int count = guild_members - first < CHUNK_MEMBERS ? guild_members - first : CHUNK_MEMBERS;
+
+        uint64_t generate_start = discord_time_now_ns();
+        size_t length = build_chunk_frame(frame, frame_capacity, index + 1, index, chunk_count, first, count);
+        generate_ns += discord_time_now_ns() - generate_start;
+
+        frame_bytes += length;
+        if (recorder) {
+            discord_record_frame(recorder, frame, length, 0);
+        }
+        discord_dispatch_frame(frame);
+    }
+    uint64_t elapsed = discord_time_now_ns() - start;
+
+    long rss_after = peak_rss_kb();
+    double handle_ms = (double)(elapsed - generate_ns) / 1e6;
+
+    printf("Member request: %d members in %d chunks\n", guild_members, chunk_count);
+    printf("  completed        %s\n", finished && final_result.result == DISCORD_OK ? "yes" : "no");
+    printf("  members          %llu\n", (unsigned long long)final_result.members);
+    printf("  time to complete %.1f ms (%.1f ms excluding frame generation)\n",
+           (double)final_result.elapsed_ns / 1e6, handle_ms);
+    printf("  members/sec      %.0f\n", handle_ms > 0 ? (double)final_result.members * 1000.0 / handle_ms : 0.0);
+    printf("  chunk bytes      %.1f MB total, largest %zu bytes\n",
+           (double)frame_bytes / (1024.0 * 1024.0), final_result.largest_chunk);
+    printf("  peak RSS         %ld KB (%+ld KB during the request)\n", rss_after, rss_after - rss_before);
+    if (session) {
+        printf("  cache            %llu records on %u pages, %llu dropped\n",
+               (unsigned long long)cache.records, cache.page + 1, (unsigned long long)cache.dropped);
+    } else {
+        printf("  sink bytes       %.1f MB\n", (double)sink_bytes / (1024.0 * 1024.0));
+    }
+
+    free(frame);
+    discord_members_destroy(members);
+    if (recorder) {
+        discord_record_close(recorder);
+    }
+    if (session) {
+        discord_session_close(session);
+    }
+    return finished && final_result.result == DISCORD_OK ? 0 : 1;
+}
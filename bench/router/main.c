@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "router.h"
+
+// Command router benchmark.
+// Registers --commands commands (each with an alias), builds a corpus of
+// MESSAGE_CREATE frames where --command-ratio percent are commands (a
+// tenth of those unknown) and the rest ordinary chat, then measures:
+//   route     discord_router_route on the content alone
+//   linear    the strncmp chain bots write by hand (names only), for comparison
+//   dispatch  whole frames through discord_dispatch_frame with the router
+//             attached (envelope parse + content lookup + route)
+
+#define CORPUS_SIZE 4096
+#define TARGET_RATE 100000.0
+
+static int command_count = 1000;
+static int message_count = 1000000;
+static int command_ratio = 20;
+
+static char (*names)[24];
+static char* frames[CORPUS_SIZE];
+static const char* contents[CORPUS_SIZE];
+static size_t content_lengths[CORPUS_SIZE];
+static volatile uint64_t handled = 0;
+
+static const char* chat[] = {
+    "hello everyone", "did anyone see the patch notes?", "lol", "brb",
+    "can someone help me with my build", "gg", "https://example.com/clip",
+    "that raid was wild \\ud83d\\ude02", "ok", "thanks!"
+};
+
+static void on_command(const discord_command_t* command) {
+    handled += command->argc + 1;
+}
+
+static void on_other(const discord_event_t* event) {
+    (void)event;
+}
+
+static uint32_t rng_state = 2463534242u;
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void build_corpus(void) {
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        char content[160];
+        uint32_t roll = rng() % 100;
+        if (roll < (uint32_t)command_ratio) {
+            if (rng() % 10 == 0) {
+                snprintf(content, sizeof(content), "!nosuch%u arg", rng() % 1000);
+            } else {
+                int alias = rng() % 2;
+                snprintf(content, sizeof(content), "!%s%s <@%u> %u \\\"quoted reason\\\"",
+                         alias ? "a" : "", names[rng() % (uint32_t)command_count], rng(), rng() % 100);
+            }
+        } else {
+            snprintf(content, sizeof(content), "%s", chat[rng() % (sizeof(chat) / sizeof(chat[0]))]);
+        }
+
+        frames[i] = malloc(512);
+        int prefix = snprintf(frames[i], 512,
+            "{\"t\":\"MESSAGE_CREATE\",\"s\":%d,\"op\":0,\"d\":{\"id\":\"1200000000000000%04d\","
+            "\"channel_id\":\"1100000000000000000\",\"author\":{\"id\":\"1000000000000000001\","
+            "\"username\":\"someone\",\"bot\":false},\"content\":\"", i + 1, i);
+        snprintf(frames[i] + prefix, 512 - (size_t)prefix,
+                 "%s\",\"tts\":false,\"mentions\":[],\"attachments\":[]}}", content);
+        contents[i] = frames[i] + prefix;
+        content_lengths[i] = strlen(content);
+    }
+}
+
+static int linear_match(const char* content, size_t length) {
+    if (length == 0 || content[0] != '!') {
+        return -1;
+    }
+    for (int i = 0; i < command_count; i++) {
+        size_t n = strlen(names[i]);
+        if (length - 1 >= n && strncmp(content + 1, names[i], n) == 0 &&
+            (length - 1 == n || content[1 + n] == ' ')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void report(const char* label, uint64_t elapsed_ns) {
+    double rate = elapsed_ns ? (double)message_count * 1e9 / (double)elapsed_ns : 0.0;
+    printf("  %-9s %12.0f msgs/sec  %8.1f ns/msg  %s\n", label, rate,
+           (double)elapsed_ns / (double)message_count,
+           rate >= TARGET_RATE ? "" : "(below 100k/s)");
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--commands N] [--messages N] [--command-ratio PCT]\n", program_name);
+    printf("  --commands N         Registered commands (default 1000, each with an alias)\n");
+    printf("  --messages N         Messages per measurement (default 1000000)\n");
+    printf("  --command-ratio PCT  Share of messages that are commands (default 20)\n");
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--commands") == 0 && i + 1 < argc) {
+            command_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+            message_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--command-ratio") == 0 && i + 1 < argc) {
+            command_ratio = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (command_count <= 0 || message_count <= 0 || command_ratio < 0 || command_ratio > 100) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char* prefixes[] = { "!" };
+    discord_router_config_t config = { prefixes, 1, 1, on_other };
+    discord_router_t* router = NULL;
+    if (discord_router_create(&config, &router) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not create router\n");
+        return 1;
+    }
+
+    // Names share prefixes the way real command sets do
+    static const char* stems[] = { "role", "ban", "kick", "mute", "warn", "play", "queue", "skip",
+                                   "rank", "poll", "tag", "remind", "level", "shop", "ticket", "stat" };
+    names = calloc((size_t)command_count, sizeof(*names));
+    uint64_t compile_start = discord_time_now_ns();
+    for (int i = 0; i < command_count; i++) {
+        snprintf(names[i], sizeof(names[i]), "%s%d", stems[i % 16], i / 16);
+        char alias[32];
+        snprintf(alias, sizeof(alias), "a%s", names[i]);
+        if (discord_router_add(router, names[i], on_command, NULL, NULL) != DISCORD_OK ||
+            discord_router_alias(router, alias, names[i]) != DISCORD_OK) {
+            fprintf(stderr, "Error: could not register %s\n", names[i]);
+            return 1;
+        }
+    }
+    discord_router_compile(router);
+    uint64_t compile_ns = discord_time_now_ns() - compile_start;
+
+    build_corpus();
+
+    printf("Command router: %d commands + %d aliases, %d messages, %d%% commands\n",
+           command_count, command_count, message_count, command_ratio);
+
+    uint64_t start = discord_time_now_ns();
+    for (int i = 0; i < message_count; i++) {
+        int slot = i & (CORPUS_SIZE - 1);
+        discord_router_route(router, contents[slot], content_lengths[slot], NULL);
+    }
+    report("route", discord_time_now_ns() - start);
+
+    start = discord_time_now_ns();
+    int linear_hits = 0;
+    for (int i = 0; i < message_count; i++) {
+        int slot = i & (CORPUS_SIZE - 1);
+        linear_hits += linear_match(contents[slot], content_lengths[slot]) >= 0;
+    }
+    report("linear", discord_time_now_ns() - start);
+
+    discord_dispatch_clear();
+    discord_router_attach(router);
+    start = discord_time_now_ns();
+    for (int i = 0; i < message_count; i++) {
+        discord_dispatch_frame(frames[i & (CORPUS_SIZE - 1)]);
+    }
+    report("dispatch", discord_time_now_ns() - start);
+
+    discord_router_stats_t stats;
+    discord_router_get_stats(router, &stats);
+    printf("  compile   %.2f ms, %u states x %u classes, %.1f KB\n",
+           (double)compile_ns / 1e6, stats.states, stats.classes, (double)stats.table_bytes / 1024.0);
+    printf("  outcomes  %llu dispatched, %llu rejected on prefix, %llu unknown (linear hits %d)\n",
+           (unsigned long long)stats.dispatched, (unsigned long long)stats.rejected,
+           (unsigned long long)stats.unknown, linear_hits);
+
+    discord_router_destroy(router);
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        free(frames[i]);
+    }
+    free(names);
+    return 0;
+}
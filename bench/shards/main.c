@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "abi.h"
+#include "shard.h"
+#include "sim.h"
+
+// Shard scale simulation.
+// Runs N shards through the simulated gateway on the virtual clock for a
+// stretch of gateway time: the identify queue at startup, heartbeats, lost
+// ACKs, op 7 reconnects and resumes (over standby connections with
+// --prewarm). Reports how long the fleet took to
+// come up against the max_concurrency bound, what the shards did, and how
+// much shim memory the fleet held at its peak.
+
+static int shard_count = 5000;
+static uint32_t max_concurrency = 16;
+static uint32_t minutes = 60;
+static uint32_t latency_ms = 40;
+static uint32_t ack_loss = 1;
+static uint32_t reconnects = 1;
+static uint32_t dispatch_ms = 0;
+static int use_limiter = 1;
+static uint32_t handshake_ms = 0;
+static int prewarm = 0;
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--shards N] [--concurrency C] [--minutes M] [--latency MS]\n", program_name);
+    printf("          [--ack-loss PERMILLE] [--reconnect PERMILLE] [--dispatch-ms MS] [--no-limiter]\n");
+    printf("          [--handshake-ms MS] [--prewarm]\n");
+    printf("  --shards N            Shards to run (default 5000)\n");
+    printf("  --concurrency C       max_concurrency of the bot (default 16)\n");
+    printf("  --minutes M           Virtual gateway time to simulate (default 60)\n");
+    printf("  --latency MS          One-way latency (default 40)\n");
+    printf("  --ack-loss PERMILLE   Heartbeat ACKs dropped (default 1)\n");
+    printf("  --reconnect PERMILLE  Heartbeats answered with op 7 (default 1)\n");
+    printf("  --dispatch-ms MS      A dispatch per ready shard this often (default none)\n");
+    printf("  --no-limiter          IDENTIFY without the shared limiter\n");
+    printf("  --handshake-ms MS     TCP, TLS and upgrade time of a new connection (default 0)\n");
+    printf("  --prewarm             Keep a standby connection per shard for op 7 resumes\n");
+}
+
+static size_t peak_bytes(void) {
+    size_t total = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        total += stats.peak_bytes;
+    }
+    return total;
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shard_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            max_concurrency = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+            minutes = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latency_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--ack-loss") == 0 && i + 1 < argc) {
+            ack_loss = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--reconnect") == 0 && i + 1 < argc) {
+            reconnects = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dispatch-ms") == 0 && i + 1 < argc) {
+            dispatch_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--handshake-ms") == 0 && i + 1 < argc) {
+            handshake_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--prewarm") == 0) {
+            prewarm = 1;
+        } else if (strcmp(argv[i], "--no-limiter") == 0) {
+            use_limiter = 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (shard_count <= 0 || max_concurrency == 0 || minutes == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Wall time is read before the virtual clock goes in and after it is gone
+    uint64_t wall_start = discord_time_now_ns();
+
+    discord_sim_config_t config = {0};
+    config.latency_ms = latency_ms;
+    config.max_concurrency = max_concurrency;
+    config.ack_loss_permille = ack_loss;
+    config.reconnect_permille = reconnects;
+    config.dispatch_interval_ms = dispatch_ms;
+    config.handshake_ms = handshake_ms;
+    discord_sim_t* sim = NULL;
+    if (discord_sim_create(&config, &sim) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not create the simulation\n");
+        return 1;
+    }
+
+    discord_identify_limiter_t* limiter = NULL;
+    if (use_limiter && discord_identify_limiter_create(max_concurrency, &limiter) != DISCORD_OK) {
+        fprintf(stderr, "Error: could not create the identify limiter\n");
+        return 1;
+    }
+
+    static const discord_ws_options_t transport = { DISCORD_WS_TRANSPORT_SIM, 0, 0, 0 };
+    discord_shard_t** shards = calloc((size_t)shard_count, sizeof(discord_shard_t*));
+    if (!shards) {
+        return 1;
+    }
+    for (int i = 0; i < shard_count; i++) {
+        discord_shard_config_t shard = {0};
+        shard.token = "bench-token";
+        shard.url = "wss://gateway.discord.gg/?v=10&encoding=json";
+        shard.shard_id = i;
+        shard.shard_count = shard_count;
+        shard.ws = &transport;
+        shard.limiter = limiter;
+        shard.prewarm = prewarm;
+        if (discord_shard_create(&shard, &shards[i]) != DISCORD_OK) {
+            fprintf(stderr, "Error: could not create shard %d\n", i);
+            return 1;
+        }
+    }
+
+    discord_sim_run(sim, shards, (uint32_t)shard_count, (uint64_t)minutes * 60000ull);
+
+    discord_shard_stats_t total = {0};
+    uint64_t last_ready = 0;
+    int never_ready = 0;
+    uint64_t resumed = 0, resume_ns = 0;
+    for (int i = 0; i < shard_count; i++) {
+        discord_shard_stats_t stats;
+        discord_shard_get_stats(shards[i], &stats);
+        if (stats.readies == 0) {
+            never_ready++;
+        } else if (stats.first_ready_ms > last_ready) {
+            last_ready = stats.first_ready_ms;
+        }
+        total.connects += stats.connects;
+        total.identifies += stats.identifies;
+        total.identify_waits += stats.identify_waits;
+        total.resumes += stats.resumes;
+        total.heartbeats += stats.heartbeats;
+        total.zombies += stats.zombies;
+        total.reconnects_requested += stats.reconnects_requested;
+        total.invalid_sessions += stats.invalid_sessions;
+        total.dispatches += stats.dispatches;
+        total.standbys_used += stats.standbys_used;
+        if (stats.resumes > 0 && stats.readies > 1) {
+            // The last READY/RESUMED came from a resume
+            resumed++;
+            resume_ns += stats.last_connect.total_ns;
+        }
+    }
+
+    discord_sim_stats_t sim_stats;
+    discord_sim_get_stats(sim, &sim_stats);
+    size_t peak = peak_bytes();
+
+    for (int i = 0; i < shard_count; i++) {
+        discord_shard_destroy(shards[i]);
+    }
+    free(shards);
+    discord_identify_limiter_destroy(limiter);
+    discord_sim_destroy(sim);
+    double wall_s = (double)(discord_time_now_ns() - wall_start) / 1e9;
+
+    uint64_t rounds = ((uint64_t)shard_count + max_concurrency - 1) / max_concurrency;
+    printf("Shard simulation: %d shards, max_concurrency %u, %u min of gateway time\n",
+           shard_count, max_concurrency, minutes);
+    printf("  wall time        %.2f s (%.0fx real time)\n", wall_s,
+           wall_s > 0 ? (double)minutes * 60.0 / wall_s : 0.0);
+    printf("  events           %llu (%.0f/s)\n", (unsigned long long)sim_stats.events,
+           wall_s > 0 ? (double)sim_stats.events / wall_s : 0.0);
+    if (never_ready) {
+        printf("  all READY        no (%d shards never got READY)\n", never_ready);
+    } else {
+        printf("  all READY        after %.1f s (bound %.1f s)\n", (double)last_ready / 1000.0,
+               (double)((rounds - 1) * DISCORD_IDENTIFY_WINDOW_MS) / 1000.0);
+    }
+    printf("  identifies       %llu (%llu deferred by the limiter, %llu rejected by the gateway)\n",
+           (unsigned long long)total.identifies, (unsigned long long)total.identify_waits,
+           (unsigned long long)sim_stats.identify_rejected);
+    printf("  connects         %llu, resumes %llu (%llu over a standby)\n",
+           (unsigned long long)total.connects, (unsigned long long)total.resumes,
+           (unsigned long long)total.standbys_used);
+    if (resumed) {
+        printf("  resume latency   %.1f ms to RESUMED on average\n", (double)resume_ns / (double)resumed / 1e6);
+    }
+    printf("  heartbeats       %llu, zombies %llu, op 7 %llu, op 9 %llu\n",
+           (unsigned long long)total.heartbeats, (unsigned long long)total.zombies,
+           (unsigned long long)total.reconnects_requested, (unsigned long long)total.invalid_sessions);
+    printf("  dispatches       %llu\n", (unsigned long long)total.dispatches);
+    printf("  peak shim memory %.1f KB (%.0f bytes per shard)\n", (double)peak / 1024.0,
+           (double)peak / shard_count);
+    return never_ready ? 1 : 0;
+}
@@ -0,0 +1,412 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include "abi.h"
+#include "wsframe.h"
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+#endif
+
+// WebSocket transport benchmark against a mock gateway.
+// A server thread accepts one connection per run (TLS with a throwaway
+// self-signed certificate, or plain ws:// with --plain), answers the
+// upgrade, sends HELLO and then streams MESSAGE_CREATE dispatches in
+// batches as fast as the client takes them. The client thread receives
+// each frame, reads "s" out of it and frees it, once on libwebsockets and
+// once on the io_uring transport. Reported per event: client CPU time
+// (RUSAGE_THREAD), syscalls made by the client thread and bytes copied by
+// the shim. Syscalls come from the raw_syscalls:sys_enter tracepoint when
+// perf is permitted; otherwise lws shows read/write calls from
+// /proc/thread-self/io (poll not included) and io_uring the transport's
+// own count of every call it makes.
+
+#define BATCH_FRAMES 64
+
+static int frame_count = 200000;
+static int payload_size = 700;
+static int plain = 0;
+
+typedef struct {
+    int listener;
+    int port;
+    SSL_CTX* ctx;
+} mock_gateway_t;
+
+typedef struct {
+    double cpu_us;
+    double wall_ms;
+    uint64_t syscalls;
+    int exact_syscalls;
+    uint64_t copied;
+    uint64_t shim_syscalls;
+    uint32_t ktls;
+    int received;
+} run_result_t;
+
+static int mock_write(SSL* ssl, int fd, const void* data, size_t length) {
+    const char* p = data;
+    while (length > 0) {
+        int n = ssl ? SSL_write(ssl, p, (int)length) : (int)send(fd, p, length, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static int mock_read(SSL* ssl, int fd, void* data, size_t length) {
+    return ssl ? SSL_read(ssl, data, (int)length) : (int)recv(fd, data, length, 0);
+}
+
+static size_t build_dispatch(uint8_t* out, int sequence) {
+    char body[8192];
+    int length = snprintf(body, sizeof(body),
+        "{\"t\":\"MESSAGE_CREATE\",\"s\":%d,\"op\":0,\"d\":{\"id\":\"%lld\",\"channel_id\":\"81384788765712384\","
+        "\"guild_id\":\"81384788765712384\",\"author\":{\"id\":\"80351110224678912\",\"username\":\"bench\","
+        "\"discriminator\":\"0\",\"avatar\":null},\"content\":\"",
+        sequence, 1100000000000000000LL + sequence);
+    while (length < payload_size - 3 && length < (int)sizeof(body) - 4) {
+        body[length] = (char)('a' + length % 26);
+        length++;
+    }
+    length += snprintf(body + length, sizeof(body) - (size_t)length, "\"}}");
+
+    size_t header = discord_wsframe_header(out, DISCORD_WSFRAME_TEXT, 1, (uint64_t)length, NULL);
+    memcpy(out + header, body, (size_t)length);
+    return header + (size_t)length;
+}
+
+static void* mock_gateway_thread(void* arg) {
+    mock_gateway_t* gateway = arg;
+    int fd = accept(gateway->listener, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    SSL* ssl = NULL;
+    if (gateway->ctx) {
+        ssl = SSL_new(gateway->ctx);
+        SSL_set_fd(ssl, fd);
+        if (SSL_accept(ssl) != 1) {
+            SSL_free(ssl);
+            close(fd);
+            return NULL;
+        }
+    }
+
+    char request[4096] = "";
+    size_t used = 0;
+    while (!strstr(request, "\r\n\r\n") && used < sizeof(request) - 1) {
+        int n = mock_read(ssl, fd, request + used, sizeof(request) - 1 - used);
+        if (n <= 0) {
+            goto done;
+        }
+        used += (size_t)n;
+        request[used] = '\0';
+    }
+
+    const char* key = strstr(request, "Sec-WebSocket-Key:");
+    if (!key) {
+        goto done;
+    }
+    key += 18;
+    while (*key == ' ') {
+        key++;
+    }
+    char concatenated[128], accept_key[64];
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned digest_length = 0;
+    int key_length = (int)strcspn(key, "\r\n");
+    snprintf(concatenated, sizeof(concatenated), "%.*s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key_length, key);
+    EVP_Digest(concatenated, strlen(concatenated), digest, &digest_length, EVP_sha1(), NULL);
+    EVP_EncodeBlock((unsigned char*)accept_key, digest, (int)digest_length);
+
+    uint8_t* out = malloc((size_t)BATCH_FRAMES * (size_t)(payload_size + 512) + 1024);
+    size_t n = (size_t)sprintf((char*)out, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                               "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept_key);
+    static const char hello[] = "{\"t\":null,\"s\":null,\"op\":10,\"d\":{\"heartbeat_interval\":41250}}";
+    n += discord_wsframe_header(out + n, DISCORD_WSFRAME_TEXT, 1, sizeof(hello) - 1, NULL);
+    memcpy(out + n, hello, sizeof(hello) - 1);
+    n += sizeof(hello) - 1;
+
+    for (int sequence = 1; sequence <= frame_count;) {
+        for (int i = 0; i < BATCH_FRAMES && sequence <= frame_count; i++, sequence++) {
+            n += build_dispatch(out + n, sequence);
+        }
+        if (mock_write(ssl, fd, out, n) != 0) {
+            break;
+        }
+        n = 0;
+    }
+    free(out);
+
+    // Hold the connection open until the client closes it
+    char drain[512];
+    while (mock_read(ssl, fd, drain, sizeof(drain)) > 0) {
+    }
+
+done:
+    if (ssl) {
+        SSL_free(ssl);
+    }
+    close(fd);
+    return NULL;
+}
+
+static SSL_CTX* self_signed_ctx(void) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(ctx, cert);
+    SSL_CTX_use_PrivateKey(ctx, key);
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+}
+
+// Syscalls entered by the calling thread
+static int open_syscall_counter(void) {
+#ifdef __linux__
+    static const char* paths[] = {
+        "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+        "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+    };
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        FILE* file = fopen(paths[i], "r");
+        if (!file) {
+            continue;
+        }
+        unsigned long long id = 0;
+        int ok = fscanf(file, "%llu", &id) == 1;
+        fclose(file);
+        if (!ok) {
+            continue;
+        }
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.size = sizeof(attr);
+        attr.config = id;
+        attr.sample_period = 1;
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+    return -1;
+}
+
+static uint64_t read_syscalls(int counter) {
+    uint64_t value = 0;
+    if (counter >= 0) {
+        if (read(counter, &value, sizeof(value)) != sizeof(value)) {
+            value = 0;
+        }
+        return value;
+    }
+
+    // Fallback: read-family plus write-family calls only
+    FILE* file = fopen("/proc/thread-self/io", "r");
+    if (!file) {
+        return 0;
+    }
+    char line[128];
+    unsigned long long count;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "syscr: %llu", &count) == 1 || sscanf(line, "syscw: %llu", &count) == 1) {
+            value += count;
+        }
+    }
+    fclose(file);
+    return value;
+}
+
+static double thread_cpu_us(void) {
+    struct rusage usage;
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &usage);
+#else
+    getrusage(RUSAGE_SELF, &usage);
+#endif
+    return (double)usage.ru_utime.tv_sec * 1e6 + (double)usage.ru_utime.tv_usec +
+           (double)usage.ru_stime.tv_sec * 1e6 + (double)usage.ru_stime.tv_usec;
+}
+
+static discord_result_t run_transport(discord_ws_transport_t transport, run_result_t* result) {
+    mock_gateway_t gateway = {0};
+    gateway.ctx = plain ? NULL : self_signed_ctx();
+    gateway.listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_length = sizeof(addr);
+    bind(gateway.listener, (struct sockaddr*)&addr, sizeof(addr));
+    listen(gateway.listener, 1);
+    getsockname(gateway.listener, (struct sockaddr*)&addr, &addr_length);
+    gateway.port = ntohs(addr.sin_port);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, mock_gateway_thread, &gateway);
+
+    char url[128];
+    snprintf(url, sizeof(url), "%s://localhost:%d/?v=10&encoding=json", plain ? "ws" : "wss", gateway.port);
+    discord_ws_options_t options = { transport, 1, 0, 0 };
+
+    memset(result, 0, sizeof(*result));
+    discord_ws_stats_t before, after;
+    discord_gateway_t* connection = NULL;
+    discord_result_t status = discord_ws_connect_ex(url, &options, &connection);
+    if (status != DISCORD_OK) {
+        close(gateway.listener);
+        pthread_join(thread, NULL);
+        SSL_CTX_free(gateway.ctx);
+        return status;
+    }
+
+    // HELLO first, so the handshake is outside the measurement
+    discord_ws_message_t message;
+    status = discord_ws_receive(connection, &message, 5000);
+    if (status == DISCORD_OK) {
+        discord_ws_free_message(&message);
+    }
+
+    int counter = open_syscall_counter();
+    result->exact_syscalls = counter >= 0;
+    discord_ws_get_stats(&before);
+    uint64_t syscalls_start = read_syscalls(counter);
+    double cpu_start = thread_cpu_us();
+    uint64_t wall_start = discord_time_now_ns();
+
+    while (status == DISCORD_OK && result->received < frame_count) {
+        status = discord_ws_receive(connection, &message, 5000);
+        if (status == DISCORD_OK) {
+            int sequence = 0;
+            discord_json_parse_root_int(message.data, message.length, "s", &sequence);
+            result->received += sequence > 0;
+            discord_ws_free_message(&message);
+        }
+    }
+
+    result->cpu_us = thread_cpu_us() - cpu_start;
+    result->wall_ms = (double)(discord_time_now_ns() - wall_start) / 1e6;
+    result->syscalls = read_syscalls(counter) - syscalls_start;
+    discord_ws_get_stats(&after);
+    result->copied = after.bytes_copied - before.bytes_copied;
+    result->shim_syscalls = after.syscalls - before.syscalls;
+    if (counter < 0 && transport == DISCORD_WS_TRANSPORT_URING) {
+        result->syscalls = result->shim_syscalls;
+        result->exact_syscalls = 1;
+    }
+    result->ktls = after.ktls_connections;
+    if (counter >= 0) {
+        close(counter);
+    }
+
+    discord_ws_close(connection);
+    close(gateway.listener);
+    pthread_join(thread, NULL);
+    if (gateway.ctx) {
+        SSL_CTX_free(gateway.ctx);
+    }
+    return result->received == frame_count ? DISCORD_OK : status;
+}
+
+static void print_result(const char* label, const run_result_t* r) {
+    double events = (double)r->received;
+    printf("  %-6s %10.0f events/sec  %6.2f us CPU/event  %6.3f syscalls/event%s  %6.1f bytes copied/event",
+           label, events / (r->wall_ms / 1000.0), r->cpu_us / events,
+           (double)r->syscalls / events, r->exact_syscalls ? " " : "*", (double)r->copied / events);
+    if (r->shim_syscalls && !plain) {
+        printf("  (%s)", r->ktls ? "kTLS" : "TLS in userspace");
+    }
+    printf("\n");
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--frames N] [--size BYTES] [--plain] [--transport lws|uring|both]\n", program_name);
+    printf("  --frames N       Dispatches per run (default 200000)\n");
+    printf("  --size BYTES     Approximate payload size (default 700)\n");
+    printf("  --plain          ws:// instead of wss:// (io_uring transport only)\n");
+    printf("  --transport T    Which transports to run (default both)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* which = "both";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frame_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            payload_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--plain") == 0) {
+            plain = 1;
+        } else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            which = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (frame_count <= 0 || payload_size <= 0 || payload_size > 8000) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("WebSocket transports: %d dispatches of ~%d bytes over %s, mock gateway on loopback\n",
+           frame_count, payload_size, plain ? "ws://" : "wss://");
+
+    int status = 0;
+    run_result_t result;
+    if (!plain && strcmp(which, "uring") != 0) {
+        discord_result_t r = run_transport(DISCORD_WS_TRANSPORT_LWS, &result);
+        if (r == DISCORD_OK) {
+            print_result("lws", &result);
+        } else {
+            printf("  lws    failed (%d)\n", r);
+            status = 1;
+        }
+    }
+    if (strcmp(which, "lws") != 0) {
+        discord_result_t r = run_transport(DISCORD_WS_TRANSPORT_URING, &result);
+        if (r == DISCORD_OK) {
+            print_result("uring", &result);
+        } else {
+            printf("  uring  %s (%d)\n", r == DISCORD_ERROR_UNSUPPORTED ? "unsupported" : "failed", r);
+            status = 1;
+        }
+    }
+
+    if (!plain && strcmp(which, "uring") != 0 && open_syscall_counter() < 0) {
+        printf("  * read/write calls only (perf tracepoints not permitted)\n");
+    }
+
+    discord_ws_shutdown();
+    return status;
+}
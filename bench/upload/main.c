@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "abi.h"
+#include "rest.h"
+
+// Attachment upload benchmark
+// --uploads files of --size MiB go to an HTTP sink on loopback, running in
+// a child process so the CPU time measured is the uploader's. Three ways:
+//   buffered   the helper this replaces: read the whole file into memory,
+//              build the multipart body by appending to a growing string,
+//              send it; --connections threads call it
+//   pooled     discord_rest_upload with copy_only (pread into the pooled
+//              buffers, what https without kTLS does)
+//   sendfile   discord_rest_upload streaming file contents with sendfile
+// Reported: throughput, peak heap held for uploads, CPU time, and the
+// longest the calling thread was blocked by one call.
+
+static int upload_count = 32;
+static int size_mb = 16;
+static int connections = 4;
+static int chunk_kb = 64;
+static int sink_port = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t cpu_ns(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+           (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+// Sink: one thread per connection, bodies read and dropped
+
+static void* sink_conn(void* arg) {
+    int fd = (int)(intptr_t)arg;
+    static __thread char data[256 * 1024];
+    size_t used = 0;
+    for (;;) {
+        char* end;
+        data[used] = '\0';
+        while (!(end = strstr(data, "\r\n\r\n"))) {
+            ssize_t n = recv(fd, data + used, sizeof(data) - 1 - used, 0);
+            if (n <= 0) {
+                close(fd);
+                return NULL;
+            }
+            used += (size_t)n;
+            data[used] = '\0';
+        }
+        const char* length = strstr(data, "Content-Length: ");
+        uint64_t left = length ? strtoull(length + 16, NULL, 10) : 0;
+        size_t header = (size_t)(end + 4 - data);
+        size_t have = used - header < left ? used - header : (size_t)left;
+        left -= have;
+        memmove(data, data + header + have, used - header - have);
+        used -= header + have;
+        while (left > 0) {
+            ssize_t n = recv(fd, data + used, sizeof(data) - 1 - used, 0);
+            if (n <= 0) {
+                close(fd);
+                return NULL;
+            }
+            size_t take = (size_t)n < left ? (size_t)n : (size_t)left;
+            left -= take;
+            memmove(data + used, data + used + take, (size_t)n - take);
+            used += (size_t)n - take;
+        }
+        static const char response[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                       "X-RateLimit-Limit: 1000\r\nX-RateLimit-Remaining: 999\r\n"
+                                       "X-RateLimit-Reset-After: 1\r\nContent-Length: 11\r\n\r\n{\"id\":\"1\"}\n";
+        if (send(fd, response, sizeof(response) - 1, MSG_NOSIGNAL) < 0) {
+            close(fd);
+            return NULL;
+        }
+    }
+}
+
+static pid_t sink_start(void) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0 ||
+        getsockname(listener, (struct sockaddr*)&address, &length) != 0) {
+        return -1;
+    }
+    sink_port = ntohs(address.sin_port);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (;;) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd < 0) {
+                _exit(0);
+            }
+            pthread_t thread;
+            pthread_create(&thread, NULL, sink_conn, (void*)(intptr_t)fd);
+            pthread_detach(thread);
+        }
+    }
+    close(listener);
+    return pid;
+}
+
+// Buffered baseline
+
+static size_t buffered_live = 0;
+static size_t buffered_peak = 0;
+
+static void* tracked_realloc(void* ptr, size_t old_size, size_t size) {
+    void* grown = realloc(ptr, size);
+    size_t live = __atomic_add_fetch(&buffered_live, size - old_size, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&buffered_peak, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&buffered_peak, &peak, live, 1, __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED)) {
+    }
+    return grown;
+}
+
+static void tracked_free(void* ptr, size_t size) {
+    free(ptr);
+    __atomic_sub_fetch(&buffered_live, size, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    char* data;
+    size_t length;
+} string_t;
+
+static void append(string_t* s, const void* data, size_t length) {
+    s->data = tracked_realloc(s->data, s->length, s->length + length);
+    memcpy(s->data + s->length, data, length);
+    s->length += length;
+}
+
+static int send_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static int buffered_upload(int* sock, const char* path, uint64_t channel_id) {
+    if (*sock < 0) {
+        struct sockaddr_in address = {0};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons((uint16_t)sink_port);
+        *sock = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(*sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(*sock, (struct sockaddr*)&address, sizeof(address)) != 0) {
+            return -1;
+        }
+    }
+
+    // The whole file, then the body around it
+    int fd = open(path, O_RDONLY);
+    off_t size = lseek(fd, 0, SEEK_END);
+    char* contents = tracked_realloc(NULL, 0, (size_t)size);
+    size_t read_total = 0;
+    while (read_total < (size_t)size) {
+        ssize_t n = pread(fd, contents + read_total, (size_t)size - read_total, (off_t)read_total);
+        if (n <= 0) {
+            break;
+        }
+        read_total += (size_t)n;
+    }
+    close(fd);
+
+    const char* boundary = "bench-boundary";
+    char part[512];
+    string_t body = { NULL, 0 };
+    int n = snprintf(part, sizeof(part), "--%s\r\nContent-Disposition: form-data; name=\"payload_json\"\r\n"
+                     "Content-Type: application/json\r\n\r\n{}\r\n--%s\r\nContent-Disposition: form-data; "
+                     "name=\"files[0]\"; filename=\"upload.bin\"\r\nContent-Type: application/octet-stream\r\n\r\n",
+                     boundary, boundary);
+    append(&body, part, (size_t)n);
+    append(&body, contents, read_total);
+    tracked_free(contents, (size_t)size);
+    n = snprintf(part, sizeof(part), "\r\n--%s--\r\n", boundary);
+    append(&body, part, (size_t)n);
+
+    char headers[512];
+    n = snprintf(headers, sizeof(headers), "POST /api/v10/channels/%llu/messages HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                 "Authorization: Bot bench\r\nContent-Type: multipart/form-data; boundary=%s\r\n"
+                 "Content-Length: %zu\r\n\r\n", (unsigned long long)channel_id, boundary, body.length);
+    int result = send_all(*sock, headers, (size_t)n) == 0 && send_all(*sock, body.data, body.length) == 0 ? 0 : -1;
+    tracked_free(body.data, body.length);
+
+    char response[1024];
+    size_t got = 0;
+    while (result == 0) {
+        ssize_t r = recv(*sock, response + got, sizeof(response) - 1 - got, 0);
+        if (r <= 0) {
+            result = -1;
+            break;
+        }
+        got += (size_t)r;
+        response[got] = '\0';
+        char* end = strstr(response, "\r\n\r\n");
+        if (end && got >= (size_t)(end + 4 - response) + 11) {
+            break;
+        }
+    }
+    return result;
+}
+
+typedef struct {
+    char** paths;
+    int next;
+    pthread_mutex_t lock;
+    uint64_t longest_ns;
+    int failed;
+} buffered_run_t;
+
+static void* buffered_worker(void* arg) {
+    buffered_run_t* run = arg;
+    int sock = -1;
+    for (;;) {
+        pthread_mutex_lock(&run->lock);
+        int index = run->next < upload_count ? run->next++ : -1;
+        pthread_mutex_unlock(&run->lock);
+        if (index < 0) {
+            break;
+        }
+        uint64_t start = now_ns();
+        int result = buffered_upload(&sock, run->paths[index], 1000 + (uint64_t)index);
+        uint64_t took = now_ns() - start;
+        pthread_mutex_lock(&run->lock);
+        run->failed += result != 0;
+        run->longest_ns = took > run->longest_ns ? took : run->longest_ns;
+        pthread_mutex_unlock(&run->lock);
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    return NULL;
+}
+
+// discord_rest
+
+static void on_upload(const discord_rest_response_t* response, void* user) {
+    if (response->result != DISCORD_OK) {
+        __atomic_add_fetch((int*)user, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void report(const char* name, uint64_t elapsed_ns, uint64_t cpu, size_t peak, uint64_t longest_ns, int failed) {
+    double total_mb = (double)upload_count * size_mb;
+    printf("  %-9s %8.0f MB/s  peak heap %9.2f MiB  CPU %7.1f ms  longest call %9.3f ms%s\n", name,
+           total_mb / ((double)elapsed_ns / 1e9), (double)peak / (1024.0 * 1024.0), (double)cpu / 1e6,
+           (double)longest_ns / 1e6, failed ? "  (FAILURES)" : "");
+}
+
+static void run_buffered(char** paths) {
+    buffered_run_t run = { paths, 0, PTHREAD_MUTEX_INITIALIZER, 0, 0 };
+    pthread_t threads[64];
+    uint64_t cpu = cpu_ns();
+    uint64_t start = now_ns();
+    for (int i = 0; i < connections; i++) {
+        pthread_create(&threads[i], NULL, buffered_worker, &run);
+    }
+    for (int i = 0; i < connections; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    report("buffered", now_ns() - start, cpu_ns() - cpu, buffered_peak, run.longest_ns, run.failed);
+}
+
+static void run_rest(char** paths, int copy_only) {
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/api/v10", sink_port);
+    discord_mem_stats_t before;
+    discord_mem_get_stats(DISCORD_MEM_SEND, &before);
+    discord_rest_config_t config = {0};
+    config.token = "bench";
+    config.api_url = url;
+    config.connections = (uint32_t)connections;
+    config.chunk_size = (uint32_t)chunk_kb * 1024;
+    config.global_per_second = 100000;     // The sink does not limit; measure the transfer
+    config.copy_only = copy_only;
+    discord_rest_t* rest = NULL;
+    if (discord_rest_create(&config, &rest) != DISCORD_OK) {
+        fprintf(stderr, "Error: cannot create the REST client\n");
+        return;
+    }
+
+    int* fds = calloc((size_t)upload_count, sizeof(int));
+    for (int i = 0; i < upload_count; i++) {
+        fds[i] = open(paths[i], O_RDONLY);
+    }
+
+    int failed = 0;
+    uint64_t longest = 0;
+    uint64_t cpu = cpu_ns();
+    uint64_t start = now_ns();
+    for (int i = 0; i < upload_count; i++) {
+        discord_rest_file_t file = { "upload.bin", NULL, fds[i], 0, 0 };
+        discord_rest_upload_t upload = { 1000 + (uint64_t)i, NULL, &file, 1, on_upload, &failed };
+        uint64_t call = now_ns();
+        if (discord_rest_upload(rest, &upload) != DISCORD_OK) {
+            failed++;
+        }
+        call = now_ns() - call;
+        longest = call > longest ? call : longest;
+    }
+    discord_rest_flush(rest, -1);
+    uint64_t elapsed = now_ns() - start;
+    cpu = cpu_ns() - cpu;
+
+    discord_mem_stats_t after;
+    discord_mem_get_stats(DISCORD_MEM_SEND, &after);
+    discord_rest_stats_t stats;
+    discord_rest_get_stats(rest, &stats);
+    report(copy_only ? "pooled" : "sendfile", elapsed, cpu, after.peak_bytes - before.live_bytes, longest, failed);
+    printf("            %llu MiB by sendfile, %llu MiB copied, %llu requests on %llu connections\n",
+           (unsigned long long)(stats.zero_copy_bytes >> 20), (unsigned long long)(stats.copied_bytes >> 20),
+           (unsigned long long)stats.requests, (unsigned long long)stats.connections_opened);
+
+    discord_rest_destroy(rest);
+    for (int i = 0; i < upload_count; i++) {
+        close(fds[i]);
+    }
+    free(fds);
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [--uploads N] [--size MIB] [--connections N] [--chunk-kb KB] [--dir PATH]\n", program_name);
+    printf("  --uploads N       Files uploaded (default 32)\n");
+    printf("  --size MIB        Size of each file (default 16)\n");
+    printf("  --connections N   Uploads in flight (default 4)\n");
+    printf("  --chunk-kb KB     Pooled buffer per connection (default 64)\n");
+    printf("  --dir PATH        Where the files are written (default /tmp)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* dir = "/tmp";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--uploads") == 0 && i + 1 < argc) {
+            upload_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+            connections = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk-kb") == 0 && i + 1 < argc) {
+            chunk_kb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (upload_count <= 0 || size_mb <= 0 || connections <= 0 || connections > 64 ||
+        chunk_kb * 1024 < DISCORD_REST_CHUNK_MIN) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Files in the page cache, so the network path is what is measured
+    char** paths = calloc((size_t)upload_count, sizeof(char*));
+    char* block = malloc(1 << 20);
+    for (int i = 0; i < (1 << 20); i++) {
+        block[i] = (char)(i * 7919);
+    }
+    for (int i = 0; i < upload_count; i++) {
+        paths[i] = malloc(256);
+        snprintf(paths[i], 256, "%s/discord-upload-bench-%d-%d.bin", dir, (int)getpid(), i);
+        int fd = open(paths[i], O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        for (int m = 0; m < size_mb; m++) {
+            if (fd < 0 || write(fd, block, 1 << 20) != (1 << 20)) {
+                fprintf(stderr, "Error: cannot write %s\n", paths[i]);
+                return 1;
+            }
+        }
+        close(fd);
+    }
+    free(block);
+
+    pid_t sink = sink_start();
+    if (sink < 0) {
+        fprintf(stderr, "Error: cannot listen on loopback\n");
+        return 1;
+    }
+    printf("Uploading %d files of %d MiB over %d connections to an HTTP sink (pooled buffers of %d KiB)\n",
+           upload_count, size_mb, connections, chunk_kb);
+    run_buffered(paths);
+    run_rest(paths, 1);
+    run_rest(paths, 0);
+
+    kill(sink, SIGKILL);
+    waitpid(sink, NULL, 0);
+    for (int i = 0; i < upload_count; i++) {
+        unlink(paths[i]);
+        free(paths[i]);
+    }
+    free(paths);
+    return 0;
+}
@@ -0,0 +1,29 @@
+# Cross-compile for Linux AArch64 from an x86-64 host.
+#
+#   cmake -S . -B build-arm64 -DCMAKE_TOOLCHAIN_FILE=cmake/toolchain-aarch64-linux-gnu.cmake
+#   cmake --build build-arm64
+#   ctest --test-dir build-arm64      # runs under qemu-aarch64 when installed
+#
+# Needs gcc-aarch64-linux-gnu plus arm64 builds of OpenSSL and libwebsockets
+# (e.g. libssl-dev:arm64, libwebsockets-dev:arm64 with multiarch enabled).
+
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+set(CMAKE_C_COMPILER aarch64-linux-gnu-gcc)
+set(CMAKE_ASM_COMPILER aarch64-linux-gnu-gcc)
+
+set(CMAKE_FIND_ROOT_PATH /usr/aarch64-linux-gnu)
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_PACKAGE ONLY)
+
+# Multiarch .pc files for pkg_check_modules(libwebsockets)
+set(ENV{PKG_CONFIG_LIBDIR} "/usr/lib/aarch64-linux-gnu/pkgconfig:/usr/share/pkgconfig")
+
+# Let ctest run the test binaries under user-mode emulation
+find_program(QEMU_AARCH64 qemu-aarch64)
+if(QEMU_AARCH64)
+    set(CMAKE_CROSSCOMPILING_EMULATOR "${QEMU_AARCH64};-L;/usr/aarch64-linux-gnu")
+endif()
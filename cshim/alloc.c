@@ -0,0 +1,193 @@
+#include "abi.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Tagged allocations
+// Each block carries a 16-byte header (requested size and tag) ahead of
+// the pointer handed out, so frees and reallocs find their tag and size
+// without the caller passing them and any allocator can sit underneath.
+// Counters are relaxed atomics; the allocator and budgets are meant to be
+// configured at startup, before other threads allocate.
+
+typedef struct {
+    size_t size;
+    uint32_t tag;
+    uint32_t reserved;
+} mem_header_t;
+
+#define MEM_HEADER_SIZE 16
+
+typedef struct {
+    size_t live;
+    size_t peak;
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t failures;
+    uint64_t over_budget;
+    size_t budget;
+    discord_mem_budget_callback_t callback;
+    void* user;
+    int in_callback;
+} mem_tag_state_t;
+
+static void* libc_allocate(void* user, size_t size) {
+    (void)user;
+    return malloc(size);
+}
+
+static void* libc_reallocate(void* user, void* ptr, size_t size) {
+    (void)user;
+    return realloc(ptr, size);
+}
+
+static void libc_release(void* user, void* ptr) {
+    (void)user;
+    free(ptr);
+}
+
+static discord_allocator_t mem_allocator = { libc_allocate, libc_reallocate, libc_release, NULL };
+static mem_tag_state_t mem_tags[DISCORD_MEM_TAG_COUNT];
+
+static void mem_account(uint32_t tag, size_t size) {
+    mem_tag_state_t* t = &mem_tags[tag];
+    size_t live = __atomic_add_fetch(&t->live, size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&t->allocations, 1, __ATOMIC_RELAXED);
+
+    size_t peak = __atomic_load_n(&t->peak, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&t->peak, &peak, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    // Soft budget: let the owner shed memory, one callback at a time
+    size_t budget = t->budget;
+    if (budget && live > budget && t->callback &&
+        !__atomic_exchange_n(&t->in_callback, 1, __ATOMIC_ACQUIRE)) {
+        __atomic_add_fetch(&t->over_budget, 1, __ATOMIC_RELAXED);
+        t->callback((discord_mem_tag_t)tag, live, budget, t->user);
+        __atomic_store_n(&t->in_callback, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static void mem_release_account(uint32_t tag, size_t size) {
+    __atomic_sub_fetch(&mem_tags[tag].live, size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mem_tags[tag].frees, 1, __ATOMIC_RELAXED);
+}
+
+static mem_header_t* mem_header(void* ptr) {
+    return (mem_header_t*)((char*)ptr - MEM_HEADER_SIZE);
+}
+
+discord_result_t discord_set_allocator(const discord_allocator_t* allocator) {
+    if (allocator && (!allocator->allocate || !allocator->reallocate || !allocator->release)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // Blocks must go back to the allocator that produced them
+    for (int i = 0; i < DISCORD_MEM_TAG_COUNT; i++) {
+        if (__atomic_load_n(&mem_tags[i].live, __ATOMIC_RELAXED) != 0) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+    }
+
+    if (allocator) {
+        mem_allocator = *allocator;
+    } else {
+        mem_allocator.allocate = libc_allocate;
+        mem_allocator.reallocate = libc_reallocate;
+        mem_allocator.release = libc_release;
+        mem_allocator.user = NULL;
+    }
+    return DISCORD_OK;
+}
+
+void* discord_mem_alloc(discord_mem_tag_t tag, size_t size) {
+    if ((unsigned)tag >= DISCORD_MEM_TAG_COUNT || size > SIZE_MAX - MEM_HEADER_SIZE) {
+        return NULL;
+    }
+
+    mem_header_t* header = mem_allocator.allocate(mem_allocator.user, size + MEM_HEADER_SIZE);
+    if (!header) {
+        __atomic_add_fetch(&mem_tags[tag].failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    header->size = size;
+    header->tag = (uint32_t)tag;
+    mem_account((uint32_t)tag, size);
+    return (char*)header + MEM_HEADER_SIZE;
+}
+
+void* discord_mem_calloc(discord_mem_tag_t tag, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void* ptr = discord_mem_alloc(tag, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void* discord_mem_realloc(discord_mem_tag_t tag, void* ptr, size_t size) {
+    if (!ptr) {
+        return discord_mem_alloc(tag, size);
+    }
+    if ((unsigned)tag >= DISCORD_MEM_TAG_COUNT || size > SIZE_MAX - MEM_HEADER_SIZE) {
+        return NULL;
+    }
+
+    mem_header_t* header = mem_header(ptr);
+    uint32_t old_tag = header->tag;
+    size_t old_size = header->size;
+
+    mem_header_t* resized = mem_allocator.reallocate(mem_allocator.user, header, size + MEM_HEADER_SIZE);
+    if (!resized) {
+        __atomic_add_fetch(&mem_tags[tag].failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    resized->size = size;
+    resized->tag = (uint32_t)tag;
+    mem_release_account(old_tag, old_size);
+    mem_account((uint32_t)tag, size);
+    return (char*)resized + MEM_HEADER_SIZE;
+}
+
+void discord_mem_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    mem_header_t* header = mem_header(ptr);
+    mem_release_account(header->tag, header->size);
+    mem_allocator.release(mem_allocator.user, header);
+}
+
+discord_result_t discord_mem_set_budget(discord_mem_tag_t tag, size_t budget,
+                                        discord_mem_budget_callback_t callback, void* user) {
+    if ((unsigned)tag >= DISCORD_MEM_TAG_COUNT) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    mem_tags[tag].callback = callback;
+    mem_tags[tag].user = user;
+    __atomic_store_n(&mem_tags[tag].budget, budget, __ATOMIC_RELEASE);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_mem_get_stats(discord_mem_tag_t tag, discord_mem_stats_t* stats) {
+    if ((unsigned)tag >= DISCORD_MEM_TAG_COUNT || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    mem_tag_state_t* t = &mem_tags[tag];
+    stats->live_bytes = __atomic_load_n(&t->live, __ATOMIC_RELAXED);
+    stats->peak_bytes = __atomic_load_n(&t->peak, __ATOMIC_RELAXED);
+    stats->allocations = __atomic_load_n(&t->allocations, __ATOMIC_RELAXED);
+    stats->frees = __atomic_load_n(&t->frees, __ATOMIC_RELAXED);
+    stats->failures = __atomic_load_n(&t->failures, __ATOMIC_RELAXED);
+    stats->budget = __atomic_load_n(&t->budget, __ATOMIC_RELAXED);
+    stats->over_budget = __atomic_load_n(&t->over_budget, __ATOMIC_RELAXED);
+    return DISCORD_OK;
+}
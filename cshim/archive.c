@@ -0,0 +1,1450 @@
+#include "abi.h"
+#include "archive.h"
+#include "internal.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Segment file layout (host byte order)
+//   header       archive_header_t, written last
+//   groups       per group: ARCHIVE_COLUMNS uint32 end offsets, then the
+//                columns: a kind byte per row; message, channel, guild and
+//                author ids and event_ms as zigzag varint deltas from the
+//                previous row; content lengths as varints (length + 1,
+//                0 = none); the group's contents as one block, compressed
+//                unless that did not make it smaller
+//   group table  archive_group_t per group (8-byte aligned)
+//   indexes      channel, then author: archive_key_t sorted by key, each
+//                naming a run of uint32 group numbers in the postings after
+
+#define ARCHIVE_MAGIC       0x43524144u  // "DARC"
+#define ARCHIVE_VERSION     1u
+#define ARCHIVE_NAME        "segment-%08u.darc"
+#define ARCHIVE_VARINT_MAX  10
+
+enum {
+    COL_KIND = 0,
+    COL_ID,
+    COL_CHANNEL,
+    COL_GUILD,
+    COL_AUTHOR,
+    COL_EVENT,
+    COL_LENGTH,
+    COL_CONTENT,
+    ARCHIVE_COLUMNS
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rows;
+    uint32_t groups;
+    uint64_t min_time_ms;           // Message times (from the ids)
+    uint64_t max_time_ms;
+    uint64_t groups_offset;
+    uint64_t channels_offset;
+    uint64_t authors_offset;
+    uint32_t channel_keys;
+    uint32_t channel_postings;
+    uint32_t author_keys;
+    uint32_t author_postings;
+    uint64_t file_size;
+} archive_header_t;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t size;                  // Column directory included
+    uint32_t rows;
+    uint32_t content_raw;
+    uint32_t content_packed;        // Equal to content_raw: stored as is
+    uint64_t min_time_ms;
+    uint64_t max_time_ms;
+} archive_group_t;
+
+typedef struct {
+    uint64_t key;
+    uint32_t first;
+    uint32_t count;
+} archive_key_t;
+
+typedef struct {
+    uint64_t key;
+    uint32_t group;
+} archive_pair_t;
+
+typedef struct {
+    uint64_t message_id;
+    uint64_t channel_id;
+    uint64_t guild_id;
+    uint64_t author_id;
+    uint64_t event_ms;
+    uint32_t content_length;        // Plus one; 0 = none
+    uint8_t kind;
+} archive_raw_t;
+
+// The id columns, in file order, and where they live in a raw row
+static const size_t archive_fields[] = {
+    offsetof(archive_raw_t, message_id),
+    offsetof(archive_raw_t, channel_id),
+    offsetof(archive_raw_t, guild_id),
+    offsetof(archive_raw_t, author_id),
+    offsetof(archive_raw_t, event_ms),
+};
+
+typedef struct {
+    uint32_t rows;
+    int seal;                       // Seal the segment after this group
+    archive_raw_t raw[DISCORD_ARCHIVE_GROUP_ROWS];
+    char* content;
+    size_t content_used;
+    size_t content_capacity;
+} archive_batch_t;
+
+typedef struct {
+    int fd;
+    int failed;
+    uint32_t number;
+    char path[PATH_MAX];
+    uint64_t offset;
+    uint32_t rows;
+    uint64_t min_time_ms;
+    uint64_t max_time_ms;
+    archive_group_t* groups;
+    uint32_t group_count;
+    size_t group_capacity;
+    archive_pair_t* pairs[2];       // Channel and author, by group
+    size_t pair_count[2];
+    size_t pair_capacity[2];
+} archive_segment_t;
+
+struct discord_archive {
+    char directory[PATH_MAX];
+    uint32_t segment_rows;
+    int sync;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;            // Writer: a batch was queued or stop set
+    pthread_cond_t space;           // Appenders: a batch was freed; flushers: one was written
+    archive_batch_t* current;
+    archive_batch_t* queue[DISCORD_ARCHIVE_QUEUE_GROUPS + 1];
+    uint32_t queue_head;
+    uint32_t queued;
+    archive_batch_t* free_batches[DISCORD_ARCHIVE_QUEUE_GROUPS];
+    uint32_t free_count;
+    uint64_t pushed;
+    uint64_t completed;
+    int stop;
+    pthread_t writer;
+    discord_archive_stats_t stats;
+
+    // Writer thread only
+    archive_segment_t segment;
+    uint32_t next_number;
+    uint8_t* scratch;
+    size_t scratch_capacity;
+    uint64_t* keys;                 // Distinct ids of a group
+};
+
+typedef struct {
+    uint8_t* map;
+    size_t size;
+    const archive_header_t* header;
+    const archive_group_t* groups;
+    const archive_key_t* keys[2];
+    const uint32_t* postings[2];
+    uint32_t key_count[2];
+} archive_mapped_t;
+
+struct discord_archive_reader {
+    archive_mapped_t* segments;
+    size_t count;
+    uint64_t columns[ARCHIVE_COLUMNS][DISCORD_ARCHIVE_GROUP_ROWS];
+    uint8_t kinds[DISCORD_ARCHIVE_GROUP_ROWS];
+    uint8_t* content;
+    size_t content_capacity;
+    uint32_t* candidates;
+    size_t candidate_capacity;
+};
+
+// The archive discord_dispatch_event appends to; sinks are counted by
+// epoch parity so attach can wait out appends to the one it replaced
+static discord_archive_t* attached_archive = NULL;
+static uint32_t sink_epoch = 0;
+static uint32_t sink_readers[2];
+
+static uint64_t archive_wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static uint64_t snowflake_ms(uint64_t id) {
+    return (id >> 22) + DISCORD_SNOWFLAKE_EPOCH_MS;
+}
+
+// Varints
+
+static uint8_t* put_varint(uint8_t* p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t zigzag(uint64_t current, uint64_t previous) {
+    int64_t delta = (int64_t)(current - previous);
+    return ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+}
+
+static uint64_t unzigzag(uint64_t value, uint64_t previous) {
+    return previous + ((value >> 1) ^ (0 - (value & 1)));
+}
+
+// Content compression
+// LZ77 sequences: a token byte (literal count in the high nibble, match
+// length minus 4 in the low one; 15 means length bytes follow, each 255
+// adding more), the literals, and a 16-bit little-endian match offset. The
+// last sequence has literals only.
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 13
+#define LZ_TAIL      8              // Trailing bytes always sent as literals
+
+static size_t lz_bound(size_t length) {
+    return length + length / 255 + 16;
+}
+
+static uint8_t* lz_put_length(uint8_t* p, size_t length) {
+    while (length >= 255) {
+        *p++ = 255;
+        length -= 255;
+    }
+    *p++ = (uint8_t)length;
+    return p;
+}
+
+static uint8_t* lz_put_literals(uint8_t* p, uint8_t* token, const uint8_t* literals, size_t count) {
+    *token = (uint8_t)((count >= 15 ? 15 : count) << 4);
+    if (count >= 15) {
+        p = lz_put_length(p, count - 15);
+    }
+    memcpy(p, literals, count);
+    return p + count;
+}
+
+static size_t lz_compress(const uint8_t* in, size_t length, uint8_t* out) {
+    uint32_t table[1u << LZ_HASH_BITS];     // Position + 1 of the last 4 bytes hashing there
+    memset(table, 0, sizeof(table));
+    const uint8_t* ip = in;
+    const uint8_t* anchor = in;
+    uint8_t* op = out;
+
+    if (length > LZ_MIN_MATCH + LZ_TAIL) {
+        const uint8_t* limit = in + length - LZ_TAIL;
+        while (ip < limit) {
+            uint32_t sequence;
+            memcpy(&sequence, ip, sizeof(sequence));
+            uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+            uint32_t candidate = table[hash];
+            table[hash] = (uint32_t)(ip - in) + 1;
+            if (!candidate || (uint32_t)(ip - in) - (candidate - 1) > 65535 ||
+                memcmp(in + candidate - 1, ip, LZ_MIN_MATCH) != 0) {
+                ip++;
+                continue;
+            }
+
+            const uint8_t* ref = in + candidate - 1;
+
+            size_t match = LZ_MIN_MATCH;
+            while (ip + match < limit && ref[match] == ip[match]) {
+                match++;
+            }
+            uint8_t* token = op++;
+            op = lz_put_literals(op, token, anchor, (size_t)(ip - anchor));
+            size_t offset = (size_t)(ip - ref);
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+            size_t extra = match - LZ_MIN_MATCH;
+            *token |= (uint8_t)(extra >= 15 ? 15 : extra);
+            if (extra >= 15) {
+                op = lz_put_length(op, extra - 15);
+            }
+            ip += match;
+            anchor = ip;
+        }
+    }
+
+    uint8_t* token = op++;
+    op = lz_put_literals(op, token, anchor, (size_t)(in + length - anchor));
+    return (size_t)(op - out);
+}
+
+static const uint8_t* lz_get_length(const uint8_t* p, const uint8_t* end, size_t* length) {
+    uint8_t byte;
+    do {
+        if (p >= end) {
+            return NULL;
+        }
+        byte = *p++;
+        *length += byte;
+    } while (byte == 255);
+    return p;
+}
+
+// Copies run in 16-byte steps that may overrun by up to LZ_SLACK bytes, so
+// out must have that much room past out_length
+#define LZ_SLACK 16
+
+static void lz_copy16(uint8_t* op, const uint8_t* ip, size_t length) {
+    uint8_t* end = op + length;
+    do {
+        memcpy(op, ip, 16);
+        op += 16;
+        ip += 16;
+    } while (op < end);
+}
+
+static int lz_decompress(const uint8_t* in, size_t length, uint8_t* out, size_t out_length) {
+    const uint8_t* ip = in;
+    const uint8_t* end = in + length;
+    uint8_t* op = out;
+    uint8_t* out_end = out + out_length;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !(ip = lz_get_length(ip, end, &literals))) {
+            return -1;
+        }
+        if (literals > (size_t)(end - ip) || literals > (size_t)(out_end - op)) {
+            return -1;
+        }
+        if ((size_t)(end - ip) >= literals + LZ_SLACK) {
+            lz_copy16(op, ip, literals);
+        } else {
+            memcpy(op, ip, literals);
+        }
+        op += literals;
+        ip += literals;
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return -1;
+        }
+        size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t match = token & 15;
+        if (match == 15 && !(ip = lz_get_length(ip, end, &match))) {
+            return -1;
+        }
+        match += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - out) || match > (size_t)(out_end - op)) {
+            return -1;
+        }
+        const uint8_t* ref = op - offset;
+        if (offset >= 16) {
+            lz_copy16(op, ref, match);
+            op += match;
+        } else if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            while (match--) {
+                *op++ = *ref++;
+            }
+        }
+    }
+    return op == out_end ? 0 : -1;
+}
+
+// Writer
+
+static int write_all(int fd, const void* data, size_t length) {
+    const uint8_t* p = data;
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static int grow(void** buffer, size_t* capacity, size_t needed, size_t item) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    size_t next = *capacity ? *capacity * 2 : 64;
+    while (next < needed) {
+        next *= 2;
+    }
+    void* grown = discord_mem_realloc(DISCORD_MEM_OTHER, *buffer, next * item);
+    if (!grown) {
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = next;
+    return 0;
+}
+
+static void segment_write(archive_segment_t* segment, const void* data, size_t length) {
+    if (!segment->failed && write_all(segment->fd, data, length) != 0) {
+        segment->failed = 1;
+    }
+    segment->offset += length;
+}
+
+static void segment_align(archive_segment_t* segment) {
+    static const uint8_t zeros[8] = {0};
+    if (segment->offset % 8) {
+        segment_write(segment, zeros, 8 - segment->offset % 8);
+    }
+}
+
+static void segment_start(discord_archive_t* archive) {
+    archive_segment_t* segment = &archive->segment;
+    segment->number = archive->next_number++;
+    char name[32];
+    snprintf(name, sizeof(name), ARCHIVE_NAME, segment->number);
+    int length = snprintf(segment->path, sizeof(segment->path), "%s/%s.tmp", archive->directory, name);
+    segment->fd = length < (int)sizeof(segment->path) ? open(segment->path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    segment->failed = segment->fd < 0;
+    segment->offset = 0;
+    segment->rows = 0;
+    segment->min_time_ms = UINT64_MAX;
+    segment->max_time_ms = 0;
+    segment->group_count = 0;
+    segment->pair_count[0] = segment->pair_count[1] = 0;
+
+    archive_header_t header = {0};
+    segment_write(segment, &header, sizeof(header));
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_pairs(const void* a, const void* b) {
+    const archive_pair_t* x = a;
+    const archive_pair_t* y = b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->group < y->group ? -1 : x->group > y->group;
+}
+
+// Note the distinct non-zero values of one id column for the index
+static int segment_index_group(discord_archive_t* archive, const archive_batch_t* batch, size_t field, int which) {
+    archive_segment_t* segment = &archive->segment;
+    uint32_t distinct = 0;
+    for (uint32_t i = 0; i < batch->rows; i++) {
+        uint64_t key;
+        memcpy(&key, (const char*)&batch->raw[i] + field, sizeof(key));
+        if (key) {
+            archive->keys[distinct++] = key;
+        }
+    }
+    qsort(archive->keys, distinct, sizeof(uint64_t), compare_u64);
+
+    for (uint32_t i = 0; i < distinct; i++) {
+        if (i > 0 && archive->keys[i] == archive->keys[i - 1]) {
+            continue;
+        }
+        if (grow((void**)&segment->pairs[which], &segment->pair_capacity[which], segment->pair_count[which] + 1,
+                 sizeof(archive_pair_t)) != 0) {
+            return -1;
+        }
+        archive_pair_t* pair = &segment->pairs[which][segment->pair_count[which]++];
+        pair->key = archive->keys[i];
+        pair->group = segment->group_count;
+    }
+    return 0;
+}
+
+static void segment_write_group(discord_archive_t* archive, const archive_batch_t* batch) {
+    archive_segment_t* segment = &archive->segment;
+    if (segment->fd < 0 && !segment->failed) {
+        segment_start(archive);
+    }
+
+    size_t needed = ARCHIVE_COLUMNS * sizeof(uint32_t) + batch->rows * (1 + 6 * ARCHIVE_VARINT_MAX) +
+                    lz_bound(batch->content_used);
+    if (grow((void**)&archive->scratch, &archive->scratch_capacity, needed, 1) != 0 ||
+        grow((void**)&segment->groups, &segment->group_capacity, segment->group_count + 1,
+             sizeof(archive_group_t)) != 0) {
+        segment->failed = 1;
+    }
+    if (segment->failed || segment_index_group(archive, batch, offsetof(archive_raw_t, channel_id), 0) != 0 ||
+        segment_index_group(archive, batch, offsetof(archive_raw_t, author_id), 1) != 0) {
+        segment->failed = 1;
+        segment->rows += batch->rows;
+        return;
+    }
+
+    uint32_t directory[ARCHIVE_COLUMNS];
+    uint8_t* start = archive->scratch;
+    uint8_t* p = start + sizeof(directory);
+    archive_group_t group = {0};
+    group.min_time_ms = UINT64_MAX;
+
+    for (uint32_t i = 0; i < batch->rows; i++) {
+        *p++ = batch->raw[i].kind;
+        uint64_t time_ms = snowflake_ms(batch->raw[i].message_id);
+        group.min_time_ms = time_ms < group.min_time_ms ? time_ms : group.min_time_ms;
+        group.max_time_ms = time_ms > group.max_time_ms ? time_ms : group.max_time_ms;
+    }
+    directory[COL_KIND] = (uint32_t)(p - start);
+
+    for (int column = 0; column < COL_LENGTH - COL_ID; column++) {
+        uint64_t previous = 0;
+        for (uint32_t i = 0; i < batch->rows; i++) {
+            uint64_t value;
+            memcpy(&value, (const char*)&batch->raw[i] + archive_fields[column], sizeof(value));
+            p = put_varint(p, zigzag(value, previous));
+            previous = value;
+        }
+        directory[COL_ID + column] = (uint32_t)(p - start);
+    }
+
+    for (uint32_t i = 0; i < batch->rows; i++) {
+        p = put_varint(p, batch->raw[i].content_length);
+    }
+    directory[COL_LENGTH] = (uint32_t)(p - start);
+
+    size_t packed = batch->content_used ? lz_compress((const uint8_t*)batch->content, batch->content_used, p) : 0;
+    if (packed >= batch->content_used && batch->content_used) {
+        memcpy(p, batch->content, batch->content_used);
+        packed = batch->content_used;
+    }
+    p += packed;
+    directory[COL_CONTENT] = (uint32_t)(p - start);
+    memcpy(start, directory, sizeof(directory));
+
+    group.offset = segment->offset;
+    group.size = (uint32_t)(p - start);
+    group.rows = batch->rows;
+    group.content_raw = (uint32_t)batch->content_used;
+    group.content_packed = (uint32_t)packed;
+    segment_write(segment, start, group.size);
+    segment->groups[segment->group_count++] = group;
+    segment->rows += batch->rows;
+    if (group.min_time_ms < segment->min_time_ms) {
+        segment->min_time_ms = group.min_time_ms;
+    }
+    if (group.max_time_ms > segment->max_time_ms) {
+        segment->max_time_ms = group.max_time_ms;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    archive->stats.groups++;
+    archive->stats.content_bytes += batch->content_used;
+    archive->stats.content_packed += packed;
+    pthread_mutex_unlock(&archive->lock);
+}
+
+// Sorted pairs to keys and postings
+static void segment_write_index(archive_segment_t* segment, int which, uint64_t* offset,
+                                uint32_t* key_count, uint32_t* posting_count) {
+    archive_pair_t* pairs = segment->pairs[which];
+    size_t count = segment->pair_count[which];
+    qsort(pairs, count, sizeof(archive_pair_t), compare_pairs);
+
+    segment_align(segment);
+    *offset = segment->offset;
+    *key_count = 0;
+    *posting_count = (uint32_t)count;
+    for (size_t i = 0; i < count;) {
+        archive_key_t key = { pairs[i].key, (uint32_t)i, 0 };
+        while (i < count && pairs[i].key == key.key) {
+            key.count++;
+            i++;
+        }
+        segment_write(segment, &key, sizeof(key));
+        (*key_count)++;
+    }
+    for (size_t i = 0; i < count; i++) {
+        segment_write(segment, &pairs[i].group, sizeof(uint32_t));
+    }
+}
+
+static void segment_seal(discord_archive_t* archive) {
+    archive_segment_t* segment = &archive->segment;
+    if (segment->fd < 0 && !segment->failed) {
+        return;                         // Nothing written since the last seal
+    }
+
+    archive_header_t header = {0};
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.rows = segment->rows;
+    header.groups = segment->group_count;
+    header.min_time_ms = segment->min_time_ms;
+    header.max_time_ms = segment->max_time_ms;
+
+    segment_align(segment);
+    header.groups_offset = segment->offset;
+    segment_write(segment, segment->groups, segment->group_count * sizeof(archive_group_t));
+    segment_write_index(segment, 0, &header.channels_offset, &header.channel_keys, &header.channel_postings);
+    segment_write_index(segment, 1, &header.authors_offset, &header.author_keys, &header.author_postings);
+    header.file_size = segment->offset;
+
+    if (!segment->failed && (pwrite(segment->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+                             (archive->sync && fsync(segment->fd) != 0))) {
+        segment->failed = 1;
+    }
+    if (segment->fd >= 0 && close(segment->fd) != 0) {
+        segment->failed = 1;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", segment->path);
+    path[strlen(path) - 4] = '\0';      // Drop .tmp
+    if (!segment->failed && rename(segment->path, path) != 0) {
+        segment->failed = 1;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    if (segment->failed) {
+        unlink(segment->path);
+        archive->stats.write_errors++;
+    } else {
+        archive->stats.segments++;
+        archive->stats.file_bytes += segment->offset;
+    }
+    pthread_mutex_unlock(&archive->lock);
+
+    segment->fd = -1;
+    segment->failed = 0;
+}
+
+static void* archive_writer_main(void* arg) {
+    discord_archive_t* archive = arg;
+    pthread_mutex_lock(&archive->lock);
+    for (;;) {
+        while (!archive->queued && !archive->stop) {
+            pthread_cond_wait(&archive->work, &archive->lock);
+        }
+        if (!archive->queued) {
+            break;
+        }
+        archive_batch_t* batch = archive->queue[archive->queue_head];
+        archive->queue_head = (archive->queue_head + 1) % (DISCORD_ARCHIVE_QUEUE_GROUPS + 1);
+        archive->queued--;
+        pthread_mutex_unlock(&archive->lock);
+
+        if (batch->rows > 0) {
+            segment_write_group(archive, batch);
+        }
+        if (batch->seal || archive->segment.rows >= archive->segment_rows) {
+            segment_seal(archive);
+        }
+        batch->rows = 0;
+        batch->seal = 0;
+        batch->content_used = 0;
+
+        pthread_mutex_lock(&archive->lock);
+        archive->free_batches[archive->free_count++] = batch;
+        archive->completed++;
+        pthread_cond_broadcast(&archive->space);
+    }
+    pthread_mutex_unlock(&archive->lock);
+    return NULL;
+}
+
+// Caller holds archive->lock. Queue the current batch and take a free one,
+// waiting for the writer when none is left.
+static void archive_push(discord_archive_t* archive) {
+    uint32_t tail = (archive->queue_head + archive->queued) % (DISCORD_ARCHIVE_QUEUE_GROUPS + 1);
+    archive->queue[tail] = archive->current;
+    archive->queued++;
+    archive->pushed++;
+    archive->current = NULL;
+    pthread_cond_signal(&archive->work);
+
+    if (!archive->free_count) {
+        archive->stats.stalls++;
+        while (!archive->free_count) {
+            pthread_cond_wait(&archive->space, &archive->lock);
+        }
+    }
+    archive->current = archive->free_batches[--archive->free_count];
+}
+
+static uint32_t highest_segment(const char* directory) {
+    DIR* dir = opendir(directory);
+    uint32_t next = 0;
+    if (!dir) {
+        return 0;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned number;
+        char rest[8] = "";
+        if (sscanf(entry->d_name, "segment-%8u.darc%7s", &number, rest) >= 1 && number + 1 > next) {
+            next = number + 1;
+        }
+    }
+    closedir(dir);
+    return next;
+}
+
+static void archive_free(discord_archive_t* archive) {
+    if (archive->current) {
+        discord_mem_free(archive->current->content);
+        discord_mem_free(archive->current);
+    }
+    for (uint32_t i = 0; i < archive->free_count; i++) {
+        discord_mem_free(archive->free_batches[i]->content);
+        discord_mem_free(archive->free_batches[i]);
+    }
+    discord_mem_free(archive->segment.groups);
+    discord_mem_free(archive->segment.pairs[0]);
+    discord_mem_free(archive->segment.pairs[1]);
+    discord_mem_free(archive->scratch);
+    discord_mem_free(archive->keys);
+    pthread_mutex_destroy(&archive->lock);
+    pthread_cond_destroy(&archive->work);
+    pthread_cond_destroy(&archive->space);
+    discord_mem_free(archive);
+}
+
+discord_result_t discord_archive_open(const char* directory, const discord_archive_config_t* config,
+                                      discord_archive_t** archive) {
+    if (!directory || !archive || strlen(directory) + 32 >= PATH_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    discord_archive_t* a = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_archive_t));
+    if (!a) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    snprintf(a->directory, sizeof(a->directory), "%s", directory);
+    a->segment_rows = config && config->segment_rows ? config->segment_rows : DISCORD_ARCHIVE_SEGMENT_ROWS;
+    a->sync = config ? config->sync : 0;
+    a->segment.fd = -1;
+    a->next_number = highest_segment(directory);
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->work, NULL);
+    pthread_cond_init(&a->space, NULL);
+
+    a->keys = discord_mem_alloc(DISCORD_MEM_OTHER, DISCORD_ARCHIVE_GROUP_ROWS * sizeof(uint64_t));
+    int ok = a->keys != NULL;
+    for (uint32_t i = 0; ok && i < DISCORD_ARCHIVE_QUEUE_GROUPS; i++) {
+        archive_batch_t* batch = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(archive_batch_t));
+        if (!batch) {
+            ok = 0;
+            break;
+        }
+        a->free_batches[a->free_count++] = batch;
+    }
+    if (ok) {
+        a->current = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(archive_batch_t));
+    }
+    if (!ok || !a->current || pthread_create(&a->writer, NULL, archive_writer_main, a) != 0) {
+        archive_free(a);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    *archive = a;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_archive_append_row(discord_archive_t* archive, const discord_archive_row_t* row) {
+    if (!archive || !row || (row->content && row->content_length >= UINT32_MAX)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    archive_batch_t* batch = archive->current;
+    if (batch->rows == DISCORD_ARCHIVE_GROUP_ROWS) {
+        archive_push(archive);
+        batch = archive->current;
+    }
+    size_t length = row->content ? row->content_length : 0;
+    if (grow((void**)&batch->content, &batch->content_capacity, batch->content_used + length, 1) != 0) {
+        pthread_mutex_unlock(&archive->lock);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    archive_raw_t* raw = &batch->raw[batch->rows++];
+    raw->kind = (uint8_t)row->kind;
+    raw->message_id = row->message_id;
+    raw->channel_id = row->channel_id;
+    raw->guild_id = row->guild_id;
+    raw->author_id = row->author_id;
+    raw->event_ms = row->event_ms;
+    raw->content_length = row->content ? (uint32_t)length + 1 : 0;
+    if (length) {
+        memcpy(batch->content + batch->content_used, row->content, length);
+        batch->content_used += length;
+    }
+    archive->stats.rows++;
+    pthread_mutex_unlock(&archive->lock);
+    return DISCORD_OK;
+}
+
+// "123" (or 123) to an id; 0 when it is not one
+static uint64_t parse_snowflake(const char* value, size_t length) {
+    if (length >= 2 && value[0] == '"') {
+        value++;
+        length -= 2;
+    }
+    if (length == 0 || length > 20) {
+        return 0;
+    }
+    uint64_t id = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (value[i] < '0' || value[i] > '9') {
+            return 0;
+        }
+        id = id * 10 + (uint64_t)(value[i] - '0');
+    }
+    return id;
+}
+
+static discord_result_t archive_skip(discord_archive_t* archive) {
+    pthread_mutex_lock(&archive->lock);
+    archive->stats.skipped++;
+    pthread_mutex_unlock(&archive->lock);
+    return DISCORD_ERROR_JSON;
+}
+
+discord_result_t discord_archive_append(discord_archive_t* archive, const discord_event_t* event) {
+    if (!archive || !event) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (!event->event_type || !event->data || strncmp(event->event_type, "MESSAGE_", 8) != 0) {
+        return DISCORD_OK;
+    }
+
+    const char* type = event->event_type + 8;
+    int bulk = strcmp(type, "DELETE_BULK") == 0;
+    discord_archive_row_t row = {0};
+    if (strcmp(type, "CREATE") == 0) {
+        row.kind = DISCORD_ARCHIVE_CREATE;
+    } else if (strcmp(type, "UPDATE") == 0) {
+        row.kind = DISCORD_ARCHIVE_UPDATE;
+    } else if (bulk || strcmp(type, "DELETE") == 0) {
+        row.kind = DISCORD_ARCHIVE_DELETE;
+    } else {
+        return DISCORD_OK;              // Reactions and the like
+    }
+
+    const char* cursor = event->data;
+    const char* end = event->data + event->data_length;
+    const char* key;
+    const char* value;
+    size_t key_length;
+    size_t value_length;
+    const char* ids = NULL;
+    size_t ids_length = 0;
+    while (discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK) {
+        if (key_length == 2 && memcmp(key, "id", 2) == 0) {
+            row.message_id = parse_snowflake(value, value_length);
+        } else if (key_length == 10 && memcmp(key, "channel_id", 10) == 0) {
+            row.channel_id = parse_snowflake(value, value_length);
+        } else if (key_length == 8 && memcmp(key, "guild_id", 8) == 0) {
+            row.guild_id = parse_snowflake(value, value_length);
+        } else if (key_length == 7 && memcmp(key, "content", 7) == 0 && value_length >= 2 && value[0] == '"') {
+            row.content = value + 1;
+            row.content_length = (uint32_t)(value_length - 2);
+        } else if (key_length == 6 && memcmp(key, "author", 6) == 0 && value[0] == '{') {
+            const char* inner = value;
+            const char* inner_end = value + value_length;
+            const char* author_key;
+            const char* author_value;
+            size_t author_key_length;
+            size_t author_value_length;
+            while (discord_json_object_next(&inner, inner_end, &author_key, &author_key_length,
+                                            &author_value, &author_value_length) == DISCORD_OK) {
+                if (author_key_length == 2 && memcmp(author_key, "id", 2) == 0) {
+                    row.author_id = parse_snowflake(author_value, author_value_length);
+                    break;
+                }
+            }
+        } else if (bulk && key_length == 3 && memcmp(key, "ids", 3) == 0 && value[0] == '[') {
+            ids = value;
+            ids_length = value_length;
+        }
+    }
+
+    row.event_ms = archive_wall_ms();
+    if (!row.channel_id) {
+        return archive_skip(archive);
+    }
+    if (!bulk) {
+        return row.message_id ? discord_archive_append_row(archive, &row) : archive_skip(archive);
+    }
+
+    // One delete row per id
+    if (!ids) {
+        return archive_skip(archive);
+    }
+    const char* element;
+    size_t element_length;
+    cursor = ids;
+    end = ids + ids_length;
+    while (discord_json_array_next(&cursor, end, &element, &element_length) == DISCORD_OK) {
+        row.message_id = parse_snowflake(element, element_length);
+        discord_result_t result = row.message_id ? discord_archive_append_row(archive, &row) : archive_skip(archive);
+        if (result == DISCORD_ERROR_MEMORY) {
+            return result;
+        }
+    }
+    return DISCORD_OK;
+}
+
+void discord_archive_sink(const discord_event_t* event) {
+    if (!__atomic_load_n(&attached_archive, __ATOMIC_ACQUIRE) || !event->event_type ||
+        strncmp(event->event_type, "MESSAGE_", 8) != 0) {
+        return;
+    }
+
+    uint32_t readers = __atomic_load_n(&sink_epoch, __ATOMIC_SEQ_CST) & 1;
+    __atomic_add_fetch(&sink_readers[readers], 1, __ATOMIC_SEQ_CST);
+    discord_archive_t* archive = __atomic_load_n(&attached_archive, __ATOMIC_SEQ_CST);
+    if (archive) {
+        discord_archive_append(archive, event);
+    }
+    __atomic_sub_fetch(&sink_readers[readers], 1, __ATOMIC_SEQ_CST);
+}
+
+// Flip the epoch and wait for sinks counted under the old parity
+static void drain_sinks(void) {
+    uint32_t parity = __atomic_fetch_add(&sink_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    while (__atomic_load_n(&sink_readers[parity], __ATOMIC_SEQ_CST) != 0) {
+        discord_sleep_ms(1);
+    }
+}
+
+discord_result_t discord_archive_attach(discord_archive_t* archive) {
+    __atomic_store_n(&attached_archive, archive, __ATOMIC_SEQ_CST);
+
+    // Same two-phase drain as automod installs
+    drain_sinks();
+    drain_sinks();
+    return DISCORD_OK;
+}
+
+discord_result_t discord_archive_flush(discord_archive_t* archive) {
+    if (!archive) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    uint64_t errors = archive->stats.write_errors;
+    archive->current->seal = 1;
+    archive_push(archive);
+    uint64_t ticket = archive->pushed;
+    while (archive->completed < ticket) {
+        pthread_cond_wait(&archive->space, &archive->lock);
+    }
+    discord_result_t result = archive->stats.write_errors == errors ? DISCORD_OK : DISCORD_ERROR_MEMORY;
+    pthread_mutex_unlock(&archive->lock);
+    return result;
+}
+
+discord_result_t discord_archive_get_stats(discord_archive_t* archive, discord_archive_stats_t* stats) {
+    if (!archive || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    *stats = archive->stats;
+    pthread_mutex_unlock(&archive->lock);
+    return DISCORD_OK;
+}
+
+void discord_archive_close(discord_archive_t* archive) {
+    if (!archive) {
+        return;
+    }
+    if (attached_archive == archive) {
+        discord_archive_attach(NULL);
+    }
+
+    discord_archive_flush(archive);
+    pthread_mutex_lock(&archive->lock);
+    archive->stop = 1;
+    pthread_cond_signal(&archive->work);
+    pthread_mutex_unlock(&archive->lock);
+    pthread_join(archive->writer, NULL);
+    archive_free(archive);
+}
+
+// Reader
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int range_ok(uint64_t offset, uint64_t length, size_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+static int segment_map(const char* path, archive_mapped_t* segment) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(archive_header_t)) {
+        close(fd);
+        return -1;
+    }
+    segment->size = (size_t)st.st_size;
+    segment->map = mmap(NULL, segment->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (segment->map == MAP_FAILED) {
+        segment->map = NULL;
+        return -1;
+    }
+
+    const archive_header_t* header = (const archive_header_t*)segment->map;
+    segment->header = header;
+    if (header->magic != ARCHIVE_MAGIC || header->version != ARCHIVE_VERSION || header->file_size != segment->size ||
+        header->groups_offset % 8 || header->channels_offset % 8 || header->authors_offset % 8 ||
+        !range_ok(header->groups_offset, (uint64_t)header->groups * sizeof(archive_group_t), segment->size)) {
+        return -1;
+    }
+    segment->groups = (const archive_group_t*)(segment->map + header->groups_offset);
+    for (uint32_t i = 0; i < header->groups; i++) {
+        const archive_group_t* group = &segment->groups[i];
+        if (!range_ok(group->offset, group->size, header->groups_offset) ||
+            group->size < ARCHIVE_COLUMNS * sizeof(uint32_t) || group->rows == 0 ||
+            group->rows > DISCORD_ARCHIVE_GROUP_ROWS || group->content_packed > group->content_raw) {
+            return -1;
+        }
+    }
+
+    const uint64_t offsets[2] = { header->channels_offset, header->authors_offset };
+    const uint32_t keys[2] = { header->channel_keys, header->author_keys };
+    const uint32_t postings[2] = { header->channel_postings, header->author_postings };
+    for (int which = 0; which < 2; which++) {
+        uint64_t key_bytes = (uint64_t)keys[which] * sizeof(archive_key_t);
+        if (!range_ok(offsets[which], key_bytes + (uint64_t)postings[which] * sizeof(uint32_t), segment->size)) {
+            return -1;
+        }
+        segment->keys[which] = (const archive_key_t*)(segment->map + offsets[which]);
+        segment->postings[which] = (const uint32_t*)(segment->map + offsets[which] + key_bytes);
+        segment->key_count[which] = keys[which];
+        for (uint32_t i = 0; i < keys[which]; i++) {
+            const archive_key_t* key = &segment->keys[which][i];
+            if ((uint64_t)key->first + key->count > postings[which]) {
+                return -1;
+            }
+        }
+        for (uint32_t i = 0; i < postings[which]; i++) {
+            if (segment->postings[which][i] >= header->groups) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+void discord_archive_reader_close(discord_archive_reader_t* reader) {
+    if (!reader) {
+        return;
+    }
+    for (size_t i = 0; i < reader->count; i++) {
+        if (reader->segments[i].map) {
+            munmap(reader->segments[i].map, reader->segments[i].size);
+        }
+    }
+    discord_mem_free(reader->segments);
+    discord_mem_free(reader->content);
+    discord_mem_free(reader->candidates);
+    discord_mem_free(reader);
+}
+
+discord_result_t discord_archive_reader_open(const char* directory, discord_archive_reader_t** reader) {
+    if (!directory || !reader || strlen(directory) + 32 >= PATH_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    char** names = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    discord_result_t result = DISCORD_OK;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned number;
+        char expected[32];
+        if (sscanf(entry->d_name, "segment-%8u.darc", &number) != 1) {
+            continue;
+        }
+        snprintf(expected, sizeof(expected), ARCHIVE_NAME, number);
+        if (strcmp(entry->d_name, expected) != 0) {
+            continue;                   // .tmp: still being written, or left by a crash
+        }
+        char* name = discord_mem_alloc(DISCORD_MEM_OTHER, strlen(expected) + 1);
+        if (!name || grow((void**)&names, &capacity, count + 1, sizeof(char*)) != 0) {
+            discord_mem_free(name);
+            result = DISCORD_ERROR_MEMORY;
+            break;
+        }
+        strcpy(name, expected);
+        names[count++] = name;
+    }
+    closedir(dir);
+    if (count > 1) {
+        qsort(names, count, sizeof(char*), compare_names);
+    }
+
+    discord_archive_reader_t* r = NULL;
+    if (result == DISCORD_OK) {
+        r = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_archive_reader_t));
+        if (!r || (count && !(r->segments = discord_mem_calloc(DISCORD_MEM_OTHER, count, sizeof(archive_mapped_t))))) {
+            result = DISCORD_ERROR_MEMORY;
+        }
+    }
+    for (size_t i = 0; result == DISCORD_OK && i < count; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+        r->count++;
+        if (segment_map(path, &r->segments[i]) != 0) {
+            result = DISCORD_ERROR_INVALID_PARAM;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        discord_mem_free(names[i]);
+    }
+    discord_mem_free(names);
+    if (result != DISCORD_OK) {
+        discord_archive_reader_close(r);
+        return result;
+    }
+    *reader = r;
+    return DISCORD_OK;
+}
+
+static const archive_key_t* index_find(const archive_mapped_t* segment, int which, uint64_t key) {
+    const archive_key_t* keys = segment->keys[which];
+    size_t low = 0;
+    size_t high = segment->key_count[which];
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (keys[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < segment->key_count[which] && keys[low].key == key ? &keys[low] : NULL;
+}
+
+// Groups of segment that can hold a match, in order; -1 when none can
+static long query_candidates(discord_archive_reader_t* reader, const archive_mapped_t* segment,
+                             const discord_archive_query_t* query) {
+    const uint32_t* lists[2] = { NULL, NULL };
+    uint32_t lengths[2] = { 0, 0 };
+    const uint64_t keys[2] = { query->channel_id, query->author_id };
+    for (int which = 0; which < 2; which++) {
+        if (keys[which]) {
+            const archive_key_t* key = index_find(segment, which, keys[which]);
+            if (!key) {
+                return -1;
+            }
+            lists[which] = segment->postings[which] + key->first;
+            lengths[which] = key->count;
+        }
+    }
+
+    uint32_t groups = segment->header->groups;
+    if (grow((void**)&reader->candidates, &reader->candidate_capacity, groups, sizeof(uint32_t)) != 0) {
+        return -2;
+    }
+    long count = 0;
+    if (lists[0] && lists[1]) {
+        uint32_t i = 0, j = 0;
+        while (i < lengths[0] && j < lengths[1]) {
+            if (lists[0][i] == lists[1][j]) {
+                reader->candidates[count++] = lists[0][i];
+                i++;
+                j++;
+            } else if (lists[0][i] < lists[1][j]) {
+                i++;
+            } else {
+                j++;
+            }
+        }
+    } else if (lists[0] || lists[1]) {
+        const uint32_t* list = lists[0] ? lists[0] : lists[1];
+        uint32_t length = lists[0] ? lengths[0] : lengths[1];
+        memcpy(reader->candidates, list, length * sizeof(uint32_t));
+        count = length;
+    } else {
+        for (uint32_t i = 0; i < groups; i++) {
+            reader->candidates[count++] = i;
+        }
+    }
+    return count;
+}
+
+static int decode_column(discord_archive_reader_t* reader, const uint8_t* group, const uint32_t* directory,
+                         uint32_t size, int column, uint32_t rows) {
+    uint32_t begin = directory[column - 1];
+    uint32_t end = directory[column];
+    if (begin > end || end > size) {
+        return -1;
+    }
+    const uint8_t* p = group + begin;
+    const uint8_t* limit = group + end;
+    uint64_t previous = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        uint64_t value;
+        if (!(p = get_varint(p, limit, &value))) {
+            return -1;
+        }
+        reader->columns[column][i] = column == COL_LENGTH ? value : (previous = unzigzag(value, previous));
+    }
+    return 0;
+}
+
+static int row_matches(const discord_archive_reader_t* reader, const discord_archive_query_t* query, uint32_t i) {
+    if (query->kinds && !(query->kinds & (1u << reader->kinds[i]))) {
+        return 0;
+    }
+    if (query->channel_id && reader->columns[COL_CHANNEL][i] != query->channel_id) {
+        return 0;
+    }
+    if (query->author_id && reader->columns[COL_AUTHOR][i] != query->author_id) {
+        return 0;
+    }
+    uint64_t time_ms = snowflake_ms(reader->columns[COL_ID][i]);
+    return (!query->since_ms || time_ms >= query->since_ms) && (!query->until_ms || time_ms < query->until_ms);
+}
+
+// 1 when the callback stopped the query, -1 when the group is damaged
+static int query_group(discord_archive_reader_t* reader, const archive_mapped_t* segment,
+                       const archive_group_t* group, const discord_archive_query_t* query,
+                       discord_archive_row_callback_t callback, void* user, discord_archive_query_stats_t* stats) {
+    const uint8_t* data = segment->map + group->offset;
+    uint32_t directory[ARCHIVE_COLUMNS];
+    memcpy(directory, data, sizeof(directory));
+    uint32_t rows = group->rows;
+    if (directory[COL_KIND] != sizeof(directory) + rows) {
+        return -1;
+    }
+    memcpy(reader->kinds, data + sizeof(directory), rows);
+    for (uint32_t i = 0; i < rows; i++) {
+        if (reader->kinds[i] > DISCORD_ARCHIVE_DELETE) {
+            return -1;
+        }
+    }
+
+    // The columns the filter needs first; the rest only if a row matched
+    static const int filter_columns[] = { COL_ID, COL_CHANNEL, COL_AUTHOR };
+    for (size_t c = 0; c < sizeof(filter_columns) / sizeof(filter_columns[0]); c++) {
+        if (decode_column(reader, data, directory, group->size, filter_columns[c], rows) != 0) {
+            return -1;
+        }
+    }
+    stats->groups_scanned++;
+    stats->rows_scanned += rows;
+
+    uint32_t first = rows;
+    for (uint32_t i = 0; i < rows && first == rows; i++) {
+        if (row_matches(reader, query, i)) {
+            first = i;
+        }
+    }
+    if (first == rows) {
+        return 0;
+    }
+
+    if (decode_column(reader, data, directory, group->size, COL_GUILD, rows) != 0 ||
+        decode_column(reader, data, directory, group->size, COL_EVENT, rows) != 0 ||
+        decode_column(reader, data, directory, group->size, COL_LENGTH, rows) != 0 ||
+        directory[COL_CONTENT] != group->size || directory[COL_CONTENT] - directory[COL_LENGTH] != group->content_packed) {
+        return -1;
+    }
+    const uint8_t* packed = data + directory[COL_LENGTH];
+    const uint8_t* content = packed;
+    if (group->content_packed < group->content_raw) {
+        if (grow((void**)&reader->content, &reader->content_capacity, group->content_raw + LZ_SLACK, 1) != 0 ||
+            lz_decompress(packed, group->content_packed, reader->content, group->content_raw) != 0) {
+            return -1;
+        }
+        content = reader->content;
+    }
+    stats->groups_decoded++;
+
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        uint64_t length = reader->columns[COL_LENGTH][i];
+        uint64_t bytes = length ? length - 1 : 0;
+        if (bytes > group->content_raw - offset) {
+            return -1;
+        }
+        if (i >= first && row_matches(reader, query, i)) {
+            discord_archive_row_t row;
+            row.kind = (discord_archive_kind_t)reader->kinds[i];
+            row.message_id = reader->columns[COL_ID][i];
+            row.channel_id = reader->columns[COL_CHANNEL][i];
+            row.guild_id = reader->columns[COL_GUILD][i];
+            row.author_id = reader->columns[COL_AUTHOR][i];
+            row.event_ms = reader->columns[COL_EVENT][i];
+            row.content = length ? (const char*)content + offset : NULL;
+            row.content_length = (uint32_t)bytes;
+            stats->rows_matched++;
+            if (callback && callback(user, &row)) {
+                return 1;
+            }
+        }
+        offset += bytes;
+    }
+    return 0;
+}
+
+discord_result_t discord_archive_query(discord_archive_reader_t* reader, const discord_archive_query_t* query,
+                                       discord_archive_row_callback_t callback, void* user,
+                                       discord_archive_query_stats_t* stats) {
+    if (!reader || !query) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    discord_archive_query_stats_t local;
+    if (!stats) {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    for (size_t s = 0; s < reader->count; s++) {
+        const archive_mapped_t* segment = &reader->segments[s];
+        const archive_header_t* header = segment->header;
+        stats->segments++;
+        if (!header->groups || (query->since_ms && header->max_time_ms < query->since_ms) ||
+            (query->until_ms && header->min_time_ms >= query->until_ms)) {
+            stats->segments_skipped++;
+            continue;
+        }
+        long candidates = query_candidates(reader, segment, query);
+        if (candidates == -2) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        if (candidates < 0) {
+            stats->segments_skipped++;
+            continue;
+        }
+
+        for (long c = 0; c < candidates; c++) {
+            const archive_group_t* group = &segment->groups[reader->candidates[c]];
+            if ((query->since_ms && group->max_time_ms < query->since_ms) ||
+                (query->until_ms && group->min_time_ms >= query->until_ms)) {
+                continue;
+            }
+            int result = query_group(reader, segment, group, query, callback, user, stats);
+            if (result < 0) {
+                return DISCORD_ERROR_INVALID_PARAM;
+            }
+            if (result > 0) {
+                return DISCORD_OK;
+            }
+        }
+    }
+    return DISCORD_OK;
+}
+
+#else
+
+discord_result_t discord_archive_open(const char* directory, const discord_archive_config_t* config,
+                                      discord_archive_t** archive) {
+    (void)directory; (void)config; (void)archive;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_archive_append(discord_archive_t* archive, const discord_event_t* event) {
+    (void)archive; (void)event;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_archive_append_row(discord_archive_t* archive, const discord_archive_row_t* row) {
+    (void)archive; (void)row;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_archive_sink(const discord_event_t* event) {
+    (void)event;
+}
+
+discord_result_t discord_archive_attach(discord_archive_t* archive) {
+    (void)archive;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_archive_flush(discord_archive_t* archive) {
+    (void)archive;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_archive_get_stats(discord_archive_t* archive, discord_archive_stats_t* stats) {
+    (void)archive; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_archive_close(discord_archive_t* archive) {
+    (void)archive;
+}
+
+discord_result_t discord_archive_reader_open(const char* directory, discord_archive_reader_t** reader) {
+    (void)directory; (void)reader;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_archive_query(discord_archive_reader_t* reader, const discord_archive_query_t* query,
+                                       discord_archive_row_callback_t callback, void* user,
+                                       discord_archive_query_stats_t* stats) {
+    (void)reader; (void)query; (void)callback; (void)user; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_archive_reader_close(discord_archive_reader_t* reader) {
+    (void)reader;
+}
+
+#endif
@@ -0,0 +1,1065 @@
+#include "abi.h"
+#include "structs.h"
+#include "automod.h"
+#include "scan.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+    static unsigned automod_ctz64(uint64_t value) {
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return (unsigned)index;
+    }
+#else
+    static unsigned automod_ctz64(uint64_t value) {
+        return (unsigned)__builtin_ctzll(value);
+    }
+#endif
+
+// Compiled automod rule sets
+// Keywords are folded to lower case and rewritten over an alphabet of byte
+// classes (0 and 1 are the non-word and word bytes no keyword uses) plus
+// one extra symbol, B, for "a word may start here". The text is read as if
+// B followed every non-word byte and stood before the first byte, and a
+// keyword gets a B after each of its non-word bytes and, when it must start
+// a word, in front. Whole-word and prefix keywords then only match at word
+// starts without any lookbehind, and suffix and whole-word keywords check
+// the byte after the match when they are reported.
+//
+// The rewritten keywords form the trie of an Aho-Corasick automaton whose
+// failure transitions are resolved at compile time. The scan table drops B
+// again: the step on a non-word byte is the step on that byte followed by
+// the step on B. Entries hold the next state's row offset (state *
+// class_count) with the top bit set when that state ends any keyword, so
+// the hot loop is one load, one mask and one branch per byte.
+//
+// Stepping costs one dependent table load per byte, so when every keyword
+// must start a word (no "*word" rules) most of the text is not stepped
+// through at all. The automaton is idle in state 0 (inside
+// a word no keyword can still match) and in the start state (after a
+// non-word byte, nothing pending); from there the scan jumps from word
+// start to word start, 64 bytes of starts at a time from
+// discord_scan_word_starts, and resumes stepping only at a word whose first
+// bytes begin some keyword: the first n bytes of every keyword, n being the
+// shortest keyword's length up to eight, go into a 256 Kbit filter that
+// fits in L1, so a word costs one masked 8-byte load and one probe. Each
+// word let through costs a detour into the table, so once the filter has
+// passed more than about one word in five the rest of the message is
+// stepped through.
+//
+// Domains live in an open-addressing table keyed by FNV-1a; a link's host
+// and each of its parent domains are looked up in turn.
+
+#define AUTOMOD_MATCH           0x80000000u
+#define AUTOMOD_NONE            UINT32_MAX
+#define AUTOMOD_CLASS_OTHER     0           // Non-word bytes no keyword uses
+#define AUTOMOD_CLASS_WORD      1           // Word bytes no keyword uses
+#define AUTOMOD_PREFIX_BITS     18          // log2 of the prefix filter size
+#define AUTOMOD_CANDIDATE_SLACK 2           // Candidates before the filter can be given up
+
+typedef struct {
+    char* pattern;                  // Folded; keywords without the '*'
+    uint32_t length;
+    discord_automod_rule_type_t type;
+    discord_automod_action_t action;
+    uint32_t rule_id;
+    uint8_t left_bound;             // Keyword starts a word
+    uint8_t right_bound;            // Keyword ends a word
+    uint32_t next_same;             // Domains: next rule for the same domain
+} automod_rule_t;
+
+struct discord_automod {
+    discord_automod_config_t config;
+    automod_rule_t* rules;
+    size_t rule_count;
+    size_t rule_capacity;
+    uint32_t keyword_count;
+    uint32_t domain_count;
+
+    int compiled;
+    uint8_t classes[256];
+    uint32_t class_count;
+    uint32_t* next;                 // Row offset of the next state | AUTOMOD_MATCH
+    uint32_t* outputs;              // Per state: first output entry, AUTOMOD_NONE = none
+    uint32_t* out_rule;             // Output entries: rule index
+    uint32_t* out_next;             // Output entries: next entry (shared tails)
+    uint32_t state_count;
+    uint32_t start;                 // Row of the state before the first byte
+    int word_skip;                  // Every keyword starts a word
+    uint64_t prefixes[(1u << AUTOMOD_PREFIX_BITS) / 64]; // Keyword prefixes
+    uint32_t prefix_length;         // Shortest keyword, at most 8
+    uint64_t prefix_mask;           // Its bytes of an 8-byte load
+
+    uint32_t* domain_table;         // Rule index + 1, 0 = empty
+    uint32_t domain_mask;
+
+    discord_automod_stats_t stats;  // Counters are updated atomically
+};
+
+typedef struct {
+    const discord_automod_t* automod;
+    const char* content;
+    size_t length;
+    size_t exact;                   // Decoded bytes before the first escape (same offsets raw)
+    uint64_t skipped;
+    uint32_t candidates;            // Words the prefix filter let through
+    uint32_t rejected;              // Words it ruled out
+    discord_automod_verdict_t* verdict;
+} automod_scan_t;
+
+static discord_automod_t* active_automod = NULL;
+static int automod_used = 0;                // Set by the first install, never cleared
+static uint32_t automod_epoch = 0;
+static uint32_t automod_readers[2];
+
+static int is_word_byte(unsigned char c) {
+    unsigned char folded = (unsigned char)(c | 0x20);
+    return c >= 0x80 || (c >= '0' && c <= '9') || (folded >= 'a' && folded <= 'z') || c == '_';
+}
+
+static unsigned char fold(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static uint32_t automod_hash(const char* s, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Filter bit of a prefix (masked 8-byte load)
+static uint32_t prefix_bit(uint64_t key) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - AUTOMOD_PREFIX_BITS));
+}
+
+// fold on eight bytes at once: a byte whose top bit is clear and whose low
+// seven bits are in 'A'..'Z' gets 0x20. No byte sum carries into the next.
+static uint64_t fold8(uint64_t x) {
+    const uint64_t ones = 0x0101010101010101ull;
+    uint64_t low = x & (0x7F * ones);
+    uint64_t upper = (low + (0x80 - 'A') * ones) & ~(low + (0x80 - 'Z' - 1) * ones) & ~x & (0x80 * ones);
+    return x | (upper >> 2);
+}
+
+static int hex4(const char* p, uint32_t* value) {
+    uint32_t result = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = (uint32_t)(c - '0');
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            digit = (uint32_t)((c | 0x20) - 'a' + 10);
+        } else {
+            return 0;
+        }
+        result = (result << 4) | digit;
+    }
+    *value = result;
+    return 1;
+}
+
+// Decode the byte or escape at p into out (up to 4 bytes, *count of them);
+// returns its raw width. A malformed escape is a literal backslash.
+static size_t decode_escape(const char* p, const char* end, unsigned char* out, size_t* count) {
+    *count = 1;
+    if (p[0] != '\\' || end - p < 2) {
+        out[0] = (unsigned char)p[0];
+        return 1;
+    }
+
+    switch (p[1]) {
+        case 'n': out[0] = '\n'; return 2;
+        case 'r': out[0] = '\r'; return 2;
+        case 't': out[0] = '\t'; return 2;
+        case 'b': out[0] = '\b'; return 2;
+        case 'f': out[0] = '\f'; return 2;
+        case '"':
+        case '\\':
+        case '/':
+            out[0] = (unsigned char)p[1];
+            return 2;
+        case 'u': {
+            uint32_t cp;
+            if (end - p < 6 || !hex4(p + 2, &cp)) {
+                break;
+            }
+            size_t width = 6;
+            uint32_t low;
+            if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 12 && p[6] == '\\' && p[7] == 'u' &&
+                hex4(p + 8, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                width = 12;
+            }
+
+            if (cp < 0x80) {
+                out[0] = (unsigned char)cp;
+            } else if (cp < 0x800) {
+                out[0] = (unsigned char)(0xC0 | (cp >> 6));
+                out[1] = (unsigned char)(0x80 | (cp & 0x3F));
+                *count = 2;
+            } else if (cp < 0x10000) {
+                out[0] = (unsigned char)(0xE0 | (cp >> 12));
+                out[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+                out[2] = (unsigned char)(0x80 | (cp & 0x3F));
+                *count = 3;
+            } else {
+                out[0] = (unsigned char)(0xF0 | (cp >> 18));
+                out[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+                out[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+                out[3] = (unsigned char)(0x80 | (cp & 0x3F));
+                *count = 4;
+            }
+            return width;
+        }
+        default:
+            break;
+    }
+
+    out[0] = '\\';
+    return 1;
+}
+
+// Whether the decoded byte at p is a word byte (0 at the end)
+static int word_at(const char* p, const char* end) {
+    if (p >= end) {
+        return 0;
+    }
+    if (*p != '\\') {
+        return is_word_byte((unsigned char)*p);
+    }
+    unsigned char decoded[4];
+    size_t count;
+    decode_escape(p, end, decoded, &count);
+    return is_word_byte(decoded[0]);
+}
+
+// Raw offset of decoded byte number decoded (the start of its escape)
+static size_t raw_offset(const char* content, size_t length, size_t decoded) {
+    size_t raw = 0;
+    size_t count = 0;
+    while (raw < length && count < decoded) {
+        if (content[raw] != '\\') {
+            raw++;
+            count++;
+            continue;
+        }
+        unsigned char buf[4];
+        size_t n;
+        size_t width = decode_escape(content + raw, content + length, buf, &n);
+        if (count + n > decoded) {
+            break;
+        }
+        count += n;
+        raw += width;
+    }
+    return raw;
+}
+
+static int valid_domain(const char* pattern, size_t len) {
+    if (len == 0 || len > DISCORD_AUTOMOD_DOMAIN_MAX || pattern[0] == '.' || pattern[len - 1] == '.') {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = fold((unsigned char)pattern[i]);
+        int label = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+        if (!label && !(c == '.' && pattern[i + 1] != '.')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+discord_result_t discord_automod_create(const discord_automod_config_t* config, discord_automod_t** automod) {
+    if (!automod) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_automod_t* a = discord_mem_calloc(DISCORD_MEM_DISPATCH, 1, sizeof(*a));
+    if (!a) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    if (config) {
+        a->config = *config;
+    }
+
+    *automod = a;
+    return DISCORD_OK;
+}
+
+static void free_tables(discord_automod_t* automod) {
+    discord_mem_free(automod->next);
+    discord_mem_free(automod->outputs);
+    discord_mem_free(automod->out_rule);
+    discord_mem_free(automod->out_next);
+    discord_mem_free(automod->domain_table);
+    automod->next = NULL;
+    automod->outputs = NULL;
+    automod->out_rule = NULL;
+    automod->out_next = NULL;
+    automod->domain_table = NULL;
+    automod->state_count = 0;
+    automod->compiled = 0;
+}
+
+void discord_automod_destroy(discord_automod_t* automod) {
+    if (!automod) {
+        return;
+    }
+
+    if (__atomic_load_n(&active_automod, __ATOMIC_SEQ_CST) == automod) {
+        discord_automod_t* previous = NULL;
+        discord_automod_install(NULL, UINT32_MAX, &previous);
+    }
+
+    for (size_t i = 0; i < automod->rule_count; i++) {
+        discord_mem_free(automod->rules[i].pattern);
+    }
+    discord_mem_free(automod->rules);
+    free_tables(automod);
+    discord_mem_free(automod);
+}
+
+discord_result_t discord_automod_add(discord_automod_t* automod, const discord_automod_rule_t* rule) {
+    if (!automod || !rule || !rule->pattern ||
+        (rule->action != DISCORD_AUTOMOD_FLAG && rule->action != DISCORD_AUTOMOD_BLOCK) ||
+        __atomic_load_n(&active_automod, __ATOMIC_SEQ_CST) == automod) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    const char* body = rule->pattern;
+    size_t len = strlen(body);
+    int left_any = 0;
+    int right_any = 0;
+
+    if (rule->type == DISCORD_AUTOMOD_KEYWORD) {
+        if (len > 0 && body[0] == '*') {
+            left_any = 1;
+            body++;
+            len--;
+        }
+        if (len > 0 && body[len - 1] == '*') {
+            right_any = 1;
+            len--;
+        }
+        if (len == 0 || len > DISCORD_AUTOMOD_KEYWORD_MAX) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = (unsigned char)body[i];
+            if (c < 0x20 || c == 0x7F || c == '*') {
+                return DISCORD_ERROR_INVALID_PARAM;
+            }
+        }
+    } else if (rule->type == DISCORD_AUTOMOD_DOMAIN) {
+        if (!valid_domain(body, len)) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+    } else {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    if (automod->rule_count == automod->rule_capacity) {
+        size_t capacity = automod->rule_capacity ? automod->rule_capacity * 2 : 64;
+        automod_rule_t* rules = discord_mem_realloc(DISCORD_MEM_DISPATCH, automod->rules,
+                                                    capacity * sizeof(automod_rule_t));
+        if (!rules) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        automod->rules = rules;
+        automod->rule_capacity = capacity;
+    }
+
+    char* pattern = discord_mem_alloc(DISCORD_MEM_DISPATCH, len + 1);
+    if (!pattern) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    for (size_t i = 0; i < len; i++) {
+        pattern[i] = (char)fold((unsigned char)body[i]);
+    }
+    pattern[len] = '\0';
+
+    automod_rule_t* entry = &automod->rules[automod->rule_count++];
+    entry->pattern = pattern;
+    entry->length = (uint32_t)len;
+    entry->type = rule->type;
+    entry->action = rule->action;
+    entry->rule_id = rule->rule_id;
+    entry->left_bound = rule->type == DISCORD_AUTOMOD_KEYWORD && !left_any &&
+                        is_word_byte((unsigned char)pattern[0]);
+    entry->right_bound = rule->type == DISCORD_AUTOMOD_KEYWORD && !right_any &&
+                         is_word_byte((unsigned char)pattern[len - 1]);
+    entry->next_same = AUTOMOD_NONE;
+
+    if (rule->type == DISCORD_AUTOMOD_KEYWORD) {
+        automod->keyword_count++;
+    } else {
+        automod->domain_count++;
+    }
+    automod->compiled = 0;
+    return DISCORD_OK;
+}
+
+// Keyword rewritten over classes plus B (see the top of the file)
+static size_t keyword_symbols(const discord_automod_t* automod, const automod_rule_t* rule, uint32_t boundary,
+                              uint32_t* symbols) {
+    size_t count = 0;
+    if (rule->left_bound) {
+        symbols[count++] = boundary;
+    }
+    for (uint32_t i = 0; i < rule->length; i++) {
+        unsigned char c = (unsigned char)rule->pattern[i];
+        symbols[count++] = automod->classes[c];
+        if (!is_word_byte(c)) {
+            symbols[count++] = boundary;
+        }
+    }
+    return count;
+}
+
+static discord_result_t compile_keywords(discord_automod_t* automod) {
+    // Byte classes: one per distinct byte used in any keyword
+    uint16_t assigned[256] = {0};
+    uint32_t class_count = 2;
+    size_t total_symbols = 0;
+    for (size_t i = 0; i < automod->rule_count; i++) {
+        const automod_rule_t* rule = &automod->rules[i];
+        if (rule->type != DISCORD_AUTOMOD_KEYWORD) {
+            continue;
+        }
+        for (uint32_t j = 0; j < rule->length; j++) {
+            unsigned char c = (unsigned char)rule->pattern[j];
+            if (!assigned[c]) {
+                assigned[c] = (uint16_t)class_count++;
+            }
+        }
+        total_symbols += 2 * (size_t)rule->length + 1;
+    }
+
+    uint8_t class_word[256];
+    for (int c = 0; c < 256; c++) {
+        automod->classes[c] = assigned[c] ? (uint8_t)assigned[c]
+                                          : (is_word_byte((unsigned char)c) ? AUTOMOD_CLASS_WORD : AUTOMOD_CLASS_OTHER);
+    }
+    for (int c = 'A'; c <= 'Z'; c++) {
+        automod->classes[c] = automod->classes[c + ('a' - 'A')];
+    }
+    for (int c = 0; c < 256; c++) {
+        class_word[automod->classes[c]] = (uint8_t)is_word_byte((unsigned char)c);
+    }
+
+    // Trie over classes + B; 0 doubles as "no edge" since no edge enters the root
+    const uint32_t boundary = class_count;
+    const size_t symbol_count = (size_t)class_count + 1;
+    size_t max_states = 1 + total_symbols;
+    uint32_t* go = discord_mem_calloc(DISCORD_MEM_DISPATCH, max_states * symbol_count, sizeof(uint32_t));
+    uint32_t* fail = discord_mem_calloc(DISCORD_MEM_DISPATCH, max_states, sizeof(uint32_t));
+    uint32_t* queue = discord_mem_calloc(DISCORD_MEM_DISPATCH, max_states, sizeof(uint32_t));
+    uint32_t* outputs = discord_mem_calloc(DISCORD_MEM_DISPATCH, max_states, sizeof(uint32_t));
+    uint32_t* out_rule = discord_mem_calloc(DISCORD_MEM_DISPATCH, automod->keyword_count, sizeof(uint32_t));
+    uint32_t* out_next = discord_mem_calloc(DISCORD_MEM_DISPATCH, automod->keyword_count, sizeof(uint32_t));
+    if (!go || !fail || !queue || !outputs || !out_rule || !out_next) {
+        discord_mem_free(go);
+        discord_mem_free(fail);
+        discord_mem_free(queue);
+        discord_mem_free(outputs);
+        discord_mem_free(out_rule);
+        discord_mem_free(out_next);
+        return DISCORD_ERROR_MEMORY;
+    }
+    memset(outputs, 0xFF, max_states * sizeof(uint32_t));
+
+    uint32_t state_count = 1;
+    uint32_t entries = 0;
+    uint32_t symbols[2 * DISCORD_AUTOMOD_KEYWORD_MAX + 1];
+    for (size_t i = 0; i < automod->rule_count; i++) {
+        if (automod->rules[i].type != DISCORD_AUTOMOD_KEYWORD) {
+            continue;
+        }
+        size_t count = keyword_symbols(automod, &automod->rules[i], boundary, symbols);
+        uint32_t state = 0;
+        for (size_t j = 0; j < count; j++) {
+            uint32_t* edge = &go[(size_t)state * symbol_count + symbols[j]];
+            if (*edge == 0) {
+                *edge = state_count++;
+            }
+            state = *edge;
+        }
+        out_rule[entries] = (uint32_t)i;
+        out_next[entries] = outputs[state];
+        outputs[state] = entries++;
+    }
+
+    // Breadth-first failure links; missing edges take the failure state's
+    // edge, and each state's outputs continue with its failure state's
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    for (size_t s = 0; s < symbol_count; s++) {
+        uint32_t child = go[s];
+        if (child) {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        uint32_t f = fail[state];
+
+        if (outputs[state] == AUTOMOD_NONE) {
+            outputs[state] = outputs[f];
+        } else {
+            uint32_t last = outputs[state];
+            while (out_next[last] != AUTOMOD_NONE) {
+                last = out_next[last];
+            }
+            out_next[last] = outputs[f];
+        }
+
+        uint32_t* row = &go[(size_t)state * symbol_count];
+        const uint32_t* fail_row = &go[(size_t)f * symbol_count];
+        for (size_t s = 0; s < symbol_count; s++) {
+            if (row[s]) {
+                fail[row[s]] = fail_row[s];
+                queue[tail++] = row[s];
+            } else {
+                row[s] = fail_row[s];
+            }
+        }
+    }
+
+    discord_result_t result = DISCORD_OK;
+    uint32_t* next = NULL;
+    if ((uint64_t)state_count * class_count >= AUTOMOD_MATCH) {
+        result = DISCORD_ERROR_MEMORY;
+    } else {
+        next = discord_mem_alloc(DISCORD_MEM_DISPATCH, (size_t)state_count * class_count * sizeof(uint32_t));
+        if (!next) {
+            result = DISCORD_ERROR_MEMORY;
+        }
+    }
+
+    if (result == DISCORD_OK) {
+        for (uint32_t state = 0; state < state_count; state++) {
+            const uint32_t* row = &go[(size_t)state * symbol_count];
+            for (uint32_t c = 0; c < class_count; c++) {
+                uint32_t target = row[c];
+                if (!class_word[c]) {
+                    target = go[(size_t)target * symbol_count + boundary];
+                }
+                next[(size_t)state * class_count + c] =
+                    target * class_count | (outputs[target] != AUTOMOD_NONE ? AUTOMOD_MATCH : 0);
+            }
+        }
+
+        automod->word_skip = 1;
+        automod->prefix_length = 8;
+        for (size_t i = 0; i < automod->rule_count; i++) {
+            const automod_rule_t* rule = &automod->rules[i];
+            if (rule->type == DISCORD_AUTOMOD_KEYWORD) {
+                automod->word_skip &= rule->left_bound;
+                if (rule->length < automod->prefix_length) {
+                    automod->prefix_length = rule->length;
+                }
+            }
+        }
+
+        // Keys are masked loads so they match the scan on either byte order
+        unsigned char bytes[8] = {0};
+        memset(bytes, 0xFF, automod->prefix_length);
+        memcpy(&automod->prefix_mask, bytes, sizeof(bytes));
+        memset(automod->prefixes, 0, sizeof(automod->prefixes));
+        for (size_t i = 0; i < automod->rule_count; i++) {
+            const automod_rule_t* rule = &automod->rules[i];
+            if (rule->type != DISCORD_AUTOMOD_KEYWORD) {
+                continue;
+            }
+            uint64_t key = 0;
+            memcpy(&key, rule->pattern, automod->prefix_length);
+            uint32_t bit = prefix_bit(key);
+            automod->prefixes[bit >> 6] |= 1ull << (bit & 63);
+        }
+        automod->start = go[boundary] * class_count;
+
+        // Shared prefixes leave the tail of the per-state arrays unused
+        uint32_t* trimmed = discord_mem_realloc(DISCORD_MEM_DISPATCH, outputs, state_count * sizeof(uint32_t));
+        if (trimmed) {
+            outputs = trimmed;
+        }
+        automod->class_count = class_count;
+        automod->next = next;
+        automod->outputs = outputs;
+        automod->out_rule = out_rule;
+        automod->out_next = out_next;
+        automod->state_count = state_count;
+    } else {
+        discord_mem_free(outputs);
+        discord_mem_free(out_rule);
+        discord_mem_free(out_next);
+    }
+
+    discord_mem_free(go);
+    discord_mem_free(fail);
+    discord_mem_free(queue);
+    return result;
+}
+
+static discord_result_t compile_domains(discord_automod_t* automod) {
+    uint32_t size = 16;
+    while (size < automod->domain_count * 2) {
+        size *= 2;
+    }
+    uint32_t* table = discord_mem_calloc(DISCORD_MEM_DISPATCH, size, sizeof(uint32_t));
+    if (!table) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < automod->rule_count; i++) {
+        automod_rule_t* rule = &automod->rules[i];
+        if (rule->type != DISCORD_AUTOMOD_DOMAIN) {
+            continue;
+        }
+        rule->next_same = AUTOMOD_NONE;
+        uint32_t slot = automod_hash(rule->pattern, rule->length) & (size - 1);
+        for (;;) {
+            if (table[slot] == 0) {
+                table[slot] = (uint32_t)i + 1;
+                break;
+            }
+            automod_rule_t* other = &automod->rules[table[slot] - 1];
+            if (other->length == rule->length && memcmp(other->pattern, rule->pattern, rule->length) == 0) {
+                while (other->next_same != AUTOMOD_NONE) {
+                    other = &automod->rules[other->next_same];
+                }
+                other->next_same = (uint32_t)i;
+                break;
+            }
+            slot = (slot + 1) & (size - 1);
+        }
+    }
+
+    automod->domain_table = table;
+    automod->domain_mask = size - 1;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_automod_compile(discord_automod_t* automod) {
+    if (!automod || __atomic_load_n(&active_automod, __ATOMIC_SEQ_CST) == automod) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    free_tables(automod);
+    automod->word_skip = 0;
+
+    discord_result_t result = DISCORD_OK;
+    if (automod->keyword_count) {
+        result = compile_keywords(automod);
+    }
+    if (result == DISCORD_OK && automod->domain_count) {
+        result = compile_domains(automod);
+    }
+    if (result != DISCORD_OK) {
+        free_tables(automod);
+        return result;
+    }
+
+    automod->compiled = 1;
+    return DISCORD_OK;
+}
+
+// Record a match; 1 once the verdict is full
+static int add_match(automod_scan_t* scan, const automod_rule_t* rule, size_t offset, size_t length) {
+    discord_automod_verdict_t* verdict = scan->verdict;
+    discord_automod_match_t* match = &verdict->matches[verdict->match_count++];
+    match->rule_id = rule->rule_id;
+    match->action = rule->action;
+    match->offset = (uint32_t)offset;
+    match->length = (uint32_t)length;
+    if (rule->action > verdict->action) {
+        verdict->action = rule->action;
+    }
+    return verdict->match_count == DISCORD_AUTOMOD_MAX_MATCHES;
+}
+
+// Keywords ending at decoded byte decoded_end (raw byte raw_end)
+static int report_keywords(automod_scan_t* scan, uint32_t row, size_t decoded_end, size_t raw_end, int next_word) {
+    const discord_automod_t* automod = scan->automod;
+    for (uint32_t entry = automod->outputs[row / automod->class_count]; entry != AUTOMOD_NONE;
+         entry = automod->out_next[entry]) {
+        const automod_rule_t* rule = &automod->rules[automod->out_rule[entry]];
+        if (rule->right_bound && next_word) {
+            continue;
+        }
+        size_t decoded_start = decoded_end - rule->length;
+        size_t raw_start = decoded_start < scan->exact
+            ? decoded_start : raw_offset(scan->content, scan->length, decoded_start);
+        if (add_match(scan, rule, raw_start, raw_end - raw_start)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Whether a keyword may start at the word at w: its first prefix_length
+// bytes are in the filter. A word cut short by an escape may.
+static int may_start(const discord_automod_t* automod, const char* w, const char* run_end, const char* end) {
+    if ((size_t)(run_end - w) < automod->prefix_length) {
+        return run_end != end;
+    }
+
+    uint64_t key = 0;
+    if (end - w >= 8) {
+        memcpy(&key, w, 8);
+    } else {
+        memcpy(&key, w, (size_t)(end - w));
+    }
+    uint32_t bit = prefix_bit(fold8(key) & automod->prefix_mask);
+    return (int)((automod->prefixes[bit >> 6] >> (bit & 63)) & 1);
+}
+
+// Word starts of the window of a run at base; bits below valid are known
+typedef struct {
+    const char* base;
+    uint32_t valid;
+    uint64_t starts;
+} automod_window_t;
+
+// First word in [p, run_end) a keyword may start at, or run_end. p itself
+// counts when it is a word byte after a non-word byte (at_start); any other
+// start lies past p, so a window that still covers p is reused.
+static const char* next_candidate(automod_scan_t* scan, automod_window_t* window, const char* p,
+                                  const char* run_end, int at_start) {
+    const discord_automod_t* automod = scan->automod;
+    const char* end = scan->content + scan->length;
+    if (at_start && is_word_byte((unsigned char)*p)) {
+        if (may_start(automod, p, run_end, end)) {
+            return p;
+        }
+        scan->rejected++;
+    }
+
+    uint64_t starts = 0;
+    size_t offset = (size_t)(p - window->base);
+    if (window->base && p >= window->base && offset + 1 < window->valid) {
+        starts = window->starts & (~0ull << (offset + 1));
+    } else {
+        window->base = p;
+        window->valid = 0;
+    }
+
+    for (;;) {
+        if (!starts && window->valid == 0) {
+            size_t length = (size_t)(run_end - window->base);
+            window->starts = discord_scan_word_starts(window->base, length);
+            window->valid = length < 64 ? (uint32_t)length : 64;
+            starts = window->starts;
+        }
+        while (starts) {
+            const char* word = window->base + automod_ctz64(starts);
+            if (may_start(automod, word, run_end, end)) {
+                return word;
+            }
+            scan->rejected++;
+            starts &= starts - 1;
+        }
+        if (window->base + window->valid >= run_end) {
+            return run_end;
+        }
+        // The next window starts on this one's last byte, which it can
+        // then tell a word start after
+        window->base += window->valid - 1;
+        window->valid = 0;
+    }
+}
+
+static void scan_keywords(automod_scan_t* scan) {
+    const discord_automod_t* automod = scan->automod;
+    const uint32_t* next = automod->next;
+    const uint8_t* classes = automod->classes;
+    int skip_words = automod->word_skip && !automod->config.scalar_only;
+    const uint32_t start = automod->start;
+    const char* content = scan->content;
+    const char* p = content;
+    const char* end = content + scan->length;
+    uint32_t state = start;
+    size_t adjust = 0;              // Raw bytes minus decoded bytes so far
+
+    while (p < end) {
+        const char* run_end = p + discord_scan_quote_or_escape(p, (size_t)(end - p));
+        automod_window_t window = {NULL, 0, 0};
+        while (p < run_end) {
+            if (skip_words && (state == 0 || state == start)) {
+                // Idle: on to the next word a keyword may start at
+                const char* word = next_candidate(scan, &window, p, run_end, state == start);
+                scan->skipped += (size_t)(word - p);
+                if (word == run_end) {
+                    state = is_word_byte((unsigned char)run_end[-1]) ? 0 : start;
+                    p = run_end;
+                    break;
+                }
+                p = word;
+                state = start;
+                if (++scan->candidates > AUTOMOD_CANDIDATE_SLACK + scan->rejected / 4) {
+                    // Most words here begin like some keyword: stepping
+                    // through the rest costs less than testing each word
+                    skip_words = 0;
+                }
+            }
+            uint32_t step = next[state + classes[(unsigned char)*p++]];
+            state = step & ~AUTOMOD_MATCH;
+            if (step & AUTOMOD_MATCH) {
+                size_t raw_end = (size_t)(p - content);
+                if (report_keywords(scan, state, raw_end - adjust, raw_end, word_at(p, end))) {
+                    return;
+                }
+            }
+        }
+        if (p == end) {
+            break;
+        }
+
+        if (scan->exact == SIZE_MAX) {
+            scan->exact = (size_t)(p - content);
+        }
+        unsigned char decoded[4];
+        size_t count;
+        size_t width = decode_escape(p, end, decoded, &count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t step = next[state + classes[decoded[i]]];
+            state = step & ~AUTOMOD_MATCH;
+            if (step & AUTOMOD_MATCH) {
+                int next_word = i + 1 < count ? is_word_byte(decoded[i + 1]) : word_at(p + width, end);
+                size_t decoded_end = (size_t)(p - content) - adjust + i + 1;
+                if (report_keywords(scan, state, decoded_end, (size_t)(p + width - content), next_word)) {
+                    return;
+                }
+            }
+        }
+        adjust += width - count;
+        p += width;
+    }
+}
+
+static int is_authority_byte(unsigned char c) {
+    return is_word_byte(c) || (c != '\0' && strchr("-.~%!$&'*+,;=:@", c) != NULL);
+}
+
+// Hosts of scheme://host links, each looked up with its parent domains
+static void scan_links(automod_scan_t* scan) {
+    const discord_automod_t* automod = scan->automod;
+    const char* content = scan->content;
+    const char* end = content + scan->length;
+    const char* p = content;
+
+    while (end - p >= 4) {
+        size_t idx = discord_scan_find_pair(p, (size_t)(end - p), ':', '/');
+        if (idx == (size_t)(end - p)) {
+            break;
+        }
+        const char* colon = p + idx;
+        p = colon + 1;
+        if (colon == content || !is_word_byte((unsigned char)colon[-1]) || end - colon < 4 || colon[2] != '/') {
+            continue;
+        }
+
+        // The authority ends at the path, query or fragment; the host
+        // follows any userinfo ("https://discord.com@evil.example")
+        const char* host = colon + 3;
+        const char* authority_end = host;
+        while (authority_end < end && is_authority_byte((unsigned char)*authority_end)) {
+            if (*authority_end == '@') {
+                host = authority_end + 1;
+            }
+            authority_end++;
+        }
+        p = authority_end;
+
+        const char* host_end = host;
+        while (host_end < authority_end && *host_end != ':') {
+            host_end++;
+        }
+        while (host_end > host && host_end[-1] == '.') {
+            host_end--;
+        }
+        size_t host_length = (size_t)(host_end - host);
+        if (host_length == 0 || host_length > DISCORD_AUTOMOD_DOMAIN_MAX) {
+            continue;
+        }
+
+        char folded[DISCORD_AUTOMOD_DOMAIN_MAX];
+        for (size_t i = 0; i < host_length; i++) {
+            folded[i] = (char)fold((unsigned char)host[i]);
+        }
+
+        const char* label = folded;
+        const char* folded_end = folded + host_length;
+        while (label < folded_end) {
+            size_t length = (size_t)(folded_end - label);
+            uint32_t slot = automod_hash(label, length) & automod->domain_mask;
+            while (automod->domain_table[slot]) {
+                uint32_t index = automod->domain_table[slot] - 1;
+                const automod_rule_t* rule = &automod->rules[index];
+                if (rule->length == length && memcmp(rule->pattern, label, length) == 0) {
+                    for (;;) {
+                        if (add_match(scan, rule, (size_t)(host - content), host_length)) {
+                            return;
+                        }
+                        if (rule->next_same == AUTOMOD_NONE) {
+                            break;
+                        }
+                        rule = &automod->rules[rule->next_same];
+                    }
+                    break;
+                }
+                slot = (slot + 1) & automod->domain_mask;
+            }
+
+            const char* dot = memchr(label, '.', length);
+            if (!dot) {
+                break;
+            }
+            label = dot + 1;
+        }
+    }
+}
+
+static void automod_scan(discord_automod_t* automod, const char* content, size_t length,
+                         discord_automod_verdict_t* verdict) {
+    verdict->event = NULL;
+    verdict->content = content;
+    verdict->content_length = length;
+    verdict->action = DISCORD_AUTOMOD_FLAG;
+    verdict->match_count = 0;
+    verdict->user = automod->config.user;
+
+    automod_scan_t scan = { automod, content, length, SIZE_MAX, 0, 0, 0, verdict };
+    if (automod->keyword_count) {
+        scan_keywords(&scan);
+    }
+    if (automod->domain_count && verdict->match_count < DISCORD_AUTOMOD_MAX_MATCHES) {
+        scan_links(&scan);
+    }
+
+    __atomic_add_fetch(&automod->stats.messages, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&automod->stats.bytes, length, __ATOMIC_RELAXED);
+    if (scan.skipped) {
+        __atomic_add_fetch(&automod->stats.skipped_bytes, scan.skipped, __ATOMIC_RELAXED);
+    }
+    if (verdict->match_count) {
+        __atomic_add_fetch(&automod->stats.matched, 1, __ATOMIC_RELAXED);
+    }
+}
+
+discord_result_t discord_automod_scan(discord_automod_t* automod, const char* content, size_t length,
+                                      discord_automod_verdict_t* verdict) {
+    if (!automod || (!content && length) || !verdict || !automod->compiled) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    automod_scan(automod, content ? content : "", length, verdict);
+    return DISCORD_OK;
+}
+
+// Flip the epoch and wait for filters counted under the old parity
+static int drain_readers(uint64_t deadline) {
+    uint32_t parity = __atomic_fetch_add(&automod_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    while (__atomic_load_n(&automod_readers[parity], __ATOMIC_SEQ_CST) != 0) {
+        if (discord_time_now_ms() >= deadline) {
+            return 0;
+        }
+        discord_sleep_ms(1);
+    }
+    return 1;
+}
+
+discord_result_t discord_automod_install(discord_automod_t* automod, uint32_t timeout_ms,
+                                         discord_automod_t** previous) {
+    if (!previous || (automod && !automod->compiled)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    __atomic_store_n(&automod_used, 1, __ATOMIC_SEQ_CST);
+    *previous = __atomic_exchange_n(&active_automod, automod, __ATOMIC_SEQ_CST);
+
+    // Same two-phase drain as handler module swaps (dispatch.c)
+    uint64_t deadline = discord_time_now_ms() + timeout_ms;
+    if (!drain_readers(deadline) || !drain_readers(deadline)) {
+        return DISCORD_ERROR_TIMEOUT;
+    }
+    return DISCORD_OK;
+}
+
+int discord_automod_filter(const discord_event_t* event) {
+    if (!__atomic_load_n(&automod_used, __ATOMIC_ACQUIRE) || !event || !event->data || !event->event_type ||
+        strncmp(event->event_type, "MESSAGE_", 8) != 0) {
+        return 0;
+    }
+    int update = strcmp(event->event_type + 8, "UPDATE") == 0;
+    if (!update && strcmp(event->event_type + 8, "CREATE") != 0) {
+        return 0;
+    }
+
+    uint32_t readers = __atomic_load_n(&automod_epoch, __ATOMIC_SEQ_CST) & 1;
+    __atomic_add_fetch(&automod_readers[readers], 1, __ATOMIC_SEQ_CST);
+    discord_automod_t* automod = __atomic_load_n(&active_automod, __ATOMIC_SEQ_CST);
+    int blocked = 0;
+
+    if (automod && (!update || automod->config.scan_updates)) {
+        const char* cursor = event->data;
+        const char* end = event->data + event->data_length;
+        const char* key;
+        const char* value;
+        size_t key_length;
+        size_t value_length;
+
+        while (discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK) {
+            if (key_length == 7 && memcmp(key, "content", 7) == 0 && value_length >= 2 && value[0] == '"') {
+                discord_automod_verdict_t verdict;
+                automod_scan(automod, value + 1, value_length - 2, &verdict);
+                if (verdict.match_count) {
+                    verdict.event = event;
+                    if (automod->config.on_verdict) {
+                        automod->config.on_verdict(&verdict);
+                    }
+                    if (verdict.action == DISCORD_AUTOMOD_BLOCK) {
+                        __atomic_add_fetch(&automod->stats.blocked, 1, __ATOMIC_RELAXED);
+                        blocked = 1;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    __atomic_sub_fetch(&automod_readers[readers], 1, __ATOMIC_SEQ_CST);
+    return blocked;
+}
+
+discord_result_t discord_automod_get_stats(discord_automod_t* automod, discord_automod_stats_t* stats) {
+    if (!automod || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->messages = __atomic_load_n(&automod->stats.messages, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&automod->stats.bytes, __ATOMIC_RELAXED);
+    stats->matched = __atomic_load_n(&automod->stats.matched, __ATOMIC_RELAXED);
+    stats->blocked = __atomic_load_n(&automod->stats.blocked, __ATOMIC_RELAXED);
+    stats->skipped_bytes = __atomic_load_n(&automod->stats.skipped_bytes, __ATOMIC_RELAXED);
+    stats->keywords = automod->keyword_count;
+    stats->domains = automod->domain_count;
+    if (automod->compiled) {
+        stats->states = automod->state_count;
+        stats->classes = automod->keyword_count ? automod->class_count : 0;
+        stats->table_bytes = (size_t)automod->state_count * (automod->class_count + 1) * sizeof(uint32_t) +
+                             (size_t)automod->keyword_count * 2 * sizeof(uint32_t) +
+                             (automod->keyword_count ? sizeof(automod->prefixes) : 0) +
+                             (automod->domain_count ? ((size_t)automod->domain_mask + 1) * sizeof(uint32_t) : 0);
+        stats->word_skip = automod->word_skip;
+    }
+    return DISCORD_OK;
+}
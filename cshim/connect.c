@@ -0,0 +1,583 @@
+#ifdef __linux__
+    #define _GNU_SOURCE
+#endif
+
+#include "abi.h"
+#include "connect.h"
+#include "internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <errno.h>
+    #include <netdb.h>
+    #include <time.h>
+    #include <unistd.h>
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+#endif
+
+#if !defined(_WIN32) && !defined(SOCK_CLOEXEC)
+    #define SOCK_CLOEXEC 0
+#endif
+
+#if defined(__linux__) && !defined(TCP_FASTOPEN_CONNECT)
+    #define TCP_FASTOPEN_CONNECT 30
+#endif
+
+#define DNS_ADDRESSES_MAX   8
+#define DNS_RETRY_MS        1000        // Between lookups of a host whose last one failed
+
+static discord_connect_stats_t connect_stats;
+
+// -- URLs ------------------------------------------------------------------
+
+// ws[s]://host[:port][/path][?query]; host may be a bracketed IPv6 literal
+discord_result_t discord_url_parse(const char* url, discord_url_t* parsed) {
+    if (!url || !parsed) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    memset(parsed, 0, sizeof(*parsed));
+    if (strncmp(url, "wss://", 6) == 0) {
+        parsed->secure = 1;
+        parsed->default_port = 443;
+        url += 6;
+    } else if (strncmp(url, "ws://", 5) == 0) {
+        parsed->default_port = 80;
+        url += 5;
+    } else {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    size_t authority = strcspn(url, "/?#");
+    const char* end = url + authority;
+    const char* host = url;
+    const char* port = NULL;
+    size_t host_length;
+    if (*url == '[') {
+        const char* close = memchr(url, ']', authority);
+        if (!close || (close + 1 < end && close[1] != ':')) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+        host = url + 1;
+        host_length = (size_t)(close - host);
+        port = close + 1 < end ? close + 2 : NULL;
+    } else {
+        const char* colon = memchr(url, ':', authority);
+        host_length = colon ? (size_t)(colon - url) : authority;
+        port = colon ? colon + 1 : NULL;
+    }
+    if (host_length == 0 || host_length >= sizeof(parsed->host)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    memcpy(parsed->host, host, host_length);
+
+    parsed->port = parsed->default_port;
+    if (port) {
+        int value = 0;
+        if (port == end) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+        for (const char* p = port; p < end; p++) {
+            if (*p < '0' || *p > '9' || value > 65535) {
+                return DISCORD_ERROR_INVALID_PARAM;
+            }
+            value = value * 10 + (*p - '0');
+        }
+        if (value <= 0 || value > 65535) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+        parsed->port = value;
+    }
+
+    // The fragment never goes on the wire
+    size_t rest = strcspn(end, "#");
+    int slash = *end != '/';
+    if (rest + (size_t)slash >= sizeof(parsed->path)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    parsed->path[0] = '/';
+    memcpy(parsed->path + slash, end, rest);
+    return DISCORD_OK;
+}
+
+#ifndef _WIN32
+
+// -- DNS cache -------------------------------------------------------------
+// One entry per host. An entry being resolved is pinned (never evicted);
+// its lookup runs on a detached thread and callers that need the result
+// wait on dns.done. Addresses are stored with port 0.
+
+typedef struct {
+    char host[DISCORD_URL_HOST_MAX];
+    struct sockaddr_storage addresses[DNS_ADDRESSES_MAX];
+    socklen_t lengths[DNS_ADDRESSES_MAX];
+    uint32_t count;
+    uint64_t resolved_ms;           // When addresses were stored
+    uint64_t used_ms;               // Least recently used goes first
+    uint64_t retry_at_ms;           // After a failed lookup
+    int resolving;
+} dns_entry_t;
+
+typedef struct {
+    struct sockaddr_storage addresses[DNS_ADDRESSES_MAX];
+    socklen_t lengths[DNS_ADDRESSES_MAX];
+    uint32_t count;
+} dns_result_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    uint32_t ttl_ms;
+    uint32_t stale_ms;
+} dns = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, DISCORD_DNS_TTL_MS, DISCORD_DNS_STALE_MS };
+
+static dns_entry_t dns_entries[DISCORD_DNS_CACHE_MAX];
+
+static int dns_lookup(const char* host, int flags, dns_result_t* result) {
+    struct addrinfo hints;
+    struct addrinfo* addresses = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = flags;
+    result->count = 0;
+    if (getaddrinfo(host, NULL, &hints, &addresses) != 0) {
+        return -1;
+    }
+
+    for (struct addrinfo* a = addresses; a && result->count < DNS_ADDRESSES_MAX; a = a->ai_next) {
+        if (a->ai_addrlen <= sizeof(struct sockaddr_storage)) {
+            memcpy(&result->addresses[result->count], a->ai_addr, a->ai_addrlen);
+            result->lengths[result->count++] = (socklen_t)a->ai_addrlen;
+        }
+    }
+    freeaddrinfo(addresses);
+    return result->count > 0 ? 0 : -1;
+}
+
+static void* dns_resolve_main(void* arg) {
+    dns_entry_t* entry = arg;
+    char host[DISCORD_URL_HOST_MAX];
+    pthread_mutex_lock(&dns.lock);
+    memcpy(host, entry->host, sizeof(host));
+    pthread_mutex_unlock(&dns.lock);
+
+    dns_result_t result;
+    int failed = dns_lookup(host, 0, &result) != 0;
+
+    pthread_mutex_lock(&dns.lock);
+    connect_stats.lookups++;
+    uint64_t now = discord_time_now_ms();
+    if (failed) {
+        // Keep whatever the last good lookup returned
+        connect_stats.failures++;
+        entry->retry_at_ms = now + DNS_RETRY_MS;
+    } else {
+        memcpy(entry->addresses, result.addresses, sizeof(result.addresses));
+        memcpy(entry->lengths, result.lengths, sizeof(result.lengths));
+        entry->count = result.count;
+        entry->resolved_ms = now;
+        entry->retry_at_ms = 0;
+    }
+    entry->resolving = 0;
+    pthread_cond_broadcast(&dns.done);
+    pthread_mutex_unlock(&dns.lock);
+    return NULL;
+}
+
+// Caller holds dns.lock
+static void dns_start(dns_entry_t* entry) {
+    pthread_attr_t attributes;
+    pthread_t thread;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    entry->resolving = 1;
+    if (pthread_create(&thread, &attributes, dns_resolve_main, entry) != 0) {
+        entry->resolving = 0;
+        entry->retry_at_ms = discord_time_now_ms() + DNS_RETRY_MS;
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+// Caller holds dns.lock; NULL when every entry is being resolved
+static dns_entry_t* dns_entry(const char* host, uint64_t now) {
+    dns_entry_t* victim = NULL;
+    for (int i = 0; i < DISCORD_DNS_CACHE_MAX; i++) {
+        dns_entry_t* entry = &dns_entries[i];
+        if (strcmp(entry->host, host) == 0) {
+            entry->used_ms = now;
+            return entry;
+        }
+        // An empty entry, else the least recently used
+        if (!entry->resolving && (!victim || (victim->host[0] != '\0' &&
+                                              (entry->host[0] == '\0' || entry->used_ms < victim->used_ms)))) {
+            victim = entry;
+        }
+    }
+    if (victim) {
+        memset(victim, 0, sizeof(*victim));
+        snprintf(victim->host, sizeof(victim->host), "%s", host);
+        victim->used_ms = now;
+    }
+    return victim;
+}
+
+static void dns_copy(const dns_entry_t* entry, dns_result_t* result) {
+    memcpy(result->addresses, entry->addresses, sizeof(result->addresses));
+    memcpy(result->lengths, entry->lengths, sizeof(result->lengths));
+    result->count = entry->count;
+}
+
+// Fresh entries answer at once. Expired ones (or ones whose refresh
+// failed) still answer within the stale window, starting a refresh; past
+// it the caller waits up to timeout_ms for the lookup.
+static discord_result_t dns_resolve(const char* host, int timeout_ms, dns_result_t* result, int* cached) {
+    *cached = 0;
+    if (dns_lookup(host, AI_NUMERICHOST, result) == 0) {
+        *cached = 1;
+        return DISCORD_OK;
+    }
+
+    pthread_mutex_lock(&dns.lock);
+    uint64_t now = discord_time_now_ms();
+    dns_entry_t* entry = dns_entry(host, now);
+    if (!entry) {
+        pthread_mutex_unlock(&dns.lock);
+        int failed = dns_lookup(host, 0, result) != 0;
+        __atomic_add_fetch(&connect_stats.lookups, 1, __ATOMIC_RELAXED);
+        return failed ? DISCORD_ERROR_NETWORK : DISCORD_OK;
+    }
+
+    if (entry->count > 0) {
+        uint64_t age = now - entry->resolved_ms;
+        if (age < dns.ttl_ms) {
+            connect_stats.hits++;
+            dns_copy(entry, result);
+            *cached = 1;
+            pthread_mutex_unlock(&dns.lock);
+            return DISCORD_OK;
+        }
+        if (age < (uint64_t)dns.ttl_ms + dns.stale_ms || entry->retry_at_ms) {
+            connect_stats.stale_hits++;
+            if (!entry->resolving && now >= entry->retry_at_ms) {
+                dns_start(entry);
+            }
+            dns_copy(entry, result);
+            *cached = 1;
+            pthread_mutex_unlock(&dns.lock);
+            return DISCORD_OK;
+        }
+    }
+
+    if (entry->resolving) {
+        connect_stats.joined++;
+    } else {
+        dns_start(entry);
+    }
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeout_ms / 1000;
+    until.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    int timed_out = 0;
+    while (entry->resolving && strcmp(entry->host, host) == 0 && !timed_out) {
+        timed_out = pthread_cond_timedwait(&dns.done, &dns.lock, &until) == ETIMEDOUT;
+    }
+
+    discord_result_t status = DISCORD_OK;
+    if (strcmp(entry->host, host) == 0 && entry->count > 0) {
+        dns_copy(entry, result);
+    } else {
+        status = timed_out ? DISCORD_ERROR_TIMEOUT : DISCORD_ERROR_NETWORK;
+    }
+    pthread_mutex_unlock(&dns.lock);
+    return status;
+}
+
+discord_result_t discord_dns_configure(uint32_t ttl_ms, uint32_t stale_ms) {
+    pthread_mutex_lock(&dns.lock);
+    dns.ttl_ms = ttl_ms ? ttl_ms : DISCORD_DNS_TTL_MS;
+    dns.stale_ms = stale_ms ? stale_ms : DISCORD_DNS_STALE_MS;
+    pthread_mutex_unlock(&dns.lock);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_dns_prefetch(const char* host) {
+    if (!host || !*host || strlen(host) >= DISCORD_URL_HOST_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    dns_result_t numeric;
+    if (dns_lookup(host, AI_NUMERICHOST, &numeric) == 0) {
+        return DISCORD_OK;
+    }
+
+    pthread_mutex_lock(&dns.lock);
+    uint64_t now = discord_time_now_ms();
+    dns_entry_t* entry = dns_entry(host, now);
+    if (entry && !entry->resolving && now >= entry->retry_at_ms &&
+        (entry->count == 0 || now - entry->resolved_ms >= dns.ttl_ms)) {
+        dns_start(entry);
+    }
+    pthread_mutex_unlock(&dns.lock);
+    return entry ? DISCORD_OK : DISCORD_ERROR_MEMORY;
+}
+
+discord_result_t discord_dns_flush(void) {
+    pthread_mutex_lock(&dns.lock);
+    for (int i = 0; i < DISCORD_DNS_CACHE_MAX; i++) {
+        // A running lookup still owns its entry; it stores a fresh result
+        if (!dns_entries[i].resolving) {
+            memset(&dns_entries[i], 0, sizeof(dns_entries[i]));
+        }
+    }
+    pthread_mutex_unlock(&dns.lock);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_dns_resolve_numeric(const char* host, int timeout_ms, char* address, size_t size,
+                                             int* cached) {
+    if (!host || !address || !cached || strlen(host) >= DISCORD_URL_HOST_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    dns_result_t result;
+    discord_result_t status = dns_resolve(host, timeout_ms, &result, cached);
+    if (status != DISCORD_OK) {
+        return status;
+    }
+    if (getnameinfo((struct sockaddr*)&result.addresses[0], result.lengths[0], address, (socklen_t)size,
+                    NULL, 0, NI_NUMERICHOST) != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+    return DISCORD_OK;
+}
+
+// -- TCP -------------------------------------------------------------------
+
+int discord_connect_tcp(const char* host, int port, int fastopen, int timeout_s, discord_connect_timing_t* timing) {
+    uint64_t start = discord_time_now_ns();
+    dns_result_t result;
+    int cached = 0;
+    if (dns_resolve(host, timeout_s * 1000, &result, &cached) != DISCORD_OK) {
+        return -1;
+    }
+    uint64_t resolved = discord_time_now_ns();
+    timing->dns_ns = cached ? 0 : resolved - start;
+    timing->dns_cached = cached;
+
+    int fd = -1;
+    for (uint32_t i = 0; i < result.count && fd < 0; i++) {
+        struct sockaddr* address = (struct sockaddr*)&result.addresses[i];
+        if (address->sa_family == AF_INET) {
+            ((struct sockaddr_in*)address)->sin_port = htons((uint16_t)port);
+        } else if (address->sa_family == AF_INET6) {
+            ((struct sockaddr_in6*)address)->sin6_port = htons((uint16_t)port);
+        } else {
+            continue;
+        }
+
+        fd = socket(address->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            continue;
+        }
+        struct timeval timeout = { timeout_s, 0 };
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef TCP_FASTOPEN_CONNECT
+        // connect() returns at once; the SYN leaves with the first write
+        // (the ClientHello) and carries it when a cookie is cached
+        if (fastopen) {
+            setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &one, sizeof(one));
+        }
+#else
+        (void)fastopen;
+#endif
+        if (connect(fd, address, result.lengths[i]) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    timing->tcp_ns = discord_time_now_ns() - resolved;
+    return fd;
+}
+
+int discord_connect_syn_data(int fd) {
+#if defined(TCP_INFO) && defined(TCPI_OPT_SYN_DATA)
+    struct tcp_info info;
+    socklen_t length = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) == 0) {
+        return (info.tcpi_options & TCPI_OPT_SYN_DATA) != 0;
+    }
+#else
+    (void)fd;
+#endif
+    return 0;
+}
+
+#else
+
+discord_result_t discord_dns_configure(uint32_t ttl_ms, uint32_t stale_ms) {
+    (void)ttl_ms; (void)stale_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_dns_prefetch(const char* host) {
+    (void)host;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_dns_flush(void) {
+    return DISCORD_OK;
+}
+
+discord_result_t discord_dns_resolve_numeric(const char* host, int timeout_ms, char* address, size_t size,
+                                             int* cached) {
+    (void)host; (void)timeout_ms; (void)address; (void)size; (void)cached;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+#endif
+
+// -- Standby connections -----------------------------------------------------
+
+struct discord_ws_standby {
+    char* url;
+    discord_ws_options_t options;
+    int has_options;
+    discord_gateway_t* gateway;
+    discord_result_t result;
+    uint64_t opened_ms;
+#ifndef _WIN32
+    pthread_t thread;
+    int threaded;
+#endif
+};
+
+static void* standby_main(void* arg) {
+    discord_ws_standby_t* standby = arg;
+    standby->result = discord_ws_connect_ex(standby->url, standby->has_options ? &standby->options : NULL,
+                                            &standby->gateway);
+    return NULL;
+}
+
+static void standby_wait(discord_ws_standby_t* standby) {
+#ifndef _WIN32
+    if (standby->threaded) {
+        pthread_join(standby->thread, NULL);
+        standby->threaded = 0;
+    }
+#else
+    (void)standby;
+#endif
+}
+
+discord_result_t discord_ws_prewarm(const char* url, const discord_ws_options_t* options,
+                                    discord_ws_standby_t** standby) {
+    // The simulator takes its own sim:// URLs
+    discord_url_t parsed;
+    if (!url || !standby || (discord_ws_select_transport(options) != DISCORD_WS_TRANSPORT_SIM &&
+                             discord_url_parse(url, &parsed) != DISCORD_OK)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_ws_standby_t* s = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_ws_standby_t));
+    size_t length = strlen(url);
+    if (!s || !(s->url = discord_mem_alloc(DISCORD_MEM_OTHER, length + 1))) {
+        discord_mem_free(s);
+        return DISCORD_ERROR_MEMORY;
+    }
+    memcpy(s->url, url, length + 1);
+    if (options) {
+        s->options = *options;
+        s->has_options = 1;
+    }
+    s->opened_ms = discord_time_now_ms();
+    __atomic_add_fetch(&connect_stats.standbys_opened, 1, __ATOMIC_RELAXED);
+
+#ifndef _WIN32
+    if (discord_ws_select_transport(options) == DISCORD_WS_TRANSPORT_URING &&
+        pthread_create(&s->thread, NULL, standby_main, s) == 0) {
+        s->threaded = 1;
+        *standby = s;
+        return DISCORD_OK;
+    }
+#endif
+
+    standby_main(s);
+    *standby = s;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_ws_standby_take(discord_ws_standby_t* standby, discord_gateway_t** gateway) {
+    if (!standby || !gateway) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    standby_wait(standby);
+    discord_result_t result = standby->result;
+    if (result == DISCORD_OK && discord_time_now_ms() - standby->opened_ms > DISCORD_WS_STANDBY_MAX_AGE_MS) {
+        discord_ws_close(standby->gateway);
+        __atomic_add_fetch(&connect_stats.standbys_expired, 1, __ATOMIC_RELAXED);
+        result = DISCORD_ERROR_TIMEOUT;
+    } else if (result == DISCORD_OK) {
+        standby->gateway->timing.prewarmed = 1;
+        *gateway = standby->gateway;
+        __atomic_add_fetch(&connect_stats.standbys_used, 1, __ATOMIC_RELAXED);
+    }
+
+    discord_mem_free(standby->url);
+    discord_mem_free(standby);
+    return result;
+}
+
+void discord_ws_standby_close(discord_ws_standby_t* standby) {
+    if (!standby) {
+        return;
+    }
+    standby_wait(standby);
+    if (standby->result == DISCORD_OK) {
+        discord_ws_close(standby->gateway);
+        __atomic_add_fetch(&connect_stats.standbys_expired, 1, __ATOMIC_RELAXED);
+    }
+    discord_mem_free(standby->url);
+    discord_mem_free(standby);
+}
+
+discord_result_t discord_ws_get_connect_timing(discord_gateway_t* gateway, discord_connect_timing_t* timing) {
+    if (!gateway || !timing) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    *timing = gateway->timing;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_connect_get_stats(discord_connect_stats_t* stats) {
+    if (!stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+#ifndef _WIN32
+    pthread_mutex_lock(&dns.lock);
+#endif
+    *stats = connect_stats;
+    stats->entries = 0;
+#ifndef _WIN32
+    for (int i = 0; i < DISCORD_DNS_CACHE_MAX; i++) {
+        stats->entries += dns_entries[i].host[0] != '\0';
+    }
+    pthread_mutex_unlock(&dns.lock);
+#endif
+    return DISCORD_OK;
+}
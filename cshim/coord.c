@@ -0,0 +1,989 @@
+#include "abi.h"
+#include "coord.h"
+#include "shard.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Shard coordinator
+// Both ends exchange fixed 16-byte records over a stream socket, in native
+// byte order since they share a host. A client says HELLO and gets CONFIG
+// back; assignments arrive as ASSIGN followed by its RANGE records. An
+// ACQUIRE is answered with GRANT (how long to wait) or DENY before the
+// client sends anything else, so a client never has two replies pending.
+//
+// The server keeps, per shard, its owner and the process it is moving to
+// (pending). Processes are identified by join order, never reused. An
+// owner is only told about shards it owns and that are not moving away;
+// when it confirms that assignment, its moving shards go to their new
+// owners. Server sockets are non-blocking and a process that stops
+// reading (its socket buffer full) is disconnected like one that died.
+
+#define COORD_NONE          UINT32_MAX
+#define COORD_BUFFER        4096
+
+#ifdef MSG_NOSIGNAL
+    #define COORD_SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define COORD_SEND_FLAGS 0
+#endif
+
+enum {
+    COORD_HELLO = 1,                // Client: value = pid
+    COORD_ACQUIRE,                  // Client: shard
+    COORD_READY,                    // Client: shard
+    COORD_CONFIRM,                  // Client: value = assignment version applied
+    COORD_CONFIG,                   // Server: shard = shard count, value = max_concurrency
+    COORD_ASSIGN,                   // Server: shard = RANGE records that follow, value = version
+    COORD_RANGE,                    // Server: shard = first, value = count
+    COORD_GRANT,                    // Server: shard, value = ms to wait
+    COORD_DENY                      // Server: shard
+};
+
+typedef struct {
+    uint32_t type;
+    uint32_t shard;
+    uint64_t value;
+} coord_message_t;
+
+typedef struct {
+    int fd;
+    size_t used;
+    uint8_t data[COORD_BUFFER];
+} coord_reader_t;
+
+static void coord_no_sigpipe(int fd) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)fd;
+#endif
+}
+
+// 0 when everything was sent; a non-blocking socket that fills up fails
+static int coord_send(int fd, const coord_message_t* messages, size_t count) {
+    const char* p = (const char*)messages;
+    size_t left = count * sizeof(coord_message_t);
+    while (left) {
+        ssize_t n = send(fd, p, left, COORD_SEND_FLAGS);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    return 0;
+}
+
+static int coord_send_one(int fd, uint32_t type, uint32_t shard, uint64_t value) {
+    coord_message_t message = { type, shard, value };
+    return coord_send(fd, &message, 1);
+}
+
+// Read what is available: 1 if anything came, 0 if nothing did within
+// timeout_ms, -1 when the peer closed or failed
+static int coord_read(coord_reader_t* reader, int timeout_ms) {
+    if (timeout_ms != 0) {
+        struct pollfd pfd = { reader->fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR) {
+            return 0;
+        }
+        if (ready <= 0) {
+            return ready;
+        }
+    }
+    ssize_t n = recv(reader->fd, reader->data + reader->used, sizeof(reader->data) - reader->used, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    if (n <= 0) {
+        return -1;
+    }
+    reader->used += (size_t)n;
+    return 1;
+}
+
+// Take the next complete record out of the buffer
+static int coord_next(coord_reader_t* reader, size_t* offset, coord_message_t* message) {
+    if (reader->used - *offset < sizeof(coord_message_t)) {
+        memmove(reader->data, reader->data + *offset, reader->used - *offset);
+        reader->used -= *offset;
+        *offset = 0;
+        return 0;
+    }
+    memcpy(message, reader->data + *offset, sizeof(coord_message_t));
+    *offset += sizeof(coord_message_t);
+    return 1;
+}
+
+static discord_result_t coord_address(const char* path, struct sockaddr_un* address) {
+    if (!path || strlen(path) >= sizeof(address->sun_path)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    memcpy(address->sun_path, path, strlen(path) + 1);
+    return DISCORD_OK;
+}
+
+// Server
+
+typedef struct {
+    coord_reader_t reader;
+    uint32_t id;                    // Join order
+    int hello;                      // Counted as a process (HELLO received)
+    int dead;                       // Closed or failed; removed at the end of the poll
+    int dirty;                      // Its assignment changed since it was last sent
+    uint64_t version;               // Of the last assignment sent
+} coord_peer_t;
+
+struct discord_coord_server {
+    discord_coord_server_config_t config;
+    char* path;
+    int listener;
+    coord_peer_t** peers;           // Join order
+    uint32_t peer_count;
+    uint32_t peer_capacity;
+    struct pollfd* pollfds;
+    uint32_t next_id;
+    uint64_t version;
+    int started;                    // First assignment made
+    uint32_t* owner;                // Peer id per shard, COORD_NONE = unassigned
+    uint32_t* pending;              // Peer id the shard moves to once its owner confirms
+    uint8_t* ready;
+    uint32_t* surplus;              // Rebalance scratch
+    uint64_t* bucket_next_ms;       // Next free IDENTIFY slot per bucket
+    discord_coord_server_stats_t stats;
+};
+
+static coord_peer_t* server_peer(discord_coord_server_t* server, uint32_t id) {
+    for (uint32_t i = 0; i < server->peer_count; i++) {
+        if (server->peers[i]->id == id) {
+            return server->peers[i];
+        }
+    }
+    return NULL;
+}
+
+static void server_unready(discord_coord_server_t* server, uint32_t shard) {
+    if (server->ready[shard]) {
+        server->ready[shard] = 0;
+        server->stats.shards_ready--;
+        server->stats.all_ready_ms = 0;
+    }
+}
+
+static void server_mark(discord_coord_server_t* server, uint32_t id) {
+    coord_peer_t* peer = id == COORD_NONE ? NULL : server_peer(server, id);
+    if (peer) {
+        peer->dirty = 1;
+    }
+}
+
+// Send each changed peer the shards it owns that are not moving away
+static void server_flush(discord_coord_server_t* server) {
+    uint32_t count = server->config.shard_count;
+    for (uint32_t i = 0; i < server->peer_count; i++) {
+        coord_peer_t* peer = server->peers[i];
+        if (!peer->dirty || peer->dead) {
+            continue;
+        }
+        peer->dirty = 0;
+
+        coord_message_t messages[COORD_BUFFER / sizeof(coord_message_t)];
+        uint32_t ranges = 0;
+        int failed = 0;
+        server->version++;
+        for (uint32_t shard = 0; shard < count; shard++) {
+            if (server->owner[shard] != peer->id || server->pending[shard] != COORD_NONE) {
+                continue;
+            }
+            while (shard + 1 < count && server->owner[shard + 1] == peer->id &&
+                   server->pending[shard + 1] == COORD_NONE) {
+                shard++;
+            }
+            ranges++;
+        }
+
+        uint32_t n = 0;
+        messages[n++] = (coord_message_t){ COORD_ASSIGN, ranges, server->version };
+        for (uint32_t shard = 0; shard < count && !failed; shard++) {
+            if (server->owner[shard] != peer->id || server->pending[shard] != COORD_NONE) {
+                continue;
+            }
+            uint32_t first = shard;
+            while (shard + 1 < count && server->owner[shard + 1] == peer->id &&
+                   server->pending[shard + 1] == COORD_NONE) {
+                shard++;
+            }
+            messages[n++] = (coord_message_t){ COORD_RANGE, first, shard - first + 1 };
+            if (n == sizeof(messages) / sizeof(messages[0])) {
+                failed = coord_send(peer->reader.fd, messages, n) != 0;
+                n = 0;
+            }
+        }
+        if (failed || coord_send(peer->reader.fd, messages, n) != 0) {
+            peer->dead = 1;
+            continue;
+        }
+        peer->version = server->version;
+        server->stats.assignments++;
+    }
+}
+
+// Even out the shards over the processes in join order: the first
+// shard_count % processes get one more. A process above its share gives up
+// its highest shards; shards without an owner and those given up go, in
+// order, to the processes below theirs.
+static void server_rebalance(discord_coord_server_t* server) {
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < server->peer_count; i++) {
+        live += server->peers[i]->hello && !server->peers[i]->dead;
+    }
+    uint32_t wanted = server->config.processes ? server->config.processes : 1;
+    if (live == 0 || (!server->started && live < wanted)) {
+        return;
+    }
+    if (!server->started) {
+        server->started = 1;
+        server->stats.assigned_ms = discord_time_now_ms();
+    }
+
+    uint32_t count = server->config.shard_count;
+    uint32_t base = count / live;
+    uint32_t extra = count % live;
+
+    // Where each shard is headed: its pending owner, else its owner
+    uint32_t pool = 0;
+    uint32_t rank = 0;
+    for (uint32_t i = 0; i < server->peer_count; i++) {
+        coord_peer_t* peer = server->peers[i];
+        if (!peer->hello || peer->dead) {
+            continue;
+        }
+        uint32_t share = base + (rank++ < extra);
+        uint32_t held = 0;
+        for (uint32_t shard = 0; shard < count; shard++) {
+            uint32_t to = server->pending[shard] != COORD_NONE ? server->pending[shard] : server->owner[shard];
+            held += to == peer->id;
+        }
+        for (uint32_t shard = count; shard-- > 0 && held > share;) {
+            uint32_t to = server->pending[shard] != COORD_NONE ? server->pending[shard] : server->owner[shard];
+            if (to == peer->id) {
+                server->surplus[pool++] = shard;
+                held--;
+            }
+        }
+    }
+    for (uint32_t shard = 0; shard < count; shard++) {
+        if (server->owner[shard] == COORD_NONE) {
+            server->surplus[pool++] = shard;
+        }
+    }
+    if (pool == 0) {
+        return;
+    }
+
+    // Lowest shards first, so ranges stay contiguous where they can
+    for (uint32_t i = 1; i < pool; i++) {
+        uint32_t shard = server->surplus[i];
+        uint32_t j = i;
+        for (; j > 0 && server->surplus[j - 1] > shard; j--) {
+            server->surplus[j] = server->surplus[j - 1];
+        }
+        server->surplus[j] = shard;
+    }
+
+    uint32_t next = 0;
+    rank = 0;
+    for (uint32_t i = 0; i < server->peer_count && next < pool; i++) {
+        coord_peer_t* peer = server->peers[i];
+        if (!peer->hello || peer->dead) {
+            continue;
+        }
+        uint32_t share = base + (rank++ < extra);
+        uint32_t held = 0;
+        for (uint32_t shard = 0; shard < count; shard++) {
+            uint32_t to = server->pending[shard] != COORD_NONE ? server->pending[shard] : server->owner[shard];
+            held += to == peer->id;
+        }
+        // Surplus shards of this peer were counted; they are about to be
+        // handed out (possibly back to it)
+        for (uint32_t k = next; k < pool; k++) {
+            uint32_t shard = server->surplus[k];
+            uint32_t to = server->pending[shard] != COORD_NONE ? server->pending[shard] : server->owner[shard];
+            held -= to == peer->id;
+        }
+        for (; held < share && next < pool; held++) {
+            uint32_t shard = server->surplus[next++];
+            uint32_t owner = server->owner[shard];
+            server_unready(server, shard);
+            if (owner == COORD_NONE || owner == peer->id) {
+                server->owner[shard] = peer->id;
+                server->pending[shard] = COORD_NONE;
+                peer->dirty = 1;
+            } else {
+                // Once the owner has stopped it
+                server->pending[shard] = peer->id;
+                server_mark(server, owner);
+            }
+        }
+    }
+}
+
+static void server_confirm(discord_coord_server_t* server, coord_peer_t* peer, uint64_t version) {
+    if (version != peer->version) {
+        return;                     // A later assignment is on its way
+    }
+    for (uint32_t shard = 0; shard < server->config.shard_count; shard++) {
+        if (server->owner[shard] == peer->id && server->pending[shard] != COORD_NONE) {
+            server->owner[shard] = server->pending[shard];
+            server->pending[shard] = COORD_NONE;
+            server_mark(server, server->owner[shard]);
+            server->stats.shards_moved++;
+        }
+    }
+}
+
+static void server_acquire(discord_coord_server_t* server, coord_peer_t* peer, uint32_t shard) {
+    if (shard >= server->config.shard_count || server->owner[shard] != peer->id ||
+        server->pending[shard] != COORD_NONE) {
+        server->stats.denied++;
+        if (coord_send_one(peer->reader.fd, COORD_DENY, shard, 0) != 0) {
+            peer->dead = 1;
+        }
+        return;
+    }
+
+    uint64_t now = discord_time_now_ms();
+    uint64_t* slot = &server->bucket_next_ms[shard % server->config.max_concurrency];
+    uint64_t at = *slot > now ? *slot : now;
+    *slot = at + server->config.window_ms;
+    server->stats.grants++;
+    server->stats.grants_delayed += at > now;
+    server_unready(server, shard);
+    if (coord_send_one(peer->reader.fd, COORD_GRANT, shard, at - now) != 0) {
+        peer->dead = 1;
+    }
+}
+
+static void server_handle(discord_coord_server_t* server, coord_peer_t* peer, const coord_message_t* message) {
+    uint32_t count = server->config.shard_count;
+    switch (message->type) {
+        case COORD_HELLO:
+            if (!peer->hello) {
+                peer->hello = 1;
+                server->stats.joins++;
+                if (coord_send_one(peer->reader.fd, COORD_CONFIG, count, server->config.max_concurrency) != 0) {
+                    peer->dead = 1;
+                    break;
+                }
+                server_rebalance(server);
+            }
+            break;
+
+        case COORD_ACQUIRE:
+            server_acquire(server, peer, message->shard);
+            break;
+
+        case COORD_READY:
+            if (message->shard < count && server->owner[message->shard] == peer->id &&
+                !server->ready[message->shard]) {
+                server->ready[message->shard] = 1;
+                if (++server->stats.shards_ready == count) {
+                    server->stats.all_ready_ms = discord_time_now_ms();
+                }
+            }
+            break;
+
+        case COORD_CONFIRM:
+            server_confirm(server, peer, message->value);
+            break;
+
+        default:
+            peer->dead = 1;         // Not speaking this protocol
+            break;
+    }
+}
+
+// Shards of a process that left: those it was handing on go to their new
+// owner, the rest to whoever the next rebalance picks
+static void server_remove(discord_coord_server_t* server, uint32_t index) {
+    coord_peer_t* peer = server->peers[index];
+    for (uint32_t shard = 0; shard < server->config.shard_count; shard++) {
+        if (server->owner[shard] == peer->id) {
+            server_unready(server, shard);
+            server->owner[shard] = server->pending[shard];
+            server->pending[shard] = COORD_NONE;
+            server_mark(server, server->owner[shard]);
+            server->stats.shards_moved++;
+        } else if (server->pending[shard] == peer->id) {
+            // Back to the owner, which was told to stop it
+            server->pending[shard] = COORD_NONE;
+            server_mark(server, server->owner[shard]);
+        }
+    }
+    if (peer->hello) {
+        server->stats.leaves++;
+    }
+    close(peer->reader.fd);
+    discord_mem_free(peer);
+    memmove(&server->peers[index], &server->peers[index + 1],
+            (server->peer_count - index - 1) * sizeof(coord_peer_t*));
+    server->peer_count--;
+}
+
+static void server_accept(discord_coord_server_t* server) {
+    for (;;) {
+        int fd = accept(server->listener, NULL, NULL);
+        if (fd < 0) {
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        coord_no_sigpipe(fd);
+
+        if (server->peer_count == server->peer_capacity) {
+            uint32_t capacity = server->peer_capacity ? server->peer_capacity * 2 : 16;
+            coord_peer_t** peers = discord_mem_realloc(DISCORD_MEM_OTHER, server->peers,
+                                                       capacity * sizeof(coord_peer_t*));
+            struct pollfd* pollfds = peers ? discord_mem_realloc(DISCORD_MEM_OTHER, server->pollfds,
+                                                                 (capacity + 1) * sizeof(struct pollfd)) : NULL;
+            if (peers) {
+                server->peers = peers;
+            }
+            if (!pollfds) {
+                close(fd);
+                return;
+            }
+            server->pollfds = pollfds;
+            server->peer_capacity = capacity;
+        }
+        coord_peer_t* peer = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(coord_peer_t));
+        if (!peer) {
+            close(fd);
+            return;
+        }
+        peer->reader.fd = fd;
+        peer->id = server->next_id++;
+        server->peers[server->peer_count++] = peer;
+    }
+}
+
+discord_result_t discord_coord_server_create(const discord_coord_server_config_t* config,
+                                             discord_coord_server_t** server) {
+    struct sockaddr_un address;
+    if (!config || !server || config->shard_count == 0 || coord_address(config->path, &address) != DISCORD_OK) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_coord_server_t* s = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_coord_server_t));
+    if (!s) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    s->listener = -1;
+    s->config = *config;
+    if (s->config.max_concurrency == 0) {
+        s->config.max_concurrency = 1;
+    }
+    if (s->config.window_ms == 0) {
+        s->config.window_ms = DISCORD_IDENTIFY_WINDOW_MS;
+    }
+
+    uint32_t count = config->shard_count;
+    size_t path_length = strlen(config->path);
+    s->path = discord_mem_alloc(DISCORD_MEM_OTHER, path_length + 1);
+    s->owner = discord_mem_alloc(DISCORD_MEM_OTHER, count * sizeof(uint32_t));
+    s->pending = discord_mem_alloc(DISCORD_MEM_OTHER, count * sizeof(uint32_t));
+    s->ready = discord_mem_calloc(DISCORD_MEM_OTHER, count, 1);
+    s->surplus = discord_mem_alloc(DISCORD_MEM_OTHER, count * sizeof(uint32_t));
+    s->bucket_next_ms = discord_mem_calloc(DISCORD_MEM_OTHER, s->config.max_concurrency, sizeof(uint64_t));
+    s->pollfds = discord_mem_alloc(DISCORD_MEM_OTHER, sizeof(struct pollfd));
+    if (!s->path || !s->owner || !s->pending || !s->ready || !s->surplus || !s->bucket_next_ms || !s->pollfds) {
+        discord_coord_server_destroy(s);
+        return DISCORD_ERROR_MEMORY;
+    }
+    memcpy(s->path, config->path, path_length + 1);
+    s->config.path = s->path;
+    for (uint32_t shard = 0; shard < count; shard++) {
+        s->owner[shard] = COORD_NONE;
+        s->pending[shard] = COORD_NONE;
+    }
+
+    unlink(config->path);
+    s->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s->listener < 0 || bind(s->listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(s->listener, 128) != 0) {
+        discord_coord_server_destroy(s);
+        return DISCORD_ERROR_NETWORK;
+    }
+    fcntl(s->listener, F_SETFL, fcntl(s->listener, F_GETFL) | O_NONBLOCK);
+    fcntl(s->listener, F_SETFD, FD_CLOEXEC);
+
+    *server = s;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_coord_server_poll(discord_coord_server_t* server, int timeout_ms) {
+    if (!server) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t polled = server->peer_count;
+    server->pollfds[0] = (struct pollfd){ server->listener, POLLIN, 0 };
+    for (uint32_t i = 0; i < polled; i++) {
+        server->pollfds[i + 1] = (struct pollfd){ server->peers[i]->reader.fd, POLLIN, 0 };
+    }
+    int ready = poll(server->pollfds, polled + 1, timeout_ms);
+    if (ready < 0) {
+        return errno == EINTR ? DISCORD_OK : DISCORD_ERROR_NETWORK;
+    }
+
+    // Peers only move when removed, after this loop
+    for (uint32_t i = 0; i < polled && ready > 0; i++) {
+        coord_peer_t* peer = server->peers[i];
+        if (!server->pollfds[i + 1].revents || peer->dead) {
+            continue;
+        }
+        ready--;
+        int result;
+        while ((result = coord_read(&peer->reader, 0)) > 0) {
+            size_t offset = 0;
+            coord_message_t message;
+            while (!peer->dead && coord_next(&peer->reader, &offset, &message)) {
+                server_handle(server, peer, &message);
+            }
+            server_flush(server);
+            if (peer->dead) {
+                break;
+            }
+        }
+        if (result < 0) {
+            peer->dead = 1;
+        }
+    }
+    if (server->pollfds[0].revents) {
+        server_accept(server);
+    }
+
+    // Removing a peer can fail sends to others; repeat until settled
+    for (;;) {
+        int removed = 0;
+        for (uint32_t i = server->peer_count; i-- > 0;) {
+            if (server->peers[i]->dead) {
+                server_remove(server, i);
+                removed = 1;
+            }
+        }
+        if (!removed) {
+            break;
+        }
+        server_rebalance(server);
+        server_flush(server);
+    }
+    return DISCORD_OK;
+}
+
+discord_result_t discord_coord_server_get_stats(const discord_coord_server_t* server,
+                                                discord_coord_server_stats_t* stats) {
+    if (!server || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    *stats = server->stats;
+    stats->processes = 0;
+    for (uint32_t i = 0; i < server->peer_count; i++) {
+        stats->processes += server->peers[i]->hello;
+    }
+    stats->shards_assigned = 0;
+    for (uint32_t shard = 0; shard < server->config.shard_count; shard++) {
+        stats->shards_assigned += server->owner[shard] != COORD_NONE && server->pending[shard] == COORD_NONE;
+    }
+    return DISCORD_OK;
+}
+
+void discord_coord_server_destroy(discord_coord_server_t* server) {
+    if (!server) {
+        return;
+    }
+    for (uint32_t i = 0; i < server->peer_count; i++) {
+        close(server->peers[i]->reader.fd);
+        discord_mem_free(server->peers[i]);
+    }
+    if (server->listener >= 0) {
+        close(server->listener);
+        unlink(server->path);
+    }
+    discord_mem_free(server->peers);
+    discord_mem_free(server->pollfds);
+    discord_mem_free(server->path);
+    discord_mem_free(server->owner);
+    discord_mem_free(server->pending);
+    discord_mem_free(server->ready);
+    discord_mem_free(server->surplus);
+    discord_mem_free(server->bucket_next_ms);
+    discord_mem_free(server);
+}
+
+// Client
+
+struct discord_coord {
+    coord_reader_t reader;
+    int closed;                     // The coordinator went away
+    uint32_t shard_count;
+    uint32_t max_concurrency;
+    uint8_t* owned;
+    uint8_t* incoming;              // The assignment being received
+    uint32_t owned_count;
+    uint32_t ranges_left;           // RANGE records still to come
+    uint64_t incoming_version;
+    uint64_t server_version;        // Of the owned set, confirmed with it
+    uint64_t version;               // Assignments applied
+    int changed;                    // Not reported by discord_coord_poll yet
+    int configured;
+    int replied;                    // The GRANT/DENY of the acquire in flight
+    coord_message_t reply;
+};
+
+static discord_coord_t* attached_coord = NULL;
+static int attached_shard = 0;
+static int attached_count = 0;
+
+static void client_apply(discord_coord_t* coord) {
+    memcpy(coord->owned, coord->incoming, coord->shard_count);
+    coord->owned_count = 0;
+    for (uint32_t shard = 0; shard < coord->shard_count; shard++) {
+        coord->owned_count += coord->owned[shard];
+    }
+    coord->server_version = coord->incoming_version;
+    coord->version++;
+    coord->changed = 1;
+}
+
+static void client_handle(discord_coord_t* coord, const coord_message_t* message) {
+    switch (message->type) {
+        case COORD_CONFIG:
+            if (!coord->configured && message->shard > 0) {
+                coord->owned = discord_mem_calloc(DISCORD_MEM_OTHER, message->shard, 1);
+                coord->incoming = discord_mem_calloc(DISCORD_MEM_OTHER, message->shard, 1);
+                if (coord->owned && coord->incoming) {
+                    coord->shard_count = message->shard;
+                    coord->max_concurrency = (uint32_t)message->value;
+                    coord->configured = 1;
+                }
+            }
+            break;
+
+        case COORD_ASSIGN:
+            if (coord->configured) {
+                memset(coord->incoming, 0, coord->shard_count);
+                coord->ranges_left = message->shard;
+                coord->incoming_version = message->value;
+                if (coord->ranges_left == 0) {
+                    client_apply(coord);
+                }
+            }
+            break;
+
+        case COORD_RANGE:
+            if (coord->configured && coord->ranges_left) {
+                for (uint64_t i = 0; i < message->value && message->shard + i < coord->shard_count; i++) {
+                    coord->incoming[message->shard + i] = 1;
+                }
+                if (--coord->ranges_left == 0) {
+                    client_apply(coord);
+                }
+            }
+            break;
+
+        case COORD_GRANT:
+        case COORD_DENY:
+            coord->replied = 1;
+            coord->reply = *message;
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Read and handle what arrives within timeout_ms; returns as coord_read
+static int client_read(discord_coord_t* coord, int timeout_ms) {
+    if (coord->closed) {
+        return -1;
+    }
+    int result = coord_read(&coord->reader, timeout_ms);
+    if (result < 0) {
+        coord->closed = 1;
+        return -1;
+    }
+    size_t offset = 0;
+    coord_message_t message;
+    while (coord_next(&coord->reader, &offset, &message)) {
+        client_handle(coord, &message);
+    }
+    return result;
+}
+
+static int client_send(discord_coord_t* coord, uint32_t type, uint32_t shard, uint64_t value) {
+    if (coord->closed || coord_send_one(coord->reader.fd, type, shard, value) != 0) {
+        coord->closed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+discord_result_t discord_coord_connect(const char* path, discord_coord_t** coord) {
+    struct sockaddr_un address;
+    if (!coord || coord_address(path, &address) != DISCORD_OK) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_coord_t* c = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_coord_t));
+    if (!c) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    c->reader.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (c->reader.fd < 0) {
+        discord_mem_free(c);
+        return DISCORD_ERROR_NETWORK;
+    }
+    fcntl(c->reader.fd, F_SETFD, FD_CLOEXEC);
+    coord_no_sigpipe(c->reader.fd);
+    if (connect(c->reader.fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        client_send(c, COORD_HELLO, 0, (uint64_t)getpid()) != 0) {
+        discord_coord_close(c);
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    while (!c->configured) {
+        if (client_read(c, DISCORD_COORD_TIMEOUT_MS) <= 0) {
+            discord_coord_close(c);
+            return DISCORD_ERROR_NETWORK;
+        }
+    }
+    *coord = c;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_coord_poll(discord_coord_t* coord, int timeout_ms) {
+    if (!coord) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    int result = 0;
+    if (!coord->changed) {
+        result = client_read(coord, timeout_ms);
+    }
+    while (result > 0) {
+        result = client_read(coord, 0);
+    }
+    if (coord->changed) {
+        coord->changed = 0;
+        return DISCORD_OK;
+    }
+    return result < 0 ? DISCORD_ERROR_NETWORK : DISCORD_ERROR_TIMEOUT;
+}
+
+discord_result_t discord_coord_get_assignment(const discord_coord_t* coord, discord_coord_assignment_t* assignment) {
+    if (!coord || !assignment) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    assignment->shard_count = coord->shard_count;
+    assignment->max_concurrency = coord->max_concurrency;
+    assignment->owned = coord->owned_count;
+    assignment->version = coord->version;
+    return DISCORD_OK;
+}
+
+int discord_coord_owns(const discord_coord_t* coord, int shard_id) {
+    return coord && shard_id >= 0 && (uint32_t)shard_id < coord->shard_count && coord->owned[shard_id];
+}
+
+discord_result_t discord_coord_confirm(discord_coord_t* coord) {
+    if (!coord) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    return client_send(coord, COORD_CONFIRM, 0, coord->server_version) == 0 ? DISCORD_OK : DISCORD_ERROR_NETWORK;
+}
+
+discord_result_t discord_coord_acquire(discord_coord_t* coord, int shard_id, uint64_t now_ms, uint64_t* retry_at_ms) {
+    if (!coord || shard_id < 0 || !retry_at_ms) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    coord->replied = 0;
+    if (client_send(coord, COORD_ACQUIRE, (uint32_t)shard_id, 0) != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+    // Assignments that arrive meanwhile are kept for discord_coord_poll
+    while (!coord->replied) {
+        if (client_read(coord, DISCORD_COORD_TIMEOUT_MS) <= 0) {
+            return DISCORD_ERROR_NETWORK;
+        }
+    }
+    if (coord->reply.type == COORD_DENY) {
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+    *retry_at_ms = now_ms + coord->reply.value;
+    return coord->reply.value ? DISCORD_ERROR_TIMEOUT : DISCORD_OK;
+}
+
+discord_result_t discord_coord_report_ready(discord_coord_t* coord, int shard_id) {
+    if (!coord || shard_id < 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    return client_send(coord, COORD_READY, (uint32_t)shard_id, 0) == 0 ? DISCORD_OK : DISCORD_ERROR_NETWORK;
+}
+
+void discord_coord_close(discord_coord_t* coord) {
+    if (!coord) {
+        return;
+    }
+    if (attached_coord == coord) {
+        attached_coord = NULL;
+    }
+    close(coord->reader.fd);
+    discord_mem_free(coord->owned);
+    discord_mem_free(coord->incoming);
+    discord_mem_free(coord);
+}
+
+discord_result_t discord_coord_attach(discord_coord_t* coord, int shard_id) {
+    if (coord && shard_id < 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    attached_coord = coord;
+    attached_shard = shard_id;
+    attached_count = coord ? (int)coord->shard_count : 0;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_coord_identify_slot(uint64_t* at_ms) {
+    if (!at_ms) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    uint64_t now = discord_time_now_ms();
+    *at_ms = now;
+    discord_coord_t* coord = attached_coord;
+    if (!coord) {
+        return DISCORD_OK;
+    }
+
+    attached_count = (int)coord->shard_count;    // Attached before the first assignment
+    uint64_t at = now;
+    discord_result_t result = discord_coord_acquire(coord, attached_shard, now, &at);
+    if (result == DISCORD_ERROR_TIMEOUT) {
+        *at_ms = at;                // Reserved for us; no second acquire
+        result = DISCORD_OK;
+    }
+    return result;
+}
+
+discord_result_t discord_coord_identify_shard(int* shard_id, int* shard_count) {
+    if (!shard_id || !shard_count) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    *shard_id = attached_coord ? attached_shard : 0;
+    *shard_count = attached_coord ? attached_count : 0;
+    return DISCORD_OK;
+}
+
+#else
+
+discord_result_t discord_coord_server_create(const discord_coord_server_config_t* config,
+                                             discord_coord_server_t** server) {
+    (void)config; (void)server;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_coord_server_poll(discord_coord_server_t* server, int timeout_ms) {
+    (void)server; (void)timeout_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_coord_server_get_stats(const discord_coord_server_t* server,
+                                                discord_coord_server_stats_t* stats) {
+    (void)server; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_coord_server_destroy(discord_coord_server_t* server) {
+    (void)server;
+}
+
+discord_result_t discord_coord_connect(const char* path, discord_coord_t** coord) {
+    (void)path; (void)coord;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_coord_poll(discord_coord_t* coord, int timeout_ms) {
+    (void)coord; (void)timeout_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_coord_get_assignment(const discord_coord_t* coord, discord_coord_assignment_t* assignment) {
+    (void)coord; (void)assignment;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+int discord_coord_owns(const discord_coord_t* coord, int shard_id) {
+    (void)coord; (void)shard_id;
+    return 0;
+}
+
+discord_result_t discord_coord_confirm(discord_coord_t* coord) {
+    (void)coord;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_coord_acquire(discord_coord_t* coord, int shard_id, uint64_t now_ms, uint64_t* retry_at_ms) {
+    (void)coord; (void)shard_id; (void)now_ms; (void)retry_at_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_coord_report_ready(discord_coord_t* coord, int shard_id) {
+    (void)coord; (void)shard_id;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_coord_close(discord_coord_t* coord) {
+    (void)coord;
+}
+
+discord_result_t discord_coord_attach(discord_coord_t* coord, int shard_id) {
+    (void)coord; (void)shard_id;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_coord_identify_slot(uint64_t* at_ms) {
+    if (!at_ms) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    *at_ms = discord_time_now_ms();
+    return DISCORD_OK;
+}
+
+discord_result_t discord_coord_identify_shard(int* shard_id, int* shard_count) {
+    if (!shard_id || !shard_count) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    *shard_id = 0;
+    *shard_count = 0;
+    return DISCORD_OK;
+}
+
+#endif
@@ -0,0 +1,556 @@
+#include "abi.h"
+#include "structs.h"
+#include "internal.h"
+#include "dispatch.h"
+#include "archive.h"
+#include "automod.h"
+#include "fanout.h"
+#include "module.h"
+#include "qos.h"
+#include "trace.h"
+#include "scan.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #define DISPATCH_THREAD_LOCAL __declspec(thread)
+#else
+    #define DISPATCH_THREAD_LOCAL __thread
+#endif
+
+// Table-driven event dispatcher
+// Handlers are kept in a small open-addressing table keyed by event name
+// (FNV-1a). Registration happens at startup; lookups on the hot path are a
+// hash, usually one probe and one memcmp.
+//
+// A loaded handler module (module.h) brings a second, immutable table that
+// is swapped in with one pointer store. Dispatches count themselves in one
+// of two reader counters picked by the epoch's parity; a swap flips the
+// epoch twice and waits for each counter to drain in turn, after which no
+// dispatch can still hold the old table (as in sleepable RCU). Until the
+// first module is loaded dispatches skip the counters entirely.
+//
+// A batched type's slot points at one of DISCORD_DISPATCH_BATCH_TYPES
+// batches. Each batch copies its events' data into one arena (the events
+// hold offsets until delivery, as the arena may move) and keeps a 256-bit
+// filter of the guilds in it; a collision only delivers a batch early.
+// While nothing is pending, events skip the guild lookup entirely.
+
+#define DISPATCH_TABLE_MASK (DISCORD_DISPATCH_TABLE_SIZE - 1)
+
+typedef struct {
+    char name[DISCORD_EVENT_TYPE_MAX];
+    size_t name_len;
+    uint32_t hash;
+    discord_event_handler_t handler;
+    uint32_t batch;                 // Index + 1 into dispatch_batches; 0 = not batched
+} dispatch_slot_t;
+
+typedef struct {
+    dispatch_slot_t* slot;
+    discord_batch_handler_t handler;    // NULL = free entry
+    uint32_t max_events;
+    uint64_t window_ns;
+    discord_event_t* events;
+    char* arena;
+    size_t arena_used;
+    size_t arena_capacity;
+    uint32_t count;
+    uint64_t first_ns;              // Arrival of events[0]
+    uint64_t guilds[4];
+    int delivering;
+} dispatch_batch_t;
+
+struct discord_dispatch_module {
+    dispatch_slot_t table[DISCORD_DISPATCH_TABLE_SIZE];
+    discord_event_handler_t catch_all;
+};
+
+static dispatch_slot_t dispatch_table[DISCORD_DISPATCH_TABLE_SIZE];
+static discord_event_handler_t catch_all_handler = NULL;
+
+static struct discord_dispatch_module* active_module = NULL;
+static int modules_used = 0;                // Set by the first swap, never cleared
+static uint32_t module_epoch = 0;
+static uint32_t module_readers[2];
+
+static dispatch_batch_t dispatch_batches[DISCORD_DISPATCH_BATCH_TYPES];
+static uint32_t batches_pending = 0;        // Batches holding events
+static discord_batch_stats_t batch_stats;
+static DISPATCH_THREAD_LOCAL int batch_thread = 0;  // Set on the thread that registered a batch handler
+
+static uint32_t event_hash(const char* name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static dispatch_slot_t* dispatch_find(dispatch_slot_t* table, const char* name, size_t len, uint32_t hash,
+                                      int insert) {
+    for (uint32_t probe = 0; probe < DISCORD_DISPATCH_TABLE_SIZE; probe++) {
+        dispatch_slot_t* slot = &table[(hash + probe) & DISPATCH_TABLE_MASK];
+
+        if (slot->name_len == 0) {
+            return insert ? slot : NULL;
+        }
+
+        if (slot->hash == hash && slot->name_len == len && memcmp(slot->name, name, len) == 0) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+// Guild filter bit of a dispatch. The guild key is the first "guild_id": in the payload. The pattern cannot
+// occur inside a string (its quotes would be escaped) and a nested
+// guild_id (a member, a referenced message) names the event's own guild,
+// so no depth tracking is needed and reaction payloads, which end with the
+// key, are found with one vectorised scan. GUILD_* events without one use
+// their top-level id.
+static uint32_t event_guild_bit(const discord_event_t* event) {
+    static const char pattern[] = "\"guild_id\":";
+    const size_t pattern_len = sizeof(pattern) - 1;
+    const char* p = event->data;
+    const char* end = event->data + event->data_length;
+    const char* guild = NULL;
+    size_t guild_length = 0;
+
+    while (p && (size_t)(end - p) >= pattern_len) {
+        size_t idx = discord_scan_find_pair(p, (size_t)(end - p), '"', 'g');
+        if ((size_t)(end - p) - idx < pattern_len) {
+            break;
+        }
+        if (memcmp(p + idx, pattern, pattern_len) == 0) {
+            const char* value = p + idx + pattern_len;
+            while (value < end && (*value == ' ' || *value == '"')) {
+                value++;
+            }
+            guild = value;
+            while (value < end && *value >= '0' && *value <= '9') {
+                value++;
+            }
+            guild_length = (size_t)(value - guild);
+            break;
+        }
+        p += idx + 1;
+    }
+
+    if (!guild && strncmp(event->event_type, "GUILD_", 6) == 0) {
+        const char* cursor = event->data;
+        const char* key;
+        const char* value;
+        size_t key_length;
+        size_t value_length;
+        while (discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK) {
+            if (key_length == 2 && memcmp(key, "id", 2) == 0) {
+                int quoted = value_length >= 2 && value[0] == '"';
+                guild = value + quoted;
+                guild_length = value_length - 2 * (size_t)quoted;
+                break;
+            }
+        }
+    }
+    return event_hash(guild ? guild : "", guild ? guild_length : 0) & 255;
+}
+
+static void batch_deliver(dispatch_batch_t* batch, uint64_t* reason) {
+    if (batch->count == 0 || batch->delivering) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        batch->events[i].data = batch->arena + (uintptr_t)batch->events[i].data;
+    }
+    batch_stats.batches++;
+    batch_stats.events += batch->count;
+    (*reason)++;
+
+    // Events dispatched by the handler go around this batch
+    batch->delivering = 1;
+    DISCORD_TRACE_BEGIN(trace_batch);
+    batch->handler(batch->events, batch->count);
+    DISCORD_TRACE_END(trace_batch, DISCORD_TRACE_HANDLER, 0);
+    batch->delivering = 0;
+
+    batch->count = 0;
+    batch->arena_used = 0;
+    memset(batch->guilds, 0, sizeof(batch->guilds));
+    batches_pending--;
+}
+
+// Deliver the batches holding events of guild bit, except skip
+static void batch_order(uint32_t bit, const dispatch_batch_t* skip) {
+    for (uint32_t i = 0; i < DISCORD_DISPATCH_BATCH_TYPES && batches_pending; i++) {
+        dispatch_batch_t* batch = &dispatch_batches[i];
+        if (batch != skip && batch->count && (batch->guilds[bit >> 6] & (1ull << (bit & 63)))) {
+            batch_deliver(batch, &batch_stats.ordered);
+        }
+    }
+}
+
+// Copy event into batch; non-zero when it cannot take it
+static int batch_append(dispatch_batch_t* batch, const discord_event_t* event, uint32_t bit) {
+    if (batch->delivering) {
+        return -1;
+    }
+    size_t needed = batch->arena_used + event->data_length + 1;
+    if (needed > batch->arena_capacity) {
+        size_t capacity = batch->arena_capacity ? batch->arena_capacity * 2 : 4096;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        char* arena = discord_mem_realloc(DISCORD_MEM_DISPATCH, batch->arena, capacity);
+        if (!arena) {
+            return -1;
+        }
+        batch->arena = arena;
+        batch->arena_capacity = capacity;
+    }
+
+    discord_event_t* copy = &batch->events[batch->count];
+    copy->opcode = event->opcode;
+    copy->sequence = event->sequence;
+    copy->event_type = batch->slot->name;
+    copy->data_length = event->data_length;
+    copy->data = (char*)(uintptr_t)batch->arena_used;
+    if (event->data_length) {
+        memcpy(batch->arena + batch->arena_used, event->data, event->data_length);
+    }
+    batch->arena[batch->arena_used + event->data_length] = '\0';
+    batch->arena_used = needed;
+    batch->guilds[bit >> 6] |= 1ull << (bit & 63);
+
+    uint64_t now = discord_time_now_ns();
+    if (batch->count++ == 0) {
+        batch->first_ns = now;
+        batches_pending++;
+    }
+    if (batch->count >= batch->max_events) {
+        batch_deliver(batch, &batch_stats.full);
+    } else if (now - batch->first_ns >= batch->window_ns) {
+        batch_deliver(batch, &batch_stats.expired);
+    }
+    return 0;
+}
+
+static void batch_release(dispatch_batch_t* batch) {
+    batch_deliver(batch, &batch_stats.drained);
+    batch->slot->batch = 0;
+    discord_mem_free(batch->events);
+    discord_mem_free(batch->arena);
+    memset(batch, 0, sizeof(*batch));
+}
+
+discord_result_t discord_dispatch_set_handler(discord_event_handler_t handler) {
+    catch_all_handler = handler;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_dispatch_on(const char* event_type, discord_event_handler_t handler) {
+    if (!event_type) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    size_t len = strlen(event_type);
+    if (len == 0 || len >= DISCORD_EVENT_TYPE_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t hash = event_hash(event_type, len);
+    dispatch_slot_t* slot = dispatch_find(dispatch_table, event_type, len, hash, 1);
+    if (!slot) {
+        return DISCORD_ERROR_MEMORY; // Table full
+    }
+
+    // Slots are never removed; a NULL handler falls back to the catch-all
+    if (slot->batch) {
+        batch_release(&dispatch_batches[slot->batch - 1]);
+    }
+    memcpy(slot->name, event_type, len + 1);
+    slot->name_len = len;
+    slot->hash = hash;
+    slot->handler = handler;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_dispatch_on_batch(const char* event_type, discord_batch_handler_t handler,
+                                           const discord_batch_config_t* config) {
+    uint32_t max_events = config && config->max_events ? config->max_events : DISCORD_DISPATCH_BATCH_DEFAULT_EVENTS;
+    uint32_t window_us = config && config->window_us ? config->window_us : DISCORD_DISPATCH_BATCH_DEFAULT_WINDOW_US;
+    if (!event_type || max_events > DISCORD_DISPATCH_BATCH_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (!handler) {
+        size_t len = strlen(event_type);
+        dispatch_slot_t* slot = dispatch_find(dispatch_table, event_type, len, event_hash(event_type, len), 0);
+        if (slot && slot->batch) {
+            batch_release(&dispatch_batches[slot->batch - 1]);
+        }
+        return DISCORD_OK;
+    }
+
+    // Reserve the batch and its buffer first: on failure the current
+    // handler stays. A type that already has a batch keeps its place
+    size_t len = strlen(event_type);
+    uint32_t hash = event_hash(event_type, len);
+    dispatch_slot_t* slot = dispatch_find(dispatch_table, event_type, len, hash, 0);
+    uint32_t index = slot ? slot->batch : 0;
+    for (uint32_t i = 0; i < DISCORD_DISPATCH_BATCH_TYPES && !index; i++) {
+        if (!dispatch_batches[i].handler) {
+            index = i + 1;
+        }
+    }
+    if (!index) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    discord_event_t* events = discord_mem_calloc(DISCORD_MEM_DISPATCH, max_events, sizeof(discord_event_t));
+    if (!events) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    // Register the name so the slot exists (and any plain handler or old
+    // batch goes)
+    discord_result_t result = discord_dispatch_on(event_type, NULL);
+    if (result != DISCORD_OK) {
+        discord_mem_free(events);
+        return result;
+    }
+    slot = dispatch_find(dispatch_table, event_type, len, hash, 0);
+
+    dispatch_batch_t* batch = &dispatch_batches[index - 1];
+    slot->batch = index;
+    batch->events = events;
+    batch->slot = slot;
+    batch->handler = handler;
+    batch->max_events = max_events;
+    batch->window_ns = (uint64_t)window_us * 1000;
+    batch_thread = 1;
+    return DISCORD_OK;
+}
+
+void discord_dispatch_flush(void) {
+    for (uint32_t i = 0; i < DISCORD_DISPATCH_BATCH_TYPES && batches_pending; i++) {
+        batch_deliver(&dispatch_batches[i], &batch_stats.drained);
+    }
+}
+
+void discord_dispatch_poll(int idle) {
+    if (!batches_pending) {
+        return;
+    }
+    if (idle) {
+        discord_dispatch_flush();
+        return;
+    }
+
+    uint64_t now = discord_time_now_ns();
+    for (uint32_t i = 0; i < DISCORD_DISPATCH_BATCH_TYPES && batches_pending; i++) {
+        dispatch_batch_t* batch = &dispatch_batches[i];
+        if (batch->count && now - batch->first_ns >= batch->window_ns) {
+            batch_deliver(batch, &batch_stats.expired);
+        }
+    }
+}
+
+discord_result_t discord_dispatch_get_batch_stats(discord_batch_stats_t* stats) {
+    if (!stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    *stats = batch_stats;
+    stats->pending = 0;
+    for (uint32_t i = 0; i < DISCORD_DISPATCH_BATCH_TYPES; i++) {
+        stats->pending += dispatch_batches[i].count;
+    }
+    return DISCORD_OK;
+}
+
+void discord_dispatch_clear(void) {
+    for (uint32_t i = 0; i < DISCORD_DISPATCH_BATCH_TYPES; i++) {
+        if (dispatch_batches[i].handler) {
+            batch_release(&dispatch_batches[i]);
+        }
+    }
+    memset(dispatch_table, 0, sizeof(dispatch_table));
+    catch_all_handler = NULL;
+}
+
+discord_result_t discord_dispatch_event(const discord_event_t* event) {
+    if (!event) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // An installed automod rule set sees messages before any handler
+    if (discord_automod_filter(event)) {
+        return DISCORD_OK;
+    }
+
+    // Sinks see every delivered event, independent of handler lookup
+    discord_fanout_sink(event);
+
+    discord_event_handler_t handler = NULL;
+    dispatch_batch_t* batch = NULL;
+    struct discord_dispatch_module* module = NULL;
+    int counted = __atomic_load_n(&modules_used, __ATOMIC_ACQUIRE);
+    uint32_t readers = 0;
+
+    if (counted) {
+        readers = __atomic_load_n(&module_epoch, __ATOMIC_SEQ_CST) & 1;
+        __atomic_add_fetch(&module_readers[readers], 1, __ATOMIC_SEQ_CST);
+        module = __atomic_load_n(&active_module, __ATOMIC_SEQ_CST);
+    }
+
+    if (event->event_type && event->event_type[0] != '\0') {
+        size_t len = strlen(event->event_type);
+        uint32_t hash = event_hash(event->event_type, len);
+        dispatch_slot_t* slot = module ? dispatch_find(module->table, event->event_type, len, hash, 0) : NULL;
+        if (!slot || !slot->handler) {
+            slot = dispatch_find(dispatch_table, event->event_type, len, hash, 0);
+            batch = slot && slot->batch ? &dispatch_batches[slot->batch - 1] : NULL;
+        }
+        if (slot) {
+            handler = slot->handler;
+        }
+
+        // Earlier events of this guild go first; batched ones join their batch
+        if (batch_thread && (batches_pending || batch)) {
+            uint32_t bit = event_guild_bit(event);
+            batch_order(bit, batch);
+            if (batch && batch_append(batch, event, bit) == 0) {
+                goto done;
+            }
+        }
+    }
+
+    if (!handler && !batch && module) {
+        handler = module->catch_all;
+    }
+    if (!handler && !batch) {
+        handler = catch_all_handler;
+    }
+
+    if (batch) {
+        // Not collected: another thread, or the batch is being delivered
+        DISCORD_TRACE_BEGIN(trace_handler);
+        batch->handler(event, 1);
+        DISCORD_TRACE_END(trace_handler, DISCORD_TRACE_HANDLER, event->opcode);
+    } else if (handler) {
+        DISCORD_TRACE_BEGIN(trace_handler);
+        handler(event);
+        DISCORD_TRACE_END(trace_handler, DISCORD_TRACE_HANDLER, event->opcode);
+    }
+
+done:
+    if (counted) {
+        __atomic_sub_fetch(&module_readers[readers], 1, __ATOMIC_SEQ_CST);
+    }
+    return DISCORD_OK;
+}
+
+discord_result_t discord_dispatch_module_create(const discord_module_t* module,
+                                                struct discord_dispatch_module** table) {
+    if (!module || !table || (module->handler_count && !module->handlers)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    struct discord_dispatch_module* result = discord_mem_calloc(DISCORD_MEM_DISPATCH, 1,
+                                                                sizeof(struct discord_dispatch_module));
+    if (!result) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < module->handler_count; i++) {
+        const char* event_type = module->handlers[i].event_type;
+        size_t len = event_type ? strlen(event_type) : 0;
+        if (len == 0 || len >= DISCORD_EVENT_TYPE_MAX || !module->handlers[i].handler) {
+            discord_mem_free(result);
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+
+        uint32_t hash = event_hash(event_type, len);
+        dispatch_slot_t* slot = dispatch_find(result->table, event_type, len, hash, 1);
+        if (!slot) {
+            discord_mem_free(result);
+            return DISCORD_ERROR_MEMORY;
+        }
+        memcpy(slot->name, event_type, len + 1);
+        slot->name_len = len;
+        slot->hash = hash;
+        slot->handler = module->handlers[i].handler;
+    }
+    result->catch_all = module->catch_all;
+
+    *table = result;
+    return DISCORD_OK;
+}
+
+void discord_dispatch_module_free(struct discord_dispatch_module* table) {
+    discord_mem_free(table);
+}
+
+// Flip the epoch and wait for dispatches counted under the old parity
+static int drain_readers(uint64_t deadline) {
+    uint32_t parity = __atomic_fetch_add(&module_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    while (__atomic_load_n(&module_readers[parity], __ATOMIC_SEQ_CST) != 0) {
+        if (discord_time_now_ms() >= deadline) {
+            return 0;
+        }
+        discord_sleep_ms(1);
+    }
+    return 1;
+}
+
+discord_result_t discord_dispatch_module_swap(struct discord_dispatch_module* table, uint32_t timeout_ms,
+                                              struct discord_dispatch_module** previous) {
+    if (!previous) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    __atomic_store_n(&modules_used, 1, __ATOMIC_SEQ_CST);
+    *previous = __atomic_exchange_n(&active_module, table, __ATOMIC_SEQ_CST);
+
+    // Any dispatch still holding the old table counted itself before the
+    // exchange, under either parity. Each counter is drained while new
+    // dispatches count under the other, so neither wait can be starved.
+    uint64_t deadline = discord_time_now_ms() + timeout_ms;
+    if (!drain_readers(deadline) || !drain_readers(deadline)) {
+        return DISCORD_ERROR_TIMEOUT;
+    }
+    return DISCORD_OK;
+}
+
+discord_result_t discord_dispatch_frame(const char* json) {
+    if (!json) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    char event_type[DISCORD_EVENT_TYPE_MAX];
+    const char* data = NULL;
+    size_t data_length = 0;
+    discord_event_t event;
+
+    discord_result_t result = discord_json_parse_envelope(json, &event.opcode, &event.sequence,
+                                                          event_type, sizeof(event_type),
+                                                          &data, &data_length);
+    if (result != DISCORD_OK) {
+        return result;
+    }
+
+    event.data = (char*)data;
+    event.data_length = data_length;
+    event.event_type = event_type;
+
+    // Archived as received, before QoS can shed it or automod block it
+    discord_archive_sink(&event);
+
+    // An attached QoS scheduler queues dispatches instead of running them here
+    if (discord_qos_offer(&event)) {
+        return DISCORD_OK;
+    }
+
+    return discord_dispatch_event(&event);
+}
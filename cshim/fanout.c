@@ -0,0 +1,814 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE                         // memfd_create
+#endif
+
+#include "abi.h"
+#include "fanout.h"
+#include "internal.h"
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+    #include <sys/syscall.h>
+    #include <linux/futex.h>
+#endif
+
+// Shared-memory fan-out ring
+// The file holds a header (page aligned) followed by the ring. Records are
+// 64-byte aligned and never wrap: one that does not fit before the end of
+// the ring is preceded by a padding record. Positions are absolute byte
+// counts; head is the end of the last published record and tail the start
+// of the oldest one still intact.
+//
+// The publisher moves tail past the records it is about to overwrite (with
+// a full fence) before writing. A reader copies a record header, fences,
+// and checks tail has not passed its cursor, so a DROP consumer that is
+// overrun notices instead of reading a torn record as valid. BLOCK
+// consumers hold the publisher back instead, through their cursor in the
+// header. Waiting is a futex on a counter in the mapping (shared across
+// processes); head_seq for consumers, release_seq for the publisher.
+
+#define FANOUT_MAGIC        0x4E414644u  // "DFAN"
+#define FANOUT_VERSION      1u
+#define FANOUT_ALIGN        64u
+#define FANOUT_MIN_CAPACITY (64u << 10)
+#define FANOUT_PAD_OPCODE   (-1)         // Opcode of a padding record
+#define FANOUT_SLICE_MS     100          // Longest wait between liveness checks
+
+enum {
+    FANOUT_SLOT_FREE = 0,
+    FANOUT_SLOT_CLAIMED,                 // Being set up by a consumer
+    FANOUT_SLOT_ACTIVE
+};
+
+typedef struct {
+    uint64_t position;                  // Absolute ring position of the record
+    uint64_t index;                     // Publish order
+    uint64_t published_ns;
+    uint32_t size;                      // Whole record, multiple of FANOUT_ALIGN
+    int32_t opcode;
+    int32_t sequence;
+    uint32_t data_length;
+    uint32_t type_length;
+    uint32_t reserved;
+} fanout_record_t;                      // event_type\0 and data\0 follow
+
+typedef struct {
+    uint32_t state;
+    int32_t pid;
+    uint32_t mode;
+    uint32_t reserved;
+    uint64_t cursor;                    // Next position this consumer reads
+    uint64_t received;
+    uint64_t lost;
+    char pad[24];
+} fanout_slot_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t max_consumers;
+    uint32_t header_size;
+    int32_t publisher_pid;
+    uint32_t closed;
+    uint32_t reserved;
+    char pad0[32];
+
+    // Written by the publisher on every event
+    uint64_t head;
+    uint64_t tail;
+    uint64_t next_index;
+    uint32_t head_seq;                  // Futex: bumped per publish
+    uint32_t waiters;                   // Consumers sleeping on head_seq
+    char pad1[32];
+
+    // Written by consumers when the publisher waits
+    uint32_t release_seq;               // Futex: bumped per release while waiting
+    uint32_t publisher_waiting;
+    char pad2[56];
+
+    uint64_t published;
+    uint64_t dropped;
+    uint64_t bytes;
+    uint64_t waits;
+    uint64_t reclaimed;
+    char pad3[24];
+
+    fanout_slot_t slots[];
+} fanout_header_t;
+
+struct discord_fanout {
+    int fd;
+    unsigned char* map;
+    size_t map_size;
+    fanout_header_t* header;
+    unsigned char* ring;
+    uint64_t mask;
+    uint32_t timeout_ms;
+};
+
+struct discord_fanout_consumer {
+    unsigned char* header_map;
+    size_t header_size;
+    const unsigned char* ring;
+    size_t capacity;
+    fanout_header_t* header;
+    fanout_slot_t* slot;
+    uint64_t mask;
+    uint64_t cursor;
+    uint64_t next_index;                // Index expected next; gaps were lost
+    uint32_t held_size;
+    int holding;
+    uint64_t received;
+    uint64_t lost;
+};
+
+// The ring discord_dispatch_event publishes to, and sinks counted by
+// epoch parity so attach can wait out publishes to the ring it replaced
+static discord_fanout_t* attached_fanout = NULL;
+static uint32_t sink_epoch = 0;
+static uint32_t sink_readers[2];
+
+// A ring has one publisher, but interaction workers dispatch alongside
+// the gateway thread
+static discord_lock_t sink_lock = DISCORD_LOCK_INIT;
+
+static uint32_t fanout_align(size_t size) {
+    return (uint32_t)((size + FANOUT_ALIGN - 1) & ~(size_t)(FANOUT_ALIGN - 1));
+}
+
+#ifdef __linux__
+static void fanout_wait(uint32_t* word, uint32_t expected, uint32_t timeout_ms) {
+    struct timespec ts = { (time_t)(timeout_ms / 1000), (long)(timeout_ms % 1000) * 1000000L };
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, &ts, NULL, 0);
+}
+
+static void fanout_wake(uint32_t* word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+#else
+// No cross-process futex: poll the counter
+static void fanout_wait(uint32_t* word, uint32_t expected, uint32_t timeout_ms) {
+    struct timespec ts = { 0, 200000 };
+    for (uint32_t waited_us = 0; waited_us < timeout_ms * 1000u; waited_us += 200) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != expected) {
+            return;
+        }
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void fanout_wake(uint32_t* word) {
+    (void)word;
+}
+#endif
+
+static int process_dead(int32_t pid) {
+    return pid > 0 && kill((pid_t)pid, 0) != 0 && errno == ESRCH;
+}
+
+// Milliseconds left before deadline, 0 once it has passed
+static uint32_t remaining_ms(uint64_t deadline) {
+    uint64_t now = discord_time_now_ms();
+    return now >= deadline ? 0 : (uint32_t)(deadline - now);
+}
+
+// Lowest cursor among BLOCK consumers (head when there are none); *blocker
+// is the slot holding it back
+static uint64_t min_cursor(const discord_fanout_t* fanout, uint64_t head, uint32_t* blocker) {
+    fanout_header_t* header = fanout->header;
+    uint64_t tail = header->tail;
+    uint64_t min = head;
+    for (uint32_t i = 0; i < header->max_consumers; i++) {
+        fanout_slot_t* slot = &header->slots[i];
+        if (__atomic_load_n(&slot->state, __ATOMIC_SEQ_CST) != FANOUT_SLOT_ACTIVE ||
+            slot->mode != DISCORD_FANOUT_BLOCK) {
+            continue;
+        }
+        // A consumer that attached while the ring wrapped starts at tail
+        uint64_t cursor = __atomic_load_n(&slot->cursor, __ATOMIC_SEQ_CST);
+        if (cursor < tail) {
+            cursor = tail;
+        }
+        if (cursor < min) {
+            min = cursor;
+            *blocker = i;
+        }
+    }
+    return min;
+}
+
+// Wait until BLOCK consumers have released everything before end - capacity
+static int reserve(discord_fanout_t* fanout, uint64_t head, uint64_t end) {
+    fanout_header_t* header = fanout->header;
+    uint64_t capacity = header->capacity;
+    uint64_t deadline = 0;
+    int waited = 0;
+
+    for (;;) {
+        uint32_t blocker = 0;
+        if (end - min_cursor(fanout, head, &blocker) <= capacity) {
+            return 1;
+        }
+
+        fanout_slot_t* slot = &header->slots[blocker];
+        if (process_dead(slot->pid)) {
+            uint32_t active = FANOUT_SLOT_ACTIVE;
+            if (__atomic_compare_exchange_n(&slot->state, &active, FANOUT_SLOT_FREE, 0,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                header->reclaimed++;
+            }
+            continue;
+        }
+
+        if (!waited) {
+            waited = 1;
+            header->waits++;
+            deadline = discord_time_now_ms() + fanout->timeout_ms;
+        }
+        uint32_t slice = FANOUT_SLICE_MS;
+        if (fanout->timeout_ms != UINT32_MAX) {
+            uint32_t left = remaining_ms(deadline);
+            if (left == 0) {
+                return 0;
+            }
+            if (left < slice) {
+                slice = left;
+            }
+        }
+
+        __atomic_store_n(&header->publisher_waiting, 1, __ATOMIC_SEQ_CST);
+        uint32_t seq = __atomic_load_n(&header->release_seq, __ATOMIC_SEQ_CST);
+        if (end - min_cursor(fanout, head, &blocker) > capacity) {
+            fanout_wait(&header->release_seq, seq, slice);
+        }
+        __atomic_store_n(&header->publisher_waiting, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+// Retire the records [end - capacity, ...) is about to overwrite
+static void advance_tail(discord_fanout_t* fanout, uint64_t end) {
+    fanout_header_t* header = fanout->header;
+    if (end <= header->capacity) {
+        return;
+    }
+
+    uint64_t tail = header->tail;
+    uint64_t limit = end - header->capacity;
+    if (tail >= limit) {
+        return;
+    }
+    while (tail < limit) {
+        const fanout_record_t* record = (const fanout_record_t*)(fanout->ring + (tail & fanout->mask));
+        tail += record->size;
+    }
+    __atomic_store_n(&header->tail, tail, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+discord_result_t discord_fanout_create(const char* path, const discord_fanout_config_t* config,
+                                       discord_fanout_t** fanout) {
+    if (!fanout) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t capacity = config && config->capacity ? config->capacity : DISCORD_FANOUT_CAPACITY_DEFAULT;
+    uint32_t max_consumers = config && config->max_consumers ? config->max_consumers
+                                                             : DISCORD_FANOUT_CONSUMERS_DEFAULT;
+    uint32_t timeout_ms = config && config->publish_timeout_ms ? config->publish_timeout_ms
+                                                               : DISCORD_FANOUT_TIMEOUT_DEFAULT;
+    if (capacity < FANOUT_MIN_CAPACITY || (capacity & (capacity - 1)) != 0 ||
+        max_consumers > DISCORD_FANOUT_CONSUMERS_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t header_size = sizeof(fanout_header_t) + max_consumers * sizeof(fanout_slot_t);
+    header_size = (header_size + page - 1) / page * page;
+    size_t map_size = header_size + capacity;
+
+    int fd;
+    if (path) {
+        // Replace rather than reuse: consumers still mapping the old file
+        // see it closed instead of a ring reset under them
+        unlink(path);
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    } else {
+#ifdef __linux__
+        fd = memfd_create("discord-fanout", 0);  // No CLOEXEC: exec'd workers inherit it
+#else
+        return DISCORD_ERROR_UNSUPPORTED;
+#endif
+    }
+    if (fd < 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (ftruncate(fd, (off_t)map_size) != 0) {
+        close(fd);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    unsigned char* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    discord_fanout_t* result = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_fanout_t));
+    if (!result) {
+        munmap(map, map_size);
+        close(fd);
+        return DISCORD_ERROR_MEMORY;
+    }
+    result->fd = fd;
+    result->map = map;
+    result->map_size = map_size;
+    result->header = (fanout_header_t*)map;
+    result->ring = map + header_size;
+    result->mask = capacity - 1;
+    result->timeout_ms = timeout_ms;
+
+    fanout_header_t* header = result->header;
+    header->version = FANOUT_VERSION;
+    header->capacity = capacity;
+    header->max_consumers = max_consumers;
+    header->header_size = (uint32_t)header_size;
+    header->publisher_pid = (int32_t)getpid();
+    __atomic_store_n(&header->magic, FANOUT_MAGIC, __ATOMIC_RELEASE);
+
+    *fanout = result;
+    return DISCORD_OK;
+}
+
+int discord_fanout_fd(const discord_fanout_t* fanout) {
+    return fanout ? fanout->fd : -1;
+}
+
+discord_result_t discord_fanout_publish(discord_fanout_t* fanout, const discord_event_t* event) {
+    if (!fanout || !event || (event->data_length && !event->data)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    fanout_header_t* header = fanout->header;
+    size_t type_length = event->event_type ? strlen(event->event_type) : 0;
+    size_t length = sizeof(fanout_record_t) + type_length + 1 + event->data_length + 1;
+    if (length > header->capacity / 4) {
+        header->dropped++;
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    uint32_t size = fanout_align(length);
+    uint64_t head = header->head;
+    uint64_t offset = head & fanout->mask;
+    uint32_t pad = header->capacity - offset < size ? (uint32_t)(header->capacity - offset) : 0;
+    uint64_t end = head + pad + size;
+
+    if (!reserve(fanout, head, end)) {
+        header->dropped++;
+        return DISCORD_ERROR_TIMEOUT;
+    }
+    advance_tail(fanout, end);
+
+    if (pad) {
+        fanout_record_t* filler = (fanout_record_t*)(fanout->ring + offset);
+        memset(filler, 0, sizeof(*filler));
+        filler->position = head;
+        filler->size = pad;
+        filler->opcode = FANOUT_PAD_OPCODE;
+        offset = 0;
+    }
+
+    fanout_record_t* record = (fanout_record_t*)(fanout->ring + offset);
+    record->position = head + pad;
+    record->index = header->next_index;
+    __atomic_store_n(&header->next_index, record->index + 1, __ATOMIC_RELAXED);
+    record->published_ns = discord_time_now_ns();
+    record->size = size;
+    record->opcode = event->opcode;
+    record->sequence = event->sequence;
+    record->data_length = (uint32_t)event->data_length;
+    record->type_length = (uint32_t)type_length;
+    record->reserved = 0;
+    char* text = (char*)(record + 1);
+    if (type_length) {
+        memcpy(text, event->event_type, type_length);
+    }
+    text[type_length] = '\0';
+    if (event->data_length) {
+        memcpy(text + type_length + 1, event->data, event->data_length);
+    }
+    text[type_length + 1 + event->data_length] = '\0';
+
+    __atomic_store_n(&header->head, end, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&header->head_seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header->waiters, __ATOMIC_SEQ_CST)) {
+        fanout_wake(&header->head_seq);
+    }
+
+    header->published++;
+    header->bytes += pad + size;
+    return DISCORD_OK;
+}
+
+void discord_fanout_sink(const discord_event_t* event) {
+    if (!__atomic_load_n(&attached_fanout, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    uint32_t readers = __atomic_load_n(&sink_epoch, __ATOMIC_SEQ_CST) & 1;
+    __atomic_add_fetch(&sink_readers[readers], 1, __ATOMIC_SEQ_CST);
+    discord_fanout_t* fanout = __atomic_load_n(&attached_fanout, __ATOMIC_SEQ_CST);
+    if (fanout) {
+        discord_lock(&sink_lock);
+        discord_fanout_publish(fanout, event);
+        discord_unlock(&sink_lock);
+    }
+    __atomic_sub_fetch(&sink_readers[readers], 1, __ATOMIC_SEQ_CST);
+}
+
+// Flip the epoch and wait for sinks counted under the old parity; a sink
+// publishes at most once, so this is bounded by publish_timeout_ms
+static void drain_sinks(void) {
+    uint32_t parity = __atomic_fetch_add(&sink_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    while (__atomic_load_n(&sink_readers[parity], __ATOMIC_SEQ_CST) != 0) {
+        discord_sleep_ms(1);
+    }
+}
+
+discord_result_t discord_fanout_attach(discord_fanout_t* fanout) {
+    __atomic_store_n(&attached_fanout, fanout, __ATOMIC_SEQ_CST);
+
+    // Same two-phase drain as automod installs
+    drain_sinks();
+    drain_sinks();
+    return DISCORD_OK;
+}
+
+discord_result_t discord_fanout_get_stats(const discord_fanout_t* fanout, discord_fanout_stats_t* stats) {
+    if (!fanout || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    const fanout_header_t* header = fanout->header;
+    memset(stats, 0, sizeof(*stats));
+    stats->published = header->published;
+    stats->dropped = header->dropped;
+    stats->bytes = header->bytes;
+    stats->waits = header->waits;
+    stats->reclaimed = header->reclaimed;
+    for (uint32_t i = 0; i < header->max_consumers; i++) {
+        if (__atomic_load_n(&header->slots[i].state, __ATOMIC_ACQUIRE) == FANOUT_SLOT_ACTIVE) {
+            stats->consumers++;
+        }
+    }
+    return DISCORD_OK;
+}
+
+void discord_fanout_destroy(discord_fanout_t* fanout) {
+    if (!fanout) {
+        return;
+    }
+    if (attached_fanout == fanout) {
+        discord_fanout_attach(NULL);
+    }
+
+    fanout_header_t* header = fanout->header;
+    __atomic_store_n(&header->closed, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&header->head_seq, 1, __ATOMIC_SEQ_CST);
+    fanout_wake(&header->head_seq);
+
+    munmap(fanout->map, fanout->map_size);
+    close(fanout->fd);
+    discord_mem_free(fanout);
+}
+
+static discord_result_t consumer_map(int fd, discord_fanout_mode_t mode, discord_fanout_consumer_t** consumer) {
+    if (fd < 0 || !consumer || (mode != DISCORD_FANOUT_BLOCK && mode != DISCORD_FANOUT_DROP)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    fanout_header_t probe;
+    struct stat st;
+    if (pread(fd, &probe, sizeof(probe), 0) != (ssize_t)sizeof(probe) || fstat(fd, &st) != 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (probe.magic != FANOUT_MAGIC || probe.version != FANOUT_VERSION ||
+        (uint64_t)st.st_size != (uint64_t)probe.header_size + probe.capacity) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (probe.closed) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    // The ring is mapped read-only: a consumer cannot corrupt what the
+    // others read
+    unsigned char* header_map = mmap(NULL, probe.header_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header_map == MAP_FAILED) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    const unsigned char* ring = mmap(NULL, probe.capacity, PROT_READ, MAP_SHARED, fd, (off_t)probe.header_size);
+    if (ring == MAP_FAILED) {
+        munmap(header_map, probe.header_size);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    discord_fanout_consumer_t* result = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_fanout_consumer_t));
+    if (!result) {
+        munmap((void*)ring, probe.capacity);
+        munmap(header_map, probe.header_size);
+        return DISCORD_ERROR_MEMORY;
+    }
+    result->header_map = header_map;
+    result->header_size = probe.header_size;
+    result->ring = ring;
+    result->capacity = probe.capacity;
+    result->header = (fanout_header_t*)header_map;
+    result->mask = probe.capacity - 1;
+
+    fanout_header_t* header = result->header;
+    for (uint32_t i = 0; i < header->max_consumers && !result->slot; i++) {
+        fanout_slot_t* slot = &header->slots[i];
+        uint32_t free_state = FANOUT_SLOT_FREE;
+        if (__atomic_compare_exchange_n(&slot->state, &free_state, FANOUT_SLOT_CLAIMED, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            result->slot = slot;
+        }
+    }
+    if (!result->slot) {
+        munmap((void*)ring, probe.capacity);
+        munmap(header_map, probe.header_size);
+        discord_mem_free(result);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    fanout_slot_t* slot = result->slot;
+    // Read after head, so never past the index of the first record read
+    result->cursor = __atomic_load_n(&header->head, __ATOMIC_SEQ_CST);
+    result->next_index = __atomic_load_n(&header->next_index, __ATOMIC_SEQ_CST);
+    slot->pid = (int32_t)getpid();
+    slot->mode = (uint32_t)mode;
+    slot->received = 0;
+    slot->lost = 0;
+    __atomic_store_n(&slot->cursor, result->cursor, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&slot->state, FANOUT_SLOT_ACTIVE, __ATOMIC_SEQ_CST);
+
+    *consumer = result;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_fanout_consumer_open(const char* path, discord_fanout_mode_t mode,
+                                              discord_fanout_consumer_t** consumer) {
+    if (!path) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+    discord_result_t result = consumer_map(fd, mode, consumer);
+    close(fd);                          // The mappings keep the file
+    return result;
+}
+
+discord_result_t discord_fanout_consumer_open_fd(int fd, discord_fanout_mode_t mode,
+                                                 discord_fanout_consumer_t** consumer) {
+    return consumer_map(fd, mode, consumer);
+}
+
+static void publish_cursor(discord_fanout_consumer_t* consumer) {
+    fanout_header_t* header = consumer->header;
+    __atomic_store_n(&consumer->slot->cursor, consumer->cursor, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header->publisher_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&header->release_seq, 1, __ATOMIC_SEQ_CST);
+        fanout_wake(&header->release_seq);
+    }
+}
+
+discord_result_t discord_fanout_next(discord_fanout_consumer_t* consumer, int timeout_ms,
+                                     discord_fanout_event_t* event) {
+    if (!consumer || !event) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (consumer->holding) {
+        discord_fanout_release(consumer);
+    }
+
+    fanout_header_t* header = consumer->header;
+    uint64_t deadline = timeout_ms > 0 ? discord_time_now_ms() + (uint64_t)timeout_ms : 0;
+
+    for (;;) {
+        uint64_t head = __atomic_load_n(&header->head, __ATOMIC_SEQ_CST);
+        if (consumer->cursor == head) {
+            if (__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE) || process_dead(header->publisher_pid)) {
+                return DISCORD_ERROR_NETWORK;
+            }
+            uint32_t slice = FANOUT_SLICE_MS;
+            if (timeout_ms >= 0) {
+                uint32_t left = timeout_ms > 0 ? remaining_ms(deadline) : 0;
+                if (left == 0) {
+                    return DISCORD_ERROR_TIMEOUT;
+                }
+                if (left < slice) {
+                    slice = left;
+                }
+            }
+
+            __atomic_add_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+            uint32_t seq = __atomic_load_n(&header->head_seq, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&header->head, __ATOMIC_SEQ_CST) == consumer->cursor &&
+                !__atomic_load_n(&header->closed, __ATOMIC_SEQ_CST)) {
+                fanout_wait(&header->head_seq, seq, slice);
+            }
+            __atomic_sub_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        // Overrun: skip to the oldest intact record
+        uint64_t tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+        if (consumer->cursor < tail) {
+            consumer->cursor = tail;
+            continue;
+        }
+
+        const fanout_record_t* record = (const fanout_record_t*)(consumer->ring + (consumer->cursor & consumer->mask));
+        fanout_record_t copy;
+        memcpy(&copy, record, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->tail, __ATOMIC_ACQUIRE) > consumer->cursor) {
+            continue;
+        }
+
+        if (copy.position != consumer->cursor || copy.size < sizeof(fanout_record_t) ||
+            copy.size % FANOUT_ALIGN != 0 || copy.size > consumer->capacity) {
+            // Not a record boundary; only a corrupted ring gets here
+            consumer->cursor = head;
+            publish_cursor(consumer);
+            continue;
+        }
+        if (copy.opcode == FANOUT_PAD_OPCODE) {
+            consumer->cursor += copy.size;
+            publish_cursor(consumer);
+            continue;
+        }
+        if ((uint64_t)sizeof(fanout_record_t) + copy.type_length + copy.data_length + 2 > copy.size) {
+            consumer->cursor += copy.size;
+            publish_cursor(consumer);
+            continue;
+        }
+
+        if (copy.index > consumer->next_index) {
+            consumer->lost += copy.index - consumer->next_index;
+        }
+        consumer->next_index = copy.index + 1;
+
+        char* text = (char*)(record + 1);
+        event->event.opcode = copy.opcode;
+        event->event.sequence = copy.sequence;
+        event->event.event_type = text;
+        event->event.data = text + copy.type_length + 1;
+        event->event.data_length = copy.data_length;
+        event->index = copy.index;
+        event->published_ns = copy.published_ns;
+
+        consumer->held_size = copy.size;
+        consumer->holding = 1;
+        return DISCORD_OK;
+    }
+}
+
+discord_result_t discord_fanout_release(discord_fanout_consumer_t* consumer) {
+    if (!consumer) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (!consumer->holding) {
+        return DISCORD_OK;
+    }
+    consumer->holding = 0;
+
+    fanout_slot_t* slot = consumer->slot;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&consumer->header->tail, __ATOMIC_ACQUIRE) > consumer->cursor) {
+        // Overwritten while held; the next call skips ahead
+        consumer->lost++;
+        __atomic_store_n(&slot->lost, consumer->lost, __ATOMIC_RELAXED);
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    consumer->cursor += consumer->held_size;
+    consumer->received++;
+    __atomic_store_n(&slot->received, consumer->received, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->lost, consumer->lost, __ATOMIC_RELAXED);
+    publish_cursor(consumer);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_fanout_consumer_get_stats(const discord_fanout_consumer_t* consumer,
+                                                   discord_fanout_consumer_stats_t* stats) {
+    if (!consumer || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t head = __atomic_load_n(&consumer->header->head, __ATOMIC_ACQUIRE);
+    stats->received = consumer->received;
+    stats->lost = consumer->lost;
+    stats->lag_bytes = head > consumer->cursor ? head - consumer->cursor : 0;
+    return DISCORD_OK;
+}
+
+void discord_fanout_consumer_close(discord_fanout_consumer_t* consumer) {
+    if (!consumer) {
+        return;
+    }
+
+    fanout_header_t* header = consumer->header;
+    __atomic_store_n(&consumer->slot->state, FANOUT_SLOT_FREE, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header->publisher_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&header->release_seq, 1, __ATOMIC_SEQ_CST);
+        fanout_wake(&header->release_seq);
+    }
+
+    munmap((void*)consumer->ring, consumer->capacity);
+    munmap(consumer->header_map, consumer->header_size);
+    discord_mem_free(consumer);
+}
+
+#else
+
+discord_result_t discord_fanout_create(const char* path, const discord_fanout_config_t* config,
+                                       discord_fanout_t** fanout) {
+    (void)path; (void)config; (void)fanout;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+int discord_fanout_fd(const discord_fanout_t* fanout) {
+    (void)fanout;
+    return -1;
+}
+
+discord_result_t discord_fanout_publish(discord_fanout_t* fanout, const discord_event_t* event) {
+    (void)fanout; (void)event;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_fanout_sink(const discord_event_t* event) {
+    (void)event;
+}
+
+discord_result_t discord_fanout_attach(discord_fanout_t* fanout) {
+    (void)fanout;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_fanout_get_stats(const discord_fanout_t* fanout, discord_fanout_stats_t* stats) {
+    (void)fanout; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_fanout_destroy(discord_fanout_t* fanout) {
+    (void)fanout;
+}
+
+discord_result_t discord_fanout_consumer_open(const char* path, discord_fanout_mode_t mode,
+                                              discord_fanout_consumer_t** consumer) {
+    (void)path; (void)mode; (void)consumer;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_fanout_consumer_open_fd(int fd, discord_fanout_mode_t mode,
+                                                 discord_fanout_consumer_t** consumer) {
+    (void)fd; (void)mode; (void)consumer;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_fanout_next(discord_fanout_consumer_t* consumer, int timeout_ms,
+                                     discord_fanout_event_t* event) {
+    (void)consumer; (void)timeout_ms; (void)event;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_fanout_release(discord_fanout_consumer_t* consumer) {
+    (void)consumer;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_fanout_consumer_get_stats(const discord_fanout_consumer_t* consumer,
+                                                   discord_fanout_consumer_stats_t* stats) {
+    (void)consumer; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_fanout_consumer_close(discord_fanout_consumer_t* consumer) {
+    (void)consumer;
+}
+
+#endif
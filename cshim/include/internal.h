@@ -3,23 +3,67 @@
 
 #include "abi.h"
 #include "structs.h"
+#include "module.h"
+#include "connect.h"
 #include <libwebsockets.h>
 
-// Internal WebSocket context
+// Minimal mutex used by the shim (libwebsockets.h must come first on
+// Windows so winsock2.h precedes windows.h)
+#ifdef _WIN32
+    #include <windows.h>
+    typedef SRWLOCK discord_lock_t;
+    #define DISCORD_LOCK_INIT SRWLOCK_INIT
+    #define discord_lock(l) AcquireSRWLockExclusive(l)
+    #define discord_try_lock(l) TryAcquireSRWLockExclusive(l)
+    #define discord_unlock(l) ReleaseSRWLockExclusive(l)
+#else
+    #include <pthread.h>
+    typedef pthread_mutex_t discord_lock_t;
+    #define DISCORD_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+    #define discord_lock(l) pthread_mutex_lock(l)
+    #define discord_try_lock(l) (pthread_mutex_trylock(l) == 0)
+    #define discord_unlock(l) pthread_mutex_unlock(l)
+#endif
+
+// Completed inbound frame waiting for discord_ws_receive
+typedef struct {
+    char* data;                     // NUL-terminated; ownership moves to the caller
+    size_t length;
+    int is_binary;
+} discord_ws_frame_t;
+
+// Internal WebSocket context (one per connection; the lws_context is shared)
 struct discord_ws_context {
-    struct lws_context* context;
     struct lws* wsi;
     discord_gateway_t* gateway;
-    char* receive_buffer;
+    char* receive_buffer;           // Reassembly of a fragmented frame
     size_t receive_buffer_size;
     size_t receive_buffer_pos;
+    discord_ws_frame_t* frames;     // Ring of completed frames
+    size_t frame_capacity;          // Power of two
+    size_t frame_head;              // Next frame to hand out
+    size_t frame_count;
+    size_t queued_bytes;            // Payload bytes held in frames[]
     int connection_error;
     int close_reason;
+    int close_requested;            // Close from the next WRITEABLE callback
+    discord_recorder_t* recorder;   // Optional capture of inbound frames
+    uint64_t connect_started_ns;    // For the gateway's upgrade_ns
+    struct discord_ws_context* prev; // Live connections on the shared context
+    struct discord_ws_context* next;
 };
 
-// Internal gateway structure
+// io_uring transport connection (ws_uring.c)
+struct discord_uring_conn;
+
+// Simulated gateway connection (sim.c)
+struct discord_sim_conn;
+
+// Internal gateway structure (exactly one of ws_ctx, uring and sim is set)
 struct discord_gateway {
     struct discord_ws_context* ws_ctx;
+    struct discord_uring_conn* uring;
+    struct discord_sim_conn* sim;
     discord_gateway_state_t state;
     int heartbeat_interval;
     uint64_t last_heartbeat;
@@ -28,10 +72,72 @@ struct discord_gateway {
     char* session_id;
     char* resume_gateway_url;
     int should_reconnect;
+    discord_connect_timing_t timing;
 };
 
 // Internal function declarations
 int discord_ws_callback(struct lws* wsi, enum lws_callback_reasons reason,
                        void* user, void* in, size_t len);
 
-#endif // DISCORD_ASM_CSHIM_INTERNAL_H
\ No newline at end of file
+// io_uring transport, called by the discord_ws_* entry points in ws.c
+discord_result_t discord_uring_connect(const char* url, const discord_ws_options_t* options,
+                                       discord_gateway_t* gateway);
+discord_result_t discord_uring_send(struct discord_uring_conn* conn, const char* data, size_t length);
+discord_result_t discord_uring_receive(struct discord_uring_conn* conn, discord_ws_message_t* message,
+                                       int timeout_ms);
+void discord_uring_close(struct discord_uring_conn* conn);
+void discord_uring_set_recorder(struct discord_uring_conn* conn, discord_recorder_t* recorder);
+int discord_uring_release_message(discord_ws_message_t* message);  // 1 if it pointed into a ring buffer
+void discord_uring_add_stats(discord_ws_stats_t* stats);
+discord_result_t discord_uring_shutdown(void);
+
+// Simulated transport, called by the discord_ws_* entry points in ws.c;
+// messages are discord_mem_alloc'd like lws frames
+discord_result_t discord_sim_conn_open(const char* url, discord_gateway_t* gateway);
+discord_result_t discord_sim_conn_send(struct discord_sim_conn* conn, const char* data, size_t length);
+discord_result_t discord_sim_conn_receive(struct discord_sim_conn* conn, discord_ws_message_t* message,
+                                          int timeout_ms);
+void discord_sim_conn_close(struct discord_sim_conn* conn);
+void discord_sim_conn_set_recorder(struct discord_sim_conn* conn, discord_recorder_t* recorder);
+
+// Connect pipeline (connect.c)
+#define DISCORD_URL_HOST_MAX 256
+#define DISCORD_URL_PATH_MAX 1024
+
+typedef struct {
+    int secure;                     // wss://
+    int port;
+    int default_port;               // 443 or 80: the Host header leaves it out
+    char host[DISCORD_URL_HOST_MAX]; // IPv6 literals without the brackets
+    char path[DISCORD_URL_PATH_MAX]; // Path and query, always starting with '/'
+} discord_url_t;
+
+discord_result_t discord_url_parse(const char* url, discord_url_t* parsed);
+discord_ws_transport_t discord_ws_select_transport(const discord_ws_options_t* options);
+// host as a numeric address from the DNS cache, waiting up to timeout_ms
+// for a lookup; *cached is set when no lookup was needed
+discord_result_t discord_dns_resolve_numeric(const char* host, int timeout_ms, char* address, size_t size,
+                                             int* cached);
+#ifndef _WIN32
+// Blocking TCP socket connected to host:port through the DNS cache, with
+// SO_RCVTIMEO/SO_SNDTIMEO of timeout_s; fills timing's DNS and TCP phases.
+// -1 on failure
+int discord_connect_tcp(const char* host, int port, int fastopen, int timeout_s, discord_connect_timing_t* timing);
+// 1 when the connection's SYN carried data
+int discord_connect_syn_data(int fd);
+#endif
+
+// Handler module tables, built from a module's registration table by
+// dispatch.c and swapped in by module.c
+struct discord_dispatch_module;
+
+discord_result_t discord_dispatch_module_create(const discord_module_t* module,
+                                                struct discord_dispatch_module** table);
+void discord_dispatch_module_free(struct discord_dispatch_module* table);
+// Make table live (NULL = none) and wait up to timeout_ms until no dispatch
+// can still be running in the one it replaced (*previous).
+// DISCORD_ERROR_TIMEOUT: *previous may still be in use and must be kept
+discord_result_t discord_dispatch_module_swap(struct discord_dispatch_module* table, uint32_t timeout_ms,
+                                              struct discord_dispatch_module** previous);
+
+#endif // DISCORD_ASM_CSHIM_INTERNAL_H
@@ -0,0 +1,31 @@
+#ifndef DISCORD_ASM_CSHIM_SCAN_H
+#define DISCORD_ASM_CSHIM_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte-scanning kernels used by the JSON, capture and automod code.
+// Vectorised with SSE2 on x86-64 and NEON on AArch64 (both baseline for
+// their architecture, so no runtime dispatch); other targets use the
+// scalar versions. All functions read only within [s, s + len).
+
+// Index of the first '"' or '\\' in s, or len if there is none
+size_t discord_scan_quote_or_escape(const char* s, size_t len);
+
+// Index of the first i with s[i] == a && s[i + 1] == b, or len if none
+size_t discord_scan_find_pair(const char* s, size_t len, char a, char b);
+
+// Word starts among the first min(len, 64) bytes: bit i is set when s[i]
+// is a word byte (ASCII letter, digit, '_' or any byte >= 0x80) and s[i - 1]
+// is not one. s[-1] counts as a word byte, so bit 0 is never set.
+uint64_t discord_scan_word_starts(const char* s, size_t len);
+
+// Scalar reference versions (used for tails and by tests)
+size_t discord_scan_quote_or_escape_scalar(const char* s, size_t len);
+size_t discord_scan_find_pair_scalar(const char* s, size_t len, char a, char b);
+uint64_t discord_scan_word_starts_scalar(const char* s, size_t len);
+
+// Name of the compiled-in kernel set ("sse2", "neon" or "scalar")
+const char* discord_scan_backend(void);
+
+#endif // DISCORD_ASM_CSHIM_SCAN_H
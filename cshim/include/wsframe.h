@@ -0,0 +1,49 @@
+#ifndef DISCORD_ASM_CSHIM_WSFRAME_H
+#define DISCORD_ASM_CSHIM_WSFRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// RFC 6455 framing for the io_uring transport (ws_uring.c).
+// Header encode/decode plus the masking kernel, vectorised like scan.c
+// (SSE2 on x86-64, NEON on AArch64, scalar elsewhere).
+
+#define DISCORD_WSFRAME_HEADER_MAX      14      // 2 + 8 length bytes + 4 mask bytes
+#define DISCORD_WSFRAME_CONTROL_MAX     125     // Largest control frame payload
+
+#define DISCORD_WSFRAME_CONTINUATION    0x0
+#define DISCORD_WSFRAME_TEXT            0x1
+#define DISCORD_WSFRAME_BINARY          0x2
+#define DISCORD_WSFRAME_CLOSE           0x8
+#define DISCORD_WSFRAME_PING            0x9
+#define DISCORD_WSFRAME_PONG            0xA
+
+typedef struct {
+    int fin;
+    int opcode;
+    int masked;
+    uint8_t mask[4];
+    size_t header_length;
+    uint64_t payload_length;
+} discord_wsframe_t;
+
+// Decode the header at data: 1 when complete, 0 when more bytes are
+// needed, -1 on a protocol error (reserved bits, unknown opcode, bad
+// control frame, 64-bit length with the top bit set)
+int discord_wsframe_parse(const uint8_t* data, size_t length, discord_wsframe_t* frame);
+
+// Encode a header into out (DISCORD_WSFRAME_HEADER_MAX bytes); mask may be
+// NULL for an unmasked (server) frame. Returns the header length.
+size_t discord_wsframe_header(uint8_t* out, int opcode, int fin, uint64_t payload_length,
+                              const uint8_t* mask);
+
+// XOR data with the mask in place, starting at mask byte (offset & 3)
+void discord_wsframe_mask(uint8_t* data, size_t length, const uint8_t mask[4], size_t offset);
+
+// Masked copy (client sends; the caller's payload is left untouched)
+void discord_wsframe_mask_copy(uint8_t* out, const uint8_t* in, size_t length, const uint8_t mask[4]);
+
+// Scalar reference version (used for tails and by tests)
+void discord_wsframe_mask_scalar(uint8_t* data, size_t length, const uint8_t mask[4], size_t offset);
+
+#endif // DISCORD_ASM_CSHIM_WSFRAME_H
@@ -0,0 +1,671 @@
+#include "abi.h"
+#include "structs.h"
+#include "interactions.h"
+#include "dispatch.h"
+#include <libwebsockets.h>
+#include <openssl/evp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+    #define INTERACTIONS_THREAD_LOCAL __declspec(thread)
+#else
+    #include <pthread.h>
+    #define INTERACTIONS_THREAD_LOCAL __thread
+#endif
+
+// HTTP interactions endpoint
+// libwebsockets runs the listener on the thread that calls
+// discord_interactions_service. A request's timestamp header and body are
+// read into one buffer (timestamp || body), which is exactly the signed
+// message, so verification needs no concatenation. Complete requests go to
+// a pending queue; workers take up to DISCORD_INTERACTIONS_BATCH at a time,
+// verify and dispatch them, put them on a done queue and wake the service
+// thread with lws_cancel_service. The service thread then asks for a
+// WRITEABLE callback on each connection and writes the response straight
+// from the request's buffer. Only the service thread touches wsi state.
+
+#define INTERACTIONS_DEFAULT_PATH    "/interactions"
+#define INTERACTIONS_DEFAULT_WORKERS 4
+#define INTERACTIONS_TIMESTAMP_MAX   32
+
+static const char pong_response[] = "{\"type\":1}";
+static const char unauthorized_response[] = "invalid request signature";
+static const char no_response[] = "no response";
+static char interaction_event_type[] = "INTERACTION_CREATE";
+
+typedef struct interaction_request {
+    struct lws* wsi;
+    char* message;                  // timestamp || body || NUL
+    size_t timestamp_length;
+    size_t message_length;
+    size_t message_capacity;
+    unsigned char signature[64];
+    int signature_present;
+    int status;                     // HTTP status of the response
+    const char* content_type;
+    unsigned char* response;        // LWS_PRE headroom + body
+    size_t response_capacity;
+    size_t response_length;
+    int in_flight;                  // Owned by a worker or the done queue
+    int orphaned;                   // Connection closed while in flight
+    struct interaction_request* next;
+} interaction_request_t;
+
+typedef struct {
+    interaction_request_t* request;
+} interaction_session_t;
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int decode_hex(const char* hex, size_t hex_length, unsigned char* out, size_t out_length) {
+    if (hex_length != out_length * 2) {
+        return 0;
+    }
+    for (size_t i = 0; i < out_length; i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return 0;
+        }
+        out[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return 1;
+}
+
+static EVP_PKEY* load_public_key(const char* hex) {
+    unsigned char raw[32];
+    if (!hex || !decode_hex(hex, strlen(hex), raw, sizeof(raw))) {
+        return NULL;
+    }
+    return EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, NULL, raw, sizeof(raw));
+}
+
+static int verify_message(EVP_MD_CTX* md, EVP_PKEY* key, const unsigned char* signature,
+                          const char* message, size_t length) {
+    EVP_MD_CTX_reset(md);
+    if (EVP_DigestVerifyInit(md, NULL, NULL, NULL, key) != 1) {
+        return 0;
+    }
+    return EVP_DigestVerify(md, signature, 64, (const unsigned char*)message, length) == 1;
+}
+
+discord_result_t discord_interactions_verify(const char* public_key, const char* signature,
+                                             const char* timestamp, const char* body, size_t body_length) {
+    if (!public_key || !signature || !timestamp || (!body && body_length > 0)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    unsigned char raw_signature[64];
+    if (!decode_hex(signature, strlen(signature), raw_signature, sizeof(raw_signature))) {
+        return DISCORD_ERROR_AUTH;
+    }
+
+    EVP_PKEY* key = load_public_key(public_key);
+    if (!key) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    size_t timestamp_length = strlen(timestamp);
+    char* message = discord_mem_alloc(DISCORD_MEM_RECEIVE, timestamp_length + body_length);
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+    if (!message || !md) {
+        discord_mem_free(message);
+        EVP_MD_CTX_free(md);
+        EVP_PKEY_free(key);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    memcpy(message, timestamp, timestamp_length);
+    if (body_length > 0) {
+        memcpy(message + timestamp_length, body, body_length);
+    }
+
+    int ok = verify_message(md, key, raw_signature, message, timestamp_length + body_length);
+
+    EVP_MD_CTX_free(md);
+    EVP_PKEY_free(key);
+    discord_mem_free(message);
+    return ok ? DISCORD_OK : DISCORD_ERROR_AUTH;
+}
+
+// Request being dispatched on this worker (for the respond calls)
+static INTERACTIONS_THREAD_LOCAL interaction_request_t* current_request = NULL;
+
+static unsigned char* reserve_response(interaction_request_t* request, size_t capacity) {
+    if (request->response_capacity < capacity || !request->response) {
+        unsigned char* response = discord_mem_realloc(DISCORD_MEM_SEND, request->response, LWS_PRE + capacity);
+        if (!response) {
+            return NULL;
+        }
+        request->response = response;
+        request->response_capacity = capacity;
+    }
+    return request->response + LWS_PRE;
+}
+
+char* discord_interactions_response_buffer(size_t capacity) {
+    if (!current_request) {
+        return NULL;
+    }
+    return (char*)reserve_response(current_request, capacity);
+}
+
+discord_result_t discord_interactions_respond(size_t length) {
+    interaction_request_t* request = current_request;
+    if (!request || !request->response || length > request->response_capacity) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    request->status = HTTP_STATUS_OK;
+    request->content_type = "application/json";
+    request->response_length = length;
+    return DISCORD_OK;
+}
+
+#ifndef _WIN32
+
+static void free_request(interaction_request_t* request) {
+    if (request) {
+        discord_mem_free(request->message);
+        discord_mem_free(request->response);
+        discord_mem_free(request);
+    }
+}
+
+static void set_response(interaction_request_t* request, int status, const char* content_type,
+                         const char* body, size_t length) {
+    request->status = status;
+    request->content_type = content_type;
+    request->response_length = 0;
+    unsigned char* out = reserve_response(request, length);
+    if (out) {
+        memcpy(out, body, length);
+        request->response_length = length;
+    } else {
+        request->status = HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
+}
+
+struct discord_interactions {
+    struct lws_context* context;
+    EVP_PKEY* public_key;
+    char path[128];
+    pthread_t* workers;
+    int worker_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    interaction_request_t* pending_head;
+    interaction_request_t* pending_tail;
+    interaction_request_t* done;
+    int stopping;
+    discord_interactions_stats_t stats; // Updated with atomic adds
+};
+
+static void stats_add(uint64_t* counter, uint64_t value) {
+    __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+// Verify one request and produce its response (worker thread)
+static void process_request(discord_interactions_t* server, EVP_MD_CTX* md, interaction_request_t* request) {
+    const char* body = request->message + request->timestamp_length;
+    size_t body_length = request->message_length - request->timestamp_length;
+
+    if (!request->signature_present ||
+        !verify_message(md, server->public_key, request->signature, request->message, request->message_length)) {
+        stats_add(&server->stats.rejected, 1);
+        set_response(request, HTTP_STATUS_UNAUTHORIZED, "text/plain",
+                     unauthorized_response, sizeof(unauthorized_response) - 1);
+        return;
+    }
+    stats_add(&server->stats.verified, 1);
+
+    // PING (type 1) is answered here; nested "type" keys don't count
+    int type = 0;
+    if (discord_json_parse_root_int(body, body_length, "type", &type) == DISCORD_OK && type == 1) {
+        stats_add(&server->stats.pings, 1);
+        set_response(request, HTTP_STATUS_OK, "application/json", pong_response, sizeof(pong_response) - 1);
+        return;
+    }
+
+    discord_event_t event;
+    event.opcode = 0;
+    event.data = (char*)body;
+    event.data_length = body_length;
+    event.sequence = -1;
+    event.event_type = interaction_event_type;
+
+    request->status = 0;
+    current_request = request;
+    discord_dispatch_event(&event);
+    current_request = NULL;
+    stats_add(&server->stats.dispatched, 1);
+
+    if (request->status == 0) {
+        set_response(request, HTTP_STATUS_INTERNAL_SERVER_ERROR, "text/plain",
+                     no_response, sizeof(no_response) - 1);
+    }
+}
+
+static void* interactions_worker(void* arg) {
+    discord_interactions_t* server = arg;
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+
+    for (;;) {
+        // Take a batch of pending requests
+        pthread_mutex_lock(&server->lock);
+        while (!server->pending_head && !server->stopping) {
+            pthread_cond_wait(&server->work_ready, &server->lock);
+        }
+        if (server->stopping) {
+            pthread_mutex_unlock(&server->lock);
+            break;
+        }
+
+        interaction_request_t* batch = server->pending_head;
+        interaction_request_t* last = batch;
+        for (int n = 1; n < DISCORD_INTERACTIONS_BATCH && last->next; n++) {
+            last = last->next;
+        }
+        server->pending_head = last->next;
+        if (!server->pending_head) {
+            server->pending_tail = NULL;
+        }
+        last->next = NULL;
+        pthread_mutex_unlock(&server->lock);
+
+        stats_add(&server->stats.batches, 1);
+        for (interaction_request_t* r = batch; r; r = r->next) {
+            if (md) {
+                process_request(server, md, r);
+            } else {
+                set_response(r, HTTP_STATUS_SERVICE_UNAVAILABLE, "text/plain", no_response, sizeof(no_response) - 1);
+            }
+        }
+
+        // Hand the whole batch back to the service thread at once
+        pthread_mutex_lock(&server->lock);
+        last->next = server->done;
+        server->done = batch;
+        pthread_mutex_unlock(&server->lock);
+        lws_cancel_service(server->context);
+    }
+
+    EVP_MD_CTX_free(md);
+    return NULL;
+}
+
+static void drain_done(discord_interactions_t* server) {
+    pthread_mutex_lock(&server->lock);
+    interaction_request_t* request = server->done;
+    server->done = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    while (request) {
+        interaction_request_t* next = request->next;
+        request->next = NULL;
+        request->in_flight = 0;
+        if (request->orphaned) {
+            free_request(request);
+        } else {
+            lws_callback_on_writable(request->wsi);
+        }
+        request = next;
+    }
+}
+
+static int read_custom_header(struct lws* wsi, const char* name, char* out, int size) {
+#if defined(LWS_WITH_CUSTOM_HEADERS)
+    int name_length = (int)strlen(name);
+    int length = lws_hdr_custom_length(wsi, name, name_length);
+    if (length <= 0 || length >= size) {
+        return -1;
+    }
+    return lws_hdr_custom_copy(wsi, out, size, name, name_length);
+#else
+    (void)wsi; (void)name; (void)out; (void)size;
+    return -1;
+#endif
+}
+
+static int begin_request(struct lws* wsi, interaction_session_t* session, const char* path) {
+    discord_interactions_t* server = lws_context_user(lws_get_context(wsi));
+
+    if (lws_hdr_total_length(wsi, WSI_TOKEN_POST_URI) <= 0) {
+        lws_return_http_status(wsi, HTTP_STATUS_METHOD_NOT_ALLOWED, NULL);
+        return lws_http_transaction_completed(wsi) ? -1 : 0;
+    }
+    if (!path || strcmp(path, server->path) != 0) {
+        lws_return_http_status(wsi, HTTP_STATUS_NOT_FOUND, NULL);
+        return lws_http_transaction_completed(wsi) ? -1 : 0;
+    }
+
+    char length_header[24] = {0};
+    size_t content_length = 0;
+    if (lws_hdr_copy(wsi, length_header, sizeof(length_header), WSI_TOKEN_HTTP_CONTENT_LENGTH) > 0) {
+        content_length = (size_t)strtoull(length_header, NULL, 10);
+    }
+    if (content_length > DISCORD_INTERACTIONS_MAX_BODY) {
+        lws_return_http_status(wsi, HTTP_STATUS_REQ_ENTITY_TOO_LARGE, NULL);
+        return -1;
+    }
+
+    interaction_request_t* request = discord_mem_calloc(DISCORD_MEM_RECEIVE, 1, sizeof(interaction_request_t));
+    if (!request) {
+        return -1;
+    }
+    request->wsi = wsi;
+
+    // Signed message starts with the timestamp; the body is appended to it
+    char timestamp[INTERACTIONS_TIMESTAMP_MAX];
+    int timestamp_length = read_custom_header(wsi, "x-signature-timestamp:", timestamp, sizeof(timestamp));
+    if (timestamp_length < 0) {
+        timestamp_length = 0;
+    }
+
+    char signature[DISCORD_INTERACTIONS_SIG_HEX_LEN + 2];
+    int signature_length = read_custom_header(wsi, "x-signature-ed25519:", signature, sizeof(signature));
+    request->signature_present = timestamp_length > 0 && signature_length > 0 &&
+        decode_hex(signature, (size_t)signature_length, request->signature, sizeof(request->signature));
+
+    request->message_capacity = (size_t)timestamp_length + content_length + 1;
+    request->message = discord_mem_alloc(DISCORD_MEM_RECEIVE, request->message_capacity);
+    if (!request->message) {
+        free_request(request);
+        return -1;
+    }
+    memcpy(request->message, timestamp, (size_t)timestamp_length);
+    request->timestamp_length = (size_t)timestamp_length;
+    request->message_length = (size_t)timestamp_length;
+
+    session->request = request;
+    return 0;
+}
+
+static int append_body(interaction_request_t* request, const void* in, size_t length) {
+    size_t required = request->message_length + length + 1;
+    if (required - request->timestamp_length > DISCORD_INTERACTIONS_MAX_BODY + 1) {
+        return -1;
+    }
+    if (required > request->message_capacity) {
+        // No or wrong Content-Length
+        size_t capacity = required * 2;
+        char* message = discord_mem_realloc(DISCORD_MEM_RECEIVE, request->message, capacity);
+        if (!message) {
+            return -1;
+        }
+        request->message = message;
+        request->message_capacity = capacity;
+    }
+    memcpy(request->message + request->message_length, in, length);
+    request->message_length += length;
+    return 0;
+}
+
+static int write_response(struct lws* wsi, interaction_session_t* session) {
+    interaction_request_t* request = session->request;
+    if (!request || request->in_flight || request->status == 0) {
+        return 0;
+    }
+
+    unsigned char headers[LWS_PRE + 256];
+    unsigned char* start = headers + LWS_PRE;
+    unsigned char* p = start;
+    unsigned char* end = headers + sizeof(headers) - 1;
+
+    if (lws_add_http_common_headers(wsi, (unsigned int)request->status, request->content_type,
+                                    request->response_length, &p, end) ||
+        lws_finalize_write_http_header(wsi, start, &p, end)) {
+        return -1;
+    }
+
+    // Body goes out of the request's own buffer (LWS_PRE headroom reserved)
+    if (request->response_length > 0 &&
+        lws_write(wsi, request->response + LWS_PRE, request->response_length, LWS_WRITE_HTTP_FINAL) < 0) {
+        return -1;
+    }
+
+    free_request(request);
+    session->request = NULL;
+    return lws_http_transaction_completed(wsi) ? -1 : 0;
+}
+
+static int interactions_callback(struct lws* wsi, enum lws_callback_reasons reason,
+                                 void* user, void* in, size_t len) {
+    interaction_session_t* session = (interaction_session_t*)user;
+    discord_interactions_t* server;
+
+    switch (reason) {
+        case LWS_CALLBACK_HTTP:
+            return begin_request(wsi, session, (const char*)in);
+
+        case LWS_CALLBACK_HTTP_BODY:
+            if (session && session->request && in && len > 0) {
+                if (append_body(session->request, in, len) != 0) {
+                    lws_return_http_status(wsi, HTTP_STATUS_REQ_ENTITY_TOO_LARGE, NULL);
+                    return -1;
+                }
+            }
+            break;
+
+        case LWS_CALLBACK_HTTP_BODY_COMPLETION:
+            if (session && session->request) {
+                server = lws_context_user(lws_get_context(wsi));
+                interaction_request_t* request = session->request;
+                request->message[request->message_length] = '\0';
+                request->in_flight = 1;
+                stats_add(&server->stats.requests, 1);
+
+                pthread_mutex_lock(&server->lock);
+                if (server->pending_tail) {
+                    server->pending_tail->next = request;
+                } else {
+                    server->pending_head = request;
+                }
+                server->pending_tail = request;
+                pthread_cond_signal(&server->work_ready);
+                pthread_mutex_unlock(&server->lock);
+            }
+            break;
+
+        case LWS_CALLBACK_HTTP_WRITEABLE:
+            if (session) {
+                return write_response(wsi, session);
+            }
+            break;
+
+        case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+            server = lws_context_user(lws_get_context(wsi));
+            if (server) {
+                drain_done(server);
+            }
+            break;
+
+        case LWS_CALLBACK_CLOSED_HTTP:
+            if (session && session->request) {
+                // A worker may still hold it; the drain frees it then
+                if (session->request->in_flight) {
+                    session->request->orphaned = 1;
+                } else {
+                    free_request(session->request);
+                }
+                session->request = NULL;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static struct lws_protocols interaction_protocols[] = {
+    {
+        "http",
+        interactions_callback,
+        sizeof(interaction_session_t),
+        0,
+        0, NULL, 0
+    },
+    { NULL, NULL, 0, 0, 0, NULL, 0 } // terminator
+};
+
+discord_result_t discord_interactions_start(const discord_interactions_config_t* config, discord_interactions_t** server) {
+    if (!config || !server || !config->public_key || config->port <= 0 || config->worker_threads < 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+#if !defined(LWS_WITH_CUSTOM_HEADERS)
+    // Signature headers are not standard headers; lws needs custom header support
+    return DISCORD_ERROR_UNSUPPORTED;
+#endif
+
+    const char* path = config->path ? config->path : INTERACTIONS_DEFAULT_PATH;
+    if (strlen(path) >= sizeof(((discord_interactions_t*)0)->path)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_interactions_t* s = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_interactions_t));
+    if (!s) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    strcpy(s->path, path);
+    s->public_key = load_public_key(config->public_key);
+    if (!s->public_key) {
+        discord_mem_free(s);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work_ready, NULL);
+
+    struct lws_context_creation_info ctx_info = {0};
+    ctx_info.port = config->port;
+    ctx_info.protocols = interaction_protocols;
+    ctx_info.gid = -1;
+    ctx_info.uid = -1;
+    ctx_info.user = s;
+    if (config->tls_cert_path && config->tls_key_path) {
+        ctx_info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+        ctx_info.ssl_cert_filepath = config->tls_cert_path;
+        ctx_info.ssl_private_key_filepath = config->tls_key_path;
+    }
+
+    s->context = lws_create_context(&ctx_info);
+    if (!s->context) {
+        discord_interactions_stop(s);
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    s->worker_count = config->worker_threads ? config->worker_threads : INTERACTIONS_DEFAULT_WORKERS;
+    s->workers = discord_mem_calloc(DISCORD_MEM_OTHER, (size_t)s->worker_count, sizeof(pthread_t));
+    if (!s->workers) {
+        s->worker_count = 0;
+        discord_interactions_stop(s);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    for (int i = 0; i < s->worker_count; i++) {
+        if (pthread_create(&s->workers[i], NULL, interactions_worker, s) != 0) {
+            s->worker_count = i;
+            discord_interactions_stop(s);
+            return DISCORD_ERROR_MEMORY;
+        }
+    }
+
+    *server = s;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_interactions_service(discord_interactions_t* server, int timeout_ms) {
+    if (!server || !server->context) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    if (lws_service(server->context, timeout_ms) < 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    return DISCORD_OK;
+}
+
+discord_result_t discord_interactions_get_stats(discord_interactions_t* server, discord_interactions_stats_t* stats) {
+    if (!server || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    stats->requests = __atomic_load_n(&server->stats.requests, __ATOMIC_RELAXED);
+    stats->verified = __atomic_load_n(&server->stats.verified, __ATOMIC_RELAXED);
+    stats->rejected = __atomic_load_n(&server->stats.rejected, __ATOMIC_RELAXED);
+    stats->pings = __atomic_load_n(&server->stats.pings, __ATOMIC_RELAXED);
+    stats->dispatched = __atomic_load_n(&server->stats.dispatched, __ATOMIC_RELAXED);
+    stats->batches = __atomic_load_n(&server->stats.batches, __ATOMIC_RELAXED);
+    return DISCORD_OK;
+}
+
+void discord_interactions_stop(discord_interactions_t* server) {
+    if (!server) {
+        return;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    server->stopping = 1;
+    pthread_cond_broadcast(&server->work_ready);
+    pthread_mutex_unlock(&server->lock);
+
+    for (int i = 0; i < server->worker_count; i++) {
+        pthread_join(server->workers[i], NULL);
+    }
+    discord_mem_free(server->workers);
+
+    // Closing connections frees idle requests and orphans in-flight ones
+    if (server->context) {
+        lws_context_destroy(server->context);
+    }
+
+    for (interaction_request_t* r = server->pending_head; r;) {
+        interaction_request_t* next = r->next;
+        free_request(r);
+        r = next;
+    }
+    for (interaction_request_t* r = server->done; r;) {
+        interaction_request_t* next = r->next;
+        free_request(r);
+        r = next;
+    }
+
+    EVP_PKEY_free(server->public_key);
+    pthread_mutex_destroy(&server->lock);
+    pthread_cond_destroy(&server->work_ready);
+    discord_mem_free(server);
+}
+
+#else // _WIN32
+
+discord_result_t discord_interactions_start(const discord_interactions_config_t* config, discord_interactions_t** server) {
+    (void)config; (void)server;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_interactions_service(discord_interactions_t* server, int timeout_ms) {
+    (void)server; (void)timeout_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_interactions_get_stats(discord_interactions_t* server, discord_interactions_stats_t* stats) {
+    (void)server; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_interactions_stop(discord_interactions_t* server) {
+    (void)server;
+}
+
+#endif
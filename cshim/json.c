@@ -1,4 +1,6 @@
 #include "abi.h"
+#include "trace.h"
+#include "scan.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -8,17 +10,42 @@
 // Note: This is a minimal implementation focused on Discord Gateway needs
 // For production, consider using a proper JSON library like cJSON
 
+// Helper function to find a pattern using the vectorised pair scan
+static const char* find_pattern(const char* text, size_t text_len, const char* pattern, size_t pattern_len) {
+    const char* p = text;
+    size_t remaining = text_len;
+    
+    while (remaining >= pattern_len) {
+        size_t idx = discord_scan_find_pair(p, remaining, pattern[0], pattern[1]);
+        if (idx == remaining || remaining - idx < pattern_len) {
+            return NULL;
+        }
+        
+        if (memcmp(p + idx, pattern, pattern_len) == 0) {
+            return p + idx;
+        }
+        
+        p += idx + 1;
+        remaining -= idx + 1;
+    }
+    
+    return NULL;
+}
+
 // Helper function to find a JSON value by key
 static const char* find_json_value(const char* json, const char* key, size_t* value_len) {
     if (!json || !key) return NULL;
     
     char search_pattern[256];
-    snprintf(search_pattern, sizeof(search_pattern), "\"%s\":", key);
+    int pattern_len = snprintf(search_pattern, sizeof(search_pattern), "\"%s\":", key);
+    if (pattern_len <= 0 || (size_t)pattern_len >= sizeof(search_pattern)) return NULL;
     
-    const char* key_pos = strstr(json, search_pattern);
+    size_t json_len = strlen(json);
+    const char* json_end = json + json_len;
+    const char* key_pos = find_pattern(json, json_len, search_pattern, (size_t)pattern_len);
     if (!key_pos) return NULL;
     
-    const char* value_start = key_pos + strlen(search_pattern);
+    const char* value_start = key_pos + pattern_len;
     
     // Skip whitespace
     while (*value_start && isspace(*value_start)) {
@@ -33,10 +60,12 @@ static const char* find_json_value(const char* json, const char* key, size_t* va
         // String value
         value_start++; // Skip opening quote
         value_end = value_start;
-        while (*value_end && *value_end != '"') {
-            if (*value_end == '\\') value_end++; // Skip escaped character
-            value_end++;
+        while (value_end < json_end) {
+            value_end += discord_scan_quote_or_escape(value_end, (size_t)(json_end - value_end));
+            if (value_end >= json_end || *value_end == '"') break;
+            value_end += 2; // Skip escaped character
         }
+        if (value_end > json_end) value_end = json_end;
     } else if (*value_start == '{') {
         // Object value
         int brace_count = 1;
@@ -87,6 +116,7 @@ discord_result_t discord_json_parse_opcode(const char* json, int* opcode) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
     
+    DISCORD_TRACE_BEGIN(trace_parse);
     size_t value_len;
     const char* op_value = find_json_value(json, "op", &value_len);
     if (!op_value) {
@@ -94,6 +124,7 @@ discord_result_t discord_json_parse_opcode(const char* json, int* opcode) {
     }
     
     *opcode = extract_int(op_value, value_len);
+    DISCORD_TRACE_END(trace_parse, DISCORD_TRACE_JSON_PARSE, *opcode);
     return DISCORD_OK;
 }
 
@@ -110,7 +141,7 @@ discord_result_t discord_json_parse_hello(const char* json, int* heartbeat_inter
     }
     
     // Create a null-terminated copy of the data object to parse
-    char* d_copy = malloc(d_len + 1);
+    char* d_copy = discord_mem_alloc(DISCORD_MEM_JSON, d_len + 1);
     if (!d_copy) {
         return DISCORD_ERROR_MEMORY;
     }
@@ -123,18 +154,302 @@ discord_result_t discord_json_parse_hello(const char* json, int* heartbeat_inter
     const char* interval_value = find_json_value(d_copy, "heartbeat_interval", &interval_len);
     
     if (!interval_value) {
-        free(d_copy);
+        discord_mem_free(d_copy);
         return DISCORD_ERROR_JSON;
     }
     
     *heartbeat_interval = extract_int(interval_value, interval_len);
-    free(d_copy);
+    discord_mem_free(d_copy);
+    
+    return DISCORD_OK;
+}
+
+discord_result_t discord_json_parse_sequence(const char* json, int* sequence) {
+    if (!json || !sequence) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    
+    DISCORD_TRACE_BEGIN(trace_parse);
+    size_t value_len;
+    const char* s_value = find_json_value(json, "s", &value_len);
+    if (!s_value) {
+        return DISCORD_ERROR_JSON;
+    }
+    
+    // Non-dispatch payloads carry "s":null
+    if (value_len == 4 && memcmp(s_value, "null", 4) == 0) {
+        *sequence = -1;
+    } else {
+        *sequence = extract_int(s_value, value_len);
+    }
+    
+    DISCORD_TRACE_END(trace_parse, DISCORD_TRACE_JSON_PARSE, 0);
+    return DISCORD_OK;
+}
+
+int discord_json_match_event(const char* json, const char* event_type) {
+    if (!json || !event_type) {
+        return 0;
+    }
+    
+    size_t value_len;
+    const char* t_value = find_json_value(json, "t", &value_len);
+    if (!t_value || t_value == json || t_value[-1] != '"') {
+        return 0; // Missing or "t":null
+    }
+    
+    return strlen(event_type) == value_len && memcmp(t_value, event_type, value_len) == 0;
+}
+
+discord_result_t discord_json_parse_envelope(const char* json, int* opcode, int* sequence,
+                                            char* event_type, size_t event_type_size,
+                                            const char** data, size_t* data_length) {
+    if (!json || !opcode || !sequence || !event_type || event_type_size == 0 ||
+        !data || !data_length) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    
+    discord_result_t result = discord_json_parse_opcode(json, opcode);
+    if (result != DISCORD_OK) {
+        return result;
+    }
+    
+    DISCORD_TRACE_BEGIN(trace_parse);
+    size_t value_len;
+    const char* value = find_json_value(json, "s", &value_len);
+    if (value && !(value_len == 4 && memcmp(value, "null", 4) == 0)) {
+        *sequence = extract_int(value, value_len);
+    } else {
+        *sequence = -1;
+    }
+    
+    // Event name is copied so it can be handed out NUL-terminated
+    event_type[0] = '\0';
+    value = find_json_value(json, "t", &value_len);
+    if (value && value != json && value[-1] == '"') {
+        if (value_len >= event_type_size) {
+            return DISCORD_ERROR_JSON;
+        }
+        memcpy(event_type, value, value_len);
+        event_type[value_len] = '\0';
+    }
+    
+    // Payload is a view into the frame, not a copy
+    value = find_json_value(json, "d", &value_len);
+    *data = value;
+    *data_length = value ? value_len : 0;
+    
+    DISCORD_TRACE_END(trace_parse, DISCORD_TRACE_JSON_PARSE, *opcode);
+    return DISCORD_OK;
+}
+
+// Helper function to skip past a string starting at the opening quote
+static const char* skip_json_string(const char* p, const char* end) {
+    p++;
+    while (p < end) {
+        p += discord_scan_quote_or_escape(p, (size_t)(end - p));
+        if (p >= end) return end;
+        if (*p == '"') return p + 1;
+        p += 2; // Skip escaped character
+    }
+    return end;
+}
+
+discord_result_t discord_json_parse_root_int(const char* json, size_t length, const char* key, int* value) {
+    if (!json || !key || !value) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    
+    // Walk the document tracking depth so keys of nested objects
+    // (e.g. "channel":{"type":1}) never match a top-level key
+    size_t key_len = strlen(key);
+    const char* end = json + length;
+    const char* p = json;
+    int depth = 0;
+    
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            const char* name = p + 1;
+            p = skip_json_string(p, end);
+            if (depth != 1 || (size_t)(p - name) != key_len + 1 || memcmp(name, key, key_len) != 0) {
+                continue;
+            }
+            
+            while (p < end && isspace((unsigned char)*p)) p++;
+            if (p >= end || *p != ':') continue; // A string value, not a key
+            p++;
+            while (p < end && isspace((unsigned char)*p)) p++;
+            
+            const char* number = p;
+            if (p < end && *p == '-') p++;
+            while (p < end && isdigit((unsigned char)*p)) p++;
+            if (p == number || (p == number + 1 && *number == '-')) {
+                return DISCORD_ERROR_JSON;
+            }
+            
+            *value = extract_int(number, (size_t)(p - number));
+            return DISCORD_OK;
+        }
+        
+        if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') depth--;
+        p++;
+    }
+    
+    return DISCORD_ERROR_NOT_FOUND;
+}
+
+// Helper function to skip past one value (string, number, literal,
+// object or array) starting at its first character
+static const char* skip_json_value(const char* p, const char* end) {
+    if (p >= end) return end;
+    if (*p == '"') return skip_json_string(p, end);
+    
+    if (*p != '{' && *p != '[') {
+        while (p < end && !isspace((unsigned char)*p) &&
+               *p != ',' && *p != '}' && *p != ']') {
+            p++;
+        }
+        return p;
+    }
+    
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            p = skip_json_string(p, end);
+            continue;
+        }
+        if (c == '{' || c == '[') depth++;
+        else if ((c == '}' || c == ']') && --depth == 0) return p + 1;
+        p++;
+    }
+    return end;
+}
+
+discord_result_t discord_json_object_next(const char** cursor, const char* end,
+                                          const char** key, size_t* key_length,
+                                          const char** value, size_t* value_length) {
+    if (!cursor || !*cursor || !end || !key || !key_length || !value || !value_length) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    
+    const char* p = *cursor;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p < end && (*p == '{' || *p == ',')) p++;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p >= end || *p == '}') {
+        *cursor = p;
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+    if (*p != '"') {
+        return DISCORD_ERROR_JSON;
+    }
+    
+    const char* name = p + 1;
+    p = skip_json_string(p, end);
+    *key = name;
+    *key_length = (size_t)(p - name) - 1;
+    
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p >= end || *p != ':') {
+        return DISCORD_ERROR_JSON;
+    }
+    p++;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p >= end) {
+        return DISCORD_ERROR_JSON;
+    }
     
+    *value = p;
+    p = skip_json_value(p, end);
+    *value_length = (size_t)(p - *value);
+    *cursor = p;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_json_array_next(const char** cursor, const char* end,
+                                         const char** element, size_t* element_length) {
+    if (!cursor || !*cursor || !end || !element || !element_length) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    
+    const char* p = *cursor;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p < end && (*p == '[' || *p == ',')) p++;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p >= end || *p == ']') {
+        *cursor = p;
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+    
+    *element = p;
+    p = skip_json_value(p, end);
+    *element_length = (size_t)(p - *element);
+    *cursor = p;
+    return DISCORD_OK;
+}
+
+// Helper function to copy a string value out of a JSON object
+static char* dup_json_string(const char* json, const char* key) {
+    size_t value_len;
+    const char* value = find_json_value(json, key, &value_len);
+    if (!value || value == json || value[-1] != '"') {
+        return NULL;
+    }
+    
+    char* copy = discord_mem_alloc(DISCORD_MEM_JSON, value_len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    
+    memcpy(copy, value, value_len);
+    copy[value_len] = '\0';
+    return copy;
+}
+
+discord_result_t discord_json_parse_ready(const char* json, char** session_id, char** resume_gateway_url) {
+    if (!json || !session_id || !resume_gateway_url) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    
+    size_t d_len;
+    const char* d_value = find_json_value(json, "d", &d_len);
+    if (!d_value) {
+        return DISCORD_ERROR_JSON;
+    }
+    
+    char* d_copy = discord_mem_alloc(DISCORD_MEM_JSON, d_len + 1);
+    if (!d_copy) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    
+    memcpy(d_copy, d_value, d_len);
+    d_copy[d_len] = '\0';
+    
+    char* id = dup_json_string(d_copy, "session_id");
+    char* url = dup_json_string(d_copy, "resume_gateway_url");
+    discord_mem_free(d_copy);
+    
+    if (!id || !url) {
+        discord_mem_free(id);
+        discord_mem_free(url);
+        return DISCORD_ERROR_JSON;
+    }
+    
+    *session_id = id;
+    *resume_gateway_url = url;
     return DISCORD_OK;
 }
 
 discord_result_t discord_json_create_identify(const char* token, char** json_out) {
-    if (!token || !json_out) {
+    return discord_json_create_identify_sharded(token, 0, 0, json_out);
+}
+
+discord_result_t discord_json_create_identify_sharded(const char* token, int shard_id, int shard_count,
+                                                      char** json_out) {
+    if (!token || !json_out || shard_count < 0 || (shard_count > 0 && (shard_id < 0 || shard_id >= shard_count))) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
     
@@ -143,17 +458,24 @@ discord_result_t discord_json_create_identify(const char* token, char** json_out
     size_t base_len = 512; // Base JSON structure
     size_t total_len = base_len + token_len;
     
-    char* json = malloc(total_len);
+    char* json = discord_mem_alloc(DISCORD_MEM_JSON, total_len);
     if (!json) {
         return DISCORD_ERROR_MEMORY;
     }
     
+    // "shard":[id,count] only when sharding
+    char shard[48] = "";
+    if (shard_count > 0) {
+        snprintf(shard, sizeof(shard), "\"shard\":[%d,%d],", shard_id, shard_count);
+    }
+    
     int result = snprintf(json, total_len,
         "{"
         "\"op\":2,"
         "\"d\":{"
             "\"token\":\"%s\","
             "\"intents\":%d,"
+            "%s"
             "\"properties\":{"
                 "\"os\":\"discord-asm\","
                 "\"browser\":\"discord-asm\","
@@ -162,11 +484,12 @@ discord_result_t discord_json_create_identify(const char* token, char** json_out
         "}"
         "}",
         token,
-        513 // GUILD_MESSAGES + DIRECT_MESSAGES (basic intents)
+        513, // GUILD_MESSAGES + DIRECT_MESSAGES (basic intents)
+        shard
     );
     
     if (result < 0 || (size_t)result >= total_len) {
-        free(json);
+        discord_mem_free(json);
         return DISCORD_ERROR_JSON;
     }
     
@@ -179,7 +502,7 @@ discord_result_t discord_json_create_heartbeat(int sequence, char** json_out) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
     
-    char* json = malloc(64);
+    char* json = discord_mem_alloc(DISCORD_MEM_JSON, 64);
     if (!json) {
         return DISCORD_ERROR_MEMORY;
     }
@@ -192,7 +515,41 @@ discord_result_t discord_json_create_heartbeat(int sequence, char** json_out) {
     }
     
     if (result < 0 || result >= 64) {
-        free(json);
+        discord_mem_free(json);
+        return DISCORD_ERROR_JSON;
+    }
+    
+    *json_out = json;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_json_create_resume(const char* token, const char* session_id, int sequence, char** json_out) {
+    if (!token || !session_id || !json_out) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    
+    size_t total_len = 128 + strlen(token) + strlen(session_id);
+    char* json = discord_mem_alloc(DISCORD_MEM_JSON, total_len);
+    if (!json) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    
+    int result = snprintf(json, total_len,
+        "{"
+        "\"op\":6,"
+        "\"d\":{"
+            "\"token\":\"%s\","
+            "\"session_id\":\"%s\","
+            "\"seq\":%d"
+        "}"
+        "}",
+        token,
+        session_id,
+        sequence
+    );
+    
+    if (result < 0 || (size_t)result >= total_len) {
+        discord_mem_free(json);
         return DISCORD_ERROR_JSON;
     }
     
@@ -202,6 +559,6 @@ discord_result_t discord_json_create_heartbeat(int sequence, char** json_out) {
 
 void discord_json_free(char* json) {
     if (json) {
-        free(json);
+        discord_mem_free(json);
     }
 }
\ No newline at end of file
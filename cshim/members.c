@@ -0,0 +1,519 @@
+#include "abi.h"
+#include "dispatch.h"
+#include "members.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Guild member request tracker
+// Requests live in a fixed table of slots: QUEUED until the token bucket
+// has a send for them, then SENT until the last chunk arrives or they stall
+// past the timeout. Chunks are parsed in place: one pass over the top-level
+// keys of d to find the nonce and chunk counters, one pass over the members
+// array to hand each element to the sink.
+
+#define MEMBERS_ID_MAX      32                  // Snowflakes are at most 20 digits
+#define MEMBERS_TOKEN       1000000ull          // Bucket fixed point: one send
+
+typedef enum {
+    MEMBERS_SLOT_FREE = 0,
+    MEMBERS_SLOT_QUEUED,
+    MEMBERS_SLOT_SENT
+} members_slot_state_t;
+
+typedef struct {
+    members_slot_state_t state;
+    uint64_t order;                 // Queue position among QUEUED slots
+    char nonce[DISCORD_MEMBERS_NONCE_MAX];
+    char guild_id[MEMBERS_ID_MAX];
+    char* payload;                  // op 8 JSON until sent
+    size_t payload_length;
+    discord_members_sink_t sink;
+    discord_members_done_t done;
+    void* user;
+    uint64_t requested_ns;
+    uint64_t sent_ns;
+    uint64_t last_activity_ms;      // Send or latest chunk
+    uint64_t members;
+    uint64_t not_found;
+    uint32_t chunks;
+    uint32_t chunk_count;
+    size_t largest_chunk;
+} members_slot_t;
+
+struct discord_members {
+    discord_gateway_t* gateway;
+    discord_members_send_t send;
+    void* send_user;
+    uint32_t refill_per_window;     // Sends added per window on top of the burst
+    uint32_t burst;
+    uint32_t timeout_ms;
+    uint64_t tokens;                // In MEMBERS_TOKEN units
+    uint64_t refilled_at_ms;
+    uint64_t next_order;
+    uint64_t nonce_seed;
+    uint32_t nonce_counter;
+    discord_members_stats_t stats;
+    members_slot_t slots[DISCORD_MEMBERS_MAX_PENDING];
+};
+
+static discord_members_t* attached_members = NULL;
+
+static int valid_snowflake(const char* id) {
+    size_t len = id ? strlen(id) : 0;
+    if (len == 0 || len >= MEMBERS_ID_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (id[i] < '0' || id[i] > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Append a JSON string literal (quoted and escaped); returns bytes written
+// or 0 when out of space
+static size_t put_json_string(char* out, size_t capacity, const char* value) {
+    size_t pos = 0;
+    if (capacity < 2) return 0;
+    out[pos++] = '"';
+    for (const unsigned char* p = (const unsigned char*)value; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            if (pos + 2 >= capacity) return 0;
+            out[pos++] = '\\';
+            out[pos++] = (char)*p;
+        } else if (*p < 0x20) {
+            if (pos + 6 >= capacity) return 0;
+            pos += (size_t)snprintf(out + pos, capacity - pos, "\\u%04x", *p);
+        } else {
+            if (pos + 1 >= capacity) return 0;
+            out[pos++] = (char)*p;
+        }
+    }
+    if (pos + 1 >= capacity) return 0;
+    out[pos++] = '"';
+    out[pos] = '\0';
+    return pos;
+}
+
+static discord_result_t build_payload(const discord_members_request_t* request, const char* nonce,
+                                      char** payload, size_t* payload_length) {
+    const char* query = request->query ? request->query : "";
+    size_t capacity = 192 + 6 * strlen(query) + request->user_id_count * (MEMBERS_ID_MAX + 3);
+    char* json = discord_mem_alloc(DISCORD_MEM_SEND, capacity);
+    if (!json) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    size_t pos = (size_t)snprintf(json, capacity, "{\"op\":%d,\"d\":{\"guild_id\":\"%s\",",
+                                  DISCORD_OP_REQUEST_MEMBERS, request->guild_id);
+
+    if (request->user_id_count > 0) {
+        pos += (size_t)snprintf(json + pos, capacity - pos, "\"user_ids\":[");
+        for (size_t i = 0; i < request->user_id_count; i++) {
+            pos += (size_t)snprintf(json + pos, capacity - pos, "%s\"%s\"",
+                                    i ? "," : "", request->user_ids[i]);
+        }
+        pos += (size_t)snprintf(json + pos, capacity - pos, "],");
+    } else {
+        pos += (size_t)snprintf(json + pos, capacity - pos, "\"query\":");
+        size_t written = put_json_string(json + pos, capacity - pos, query);
+        if (written == 0) {
+            discord_mem_free(json);
+            return DISCORD_ERROR_MEMORY;
+        }
+        pos += written;
+        pos += (size_t)snprintf(json + pos, capacity - pos, ",\"limit\":%u,", request->limit);
+    }
+
+    int written = snprintf(json + pos, capacity - pos, "\"presences\":%s,\"nonce\":\"%s\"}}",
+                           request->presences ? "true" : "false", nonce);
+    if (written < 0 || (size_t)written >= capacity - pos) {
+        discord_mem_free(json);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    *payload = json;
+    *payload_length = pos + (size_t)written;
+    return DISCORD_OK;
+}
+
+static void refill(discord_members_t* members, uint64_t now_ms) {
+    if (now_ms <= members->refilled_at_ms) {
+        return;
+    }
+
+    uint64_t limit = (uint64_t)members->burst * MEMBERS_TOKEN;
+    uint64_t added = (now_ms - members->refilled_at_ms) * members->refill_per_window * MEMBERS_TOKEN /
+                     DISCORD_GATEWAY_SEND_WINDOW_MS;
+    members->tokens = members->tokens + added > limit ? limit : members->tokens + added;
+    members->refilled_at_ms = now_ms;
+}
+
+static void finish_slot(discord_members_t* members, members_slot_t* slot, discord_result_t outcome) {
+    // Copy out before the slot is released so done() may queue a new request
+    char nonce[DISCORD_MEMBERS_NONCE_MAX];
+    char guild_id[MEMBERS_ID_MAX];
+    memcpy(nonce, slot->nonce, sizeof(nonce));
+    memcpy(guild_id, slot->guild_id, sizeof(guild_id));
+
+    discord_members_result_t result;
+    result.guild_id = guild_id;
+    result.nonce = nonce;
+    result.result = outcome;
+    result.members = slot->members;
+    result.not_found = slot->not_found;
+    result.chunks = slot->chunks;
+    result.chunk_count = slot->chunk_count;
+    result.queued_ns = slot->sent_ns - slot->requested_ns;
+    result.elapsed_ns = discord_time_now_ns() - slot->requested_ns;
+    result.largest_chunk = slot->largest_chunk;
+
+    discord_members_done_t done = slot->done;
+    void* user = slot->user;
+
+    members->stats.in_flight--;
+    if (outcome == DISCORD_OK) {
+        members->stats.completed++;
+    } else {
+        members->stats.timed_out++;
+    }
+    memset(slot, 0, sizeof(*slot));
+
+    if (done) {
+        done(user, &result);
+    }
+}
+
+discord_result_t discord_members_create(const discord_members_config_t* config, discord_members_t** members) {
+    if (!config || !members || (!config->gateway && !config->send)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t per_minute = config->sends_per_minute ? config->sends_per_minute : DISCORD_MEMBERS_SENDS_PER_MINUTE;
+    uint32_t burst = config->burst ? config->burst : DISCORD_MEMBERS_BURST;
+    if (per_minute > DISCORD_GATEWAY_SEND_LIMIT || burst >= per_minute) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_members_t* m = discord_mem_calloc(DISCORD_MEM_SEND, 1, sizeof(*m));
+    if (!m) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    // A full bucket plus one window of refill never exceeds per_minute,
+    // so no 60 s window sees more sends than that
+    m->gateway = config->gateway;
+    m->send = config->send;
+    m->send_user = config->send_user;
+    m->burst = burst;
+    m->refill_per_window = per_minute - burst;
+    m->timeout_ms = config->timeout_ms ? config->timeout_ms : DISCORD_MEMBERS_TIMEOUT_MS;
+    m->tokens = (uint64_t)burst * MEMBERS_TOKEN;
+    m->refilled_at_ms = discord_time_now_ms();
+    m->nonce_seed = discord_time_now_ns() ^ (uint64_t)(uintptr_t)m;
+
+    *members = m;
+    return DISCORD_OK;
+}
+
+void discord_members_destroy(discord_members_t* members) {
+    if (!members) {
+        return;
+    }
+
+    if (attached_members == members) {
+        discord_members_attach(NULL);
+    }
+
+    for (size_t i = 0; i < DISCORD_MEMBERS_MAX_PENDING; i++) {
+        discord_mem_free(members->slots[i].payload);
+    }
+    discord_mem_free(members);
+}
+
+discord_result_t discord_members_request(discord_members_t* members, const discord_members_request_t* request,
+                                         char nonce_out[DISCORD_MEMBERS_NONCE_MAX]) {
+    if (!members || !request || !valid_snowflake(request->guild_id) ||
+        request->user_id_count > DISCORD_MEMBERS_MAX_USER_IDS ||
+        (request->user_id_count > 0 && !request->user_ids)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    for (size_t i = 0; i < request->user_id_count; i++) {
+        if (!valid_snowflake(request->user_ids[i])) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+    }
+
+    members_slot_t* slot = NULL;
+    for (size_t i = 0; i < DISCORD_MEMBERS_MAX_PENDING; i++) {
+        if (members->slots[i].state == MEMBERS_SLOT_FREE) {
+            slot = &members->slots[i];
+            break;
+        }
+    }
+    if (!slot) {
+        return DISCORD_ERROR_MEMORY; // Too many requests outstanding
+    }
+
+    snprintf(slot->nonce, sizeof(slot->nonce), "%016llx%08x",
+             (unsigned long long)members->nonce_seed, ++members->nonce_counter);
+
+    discord_result_t result = build_payload(request, slot->nonce, &slot->payload, &slot->payload_length);
+    if (result != DISCORD_OK) {
+        memset(slot, 0, sizeof(*slot));
+        return result;
+    }
+
+    snprintf(slot->guild_id, sizeof(slot->guild_id), "%s", request->guild_id);
+    slot->sink = request->sink;
+    slot->done = request->done;
+    slot->user = request->user;
+    slot->order = members->next_order++;
+    slot->requested_ns = discord_time_now_ns();
+    slot->state = MEMBERS_SLOT_QUEUED;
+
+    members->stats.requests++;
+    members->stats.queued++;
+
+    if (nonce_out) {
+        memcpy(nonce_out, slot->nonce, DISCORD_MEMBERS_NONCE_MAX);
+    }
+
+    result = discord_members_poll(members, discord_time_now_ms(), NULL);
+    return result == DISCORD_ERROR_NETWORK ? DISCORD_OK : result; // Stays queued for the next poll
+}
+
+discord_result_t discord_members_poll(discord_members_t* members, uint64_t now_ms, uint32_t* wait_ms) {
+    if (!members) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_result_t result = DISCORD_OK;
+    refill(members, now_ms);
+
+    while (members->stats.queued > 0 && members->tokens >= MEMBERS_TOKEN) {
+        members_slot_t* next = NULL;
+        for (size_t i = 0; i < DISCORD_MEMBERS_MAX_PENDING; i++) {
+            members_slot_t* slot = &members->slots[i];
+            if (slot->state == MEMBERS_SLOT_QUEUED && (!next || slot->order < next->order)) {
+                next = slot;
+            }
+        }
+
+        discord_result_t sent = members->send
+            ? members->send(members->send_user, next->payload, next->payload_length)
+            : discord_ws_send(members->gateway, next->payload, next->payload_length);
+        if (sent != DISCORD_OK) {
+            result = DISCORD_ERROR_NETWORK;
+            break;
+        }
+
+        members->tokens -= MEMBERS_TOKEN;
+        discord_mem_free(next->payload);
+        next->payload = NULL;
+        next->state = MEMBERS_SLOT_SENT;
+        next->sent_ns = discord_time_now_ns();
+        next->last_activity_ms = now_ms;
+        members->stats.sent++;
+        members->stats.queued--;
+        members->stats.in_flight++;
+    }
+
+    for (size_t i = 0; i < DISCORD_MEMBERS_MAX_PENDING; i++) {
+        members_slot_t* slot = &members->slots[i];
+        if (slot->state == MEMBERS_SLOT_SENT && now_ms >= slot->last_activity_ms + members->timeout_ms) {
+            finish_slot(members, slot, DISCORD_ERROR_TIMEOUT);
+        }
+    }
+
+    if (wait_ms) {
+        if (members->stats.queued == 0 || members->tokens >= MEMBERS_TOKEN) {
+            *wait_ms = 0;
+        } else {
+            uint64_t missing = MEMBERS_TOKEN - members->tokens;
+            uint64_t per_window = (uint64_t)members->refill_per_window * MEMBERS_TOKEN;
+            *wait_ms = (uint32_t)((missing * DISCORD_GATEWAY_SEND_WINDOW_MS + per_window - 1) / per_window);
+        }
+    }
+
+    return result;
+}
+
+static uint32_t token_to_u32(const char* value, size_t length) {
+    uint32_t n = 0;
+    for (size_t i = 0; i < length && value[i] >= '0' && value[i] <= '9'; i++) {
+        n = n * 10 + (uint32_t)(value[i] - '0');
+    }
+    return n;
+}
+
+discord_result_t discord_members_handle_chunk(discord_members_t* members, const char* data, size_t length) {
+    if (!members || !data) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    const char* end = data + length;
+    const char* cursor = data;
+    const char* key;
+    const char* value;
+    size_t key_length;
+    size_t value_length;
+    const char* nonce = NULL;
+    size_t nonce_length = 0;
+    const char* member_array = NULL;
+    size_t member_array_length = 0;
+    const char* not_found = NULL;
+    size_t not_found_length = 0;
+    uint32_t chunk_count = 0;
+    discord_result_t result;
+
+    while ((result = discord_json_object_next(&cursor, end, &key, &key_length,
+                                              &value, &value_length)) == DISCORD_OK) {
+        if (key_length == 5 && memcmp(key, "nonce", 5) == 0 && value_length >= 2 && value[0] == '"') {
+            nonce = value + 1;
+            nonce_length = value_length - 2;
+        } else if (key_length == 7 && memcmp(key, "members", 7) == 0 && value[0] == '[') {
+            member_array = value;
+            member_array_length = value_length;
+        } else if (key_length == 9 && memcmp(key, "not_found", 9) == 0 && value[0] == '[') {
+            not_found = value;
+            not_found_length = value_length;
+        } else if (key_length == 11 && memcmp(key, "chunk_count", 11) == 0) {
+            chunk_count = token_to_u32(value, value_length);
+        }
+    }
+    if (result != DISCORD_ERROR_NOT_FOUND) {
+        return result;
+    }
+
+    members_slot_t* slot = NULL;
+    if (nonce && nonce_length < DISCORD_MEMBERS_NONCE_MAX) {
+        for (size_t i = 0; i < DISCORD_MEMBERS_MAX_PENDING; i++) {
+            members_slot_t* candidate = &members->slots[i];
+            if (candidate->state == MEMBERS_SLOT_SENT && strlen(candidate->nonce) == nonce_length &&
+                memcmp(candidate->nonce, nonce, nonce_length) == 0) {
+                slot = candidate;
+                break;
+            }
+        }
+    }
+    if (!slot) {
+        members->stats.unmatched++;
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    const char* element;
+    size_t element_length;
+    if (member_array) {
+        const char* array_end = member_array + member_array_length;
+        cursor = member_array;
+        while (discord_json_array_next(&cursor, array_end, &element, &element_length) == DISCORD_OK) {
+            if (slot->sink) {
+                slot->sink(slot->user, slot->guild_id, element, element_length);
+            }
+            slot->members++;
+            members->stats.members++;
+        }
+    }
+    if (not_found) {
+        const char* array_end = not_found + not_found_length;
+        cursor = not_found;
+        while (discord_json_array_next(&cursor, array_end, &element, &element_length) == DISCORD_OK) {
+            slot->not_found++;
+        }
+    }
+
+    slot->chunks++;
+    slot->chunk_count = chunk_count ? chunk_count : 1;
+    slot->last_activity_ms = discord_time_now_ms();
+    if (length > slot->largest_chunk) {
+        slot->largest_chunk = length;
+    }
+    members->stats.chunks++;
+
+    if (slot->chunks >= slot->chunk_count) {
+        finish_slot(members, slot, DISCORD_OK);
+    }
+
+    return DISCORD_OK;
+}
+
+static void on_members_chunk(const discord_event_t* event) {
+    if (attached_members && event->data) {
+        discord_members_handle_chunk(attached_members, event->data, event->data_length);
+    }
+}
+
+discord_result_t discord_members_attach(discord_members_t* members) {
+    attached_members = members;
+    return discord_dispatch_on("GUILD_MEMBERS_CHUNK", members ? on_members_chunk : NULL);
+}
+
+discord_result_t discord_members_get_stats(discord_members_t* members, discord_members_stats_t* stats) {
+    if (!members || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    *stats = members->stats;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_members_cache_init(discord_members_cache_t* cache, discord_session_t* session) {
+    if (!cache || !session) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // Clear every page so stale records from an earlier run cannot follow ours
+    void* page;
+    size_t size;
+    uint32_t pages = 0;
+    while (discord_session_cache_page(session, pages, &page, &size) == DISCORD_OK) {
+        memset(page, 0, size);
+        pages++;
+    }
+    if (pages == 0) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    memset(cache, 0, sizeof(*cache));
+    cache->session = session;
+    return DISCORD_OK;
+}
+
+void discord_members_cache_sink(void* user, const char* guild_id, const char* member, size_t member_length) {
+    (void)guild_id;
+    discord_members_cache_t* cache = user;
+
+    void* page;
+    size_t size;
+    if (discord_session_cache_page(cache->session, cache->page, &page, &size) != DISCORD_OK) {
+        cache->dropped++;
+        return;
+    }
+
+    // Records never straddle pages; a zero length (from the cleared page)
+    // marks where this page's data stops
+    size_t record = sizeof(uint32_t) + member_length;
+    if (record > size - sizeof(uint32_t)) {
+        cache->dropped++;
+        return;
+    }
+    if (cache->offset + record > size - sizeof(uint32_t)) {
+        if (discord_session_cache_page(cache->session, cache->page + 1, &page, &size) != DISCORD_OK) {
+            cache->dropped++;
+            return;
+        }
+        cache->page++;
+        cache->offset = 0;
+    }
+
+    uint32_t length32 = (uint32_t)member_length;
+    unsigned char* out = (unsigned char*)page + cache->offset;
+    memcpy(out, &length32, sizeof(length32));
+    memcpy(out + sizeof(length32), member, member_length);
+    cache->offset += record;
+    cache->records++;
+}
@@ -0,0 +1,303 @@
+#include "abi.h"
+#include "module.h"
+#include "internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Handler module loader
+// Loads are serialized by module_lock and run on the caller's thread (or
+// the watcher's), never the gateway's: dispatch keeps running on the old
+// table until the new one is swapped in, and the old module is closed only
+// after the swap drained. dlopen returns the already-loaded object for a
+// path it has seen, so each load opens a private copy of the file, unlinked
+// as soon as it is mapped.
+
+typedef struct {
+    void* handle;
+    const discord_module_t* module;
+    struct discord_dispatch_module* table;
+} loaded_module_t;
+
+static discord_lock_t module_lock = DISCORD_LOCK_INIT;
+static loaded_module_t current;
+static void* module_state = NULL;
+static discord_module_stats_t module_stats;
+
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t watch_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t watch_thread;
+static int watching = 0;
+static int watch_stop = 0;
+static char watch_path[PATH_MAX];
+static uint32_t watch_interval_ms = 1000;
+static struct stat watch_seen;
+static int watch_have_seen = 0;
+
+// Copy path next to itself (or into TMPDIR when its directory is read-only)
+static discord_result_t copy_module(const char* path, char* copy, size_t size) {
+    int in = open(path, O_RDONLY);
+    if (in < 0) {
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    const char* tmp = getenv("TMPDIR");
+    int out = -1;
+    for (int attempt = 0; attempt < 2 && out < 0; attempt++) {
+        if (attempt == 0) {
+            snprintf(copy, size, "%s.%d.%llu", path, (int)getpid(),
+                     (unsigned long long)module_stats.generation + 1);
+        } else {
+            snprintf(copy, size, "%s/discord-module.%d.%llu.so", tmp ? tmp : "/tmp", (int)getpid(),
+                     (unsigned long long)module_stats.generation + 1);
+        }
+        out = open(copy, O_WRONLY | O_CREAT | O_TRUNC, 0700);
+    }
+    if (out < 0) {
+        close(in);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    char buffer[65536];
+    ssize_t n;
+    discord_result_t result = DISCORD_OK;
+    while ((n = read(in, buffer, sizeof(buffer))) != 0) {
+        if (n < 0 || write(out, buffer, (size_t)n) != n) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            result = DISCORD_ERROR_MEMORY;
+            break;
+        }
+    }
+    close(in);
+    if (close(out) != 0 || result != DISCORD_OK) {
+        unlink(copy);
+        return DISCORD_ERROR_MEMORY;
+    }
+    return DISCORD_OK;
+}
+
+static void close_module(loaded_module_t* loaded, void** state) {
+    if (loaded->module->fini) {
+        loaded->module->fini(state);
+    }
+    dlclose(loaded->handle);
+    discord_dispatch_module_free(loaded->table);
+}
+
+// Swap next in (NULL = none) and close what it replaced once drained
+static void swap_module(const loaded_module_t* next, void** final_state) {
+    struct discord_dispatch_module* previous = NULL;
+    uint64_t start = discord_time_now_ns();
+    discord_result_t drained = discord_dispatch_module_swap(next ? next->table : NULL,
+                                                            DISCORD_MODULE_DRAIN_MS, &previous);
+    module_stats.last_swap_ns = discord_time_now_ns() - start;
+
+    if (current.handle) {
+        if (drained == DISCORD_OK) {
+            close_module(&current, final_state);
+        } else {
+            // A handler is still running in it: leave it mapped for good
+            module_stats.stranded++;
+        }
+    }
+
+    if (next) {
+        current = *next;
+        module_stats.loaded = 1;
+        snprintf(module_stats.name, sizeof(module_stats.name), "%s", next->module->name ? next->module->name : "");
+    } else {
+        memset(&current, 0, sizeof(current));
+        module_stats.loaded = 0;
+        module_stats.name[0] = '\0';
+    }
+}
+
+// Count a rejected load and keep its reason for discord_module_get_stats
+// (caller holds module_lock, released here)
+static discord_result_t load_failed(discord_result_t result, const char* reason) {
+    module_stats.failures++;
+    snprintf(module_stats.last_error, sizeof(module_stats.last_error), "%s", reason);
+    discord_unlock(&module_lock);
+    return result;
+}
+
+discord_result_t discord_module_load(const char* path) {
+    if (!path) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_lock(&module_lock);
+
+    char copy[PATH_MAX + 64];
+    discord_result_t result = copy_module(path, copy, sizeof(copy));
+    if (result != DISCORD_OK) {
+        return load_failed(result, result == DISCORD_ERROR_NOT_FOUND ? "cannot open the module file" :
+                                                                        "cannot copy the module file");
+    }
+
+    loaded_module_t next = {0};
+    next.handle = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+    unlink(copy);
+    if (!next.handle) {
+        const char* reason = dlerror();
+        return load_failed(DISCORD_ERROR_INVALID_PARAM, reason ? reason : "dlopen failed");
+    }
+
+    discord_module_entry_t entry;
+    *(void**)&entry = dlsym(next.handle, DISCORD_MODULE_ENTRY);
+    next.module = entry ? entry() : NULL;
+    const char* reason = NULL;
+    if (!next.module) {
+        result = DISCORD_ERROR_INVALID_PARAM;
+        reason = entry ? DISCORD_MODULE_ENTRY " returned NULL" : "no " DISCORD_MODULE_ENTRY " symbol";
+    } else if (next.module->abi_version != DISCORD_MODULE_ABI_VERSION) {
+        result = DISCORD_ERROR_UNSUPPORTED;
+        reason = "unsupported module ABI version";
+    } else {
+        result = discord_dispatch_module_create(next.module, &next.table);
+        reason = "invalid handler table";
+    }
+    if (result == DISCORD_OK && next.module->init && next.module->init(&module_state) != 0) {
+        discord_dispatch_module_free(next.table);
+        result = DISCORD_ERROR_INVALID_PARAM;
+        reason = "init failed";
+    }
+    if (result != DISCORD_OK) {
+        dlclose(next.handle);
+        return load_failed(result, reason);
+    }
+
+    swap_module(&next, NULL);
+    module_stats.generation++;
+    module_stats.loads++;
+    discord_unlock(&module_lock);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_module_unload(void) {
+    discord_lock(&module_lock);
+    if (current.handle) {
+        swap_module(NULL, &module_state);
+    }
+    discord_unlock(&module_lock);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_module_get_stats(discord_module_stats_t* stats) {
+    if (!stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_lock(&module_lock);
+    *stats = module_stats;
+    discord_unlock(&module_lock);
+    return DISCORD_OK;
+}
+
+// Deploys replace the file (rename) or rewrite it: either changes one of
+// these. Inode numbers are reused right away, so times are compared to the
+// nanosecond.
+static int file_changed(const struct stat* a, const struct stat* b) {
+    return a->st_ino != b->st_ino || a->st_dev != b->st_dev || a->st_size != b->st_size ||
+           a->st_mtim.tv_sec != b->st_mtim.tv_sec || a->st_mtim.tv_nsec != b->st_mtim.tv_nsec ||
+           a->st_ctim.tv_sec != b->st_ctim.tv_sec || a->st_ctim.tv_nsec != b->st_ctim.tv_nsec;
+}
+
+static void* watch_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&watch_lock);
+    while (!watch_stop) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += watch_interval_ms / 1000;
+        until.tv_nsec += (long)(watch_interval_ms % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&watch_wake, &watch_lock, &until);
+        if (watch_stop) {
+            break;
+        }
+
+        struct stat now;
+        if (stat(watch_path, &now) != 0 || (watch_have_seen && !file_changed(&watch_seen, &now))) {
+            continue;
+        }
+        watch_seen = now;
+        watch_have_seen = 1;
+
+        pthread_mutex_unlock(&watch_lock);
+        discord_module_load(watch_path);
+        pthread_mutex_lock(&watch_lock);
+    }
+    pthread_mutex_unlock(&watch_lock);
+    return NULL;
+}
+
+discord_result_t discord_module_watch(const char* path, uint32_t interval_ms) {
+    if (path && strlen(path) >= sizeof(watch_path)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&watch_lock);
+    int was_watching = watching;
+    watch_stop = 1;
+    watching = 0;
+    pthread_cond_broadcast(&watch_wake);
+    pthread_mutex_unlock(&watch_lock);
+    if (was_watching) {
+        pthread_join(watch_thread, NULL);
+    }
+    if (!path) {
+        return DISCORD_OK;
+    }
+
+    pthread_mutex_lock(&watch_lock);
+    strcpy(watch_path, path);
+    // Whatever is there now counts as loaded; only later changes reload
+    watch_have_seen = stat(watch_path, &watch_seen) == 0;
+    watch_interval_ms = interval_ms ? interval_ms : 1000;
+    watch_stop = 0;
+    watching = pthread_create(&watch_thread, NULL, watch_main, NULL) == 0;
+    pthread_mutex_unlock(&watch_lock);
+    return watching ? DISCORD_OK : DISCORD_ERROR_MEMORY;
+}
+
+#else
+
+discord_result_t discord_module_load(const char* path) {
+    (void)path;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_module_unload(void) {
+    return DISCORD_OK;
+}
+
+discord_result_t discord_module_watch(const char* path, uint32_t interval_ms) {
+    (void)path; (void)interval_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_module_get_stats(discord_module_stats_t* stats) {
+    if (!stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    memset(stats, 0, sizeof(*stats));
+    return DISCORD_OK;
+}
+
+#endif
@@ -0,0 +1,464 @@
+#include "abi.h"
+#include "structs.h"
+#include "dispatch.h"
+#include "qos.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Dispatch QoS scheduler
+// One ring per class, FIFO within the class. Every class has a single
+// deadline budget, so the head of each ring is its earliest deadline and
+// EDF across classes only compares DISCORD_QOS_CLASS_COUNT heads.
+//
+// Coalescing classes keep a direct-mapped index from key hash to queue
+// position. A stale or colliding index slot just means a missed merge;
+// positions only grow, so a slot is valid when it still points inside the
+// ring and the entry there carries the same hash.
+
+#define QOS_TYPE_MASK       (DISCORD_QOS_TYPE_TABLE_SIZE - 1)
+#define QOS_INITIAL_RING    256
+
+typedef struct {
+    char name[DISCORD_EVENT_TYPE_MAX];
+    size_t name_len;
+    uint32_t hash;
+    discord_qos_class_t cls;
+    char key[DISCORD_QOS_KEY_MAX];  // Coalesce key path ("" = none)
+} qos_type_t;
+
+typedef struct {
+    char* block;                    // event_type NUL, then d NUL
+    size_t data_length;
+    int opcode;
+    int sequence;
+    uint64_t key_hash;              // 0 = no key
+    uint64_t arrived_ns;
+    uint64_t deadline_ns;
+} qos_entry_t;
+
+typedef struct {
+    discord_qos_class_config_t config;
+    qos_entry_t* ring;
+    size_t capacity;                // Power of two
+    uint64_t head_pos;              // Position of the oldest entry
+    size_t count;
+    uint64_t* index;                // Coalesce index: position + 1 (2x capacity)
+    discord_qos_class_stats_t stats;
+} qos_lane_t;
+
+struct discord_qos {
+    qos_type_t types[DISCORD_QOS_TYPE_TABLE_SIZE];
+    qos_lane_t lanes[DISCORD_QOS_CLASS_COUNT];
+    uint32_t pending;
+    uint32_t drained;               // Frames pulled since the last batch
+};
+
+static discord_qos_t* attached_qos = NULL;
+
+static uint32_t type_hash(const char* name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t key_hash(const char* event_type, const char* value, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* p = event_type; *p; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ull;
+    }
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)value[i];
+        hash *= 1099511628211ull;
+    }
+    return hash ? hash : 1;
+}
+
+static qos_type_t* type_find(discord_qos_t* qos, const char* name, size_t len, int insert) {
+    uint32_t hash = type_hash(name, len);
+    for (uint32_t probe = 0; probe < DISCORD_QOS_TYPE_TABLE_SIZE; probe++) {
+        qos_type_t* slot = &qos->types[(hash + probe) & QOS_TYPE_MASK];
+
+        if (slot->name_len == 0) {
+            if (!insert) {
+                return NULL;
+            }
+            memcpy(slot->name, name, len);
+            slot->name[len] = '\0';
+            slot->name_len = len;
+            slot->hash = hash;
+            return slot;
+        }
+
+        if (slot->hash == hash && slot->name_len == len && memcmp(slot->name, name, len) == 0) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+// Raw value of the key path in d ("a" or "a.b"), or NULL
+static const char* find_key(const char* data, size_t length, const char* path, size_t* value_length) {
+    const char* dot = strchr(path, '.');
+    size_t first_len = dot ? (size_t)(dot - path) : strlen(path);
+
+    const char* cursor = data;
+    const char* end = data + length;
+    const char* key;
+    const char* value;
+    size_t key_length;
+
+    while (discord_json_object_next(&cursor, end, &key, &key_length, &value, value_length) == DISCORD_OK) {
+        if (key_length != first_len || memcmp(key, path, first_len) != 0) {
+            continue;
+        }
+        if (!dot) {
+            return value;
+        }
+        if (value[0] != '{') {
+            return NULL;
+        }
+        return find_key(value, *value_length, dot + 1, value_length);
+    }
+
+    return NULL;
+}
+
+static qos_entry_t* lane_entry(qos_lane_t* lane, uint64_t pos) {
+    return &lane->ring[pos & (lane->capacity - 1)];
+}
+
+static void lane_index_put(qos_lane_t* lane, uint64_t pos, uint64_t hash) {
+    if (lane->index && hash) {
+        lane->index[hash & (2 * lane->capacity - 1)] = pos + 1;
+    }
+}
+
+static qos_entry_t* lane_index_find(qos_lane_t* lane, uint64_t hash) {
+    if (!lane->index || !hash) {
+        return NULL;
+    }
+
+    uint64_t slot = lane->index[hash & (2 * lane->capacity - 1)];
+    if (slot == 0 || slot - 1 < lane->head_pos || slot - 1 >= lane->head_pos + lane->count) {
+        return NULL;
+    }
+
+    qos_entry_t* entry = lane_entry(lane, slot - 1);
+    return entry->key_hash == hash ? entry : NULL;
+}
+
+static discord_result_t lane_grow(qos_lane_t* lane, int coalescing) {
+    size_t capacity = lane->capacity ? lane->capacity * 2 : QOS_INITIAL_RING;
+    qos_entry_t* ring = discord_mem_alloc(DISCORD_MEM_DISPATCH, capacity * sizeof(qos_entry_t));
+    uint64_t* index = coalescing ? discord_mem_calloc(DISCORD_MEM_DISPATCH, 2 * capacity, sizeof(uint64_t)) : NULL;
+    if (!ring || (coalescing && !index)) {
+        discord_mem_free(ring);
+        discord_mem_free(index);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < lane->count; i++) {
+        uint64_t pos = lane->head_pos + i;
+        ring[pos & (capacity - 1)] = *lane_entry(lane, pos);
+    }
+
+    discord_mem_free(lane->ring);
+    discord_mem_free(lane->index);
+    lane->ring = ring;
+    lane->capacity = capacity;
+    lane->index = index;
+
+    for (size_t i = 0; i < lane->count; i++) {
+        uint64_t pos = lane->head_pos + i;
+        lane_index_put(lane, pos, lane_entry(lane, pos)->key_hash);
+    }
+    return DISCORD_OK;
+}
+
+static void lane_drop_head(discord_qos_t* qos, qos_lane_t* lane) {
+    discord_mem_free(lane_entry(lane, lane->head_pos)->block);
+    lane->head_pos++;
+    lane->count--;
+    lane->stats.shed++;
+    qos->pending--;
+}
+
+static void lane_clear(qos_lane_t* lane) {
+    for (size_t i = 0; i < lane->count; i++) {
+        discord_mem_free(lane_entry(lane, lane->head_pos + i)->block);
+    }
+    discord_mem_free(lane->ring);
+    discord_mem_free(lane->index);
+    lane->ring = NULL;
+    lane->index = NULL;
+    lane->capacity = 0;
+    lane->count = 0;
+}
+
+discord_result_t discord_qos_create(discord_qos_t** qos) {
+    if (!qos) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_qos_t* q = discord_mem_calloc(DISCORD_MEM_DISPATCH, 1, sizeof(*q));
+    if (!q) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    q->lanes[DISCORD_QOS_CRITICAL].config = (discord_qos_class_config_t){ 250, 0, DISCORD_QOS_KEEP };
+    q->lanes[DISCORD_QOS_HIGH].config = (discord_qos_class_config_t){ 1000, 0, DISCORD_QOS_KEEP };
+    q->lanes[DISCORD_QOS_NORMAL].config = (discord_qos_class_config_t){ 5000, 0, DISCORD_QOS_KEEP };
+    q->lanes[DISCORD_QOS_LOW].config = (discord_qos_class_config_t){ 10000, 1024, DISCORD_QOS_COALESCE };
+
+    discord_qos_classify(q, "INTERACTION_CREATE", DISCORD_QOS_CRITICAL, NULL);
+    discord_qos_classify(q, "PRESENCE_UPDATE", DISCORD_QOS_LOW, "user.id");
+    discord_qos_classify(q, "TYPING_START", DISCORD_QOS_LOW, "user_id");
+
+    *qos = q;
+    return DISCORD_OK;
+}
+
+void discord_qos_destroy(discord_qos_t* qos) {
+    if (!qos) {
+        return;
+    }
+
+    if (attached_qos == qos) {
+        attached_qos = NULL; // Queued events are dropped, not dispatched
+    }
+
+    for (int i = 0; i < DISCORD_QOS_CLASS_COUNT; i++) {
+        lane_clear(&qos->lanes[i]);
+    }
+    discord_mem_free(qos);
+}
+
+discord_result_t discord_qos_set_class(discord_qos_t* qos, discord_qos_class_t cls, const discord_qos_class_config_t* config) {
+    if (!qos || !config || (unsigned)cls >= DISCORD_QOS_CLASS_COUNT ||
+        (unsigned)config->policy > DISCORD_QOS_COALESCE) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // The coalesce index is built with the ring, so policy changes wait
+    // for an empty lane
+    qos_lane_t* lane = &qos->lanes[cls];
+    if (lane->count > 0 && config->policy != lane->config.policy) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (lane->count == 0) {
+        lane_clear(lane);
+    }
+
+    lane->config = *config;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_qos_classify(discord_qos_t* qos, const char* event_type, discord_qos_class_t cls,
+                                      const char* coalesce_key) {
+    if (!qos || !event_type || (unsigned)cls >= DISCORD_QOS_CLASS_COUNT ||
+        (coalesce_key && strlen(coalesce_key) >= DISCORD_QOS_KEY_MAX)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    size_t len = strlen(event_type);
+    if (len == 0 || len >= DISCORD_EVENT_TYPE_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    qos_type_t* slot = type_find(qos, event_type, len, 1);
+    if (!slot) {
+        return DISCORD_ERROR_MEMORY; // Table full
+    }
+
+    slot->cls = cls;
+    if (coalesce_key) {
+        memcpy(slot->key, coalesce_key, strlen(coalesce_key) + 1);
+    } else {
+        slot->key[0] = '\0';
+    }
+    return DISCORD_OK;
+}
+
+discord_result_t discord_qos_attach(discord_qos_t* qos) {
+    discord_qos_t* previous = attached_qos;
+    attached_qos = qos;
+
+    if (previous && previous != qos) {
+        while (discord_qos_run(previous, UINT32_MAX) > 0) {
+        }
+    }
+    return DISCORD_OK;
+}
+
+static int qos_enqueue(discord_qos_t* qos, const discord_event_t* event) {
+    size_t type_len = strlen(event->event_type);
+    qos_type_t* type = type_find(qos, event->event_type, type_len, 0);
+    discord_qos_class_t cls = type ? type->cls : DISCORD_QOS_NORMAL;
+    qos_lane_t* lane = &qos->lanes[cls];
+    discord_qos_policy_t policy = lane->config.policy;
+    int saturated = lane->config.high_water > 0 && lane->count >= lane->config.high_water;
+
+    if (saturated && policy == DISCORD_QOS_SHED_NEWEST) {
+        lane->stats.enqueued++;
+        lane->stats.shed++;
+        return 1;
+    }
+
+    uint64_t hash = 0;
+    if (policy == DISCORD_QOS_COALESCE && type && type->key[0] && event->data) {
+        size_t value_length;
+        const char* value = find_key(event->data, event->data_length, type->key, &value_length);
+        if (value) {
+            hash = key_hash(event->event_type, value, value_length);
+        }
+    }
+
+    char* block = discord_mem_alloc(DISCORD_MEM_DISPATCH, type_len + 1 + event->data_length + 1);
+    if (!block) {
+        return 0; // Dispatch inline rather than lose the event
+    }
+    memcpy(block, event->event_type, type_len + 1);
+    if (event->data_length) {
+        memcpy(block + type_len + 1, event->data, event->data_length);
+    }
+    block[type_len + 1 + event->data_length] = '\0';
+
+    lane->stats.enqueued++;
+
+    if (saturated && policy == DISCORD_QOS_COALESCE) {
+        qos_entry_t* existing = lane_index_find(lane, hash);
+        if (existing) {
+            // Newest payload, original place in line and deadline
+            discord_mem_free(existing->block);
+            existing->block = block;
+            existing->data_length = event->data_length;
+            existing->opcode = event->opcode;
+            existing->sequence = event->sequence;
+            lane->stats.coalesced++;
+            return 1;
+        }
+    }
+
+    if (saturated && policy != DISCORD_QOS_KEEP) {
+        lane_drop_head(qos, lane);
+    }
+
+    if (lane->count == lane->capacity &&
+        lane_grow(lane, policy == DISCORD_QOS_COALESCE) != DISCORD_OK) {
+        discord_mem_free(block);
+        lane->stats.enqueued--;
+        return 0;
+    }
+
+    uint64_t now = discord_time_now_ns();
+    uint64_t pos = lane->head_pos + lane->count;
+    qos_entry_t* entry = lane_entry(lane, pos);
+    entry->block = block;
+    entry->data_length = event->data_length;
+    entry->opcode = event->opcode;
+    entry->sequence = event->sequence;
+    entry->key_hash = hash;
+    entry->arrived_ns = now;
+    entry->deadline_ns = now + (uint64_t)lane->config.deadline_ms * 1000000ull;
+    lane_index_put(lane, pos, hash);
+    lane->count++;
+    qos->pending++;
+
+    if (lane->count > lane->stats.max_depth) {
+        lane->stats.max_depth = (uint32_t)lane->count;
+    }
+    return 1;
+}
+
+int discord_qos_offer(const discord_event_t* event) {
+    discord_qos_t* qos = attached_qos;
+    if (!qos || !event || !event->event_type || event->event_type[0] == '\0') {
+        return 0;
+    }
+    return qos_enqueue(qos, event);
+}
+
+uint32_t discord_qos_pending(void) {
+    return attached_qos ? attached_qos->pending : 0;
+}
+
+void discord_qos_poll(int idle) {
+    discord_qos_t* qos = attached_qos;
+    if (qos && (idle || ++qos->drained >= DISCORD_QOS_DRAIN_MAX)) {
+        qos->drained = 0;
+        discord_qos_run(qos, DISCORD_QOS_BATCH);
+    }
+
+    // Batched handlers (dispatch.h) hang off the same loop hook
+    discord_dispatch_poll(idle);
+}
+
+uint32_t discord_qos_run(discord_qos_t* qos, uint32_t max_events) {
+    if (!qos) {
+        return 0;
+    }
+
+    uint32_t dispatched = 0;
+    while (dispatched < max_events && qos->pending > 0) {
+        qos_lane_t* lane = NULL;
+        for (int i = 0; i < DISCORD_QOS_CLASS_COUNT; i++) {
+            qos_lane_t* candidate = &qos->lanes[i];
+            if (candidate->count > 0 &&
+                (!lane || lane_entry(candidate, candidate->head_pos)->deadline_ns <
+                          lane_entry(lane, lane->head_pos)->deadline_ns)) {
+                lane = candidate;
+            }
+        }
+
+        qos_entry_t entry = *lane_entry(lane, lane->head_pos);
+        lane->head_pos++;
+        lane->count--;
+        qos->pending--;
+
+        uint64_t now = discord_time_now_ns();
+        if (now > entry.deadline_ns) {
+            if (lane->config.policy != DISCORD_QOS_KEEP) {
+                discord_mem_free(entry.block);
+                lane->stats.shed++;
+                continue;
+            }
+            lane->stats.late++;
+        }
+
+        size_t type_len = strlen(entry.block);
+        discord_event_t event;
+        event.opcode = entry.opcode;
+        event.sequence = entry.sequence;
+        event.event_type = entry.block;
+        event.data = entry.block + type_len + 1;
+        event.data_length = entry.data_length;
+
+        discord_dispatch_event(&event);
+        discord_mem_free(entry.block);
+
+        if (now - entry.arrived_ns > lane->stats.max_wait_ns) {
+            lane->stats.max_wait_ns = now - entry.arrived_ns;
+        }
+        lane->stats.dispatched++;
+        dispatched++;
+    }
+
+    return dispatched;
+}
+
+discord_result_t discord_qos_get_stats(discord_qos_t* qos, discord_qos_stats_t* stats) {
+    if (!qos || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < DISCORD_QOS_CLASS_COUNT; i++) {
+        stats->classes[i] = qos->lanes[i].stats;
+        stats->classes[i].depth = (uint32_t)qos->lanes[i].count;
+    }
+    return DISCORD_OK;
+}
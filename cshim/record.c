@@ -0,0 +1,454 @@
+#include "abi.h"
+#include "structs.h"
+#include "dispatch.h"
+#include "scan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#else
+    #include <io.h>
+#endif
+
+// Binary frame capture and replay
+// File layout (host byte order):
+//   header: uint32 magic "DREC", uint32 version, uint64 capture start (ms, wall clock)
+//   record: uint32 length, uint32 flags, uint64 ns since first frame, payload[length]
+
+#define RECORD_MAGIC        0x43455244u  // "DREC"
+#define RECORD_VERSION      1u
+#define RECORD_FILE_HEADER  16
+#define RECORD_FRAME_HEADER 16
+#define RECORD_FLAG_BINARY  0x1u
+
+struct discord_recorder {
+    FILE* file;
+    uint64_t start_ns;
+    uint64_t base_ns;               // Last timestamp already in an appended capture
+    uint64_t frames;
+    char* scratch;                  // Redaction copy, grown on demand
+    size_t scratch_size;
+};
+
+struct discord_replay {
+    const unsigned char* data;
+    size_t size;
+    size_t frame_count;
+    int mapped;
+    char* scratch;                  // NUL-terminated copy handed to the parser
+    size_t scratch_size;
+};
+
+static void put_u32(unsigned char* out, uint32_t value) {
+    memcpy(out, &value, sizeof(value));
+}
+
+static void put_u64(unsigned char* out, uint64_t value) {
+    memcpy(out, &value, sizeof(value));
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+static uint64_t get_u64(const unsigned char* in) {
+    uint64_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+// Find the next "token" key in [data, data+length)
+static const char* find_token_key(const char* data, size_t length) {
+    static const char key[] = "\"token\"";
+    const size_t key_len = sizeof(key) - 1;
+
+    size_t i = 0;
+    while (i + key_len <= length) {
+        i += discord_scan_find_pair(data + i, length - i, '"', 't');
+        if (i + key_len > length) {
+            break;
+        }
+        if (memcmp(data + i, key, key_len) == 0) {
+            return data + i;
+        }
+        i++;
+    }
+
+    return NULL;
+}
+
+// Overwrite every "token":"..." string value with '*' (same length)
+static void redact_tokens(char* data, size_t length) {
+    char* end = data + length;
+    const char* key = find_token_key(data, length);
+
+    while (key) {
+        char* p = (char*)key + 7;
+        while (p < end && (*p == ' ' || *p == ':' || *p == '\t')) {
+            p++;
+        }
+
+        if (p < end && *p == '"') {
+            p++;
+            while (p < end && *p != '"') {
+                if (*p == '\\' && p + 1 < end) {
+                    *p++ = '*';
+                }
+                *p++ = '*';
+            }
+        }
+
+        key = find_token_key(p, (size_t)(end - p));
+    }
+}
+
+static int truncate_file(FILE* file, long size) {
+    fflush(file);
+#ifndef _WIN32
+    return ftruncate(fileno(file), (off_t)size);
+#else
+    return _chsize_s(_fileno(file), size) == 0 ? 0 : -1;
+#endif
+}
+
+discord_result_t discord_record_open(const char* path, discord_recorder_t** recorder) {
+    if (!path || !recorder) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    FILE* file = fopen(path, "a+b");
+    if (!file) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_recorder_t* rec = discord_mem_calloc(DISCORD_MEM_RECEIVE, 1, sizeof(discord_recorder_t));
+    if (!rec) {
+        fclose(file);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    rec->file = file;
+
+    // New captures get a header; appending to an existing one keeps its header
+    // and continues from its last timestamp, so paced replays never go back.
+    // A record torn by a crashed recorder is cut off, or every frame
+    // appended after it would be lost to replay
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    if (size > 0) {
+        unsigned char header[RECORD_FILE_HEADER];
+        if (size < RECORD_FILE_HEADER || fseek(file, 0, SEEK_SET) != 0 ||
+            fread(header, sizeof(header), 1, file) != 1 ||
+            get_u32(header) != RECORD_MAGIC || get_u32(header + 4) != RECORD_VERSION) {
+            fclose(file);
+            discord_mem_free(rec);
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+
+        long offset = RECORD_FILE_HEADER;
+        while (offset + RECORD_FRAME_HEADER <= size && fseek(file, offset, SEEK_SET) == 0 &&
+               fread(header, RECORD_FRAME_HEADER, 1, file) == 1) {
+            long end = offset + RECORD_FRAME_HEADER + (long)get_u32(header);
+            if (end > size) {
+                break;
+            }
+            rec->base_ns = get_u64(header + 8);
+            offset = end;
+        }
+        if (offset < size && truncate_file(file, offset) != 0) {
+            fclose(file);
+            discord_mem_free(rec);
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+        fseek(file, 0, SEEK_END);
+    } else {
+        unsigned char header[RECORD_FILE_HEADER];
+        put_u32(header, RECORD_MAGIC);
+        put_u32(header + 4, RECORD_VERSION);
+        put_u64(header + 8, (uint64_t)time(NULL) * 1000);
+        if (fwrite(header, sizeof(header), 1, file) != 1) {
+            fclose(file);
+            discord_mem_free(rec);
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+    }
+
+    *recorder = rec;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_record_frame(discord_recorder_t* recorder, const char* data, size_t length, int is_binary) {
+    if (!recorder || !data || length > UINT32_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t now = discord_time_now_ns();
+    if (recorder->frames == 0) {
+        recorder->start_ns = now;
+    }
+
+    // Only frames that mention a token pay for the redaction copy
+    const char* payload = data;
+    if (!is_binary && find_token_key(data, length)) {
+        if (length > recorder->scratch_size) {
+            char* scratch = discord_mem_realloc(DISCORD_MEM_RECEIVE, recorder->scratch, length);
+            if (!scratch) {
+                return DISCORD_ERROR_MEMORY;
+            }
+            recorder->scratch = scratch;
+            recorder->scratch_size = length;
+        }
+        memcpy(recorder->scratch, data, length);
+        redact_tokens(recorder->scratch, length);
+        payload = recorder->scratch;
+    }
+
+    unsigned char header[RECORD_FRAME_HEADER];
+    put_u32(header, (uint32_t)length);
+    put_u32(header + 4, is_binary ? RECORD_FLAG_BINARY : 0);
+    put_u64(header + 8, recorder->base_ns + (now - recorder->start_ns));
+
+    if (fwrite(header, sizeof(header), 1, recorder->file) != 1 ||
+        (length > 0 && fwrite(payload, length, 1, recorder->file) != 1)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    recorder->frames++;
+    return DISCORD_OK;
+}
+
+void discord_record_close(discord_recorder_t* recorder) {
+    if (!recorder) {
+        return;
+    }
+
+    fclose(recorder->file);
+    discord_mem_free(recorder->scratch);
+    discord_mem_free(recorder);
+}
+
+static discord_result_t replay_load(const char* path, discord_replay_t* replay) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < RECORD_FILE_HEADER) {
+        close(fd);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    replay->data = map;
+    replay->size = (size_t)st.st_size;
+    replay->mapped = 1;
+    return DISCORD_OK;
+#else
+    // No mmap here; read the capture into memory instead
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < RECORD_FILE_HEADER) {
+        fclose(file);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    unsigned char* data = discord_mem_alloc(DISCORD_MEM_RECEIVE, (size_t)size);
+    if (!data || fread(data, (size_t)size, 1, file) != 1) {
+        discord_mem_free(data);
+        fclose(file);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    fclose(file);
+    replay->data = data;
+    replay->size = (size_t)size;
+    replay->mapped = 0;
+    return DISCORD_OK;
+#endif
+}
+
+static void replay_unload(discord_replay_t* replay) {
+#ifndef _WIN32
+    if (replay->mapped) {
+        munmap((void*)replay->data, replay->size);
+        return;
+    }
+#endif
+    discord_mem_free((void*)replay->data);
+}
+
+discord_result_t discord_replay_open(const char* path, discord_replay_t** replay) {
+    if (!path || !replay) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_replay_t* rp = discord_mem_calloc(DISCORD_MEM_RECEIVE, 1, sizeof(discord_replay_t));
+    if (!rp) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    discord_result_t result = replay_load(path, rp);
+    if (result != DISCORD_OK) {
+        discord_mem_free(rp);
+        return result;
+    }
+
+    if (get_u32(rp->data) != RECORD_MAGIC || get_u32(rp->data + 4) != RECORD_VERSION) {
+        replay_unload(rp);
+        discord_mem_free(rp);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // Validate record framing once so replay_run can trust it
+    size_t max_length = 0;
+    size_t offset = RECORD_FILE_HEADER;
+    while (offset + RECORD_FRAME_HEADER <= rp->size) {
+        size_t length = get_u32(rp->data + offset);
+        if (offset + RECORD_FRAME_HEADER + length > rp->size) {
+            break; // Truncated tail from a crashed recorder
+        }
+        if (length > max_length) {
+            max_length = length;
+        }
+        offset += RECORD_FRAME_HEADER + length;
+        rp->frame_count++;
+    }
+
+    rp->scratch_size = max_length + 1;
+    rp->scratch = discord_mem_alloc(DISCORD_MEM_RECEIVE, rp->scratch_size);
+    if (!rp->scratch) {
+        replay_unload(rp);
+        discord_mem_free(rp);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    *replay = rp;
+    return DISCORD_OK;
+}
+
+size_t discord_replay_frame_count(const discord_replay_t* replay) {
+    return replay ? replay->frame_count : 0;
+}
+
+static discord_replay_type_stats_t* replay_type_slot(discord_replay_stats_t* stats, const char* event_type) {
+    for (size_t i = 0; i < stats->type_count; i++) {
+        if (strcmp(stats->types[i].event_type, event_type) == 0) {
+            return &stats->types[i];
+        }
+    }
+
+    if (stats->type_count == DISCORD_REPLAY_MAX_TYPES) {
+        return NULL;
+    }
+
+    discord_replay_type_stats_t* slot = &stats->types[stats->type_count++];
+    size_t length = strlen(event_type);
+    if (length >= sizeof(slot->event_type)) {
+        length = sizeof(slot->event_type) - 1;
+    }
+    memcpy(slot->event_type, event_type, length);
+    slot->event_type[length] = '\0';
+    return slot;
+}
+
+discord_result_t discord_replay_run(discord_replay_t* replay, discord_replay_mode_t mode, discord_replay_stats_t* stats) {
+    if (!replay || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    uint64_t run_start = discord_time_now_ns();
+    size_t offset = RECORD_FILE_HEADER;
+
+    for (size_t n = 0; n < replay->frame_count; n++) {
+        const unsigned char* record = replay->data + offset;
+        size_t length = get_u32(record);
+        uint32_t flags = get_u32(record + 4);
+        uint64_t at_ns = get_u64(record + 8);
+        offset += RECORD_FRAME_HEADER + length;
+
+        if (flags & RECORD_FLAG_BINARY) {
+            continue; // Gateway JSON is always text
+        }
+
+        if (mode == DISCORD_REPLAY_PACED) {
+            uint64_t due = run_start + at_ns;
+            uint64_t now = discord_time_now_ns();
+            if (due > now + 1000000ull) {
+                discord_sleep_ms((uint32_t)((due - now) / 1000000ull));
+            }
+        }
+
+        // Same copy the WebSocket layer makes when handing out a message,
+        // then the live path from there (QoS and every other frame stage)
+        uint64_t t0 = discord_time_now_ns();
+        memcpy(replay->scratch, record + RECORD_FRAME_HEADER, length);
+        replay->scratch[length] = '\0';
+        discord_result_t result = discord_dispatch_frame(replay->scratch);
+        uint64_t elapsed = discord_time_now_ns() - t0;
+
+        // The type is looked up outside the timed section, for the stats only
+        char event_type[DISCORD_EVENT_TYPE_MAX];
+        const char* data = NULL;
+        size_t data_length = 0;
+        int opcode = 0;
+        int sequence = 0;
+        if (result != DISCORD_OK ||
+            discord_json_parse_envelope(replay->scratch, &opcode, &sequence, event_type, sizeof(event_type),
+                                        &data, &data_length) != DISCORD_OK) {
+            stats->errors++;
+            continue;
+        }
+
+        stats->frames++;
+        stats->bytes += length;
+
+        discord_replay_type_stats_t* slot = replay_type_slot(stats, event_type);
+        if (slot) {
+            slot->count++;
+            slot->total_ns += elapsed;
+            if (elapsed > slot->max_ns) {
+                slot->max_ns = elapsed;
+            }
+        }
+    }
+
+    stats->elapsed_ns = discord_time_now_ns() - run_start;
+    if (stats->elapsed_ns > 0) {
+        stats->events_per_sec = (double)stats->frames * 1e9 / (double)stats->elapsed_ns;
+    }
+
+    return DISCORD_OK;
+}
+
+void discord_replay_close(discord_replay_t* replay) {
+    if (!replay) {
+        return;
+    }
+
+    replay_unload(replay);
+    discord_mem_free(replay->scratch);
+    discord_mem_free(replay);
+}
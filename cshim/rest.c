@@ -0,0 +1,1182 @@
+#ifdef __linux__
+    #define _GNU_SOURCE
+#endif
+
+#include "abi.h"
+#include "rest.h"
+#include "internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#ifdef __linux__
+    #include <sys/sendfile.h>
+#endif
+
+// REST client
+// Uploads wait in one FIFO queue. A connection thread takes the first one
+// its bucket and the global budget let through; uploads to a channel stay
+// in order because they share its bucket. A request is written as:
+//   request line and headers, payload_json part      (staged in the buffer)
+//   per file: part header (staged), contents         (sendfile/splice, or
+//                                                     read into the buffer)
+//   closing boundary                                 (staged)
+// The Content-Length is worked out beforehand from the file lengths. The
+// response is read into the same buffer and the body decoded in place.
+
+#define REST_USER_AGENT         "DiscordBot (https://github.com/mateoltd/discord-asm, 0.1.0)"
+#define REST_BOUNDARY_MAX       48
+#define REST_PART_HEADER_MAX    (DISCORD_URL_PATH_MAX + DISCORD_URL_HOST_MAX + 1024)
+#define REST_SENDFILE_MAX       (1u << 30)  // Per sendfile/splice call
+#define REST_RAW_RESERVE        1024        // Receive room kept past a full body (chunk size lines)
+#define REST_UNKNOWN            (-1)
+
+#ifdef MSG_NOSIGNAL
+    #define REST_SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define REST_SEND_FLAGS 0
+#endif
+
+typedef enum {
+    REST_FILE_REGULAR = 0,          // pread/sendfile from offset; can be sent again
+    REST_FILE_PIPE,                 // read/splice; consumed by the first attempt
+    REST_FILE_STREAM                // Anything else readable: read only
+} rest_file_kind_t;
+
+typedef struct {
+    const char* filename;           // In the job's string block
+    const char* content_type;
+    int fd;
+    rest_file_kind_t kind;
+    uint64_t offset;
+    uint64_t length;
+} rest_file_t;
+
+typedef struct rest_job {
+    struct rest_job* next;
+    uint64_t channel_id;
+    uint32_t bucket;                // Index into rest->buckets
+    char* payload_json;             // In the job's string block
+    size_t payload_length;
+    rest_file_t files[DISCORD_REST_MAX_FILES];
+    uint32_t file_count;
+    int streamed;                   // Has a pipe or stream: not sent twice
+    discord_rest_callback_t callback;
+    void* user;
+    uint32_t attempts;
+    uint64_t submitted_ns;
+    uint64_t started_ns;
+} rest_job_t;
+
+typedef struct {
+    uint64_t channel_id;
+    int32_t limit;                  // REST_UNKNOWN until a response said
+    int32_t remaining;              // Sends left before reset_at_ms, counting those in flight
+    uint64_t reset_at_ms;
+    uint64_t window_ms;             // Last Reset-After, for refills before the next response
+    uint32_t in_flight;
+} rest_bucket_t;
+
+// What one attempt came back with
+typedef struct {
+    discord_result_t result;        // Transport outcome
+    int status;
+    int responded;                  // Any response byte arrived
+    int close;                      // Connection: close, or a close-delimited body
+    int32_t limit;
+    int32_t remaining;
+    int64_t reset_after_ms;         // -1 = not sent
+    int64_t retry_after_ms;
+    int global;
+    const char* body;
+    size_t body_length;
+    uint64_t bytes_sent;
+    uint64_t zero_copy_bytes;
+    uint64_t copied_bytes;
+} rest_outcome_t;
+
+typedef struct {
+    discord_rest_t* rest;
+    pthread_t thread;
+    int fd;
+    SSL* ssl;
+    int ktls;
+    uint8_t* buffer;                // chunk_size + 1 (room for a NUL)
+    size_t staged;                  // Request bytes waiting in buffer
+    rest_outcome_t* outcome;        // Attempt being sent
+} rest_conn_t;
+
+struct discord_rest {
+    pthread_mutex_t lock;
+    pthread_cond_t work;            // Connections: queue, buckets or budget changed, or stopping
+    pthread_cond_t idle;            // Flushers: an upload finished
+    rest_job_t* head;
+    rest_job_t* tail;
+    uint32_t in_flight;
+    int stopping;
+
+    rest_bucket_t* buckets;
+    uint32_t bucket_count;
+    uint32_t bucket_capacity;
+    uint32_t global_per_second;
+    uint64_t global_window_ms;      // Start of the current one-second window
+    uint32_t global_sent;           // In that window
+    uint64_t global_blocked_ms;     // Until then after a global 429
+
+    discord_url_t url;
+    char authorization[256];
+    size_t chunk_size;
+    int copy_only;
+    int skip_verify;
+    SSL_CTX* ssl_ctx;
+    uint64_t boundary_seed;
+    uint64_t boundary_count;
+
+    rest_conn_t* connections;
+    uint32_t connection_count;
+    discord_rest_stats_t stats;     // Counters; the gauges are filled in by get_stats
+};
+
+static uint64_t rest_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rest_now_ms(void) {
+    return rest_now_ns() / 1000000ULL;
+}
+
+// Condition waits use the wall clock (the default condvar clock)
+static void rest_wait(pthread_cond_t* cond, pthread_mutex_t* lock, int64_t timeout_ms) {
+    if (timeout_ms < 0) {
+        pthread_cond_wait(cond, lock);
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += (time_t)(timeout_ms / 1000);
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(cond, lock, &ts);
+}
+
+// Text that goes inside a quoted header parameter
+static int rest_header_safe(const char* text) {
+    return text && *text && strpbrk(text, "\"\r\n") == NULL;
+}
+
+// -- Rate limiter (under rest->lock) ---------------------------------------
+
+static discord_result_t rest_bucket_index(discord_rest_t* rest, uint64_t channel_id, uint32_t* index) {
+    for (uint32_t i = 0; i < rest->bucket_count; i++) {
+        if (rest->buckets[i].channel_id == channel_id) {
+            *index = i;
+            return DISCORD_OK;
+        }
+    }
+    if (rest->bucket_count == rest->bucket_capacity) {
+        uint32_t capacity = rest->bucket_capacity ? rest->bucket_capacity * 2 : 16;
+        rest_bucket_t* buckets = discord_mem_realloc(DISCORD_MEM_SEND, rest->buckets, capacity * sizeof(rest_bucket_t));
+        if (!buckets) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        rest->buckets = buckets;
+        rest->bucket_capacity = capacity;
+    }
+    rest_bucket_t* bucket = &rest->buckets[rest->bucket_count];
+    memset(bucket, 0, sizeof(*bucket));
+    bucket->channel_id = channel_id;
+    bucket->limit = REST_UNKNOWN;
+    bucket->remaining = REST_UNKNOWN;
+    *index = rest->bucket_count++;
+    return DISCORD_OK;
+}
+
+// 1 when a request may go to bucket now; otherwise *wait_ms is how long
+// until it may (0 = until a response comes back)
+static int rest_bucket_ready(rest_bucket_t* bucket, uint64_t now, uint64_t* wait_ms) {
+    *wait_ms = 0;
+    if (bucket->limit == REST_UNKNOWN) {
+        if (bucket->reset_at_ms > now) {
+            *wait_ms = bucket->reset_at_ms - now;   // Rate limited before the limits were known
+            return 0;
+        }
+        return bucket->in_flight == 0;
+    }
+    if (now >= bucket->reset_at_ms && bucket->remaining < bucket->limit) {
+        // Refill; the next response gives the real reset time
+        bucket->remaining = bucket->limit - (int32_t)bucket->in_flight;
+        bucket->reset_at_ms = now + bucket->window_ms;
+    }
+    if (bucket->remaining > 0) {
+        return 1;
+    }
+    *wait_ms = bucket->reset_at_ms > now ? bucket->reset_at_ms - now : 1;
+    return 0;
+}
+
+// First queued job that may be sent now, unlinked and counted against its
+// bucket and the global budget. NULL with *wait_ms as for rest_bucket_ready
+// (also when the queue is empty)
+static rest_job_t* rest_take(discord_rest_t* rest, uint64_t* wait_ms) {
+    uint64_t now = rest_now_ms();
+    *wait_ms = 0;
+    if (!rest->head) {
+        return NULL;
+    }
+    if (rest->global_blocked_ms > now) {
+        *wait_ms = rest->global_blocked_ms - now;
+        return NULL;
+    }
+    if (now >= rest->global_window_ms + 1000) {
+        rest->global_window_ms = now;
+        rest->global_sent = 0;
+    }
+    if (rest->global_sent >= rest->global_per_second) {
+        *wait_ms = rest->global_window_ms + 1000 - now;
+        return NULL;
+    }
+
+    rest_job_t* previous = NULL;
+    for (rest_job_t* job = rest->head; job; previous = job, job = job->next) {
+        rest_bucket_t* bucket = &rest->buckets[job->bucket];
+        uint64_t bucket_wait;
+        if (!rest_bucket_ready(bucket, now, &bucket_wait)) {
+            if (bucket_wait && (*wait_ms == 0 || bucket_wait < *wait_ms)) {
+                *wait_ms = bucket_wait;
+            }
+            continue;
+        }
+
+        if (previous) {
+            previous->next = job->next;
+        } else {
+            rest->head = job->next;
+        }
+        if (rest->tail == job) {
+            rest->tail = previous;
+        }
+        job->next = NULL;
+        if (bucket->limit != REST_UNKNOWN) {
+            bucket->remaining--;
+        }
+        bucket->in_flight++;
+        rest->global_sent++;
+        return job;
+    }
+    return NULL;
+}
+
+// Fold a response's X-RateLimit-* headers into the bucket it came from
+static void rest_bucket_update(discord_rest_t* rest, rest_bucket_t* bucket, const rest_outcome_t* outcome) {
+    uint64_t now = rest_now_ms();
+    bucket->in_flight--;
+
+    if (outcome->status == 429) {
+        uint64_t until = now + (uint64_t)(outcome->retry_after_ms > 0 ? outcome->retry_after_ms : 1000);
+        if (outcome->global) {
+            rest->global_blocked_ms = until;
+        } else {
+            bucket->remaining = 0;
+            bucket->reset_at_ms = until;
+        }
+        return;
+    }
+    if (outcome->limit <= 0 || outcome->remaining < 0 || outcome->reset_after_ms < 0) {
+        return;
+    }
+
+    // Requests still in flight have not been counted by the server yet
+    int32_t remaining = outcome->remaining - (int32_t)bucket->in_flight;
+    if (remaining < 0) {
+        remaining = 0;
+    }
+    uint64_t reset_at = now + (uint64_t)outcome->reset_after_ms;
+    if (bucket->limit == REST_UNKNOWN || reset_at > bucket->reset_at_ms + (uint64_t)outcome->reset_after_ms / 2) {
+        bucket->remaining = remaining;      // A new window
+    } else if (remaining < bucket->remaining) {
+        bucket->remaining = remaining;
+    }
+    bucket->limit = outcome->limit;
+    bucket->reset_at_ms = reset_at;
+    bucket->window_ms = (uint64_t)outcome->reset_after_ms;
+}
+
+// -- Connection ------------------------------------------------------------
+
+static void rest_conn_close(rest_conn_t* conn) {
+    if (conn->ssl) {
+        SSL_free(conn->ssl);
+        conn->ssl = NULL;
+    }
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    if (conn->ktls) {
+        pthread_mutex_lock(&conn->rest->lock);
+        conn->rest->stats.ktls_connections--;
+        pthread_mutex_unlock(&conn->rest->lock);
+        conn->ktls = 0;
+    }
+}
+
+static discord_result_t rest_conn_open(rest_conn_t* conn) {
+    discord_rest_t* rest = conn->rest;
+    discord_connect_timing_t timing;
+    memset(&timing, 0, sizeof(timing));
+    conn->fd = discord_connect_tcp(rest->url.host, rest->url.port, 0, DISCORD_REST_TIMEOUT_S, &timing);
+    if (conn->fd < 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(conn->fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    if (rest->url.secure) {
+        conn->ssl = SSL_new(rest->ssl_ctx);
+        if (!conn->ssl) {
+            rest_conn_close(conn);
+            return DISCORD_ERROR_MEMORY;
+        }
+        SSL_set_fd(conn->ssl, conn->fd);
+        SSL_set_tlsext_host_name(conn->ssl, rest->url.host);
+        if (!rest->skip_verify) {
+            SSL_set1_host(conn->ssl, rest->url.host);
+        }
+        if (SSL_connect(conn->ssl) != 1) {
+            ERR_clear_error();
+            discord_result_t result = SSL_get_verify_result(conn->ssl) != X509_V_OK ? DISCORD_ERROR_AUTH
+                                                                                     : DISCORD_ERROR_NETWORK;
+            rest_conn_close(conn);
+            return result;
+        }
+        conn->ktls = BIO_get_ktls_send(SSL_get_wbio(conn->ssl)) != 0;
+    }
+
+    pthread_mutex_lock(&rest->lock);
+    rest->stats.connections_opened++;
+    if (conn->ktls) {
+        rest->stats.ktls_connections++;
+    }
+    pthread_mutex_unlock(&rest->lock);
+    return DISCORD_OK;
+}
+
+static int rest_write(rest_conn_t* conn, const void* data, size_t length) {
+    while (length > 0) {
+        ssize_t n;
+        if (conn->ssl) {
+            size_t written = 0;
+            n = SSL_write_ex(conn->ssl, data, length, &written) ? (ssize_t)written : -1;
+        } else {
+            n = send(conn->fd, data, length, REST_SEND_FLAGS);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        conn->outcome->bytes_sent += (uint64_t)n;
+        data = (const char*)data + n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static ssize_t rest_read(rest_conn_t* conn, void* data, size_t length) {
+    for (;;) {
+        ssize_t n;
+        if (conn->ssl) {
+            size_t read = 0;
+            if (SSL_read_ex(conn->ssl, data, length, &read)) {
+                n = (ssize_t)read;
+            } else {
+                n = SSL_get_error(conn->ssl, 0) == SSL_ERROR_ZERO_RETURN ? 0 : -1;
+                ERR_clear_error();
+            }
+        } else {
+            n = recv(conn->fd, data, length, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+        }
+        if (n > 0) {
+            conn->outcome->responded = 1;
+        }
+        return n;
+    }
+}
+
+static int rest_flush_staged(rest_conn_t* conn) {
+    size_t staged = conn->staged;
+    conn->staged = 0;
+    return staged ? rest_write(conn, conn->buffer, staged) : 0;
+}
+
+// Small pieces are gathered into one write; large ones go out directly
+static int rest_put(rest_conn_t* conn, const void* data, size_t length) {
+    size_t chunk_size = conn->rest->chunk_size;
+    if (conn->staged + length > chunk_size && rest_flush_staged(conn) != 0) {
+        return -1;
+    }
+    if (length > chunk_size) {
+        return rest_write(conn, data, length);
+    }
+    memcpy(conn->buffer + conn->staged, data, length);
+    conn->staged += length;
+    return 0;
+}
+
+// Contents by the kernel: 1 when sent, 0 when this file or socket cannot
+// take sendfile/splice (nothing was sent), -1 on error
+static int rest_send_zero_copy(rest_conn_t* conn, const rest_file_t* file) {
+#ifdef __linux__
+    if (conn->rest->copy_only || (conn->ssl && !conn->ktls) || file->kind == REST_FILE_STREAM) {
+        return 0;
+    }
+    uint64_t left = file->length;
+    off_t offset = (off_t)file->offset;
+    while (left > 0) {
+        size_t step = left < REST_SENDFILE_MAX ? (size_t)left : REST_SENDFILE_MAX;
+        ssize_t n;
+        if (file->kind == REST_FILE_PIPE) {
+            n = splice(file->fd, NULL, conn->fd, NULL, step, SPLICE_F_MOVE | SPLICE_F_MORE);
+        } else if (conn->ssl) {
+            n = SSL_sendfile(conn->ssl, file->fd, offset, step, 0);
+            if (n > 0) {
+                offset += n;
+            }
+        } else {
+            n = sendfile(conn->fd, file->fd, &offset, step);
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (left == file->length && (errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+                ERR_clear_error();
+                return 0;
+            }
+            return -1;                      // Also a file that got shorter
+        }
+        left -= (uint64_t)n;
+        conn->outcome->bytes_sent += (uint64_t)n;
+        conn->outcome->zero_copy_bytes += (uint64_t)n;
+    }
+    return 1;
+#else
+    (void)conn; (void)file;
+    return 0;
+#endif
+}
+
+// Contents through the pooled buffer, a chunk at a time
+static int rest_send_copy(rest_conn_t* conn, const rest_file_t* file) {
+    uint64_t left = file->length;
+    uint64_t offset = file->offset;
+    size_t chunk_size = conn->rest->chunk_size;
+    while (left > 0) {
+        size_t step = left < chunk_size ? (size_t)left : chunk_size;
+        ssize_t n = file->kind == REST_FILE_REGULAR ? pread(file->fd, conn->buffer, step, (off_t)offset)
+                                                    : read(file->fd, conn->buffer, step);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0 || rest_write(conn, conn->buffer, (size_t)n) != 0) {
+            return -1;
+        }
+        offset += (uint64_t)n;
+        left -= (uint64_t)n;
+        conn->outcome->copied_bytes += (uint64_t)n;
+    }
+    return 0;
+}
+
+static size_t rest_part_header(char* out, size_t size, const char* boundary, int index, const rest_file_t* file) {
+    int n;
+    if (!file) {
+        n = snprintf(out, size, "--%s\r\nContent-Disposition: form-data; name=\"payload_json\"\r\n"
+                     "Content-Type: application/json\r\n\r\n", boundary);
+    } else {
+        n = snprintf(out, size, "\r\n--%s\r\nContent-Disposition: form-data; name=\"files[%d]\"; "
+                     "filename=\"%s\"\r\nContent-Type: %s\r\n\r\n", boundary, index, file->filename,
+                     file->content_type);
+    }
+    return n > 0 ? (size_t)n : 0;
+}
+
+static discord_result_t rest_send_request(rest_conn_t* conn, const rest_job_t* job) {
+    discord_rest_t* rest = conn->rest;
+    char boundary[REST_BOUNDARY_MAX];
+    pthread_mutex_lock(&rest->lock);
+    uint64_t count = ++rest->boundary_count;
+    pthread_mutex_unlock(&rest->lock);
+    snprintf(boundary, sizeof(boundary), "discord-asm-%016llx%08llx", (unsigned long long)rest->boundary_seed,
+             (unsigned long long)count);
+
+    // Content-Length: every part but the file contents is formatted twice
+    char part[REST_PART_HEADER_MAX];
+    char closing[REST_BOUNDARY_MAX + 16];
+    int closing_length = snprintf(closing, sizeof(closing), "\r\n--%s--\r\n", boundary);
+    uint64_t content_length = rest_part_header(NULL, 0, boundary, 0, NULL) + job->payload_length +
+                              (uint64_t)closing_length;
+    for (uint32_t i = 0; i < job->file_count; i++) {
+        content_length += rest_part_header(NULL, 0, boundary, (int)i, &job->files[i]) + job->files[i].length;
+    }
+
+    int length = snprintf(part, sizeof(part),
+                          "POST %s/channels/%llu/messages HTTP/1.1\r\nHost: %s\r\nAuthorization: %s\r\n"
+                          "User-Agent: " REST_USER_AGENT "\r\n"
+                          "Content-Type: multipart/form-data; boundary=%s\r\nContent-Length: %llu\r\n\r\n",
+                          strcmp(rest->url.path, "/") == 0 ? "" : rest->url.path,
+                          (unsigned long long)job->channel_id, rest->url.host, rest->authorization, boundary,
+                          (unsigned long long)content_length);
+    if (length <= 0 || (size_t)length >= sizeof(part) || rest_put(conn, part, (size_t)length) != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+    size_t part_length = rest_part_header(part, sizeof(part), boundary, 0, NULL);
+    if (rest_put(conn, part, part_length) != 0 || rest_put(conn, job->payload_json, job->payload_length) != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    for (uint32_t i = 0; i < job->file_count; i++) {
+        const rest_file_t* file = &job->files[i];
+        part_length = rest_part_header(part, sizeof(part), boundary, (int)i, file);
+        if (rest_put(conn, part, part_length) != 0 || rest_flush_staged(conn) != 0) {
+            return DISCORD_ERROR_NETWORK;
+        }
+        int sent = rest_send_zero_copy(conn, file);
+        if (sent < 0 || (sent == 0 && rest_send_copy(conn, file) != 0)) {
+            return DISCORD_ERROR_NETWORK;
+        }
+    }
+    if (rest_put(conn, closing, (size_t)closing_length) != 0 || rest_flush_staged(conn) != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+    return DISCORD_OK;
+}
+
+// -- Response --------------------------------------------------------------
+// The header block is read into the buffer and parsed; the body is then
+// decoded to the start of the buffer, with the bytes not yet decoded kept
+// after it. A body longer than fits is truncated (the rest is read and
+// dropped) so the connection can be reused.
+
+typedef struct {
+    rest_conn_t* conn;
+    uint8_t* data;
+    size_t capacity;                // Body bytes kept
+    size_t body;                    // Decoded: data[0, body)
+    size_t start;                   // Not decoded yet: data[start, end)
+    size_t end;
+    size_t limit;                   // Bytes of data usable
+} rest_reader_t;
+
+// Read more after the undecoded bytes; 0 at end of stream, -1 on error
+static int rest_fill(rest_reader_t* reader) {
+    if (reader->start > reader->body) {
+        memmove(reader->data + reader->body, reader->data + reader->start, reader->end - reader->start);
+        reader->end -= reader->start - reader->body;
+        reader->start = reader->body;
+    }
+    if (reader->end >= reader->limit) {
+        return -1;                          // A line longer than REST_RAW_RESERVE
+    }
+    ssize_t n = rest_read(reader->conn, reader->data + reader->end, reader->limit - reader->end);
+    if (n < 0) {
+        return -1;
+    }
+    reader->end += (size_t)n;
+    return n > 0;
+}
+
+static void rest_emit(rest_reader_t* reader, size_t length) {
+    size_t keep = reader->capacity - reader->body;
+    keep = length < keep ? length : keep;
+    memmove(reader->data + reader->body, reader->data + reader->start, keep);
+    reader->body += keep;
+    reader->start += length;
+}
+
+// A CRLF-terminated line at start (without the CRLF); NULL when more is needed
+static char* rest_line(rest_reader_t* reader) {
+    uint8_t* line = reader->data + reader->start;
+    uint8_t* end = memchr(line, '\n', reader->end - reader->start);
+    if (!end) {
+        return NULL;
+    }
+    *end = '\0';
+    if (end > line && end[-1] == '\r') {
+        end[-1] = '\0';
+    }
+    reader->start = (size_t)(end + 1 - reader->data);
+    return (char*)line;
+}
+
+static int rest_read_chunked(rest_reader_t* reader) {
+    for (;;) {
+        char* line;
+        while (!(line = rest_line(reader))) {
+            if (rest_fill(reader) <= 0) {
+                return -1;
+            }
+        }
+        uint64_t size = strtoull(line, NULL, 16);
+        if (size == 0) {
+            // Trailers end with an empty line
+            for (;;) {
+                while (!(line = rest_line(reader))) {
+                    if (rest_fill(reader) <= 0) {
+                        return -1;
+                    }
+                }
+                if (*line == '\0') {
+                    return 0;
+                }
+            }
+        }
+        while (size > 0) {
+            if (reader->start == reader->end && rest_fill(reader) <= 0) {
+                return -1;
+            }
+            size_t available = reader->end - reader->start;
+            size_t take = size < available ? (size_t)size : available;
+            rest_emit(reader, take);
+            size -= take;
+        }
+        while (!(line = rest_line(reader))) {
+            if (rest_fill(reader) <= 0) {
+                return -1;
+            }
+        }
+    }
+}
+
+static int rest_header_is(const char* name, size_t length, const char* text) {
+    return strlen(text) == length && strncasecmp(name, text, length) == 0;
+}
+
+static int64_t rest_header_ms(const char* value) {
+    return (int64_t)(strtod(value, NULL) * 1000.0 + 0.5);
+}
+
+static discord_result_t rest_read_response(rest_conn_t* conn, rest_outcome_t* outcome) {
+    size_t chunk_size = conn->rest->chunk_size;
+    rest_reader_t reader = { conn, conn->buffer, chunk_size - REST_RAW_RESERVE, 0, 0, 0, chunk_size };
+
+    // Header block
+    char* headers = (char*)conn->buffer;
+    char* blank = NULL;
+    while (!blank) {
+        if (rest_fill(&reader) <= 0) {
+            return DISCORD_ERROR_NETWORK;
+        }
+        conn->buffer[reader.end] = '\0';
+        blank = strstr(headers, "\r\n\r\n");
+    }
+    reader.start = (size_t)(blank + 4 - headers);
+    blank[2] = '\0';
+
+    int minor = 1;
+    if (sscanf(headers, "HTTP/1.%d %d", &minor, &outcome->status) != 2) {
+        return DISCORD_ERROR_NETWORK;
+    }
+    outcome->close = minor == 0;
+    int64_t content_length = -1;
+    int chunked = 0;
+    for (char* line = strstr(headers, "\r\n"); line && line[2]; line = strstr(line + 2, "\r\n")) {
+        char* name = line + 2;
+        char* colon = strchr(name, ':');
+        char* eol = strstr(name, "\r\n");
+        if (!colon || (eol && colon > eol)) {
+            continue;
+        }
+        size_t name_length = (size_t)(colon - name);
+        const char* value = colon + 1;
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        if (rest_header_is(name, name_length, "Content-Length")) {
+            content_length = strtoll(value, NULL, 10);
+        } else if (rest_header_is(name, name_length, "Transfer-Encoding")) {
+            chunked = strncasecmp(value, "chunked", 7) == 0;
+        } else if (rest_header_is(name, name_length, "Connection")) {
+            outcome->close = strncasecmp(value, "close", 5) == 0;
+        } else if (rest_header_is(name, name_length, "X-RateLimit-Limit")) {
+            outcome->limit = (int32_t)strtol(value, NULL, 10);
+        } else if (rest_header_is(name, name_length, "X-RateLimit-Remaining")) {
+            outcome->remaining = (int32_t)strtol(value, NULL, 10);
+        } else if (rest_header_is(name, name_length, "X-RateLimit-Reset-After")) {
+            outcome->reset_after_ms = rest_header_ms(value);
+        } else if (rest_header_is(name, name_length, "Retry-After")) {
+            outcome->retry_after_ms = rest_header_ms(value);
+        } else if (rest_header_is(name, name_length, "X-RateLimit-Global")) {
+            outcome->global = strncasecmp(value, "true", 4) == 0;
+        } else if (rest_header_is(name, name_length, "X-RateLimit-Scope")) {
+            outcome->global = outcome->global || strncasecmp(value, "global", 6) == 0;
+        }
+    }
+
+    // Body
+    int result = 0;
+    if (outcome->status == 204 || outcome->status == 304) {
+        // No body
+    } else if (chunked) {
+        result = rest_read_chunked(&reader);
+    } else if (content_length >= 0) {
+        uint64_t left = (uint64_t)content_length;
+        while (left > 0 && result == 0) {
+            if (reader.start == reader.end && rest_fill(&reader) <= 0) {
+                result = -1;
+                break;
+            }
+            size_t available = reader.end - reader.start;
+            size_t take = left < available ? (size_t)left : available;
+            rest_emit(&reader, take);
+            left -= take;
+        }
+    } else {
+        // Until the server closes
+        outcome->close = 1;
+        int more;
+        do {
+            rest_emit(&reader, reader.end - reader.start);
+        } while ((more = rest_fill(&reader)) > 0);
+        result = more;
+        rest_emit(&reader, reader.end - reader.start);
+    }
+    if (result != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+    conn->buffer[reader.body] = '\0';
+    outcome->body = (const char*)conn->buffer;
+    outcome->body_length = reader.body;
+    return DISCORD_OK;
+}
+
+// -- Connection threads ----------------------------------------------------
+
+static void rest_attempt(rest_conn_t* conn, rest_job_t* job, rest_outcome_t* outcome) {
+    memset(outcome, 0, sizeof(*outcome));
+    outcome->limit = REST_UNKNOWN;
+    outcome->remaining = REST_UNKNOWN;
+    outcome->reset_after_ms = -1;
+    outcome->retry_after_ms = -1;
+    conn->outcome = outcome;
+    conn->staged = 0;
+
+    int reused = conn->fd >= 0;
+    outcome->result = reused ? DISCORD_OK : rest_conn_open(conn);
+    if (outcome->result == DISCORD_OK) {
+        outcome->result = rest_send_request(conn, job);
+    }
+    if (outcome->result == DISCORD_OK) {
+        outcome->result = rest_read_response(conn, outcome);
+    }
+    if (outcome->result != DISCORD_OK || outcome->close) {
+        rest_conn_close(conn);
+    }
+
+    // A kept-alive connection the server closed in the meantime fails
+    // before anything comes back; that attempt is not counted
+    if (outcome->result == DISCORD_ERROR_NETWORK && reused && !outcome->responded && !job->streamed) {
+        job->attempts--;
+        outcome->status = -1;
+    }
+}
+
+static discord_result_t rest_status_result(int status) {
+    if (status >= 200 && status < 300) {
+        return DISCORD_OK;
+    }
+    if (status == 401 || status == 403) {
+        return DISCORD_ERROR_AUTH;
+    }
+    if (status == 404) {
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+    if (status == 400 || status == 413) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    return DISCORD_ERROR_NETWORK;
+}
+
+static void* rest_connection_main(void* arg) {
+    rest_conn_t* conn = arg;
+    discord_rest_t* rest = conn->rest;
+    rest_outcome_t outcome;
+
+    pthread_mutex_lock(&rest->lock);
+    while (!rest->stopping) {
+        uint64_t wait_ms = 0;
+        rest_job_t* job = rest_take(rest, &wait_ms);
+        if (!job) {
+            if (rest->head) {
+                rest->stats.limiter_waits++;
+            }
+            rest_wait(&rest->work, &rest->lock, wait_ms ? (int64_t)wait_ms : -1);
+            continue;
+        }
+
+        rest->in_flight++;
+        if (job->attempts++ == 0) {
+            job->started_ns = rest_now_ns();
+        }
+        pthread_mutex_unlock(&rest->lock);
+        rest_attempt(conn, job, &outcome);
+        pthread_mutex_lock(&rest->lock);
+
+        rest->stats.requests++;
+        rest->stats.bytes_sent += outcome.bytes_sent;
+        rest->stats.zero_copy_bytes += outcome.zero_copy_bytes;
+        rest->stats.copied_bytes += outcome.copied_bytes;
+        rest_bucket_update(rest, &rest->buckets[job->bucket], &outcome);
+        if (outcome.status == 429) {
+            rest->stats.rate_limited++;
+        }
+
+        int retry = outcome.status == -1 || (outcome.status == 429 && !job->streamed);
+        if (retry && job->attempts < DISCORD_REST_MAX_ATTEMPTS) {
+            // Back to the head: it stays ahead of later uploads to its channel
+            job->next = rest->head;
+            rest->head = job;
+            if (!rest->tail) {
+                rest->tail = job;
+            }
+            rest->in_flight--;
+            pthread_cond_broadcast(&rest->work);
+            continue;
+        }
+
+        discord_rest_response_t response;
+        memset(&response, 0, sizeof(response));
+        response.status = outcome.status > 0 ? outcome.status : 0;
+        response.result = outcome.result != DISCORD_OK ? outcome.result
+                        : outcome.status == 429 ? DISCORD_ERROR_TIMEOUT
+                        : rest_status_result(outcome.status);
+        response.body = outcome.body;
+        response.body_length = outcome.body_length;
+        response.attempts = job->attempts;
+        response.bytes_sent = outcome.bytes_sent;
+        response.zero_copy_bytes = outcome.zero_copy_bytes;
+        response.queued_ns = job->started_ns - job->submitted_ns;
+        if (response.result == DISCORD_OK) {
+            rest->stats.completed++;
+        } else {
+            rest->stats.failed++;
+        }
+        pthread_cond_broadcast(&rest->work);
+        pthread_mutex_unlock(&rest->lock);
+
+        response.total_ns = rest_now_ns() - job->submitted_ns;
+        if (job->callback) {
+            job->callback(&response, job->user);
+        }
+        discord_mem_free(job);
+
+        // Still in flight for discord_rest_flush until the callback returned
+        pthread_mutex_lock(&rest->lock);
+        rest->in_flight--;
+        pthread_cond_broadcast(&rest->idle);
+    }
+    pthread_mutex_unlock(&rest->lock);
+    return NULL;
+}
+
+// -- Entry points ----------------------------------------------------------
+
+discord_result_t discord_rest_create(const discord_rest_config_t* config, discord_rest_t** rest) {
+    if (!config || !rest || !config->token || !*config->token || strpbrk(config->token, "\r\n") ||
+        strlen(config->token) + 4 >= sizeof(((discord_rest_t*)0)->authorization) ||
+        (config->chunk_size && config->chunk_size < DISCORD_REST_CHUNK_MIN)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // The URL parser takes WebSocket schemes
+    const char* api_url = config->api_url ? config->api_url : DISCORD_REST_API_URL;
+    char url[DISCORD_URL_HOST_MAX + DISCORD_URL_PATH_MAX];
+    if (strncmp(api_url, "https://", 8) == 0) {
+        snprintf(url, sizeof(url), "wss://%s", api_url + 8);
+    } else if (strncmp(api_url, "http://", 7) == 0) {
+        snprintf(url, sizeof(url), "ws://%s", api_url + 7);
+    } else {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_rest_t* r = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_rest_t));
+    if (!r) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    if (discord_url_parse(url, &r->url) != DISCORD_OK || strchr(r->url.path, '?')) {
+        discord_mem_free(r);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    size_t path_length = strlen(r->url.path);
+    if (path_length > 1 && r->url.path[path_length - 1] == '/') {
+        r->url.path[path_length - 1] = '\0';
+    }
+    snprintf(r->authorization, sizeof(r->authorization), "Bot %s", config->token);
+    r->chunk_size = config->chunk_size ? config->chunk_size : DISCORD_REST_CHUNK_SIZE;
+    r->global_per_second = config->global_per_second ? config->global_per_second : DISCORD_REST_GLOBAL_PER_SECOND;
+    r->copy_only = config->copy_only;
+    r->skip_verify = config->skip_verify;
+    RAND_bytes((unsigned char*)&r->boundary_seed, sizeof(r->boundary_seed));
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->work, NULL);
+    pthread_cond_init(&r->idle, NULL);
+
+    if (r->url.secure) {
+        r->ssl_ctx = SSL_CTX_new(TLS_client_method());
+        if (!r->ssl_ctx) {
+            discord_rest_destroy(r);
+            return DISCORD_ERROR_MEMORY;
+        }
+#ifdef SSL_OP_ENABLE_KTLS
+        // Uploads only need the kernel to encrypt what is sent
+        SSL_CTX_set_options(r->ssl_ctx, SSL_OP_ENABLE_KTLS);
+#endif
+        if (r->skip_verify) {
+            SSL_CTX_set_verify(r->ssl_ctx, SSL_VERIFY_NONE, NULL);
+        } else {
+            SSL_CTX_set_verify(r->ssl_ctx, SSL_VERIFY_PEER, NULL);
+            SSL_CTX_set_default_verify_paths(r->ssl_ctx);
+        }
+    }
+
+    uint32_t count = config->connections ? config->connections : DISCORD_REST_CONNECTIONS;
+    r->connections = discord_mem_calloc(DISCORD_MEM_OTHER, count, sizeof(rest_conn_t));
+    if (!r->connections) {
+        discord_rest_destroy(r);
+        return DISCORD_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        rest_conn_t* conn = &r->connections[i];
+        conn->rest = r;
+        conn->fd = -1;
+        conn->buffer = discord_mem_alloc(DISCORD_MEM_SEND, r->chunk_size + 1);
+        if (!conn->buffer || pthread_create(&conn->thread, NULL, rest_connection_main, conn) != 0) {
+            discord_mem_free(conn->buffer);
+            conn->buffer = NULL;
+            discord_rest_destroy(r);
+            return DISCORD_ERROR_MEMORY;
+        }
+        r->connection_count++;
+    }
+
+    *rest = r;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_rest_upload(discord_rest_t* rest, const discord_rest_upload_t* upload) {
+    if (!rest || !upload || upload->channel_id == 0 || upload->file_count > DISCORD_REST_MAX_FILES ||
+        (upload->file_count && !upload->files)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // The job and its strings in one block
+    const char* payload = upload->payload_json ? upload->payload_json : "{}";
+    size_t payload_length = strlen(payload);
+    size_t strings = payload_length + 1;
+    for (uint32_t i = 0; i < upload->file_count; i++) {
+        const discord_rest_file_t* file = &upload->files[i];
+        const char* type = file->content_type ? file->content_type : "application/octet-stream";
+        if (file->fd < 0 || !rest_header_safe(file->filename) || !rest_header_safe(type) ||
+            strlen(file->filename) + strlen(type) > REST_PART_HEADER_MAX - 256) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+        strings += strlen(file->filename) + strlen(type) + 2;
+    }
+    rest_job_t* job = discord_mem_calloc(DISCORD_MEM_SEND, 1, sizeof(rest_job_t) + strings);
+    if (!job) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    char* text = (char*)(job + 1);
+    job->channel_id = upload->channel_id;
+    job->payload_json = text;
+    job->payload_length = payload_length;
+    memcpy(text, payload, payload_length + 1);
+    text += payload_length + 1;
+
+    for (uint32_t i = 0; i < upload->file_count; i++) {
+        const discord_rest_file_t* source = &upload->files[i];
+        rest_file_t* file = &job->files[i];
+        const char* type = source->content_type ? source->content_type : "application/octet-stream";
+        struct stat st;
+        if (fstat(source->fd, &st) != 0) {
+            discord_mem_free(job);
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+        file->fd = source->fd;
+        file->offset = source->offset;
+        file->length = source->length;
+        if (S_ISREG(st.st_mode)) {
+            file->kind = REST_FILE_REGULAR;
+            if (file->offset > (uint64_t)st.st_size ||
+                (file->length == 0 && (file->length = (uint64_t)st.st_size - file->offset) == 0)) {
+                discord_mem_free(job);
+                return DISCORD_ERROR_INVALID_PARAM;
+            }
+        } else {
+            file->kind = S_ISFIFO(st.st_mode) ? REST_FILE_PIPE : REST_FILE_STREAM;
+            job->streamed = 1;
+            if (file->length == 0) {
+                discord_mem_free(job);
+                return DISCORD_ERROR_INVALID_PARAM;
+            }
+        }
+        file->filename = text;
+        strcpy(text, source->filename);
+        text += strlen(source->filename) + 1;
+        file->content_type = text;
+        strcpy(text, type);
+        text += strlen(type) + 1;
+    }
+    job->file_count = upload->file_count;
+    job->callback = upload->callback;
+    job->user = upload->user;
+    job->submitted_ns = rest_now_ns();
+
+    pthread_mutex_lock(&rest->lock);
+    if (rest->stopping || rest_bucket_index(rest, job->channel_id, &job->bucket) != DISCORD_OK) {
+        discord_result_t result = rest->stopping ? DISCORD_ERROR_INVALID_PARAM : DISCORD_ERROR_MEMORY;
+        pthread_mutex_unlock(&rest->lock);
+        discord_mem_free(job);
+        return result;
+    }
+    if (rest->tail) {
+        rest->tail->next = job;
+    } else {
+        rest->head = job;
+    }
+    rest->tail = job;
+    rest->stats.uploads++;
+    pthread_cond_signal(&rest->work);
+    pthread_mutex_unlock(&rest->lock);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_rest_flush(discord_rest_t* rest, int timeout_ms) {
+    if (!rest) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    uint64_t deadline = timeout_ms >= 0 ? rest_now_ms() + (uint64_t)timeout_ms : 0;
+    discord_result_t result = DISCORD_OK;
+    pthread_mutex_lock(&rest->lock);
+    while (rest->head || rest->in_flight) {
+        uint64_t now = rest_now_ms();
+        if (timeout_ms >= 0 && now >= deadline) {
+            result = DISCORD_ERROR_TIMEOUT;
+            break;
+        }
+        rest_wait(&rest->idle, &rest->lock, timeout_ms >= 0 ? (int64_t)(deadline - now) : -1);
+    }
+    pthread_mutex_unlock(&rest->lock);
+    return result;
+}
+
+discord_result_t discord_rest_get_stats(discord_rest_t* rest, discord_rest_stats_t* stats) {
+    if (!rest || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&rest->lock);
+    *stats = rest->stats;
+    stats->queued = 0;
+    for (rest_job_t* job = rest->head; job; job = job->next) {
+        stats->queued++;
+    }
+    stats->in_flight = rest->in_flight;
+    stats->buckets = rest->bucket_count;
+    pthread_mutex_unlock(&rest->lock);
+    return DISCORD_OK;
+}
+
+void discord_rest_destroy(discord_rest_t* rest) {
+    if (!rest) {
+        return;
+    }
+    pthread_mutex_lock(&rest->lock);
+    rest->stopping = 1;
+    pthread_cond_broadcast(&rest->work);
+    pthread_mutex_unlock(&rest->lock);
+    for (uint32_t i = 0; i < rest->connection_count; i++) {
+        pthread_join(rest->connections[i].thread, NULL);
+    }
+
+    while (rest->head) {
+        rest_job_t* job = rest->head;
+        rest->head = job->next;
+        rest->stats.failed++;
+        if (job->callback) {
+            discord_rest_response_t response;
+            memset(&response, 0, sizeof(response));
+            response.result = DISCORD_ERROR_NETWORK;
+            response.attempts = job->attempts;
+            response.total_ns = rest_now_ns() - job->submitted_ns;
+            job->callback(&response, job->user);
+        }
+        discord_mem_free(job);
+    }
+
+    if (rest->connections) {
+        for (uint32_t i = 0; i < rest->connection_count; i++) {
+            rest_conn_close(&rest->connections[i]);
+            discord_mem_free(rest->connections[i].buffer);
+        }
+        discord_mem_free(rest->connections);
+    }
+    if (rest->ssl_ctx) {
+        SSL_CTX_free(rest->ssl_ctx);
+    }
+    pthread_mutex_destroy(&rest->lock);
+    pthread_cond_destroy(&rest->work);
+    pthread_cond_destroy(&rest->idle);
+    discord_mem_free(rest->buckets);
+    discord_mem_free(rest);
+}
+
+#else
+
+discord_result_t discord_rest_create(const discord_rest_config_t* config, discord_rest_t** rest) {
+    (void)config; (void)rest;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_rest_upload(discord_rest_t* rest, const discord_rest_upload_t* upload) {
+    (void)rest; (void)upload;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_rest_flush(discord_rest_t* rest, int timeout_ms) {
+    (void)rest; (void)timeout_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_rest_get_stats(discord_rest_t* rest, discord_rest_stats_t* stats) {
+    (void)rest; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_rest_destroy(discord_rest_t* rest) {
+    (void)rest;
+}
+
+#endif
@@ -0,0 +1,447 @@
+#include "abi.h"
+#include "structs.h"
+#include "dispatch.h"
+#include "router.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Compiled command router
+// Names are registered into plain arrays; discord_router_compile assigns
+// every byte that occurs in a name a class (0 is "no command has this
+// byte") and inserts the names into a trie stored as a dense
+// states x classes table of uint32 next states. State 0 is dead, state 1
+// is the root, terminal[] maps accepting states to commands.
+//
+// Content is the body of a JSON string as it sits in the frame, so a
+// typed quote arrives as \" and a newline as \n; both are handled here
+// without decoding the string.
+
+#define ROUTER_DEAD         0u
+#define ROUTER_ROOT         1u
+
+typedef struct {
+    char name[DISCORD_ROUTER_NAME_MAX + 1];
+    discord_command_handler_t handler;
+    void* user;
+} router_command_t;
+
+typedef struct {
+    char name[DISCORD_ROUTER_NAME_MAX + 1];
+    uint32_t command;
+} router_name_t;
+
+struct discord_router {
+    char prefixes[DISCORD_ROUTER_MAX_PREFIXES][DISCORD_ROUTER_PREFIX_MAX + 1];
+    size_t prefix_lengths[DISCORD_ROUTER_MAX_PREFIXES];
+    size_t prefix_count;
+    uint8_t prefix_first[256];      // Non-zero for the first byte of any prefix
+    int case_insensitive;
+    discord_event_handler_t fallback;
+
+    router_command_t* commands;
+    size_t command_count;
+    size_t command_capacity;
+    router_name_t* names;
+    size_t name_count;
+    size_t name_capacity;
+
+    int compiled;
+    uint8_t classes[256];
+    uint32_t class_count;
+    uint32_t* next;                 // state * class_count + class
+    uint32_t* terminal;             // command + 1, 0 = not accepting
+    uint32_t state_count;
+
+    discord_router_stats_t stats;
+};
+
+static discord_router_t* attached_router = NULL;
+
+static unsigned char fold(const discord_router_t* router, unsigned char c) {
+    return router->case_insensitive && c >= 'A' && c <= 'Z' ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+// Width of the separator at p (a space or a \n, \r, \t escape), 0 if none
+static size_t separator_at(const char* p, const char* end) {
+    if (*p == ' ') {
+        return 1;
+    }
+    if (*p == '\\' && p + 1 < end && (p[1] == 'n' || p[1] == 'r' || p[1] == 't')) {
+        return 2;
+    }
+    return 0;
+}
+
+static int valid_name(const char* name) {
+    size_t len = name ? strlen(name) : 0;
+    if (len == 0 || len > DISCORD_ROUTER_NAME_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)name[i];
+        if (c <= ' ' || c == '"' || c == '\\' || c == 0x7F) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int name_exists(const discord_router_t* router, const char* name) {
+    size_t len = strlen(name);
+    for (size_t i = 0; i < router->name_count; i++) {
+        const char* other = router->names[i].name;
+        if (strlen(other) != len) {
+            continue;
+        }
+        size_t j = 0;
+        while (j < len && fold(router, (unsigned char)other[j]) == fold(router, (unsigned char)name[j])) {
+            j++;
+        }
+        if (j == len) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static discord_result_t add_name(discord_router_t* router, const char* name, uint32_t command) {
+    if (router->name_count == router->name_capacity) {
+        size_t capacity = router->name_capacity ? router->name_capacity * 2 : 64;
+        router_name_t* names = discord_mem_realloc(DISCORD_MEM_DISPATCH, router->names,
+                                                   capacity * sizeof(router_name_t));
+        if (!names) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        router->names = names;
+        router->name_capacity = capacity;
+    }
+
+    router_name_t* entry = &router->names[router->name_count++];
+    memcpy(entry->name, name, strlen(name) + 1);
+    entry->command = command;
+    router->compiled = 0;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_router_create(const discord_router_config_t* config, discord_router_t** router) {
+    if (!config || !router || config->prefix_count == 0 ||
+        config->prefix_count > DISCORD_ROUTER_MAX_PREFIXES || !config->prefixes) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    for (size_t i = 0; i < config->prefix_count; i++) {
+        size_t len = config->prefixes[i] ? strlen(config->prefixes[i]) : 0;
+        if (len == 0 || len > DISCORD_ROUTER_PREFIX_MAX) {
+            return DISCORD_ERROR_INVALID_PARAM;
+        }
+    }
+
+    discord_router_t* r = discord_mem_calloc(DISCORD_MEM_DISPATCH, 1, sizeof(*r));
+    if (!r) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < config->prefix_count; i++) {
+        size_t len = strlen(config->prefixes[i]);
+        memcpy(r->prefixes[i], config->prefixes[i], len + 1);
+        r->prefix_lengths[i] = len;
+        r->prefix_first[(unsigned char)config->prefixes[i][0]] = 1;
+    }
+    r->prefix_count = config->prefix_count;
+    r->case_insensitive = config->case_insensitive;
+    r->fallback = config->fallback;
+
+    *router = r;
+    return DISCORD_OK;
+}
+
+void discord_router_destroy(discord_router_t* router) {
+    if (!router) {
+        return;
+    }
+
+    if (attached_router == router) {
+        discord_router_attach(NULL);
+    }
+
+    discord_mem_free(router->commands);
+    discord_mem_free(router->names);
+    discord_mem_free(router->next);
+    discord_mem_free(router->terminal);
+    discord_mem_free(router);
+}
+
+discord_result_t discord_router_add(discord_router_t* router, const char* name, discord_command_handler_t handler,
+                                    void* user, uint32_t* command_id) {
+    if (!router || !handler || !valid_name(name)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (name_exists(router, name)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    if (router->command_count == router->command_capacity) {
+        size_t capacity = router->command_capacity ? router->command_capacity * 2 : 64;
+        router_command_t* commands = discord_mem_realloc(DISCORD_MEM_DISPATCH, router->commands,
+                                                         capacity * sizeof(router_command_t));
+        if (!commands) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        router->commands = commands;
+        router->command_capacity = capacity;
+    }
+
+    uint32_t id = (uint32_t)router->command_count;
+    discord_result_t result = add_name(router, name, id);
+    if (result != DISCORD_OK) {
+        return result;
+    }
+
+    router_command_t* command = &router->commands[router->command_count++];
+    memcpy(command->name, name, strlen(name) + 1);
+    command->handler = handler;
+    command->user = user;
+
+    if (command_id) {
+        *command_id = id;
+    }
+    return DISCORD_OK;
+}
+
+discord_result_t discord_router_alias(discord_router_t* router, const char* alias, const char* name) {
+    if (!router || !valid_name(alias) || !name) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (name_exists(router, alias)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    for (size_t i = 0; i < router->command_count; i++) {
+        if (strcmp(router->commands[i].name, name) == 0) {
+            return add_name(router, alias, (uint32_t)i);
+        }
+    }
+    return DISCORD_ERROR_NOT_FOUND;
+}
+
+discord_result_t discord_router_compile(discord_router_t* router) {
+    if (!router) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // Byte classes: one per distinct (folded) byte used in any name
+    uint8_t classes[256] = {0};
+    uint32_t class_count = 1;
+    size_t total_bytes = 0;
+    for (size_t i = 0; i < router->name_count; i++) {
+        for (const char* p = router->names[i].name; *p; p++) {
+            unsigned char c = fold(router, (unsigned char)*p);
+            if (classes[c] == 0) {
+                classes[c] = (uint8_t)class_count++;
+            }
+            total_bytes++;
+        }
+    }
+    if (router->case_insensitive) {
+        for (int c = 'A'; c <= 'Z'; c++) {
+            classes[c] = classes[c + ('a' - 'A')];
+        }
+    }
+
+    // Upper bound on states: root plus one per name byte
+    size_t max_states = 2 + total_bytes;
+    uint32_t* next = discord_mem_calloc(DISCORD_MEM_DISPATCH, max_states * class_count, sizeof(uint32_t));
+    uint32_t* terminal = discord_mem_calloc(DISCORD_MEM_DISPATCH, max_states, sizeof(uint32_t));
+    if (!next || !terminal) {
+        discord_mem_free(next);
+        discord_mem_free(terminal);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    uint32_t state_count = 2;
+    for (size_t i = 0; i < router->name_count; i++) {
+        uint32_t state = ROUTER_ROOT;
+        for (const char* p = router->names[i].name; *p; p++) {
+            uint32_t* slot = &next[(size_t)state * class_count + classes[(unsigned char)*p]];
+            if (*slot == ROUTER_DEAD) {
+                *slot = state_count++;
+            }
+            state = *slot;
+        }
+        terminal[state] = router->names[i].command + 1;
+    }
+
+    // Shared prefixes leave the tail of the tables unused
+    uint32_t* trimmed = discord_mem_realloc(DISCORD_MEM_DISPATCH, next,
+                                            (size_t)state_count * class_count * sizeof(uint32_t));
+    if (trimmed) {
+        next = trimmed;
+    }
+
+    discord_mem_free(router->next);
+    discord_mem_free(router->terminal);
+    memcpy(router->classes, classes, sizeof(classes));
+    router->class_count = class_count;
+    router->next = next;
+    router->terminal = terminal;
+    router->state_count = state_count;
+    router->compiled = 1;
+    return DISCORD_OK;
+}
+
+// Split the text after the command name into argument views
+static void parse_arguments(discord_command_t* command, const char* p, const char* end) {
+    size_t width;
+    while (p < end && (width = separator_at(p, end)) != 0) {
+        p += width;
+    }
+    const char* rest_end = end;
+    while (rest_end > p && rest_end[-1] == ' ') {
+        rest_end--;
+    }
+    command->rest = p;
+    command->rest_length = (size_t)(rest_end - p);
+
+    while (p < rest_end && command->argc < DISCORD_ROUTER_MAX_ARGS) {
+        discord_arg_t* arg = &command->argv[command->argc++];
+
+        if (p + 1 < rest_end && p[0] == '\\' && p[1] == '"') {
+            // Quoted: runs to the next \" (other escapes are skipped whole)
+            p += 2;
+            arg->data = p;
+            while (p < rest_end && !(p[0] == '\\' && p + 1 < rest_end && p[1] == '"')) {
+                p += *p == '\\' ? 2 : 1;
+            }
+            if (p > rest_end) {
+                p = rest_end;
+            }
+            arg->length = (size_t)(p - arg->data);
+            p = p < rest_end ? p + 2 : rest_end;
+        } else {
+            arg->data = p;
+            while (p < rest_end && separator_at(p, rest_end) == 0) {
+                p += *p == '\\' ? 2 : 1;
+            }
+            if (p > rest_end) {
+                p = rest_end;
+            }
+            arg->length = (size_t)(p - arg->data);
+        }
+
+        while (p < rest_end && (width = separator_at(p, rest_end)) != 0) {
+            p += width;
+        }
+    }
+}
+
+discord_result_t discord_router_route(discord_router_t* router, const char* content, size_t length,
+                                      const discord_event_t* event) {
+    if (!router || !content) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    router->stats.messages++;
+
+    // First byte decides for almost every ordinary message
+    if (length == 0 || !router->prefix_first[(unsigned char)content[0]]) {
+        router->stats.rejected++;
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    const char* end = content + length;
+    const char* p = NULL;
+    for (size_t i = 0; i < router->prefix_count; i++) {
+        size_t prefix_length = router->prefix_lengths[i];
+        if (prefix_length <= length && memcmp(content, router->prefixes[i], prefix_length) == 0) {
+            p = content + prefix_length;
+            break;
+        }
+    }
+    if (!p) {
+        router->stats.rejected++;
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    if (!router->compiled) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    const char* name = p;
+    uint32_t state = ROUTER_ROOT;
+    while (p < end && separator_at(p, end) == 0) {
+        state = router->next[(size_t)state * router->class_count + router->classes[(unsigned char)*p]];
+        if (state == ROUTER_DEAD || p - name >= DISCORD_ROUTER_NAME_MAX) {
+            router->stats.unknown++;
+            return DISCORD_ERROR_NOT_FOUND;
+        }
+        p++;
+    }
+
+    uint32_t accept = router->terminal[state];
+    if (accept == 0) {
+        router->stats.unknown++;
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    const router_command_t* entry = &router->commands[accept - 1];
+    discord_command_t command;
+    command.event = event;
+    command.name = entry->name;
+    command.command_id = accept - 1;
+    command.argc = 0;
+    command.content = content;
+    command.content_length = length;
+    command.user = entry->user;
+    parse_arguments(&command, p, end);
+
+    router->stats.dispatched++;
+    entry->handler(&command);
+    return DISCORD_OK;
+}
+
+static void on_message_create(const discord_event_t* event) {
+    discord_router_t* router = attached_router;
+    if (!router || !event->data) {
+        return;
+    }
+
+    const char* cursor = event->data;
+    const char* end = event->data + event->data_length;
+    const char* key;
+    const char* value;
+    size_t key_length;
+    size_t value_length;
+
+    while (discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK) {
+        if (key_length == 7 && memcmp(key, "content", 7) == 0 && value_length >= 2 && value[0] == '"') {
+            if (discord_router_route(router, value + 1, value_length - 2, event) == DISCORD_OK) {
+                return;
+            }
+            break;
+        }
+    }
+
+    if (router->fallback) {
+        router->fallback(event);
+    }
+}
+
+discord_result_t discord_router_attach(discord_router_t* router) {
+    attached_router = router;
+    return discord_dispatch_on("MESSAGE_CREATE", router ? on_message_create : NULL);
+}
+
+discord_result_t discord_router_get_stats(discord_router_t* router, discord_router_stats_t* stats) {
+    if (!router || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    *stats = router->stats;
+    stats->commands = (uint32_t)router->command_count;
+    stats->names = (uint32_t)router->name_count;
+    stats->states = router->compiled ? router->state_count : 0;
+    stats->classes = router->compiled ? router->class_count : 0;
+    stats->table_bytes = router->compiled
+        ? (size_t)router->state_count * (router->class_count + 1) * sizeof(uint32_t) : 0;
+    return DISCORD_OK;
+}
@@ -0,0 +1,200 @@
+#include "scan.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SCAN_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define SCAN_NEON 1
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+    static unsigned scan_ctz64(uint64_t value) {
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return (unsigned)index;
+    }
+#else
+    static unsigned scan_ctz64(uint64_t value) {
+        return (unsigned)__builtin_ctzll(value);
+    }
+#endif
+
+size_t discord_scan_quote_or_escape_scalar(const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '"' || s[i] == '\\') {
+            return i;
+        }
+    }
+    return len;
+}
+
+size_t discord_scan_find_pair_scalar(const char* s, size_t len, char a, char b) {
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (s[i] == a && s[i + 1] == b) {
+            return i;
+        }
+    }
+    return len;
+}
+
+static int scan_is_word(unsigned char c) {
+    unsigned char folded = (unsigned char)(c | 0x20);
+    return c >= 0x80 || (c >= '0' && c <= '9') || (folded >= 'a' && folded <= 'z') || c == '_';
+}
+
+uint64_t discord_scan_word_starts_scalar(const char* s, size_t len) {
+    size_t count = len < 64 ? len : 64;
+    uint64_t starts = 0;
+    int previous = 1;
+    for (size_t i = 0; i < count; i++) {
+        int word = scan_is_word((unsigned char)s[i]);
+        if (word && !previous) {
+            starts |= 1ull << i;
+        }
+        previous = word;
+    }
+    return starts;
+}
+
+#if defined(SCAN_NEON)
+// NEON has no movemask; narrow each 0x00/0xFF lane to a nibble so the
+// first match is ctz / 4 of a 64-bit value.
+static uint64_t neon_nibble_mask(uint8x16_t eq) {
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+#endif
+
+size_t discord_scan_quote_or_escape(const char* s, size_t len) {
+    size_t i = 0;
+
+#if defined(SCAN_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i escape = _mm_set1_epi8('\\');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, escape));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) {
+            return i + scan_ctz64(mask);
+        }
+    }
+#elif defined(SCAN_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t escape = vdupq_n_u8('\\');
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(s + i));
+        uint8x16_t hit = vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, escape));
+        uint64_t mask = neon_nibble_mask(hit);
+        if (mask) {
+            return i + (scan_ctz64(mask) >> 2);
+        }
+    }
+#endif
+
+    return i + discord_scan_quote_or_escape_scalar(s + i, len - i);
+}
+
+size_t discord_scan_find_pair(const char* s, size_t len, char a, char b) {
+    size_t i = 0;
+
+#if defined(SCAN_SSE2)
+    const __m128i first = _mm_set1_epi8(a);
+    const __m128i second = _mm_set1_epi8(b);
+    for (; i + 17 <= len; i += 16) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(s + i + 1));
+        __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(v0, first), _mm_cmpeq_epi8(v1, second));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) {
+            return i + scan_ctz64(mask);
+        }
+    }
+#elif defined(SCAN_NEON)
+    const uint8x16_t first = vdupq_n_u8((uint8_t)a);
+    const uint8x16_t second = vdupq_n_u8((uint8_t)b);
+    for (; i + 17 <= len; i += 16) {
+        uint8x16_t v0 = vld1q_u8((const uint8_t*)(s + i));
+        uint8x16_t v1 = vld1q_u8((const uint8_t*)(s + i + 1));
+        uint8x16_t hit = vandq_u8(vceqq_u8(v0, first), vceqq_u8(v1, second));
+        uint64_t mask = neon_nibble_mask(hit);
+        if (mask) {
+            return i + (scan_ctz64(mask) >> 2);
+        }
+    }
+#endif
+
+    size_t rest = discord_scan_find_pair_scalar(s + i, len - i, a, b);
+    return rest == len - i ? len : i + rest;
+}
+
+// Ranges are tested as one unsigned compare each: (c - lo) <= (hi - lo).
+// Setting 0x20 folds A-Z onto a-z and moves no other byte into that range.
+// The word bits of up to four blocks are gathered into one mask, the rest
+// of the window is classified byte by byte, and a start is a word bit whose
+// previous bit is clear.
+uint64_t discord_scan_word_starts(const char* s, size_t len) {
+    size_t count = len < 64 ? len : 64;
+    uint64_t words = 0;
+    size_t i = 0;
+
+#if defined(SCAN_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i digit_lo = _mm_set1_epi8('0');
+    const __m128i digit_span = _mm_set1_epi8(9);
+    const __m128i alpha_lo = _mm_set1_epi8('a');
+    const __m128i alpha_span = _mm_set1_epi8(25);
+    const __m128i underscore = _mm_set1_epi8('_');
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i digit = _mm_sub_epi8(v, digit_lo);
+        __m128i alpha = _mm_sub_epi8(_mm_or_si128(v, case_bit), alpha_lo);
+        __m128i word = _mm_or_si128(
+            _mm_or_si128(_mm_cmplt_epi8(v, zero), _mm_cmpeq_epi8(v, underscore)),
+            _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(digit, digit_span), digit),
+                         _mm_cmpeq_epi8(_mm_min_epu8(alpha, alpha_span), alpha)));
+        words |= (uint64_t)(unsigned)_mm_movemask_epi8(word) << i;
+    }
+#elif defined(SCAN_NEON)
+    // Lane weights turn 0x00/0xFF lanes into one bit per byte
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bit = vld1q_u8(weights);
+    const uint8x16_t high = vdupq_n_u8(0x80);
+    const uint8x16_t case_bit = vdupq_n_u8(0x20);
+    const uint8x16_t digit_lo = vdupq_n_u8('0');
+    const uint8x16_t digit_span = vdupq_n_u8(9);
+    const uint8x16_t alpha_lo = vdupq_n_u8('a');
+    const uint8x16_t alpha_span = vdupq_n_u8(25);
+    const uint8x16_t underscore = vdupq_n_u8('_');
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(s + i));
+        uint8x16_t word = vorrq_u8(
+            vorrq_u8(vcgeq_u8(v, high), vceqq_u8(v, underscore)),
+            vorrq_u8(vcleq_u8(vsubq_u8(v, digit_lo), digit_span),
+                     vcleq_u8(vsubq_u8(vorrq_u8(v, case_bit), alpha_lo), alpha_span)));
+        uint8x16_t bits = vandq_u8(word, bit);
+        uint64_t mask = (uint64_t)vaddv_u8(vget_low_u8(bits)) | ((uint64_t)vaddv_u8(vget_high_u8(bits)) << 8);
+        words |= mask << i;
+    }
+#endif
+
+    for (; i < count; i++) {
+        words |= (uint64_t)scan_is_word((unsigned char)s[i]) << i;
+    }
+    return words & ~((words << 1) | 1);
+}
+
+const char* discord_scan_backend(void) {
+#if defined(SCAN_SSE2)
+    return "sse2";
+#elif defined(SCAN_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
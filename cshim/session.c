@@ -0,0 +1,301 @@
+#include "abi.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/time.h>
+#endif
+
+// Crash-safe session snapshot
+// The snapshot is a small file mapped MAP_SHARED into the process. Writes
+// land in the kernel page cache immediately, so they survive a crash or a
+// redeploy of the process (not a power loss; call discord_session_flush for
+// that). The header fits in the first page, entity-cache pages follow it.
+
+#define SESSION_MAGIC   0x53455344u  // "DSES"
+#define SESSION_VERSION 1u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t shard_id;
+    uint32_t cache_pages;
+    uint32_t identity_gen;          // Seqlock: odd while identity is being written
+    int32_t sequence;               // Last sequence number (atomic store)
+    uint64_t updated_at_ms;         // Wall-clock time of last update
+    char session_id[DISCORD_SESSION_ID_MAX];
+    char resume_gateway_url[DISCORD_RESUME_URL_MAX];
+} discord_session_header_t;
+
+struct discord_session {
+    int fd;
+    unsigned char* map;
+    size_t map_size;
+    discord_session_header_t* header;
+};
+
+#ifndef _WIN32
+
+// Wall clock in ms; the monotonic clock restarts with the machine so it
+// cannot be used to age a snapshot written by a previous process.
+static uint64_t wall_now_ms(void) {
+    struct timeval tv;
+    if (gettimeofday(&tv, NULL) != 0) {
+        return 0;
+    }
+    return (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
+}
+
+discord_result_t discord_session_open(const char* path, int shard_id, uint32_t cache_pages, discord_session_t** session) {
+    if (!path || !session) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    size_t map_size = DISCORD_SESSION_PAGE_SIZE * ((size_t)cache_pages + 1);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    if ((size_t)st.st_size != map_size && ftruncate(fd, (off_t)map_size) != 0) {
+        close(fd);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    unsigned char* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    discord_session_t* s = malloc(sizeof(discord_session_t));
+    if (!s) {
+        munmap(map, map_size);
+        close(fd);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    s->fd = fd;
+    s->map = map;
+    s->map_size = map_size;
+    s->header = (discord_session_header_t*)map;
+
+    // A file from another shard, layout or page count starts fresh
+    discord_session_header_t* h = s->header;
+    if (h->magic != SESSION_MAGIC || h->version != SESSION_VERSION ||
+        h->shard_id != shard_id || h->cache_pages != cache_pages) {
+        memset(map, 0, map_size);
+        h->version = SESSION_VERSION;
+        h->shard_id = shard_id;
+        h->cache_pages = cache_pages;
+        h->sequence = -1;
+        __atomic_store_n(&h->magic, SESSION_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    // A writer that died mid-update leaves the seqlock odd; drop that identity
+    if (h->identity_gen & 1) {
+        h->session_id[0] = '\0';
+        h->resume_gateway_url[0] = '\0';
+        h->identity_gen++;
+    }
+
+    *session = s;
+    return DISCORD_OK;
+}
+
+void discord_session_store_sequence(discord_session_t* session, int sequence) {
+    if (!session) {
+        return;
+    }
+
+    // Hot path: two plain stores into the mapping, no syscalls
+    discord_session_header_t* h = session->header;
+    __atomic_store_n(&h->updated_at_ms, wall_now_ms(), __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+discord_result_t discord_session_store_identity(discord_session_t* session, const char* session_id, const char* resume_gateway_url) {
+    if (!session || !session_id || !resume_gateway_url) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    if (strlen(session_id) >= DISCORD_SESSION_ID_MAX ||
+        strlen(resume_gateway_url) >= DISCORD_RESUME_URL_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_session_header_t* h = session->header;
+    __atomic_add_fetch(&h->identity_gen, 1, __ATOMIC_ACQ_REL);
+
+    strcpy(h->session_id, session_id);
+    strcpy(h->resume_gateway_url, resume_gateway_url);
+    __atomic_store_n(&h->updated_at_ms, wall_now_ms(), __ATOMIC_RELAXED);
+
+    __atomic_add_fetch(&h->identity_gen, 1, __ATOMIC_ACQ_REL);
+
+    // READY is rare; schedule writeback without waiting for it
+    msync(session->map, DISCORD_SESSION_PAGE_SIZE, MS_ASYNC);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_session_load(discord_session_t* session, uint64_t max_age_ms, discord_session_state_t* state) {
+    if (!session || !state) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_session_header_t* h = session->header;
+    uint32_t gen;
+
+    do {
+        gen = __atomic_load_n(&h->identity_gen, __ATOMIC_ACQUIRE);
+        memcpy(state->session_id, h->session_id, DISCORD_SESSION_ID_MAX);
+        memcpy(state->resume_gateway_url, h->resume_gateway_url, DISCORD_RESUME_URL_MAX);
+        state->sequence = __atomic_load_n(&h->sequence, __ATOMIC_ACQUIRE);
+        state->saved_at_ms = __atomic_load_n(&h->updated_at_ms, __ATOMIC_RELAXED);
+    } while ((gen & 1) || gen != __atomic_load_n(&h->identity_gen, __ATOMIC_ACQUIRE));
+
+    state->session_id[DISCORD_SESSION_ID_MAX - 1] = '\0';
+    state->resume_gateway_url[DISCORD_RESUME_URL_MAX - 1] = '\0';
+
+    if (state->session_id[0] == '\0' || state->sequence < 0) {
+        return DISCORD_ERROR_NOT_FOUND;
+    }
+
+    uint64_t now = wall_now_ms();
+    if (now < state->saved_at_ms || now - state->saved_at_ms > max_age_ms) {
+        return DISCORD_ERROR_TIMEOUT;
+    }
+
+    return DISCORD_OK;
+}
+
+discord_result_t discord_session_connect_url(discord_session_t* session, const char* fallback_url, char* url_out, size_t url_size) {
+    if (!fallback_url || !url_out || url_size == 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // Resume against the URL READY handed out, falling back to the default
+    discord_session_state_t state;
+    const char* query = strchr(fallback_url, '?');
+    int written;
+
+    if (session && discord_session_load(session, DISCORD_SESSION_RESUME_WINDOW_MS, &state) == DISCORD_OK &&
+        state.resume_gateway_url[0] != '\0') {
+        written = snprintf(url_out, url_size, "%s/%s", state.resume_gateway_url, query ? query : "");
+    } else {
+        written = snprintf(url_out, url_size, "%s", fallback_url);
+    }
+
+    if (written < 0 || (size_t)written >= url_size) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    return DISCORD_OK;
+}
+
+void discord_session_invalidate(discord_session_t* session) {
+    if (!session) {
+        return;
+    }
+
+    discord_session_header_t* h = session->header;
+    __atomic_add_fetch(&h->identity_gen, 1, __ATOMIC_ACQ_REL);
+    h->session_id[0] = '\0';
+    h->resume_gateway_url[0] = '\0';
+    __atomic_store_n(&h->sequence, -1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&h->identity_gen, 1, __ATOMIC_ACQ_REL);
+}
+
+discord_result_t discord_session_cache_page(discord_session_t* session, uint32_t index, void** page, size_t* size) {
+    if (!session || !page || !size || index >= session->header->cache_pages) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    *page = session->map + DISCORD_SESSION_PAGE_SIZE * ((size_t)index + 1);
+    *size = DISCORD_SESSION_PAGE_SIZE;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_session_flush(discord_session_t* session) {
+    if (!session) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    if (msync(session->map, session->map_size, MS_SYNC) != 0) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    return DISCORD_OK;
+}
+
+void discord_session_close(discord_session_t* session) {
+    if (!session) {
+        return;
+    }
+
+    munmap(session->map, session->map_size);
+    close(session->fd);
+    free(session);
+}
+
+#else
+
+discord_result_t discord_session_open(const char* path, int shard_id, uint32_t cache_pages, discord_session_t** session) {
+    (void)path; (void)shard_id; (void)cache_pages; (void)session;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_session_store_sequence(discord_session_t* session, int sequence) {
+    (void)session; (void)sequence;
+}
+
+discord_result_t discord_session_store_identity(discord_session_t* session, const char* session_id, const char* resume_gateway_url) {
+    (void)session; (void)session_id; (void)resume_gateway_url;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_session_load(discord_session_t* session, uint64_t max_age_ms, discord_session_state_t* state) {
+    (void)session; (void)max_age_ms; (void)state;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_session_connect_url(discord_session_t* session, const char* fallback_url, char* url_out, size_t url_size) {
+    (void)session;
+    if (!fallback_url || !url_out || url_size == 0 || strlen(fallback_url) >= url_size) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    strcpy(url_out, fallback_url);
+    return DISCORD_OK;
+}
+
+void discord_session_invalidate(discord_session_t* session) {
+    (void)session;
+}
+
+discord_result_t discord_session_cache_page(discord_session_t* session, uint32_t index, void** page, size_t* size) {
+    (void)session; (void)index; (void)page; (void)size;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_session_flush(discord_session_t* session) {
+    (void)session;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_session_close(discord_session_t* session) {
+    (void)session;
+}
+
+#endif
@@ -0,0 +1,594 @@
+#include "abi.h"
+#include "shard.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Identify buckets
+// next_ms is the next free IDENTIFY slot per bucket. Callers reserve a slot
+// with a CAS instead of polling for one, so shards queued on a bucket each
+// wait once, in order, and threads share a limiter without a lock.
+struct discord_identify_limiter {
+    uint32_t max_concurrency;
+    uint64_t next_ms[];
+};
+
+discord_result_t discord_identify_limiter_create(uint32_t max_concurrency, discord_identify_limiter_t** limiter) {
+    if (!limiter || max_concurrency == 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_identify_limiter_t* l = discord_mem_calloc(DISCORD_MEM_OTHER, 1,
+        sizeof(discord_identify_limiter_t) + max_concurrency * sizeof(uint64_t));
+    if (!l) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    l->max_concurrency = max_concurrency;
+    *limiter = l;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_identify_limiter_acquire(discord_identify_limiter_t* limiter, int shard_id,
+                                                  uint64_t now_ms, uint64_t* retry_at_ms) {
+    if (!limiter || shard_id < 0 || !retry_at_ms) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t* slot = &limiter->next_ms[(uint32_t)shard_id % limiter->max_concurrency];
+    uint64_t next = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint64_t at = next > now_ms ? next : now_ms;
+        if (__atomic_compare_exchange_n(slot, &next, at + DISCORD_IDENTIFY_WINDOW_MS, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *retry_at_ms = at;
+            return at > now_ms ? DISCORD_ERROR_TIMEOUT : DISCORD_OK;
+        }
+    }
+}
+
+void discord_identify_limiter_destroy(discord_identify_limiter_t* limiter) {
+    discord_mem_free(limiter);
+}
+
+// Shard state
+// Timers are absolute discord_time_now_ms values; which ones are armed
+// depends on the state (reconnect_at_ms while DISCONNECTED, and so on),
+// plus the heartbeat once HELLO has set heartbeat_interval_ms.
+
+#define SHARD_EVENT_NAME_MAX 64
+
+struct discord_shard {
+    char* token;
+    char* url;
+    char* resume_url;               // resume_gateway_url from READY plus url's query
+    char* session_id;
+    discord_ws_options_t ws;
+    int has_ws;
+    int shard_id;
+    int shard_count;
+    discord_identify_limiter_t* limiter;
+    discord_coord_t* coord;
+    uint32_t backoff_base_ms;
+    uint32_t backoff_max_ms;
+    uint32_t rng;
+    discord_shard_frame_callback_t on_frame;
+    void* user;
+    int prewarm;
+
+    discord_gateway_t* gateway;
+    discord_ws_standby_t* standby;  // To resume_url, while prewarm is set
+    uint64_t standby_at_ms;         // Open (or replace) the standby
+    int standby_taken;              // HELLO may be buffered already; poll without waiting
+    uint32_t failures;              // Consecutive; reset by READY/RESUMED
+    uint64_t reconnect_at_ms;
+    uint64_t hello_deadline_ms;
+    uint64_t identify_at_ms;
+    int identify_reserved;          // identify_at_ms is a limiter slot
+    uint32_t heartbeat_interval_ms; // 0 until HELLO
+    uint64_t next_heartbeat_ms;
+    uint64_t heartbeat_sent_ms;
+    int heartbeat_acked;
+    discord_connect_timing_t timing; // Of the connection in progress
+    uint64_t connect_started_ns;
+    uint64_t login_sent_ns;         // IDENTIFY or RESUME
+    discord_shard_stats_t stats;
+};
+
+static char* shard_strdup(const char* s) {
+    size_t length = strlen(s);
+    char* copy = discord_mem_alloc(DISCORD_MEM_OTHER, length + 1);
+    if (copy) {
+        memcpy(copy, s, length + 1);
+    }
+    return copy;
+}
+
+// xorshift32; only used for jitter
+static uint32_t shard_random(discord_shard_t* shard, uint32_t bound) {
+    uint32_t x = shard->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    shard->rng = x;
+    return bound ? x % bound : 0;
+}
+
+// Exponential backoff with jitter: [d/2, d] where d doubles per failure
+static uint64_t shard_backoff(discord_shard_t* shard) {
+    uint64_t delay = shard->backoff_base_ms;
+    for (uint32_t i = 0; i < shard->failures && delay < shard->backoff_max_ms; i++) {
+        delay *= 2;
+    }
+    if (delay > shard->backoff_max_ms) {
+        delay = shard->backoff_max_ms;
+    }
+    shard->failures++;
+    return delay / 2 + shard_random(shard, (uint32_t)(delay / 2 + 1));
+}
+
+static void shard_forget_session(discord_shard_t* shard) {
+    discord_ws_standby_close(shard->standby);
+    shard->standby = NULL;
+    discord_mem_free(shard->session_id);
+    discord_mem_free(shard->resume_url);
+    shard->session_id = NULL;
+    shard->resume_url = NULL;
+    shard->stats.sequence = -1;
+}
+
+static void shard_disconnect(discord_shard_t* shard, uint64_t now, uint64_t delay_ms) {
+    if (shard->gateway) {
+        discord_ws_close(shard->gateway);
+        shard->gateway = NULL;
+        shard->stats.disconnects++;
+    }
+    shard->heartbeat_interval_ms = 0;
+    shard->stats.state = DISCORD_SHARD_DISCONNECTED;
+    shard->reconnect_at_ms = now + delay_ms;
+}
+
+static void shard_connect(discord_shard_t* shard, uint64_t now) {
+    // Resume against the URL READY handed out
+    const char* url = shard->session_id && shard->resume_url ? shard->resume_url : shard->url;
+    shard->connect_started_ns = discord_time_now_ns();
+    discord_result_t result = DISCORD_ERROR_NETWORK;
+    if (shard->standby && url == shard->resume_url) {
+        // Opened to this URL ahead of time: the handshake is already done
+        result = discord_ws_standby_take(shard->standby, &shard->gateway);
+        shard->standby = NULL;
+        if (result == DISCORD_OK) {
+            shard->stats.standbys_used++;
+            shard->standby_taken = 1;
+        }
+    }
+    if (result != DISCORD_OK) {
+        result = discord_ws_connect_ex(url, shard->has_ws ? &shard->ws : NULL, &shard->gateway);
+    }
+    if (result != DISCORD_OK) {
+        shard->gateway = NULL;
+        shard->stats.connect_failures++;
+        shard->reconnect_at_ms = now + shard_backoff(shard);
+        return;
+    }
+
+    shard->stats.connects++;
+    shard->stats.state = DISCORD_SHARD_WAITING_HELLO;
+    shard->hello_deadline_ms = now + DISCORD_SHARD_HELLO_TIMEOUT_MS;
+}
+
+// Sends and frees json; a failed send drops the connection
+static void shard_send_owned(discord_shard_t* shard, char* json, uint64_t now) {
+    discord_result_t result = discord_ws_send(shard->gateway, json, strlen(json));
+    discord_json_free(json);
+    if (result != DISCORD_OK) {
+        shard_disconnect(shard, now, shard_backoff(shard));
+    }
+}
+
+static void shard_identify(discord_shard_t* shard, uint64_t now) {
+    uint64_t slot_ms = now;
+    discord_result_t result = DISCORD_OK;
+    if (!shard->identify_reserved && shard->coord) {
+        result = discord_coord_acquire(shard->coord, shard->shard_id, now, &slot_ms);
+        if (result == DISCORD_ERROR_NOT_FOUND) {
+            // Moved to another process: ask again until destroyed
+            shard->stats.state = DISCORD_SHARD_IDENTIFY_QUEUED;
+            shard->identify_at_ms = now + shard->backoff_base_ms;
+            return;
+        }
+    } else if (!shard->identify_reserved && shard->limiter) {
+        result = discord_identify_limiter_acquire(shard->limiter, shard->shard_id, now, &slot_ms);
+    }
+    if (result == DISCORD_ERROR_TIMEOUT) {
+        shard->stats.state = DISCORD_SHARD_IDENTIFY_QUEUED;
+        shard->stats.identify_waits++;
+        shard->identify_at_ms = slot_ms;
+        shard->identify_reserved = 1;
+        return;
+    }
+    shard->identify_reserved = 0;
+
+    char* json;
+    if (discord_json_create_identify_sharded(shard->token, shard->shard_id, shard->shard_count,
+                                             &json) != DISCORD_OK) {
+        shard_disconnect(shard, now, shard_backoff(shard));
+        return;
+    }
+    shard->stats.identifies++;
+    shard->stats.state = DISCORD_SHARD_IDENTIFYING;
+    shard->login_sent_ns = discord_time_now_ns();
+    shard_send_owned(shard, json, now);
+}
+
+static void shard_resume(discord_shard_t* shard, uint64_t now) {
+    char* json;
+    if (discord_json_create_resume(shard->token, shard->session_id, shard->stats.sequence, &json) != DISCORD_OK) {
+        shard_disconnect(shard, now, shard_backoff(shard));
+        return;
+    }
+    shard->stats.resumes++;
+    shard->stats.state = DISCORD_SHARD_RESUMING;
+    shard->login_sent_ns = discord_time_now_ns();
+    shard_send_owned(shard, json, now);
+}
+
+static void shard_heartbeat(discord_shard_t* shard, uint64_t now) {
+    char* json;
+    if (discord_json_create_heartbeat(shard->stats.sequence, &json) != DISCORD_OK) {
+        return;
+    }
+    shard->stats.heartbeats++;
+    shard->heartbeat_sent_ms = now;
+    shard->heartbeat_acked = 0;
+    shard->next_heartbeat_ms = now + shard->heartbeat_interval_ms;
+    shard_send_owned(shard, json, now);
+}
+
+static void shard_ready(discord_shard_t* shard, const char* json, uint64_t now) {
+    char* session_id;
+    char* resume_gateway_url;
+    if (discord_json_parse_ready(json, &session_id, &resume_gateway_url) != DISCORD_OK) {
+        return;
+    }
+
+    const char* query = strchr(shard->url, '?');
+    size_t size = strlen(resume_gateway_url) + (query ? strlen(query) : 0) + 2;
+    char* resume_url = discord_mem_alloc(DISCORD_MEM_OTHER, size);
+    if (resume_url) {
+        snprintf(resume_url, size, "%s/%s", resume_gateway_url, query ? query : "");
+    }
+    discord_json_free(resume_gateway_url);
+
+    discord_mem_free(shard->session_id);
+    discord_mem_free(shard->resume_url);
+    shard->session_id = session_id;
+    shard->resume_url = resume_url;
+
+    if (shard->stats.first_ready_ms == 0) {
+        shard->stats.first_ready_ms = now;
+    }
+}
+
+// The transport phases come from the gateway (lws finishes its handshake
+// after connect returns); what is left until HELLO is the wait for it
+static void shard_hello_timing(discord_shard_t* shard) {
+    uint64_t elapsed = discord_time_now_ns() - shard->connect_started_ns;
+    discord_ws_get_connect_timing(shard->gateway, &shard->timing);
+    uint64_t transport = shard->timing.prewarmed ? 0 : shard->timing.dns_ns + shard->timing.tcp_ns +
+                                                       shard->timing.tls_ns + shard->timing.upgrade_ns;
+    shard->timing.hello_ns = elapsed > transport ? elapsed - transport : 0;
+}
+
+static void shard_ready_timing(discord_shard_t* shard) {
+    uint64_t now_ns = discord_time_now_ns();
+    shard->timing.ready_ns = now_ns - shard->login_sent_ns;
+    shard->timing.total_ns = now_ns - shard->connect_started_ns;
+    shard->stats.last_connect = shard->timing;
+}
+
+// Open a standby to the resume URL, replacing one that is about to expire
+static void shard_prewarm(discord_shard_t* shard, uint64_t now) {
+    discord_ws_standby_close(shard->standby);
+    shard->standby = NULL;
+    if (discord_ws_prewarm(shard->resume_url, shard->has_ws ? &shard->ws : NULL, &shard->standby) != DISCORD_OK) {
+        shard->standby = NULL;
+    }
+    shard->standby_at_ms = now + DISCORD_SHARD_STANDBY_REFRESH_MS;
+}
+
+static void shard_handle(discord_shard_t* shard, const char* json, uint64_t now) {
+    int op, sequence;
+    char event[SHARD_EVENT_NAME_MAX];
+    const char* data;
+    size_t data_length;
+    if (discord_json_parse_envelope(json, &op, &sequence, event, sizeof(event), &data, &data_length) != DISCORD_OK) {
+        return;
+    }
+
+    switch (op) {
+        case DISCORD_OP_HELLO: {
+            int interval = 0;
+            if (!data || discord_json_parse_root_int(data, data_length, "heartbeat_interval", &interval) != DISCORD_OK ||
+                interval <= 0) {
+                shard_disconnect(shard, now, shard_backoff(shard));
+                return;
+            }
+            // First beat at a random point of the interval so shards
+            // started together don't heartbeat in lockstep
+            shard->heartbeat_interval_ms = (uint32_t)interval;
+            shard->next_heartbeat_ms = now + shard_random(shard, (uint32_t)interval);
+            shard->heartbeat_acked = 1;
+            shard_hello_timing(shard);
+            if (shard->session_id) {
+                shard_resume(shard, now);
+            } else if (shard->identify_reserved && shard->identify_at_ms > now) {
+                // The slot reserved before the last connection dropped is
+                // still ahead; wait for it rather than queue again
+                shard->stats.state = DISCORD_SHARD_IDENTIFY_QUEUED;
+            } else {
+                shard->identify_reserved = 0;
+                shard_identify(shard, now);
+            }
+            break;
+        }
+
+        case DISCORD_OP_HEARTBEAT:
+            shard_heartbeat(shard, now);
+            break;
+
+        case DISCORD_OP_HEARTBEAT_ACK:
+            shard->heartbeat_acked = 1;
+            shard->stats.heartbeat_acks++;
+            shard->stats.latency_ms = (uint32_t)(now - shard->heartbeat_sent_ms);
+            break;
+
+        case DISCORD_OP_RECONNECT:
+            shard->stats.reconnects_requested++;
+            shard_disconnect(shard, now, 0);
+            break;
+
+        case DISCORD_OP_INVALID_SESSION: {
+            // Wait 1-5 seconds, then resume on a new connection when the
+            // session survived or identify again on this one
+            uint64_t delay = 1000 + shard_random(shard, 4001);
+            shard->stats.invalid_sessions++;
+            if (data_length == 4 && memcmp(data, "true", 4) == 0 && shard->session_id) {
+                shard_disconnect(shard, now, delay);
+            } else {
+                shard_forget_session(shard);
+                shard->stats.state = DISCORD_SHARD_IDENTIFY_QUEUED;
+                shard->identify_at_ms = now + delay;
+            }
+            break;
+        }
+
+        case DISCORD_OP_DISPATCH:
+            shard->stats.dispatches++;
+            if (sequence >= 0) {
+                shard->stats.sequence = sequence;
+            }
+            if (strcmp(event, "READY") == 0) {
+                shard_ready(shard, json, now);
+            } else if (strcmp(event, "RESUMED") != 0) {
+                break;
+            }
+            shard->stats.state = DISCORD_SHARD_READY;
+            shard->stats.readies++;
+            shard->failures = 0;
+            if (shard->coord) {
+                discord_coord_report_ready(shard->coord, shard->shard_id);
+            }
+            shard_ready_timing(shard);
+            shard->standby_at_ms = now;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void shard_run_timers(discord_shard_t* shard, uint64_t now) {
+    switch (shard->stats.state) {
+        case DISCORD_SHARD_DISCONNECTED:
+            if (now >= shard->reconnect_at_ms) {
+                shard_connect(shard, now);
+            }
+            break;
+
+        case DISCORD_SHARD_WAITING_HELLO:
+            if (now >= shard->hello_deadline_ms) {
+                shard->stats.connect_failures++;
+                shard_disconnect(shard, now, shard_backoff(shard));
+            }
+            break;
+
+        case DISCORD_SHARD_IDENTIFY_QUEUED:
+            if (now >= shard->identify_at_ms) {
+                shard_identify(shard, now);
+            }
+            break;
+
+        case DISCORD_SHARD_READY:
+            if (shard->prewarm && shard->resume_url && now >= shard->standby_at_ms) {
+                shard_prewarm(shard, now);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (shard->gateway && shard->heartbeat_interval_ms && now >= shard->next_heartbeat_ms) {
+        if (!shard->heartbeat_acked) {
+            // Zombied connection: drop it and resume
+            shard->stats.zombies++;
+            shard_disconnect(shard, now, shard_backoff(shard));
+        } else {
+            shard_heartbeat(shard, now);
+        }
+    }
+}
+
+discord_result_t discord_shard_create(const discord_shard_config_t* config, discord_shard_t** shard) {
+    if (!config || !shard || !config->token || !config->url || config->shard_count < 0 ||
+        (config->shard_count > 0 && (config->shard_id < 0 || config->shard_id >= config->shard_count))) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_shard_t* s = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_shard_t));
+    if (!s) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    s->token = shard_strdup(config->token);
+    s->url = shard_strdup(config->url);
+    if (!s->token || !s->url) {
+        discord_shard_destroy(s);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    if (config->ws) {
+        s->ws = *config->ws;
+        s->has_ws = 1;
+    }
+    s->shard_id = config->shard_id;
+    s->shard_count = config->shard_count;
+    s->limiter = config->limiter;
+    s->coord = config->coord;
+    s->backoff_base_ms = config->backoff_base_ms ? config->backoff_base_ms : DISCORD_SHARD_BACKOFF_BASE_MS;
+    s->backoff_max_ms = config->backoff_max_ms ? config->backoff_max_ms : DISCORD_SHARD_BACKOFF_MAX_MS;
+    if (s->backoff_max_ms < s->backoff_base_ms) {
+        s->backoff_max_ms = s->backoff_base_ms;
+    }
+    s->rng = config->seed ? config->seed : (uint32_t)config->shard_id * 2654435761u + 1;
+    if (s->rng == 0) {
+        s->rng = 1;
+    }
+    s->on_frame = config->on_frame;
+    s->user = config->user;
+    s->prewarm = config->prewarm;
+
+    s->stats.state = DISCORD_SHARD_DISCONNECTED;
+    s->stats.sequence = -1;
+
+    *shard = s;
+    return DISCORD_OK;
+}
+
+uint64_t discord_shard_next_deadline(const discord_shard_t* shard) {
+    uint64_t deadline = UINT64_MAX;
+    if (!shard) {
+        return deadline;
+    }
+
+    switch (shard->stats.state) {
+        case DISCORD_SHARD_DISCONNECTED:
+            deadline = shard->reconnect_at_ms;
+            break;
+        case DISCORD_SHARD_WAITING_HELLO:
+            deadline = shard->standby_taken ? 0 : shard->hello_deadline_ms;
+            break;
+        case DISCORD_SHARD_IDENTIFY_QUEUED:
+            deadline = shard->identify_at_ms;
+            break;
+        case DISCORD_SHARD_READY:
+            if (shard->prewarm && shard->resume_url) {
+                deadline = shard->standby_at_ms;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (shard->gateway && shard->heartbeat_interval_ms && shard->next_heartbeat_ms < deadline) {
+        deadline = shard->next_heartbeat_ms;
+    }
+    return deadline;
+}
+
+discord_result_t discord_shard_poll(discord_shard_t* shard, int timeout_ms) {
+    if (!shard) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t now = discord_time_now_ms();
+    shard_run_timers(shard, now);
+
+    // Never wait past the next timer
+    uint64_t deadline = discord_shard_next_deadline(shard);
+    int wait = timeout_ms > 0 ? timeout_ms : 0;
+    if (deadline <= now) {
+        wait = 0;
+    } else if (deadline - now < (uint64_t)wait) {
+        wait = (int)(deadline - now);
+    }
+
+    if (!shard->gateway) {
+        // Nothing to read while waiting to reconnect
+        if (wait > 0) {
+            discord_sleep_ms((uint32_t)wait);
+            shard_run_timers(shard, discord_time_now_ms());
+        }
+        return DISCORD_OK;
+    }
+
+    shard->standby_taken = 0;
+    while (shard->gateway) {
+        discord_ws_message_t message = {0};
+        discord_result_t result = discord_ws_receive(shard->gateway, &message, wait);
+        wait = 0;
+        if (result == DISCORD_ERROR_TIMEOUT) {
+            break;
+        }
+
+        now = discord_time_now_ms();
+        if (result != DISCORD_OK) {
+            // Connection lost: come back with a RESUME after the backoff
+            shard_disconnect(shard, now, shard_backoff(shard));
+            break;
+        }
+
+        if (message.data && !message.is_binary) {
+            shard_handle(shard, message.data, now);
+            if (shard->on_frame) {
+                shard->on_frame(shard->user, shard, message.data, message.length);
+            }
+        }
+        discord_ws_free_message(&message);
+    }
+
+    shard_run_timers(shard, discord_time_now_ms());
+    return DISCORD_OK;
+}
+
+discord_result_t discord_shard_send(discord_shard_t* shard, const char* data, size_t length) {
+    if (!shard || !data || length == 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    if (!shard->gateway) {
+        return DISCORD_ERROR_NETWORK;
+    }
+    return discord_ws_send(shard->gateway, data, length);
+}
+
+discord_result_t discord_shard_get_stats(const discord_shard_t* shard, discord_shard_stats_t* stats) {
+    if (!shard || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    *stats = shard->stats;
+    return DISCORD_OK;
+}
+
+void discord_shard_destroy(discord_shard_t* shard) {
+    if (!shard) {
+        return;
+    }
+    if (shard->gateway) {
+        discord_ws_close(shard->gateway);
+    }
+    shard_forget_session(shard);
+    discord_mem_free(shard->token);
+    discord_mem_free(shard->url);
+    discord_mem_free(shard);
+}
@@ -0,0 +1,782 @@
+#include "internal.h"
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Discrete-event gateway simulation
+// Everything that happens later (a frame reaching the client, a payload
+// reaching the gateway, a dispatch tick, a shard timer) is an event in one
+// binary heap ordered by (due_ms, order). Running the simulation pops
+// events and sets the virtual clock to each one's due time, so idle
+// stretches cost nothing and thousands of shards heartbeating every 41 s
+// cost only their own events.
+//
+// A connection is shared by the client handle (until discord_ws_close) and
+// by the events that still point at it; refs counts both and the last one
+// frees it.
+
+#define SIM_NO_SHARD        UINT32_MAX
+#define SIM_RESUME_URL      "sim://resume"
+#define SIM_FRAME_MAX       512
+
+typedef enum {
+    SIM_EVENT_DELIVER = 0,          // Frame reaches the client
+    SIM_EVENT_GATEWAY,              // Client payload reaches the gateway
+    SIM_EVENT_DISPATCH,             // Next MESSAGE_CREATE for a ready session
+    SIM_EVENT_WAKE                  // Poll a shard (discord_sim_run only)
+} sim_event_kind_t;
+
+typedef struct {
+    uint64_t due_ms;
+    uint64_t order;                 // FIFO among events due together
+    uint32_t kind;
+    uint32_t shard;                 // WAKE
+    uint32_t run;                   // WAKE: discord_sim_run it belongs to
+    uint32_t generation;            // WAKE: stale unless it matches the shard's
+    struct discord_sim_conn* conn;
+    char* data;                     // DELIVER/GATEWAY payload (NUL-terminated)
+    size_t length;
+} sim_event_t;
+
+typedef struct sim_frame {
+    struct sim_frame* next;
+    char* data;
+    size_t length;
+} sim_frame_t;
+
+typedef struct {
+    int sequence;                   // Last sequence sent on the session
+    int shard_id;
+    int shard_count;
+    int valid;
+} sim_session_t;
+
+struct discord_sim_conn {
+    discord_sim_t* sim;             // NULL once the simulation is destroyed
+    uint32_t refs;
+    int client_open;                // discord_ws_close not called yet
+    int gateway_open;               // Gateway side still answering
+    int ready;                      // Past READY/RESUMED
+    int dispatching;                // A DISPATCH event is pending
+    uint32_t session;               // Valid while ready
+    discord_shard_t* owner;         // Shard polling it in discord_sim_run
+    uint32_t owner_index;
+    sim_frame_t* head;              // Frames delivered, not yet received
+    sim_frame_t* tail;
+    discord_recorder_t* recorder;
+    struct discord_sim_conn* prev;  // Live connections
+    struct discord_sim_conn* next;
+};
+
+typedef struct {
+    uint32_t generation;
+    uint64_t wake_ms;               // Due time of the current WAKE, UINT64_MAX if none
+} sim_shard_slot_t;
+
+struct discord_sim {
+    discord_sim_config_t config;
+    uint64_t now_ms;
+    uint64_t next_order;
+    uint32_t rng;
+    int running;                    // Inside discord_sim_run
+
+    sim_event_t* events;            // Binary heap
+    size_t event_count;
+    size_t event_capacity;
+
+    sim_session_t* sessions;
+    uint32_t session_count;
+    uint32_t session_capacity;
+    uint64_t* bucket_next_ms;       // Per identify bucket
+
+    struct discord_sim_conn* connections;
+
+    // discord_sim_run state
+    discord_shard_t** shards;
+    uint32_t shard_count;
+    sim_shard_slot_t* slots;
+    uint32_t run;
+    uint32_t polling;               // Shard being polled, SIM_NO_SHARD otherwise
+
+    discord_sim_stats_t stats;
+};
+
+// The simulation connections are routed to and whose clock is installed
+static discord_sim_t* sim_active = NULL;
+
+static uint32_t sim_random(discord_sim_t* sim, uint32_t bound) {
+    uint32_t x = sim->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->rng = x;
+    return x % bound;
+}
+
+static int sim_chance(discord_sim_t* sim, uint32_t permille) {
+    return permille && sim_random(sim, 1000) < permille;
+}
+
+// Event heap
+
+static int sim_event_before(const sim_event_t* a, const sim_event_t* b) {
+    return a->due_ms < b->due_ms || (a->due_ms == b->due_ms && a->order < b->order);
+}
+
+static discord_result_t sim_push(discord_sim_t* sim, sim_event_t* event) {
+    if (sim->event_count == sim->event_capacity) {
+        size_t capacity = sim->event_capacity ? sim->event_capacity * 2 : 1024;
+        sim_event_t* events = discord_mem_realloc(DISCORD_MEM_OTHER, sim->events, capacity * sizeof(sim_event_t));
+        if (!events) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        sim->events = events;
+        sim->event_capacity = capacity;
+    }
+
+    event->order = sim->next_order++;
+    if (event->conn) {
+        event->conn->refs++;
+    }
+
+    size_t i = sim->event_count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!sim_event_before(event, &sim->events[parent])) {
+            break;
+        }
+        sim->events[i] = sim->events[parent];
+        i = parent;
+    }
+    sim->events[i] = *event;
+    return DISCORD_OK;
+}
+
+static void sim_pop(discord_sim_t* sim, sim_event_t* out) {
+    *out = sim->events[0];
+    sim_event_t last = sim->events[--sim->event_count];
+    size_t count = sim->event_count;
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && sim_event_before(&sim->events[child + 1], &sim->events[child])) {
+            child++;
+        }
+        if (!sim_event_before(&sim->events[child], &last)) {
+            break;
+        }
+        sim->events[i] = sim->events[child];
+        i = child;
+    }
+    if (count > 0) {
+        sim->events[i] = last;
+    }
+}
+
+// Connections
+
+static void sim_free_frames(struct discord_sim_conn* conn) {
+    while (conn->head) {
+        sim_frame_t* frame = conn->head;
+        conn->head = frame->next;
+        discord_mem_free(frame->data);
+        discord_mem_free(frame);
+    }
+    conn->tail = NULL;
+}
+
+static void sim_unlink(struct discord_sim_conn* conn) {
+    discord_sim_t* sim = conn->sim;
+    if (!sim) {
+        return;
+    }
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    } else {
+        sim->connections = conn->next;
+    }
+    if (conn->next) {
+        conn->next->prev = conn->prev;
+    }
+    conn->prev = conn->next = NULL;
+    if (conn->ready) {
+        sim->stats.sessions_ready--;
+    }
+    sim->stats.connections--;
+    conn->sim = NULL;
+}
+
+static void sim_release(struct discord_sim_conn* conn) {
+    if (--conn->refs == 0) {
+        sim_free_frames(conn);
+        discord_mem_free(conn);
+    }
+}
+
+// The shard reading conn, if it takes part in the current run
+static uint32_t sim_owner(discord_sim_t* sim, struct discord_sim_conn* conn) {
+    if (sim->running && conn->owner && conn->owner_index < sim->shard_count &&
+        sim->shards[conn->owner_index] == conn->owner) {
+        return conn->owner_index;
+    }
+    return SIM_NO_SHARD;
+}
+
+static void sim_schedule_wake(discord_sim_t* sim, uint32_t index, uint64_t due_ms) {
+    sim_shard_slot_t* slot = &sim->slots[index];
+    if (slot->wake_ms <= due_ms) {
+        return;                         // An earlier poll reschedules anyway
+    }
+    if (due_ms < sim->now_ms) {
+        due_ms = sim->now_ms;
+    }
+
+    sim_event_t event = {0};
+    event.due_ms = due_ms;
+    event.kind = SIM_EVENT_WAKE;
+    event.shard = index;
+    event.run = sim->run;
+    event.generation = ++slot->generation;
+    slot->wake_ms = sim_push(sim, &event) == DISCORD_OK ? due_ms : UINT64_MAX;
+}
+
+// Gateway side
+
+static void sim_send_frame_after(discord_sim_t* sim, struct discord_sim_conn* conn, const char* frame,
+                                 uint64_t delay_ms) {
+    size_t length = strlen(frame);
+    char* data = discord_mem_alloc(DISCORD_MEM_RECEIVE, length + 1);
+    if (!data) {
+        return;
+    }
+    memcpy(data, frame, length + 1);
+
+    sim_event_t event = {0};
+    event.due_ms = sim->now_ms + delay_ms + sim->config.latency_ms;
+    event.kind = SIM_EVENT_DELIVER;
+    event.conn = conn;
+    event.data = data;
+    event.length = length;
+    if (sim_push(sim, &event) != DISCORD_OK) {
+        discord_mem_free(data);
+    }
+}
+
+static void sim_send_frame(discord_sim_t* sim, struct discord_sim_conn* conn, const char* frame) {
+    sim_send_frame_after(sim, conn, frame, 0);
+}
+
+static void sim_send_op(discord_sim_t* sim, struct discord_sim_conn* conn, int op, const char* d) {
+    char frame[SIM_FRAME_MAX];
+    snprintf(frame, sizeof(frame), "{\"op\":%d,\"d\":%s}", op, d);
+    sim_send_frame(sim, conn, frame);
+}
+
+static void sim_make_ready(discord_sim_t* sim, struct discord_sim_conn* conn, uint32_t session) {
+    conn->session = session;
+    if (!conn->ready) {
+        conn->ready = 1;
+        sim->stats.sessions_ready++;
+    }
+
+    if (sim->config.dispatch_interval_ms && !conn->dispatching) {
+        conn->dispatching = 1;
+        sim_event_t event = {0};
+        event.due_ms = sim->now_ms + sim->config.dispatch_interval_ms;
+        event.kind = SIM_EVENT_DISPATCH;
+        event.conn = conn;
+        sim_push(sim, &event);
+    }
+}
+
+static void sim_reject_session(discord_sim_t* sim, struct discord_sim_conn* conn) {
+    if (conn->ready) {
+        conn->ready = 0;
+        sim->stats.sessions_ready--;
+    }
+    sim_send_op(sim, conn, DISCORD_OP_INVALID_SESSION, "false");
+}
+
+// Value of key in the outermost object of json, NULL if missing
+static const char* sim_find(const char* json, size_t length, const char* key, size_t* value_length) {
+    const char* cursor = json;
+    const char* name;
+    size_t name_length;
+    const char* value;
+    while (discord_json_object_next(&cursor, json + length, &name, &name_length, &value, value_length) == DISCORD_OK) {
+        if (name_length == strlen(key) && memcmp(name, key, name_length) == 0) {
+            return value;
+        }
+    }
+    return NULL;
+}
+
+static void sim_identify(discord_sim_t* sim, struct discord_sim_conn* conn, const char* d, size_t d_length) {
+    sim->stats.identifies++;
+
+    // "shard":[id,count] picks the bucket; unsharded bots use bucket 0
+    int shard_id = 0, shard_count = 0;
+    size_t length;
+    const char* shard = d ? sim_find(d, d_length, "shard", &length) : NULL;
+    if (shard && length > 2 && shard[0] == '[') {
+        char* end;
+        shard_id = (int)strtol(shard + 1, &end, 10);
+        if (*end == ',') {
+            shard_count = (int)strtol(end + 1, NULL, 10);
+        }
+    }
+
+    uint64_t* bucket = &sim->bucket_next_ms[(uint32_t)shard_id % sim->config.max_concurrency];
+    if (shard_id < 0 || sim->now_ms < *bucket || conn->ready) {
+        sim->stats.identify_rejected++;
+        sim_reject_session(sim, conn);
+        return;
+    }
+    *bucket = sim->now_ms + DISCORD_IDENTIFY_WINDOW_MS;
+
+    if (sim->session_count == sim->session_capacity) {
+        uint32_t capacity = sim->session_capacity ? sim->session_capacity * 2 : 256;
+        sim_session_t* sessions = discord_mem_realloc(DISCORD_MEM_OTHER, sim->sessions,
+                                                      capacity * sizeof(sim_session_t));
+        if (!sessions) {
+            return;
+        }
+        sim->sessions = sessions;
+        sim->session_capacity = capacity;
+    }
+
+    uint32_t id = sim->session_count++;
+    sim_session_t* session = &sim->sessions[id];
+    session->sequence = 1;
+    session->shard_id = shard_id;
+    session->shard_count = shard_count;
+    session->valid = 1;
+    sim_make_ready(sim, conn, id);
+
+    char frame[SIM_FRAME_MAX];
+    snprintf(frame, sizeof(frame),
+             "{\"op\":0,\"s\":1,\"t\":\"READY\",\"d\":{\"v\":10,\"session_id\":\"sim-%u\","
+             "\"resume_gateway_url\":\"" SIM_RESUME_URL "\",\"shard\":[%d,%d]}}",
+             id, shard_id, shard_count);
+    sim_send_frame(sim, conn, frame);
+}
+
+static void sim_resume(discord_sim_t* sim, struct discord_sim_conn* conn, const char* d, size_t d_length) {
+    sim->stats.resumes++;
+
+    size_t length;
+    const char* value = d ? sim_find(d, d_length, "session_id", &length) : NULL;
+    uint32_t id = UINT32_MAX;
+    if (value && length > 5 && memcmp(value, "\"sim-", 5) == 0) {
+        id = (uint32_t)strtoul(value + 5, NULL, 10);
+    }
+
+    if (id >= sim->session_count || !sim->sessions[id].valid || conn->ready ||
+        sim_chance(sim, sim->config.resume_reject_permille)) {
+        if (id < sim->session_count) {
+            sim->sessions[id].valid = 0;
+        }
+        sim->stats.resume_rejected++;
+        sim_reject_session(sim, conn);
+        return;
+    }
+
+    sim_make_ready(sim, conn, id);
+    char frame[SIM_FRAME_MAX];
+    snprintf(frame, sizeof(frame), "{\"op\":0,\"s\":%d,\"t\":\"RESUMED\",\"d\":{}}",
+             ++sim->sessions[id].sequence);
+    sim_send_frame(sim, conn, frame);
+}
+
+static void sim_gateway_receive(discord_sim_t* sim, struct discord_sim_conn* conn, const char* json) {
+    int op, sequence;
+    char event[64];
+    const char* d;
+    size_t d_length;
+    if (discord_json_parse_envelope(json, &op, &sequence, event, sizeof(event), &d, &d_length) != DISCORD_OK) {
+        return;
+    }
+
+    switch (op) {
+        case DISCORD_OP_HEARTBEAT:
+            sim->stats.heartbeats++;
+            if (sim_chance(sim, sim->config.ack_loss_permille)) {
+                sim->stats.acks_dropped++;
+            } else {
+                sim_send_op(sim, conn, DISCORD_OP_HEARTBEAT_ACK, "null");
+            }
+            if (conn->ready && sim_chance(sim, sim->config.reconnect_permille)) {
+                sim->stats.reconnects_sent++;
+                sim_send_op(sim, conn, DISCORD_OP_RECONNECT, "null");
+            }
+            break;
+
+        case DISCORD_OP_IDENTIFY:
+            sim_identify(sim, conn, d, d_length);
+            break;
+
+        case DISCORD_OP_RESUME:
+            sim_resume(sim, conn, d, d_length);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void sim_dispatch(discord_sim_t* sim, struct discord_sim_conn* conn) {
+    if (!conn->ready || !conn->gateway_open) {
+        conn->dispatching = 0;
+        return;
+    }
+
+    sim_session_t* session = &sim->sessions[conn->session];
+    char frame[SIM_FRAME_MAX];
+    snprintf(frame, sizeof(frame),
+             "{\"op\":0,\"s\":%d,\"t\":\"MESSAGE_CREATE\",\"d\":{\"id\":\"%llu\",\"channel_id\":\"%d\","
+             "\"content\":\"ping\",\"author\":{\"id\":\"1\",\"username\":\"sim\"}}}",
+             ++session->sequence, (unsigned long long)sim->stats.dispatches_sent, session->shard_id);
+    sim->stats.dispatches_sent++;
+    sim_send_frame(sim, conn, frame);
+
+    sim_event_t event = {0};
+    event.due_ms = sim->now_ms + sim->config.dispatch_interval_ms;
+    event.kind = SIM_EVENT_DISPATCH;
+    event.conn = conn;
+    sim_push(sim, &event);
+}
+
+static void sim_process(discord_sim_t* sim, sim_event_t* event) {
+    struct discord_sim_conn* conn = event->conn;
+    sim->stats.events++;
+
+    switch (event->kind) {
+        case SIM_EVENT_DELIVER:
+            if (conn->client_open && conn->sim) {
+                sim_frame_t* frame = discord_mem_alloc(DISCORD_MEM_RECEIVE, sizeof(sim_frame_t));
+                if (frame) {
+                    frame->next = NULL;
+                    frame->data = event->data;
+                    frame->length = event->length;
+                    event->data = NULL;
+                    if (conn->tail) {
+                        conn->tail->next = frame;
+                    } else {
+                        conn->head = frame;
+                    }
+                    conn->tail = frame;
+                    sim->stats.frames_delivered++;
+
+                    uint32_t owner = sim_owner(sim, conn);
+                    if (owner != SIM_NO_SHARD) {
+                        sim_schedule_wake(sim, owner, sim->now_ms);
+                    }
+                }
+            }
+            break;
+
+        case SIM_EVENT_GATEWAY:
+            if (conn->gateway_open && conn->sim) {
+                sim_gateway_receive(sim, conn, event->data);
+            }
+            break;
+
+        case SIM_EVENT_DISPATCH:
+            sim_dispatch(sim, conn);
+            break;
+
+        case SIM_EVENT_WAKE: {
+            if (!sim->running || event->run != sim->run || event->shard >= sim->shard_count ||
+                sim->slots[event->shard].generation != event->generation) {
+                break;                  // Superseded by a later wake
+            }
+            uint32_t index = event->shard;
+            discord_shard_t* shard = sim->shards[index];
+            sim->slots[index].wake_ms = UINT64_MAX;
+            sim->polling = index;
+            discord_shard_poll(shard, 0);
+            sim->polling = SIM_NO_SHARD;
+
+            uint64_t deadline = discord_shard_next_deadline(shard);
+            if (deadline != UINT64_MAX) {
+                sim_schedule_wake(sim, index, deadline);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    discord_mem_free(event->data);
+    if (conn) {
+        sim_release(conn);
+    }
+}
+
+// Run events due by until_ms, stopping early once watch has a frame
+static void sim_advance_until(discord_sim_t* sim, uint64_t until_ms, struct discord_sim_conn* watch) {
+    while (sim->event_count > 0 && sim->events[0].due_ms <= until_ms) {
+        sim_event_t event;
+        sim_pop(sim, &event);
+        if (event.due_ms > sim->now_ms) {
+            sim->now_ms = event.due_ms;
+        }
+        sim_process(sim, &event);
+        if (watch && watch->head) {
+            return;
+        }
+    }
+    if (until_ms > sim->now_ms) {
+        sim->now_ms = until_ms;
+    }
+}
+
+// Virtual clock
+
+static uint64_t sim_clock_now_ns(void* user) {
+    return ((discord_sim_t*)user)->now_ms * 1000000ull;
+}
+
+static void sim_clock_sleep_ms(void* user, uint32_t milliseconds) {
+    discord_sim_t* sim = user;
+    if (!sim->running) {
+        sim_advance_until(sim, sim->now_ms + milliseconds, NULL);
+    }
+}
+
+// Public API
+
+discord_result_t discord_sim_create(const discord_sim_config_t* config, discord_sim_t** sim) {
+    if (!sim || sim_active) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_sim_t* s = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(discord_sim_t));
+    if (!s) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    if (config) {
+        s->config = *config;
+    }
+    if (s->config.heartbeat_interval_ms == 0) {
+        s->config.heartbeat_interval_ms = DISCORD_SIM_HEARTBEAT_INTERVAL_MS;
+    }
+    if (s->config.max_concurrency == 0) {
+        s->config.max_concurrency = 1;
+    }
+    s->rng = s->config.seed ? s->config.seed : 1;
+    s->polling = SIM_NO_SHARD;
+
+    s->bucket_next_ms = discord_mem_calloc(DISCORD_MEM_OTHER, s->config.max_concurrency, sizeof(uint64_t));
+    if (!s->bucket_next_ms) {
+        discord_mem_free(s);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    discord_clock_t clock = { sim_clock_now_ns, sim_clock_sleep_ms, s };
+    discord_set_clock(&clock);
+    sim_active = s;
+
+    *sim = s;
+    return DISCORD_OK;
+}
+
+void discord_sim_destroy(discord_sim_t* sim) {
+    if (!sim) {
+        return;
+    }
+
+    // Pending events hold connection references; drop them first
+    for (size_t i = 0; i < sim->event_count; i++) {
+        discord_mem_free(sim->events[i].data);
+        if (sim->events[i].conn) {
+            sim_release(sim->events[i].conn);
+        }
+    }
+
+    // Connections still held by clients stay allocated until closed
+    while (sim->connections) {
+        struct discord_sim_conn* conn = sim->connections;
+        conn->gateway_open = 0;
+        sim_unlink(conn);
+    }
+
+    if (sim_active == sim) {
+        sim_active = NULL;
+        discord_set_clock(NULL);
+    }
+
+    discord_mem_free(sim->events);
+    discord_mem_free(sim->sessions);
+    discord_mem_free(sim->bucket_next_ms);
+    discord_mem_free(sim);
+}
+
+uint64_t discord_sim_now_ms(const discord_sim_t* sim) {
+    return sim ? sim->now_ms : 0;
+}
+
+discord_result_t discord_sim_run(discord_sim_t* sim, discord_shard_t** shards, uint32_t shard_count,
+                                 uint64_t duration_ms) {
+    if (!sim || sim->running || (shard_count > 0 && !shards)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    sim->slots = NULL;
+    if (shard_count > 0) {
+        sim->slots = discord_mem_calloc(DISCORD_MEM_OTHER, shard_count, sizeof(sim_shard_slot_t));
+        if (!sim->slots) {
+            return DISCORD_ERROR_MEMORY;
+        }
+    }
+
+    sim->shards = shards;
+    sim->shard_count = shard_count;
+    sim->run++;
+    sim->running = 1;
+
+    for (uint32_t i = 0; i < shard_count; i++) {
+        sim->slots[i].wake_ms = UINT64_MAX;
+        sim_schedule_wake(sim, i, sim->now_ms);
+    }
+
+    sim_advance_until(sim, sim->now_ms + duration_ms, NULL);
+
+    sim->running = 0;
+    sim->shards = NULL;
+    sim->shard_count = 0;
+    discord_mem_free(sim->slots);
+    sim->slots = NULL;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_sim_advance(discord_sim_t* sim, uint64_t duration_ms) {
+    if (!sim || sim->running) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    sim_advance_until(sim, sim->now_ms + duration_ms, NULL);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_sim_get_stats(const discord_sim_t* sim, discord_sim_stats_t* stats) {
+    if (!sim || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+    *stats = sim->stats;
+    stats->now_ms = sim->now_ms;
+    return DISCORD_OK;
+}
+
+// Transport entry points (ws.c)
+
+discord_result_t discord_sim_conn_open(const char* url, discord_gateway_t* gateway) {
+    (void)url;                          // Every URL reaches the same gateway
+    discord_sim_t* sim = sim_active;
+    if (!sim) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    struct discord_sim_conn* conn = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(struct discord_sim_conn));
+    if (!conn) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    conn->sim = sim;
+    conn->refs = 1;
+    conn->client_open = 1;
+    conn->gateway_open = 1;
+    conn->next = sim->connections;
+    if (sim->connections) {
+        sim->connections->prev = conn;
+    }
+    sim->connections = conn;
+    sim->stats.connections++;
+    sim->stats.connects++;
+
+    // Connections opened while a shard is being polled belong to it
+    if (sim->polling != SIM_NO_SHARD) {
+        conn->owner = sim->shards[sim->polling];
+        conn->owner_index = sim->polling;
+    }
+
+    char hello[64];
+    snprintf(hello, sizeof(hello), "{\"op\":%d,\"d\":{\"heartbeat_interval\":%u}}", DISCORD_OP_HELLO,
+             sim->config.heartbeat_interval_ms);
+    sim_send_frame_after(sim, conn, hello, sim->config.handshake_ms);
+
+    gateway->sim = conn;
+    gateway->state = DISCORD_STATE_CONNECTED;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_sim_conn_send(struct discord_sim_conn* conn, const char* data, size_t length) {
+    discord_sim_t* sim = conn->sim;
+    if (!sim || !conn->gateway_open) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    char* copy = discord_mem_alloc(DISCORD_MEM_SEND, length + 1);
+    if (!copy) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    memcpy(copy, data, length);
+    copy[length] = '\0';
+
+    sim_event_t event = {0};
+    event.due_ms = sim->now_ms + sim->config.latency_ms;
+    event.kind = SIM_EVENT_GATEWAY;
+    event.conn = conn;
+    event.data = copy;
+    event.length = length;
+    discord_result_t result = sim_push(sim, &event);
+    if (result != DISCORD_OK) {
+        discord_mem_free(copy);
+    }
+    return result;
+}
+
+discord_result_t discord_sim_conn_receive(struct discord_sim_conn* conn, discord_ws_message_t* message,
+                                          int timeout_ms) {
+    // Outside discord_sim_run a blocking receive moves virtual time forward
+    discord_sim_t* sim = conn->sim;
+    if (!conn->head && sim && !sim->running && timeout_ms > 0) {
+        sim_advance_until(sim, sim->now_ms + (uint64_t)timeout_ms, conn);
+    }
+
+    sim_frame_t* frame = conn->head;
+    if (!frame) {
+        return conn->sim ? DISCORD_ERROR_TIMEOUT : DISCORD_ERROR_NETWORK;
+    }
+
+    conn->head = frame->next;
+    if (!conn->head) {
+        conn->tail = NULL;
+    }
+    message->data = frame->data;
+    message->length = frame->length;
+    message->is_binary = 0;
+    discord_mem_free(frame);
+
+    if (conn->recorder) {
+        discord_record_frame(conn->recorder, message->data, message->length, 0);
+    }
+    return DISCORD_OK;
+}
+
+void discord_sim_conn_close(struct discord_sim_conn* conn) {
+    conn->client_open = 0;
+    conn->gateway_open = 0;
+    sim_free_frames(conn);
+    sim_unlink(conn);
+    sim_release(conn);
+}
+
+void discord_sim_conn_set_recorder(struct discord_sim_conn* conn, discord_recorder_t* recorder) {
+    conn->recorder = recorder;
+}
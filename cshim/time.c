@@ -13,7 +13,26 @@
     #include <sys/time.h>
 #endif
 
-uint64_t discord_time_now_ms(void) {
+// Replaceable clock
+// time_clock holds a copy of the caller's clock; time_virtual is set once
+// it is filled in, so readers only pay an atomic load when none is set.
+static discord_clock_t time_clock;
+static int time_virtual = 0;
+
+discord_result_t discord_set_clock(const discord_clock_t* clock) {
+    if (clock && !clock->now_ns) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    __atomic_store_n(&time_virtual, 0, __ATOMIC_RELEASE);
+    if (clock) {
+        time_clock = *clock;
+        __atomic_store_n(&time_virtual, 1, __ATOMIC_RELEASE);
+    }
+    return DISCORD_OK;
+}
+
+static uint64_t system_now_ms(void) {
 #ifdef _WIN32
     // Windows: Use GetTickCount64 for millisecond precision
     return GetTickCount64();
@@ -44,7 +63,56 @@ uint64_t discord_time_now_ms(void) {
 #endif
 }
 
+static uint64_t system_now_ns(void) {
+#ifdef _WIN32
+    // Windows: QueryPerformanceCounter scaled to nanoseconds
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase = {0, 0};
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    }
+    
+    return system_now_ms() * 1000000ull;
+#endif
+}
+
+uint64_t discord_time_now_ms(void) {
+    if (__atomic_load_n(&time_virtual, __ATOMIC_ACQUIRE)) {
+        return time_clock.now_ns(time_clock.user) / 1000000ull;
+    }
+    return system_now_ms();
+}
+
+uint64_t discord_time_now_ns(void) {
+    if (__atomic_load_n(&time_virtual, __ATOMIC_ACQUIRE)) {
+        return time_clock.now_ns(time_clock.user);
+    }
+    return system_now_ns();
+}
+
 void discord_sleep_ms(uint32_t milliseconds) {
+    if (__atomic_load_n(&time_virtual, __ATOMIC_ACQUIRE)) {
+        if (time_clock.sleep_ms) {
+            time_clock.sleep_ms(time_clock.user, milliseconds);
+        }
+        return;
+    }
+
 #ifdef _WIN32
     Sleep(milliseconds);
 #else
@@ -0,0 +1,226 @@
+#include "abi.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <signal.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+    #define TRACE_THREAD_LOCAL __thread
+#endif
+
+// Per-thread span ring
+// Only the owning thread writes spans and bumps head; the dumper reads
+// whatever is there. Rings are linked into a global list on first use and
+// are never freed, so a dump can walk them without locking.
+
+#define TRACE_RING_MASK (DISCORD_TRACE_RING_SIZE - 1)
+
+typedef struct {
+    uint64_t start_tsc;
+    uint64_t end_tsc;
+    uint32_t stage;
+    uint32_t arg;
+} trace_span_t;
+
+typedef struct trace_ring {
+    struct trace_ring* next;
+    uint32_t tid;
+    volatile uint64_t head;
+    trace_span_t spans[DISCORD_TRACE_RING_SIZE];
+} trace_ring_t;
+
+volatile int discord_trace_enabled = 0;
+
+static trace_ring_t* volatile ring_list = NULL;
+static volatile uint32_t ring_count = 0;
+static TRACE_THREAD_LOCAL trace_ring_t* thread_ring = NULL;
+
+// Timestamp-counter ticks per microsecond, measured once by the first
+// discord_trace_enable so dumps never wait for a calibration window
+static double ticks_per_us = 0.0;
+
+static volatile sig_atomic_t dump_requested = 0;
+static char dump_path[512];
+
+static const char* stage_names[DISCORD_TRACE_STAGE_COUNT] = {
+    "ws_service",
+    "ws_copy",
+    "json_parse",
+    "process_message",
+    "handler",
+    "ws_send"
+};
+
+static trace_ring_t* ring_register(void) {
+    trace_ring_t* ring = calloc(1, sizeof(trace_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+
+#ifdef _MSC_VER
+    ring->tid = (uint32_t)InterlockedIncrement((volatile LONG*)&ring_count);
+    trace_ring_t* old;
+    do {
+        old = ring_list;
+        ring->next = old;
+    } while (InterlockedCompareExchangePointer((void* volatile*)&ring_list, ring, old) != old);
+#else
+    ring->tid = __atomic_add_fetch(&ring_count, 1, __ATOMIC_RELAXED);
+    trace_ring_t* old = __atomic_load_n(&ring_list, __ATOMIC_ACQUIRE);
+    do {
+        ring->next = old;
+    } while (!__atomic_compare_exchange_n(&ring_list, &old, ring, 0,
+                                          __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+#endif
+
+    return ring;
+}
+
+// Count ticks over at least 10ms of the monotonic clock
+static void trace_calibrate(void) {
+    uint64_t start_tsc = discord_trace_tsc();
+    uint64_t start_ns = discord_time_now_ns();
+    while (discord_time_now_ns() - start_ns < 10000000ull) {
+        discord_sleep_ms(1);
+    }
+    double ticks = (double)(discord_trace_tsc() - start_tsc) /
+                   ((double)(discord_time_now_ns() - start_ns) / 1000.0);
+    ticks_per_us = ticks > 0.0 ? ticks : 1.0;
+}
+
+void discord_trace_enable(int enabled) {
+    if (enabled && ticks_per_us == 0.0) {
+        trace_calibrate();
+    }
+    discord_trace_enabled = enabled ? 1 : 0;
+}
+
+void discord_trace_record_since(uint32_t stage, uint64_t start_tsc, uint32_t arg) {
+    uint64_t end_tsc = discord_trace_tsc();
+
+    trace_ring_t* ring = thread_ring;
+    if (!ring) {
+        ring = thread_ring = ring_register();
+        if (!ring) {
+            return;
+        }
+    }
+
+    uint64_t head = ring->head;
+    trace_span_t* span = &ring->spans[head & TRACE_RING_MASK];
+    span->start_tsc = start_tsc;
+    span->end_tsc = end_tsc;
+    span->stage = stage;
+    span->arg = arg;
+
+#ifdef _MSC_VER
+    _WriteBarrier();
+    ring->head = head + 1;
+#else
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+#endif
+}
+
+uint64_t discord_trace_span_count(void) {
+    uint64_t total = 0;
+    for (trace_ring_t* ring = ring_list; ring; ring = ring->next) {
+        uint64_t head = ring->head;
+        total += head < DISCORD_TRACE_RING_SIZE ? head : DISCORD_TRACE_RING_SIZE;
+    }
+    return total;
+}
+
+void discord_trace_reset(void) {
+    // Only meaningful while writers are idle (e.g. tracing disabled)
+    for (trace_ring_t* ring = ring_list; ring; ring = ring->next) {
+        ring->head = 0;
+    }
+}
+
+discord_result_t discord_trace_dump(const char* path) {
+    if (!path) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // Spans only exist once tracing was enabled, which calibrated the clock
+    double scale = ticks_per_us > 0.0 ? ticks_per_us : 1.0;
+
+    // Earliest retained span becomes t=0
+    uint64_t base_tsc = UINT64_MAX;
+    for (trace_ring_t* ring = ring_list; ring; ring = ring->next) {
+        uint64_t head = ring->head;
+        uint64_t first = head > DISCORD_TRACE_RING_SIZE ? head - DISCORD_TRACE_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; i++) {
+            uint64_t start = ring->spans[i & TRACE_RING_MASK].start_tsc;
+            if (start < base_tsc) {
+                base_tsc = start;
+            }
+        }
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    int first_event = 1;
+    for (trace_ring_t* ring = ring_list; ring; ring = ring->next) {
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                     "\"args\":{\"name\":\"discord-asm-%u\"}}",
+                first_event ? "" : ",", ring->tid, ring->tid);
+        first_event = 0;
+
+        uint64_t head = ring->head;
+        uint64_t first = head > DISCORD_TRACE_RING_SIZE ? head - DISCORD_TRACE_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; i++) {
+            const trace_span_t* span = &ring->spans[i & TRACE_RING_MASK];
+            const char* name = span->stage < DISCORD_TRACE_STAGE_COUNT ? stage_names[span->stage] : "unknown";
+            double ts = (double)(span->start_tsc - base_tsc) / scale;
+            double dur = (double)(span->end_tsc - span->start_tsc) / scale;
+
+            fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                         "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%u}}",
+                    name, ring->tid, ts, dur, span->arg);
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+
+    if (fclose(out) != 0) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    return DISCORD_OK;
+}
+
+// Signal handlers may only set a flag; the dump happens in discord_trace_poll
+static void trace_signal_handler(int signum) {
+    (void)signum;
+    dump_requested = 1;
+}
+
+discord_result_t discord_trace_install_signal(int signum, const char* path) {
+    if (!path || strlen(path) >= sizeof(dump_path)) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    strcpy(dump_path, path);
+    if (signal(signum, trace_signal_handler) == SIG_ERR) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    return DISCORD_OK;
+}
+
+void discord_trace_poll(void) {
+    if (DISCORD_TRACE_UNLIKELY(dump_requested)) {
+        dump_requested = 0;
+        discord_trace_dump(dump_path);
+    }
+}
@@ -0,0 +1,994 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE                         // sendmmsg
+#endif
+
+#include "abi.h"
+#include "voice.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Voice state update for the main gateway (no sockets involved)
+discord_result_t discord_voice_create_state_update(const char* guild_id, const char* channel_id,
+                                                   int self_mute, int self_deaf, char** json_out) {
+    if (!guild_id || !json_out || !*guild_id || strlen(guild_id) > 24 ||
+        (channel_id && (!*channel_id || strlen(channel_id) > 24))) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    char* json = discord_mem_alloc(DISCORD_MEM_JSON, 160);
+    if (!json) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    char channel[32] = "null";
+    if (channel_id) {
+        snprintf(channel, sizeof(channel), "\"%s\"", channel_id);
+    }
+    snprintf(json, 160, "{\"op\":%d,\"d\":{\"guild_id\":\"%s\",\"channel_id\":%s,"
+             "\"self_mute\":%s,\"self_deaf\":%s}}",
+             DISCORD_OP_VOICE_STATE, guild_id, channel,
+             self_mute ? "true" : "false", self_deaf ? "true" : "false");
+
+    *json_out = json;
+    return DISCORD_OK;
+}
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+
+// Handshake state lives on the connection and is only touched by the
+// thread feeding discord_voice_handle. The sender thread reads a
+// connection once its state is READY (published with a release store after
+// the cipher is set up) and from then on owns the RTP counters and the
+// queue head; the producer owns the queue tail.
+
+#define VOICE_ID_MAX        32
+#define VOICE_FIELD_MAX     256                 // session_id, token
+#define VOICE_RTP_HEADER    12
+#define VOICE_TAG_SIZE      16
+#define VOICE_NONCE_SIZE    4
+#define VOICE_PACKET_MAX    (VOICE_RTP_HEADER + DISCORD_VOICE_FRAME_MAX + VOICE_TAG_SIZE + VOICE_NONCE_SIZE)
+#define VOICE_DISCOVERY_SIZE 74
+#define VOICE_DISCOVERY_TRIES 3
+#define VOICE_QUEUE_MAX     4096
+#define VOICE_FRAME_NS      (DISCORD_VOICE_FRAME_MS * 1000000ull)
+#define VOICE_SPIN_NS       200000ull           // Spin out the last part of each wait
+#define VOICE_LATE_NS       1000000ull
+#define VOICE_RESYNC_TICKS  5                   // Further behind than this: skip, don't burst
+
+static const unsigned char opus_silence[3] = { 0xF8, 0xFF, 0xFE };
+
+typedef struct {
+    uint16_t length;
+    unsigned char data[DISCORD_VOICE_FRAME_MAX];
+} voice_frame_t;
+
+struct discord_voice {
+    discord_voice_sender_t* sender;
+    discord_gateway_t* gateway;
+    int owns_gateway;               // Opened by discord_voice_connect
+    discord_voice_send_t send;
+    void* send_user;
+    char server_id[VOICE_ID_MAX];
+    char user_id[VOICE_ID_MAX];
+    char session_id[VOICE_FIELD_MAX];
+    char token[VOICE_FIELD_MAX];
+    int state;                      // discord_voice_state_t
+    int sequence_ack;               // Last "seq" from the server, -1 before any
+    uint32_t heartbeat_interval_ms;
+    uint64_t next_heartbeat_ms;
+    uint32_t ssrc;
+    struct sockaddr_in remote;
+    EVP_CIPHER_CTX* cipher;
+    voice_frame_t* frames;
+    uint32_t frame_mask;
+    uint32_t head;                  // Next frame to send (sender)
+    uint32_t tail;                  // Next free slot (producer)
+    uint16_t rtp_sequence;
+    uint32_t rtp_timestamp;
+    uint32_t nonce;
+    int speaking;                   // Sent a queued frame on the last tick
+    uint32_t silence_left;
+    discord_voice_stats_t stats;
+};
+
+struct discord_voice_sender {
+    int fd;
+    pthread_mutex_t lock;           // Streams, packet buffers and stats
+    pthread_mutex_t discovery_lock; // One IP discovery on the socket at a time
+    discord_voice_t* streams[DISCORD_VOICE_MAX_STREAMS];
+    uint32_t stream_count;
+    pthread_t thread;
+    int running;
+    discord_voice_sender_stats_t stats;
+    unsigned char packets[DISCORD_VOICE_BATCH][VOICE_PACKET_MAX];
+    struct iovec iov[DISCORD_VOICE_BATCH];
+#ifdef __linux__
+    struct mmsghdr msgs[DISCORD_VOICE_BATCH];
+#else
+    struct msghdr msgs[DISCORD_VOICE_BATCH];
+#endif
+};
+
+static void put16(unsigned char* p, uint16_t v) {
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+}
+
+static void put32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static uint16_t get16(const unsigned char* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int valid_id(const char* id) {
+    size_t len = id ? strlen(id) : 0;
+    if (len == 0 || len >= VOICE_ID_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (id[i] < '0' || id[i] > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Session ids and tokens go into JSON unescaped, so refuse anything odd
+static int valid_field(const char* value) {
+    size_t len = value ? strlen(value) : 0;
+    if (len == 0 || len >= VOICE_FIELD_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)value[i];
+        if (c < 0x20 || c == '"' || c == '\\') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Raw value of a top-level key in an object
+static int object_field(const char* object, size_t length, const char* key,
+                        const char** value, size_t* value_length) {
+    const char* cursor = object;
+    const char* end = object + length;
+    const char* k;
+    size_t k_len;
+    size_t key_len = strlen(key);
+    while (discord_json_object_next(&cursor, end, &k, &k_len, value, value_length) == DISCORD_OK) {
+        if (k_len == key_len && memcmp(k, key, key_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int token_number(const char* value, size_t length, double* number) {
+    char buffer[32];
+    if (length == 0 || length >= sizeof(buffer)) {
+        return 0;
+    }
+    memcpy(buffer, value, length);
+    buffer[length] = '\0';
+    char* end = NULL;
+    *number = strtod(buffer, &end);
+    return end != buffer;
+}
+
+// Copy a string token without its quotes
+static int token_string(const char* value, size_t length, char* out, size_t out_size) {
+    if (length < 2 || value[0] != '"' || length - 2 >= out_size) {
+        return 0;
+    }
+    memcpy(out, value + 1, length - 2);
+    out[length - 2] = '\0';
+    return 1;
+}
+
+static discord_result_t voice_send(discord_voice_t* voice, const char* json, size_t length) {
+    return voice->send ? voice->send(voice->send_user, json, length)
+                       : discord_ws_send(voice->gateway, json, length);
+}
+
+static discord_result_t voice_fail(discord_voice_t* voice, discord_result_t result) {
+    __atomic_store_n(&voice->state, DISCORD_VOICE_FAILED, __ATOMIC_RELEASE);
+    return result;
+}
+
+// IP discovery: ask the voice server which address and port our packets
+// come from; Discord needs them in SELECT_PROTOCOL
+static discord_result_t voice_discover(discord_voice_t* voice, char* address, size_t address_size,
+                                       uint16_t* port) {
+    discord_voice_sender_t* sender = voice->sender;
+    unsigned char request[VOICE_DISCOVERY_SIZE] = {0};
+    put16(request, 0x1);
+    put16(request + 2, 70);
+    put32(request + 4, voice->ssrc);
+
+    discord_result_t result = DISCORD_ERROR_TIMEOUT;
+    pthread_mutex_lock(&sender->discovery_lock);
+
+    for (int attempt = 0; attempt < VOICE_DISCOVERY_TRIES && result == DISCORD_ERROR_TIMEOUT; attempt++) {
+        if (sendto(sender->fd, request, sizeof(request), 0,
+                   (const struct sockaddr*)&voice->remote, sizeof(voice->remote)) != (ssize_t)sizeof(request)) {
+            result = DISCORD_ERROR_NETWORK;
+            break;
+        }
+
+        uint64_t deadline = discord_time_now_ms() + DISCORD_VOICE_DISCOVERY_TIMEOUT_MS / VOICE_DISCOVERY_TRIES;
+        for (;;) {
+            uint64_t now = discord_time_now_ms();
+            if (now >= deadline) {
+                break;
+            }
+            struct pollfd pfd = { sender->fd, POLLIN, 0 };
+            if (poll(&pfd, 1, (int)(deadline - now)) <= 0) {
+                continue;
+            }
+
+            unsigned char response[VOICE_DISCOVERY_SIZE + 16];
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            ssize_t n = recvfrom(sender->fd, response, sizeof(response), 0, (struct sockaddr*)&from, &from_len);
+
+            // Anything else arriving on the shared socket (inbound audio,
+            // other streams' replies) is dropped here
+            if (n < VOICE_DISCOVERY_SIZE || get16(response) != 0x2 || get32(response + 4) != voice->ssrc ||
+                from.sin_addr.s_addr != voice->remote.sin_addr.s_addr || from.sin_port != voice->remote.sin_port) {
+                continue;
+            }
+
+            size_t length = strnlen((const char*)response + 8, 64);
+            if (length == 0 || length >= address_size || length == 64) {
+                result = DISCORD_ERROR_NETWORK;
+                break;
+            }
+            memcpy(address, response + 8, length);
+            address[length] = '\0';
+            *port = get16(response + 72);
+            result = DISCORD_OK;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&sender->discovery_lock);
+    return result;
+}
+
+static discord_result_t handle_hello(discord_voice_t* voice, const char* d, size_t d_len) {
+    const char* value;
+    size_t value_len;
+    double interval;
+    if (!object_field(d, d_len, "heartbeat_interval", &value, &value_len) ||
+        !token_number(value, value_len, &interval) || interval < 1.0) {
+        return voice_fail(voice, DISCORD_ERROR_JSON);
+    }
+
+    voice->heartbeat_interval_ms = (uint32_t)interval;
+    voice->next_heartbeat_ms = discord_time_now_ms() + voice->heartbeat_interval_ms;
+
+    char json[VOICE_FIELD_MAX * 2 + 160];
+    int length = snprintf(json, sizeof(json),
+        "{\"op\":%d,\"d\":{\"server_id\":\"%s\",\"user_id\":\"%s\",\"session_id\":\"%s\",\"token\":\"%s\"}}",
+        DISCORD_VOICE_OP_IDENTIFY, voice->server_id, voice->user_id, voice->session_id, voice->token);
+    return voice_send(voice, json, (size_t)length);
+}
+
+static discord_result_t handle_ready(discord_voice_t* voice, const char* d, size_t d_len) {
+    const char* value;
+    size_t value_len;
+    double number;
+    char ip[64];
+
+    if (!object_field(d, d_len, "ssrc", &value, &value_len) || !token_number(value, value_len, &number)) {
+        return voice_fail(voice, DISCORD_ERROR_JSON);
+    }
+    voice->ssrc = (uint32_t)number;
+
+    if (!object_field(d, d_len, "ip", &value, &value_len) || !token_string(value, value_len, ip, sizeof(ip)) ||
+        !object_field(d, d_len, "port", &value, &value_len) || !token_number(value, value_len, &number) ||
+        number < 1 || number > 65535) {
+        return voice_fail(voice, DISCORD_ERROR_JSON);
+    }
+
+    // We only speak the AES-GCM mode OpenSSL can do natively
+    int supported = 0;
+    if (object_field(d, d_len, "modes", &value, &value_len)) {
+        const char* cursor = value;
+        const char* mode;
+        size_t mode_len;
+        while (discord_json_array_next(&cursor, value + value_len, &mode, &mode_len) == DISCORD_OK) {
+            if (mode_len == sizeof(DISCORD_VOICE_MODE) + 1 &&
+                memcmp(mode + 1, DISCORD_VOICE_MODE, sizeof(DISCORD_VOICE_MODE) - 1) == 0) {
+                supported = 1;
+            }
+        }
+    }
+    if (!supported) {
+        return voice_fail(voice, DISCORD_ERROR_UNSUPPORTED);
+    }
+
+    memset(&voice->remote, 0, sizeof(voice->remote));
+    voice->remote.sin_family = AF_INET;
+    voice->remote.sin_port = htons((uint16_t)number);
+    if (inet_pton(AF_INET, ip, &voice->remote.sin_addr) != 1) {
+        return voice_fail(voice, DISCORD_ERROR_JSON);
+    }
+
+    char address[64];
+    uint16_t port = 0;
+    discord_result_t result = voice_discover(voice, address, sizeof(address), &port);
+    if (result != DISCORD_OK) {
+        return voice_fail(voice, result);
+    }
+
+    char json[256];
+    int length = snprintf(json, sizeof(json),
+        "{\"op\":%d,\"d\":{\"protocol\":\"udp\",\"data\":{\"address\":\"%s\",\"port\":%u,\"mode\":\"%s\"}}}",
+        DISCORD_VOICE_OP_SELECT_PROTOCOL, address, port, DISCORD_VOICE_MODE);
+    result = voice_send(voice, json, (size_t)length);
+    if (result == DISCORD_OK) {
+        voice->state = DISCORD_VOICE_SELECTING;
+    }
+    return result;
+}
+
+static discord_result_t handle_session_description(discord_voice_t* voice, const char* d, size_t d_len) {
+    const char* value;
+    size_t value_len;
+    unsigned char key[32];
+    size_t key_len = 0;
+
+    if (!object_field(d, d_len, "secret_key", &value, &value_len)) {
+        return voice_fail(voice, DISCORD_ERROR_JSON);
+    }
+
+    const char* cursor = value;
+    const char* element;
+    size_t element_len;
+    double byte;
+    while (discord_json_array_next(&cursor, value + value_len, &element, &element_len) == DISCORD_OK) {
+        if (key_len == sizeof(key) || !token_number(element, element_len, &byte) || byte < 0 || byte > 255) {
+            return voice_fail(voice, DISCORD_ERROR_JSON);
+        }
+        key[key_len++] = (unsigned char)byte;
+    }
+    if (key_len != sizeof(key)) {
+        return voice_fail(voice, DISCORD_ERROR_JSON);
+    }
+
+    EVP_CIPHER_CTX* cipher = EVP_CIPHER_CTX_new();
+    if (!cipher || EVP_EncryptInit_ex(cipher, EVP_aes_256_gcm(), NULL, key, NULL) != 1) {
+        EVP_CIPHER_CTX_free(cipher);
+        return voice_fail(voice, DISCORD_ERROR_MEMORY);
+    }
+    memset(key, 0, sizeof(key));
+
+    char json[128];
+    int length = snprintf(json, sizeof(json), "{\"op\":%d,\"d\":{\"speaking\":1,\"delay\":0,\"ssrc\":%u}}",
+                          DISCORD_VOICE_OP_SPEAKING, voice->ssrc);
+    discord_result_t result = voice_send(voice, json, (size_t)length);
+    if (result != DISCORD_OK) {
+        EVP_CIPHER_CTX_free(cipher);
+        return result;
+    }
+
+    EVP_CIPHER_CTX_free(voice->cipher);
+    voice->cipher = cipher;
+    __atomic_store_n(&voice->state, DISCORD_VOICE_READY, __ATOMIC_RELEASE);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_voice_handle(discord_voice_t* voice, const char* data, size_t length) {
+    if (!voice || !data) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    int op;
+    if (discord_json_parse_root_int(data, length, "op", &op) != DISCORD_OK) {
+        return DISCORD_ERROR_JSON;
+    }
+
+    int seq;
+    if (discord_json_parse_root_int(data, length, "seq", &seq) == DISCORD_OK) {
+        voice->sequence_ack = seq;
+    }
+
+    const char* d = NULL;
+    size_t d_len = 0;
+    object_field(data, length, "d", &d, &d_len);
+    if (!d && op != DISCORD_VOICE_OP_HEARTBEAT_ACK) {
+        return DISCORD_ERROR_JSON;
+    }
+
+    switch (op) {
+        case DISCORD_VOICE_OP_HELLO:
+            return handle_hello(voice, d, d_len);
+        case DISCORD_VOICE_OP_READY:
+            return handle_ready(voice, d, d_len);
+        case DISCORD_VOICE_OP_SESSION_DESCRIPTION:
+            return handle_session_description(voice, d, d_len);
+        case DISCORD_VOICE_OP_HEARTBEAT_ACK:
+            voice->stats.heartbeat_acks++;
+            return DISCORD_OK;
+        default:
+            return DISCORD_OK; // SPEAKING, CLIENT_DISCONNECT, ... are not needed to send
+    }
+}
+
+discord_result_t discord_voice_poll(discord_voice_t* voice, uint64_t now_ms) {
+    if (!voice) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    // Connections from discord_voice_connect read their own socket
+    if (voice->owns_gateway) {
+        discord_ws_message_t message;
+        while (discord_ws_receive(voice->gateway, &message, 0) == DISCORD_OK) {
+            discord_result_t result = discord_voice_handle(voice, message.data, message.length);
+            discord_ws_free_message(&message);
+            if (result != DISCORD_OK) {
+                return result;
+            }
+        }
+    }
+
+    if (voice->heartbeat_interval_ms == 0 || now_ms < voice->next_heartbeat_ms) {
+        return DISCORD_OK;
+    }
+
+    char json[96];
+    int length = snprintf(json, sizeof(json), "{\"op\":%d,\"d\":{\"t\":%llu,\"seq_ack\":%d}}",
+                          DISCORD_VOICE_OP_HEARTBEAT, (unsigned long long)now_ms, voice->sequence_ack);
+    voice->next_heartbeat_ms = now_ms + voice->heartbeat_interval_ms;
+    voice->stats.heartbeats++;
+    return voice_send(voice, json, (size_t)length);
+}
+
+discord_result_t discord_voice_create(const discord_voice_config_t* config, discord_voice_t** voice) {
+    if (!config || !voice || !config->sender || (!config->gateway && !config->send) ||
+        !valid_id(config->server_id) || !valid_id(config->user_id) ||
+        !valid_field(config->session_id) || !valid_field(config->token) ||
+        config->queue_frames > VOICE_QUEUE_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t capacity = 1;
+    uint32_t wanted = config->queue_frames ? config->queue_frames : DISCORD_VOICE_QUEUE_FRAMES;
+    while (capacity < wanted) {
+        capacity <<= 1;
+    }
+
+    discord_voice_t* v = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(*v));
+    if (!v) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    v->frames = discord_mem_alloc(DISCORD_MEM_SEND, capacity * sizeof(voice_frame_t));
+    if (!v->frames) {
+        discord_mem_free(v);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    v->sender = config->sender;
+    v->gateway = config->gateway;
+    v->send = config->send;
+    v->send_user = config->send_user;
+    snprintf(v->server_id, sizeof(v->server_id), "%s", config->server_id);
+    snprintf(v->user_id, sizeof(v->user_id), "%s", config->user_id);
+    snprintf(v->session_id, sizeof(v->session_id), "%s", config->session_id);
+    snprintf(v->token, sizeof(v->token), "%s", config->token);
+    v->state = DISCORD_VOICE_CONNECTING;
+    v->sequence_ack = -1;
+    v->frame_mask = capacity - 1;
+
+    // Random starting points, as RTP asks for
+    uint64_t seed = discord_time_now_ns() ^ (uint64_t)(uintptr_t)v;
+    v->rtp_sequence = (uint16_t)(seed >> 7);
+    v->rtp_timestamp = (uint32_t)(seed >> 17);
+
+    discord_voice_sender_t* sender = config->sender;
+    pthread_mutex_lock(&sender->lock);
+    if (sender->stream_count == DISCORD_VOICE_MAX_STREAMS) {
+        pthread_mutex_unlock(&sender->lock);
+        discord_mem_free(v->frames);
+        discord_mem_free(v);
+        return DISCORD_ERROR_MEMORY;
+    }
+    sender->streams[sender->stream_count++] = v;
+    pthread_mutex_unlock(&sender->lock);
+
+    *voice = v;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_voice_connect(const char* endpoint, const discord_voice_config_t* config,
+                                       int timeout_ms, discord_voice_t** voice) {
+    if (!endpoint || !*endpoint || !config || !voice) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    char url[512];
+    if (strstr(endpoint, "://")) {
+        snprintf(url, sizeof(url), "%s", endpoint);
+    } else {
+        snprintf(url, sizeof(url), "wss://%s/?v=%d", endpoint, DISCORD_VOICE_GATEWAY_VERSION);
+    }
+
+    discord_gateway_t* gateway = NULL;
+    discord_result_t result = discord_ws_connect(url, &gateway);
+    if (result != DISCORD_OK) {
+        return result;
+    }
+
+    discord_voice_config_t owned = *config;
+    owned.gateway = gateway;
+    owned.send = NULL;
+    discord_voice_t* v = NULL;
+    result = discord_voice_create(&owned, &v);
+    if (result != DISCORD_OK) {
+        discord_ws_close(gateway);
+        return result;
+    }
+    v->owns_gateway = 1;
+
+    uint64_t deadline = discord_time_now_ms() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+    while (v->state != DISCORD_VOICE_READY) {
+        uint64_t now = discord_time_now_ms();
+        if (v->state == DISCORD_VOICE_FAILED || now >= deadline) {
+            result = v->state == DISCORD_VOICE_FAILED ? DISCORD_ERROR_NETWORK : DISCORD_ERROR_TIMEOUT;
+            break;
+        }
+
+        discord_ws_message_t message;
+        result = discord_ws_receive(gateway, &message, (int)(deadline - now));
+        if (result == DISCORD_ERROR_TIMEOUT) {
+            continue;
+        }
+        if (result != DISCORD_OK) {
+            break;
+        }
+        result = discord_voice_handle(v, message.data, message.length);
+        discord_ws_free_message(&message);
+        if (result != DISCORD_OK) {
+            break;
+        }
+    }
+
+    if (v->state != DISCORD_VOICE_READY) {
+        discord_voice_destroy(v);
+        return result != DISCORD_OK ? result : DISCORD_ERROR_TIMEOUT;
+    }
+
+    *voice = v;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_voice_enqueue(discord_voice_t* voice, const void* opus, size_t length) {
+    if (!voice || !opus || length == 0 || length > DISCORD_VOICE_FRAME_MAX) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t head = __atomic_load_n(&voice->head, __ATOMIC_ACQUIRE);
+    if (voice->tail - head > voice->frame_mask) {
+        __atomic_add_fetch(&voice->stats.dropped, 1, __ATOMIC_RELAXED);
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    voice_frame_t* frame = &voice->frames[voice->tail & voice->frame_mask];
+    frame->length = (uint16_t)length;
+    memcpy(frame->data, opus, length);
+    __atomic_store_n(&voice->tail, voice->tail + 1, __ATOMIC_RELEASE);
+    return DISCORD_OK;
+}
+
+uint32_t discord_voice_queued(discord_voice_t* voice) {
+    if (!voice) {
+        return 0;
+    }
+    return __atomic_load_n(&voice->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&voice->head, __ATOMIC_ACQUIRE);
+}
+
+discord_result_t discord_voice_get_stats(discord_voice_t* voice, discord_voice_stats_t* stats) {
+    if (!voice || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&voice->sender->lock);
+    *stats = voice->stats;
+    pthread_mutex_unlock(&voice->sender->lock);
+    stats->state = (discord_voice_state_t)__atomic_load_n(&voice->state, __ATOMIC_ACQUIRE);
+    stats->ssrc = voice->ssrc;
+    return DISCORD_OK;
+}
+
+void discord_voice_destroy(discord_voice_t* voice) {
+    if (!voice) {
+        return;
+    }
+
+    discord_voice_sender_t* sender = voice->sender;
+    pthread_mutex_lock(&sender->lock);
+    for (uint32_t i = 0; i < sender->stream_count; i++) {
+        if (sender->streams[i] == voice) {
+            sender->streams[i] = sender->streams[--sender->stream_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sender->lock);
+
+    if (voice->owns_gateway) {
+        discord_ws_close(voice->gateway);
+    }
+    EVP_CIPHER_CTX_free(voice->cipher);
+    discord_mem_free(voice->frames);
+    discord_mem_free(voice);
+}
+
+// RTP header (AAD) | AES-256-GCM(opus) | tag | 32-bit nonce; the IV is the
+// nonce followed by eight zero bytes
+static size_t build_packet(discord_voice_t* voice, const unsigned char* opus, size_t length,
+                           unsigned char* packet) {
+    packet[0] = 0x80;
+    packet[1] = 0x78;
+    put16(packet + 2, voice->rtp_sequence);
+    put32(packet + 4, voice->rtp_timestamp);
+    put32(packet + 8, voice->ssrc);
+
+    unsigned char iv[12] = {0};
+    put32(iv, voice->nonce);
+
+    unsigned char* body = packet + VOICE_RTP_HEADER;
+    int out = 0;
+    int final = 0;
+    if (EVP_EncryptInit_ex(voice->cipher, NULL, NULL, NULL, iv) != 1 ||
+        EVP_EncryptUpdate(voice->cipher, NULL, &out, packet, VOICE_RTP_HEADER) != 1 ||
+        EVP_EncryptUpdate(voice->cipher, body, &out, opus, (int)length) != 1 ||
+        EVP_EncryptFinal_ex(voice->cipher, body + out, &final) != 1 ||
+        EVP_CIPHER_CTX_ctrl(voice->cipher, EVP_CTRL_GCM_GET_TAG, VOICE_TAG_SIZE, body + length) != 1) {
+        return 0;
+    }
+    memcpy(body + length + VOICE_TAG_SIZE, iv, VOICE_NONCE_SIZE);
+
+    voice->rtp_sequence++;
+    voice->rtp_timestamp += DISCORD_VOICE_FRAME_SAMPLES;
+    voice->nonce++;
+    return VOICE_RTP_HEADER + length + VOICE_TAG_SIZE + VOICE_NONCE_SIZE;
+}
+
+// Send count prepared packets (caller holds the lock)
+static uint32_t flush_packets(discord_voice_sender_t* sender, uint32_t count) {
+    uint32_t sent = 0;
+#ifdef __linux__
+    while (sent < count) {
+        int n = sendmmsg(sender->fd, sender->msgs + sent, count - sent, 0);
+        sender->stats.syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        sent += (uint32_t)n;
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        sender->stats.syscalls++;
+        if (sendmsg(sender->fd, &sender->msgs[i], 0) >= 0) {
+            sent++;
+        }
+    }
+#endif
+
+    for (uint32_t i = 0; i < sent; i++) {
+        sender->stats.bytes += sender->iov[i].iov_len;
+    }
+    sender->stats.packets += sent;
+    sender->stats.send_errors += count - sent;
+    return sent;
+}
+
+uint32_t discord_voice_sender_tick(discord_voice_sender_t* sender) {
+    if (!sender) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    uint32_t sent = 0;
+    pthread_mutex_lock(&sender->lock);
+
+    for (uint32_t i = 0; i < sender->stream_count; i++) {
+        discord_voice_t* v = sender->streams[i];
+        if (__atomic_load_n(&v->state, __ATOMIC_ACQUIRE) != DISCORD_VOICE_READY) {
+            continue;
+        }
+
+        const unsigned char* opus = NULL;
+        size_t length = 0;
+        int queued = v->head != __atomic_load_n(&v->tail, __ATOMIC_ACQUIRE);
+        if (queued) {
+            voice_frame_t* frame = &v->frames[v->head & v->frame_mask];
+            opus = frame->data;
+            length = frame->length;
+            v->speaking = 1;
+            v->silence_left = 0;
+        } else if (v->speaking) {
+            // Ran dry: a few silence frames stop interpolation on the client
+            v->speaking = 0;
+            v->silence_left = DISCORD_VOICE_SILENCE_FRAMES;
+            v->stats.underruns++;
+        }
+
+        if (!queued) {
+            if (v->silence_left == 0) {
+                continue;
+            }
+            v->silence_left--;
+            opus = opus_silence;
+            length = sizeof(opus_silence);
+        }
+
+        size_t size = build_packet(v, opus, length, sender->packets[count]);
+        if (queued) {
+            __atomic_store_n(&v->head, v->head + 1, __ATOMIC_RELEASE);
+        }
+        if (size == 0) {
+            sender->stats.send_errors++;
+            continue;
+        }
+
+        if (queued) {
+            v->stats.frames_sent++;
+        } else {
+            v->stats.silence_sent++;
+        }
+        v->stats.bytes_sent += size;
+
+        sender->iov[count].iov_base = sender->packets[count];
+        sender->iov[count].iov_len = size;
+#ifdef __linux__
+        struct msghdr* header = &sender->msgs[count].msg_hdr;
+#else
+        struct msghdr* header = &sender->msgs[count];
+#endif
+        memset(header, 0, sizeof(*header));
+        header->msg_name = &v->remote;
+        header->msg_namelen = sizeof(v->remote);
+        header->msg_iov = &sender->iov[count];
+        header->msg_iovlen = 1;
+
+        if (++count == DISCORD_VOICE_BATCH) {
+            sent += flush_packets(sender, count);
+            count = 0;
+        }
+    }
+
+    if (count > 0) {
+        sent += flush_packets(sender, count);
+    }
+    sender->stats.ticks++;
+
+    pthread_mutex_unlock(&sender->lock);
+    return sent;
+}
+
+// Sleep to just short of the deadline, then spin: scheduler wakeups are
+// late by tens of microseconds to milliseconds, the spin is not
+static void sleep_until(uint64_t deadline_ns) {
+    uint64_t now = discord_time_now_ns();
+    if (deadline_ns > now + VOICE_SPIN_NS) {
+#ifdef __linux__
+        uint64_t wake = deadline_ns - VOICE_SPIN_NS;
+        struct timespec ts = { (time_t)(wake / 1000000000ull), (long)(wake % 1000000000ull) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+#else
+        uint64_t wait = deadline_ns - VOICE_SPIN_NS - now;
+        struct timespec ts = { (time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull) };
+        nanosleep(&ts, NULL);
+#endif
+    }
+    while (discord_time_now_ns() < deadline_ns) {
+    }
+}
+
+static void* sender_thread(void* arg) {
+    discord_voice_sender_t* sender = (discord_voice_sender_t*)arg;
+    uint64_t deadline = discord_time_now_ns() + VOICE_FRAME_NS;
+
+    while (__atomic_load_n(&sender->running, __ATOMIC_ACQUIRE)) {
+        sleep_until(deadline);
+        uint64_t late = discord_time_now_ns() - deadline;
+
+        discord_voice_sender_tick(sender);
+
+        pthread_mutex_lock(&sender->lock);
+        if (late > VOICE_LATE_NS) {
+            sender->stats.late_ticks++;
+        }
+        if (late > sender->stats.max_late_ns) {
+            sender->stats.max_late_ns = late;
+        }
+        deadline += VOICE_FRAME_NS;
+        if (late > VOICE_RESYNC_TICKS * VOICE_FRAME_NS) {
+            uint64_t skipped = late / VOICE_FRAME_NS;
+            sender->stats.skipped_ticks += skipped;
+            deadline += skipped * VOICE_FRAME_NS;
+        }
+        pthread_mutex_unlock(&sender->lock);
+    }
+    return NULL;
+}
+
+discord_result_t discord_voice_sender_create(discord_voice_sender_t** sender) {
+    if (!sender) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    discord_voice_sender_t* s = discord_mem_calloc(DISCORD_MEM_SEND, 1, sizeof(*s));
+    if (!s) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s->fd < 0) {
+        discord_mem_free(s);
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    // Bind now so every stream and IP discovery share one source port
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    if (bind(s->fd, (struct sockaddr*)&local, sizeof(local)) != 0) {
+        close(s->fd);
+        discord_mem_free(s);
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_mutex_init(&s->discovery_lock, NULL);
+    *sender = s;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_voice_sender_start(discord_voice_sender_t* sender) {
+    if (!sender || sender->running) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    sender->running = 1;
+    if (pthread_create(&sender->thread, NULL, sender_thread, sender) != 0) {
+        sender->running = 0;
+        return DISCORD_ERROR_MEMORY;
+    }
+    return DISCORD_OK;
+}
+
+void discord_voice_sender_stop(discord_voice_sender_t* sender) {
+    if (!sender || !sender->running) {
+        return;
+    }
+
+    __atomic_store_n(&sender->running, 0, __ATOMIC_RELEASE);
+    pthread_join(sender->thread, NULL);
+}
+
+discord_result_t discord_voice_sender_get_stats(discord_voice_sender_t* sender,
+                                                discord_voice_sender_stats_t* stats) {
+    if (!sender || !stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&sender->lock);
+    *stats = sender->stats;
+    stats->streams = sender->stream_count;
+    pthread_mutex_unlock(&sender->lock);
+    return DISCORD_OK;
+}
+
+void discord_voice_sender_destroy(discord_voice_sender_t* sender) {
+    if (!sender) {
+        return;
+    }
+
+    discord_voice_sender_stop(sender);
+    close(sender->fd);
+    pthread_mutex_destroy(&sender->lock);
+    pthread_mutex_destroy(&sender->discovery_lock);
+    discord_mem_free(sender);
+}
+
+#else // _WIN32
+
+discord_result_t discord_voice_sender_create(discord_voice_sender_t** sender) {
+    (void)sender;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_voice_sender_destroy(discord_voice_sender_t* sender) {
+    (void)sender;
+}
+
+discord_result_t discord_voice_sender_start(discord_voice_sender_t* sender) {
+    (void)sender;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_voice_sender_stop(discord_voice_sender_t* sender) {
+    (void)sender;
+}
+
+uint32_t discord_voice_sender_tick(discord_voice_sender_t* sender) {
+    (void)sender;
+    return 0;
+}
+
+discord_result_t discord_voice_sender_get_stats(discord_voice_sender_t* sender,
+                                                discord_voice_sender_stats_t* stats) {
+    (void)sender; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_voice_create(const discord_voice_config_t* config, discord_voice_t** voice) {
+    (void)config; (void)voice;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_voice_connect(const char* endpoint, const discord_voice_config_t* config,
+                                       int timeout_ms, discord_voice_t** voice) {
+    (void)endpoint; (void)config; (void)timeout_ms; (void)voice;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_voice_handle(discord_voice_t* voice, const char* data, size_t length) {
+    (void)voice; (void)data; (void)length;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_voice_poll(discord_voice_t* voice, uint64_t now_ms) {
+    (void)voice; (void)now_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_voice_enqueue(discord_voice_t* voice, const void* opus, size_t length) {
+    (void)voice; (void)opus; (void)length;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+uint32_t discord_voice_queued(discord_voice_t* voice) {
+    (void)voice;
+    return 0;
+}
+
+discord_result_t discord_voice_get_stats(discord_voice_t* voice, discord_voice_stats_t* stats) {
+    (void)voice; (void)stats;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_voice_destroy(discord_voice_t* voice) {
+    (void)voice;
+}
+
+#endif
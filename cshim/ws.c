@@ -1,33 +1,145 @@
 #include "abi.h"
 #include "structs.h"
 #include "internal.h"
+#include "trace.h"
 #include <libwebsockets.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-#define WS_RECEIVE_BUFFER_SIZE 65536
+#if defined(LWS_WITH_TLS) && !defined(LWS_WITH_MBEDTLS)
+    #include <openssl/ssl.h>
+    #define WS_HAVE_OPENSSL 1
+#endif
+
+#define WS_RX_CHUNK_SIZE 16384          // lws per-connection rx buffer
+#define WS_RECEIVE_BUFFER_INITIAL 4096  // Reassembly buffer; grows for a fragmented frame
+#define WS_RECEIVE_BUFFER_KEEP 65536    // Larger buffers shrink back once their frame is queued
+#define WS_FRAME_QUEUE_INITIAL 16
+#define WS_TLS_SESSION_TIMEOUT_S 3600
+#define WS_TLS_SESSION_CACHE_MAX 256
+#define WS_DNS_WAIT_MS 5000             // Then lws resolves the name itself
+
+// Process-wide state: every gateway connection lives on one lws_context,
+// so they share a single SSL_CTX, certificate store and TLS session cache.
+// The context is created by the first connect and kept after the last
+// close so a reconnect can take the abbreviated handshake; it is released
+// by discord_ws_shutdown(). lws is not thread-safe per context, so every
+// lws call (service, write, connect, close) happens under
+// ws_shared.service_lock. Callbacks only run inside those calls and take
+// ws_shared.lock, which guards the frame queues and counters, to queue
+// completed frames on the connection they belong to. Receivers check their
+// queue under ws_shared.lock alone and only hold service_lock for one
+// service slice at a time. Lock order: service_lock, then lock.
+static struct {
+    discord_lock_t service_lock;
+    discord_lock_t lock;
+    struct lws_context* context;
+    struct discord_ws_context* connections;
+    uint32_t connection_count;
+    uint32_t contexts_created;
+    uint64_t tls_handshakes;
+    uint64_t tls_resumed;
+    uint64_t frames_received;
+    uint64_t bytes_copied;
+} ws_shared = { DISCORD_LOCK_INIT, DISCORD_LOCK_INIT, NULL, NULL, 0, 0, 0, 0, 0, 0 };
+
+static void ws_free_frames(struct discord_ws_context* ws_ctx) {
+    for (size_t i = 0; i < ws_ctx->frame_count; i++) {
+        size_t slot = (ws_ctx->frame_head + i) & (ws_ctx->frame_capacity - 1);
+        discord_mem_free(ws_ctx->frames[slot].data);
+    }
+    discord_mem_free(ws_ctx->frames);
+    ws_ctx->frames = NULL;
+    ws_ctx->frame_count = 0;
+    ws_ctx->queued_bytes = 0;
+}
+
+// Copy a complete frame into its own allocation and append it to the queue
+static discord_result_t ws_queue_frame(struct lws* wsi, struct discord_ws_context* ws_ctx,
+                                       const char* data, size_t len) {
+    if (ws_ctx->frame_count == ws_ctx->frame_capacity) {
+        size_t new_capacity = ws_ctx->frame_capacity ? ws_ctx->frame_capacity * 2 : WS_FRAME_QUEUE_INITIAL;
+        discord_ws_frame_t* frames = discord_mem_alloc(DISCORD_MEM_RECEIVE, new_capacity * sizeof(discord_ws_frame_t));
+        if (!frames) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        for (size_t i = 0; i < ws_ctx->frame_count; i++) {
+            frames[i] = ws_ctx->frames[(ws_ctx->frame_head + i) & (ws_ctx->frame_capacity - 1)];
+        }
+        discord_mem_free(ws_ctx->frames);
+        ws_ctx->frames = frames;
+        ws_ctx->frame_capacity = new_capacity;
+        ws_ctx->frame_head = 0;
+    }
+
+    char* copy = discord_mem_alloc(DISCORD_MEM_RECEIVE, len + 1);
+    if (!copy) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    DISCORD_TRACE_BEGIN(trace_copy);
+    memcpy(copy, data, len);
+    DISCORD_TRACE_END(trace_copy, DISCORD_TRACE_WS_COPY, len);
+    copy[len] = '\0';
+    ws_shared.frames_received++;
+    ws_shared.bytes_copied += len;
+
+    size_t slot = (ws_ctx->frame_head + ws_ctx->frame_count) & (ws_ctx->frame_capacity - 1);
+    ws_ctx->frames[slot].data = copy;
+    ws_ctx->frames[slot].length = len;
+    ws_ctx->frames[slot].is_binary = lws_frame_is_binary(wsi);
+    ws_ctx->frame_count++;
+    ws_ctx->queued_bytes += len;
+
+    if (ws_ctx->recorder) {
+        discord_record_frame(ws_ctx->recorder, copy, len, ws_ctx->frames[slot].is_binary);
+    }
+
+    return DISCORD_OK;
+}
+
+// Callback body; runs with both locks held
+static int ws_callback_locked(struct lws* wsi, enum lws_callback_reasons reason,
+                              struct discord_ws_context* ws_ctx, void* in, size_t len) {
 
-// WebSocket callback function
-int discord_ws_callback(struct lws* wsi, enum lws_callback_reasons reason,
-                       void* user, void* in, size_t len) {
-    struct discord_ws_context* ws_ctx = (struct discord_ws_context*)user;
-    
     switch (reason) {
         case LWS_CALLBACK_CLIENT_ESTABLISHED:
             if (ws_ctx && ws_ctx->gateway) {
                 ws_ctx->gateway->state = DISCORD_STATE_CONNECTED;
+                ws_ctx->gateway->timing.upgrade_ns = discord_time_now_ns() - ws_ctx->connect_started_ns;
+            }
+            ws_shared.tls_handshakes++;
+#ifdef WS_HAVE_OPENSSL
+            {
+                SSL* ssl = lws_get_ssl(wsi);
+                if (ssl && SSL_session_reused(ssl)) {
+                    ws_shared.tls_resumed++;
+                    if (ws_ctx && ws_ctx->gateway) {
+                        ws_ctx->gateway->timing.tls_resumed = 1;
+                    }
+                }
             }
+#endif
             lws_callback_on_writable(wsi);
             break;
-            
+
         case LWS_CALLBACK_CLIENT_RECEIVE:
             if (ws_ctx && in && len > 0) {
+                // Unfragmented frame: copy straight into its queue entry
+                if (ws_ctx->receive_buffer_pos == 0 && lws_is_final_fragment(wsi)) {
+                    if (ws_queue_frame(wsi, ws_ctx, in, len) != DISCORD_OK) {
+                        ws_ctx->connection_error = DISCORD_ERROR_MEMORY;
+                        return -1;
+                    }
+                    break;
+                }
+
                 // Ensure we have enough buffer space
-                size_t required = ws_ctx->receive_buffer_pos + len + 1;
+                size_t required = ws_ctx->receive_buffer_pos + len;
                 if (required > ws_ctx->receive_buffer_size) {
                     size_t new_size = required * 2;
-                    char* new_buffer = realloc(ws_ctx->receive_buffer, new_size);
+                    char* new_buffer = discord_mem_realloc(DISCORD_MEM_RECEIVE, ws_ctx->receive_buffer, new_size);
                     if (!new_buffer) {
                         ws_ctx->connection_error = DISCORD_ERROR_MEMORY;
                         return -1;
@@ -35,294 +147,580 @@ int discord_ws_callback(struct lws* wsi, enum lws_callback_reasons reason,
                     ws_ctx->receive_buffer = new_buffer;
                     ws_ctx->receive_buffer_size = new_size;
                 }
-                
+
                 // Copy received data
+                DISCORD_TRACE_BEGIN(trace_copy);
                 memcpy(ws_ctx->receive_buffer + ws_ctx->receive_buffer_pos, in, len);
+                DISCORD_TRACE_END(trace_copy, DISCORD_TRACE_WS_COPY, len);
                 ws_ctx->receive_buffer_pos += len;
-                
+                ws_shared.bytes_copied += len;
+
                 // Check if this is the final fragment
                 if (lws_is_final_fragment(wsi)) {
-                    ws_ctx->receive_buffer[ws_ctx->receive_buffer_pos] = '\0';
-                    // Buffer is ready for consumption
+                    discord_result_t queued = ws_queue_frame(wsi, ws_ctx, ws_ctx->receive_buffer,
+                                                             ws_ctx->receive_buffer_pos);
+                    ws_ctx->receive_buffer_pos = 0;
+                    if (queued != DISCORD_OK) {
+                        ws_ctx->connection_error = queued;
+                        return -1;
+                    }
+
+                    // One huge frame (GUILD_CREATE for a large guild) should
+                    // not pin its buffer for the life of the connection
+                    if (ws_ctx->receive_buffer_size > WS_RECEIVE_BUFFER_KEEP) {
+                        char* shrunk = discord_mem_realloc(DISCORD_MEM_RECEIVE, ws_ctx->receive_buffer,
+                                                           WS_RECEIVE_BUFFER_INITIAL);
+                        if (shrunk) {
+                            ws_ctx->receive_buffer = shrunk;
+                            ws_ctx->receive_buffer_size = WS_RECEIVE_BUFFER_INITIAL;
+                        }
+                    }
                 }
             }
             break;
-            
+
         case LWS_CALLBACK_CLIENT_WRITEABLE:
-            // Ready to send data (handled by send function)
+            // Sends are written directly; this only carries a requested close
+            if (ws_ctx && ws_ctx->close_requested) {
+                lws_close_reason(wsi, LWS_CLOSE_STATUS_NORMAL, NULL, 0);
+                return -1;
+            }
             break;
-            
+
         case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
             if (ws_ctx) {
                 ws_ctx->connection_error = DISCORD_ERROR_NETWORK;
+                ws_ctx->wsi = NULL;
                 if (ws_ctx->gateway) {
                     ws_ctx->gateway->state = DISCORD_STATE_ERROR;
                 }
             }
             break;
-            
+
         case LWS_CALLBACK_CLOSED:
-            if (ws_ctx && ws_ctx->gateway) {
-                ws_ctx->gateway->state = DISCORD_STATE_DISCONNECTED;
+        case LWS_CALLBACK_CLIENT_CLOSED:
+            if (ws_ctx) {
+                ws_ctx->wsi = NULL;
+                if (!ws_ctx->close_requested) {
+                    ws_ctx->connection_error = DISCORD_ERROR_NETWORK;
+                }
+                if (ws_ctx->gateway) {
+                    ws_ctx->gateway->state = DISCORD_STATE_DISCONNECTED;
+                }
             }
             break;
-            
+
         default:
             break;
     }
-    
+
     return 0;
 }
 
+// WebSocket callback function
+int discord_ws_callback(struct lws* wsi, enum lws_callback_reasons reason,
+                       void* user, void* in, size_t len) {
+    discord_lock(&ws_shared.lock);
+    int result = ws_callback_locked(wsi, reason, (struct discord_ws_context*)user, in, len);
+    discord_unlock(&ws_shared.lock);
+    return result;
+}
+
 // Protocol definition
 static struct lws_protocols protocols[] = {
     {
         "discord-gateway",
         discord_ws_callback,
-        sizeof(struct discord_ws_context),
-        WS_RECEIVE_BUFFER_SIZE,
+        0,                          // Per-connection data is our own ws_ctx (userdata)
+        WS_RX_CHUNK_SIZE,
         0, NULL, 0
     },
     { NULL, NULL, 0, 0, 0, NULL, 0 } // terminator
 };
 
+// Create the shared context on first use (caller holds ws_shared.service_lock)
+static discord_result_t ws_shared_context(void) {
+    if (ws_shared.context) {
+        return DISCORD_OK;
+    }
+
+    struct lws_context_creation_info ctx_info = {0};
+    ctx_info.port = CONTEXT_PORT_NO_LISTEN;
+    ctx_info.protocols = protocols;
+    ctx_info.gid = -1;
+    ctx_info.uid = -1;
+    ctx_info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+#if defined(LWS_WITH_TLS_SESSIONS)
+    // Client sessions and tickets are cached per host:port on the vhost
+    ctx_info.tls_session_timeout = WS_TLS_SESSION_TIMEOUT_S;
+    ctx_info.tls_session_cache_max = WS_TLS_SESSION_CACHE_MAX;
+#endif
+
+    ws_shared.context = lws_create_context(&ctx_info);
+    if (!ws_shared.context) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    ws_shared.contexts_created++;
+    return DISCORD_OK;
+}
+
+// Wake a thread blocked in lws_service and take the service lock; the
+// servicing thread drops it as soon as lws_service returns
+static void ws_lock_for_write(void) {
+    if (!discord_try_lock(&ws_shared.service_lock)) {
+        struct lws_context* context = ws_shared.context;
+        if (context) {
+            lws_cancel_service(context);
+        }
+        discord_lock(&ws_shared.service_lock);
+    }
+}
+
+// Transport for DISCORD_WS_TRANSPORT_DEFAULT: the environment lets the
+// assembly core (which calls discord_ws_connect) run on io_uring or the
+// simulated gateway
+discord_ws_transport_t discord_ws_select_transport(const discord_ws_options_t* options) {
+    if (options && options->transport != DISCORD_WS_TRANSPORT_DEFAULT) {
+        return options->transport;
+    }
+    const char* name = getenv("DISCORD_WS_TRANSPORT");
+    if (name && strcmp(name, "uring") == 0) {
+        return DISCORD_WS_TRANSPORT_URING;
+    }
+    if (name && strcmp(name, "sim") == 0) {
+        return DISCORD_WS_TRANSPORT_SIM;
+    }
+    return DISCORD_WS_TRANSPORT_LWS;
+}
+
+// Transports that bypass the shared lws context
+static discord_result_t ws_connect_direct(const char* url, const discord_ws_options_t* options,
+                                          discord_ws_transport_t transport, discord_gateway_t** gateway) {
+    discord_gateway_t* gw = discord_mem_alloc(DISCORD_MEM_OTHER, sizeof(discord_gateway_t));
+    if (!gw) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    memset(gw, 0, sizeof(discord_gateway_t));
+    gw->state = DISCORD_STATE_CONNECTING;
+
+    discord_result_t result = transport == DISCORD_WS_TRANSPORT_SIM ?
+                              discord_sim_conn_open(url, gw) :
+                              discord_uring_connect(url, options, gw);
+    if (result != DISCORD_OK) {
+        discord_mem_free(gw);
+        return result;
+    }
+
+    *gateway = gw;
+    return DISCORD_OK;
+}
+
 discord_result_t discord_ws_connect(const char* url, discord_gateway_t** gateway) {
+    return discord_ws_connect_ex(url, NULL, gateway);
+}
+
+discord_result_t discord_ws_connect_ex(const char* url, const discord_ws_options_t* options,
+                                       discord_gateway_t** gateway) {
     if (!url || !gateway) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
-    
-    // Parse URL
-    struct lws_client_connect_info info = {0};
-    char* url_copy = strdup(url);
-    if (!url_copy) {
-        return DISCORD_ERROR_MEMORY;
+
+    discord_ws_transport_t transport = discord_ws_select_transport(options);
+    if (transport == DISCORD_WS_TRANSPORT_URING || transport == DISCORD_WS_TRANSPORT_SIM) {
+        return ws_connect_direct(url, options, transport, gateway);
     }
-    
-    // Simple URL parsing (assumes wss://gateway.discord.gg/?v=10&encoding=json format)
-    char* host_start = strstr(url_copy, "://");
-    if (!host_start) {
-        free(url_copy);
+
+    discord_url_t parsed;
+    if (discord_url_parse(url, &parsed) != DISCORD_OK) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
-    host_start += 3;
-    
-    char* path_start = strchr(host_start, '/');
-    char* port_start = strchr(host_start, ':');
-    
-    if (path_start) {
-        *path_start = '\0';
-        info.path = path_start + 1;
-    } else {
-        info.path = "/";
-    }
-    
-    if (port_start && (!path_start || port_start < path_start)) {
-        *port_start = '\0';
-        info.port = atoi(port_start + 1);
-    } else {
-        info.port = 443; // Default WSS port
-    }
-    
-    info.address = host_start;
-    
+
+    // lws would resolve the host with a blocking getaddrinfo of its own;
+    // hand it an address from the cache instead
+    struct lws_client_connect_info info = {0};
+    char address[64];
+    int cached = 0;
+    uint64_t started = discord_time_now_ns();
+    int resolved = discord_dns_resolve_numeric(parsed.host, WS_DNS_WAIT_MS, address, sizeof(address),
+                                               &cached) == DISCORD_OK;
+    uint64_t dns_ns = cached ? 0 : discord_time_now_ns() - started;
+    info.address = resolved ? address : parsed.host;
+    info.port = parsed.port;
+    info.path = parsed.path;
+
     // Create gateway structure
-    discord_gateway_t* gw = malloc(sizeof(discord_gateway_t));
+    discord_gateway_t* gw = discord_mem_alloc(DISCORD_MEM_OTHER, sizeof(discord_gateway_t));
     if (!gw) {
-        free(url_copy);
         return DISCORD_ERROR_MEMORY;
     }
-    
+
     memset(gw, 0, sizeof(discord_gateway_t));
     gw->state = DISCORD_STATE_CONNECTING;
-    
+    gw->timing.dns_ns = dns_ns;
+    gw->timing.dns_cached = cached;
+
     // Create WebSocket context structure
-    struct discord_ws_context* ws_ctx = malloc(sizeof(struct discord_ws_context));
+    struct discord_ws_context* ws_ctx = discord_mem_alloc(DISCORD_MEM_OTHER, sizeof(struct discord_ws_context));
     if (!ws_ctx) {
-        free(gw);
-        free(url_copy);
+        discord_mem_free(gw);
         return DISCORD_ERROR_MEMORY;
     }
-    
+
     memset(ws_ctx, 0, sizeof(struct discord_ws_context));
     ws_ctx->gateway = gw;
-    ws_ctx->receive_buffer_size = WS_RECEIVE_BUFFER_SIZE;
-    ws_ctx->receive_buffer = malloc(ws_ctx->receive_buffer_size);
-    
+    ws_ctx->receive_buffer_size = WS_RECEIVE_BUFFER_INITIAL;
+    ws_ctx->receive_buffer = discord_mem_alloc(DISCORD_MEM_RECEIVE, ws_ctx->receive_buffer_size);
+
     if (!ws_ctx->receive_buffer) {
-        free(ws_ctx);
-        free(gw);
-        free(url_copy);
+        discord_mem_free(ws_ctx);
+        discord_mem_free(gw);
         return DISCORD_ERROR_MEMORY;
     }
-    
+
     gw->ws_ctx = ws_ctx;
-    
-    // Create libwebsockets context
-    struct lws_context_creation_info ctx_info = {0};
-    ctx_info.port = CONTEXT_PORT_NO_LISTEN;
-    ctx_info.protocols = protocols;
-    ctx_info.gid = -1;
-    ctx_info.uid = -1;
-    ctx_info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
-    
-    ws_ctx->context = lws_create_context(&ctx_info);
-    if (!ws_ctx->context) {
-        free(ws_ctx->receive_buffer);
-        free(ws_ctx);
-        free(gw);
-        free(url_copy);
-        return DISCORD_ERROR_NETWORK;
+
+    ws_lock_for_write();
+
+    discord_result_t result = ws_shared_context();
+    if (result != DISCORD_OK) {
+        discord_unlock(&ws_shared.service_lock);
+        discord_mem_free(ws_ctx->receive_buffer);
+        discord_mem_free(ws_ctx);
+        discord_mem_free(gw);
+        return result;
     }
-    
+
     // Set up connection info
-    info.context = ws_ctx->context;
-    info.ssl_connection = LCCSCF_USE_SSL | LCCSCF_ALLOW_SELFSIGNED | 
-                          LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK;
-    info.host = info.address;
-    info.origin = info.address;
+    info.context = ws_shared.context;
+    info.ssl_connection = parsed.secure ? LCCSCF_USE_SSL | LCCSCF_ALLOW_SELFSIGNED |
+                                          LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK : 0;
+    info.host = parsed.host;        // Host header and SNI
+    info.origin = parsed.host;
     info.protocol = protocols[0].name;
     info.userdata = ws_ctx;
-    
+
     // Connect
+    ws_ctx->connect_started_ns = discord_time_now_ns();
     ws_ctx->wsi = lws_client_connect_via_info(&info);
     if (!ws_ctx->wsi) {
-        lws_context_destroy(ws_ctx->context);
-        free(ws_ctx->receive_buffer);
-        free(ws_ctx);
-        free(gw);
-        free(url_copy);
+        discord_unlock(&ws_shared.service_lock);
+        ws_free_frames(ws_ctx);
+        discord_mem_free(ws_ctx->receive_buffer);
+        discord_mem_free(ws_ctx);
+        discord_mem_free(gw);
         return DISCORD_ERROR_NETWORK;
     }
-    
-    free(url_copy);
+
+    // Track the connection on the shared context
+    discord_lock(&ws_shared.lock);
+    ws_ctx->next = ws_shared.connections;
+    if (ws_shared.connections) {
+        ws_shared.connections->prev = ws_ctx;
+    }
+    ws_shared.connections = ws_ctx;
+    ws_shared.connection_count++;
+    discord_unlock(&ws_shared.lock);
+
+    discord_unlock(&ws_shared.service_lock);
+
     *gateway = gw;
     return DISCORD_OK;
 }
 
 discord_result_t discord_ws_send(discord_gateway_t* gateway, const char* data, size_t length) {
-    if (!gateway || !gateway->ws_ctx || !data || length == 0) {
+    if (!gateway || !data || length == 0) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
-    
-    struct discord_ws_context* ws_ctx = gateway->ws_ctx;
-    if (!ws_ctx->wsi) {
-        return DISCORD_ERROR_NETWORK;
+    if (gateway->uring) {
+        return discord_uring_send(gateway->uring, data, length);
+    }
+    if (gateway->sim) {
+        return discord_sim_conn_send(gateway->sim, data, length);
+    }
+    if (!gateway->ws_ctx) {
+        return DISCORD_ERROR_INVALID_PARAM;
     }
-    
+
+    struct discord_ws_context* ws_ctx = gateway->ws_ctx;
+
     // Prepare buffer with LWS pre/post padding
     size_t padded_len = length + LWS_PRE;
-    unsigned char* buf = malloc(padded_len);
+    unsigned char* buf = discord_mem_alloc(DISCORD_MEM_SEND, padded_len);
     if (!buf) {
         return DISCORD_ERROR_MEMORY;
     }
-    
+
+    DISCORD_TRACE_BEGIN(trace_send);
     memcpy(buf + LWS_PRE, data, length);
-    
-    int result = lws_write(ws_ctx->wsi, buf + LWS_PRE, length, LWS_WRITE_TEXT);
-    free(buf);
-    
+
+    int result = -1;
+    ws_lock_for_write();
+    if (ws_ctx->wsi) {
+        result = lws_write(ws_ctx->wsi, buf + LWS_PRE, length, LWS_WRITE_TEXT);
+    }
+    discord_lock(&ws_shared.lock);
+    ws_shared.bytes_copied += length;
+    discord_unlock(&ws_shared.lock);
+    discord_unlock(&ws_shared.service_lock);
+    discord_mem_free(buf);
+    DISCORD_TRACE_END(trace_send, DISCORD_TRACE_WS_SEND, length);
+
     if (result < 0) {
         return DISCORD_ERROR_NETWORK;
     }
-    
+
     return DISCORD_OK;
 }
 
 discord_result_t discord_ws_receive(discord_gateway_t* gateway, discord_ws_message_t* message, int timeout_ms) {
-    if (!gateway || !gateway->ws_ctx || !message) {
+    if (!gateway || !message) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
-    
-    struct discord_ws_context* ws_ctx = gateway->ws_ctx;
-    if (!ws_ctx->context) {
-        return DISCORD_ERROR_NETWORK;
+
+    // Dump the trace here if a signal asked for one
+    discord_trace_poll();
+
+    if (gateway->uring) {
+        return discord_uring_receive(gateway->uring, message, timeout_ms);
+    }
+    if (gateway->sim) {
+        return discord_sim_conn_receive(gateway->sim, message, timeout_ms);
     }
-    
-    // Clear previous message data
-    ws_ctx->receive_buffer_pos = 0;
-    
-    // Service the websocket with timeout
-    int n = 0;
-    int timeout_remaining = timeout_ms;
+    if (!gateway->ws_ctx) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    struct discord_ws_context* ws_ctx = gateway->ws_ctx;
+
+    // Service the shared context in slices; frames for other connections
+    // are queued on their own ws_ctx as a side effect. Only one thread
+    // services at a time, and neither lock is held across slices, so
+    // senders and other receivers get in between them. A timeout of 0
+    // still makes one non-blocking pass, so a loop that polls while it has
+    // work queued keeps reading the socket.
     const int service_timeout = 50; // Service in 50ms chunks
-    
-    while (timeout_remaining > 0) {
-        n = lws_service(ws_ctx->context, service_timeout);
-        if (n < 0) {
-            return DISCORD_ERROR_NETWORK;
-        }
-        
-        // Check if we received a complete message
-        if (ws_ctx->receive_buffer_pos > 0) {
-            message->data = malloc(ws_ctx->receive_buffer_pos + 1);
-            if (!message->data) {
-                return DISCORD_ERROR_MEMORY;
-            }
-            
-            memcpy(message->data, ws_ctx->receive_buffer, ws_ctx->receive_buffer_pos);
-            message->data[ws_ctx->receive_buffer_pos] = '\0';
-            message->length = ws_ctx->receive_buffer_pos;
-            message->is_binary = 0; // Discord Gateway uses text frames
-            
-            // Reset buffer for next message
-            ws_ctx->receive_buffer_pos = 0;
+    uint64_t deadline = discord_time_now_ns() + (timeout_ms > 0 ? (uint64_t)timeout_ms * 1000000ULL : 0);
+    int serviced = 0;
+
+    for (;;) {
+        discord_lock(&ws_shared.lock);
+
+        // Hand over the oldest completed frame without copying it
+        if (ws_ctx->frame_count > 0) {
+            discord_ws_frame_t* frame = &ws_ctx->frames[ws_ctx->frame_head];
+            message->data = frame->data;
+            message->length = frame->length;
+            message->is_binary = frame->is_binary;
+            ws_ctx->frame_head = (ws_ctx->frame_head + 1) & (ws_ctx->frame_capacity - 1);
+            ws_ctx->frame_count--;
+            ws_ctx->queued_bytes -= frame->length;
+            discord_unlock(&ws_shared.lock);
             return DISCORD_OK;
         }
-        
+
         // Check for connection errors
         if (ws_ctx->connection_error != 0) {
-            return ws_ctx->connection_error;
+            int error = ws_ctx->connection_error;
+            discord_unlock(&ws_shared.lock);
+            return error;
+        }
+
+        discord_unlock(&ws_shared.lock);
+
+        uint64_t now = discord_time_now_ns();
+        if (serviced && now >= deadline) {
+            return DISCORD_ERROR_TIMEOUT;
+        }
+        uint64_t remaining_ms = now < deadline ? (deadline - now + 999999) / 1000000 : 0;
+        int slice = remaining_ms < (uint64_t)service_timeout ? (int)remaining_ms : service_timeout;
+
+        // Waits for at most one slice of another receiver; whatever it
+        // queued for us is picked up on the next pass before servicing
+        discord_lock(&ws_shared.service_lock);
+        discord_lock(&ws_shared.lock);
+        int ready = ws_ctx->frame_count > 0 || ws_ctx->connection_error != 0;
+        discord_unlock(&ws_shared.lock);
+        if (ready) {
+            discord_unlock(&ws_shared.service_lock);
+            continue;
+        }
+        if (!ws_shared.context) {
+            discord_unlock(&ws_shared.service_lock);
+            return DISCORD_ERROR_TIMEOUT;
+        }
+
+        DISCORD_TRACE_BEGIN(trace_service);
+        int n = lws_service(ws_shared.context, slice > 0 ? slice : -1);   // Negative: don't wait
+        discord_unlock(&ws_shared.service_lock);
+        serviced = 1;
+        discord_lock(&ws_shared.lock);
+        size_t queued = ws_ctx->queued_bytes;
+        discord_unlock(&ws_shared.lock);
+        DISCORD_TRACE_END(trace_service, DISCORD_TRACE_WS_SERVICE, queued);
+        if (n < 0) {
+            return DISCORD_ERROR_NETWORK;
         }
-        
-        timeout_remaining -= service_timeout;
     }
-    
-    return DISCORD_ERROR_TIMEOUT;
 }
 
 discord_result_t discord_ws_close(discord_gateway_t* gateway) {
     if (!gateway) {
         return DISCORD_ERROR_INVALID_PARAM;
     }
-    
+
+    if (gateway->uring) {
+        discord_uring_close(gateway->uring);
+        gateway->uring = NULL;
+    }
+
+    if (gateway->sim) {
+        discord_sim_conn_close(gateway->sim);
+        gateway->sim = NULL;
+    }
+
     if (gateway->ws_ctx) {
         struct discord_ws_context* ws_ctx = gateway->ws_ctx;
-        
+
+        ws_lock_for_write();
+
         if (ws_ctx->wsi) {
-            lws_close_reason(ws_ctx->wsi, LWS_CLOSE_STATUS_NORMAL, NULL, 0);
-            // Service a few times to complete the close handshake
-            for (int i = 0; i < 10; i++) {
-                lws_service(ws_ctx->context, 10);
+            // Close from the writeable callback, then service a few times
+            // to complete the close handshake
+            ws_ctx->close_requested = 1;
+            lws_callback_on_writable(ws_ctx->wsi);
+            for (int i = 0; i < 10 && ws_ctx->wsi; i++) {
+                lws_service(ws_shared.context, 10);
+            }
+
+            // Still open: detach so late callbacks don't see freed memory
+            if (ws_ctx->wsi) {
+                lws_set_wsi_user(ws_ctx->wsi, NULL);
             }
         }
-        
-        if (ws_ctx->context) {
-            lws_context_destroy(ws_ctx->context);
+
+        discord_lock(&ws_shared.lock);
+        if (ws_ctx->prev) {
+            ws_ctx->prev->next = ws_ctx->next;
+        } else if (ws_shared.connections == ws_ctx) {
+            ws_shared.connections = ws_ctx->next;
+        }
+        if (ws_ctx->next) {
+            ws_ctx->next->prev = ws_ctx->prev;
         }
-        
+        ws_shared.connection_count--;
+        discord_unlock(&ws_shared.lock);
+
+        discord_unlock(&ws_shared.service_lock);
+
+        ws_free_frames(ws_ctx);
+
         if (ws_ctx->receive_buffer) {
-            free(ws_ctx->receive_buffer);
+            discord_mem_free(ws_ctx->receive_buffer);
         }
-        
-        free(ws_ctx);
+
+        discord_mem_free(ws_ctx);
     }
-    
+
     if (gateway->session_id) {
-        free(gateway->session_id);
+        discord_mem_free(gateway->session_id);
     }
-    
+
     if (gateway->resume_gateway_url) {
-        free(gateway->resume_gateway_url);
+        discord_mem_free(gateway->resume_gateway_url);
+    }
+
+    discord_mem_free(gateway);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_ws_get_stats(discord_ws_stats_t* stats) {
+    if (!stats) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    discord_lock(&ws_shared.lock);
+
+    stats->connections = ws_shared.connection_count;
+    stats->contexts_created = ws_shared.contexts_created;
+    stats->tls_handshakes = ws_shared.tls_handshakes;
+    stats->tls_resumed = ws_shared.tls_resumed;
+    stats->frames_received = ws_shared.frames_received;
+    stats->bytes_copied = ws_shared.bytes_copied;
+
+    // Memory owned per connection: our structures, reassembly buffer and
+    // queue, plus the rx buffer lws allocates for each wsi
+    for (struct discord_ws_context* c = ws_shared.connections; c; c = c->next) {
+        stats->connection_bytes += sizeof(discord_gateway_t) + sizeof(struct discord_ws_context) +
+                                   c->receive_buffer_size +
+                                   c->frame_capacity * sizeof(discord_ws_frame_t) +
+                                   c->queued_bytes +
+                                   WS_RX_CHUNK_SIZE + LWS_PRE;
+        stats->queued_frames += c->frame_count;
     }
-    
-    free(gateway);
+
+    discord_unlock(&ws_shared.lock);
+
+    discord_uring_add_stats(stats);
+
+    if (stats->connections > 0) {
+        stats->bytes_per_connection = stats->connection_bytes / stats->connections;
+    }
+
+    return DISCORD_OK;
+}
+
+discord_result_t discord_ws_shutdown(void) {
+    if (discord_uring_shutdown() != DISCORD_OK) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    ws_lock_for_write();
+
+    discord_lock(&ws_shared.lock);
+    uint32_t open = ws_shared.connection_count;
+    discord_unlock(&ws_shared.lock);
+    if (open > 0) {
+        discord_unlock(&ws_shared.service_lock);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    if (ws_shared.context) {
+        lws_context_destroy(ws_shared.context);
+        ws_shared.context = NULL;
+    }
+
+    discord_unlock(&ws_shared.service_lock);
+    return DISCORD_OK;
+}
+
+discord_result_t discord_ws_set_recorder(discord_gateway_t* gateway, discord_recorder_t* recorder) {
+    if (gateway && gateway->uring) {
+        discord_uring_set_recorder(gateway->uring, recorder);
+        return DISCORD_OK;
+    }
+    if (gateway && gateway->sim) {
+        discord_sim_conn_set_recorder(gateway->sim, recorder);
+        return DISCORD_OK;
+    }
+    if (!gateway || !gateway->ws_ctx) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    gateway->ws_ctx->recorder = recorder;
     return DISCORD_OK;
 }
 
 void discord_ws_free_message(discord_ws_message_t* message) {
     if (message && message->data) {
-        free(message->data);
+        // io_uring messages live in the connection's receive buffer
+        if (!discord_uring_release_message(message)) {
+            discord_mem_free(message->data);
+        }
         message->data = NULL;
         message->length = 0;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,1277 @@
+#ifdef __linux__
+    #define _GNU_SOURCE
+#endif
+
+#include "abi.h"
+#include "structs.h"
+#include "internal.h"
+#include "trace.h"
+#include <string.h>
+
+#ifdef __linux__
+
+#include "wsframe.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <linux/tls.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#ifndef SOL_TLS
+    #define SOL_TLS 282
+#endif
+
+#define URING_ENTRIES               8           // One read and one write in flight
+#define URING_RECEIVE_DEFAULT       (256 * 1024)
+#define URING_RECEIVE_MIN           4096
+#define URING_SEND_SIZE             (64 * 1024)
+#define URING_READ_MIN              4096        // Compact before reading into less
+#define URING_HANDSHAKE_TIMEOUT_S   10
+#define URING_CLOSE_TIMEOUT_MS      1000
+#define URING_HOST_MAX              256
+#define URING_RECORD_ALERT          21
+#define URING_RECORD_APPLICATION    23
+
+#define URING_OP_READ               1
+#define URING_OP_WRITE              2
+
+static const char uring_websocket_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// Minimal io_uring: the two ring mappings, SQE array and our submit count
+typedef struct {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+    unsigned to_submit;             // Pushed but not yet passed to io_uring_enter
+} uring_ring_t;
+
+typedef enum {
+    URING_MODE_RING = 0,            // Socket carries plaintext (ws:// or kTLS): io_uring
+    URING_MODE_SYNC                 // OpenSSL records in userspace: SSL_read/SSL_write + poll
+} uring_mode_t;
+
+// One connection. All fields are guarded by lock, which is never held
+// across the blocking wait (io_uring_enter or poll), so another thread
+// can queue a send while the receiver sleeps.
+struct discord_uring_conn {
+    discord_gateway_t* gateway;
+    discord_lock_t lock;
+    int fd;
+    SSL* ssl;
+    uring_mode_t mode;
+    int ktls;
+    uring_ring_t ring;
+    int error;
+    int closing;
+    int waiting;                    // Receiver is blocked; senders submit themselves
+    uint64_t mask_state;            // xorshift64 for frame masks
+
+    // Registered buffer 0: unconsumed bytes are [rstart, rend), reads go
+    // to [rend, receive_size); one spare byte after it for the NUL
+    uint8_t* receive;
+    size_t receive_size;
+    size_t rstart;
+    size_t rend;
+    size_t rneed;                   // Bytes from rstart that complete the next frame (0 = unknown)
+    int read_inflight;
+    uint8_t* held;                  // Zero-copy message handed out, NUL written at held[held_length]
+    size_t held_length;
+    uint8_t held_saved;
+
+    // Fragmented or oversized frames are copied here as they arrive
+    char* frag;
+    size_t frag_length;
+    size_t frag_capacity;
+    uint64_t frag_remaining;
+    int frag_binary;
+    int frag_fin;
+    int assembling;
+    int streaming;
+
+    // Registered buffer 1: [shead, stail) not yet written; one write in flight
+    uint8_t* send;
+    size_t send_size;
+    size_t shead;
+    size_t stail;
+    int write_inflight;
+
+    discord_recorder_t* recorder;
+    struct discord_uring_conn* prev;
+    struct discord_uring_conn* next;
+};
+
+// Process-wide state: the connection list (so discord_ws_free_message can
+// tell a ring-buffer message from an owned one), one client SSL_CTX per
+// verification mode and a single-entry TLS session cache
+static struct {
+    discord_lock_t lock;
+    struct discord_uring_conn* connections;
+    uint32_t connection_count;
+    uint32_t ktls_count;
+    SSL_CTX* ssl_ctx[2];            // [0] verifying, [1] skip_verify
+    SSL_SESSION* session;
+    char session_host[URING_HOST_MAX];
+    uint64_t tls_handshakes;
+    uint64_t tls_resumed;
+    uint64_t frames;
+    uint64_t bytes_copied;
+    uint64_t syscalls;
+} uring_shared = { DISCORD_LOCK_INIT, NULL, 0, 0, { NULL, NULL }, NULL, "", 0, 0, 0, 0, 0 };
+
+static void uring_count_syscalls(uint64_t count) {
+    __atomic_add_fetch(&uring_shared.syscalls, count, __ATOMIC_RELAXED);
+}
+
+static void uring_count_copy(size_t bytes) {
+    __atomic_add_fetch(&uring_shared.bytes_copied, bytes, __ATOMIC_RELAXED);
+}
+
+// -- io_uring ------------------------------------------------------------
+
+static int uring_ring_init(uring_ring_t* ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    uring_count_syscalls(1);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    // Timed waits need IORING_ENTER_EXT_ARG (5.11)
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            munmap(ring->sq_map, ring->sq_map_size);
+            close(ring->fd);
+            ring->fd = -1;
+            return -1;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_map != ring->sq_map) {
+            munmap(ring->cq_map, ring->cq_map_size);
+        }
+        munmap(ring->sq_map, ring->sq_map_size);
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    char* sq = ring->sq_map;
+    char* cq = ring->cq_map;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static void uring_ring_free(uring_ring_t* ring) {
+    if (ring->fd < 0) {
+        return;
+    }
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+// Fill and publish one SQE for a registered-buffer read or write
+static int uring_push(uring_ring_t* ring, int opcode, int fd, void* addr, size_t length,
+                      uint16_t buf_index, uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        return -1;
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->len = (uint32_t)length;
+    sqe->buf_index = buf_index;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    return 0;
+}
+
+// Submit and optionally wait for one completion; timeout_ms < 0 waits forever
+static int uring_enter(uring_ring_t* ring, unsigned to_submit, int wait, int timeout_ms) {
+    if (!to_submit && !wait) {
+        return 0;
+    }
+
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned flags = 0;
+    memset(&arg, 0, sizeof(arg));
+
+    if (wait) {
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        arg.sigmask_sz = _NSIG / 8;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+    }
+
+    uring_count_syscalls(1);
+    return (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, wait ? 1 : 0, flags,
+                        wait ? &arg : NULL, wait ? sizeof(arg) : 0);
+}
+
+// -- Connection helpers (caller holds conn->lock) --------------------------
+
+static void uring_fail(struct discord_uring_conn* conn, int error) {
+    if (!conn->error) {
+        conn->error = error;
+    }
+    if (conn->gateway) {
+        conn->gateway->state = conn->closing ? DISCORD_STATE_DISCONNECTED : DISCORD_STATE_ERROR;
+    }
+}
+
+static void uring_queue_write(struct discord_uring_conn* conn) {
+    if (conn->mode != URING_MODE_RING || conn->write_inflight || conn->shead == conn->stail) {
+        return;
+    }
+    if (uring_push(&conn->ring, IORING_OP_WRITE_FIXED, conn->fd, conn->send + conn->shead,
+                   conn->stail - conn->shead, 1, URING_OP_WRITE) == 0) {
+        conn->write_inflight = 1;
+    }
+}
+
+static void uring_queue_read(struct discord_uring_conn* conn) {
+    if (conn->read_inflight) {
+        return;
+    }
+
+    // Reads always land after the unconsumed bytes; slide a partial frame
+    // to the front when the tail is short or the frame would not fit
+    if (conn->rstart == conn->rend) {
+        conn->rstart = conn->rend = 0;
+    } else if (conn->rstart > 0 &&
+               (conn->receive_size - conn->rend < URING_READ_MIN ||
+                conn->rneed > conn->receive_size - conn->rstart)) {
+        size_t pending = conn->rend - conn->rstart;
+        memmove(conn->receive, conn->receive + conn->rstart, pending);
+        uring_count_copy(pending);
+        conn->rstart = 0;
+        conn->rend = pending;
+    }
+
+    if (conn->mode == URING_MODE_RING &&
+        uring_push(&conn->ring, IORING_OP_READ_FIXED, conn->fd, conn->receive + conn->rend,
+                   conn->receive_size - conn->rend, 0, URING_OP_READ) == 0) {
+        conn->read_inflight = 1;
+    }
+}
+
+// kTLS returns EIO for a record that is not application data; read it
+// with its record type so alerts close the connection and the rest
+// (post-handshake messages) are skipped
+static void uring_ktls_control_record(struct discord_uring_conn* conn) {
+    char control[CMSG_SPACE(sizeof(unsigned char))];
+    struct iovec iov = { conn->receive + conn->rend, conn->receive_size - conn->rend };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(conn->fd, &msg, 0);
+    uring_count_syscalls(1);
+    if (n <= 0) {
+        uring_fail(conn, DISCORD_ERROR_NETWORK);
+        return;
+    }
+
+    int record_type = URING_RECORD_APPLICATION;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_TLS && cmsg->cmsg_type == TLS_GET_RECORD_TYPE) {
+        record_type = *(unsigned char*)CMSG_DATA(cmsg);
+    }
+
+    if (record_type == URING_RECORD_APPLICATION) {
+        conn->rend += (size_t)n;
+    } else if (record_type == URING_RECORD_ALERT) {
+        uring_fail(conn, DISCORD_ERROR_NETWORK);
+    }
+}
+
+static void uring_reap(struct discord_uring_conn* conn) {
+    uring_ring_t* ring = &conn->ring;
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        int res = cqe->res;
+
+        if (cqe->user_data == URING_OP_READ) {
+            conn->read_inflight = 0;
+            if (res > 0) {
+                conn->rend += (size_t)res;
+            } else if (res == -EIO && conn->ktls) {
+                uring_ktls_control_record(conn);
+            } else if (res != -EAGAIN && res != -EINTR) {
+                uring_fail(conn, DISCORD_ERROR_NETWORK);
+            }
+        } else if (cqe->user_data == URING_OP_WRITE) {
+            conn->write_inflight = 0;
+            if (res < 0) {
+                if (res != -EAGAIN && res != -EINTR) {
+                    uring_fail(conn, DISCORD_ERROR_NETWORK);
+                }
+            } else {
+                conn->shead += (size_t)res;
+            }
+            if (conn->shead == conn->stail) {
+                conn->shead = conn->stail = 0;
+            } else if (!conn->error) {
+                uring_queue_write(conn);    // Short write: the rest goes next
+            }
+        }
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+// Pass queued SQEs to the kernel without waiting
+static void uring_submit(struct discord_uring_conn* conn) {
+    unsigned count = conn->ring.to_submit;
+    conn->ring.to_submit = 0;
+    if (count && uring_enter(&conn->ring, count, 0, 0) < 0 && errno != EBUSY && errno != EAGAIN) {
+        uring_fail(conn, DISCORD_ERROR_NETWORK);
+    }
+}
+
+// Wait for the socket (sync mode) without holding the lock
+static int uring_poll(struct discord_uring_conn* conn, short events, int timeout_ms) {
+    struct pollfd pfd = { conn->fd, events, 0 };
+    conn->waiting = 1;
+    discord_unlock(&conn->lock);
+    int n = poll(&pfd, 1, timeout_ms);
+    discord_lock(&conn->lock);
+    conn->waiting = 0;
+    uring_count_syscalls(1);
+    return n;
+}
+
+// Sync mode: write [shead, stail) through OpenSSL (or send for ws://)
+static void uring_flush_sync(struct discord_uring_conn* conn) {
+    while (conn->shead < conn->stail && !conn->error) {
+        size_t length = conn->stail - conn->shead;
+        int n;
+        int want_read = 0;
+
+        if (conn->ssl) {
+            size_t written = 0;
+            n = SSL_write_ex(conn->ssl, conn->send + conn->shead, length, &written) ? (int)written : -1;
+            if (n < 0) {
+                int err = SSL_get_error(conn->ssl, n);
+                if (err != SSL_ERROR_WANT_WRITE && err != SSL_ERROR_WANT_READ) {
+                    uring_fail(conn, DISCORD_ERROR_NETWORK);
+                    break;
+                }
+                want_read = err == SSL_ERROR_WANT_READ;
+            }
+        } else {
+            n = (int)send(conn->fd, conn->send + conn->shead, length, MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                uring_fail(conn, DISCORD_ERROR_NETWORK);
+                break;
+            }
+        }
+        uring_count_syscalls(1);
+
+        if (n > 0) {
+            conn->shead += (size_t)n;
+        } else {
+            struct pollfd pfd = { conn->fd, want_read ? POLLIN : POLLOUT, 0 };
+            poll(&pfd, 1, URING_CLOSE_TIMEOUT_MS);
+            uring_count_syscalls(1);
+        }
+    }
+
+    if (conn->shead == conn->stail) {
+        conn->shead = conn->stail = 0;
+    }
+}
+
+// Send whatever is queued now (close, or another thread is waiting)
+static void uring_flush(struct discord_uring_conn* conn) {
+    if (conn->mode == URING_MODE_SYNC) {
+        uring_flush_sync(conn);
+    } else {
+        uring_queue_write(conn);
+        uring_submit(conn);
+    }
+}
+
+// Wait for one completion, releasing the lock around the syscall
+static int uring_wait(struct discord_uring_conn* conn, int timeout_ms) {
+    unsigned count = conn->ring.to_submit;
+    conn->ring.to_submit = 0;
+    conn->waiting = 1;
+    discord_unlock(&conn->lock);
+    int rc = uring_enter(&conn->ring, count, 1, timeout_ms);
+    int saved_errno = errno;
+    discord_lock(&conn->lock);
+    conn->waiting = 0;
+    uring_reap(conn);
+
+    if (rc < 0 && saved_errno != ETIME && saved_errno != EINTR && saved_errno != EBUSY) {
+        uring_fail(conn, DISCORD_ERROR_NETWORK);
+    }
+    return rc;
+}
+
+static uint8_t* uring_next_mask(struct discord_uring_conn* conn, uint8_t mask[4]) {
+    uint64_t x = conn->mask_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    conn->mask_state = x;
+    memcpy(mask, &x, 4);
+    return mask;
+}
+
+// Append one masked frame to the send buffer
+static discord_result_t uring_append_frame(struct discord_uring_conn* conn, int opcode,
+                                           const uint8_t* payload, size_t length) {
+    size_t needed = DISCORD_WSFRAME_HEADER_MAX + length;
+    if (needed > conn->send_size) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    while (conn->stail + needed > conn->send_size) {
+        if (conn->error) {
+            return conn->error;
+        }
+        if (!conn->write_inflight && conn->shead > 0) {
+            size_t pending = conn->stail - conn->shead;
+            memmove(conn->send, conn->send + conn->shead, pending);
+            uring_count_copy(pending);
+            conn->shead = 0;
+            conn->stail = pending;
+            continue;
+        }
+        if (conn->mode == URING_MODE_SYNC) {
+            uring_flush_sync(conn);
+        } else {
+            uring_queue_write(conn);
+            uring_wait(conn, URING_CLOSE_TIMEOUT_MS);
+        }
+    }
+
+    uint8_t mask[4];
+    uint8_t* out = conn->send + conn->stail;
+    size_t header = discord_wsframe_header(out, opcode, 1, length, uring_next_mask(conn, mask));
+    discord_wsframe_mask_copy(out + header, payload, length, mask);
+    conn->stail += header + length;
+    uring_count_copy(length);
+    return DISCORD_OK;
+}
+
+// Ping, pong and close frames from the server
+static void uring_control(struct discord_uring_conn* conn, const discord_wsframe_t* frame,
+                          const uint8_t* payload) {
+    switch (frame->opcode) {
+        case DISCORD_WSFRAME_PING:
+            uring_append_frame(conn, DISCORD_WSFRAME_PONG, payload, (size_t)frame->payload_length);
+            break;
+        case DISCORD_WSFRAME_CLOSE:
+            // Echo the status code, then report the connection gone
+            if (!conn->closing) {
+                conn->closing = 1;
+                uring_append_frame(conn, DISCORD_WSFRAME_CLOSE, payload,
+                                   frame->payload_length >= 2 ? 2 : 0);
+                uring_flush(conn);
+            }
+            uring_fail(conn, DISCORD_ERROR_NETWORK);
+            break;
+        default:
+            break;
+    }
+}
+
+static void uring_deliver(struct discord_uring_conn* conn, discord_ws_message_t* message,
+                          char* data, size_t length, int is_binary) {
+    message->data = data;
+    message->length = length;
+    message->is_binary = is_binary;
+    __atomic_add_fetch(&uring_shared.frames, 1, __ATOMIC_RELAXED);
+
+    if (conn->recorder) {
+        discord_record_frame(conn->recorder, data, length, is_binary);
+    }
+}
+
+// Decode frames from [rstart, rend): 1 with a message, 0 for more bytes,
+// or an error
+static int uring_next_frame(struct discord_uring_conn* conn, discord_ws_message_t* message) {
+    for (;;) {
+        uint8_t* p = conn->receive + conn->rstart;
+        size_t available = conn->rend - conn->rstart;
+
+        if (conn->streaming) {
+            size_t n = available < conn->frag_remaining ? available : (size_t)conn->frag_remaining;
+            DISCORD_TRACE_BEGIN(trace_copy);
+            memcpy(conn->frag + conn->frag_length, p, n);
+            DISCORD_TRACE_END(trace_copy, DISCORD_TRACE_WS_COPY, n);
+            uring_count_copy(n);
+            conn->frag_length += n;
+            conn->frag_remaining -= n;
+            conn->rstart += n;
+            if (conn->frag_remaining) {
+                return 0;
+            }
+            conn->streaming = 0;
+            if (!conn->frag_fin) {
+                continue;
+            }
+
+            // Reassembled message: owned, freed by discord_ws_free_message
+            conn->frag[conn->frag_length] = '\0';
+            uring_deliver(conn, message, conn->frag, conn->frag_length, conn->frag_binary);
+            conn->frag = NULL;
+            conn->frag_length = conn->frag_capacity = 0;
+            conn->assembling = 0;
+            return 1;
+        }
+
+        discord_wsframe_t frame;
+        int parsed = discord_wsframe_parse(p, available, &frame);
+        if (parsed == 0) {
+            conn->rneed = 0;
+            return 0;
+        }
+        if (parsed < 0 || frame.masked) {
+            return DISCORD_ERROR_NETWORK;
+        }
+
+        uint64_t total = frame.header_length + frame.payload_length;
+        if (frame.opcode >= DISCORD_WSFRAME_CLOSE) {
+            if (available < total) {
+                conn->rneed = (size_t)total;
+                return 0;
+            }
+            uring_control(conn, &frame, p + frame.header_length);
+            conn->rstart += (size_t)total;
+            if (conn->error) {
+                return conn->error;
+            }
+            continue;
+        }
+
+        if ((frame.opcode == DISCORD_WSFRAME_CONTINUATION) != (conn->assembling != 0)) {
+            return DISCORD_ERROR_NETWORK;
+        }
+
+        // Whole frame in the buffer: hand it out in place
+        if (!conn->assembling && frame.fin && total <= conn->receive_size) {
+            if (available < total) {
+                conn->rneed = (size_t)total;
+                return 0;
+            }
+            uint8_t* data = p + frame.header_length;
+            size_t length = (size_t)frame.payload_length;
+            conn->held = data;
+            conn->held_length = length;
+            conn->held_saved = data[length];
+            data[length] = '\0';
+            conn->rstart += (size_t)total;
+            conn->rneed = 0;
+            uring_deliver(conn, message, (char*)data, length, frame.opcode == DISCORD_WSFRAME_BINARY);
+            return 1;
+        }
+
+        // Fragment, or larger than the receive buffer: copy as it arrives
+        if (!conn->assembling) {
+            conn->assembling = 1;
+            conn->frag_binary = frame.opcode == DISCORD_WSFRAME_BINARY;
+            conn->frag_length = 0;
+        }
+        if (frame.payload_length > SIZE_MAX - conn->frag_length - 1) {
+            return DISCORD_ERROR_MEMORY;
+        }
+        size_t required = conn->frag_length + (size_t)frame.payload_length + 1;
+        if (required > conn->frag_capacity) {
+            char* grown = discord_mem_realloc(DISCORD_MEM_RECEIVE, conn->frag, required);
+            if (!grown) {
+                return DISCORD_ERROR_MEMORY;
+            }
+            conn->frag = grown;
+            conn->frag_capacity = required;
+        }
+        conn->frag_remaining = frame.payload_length;
+        conn->frag_fin = frame.fin;
+        conn->streaming = 1;
+        conn->rstart += frame.header_length;
+        conn->rneed = 0;
+    }
+}
+
+// Put back the byte under the NUL of the last zero-copy message
+static void uring_release_held(struct discord_uring_conn* conn) {
+    if (conn->held) {
+        conn->held[conn->held_length] = conn->held_saved;
+        conn->held = NULL;
+    }
+}
+
+// -- Handshake ---------------------------------------------------------------
+
+static SSL_CTX* uring_ssl_ctx(int skip_verify) {
+    SSL_CTX* ctx = uring_shared.ssl_ctx[skip_verify ? 1 : 0];
+    if (ctx) {
+        return ctx;
+    }
+
+    ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx) {
+        return NULL;
+    }
+
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    #if OPENSSL_VERSION_NUMBER < 0x30200000L
+    // OpenSSL before 3.2 offloads only TLS 1.2 receives to the kernel
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    #endif
+#endif
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    if (skip_verify) {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+    } else {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+        SSL_CTX_set_default_verify_paths(ctx);
+    }
+
+    uring_shared.ssl_ctx[skip_verify ? 1 : 0] = ctx;
+    return ctx;
+}
+
+static int uring_raw_write(struct discord_uring_conn* conn, const void* data, size_t length) {
+    while (length > 0) {
+        int n;
+        if (conn->ssl) {
+            size_t written = 0;
+            n = SSL_write_ex(conn->ssl, data, length, &written) ? (int)written : -1;
+        } else {
+            n = (int)send(conn->fd, data, length, MSG_NOSIGNAL);
+        }
+        uring_count_syscalls(1);
+        if (n <= 0) {
+            return -1;
+        }
+        data = (const char*)data + n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static int uring_raw_read(struct discord_uring_conn* conn, void* data, size_t length) {
+    int n;
+    if (conn->ssl) {
+        size_t read = 0;
+        n = SSL_read_ex(conn->ssl, data, length, &read) ? (int)read : -1;
+    } else {
+        n = (int)recv(conn->fd, data, length, 0);
+    }
+    uring_count_syscalls(1);
+    return n;
+}
+
+static const char* uring_find_header(const char* response, const char* name) {
+    size_t name_length = strlen(name);
+    for (const char* line = strstr(response, "\r\n"); line; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, name, name_length) == 0 && line[2 + name_length] == ':') {
+            const char* value = line + 2 + name_length + 1;
+            while (*value == ' ' || *value == '\t') {
+                value++;
+            }
+            return value;
+        }
+    }
+    return NULL;
+}
+
+// HTTP/1.1 upgrade; bytes after the response stay in the receive buffer
+static discord_result_t uring_upgrade(struct discord_uring_conn* conn, const char* host, int port,
+                                      const char* path, int default_port) {
+    uint8_t nonce[16];
+    char key[32];
+    RAND_bytes(nonce, sizeof(nonce));
+    EVP_EncodeBlock((unsigned char*)key, nonce, sizeof(nonce));
+
+    // IPv6 literals go back in brackets
+    char authority[URING_HOST_MAX + 16];
+    const char* format = strchr(host, ':') ? (port == default_port ? "[%s]" : "[%s]:%d")
+                                           : (port == default_port ? "%s" : "%s:%d");
+    snprintf(authority, sizeof(authority), format, host, port);
+
+    char request[DISCORD_URL_PATH_MAX + URING_HOST_MAX + 256];
+    int length = snprintf(request, sizeof(request),
+                          "GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n",
+                          path, authority, key);
+    if (length <= 0 || (size_t)length >= sizeof(request) || uring_raw_write(conn, request, (size_t)length) != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    // Read until the blank line; the response goes through the receive
+    // buffer, which has room for any sane header block
+    char* response = (char*)conn->receive;
+    char* end = NULL;
+    while (!end) {
+        if (conn->rend >= conn->receive_size) {
+            return DISCORD_ERROR_NETWORK;
+        }
+        int n = uring_raw_read(conn, conn->receive + conn->rend, conn->receive_size - conn->rend);
+        if (n <= 0) {
+            return DISCORD_ERROR_NETWORK;
+        }
+        conn->rend += (size_t)n;
+        conn->receive[conn->rend] = '\0';
+        end = strstr(response, "\r\n\r\n");
+    }
+
+    // Drain anything OpenSSL decrypted but has not returned yet
+    while (conn->ssl && SSL_pending(conn->ssl) > 0 && conn->rend < conn->receive_size) {
+        int n = uring_raw_read(conn, conn->receive + conn->rend, conn->receive_size - conn->rend);
+        if (n <= 0) {
+            return DISCORD_ERROR_NETWORK;
+        }
+        conn->rend += (size_t)n;
+    }
+
+    size_t header_length = (size_t)(end - response) + 4;
+    end[2] = '\0';
+    if (strncmp(response, "HTTP/1.1 101", 12) != 0) {
+        return strncmp(response, "HTTP/1.1 401", 12) == 0 ? DISCORD_ERROR_AUTH : DISCORD_ERROR_NETWORK;
+    }
+
+    // Sec-WebSocket-Accept = base64(SHA-1(key + GUID))
+    char concatenated[64];
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned digest_length = 0;
+    char expected[64];
+    int key_length = snprintf(concatenated, sizeof(concatenated), "%s%s", key, uring_websocket_guid);
+    EVP_Digest(concatenated, (size_t)key_length, digest, &digest_length, EVP_sha1(), NULL);
+    EVP_EncodeBlock((unsigned char*)expected, digest, (int)digest_length);
+
+    const char* accept = uring_find_header(response, "Sec-WebSocket-Accept");
+    if (!accept || strncmp(accept, expected, strlen(expected)) != 0) {
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    conn->rstart = header_length;
+    return DISCORD_OK;
+}
+
+static discord_result_t uring_tls_handshake(struct discord_uring_conn* conn, const char* host,
+                                            int skip_verify) {
+    discord_lock(&uring_shared.lock);
+    SSL_CTX* ctx = uring_ssl_ctx(skip_verify);
+    conn->ssl = ctx ? SSL_new(ctx) : NULL;
+    if (conn->ssl && uring_shared.session && strcmp(uring_shared.session_host, host) == 0) {
+        SSL_set_session(conn->ssl, uring_shared.session);
+    }
+    discord_unlock(&uring_shared.lock);
+
+    if (!conn->ssl) {
+        return DISCORD_ERROR_MEMORY;
+    }
+
+    SSL_set_fd(conn->ssl, conn->fd);
+    SSL_set_tlsext_host_name(conn->ssl, host);
+    if (!skip_verify) {
+        SSL_set1_host(conn->ssl, host);
+    }
+
+    int connected = SSL_connect(conn->ssl);
+    uring_count_syscalls(1);
+    if (connected != 1) {
+        ERR_clear_error();
+        return SSL_get_verify_result(conn->ssl) != X509_V_OK ? DISCORD_ERROR_AUTH : DISCORD_ERROR_NETWORK;
+    }
+
+#ifdef SSL_OP_ENABLE_KTLS
+    conn->ktls = BIO_get_ktls_send(SSL_get_wbio(conn->ssl)) && BIO_get_ktls_recv(SSL_get_rbio(conn->ssl));
+#endif
+
+    discord_lock(&uring_shared.lock);
+    uring_shared.tls_handshakes++;
+    if (SSL_session_reused(conn->ssl)) {
+        uring_shared.tls_resumed++;
+    }
+    SSL_SESSION* session = SSL_get1_session(conn->ssl);
+    if (session) {
+        if (uring_shared.session) {
+            SSL_SESSION_free(uring_shared.session);
+        }
+        uring_shared.session = session;
+        snprintf(uring_shared.session_host, sizeof(uring_shared.session_host), "%s", host);
+    }
+    discord_unlock(&uring_shared.lock);
+    return DISCORD_OK;
+}
+
+// Register both buffers; without io_uring (old kernel, seccomp) fall back
+// to the sync path
+static void uring_setup_ring(struct discord_uring_conn* conn) {
+    conn->mode = URING_MODE_SYNC;
+    conn->ring.fd = -1;
+    if ((conn->ssl && !conn->ktls) || uring_ring_init(&conn->ring) != 0) {
+        return;
+    }
+
+    struct iovec buffers[2] = {
+        { conn->receive, conn->receive_size + 1 },
+        { conn->send, conn->send_size }
+    };
+    uring_count_syscalls(1);
+    if (syscall(__NR_io_uring_register, conn->ring.fd, IORING_REGISTER_BUFFERS, buffers, 2) != 0) {
+        uring_ring_free(&conn->ring);
+        return;
+    }
+    conn->mode = URING_MODE_RING;
+}
+
+static void uring_free_conn(struct discord_uring_conn* conn) {
+    uring_ring_free(&conn->ring);
+    if (conn->ssl) {
+        SSL_free(conn->ssl);
+    }
+    if (conn->fd >= 0) {
+        close(conn->fd);
+    }
+    discord_mem_free(conn->frag);
+    discord_mem_free(conn->receive);
+    discord_mem_free(conn->send);
+    discord_mem_free(conn);
+}
+
+// -- Entry points --------------------------------------------------------
+
+discord_result_t discord_uring_connect(const char* url, const discord_ws_options_t* options,
+                                       discord_gateway_t* gateway) {
+    discord_url_t parsed;
+    if (discord_url_parse(url, &parsed) != DISCORD_OK) {
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t receive_size = options && options->receive_buffer_size ? options->receive_buffer_size
+                                                                    : URING_RECEIVE_DEFAULT;
+    if (receive_size < URING_RECEIVE_MIN) {
+        receive_size = URING_RECEIVE_MIN;
+    }
+
+    struct discord_uring_conn* conn = discord_mem_calloc(DISCORD_MEM_OTHER, 1, sizeof(*conn));
+    if (!conn) {
+        return DISCORD_ERROR_MEMORY;
+    }
+    pthread_mutex_init(&conn->lock, NULL);
+    conn->gateway = gateway;
+    conn->fd = -1;
+    conn->ring.fd = -1;
+    conn->receive_size = receive_size;
+    conn->receive = discord_mem_alloc(DISCORD_MEM_RECEIVE, conn->receive_size + 1);
+    conn->send_size = URING_SEND_SIZE;
+    conn->send = discord_mem_alloc(DISCORD_MEM_SEND, conn->send_size);
+    if (!conn->receive || !conn->send) {
+        uring_free_conn(conn);
+        return DISCORD_ERROR_MEMORY;
+    }
+    RAND_bytes((unsigned char*)&conn->mask_state, sizeof(conn->mask_state));
+    conn->mask_state |= 1;
+
+    discord_connect_timing_t* timing = &gateway->timing;
+    conn->fd = discord_connect_tcp(parsed.host, parsed.port, options && options->tcp_fastopen,
+                                   URING_HANDSHAKE_TIMEOUT_S, timing);
+    if (conn->fd < 0) {
+        uring_free_conn(conn);
+        return DISCORD_ERROR_NETWORK;
+    }
+
+    discord_result_t result = DISCORD_OK;
+    uint64_t phase = discord_time_now_ns();
+    if (parsed.secure) {
+        result = uring_tls_handshake(conn, parsed.host, options && options->skip_verify);
+        timing->tls_ns = discord_time_now_ns() - phase;
+        timing->tls_resumed = conn->ssl && SSL_session_reused(conn->ssl);
+        phase += timing->tls_ns;
+    }
+    if (result == DISCORD_OK) {
+        result = uring_upgrade(conn, parsed.host, parsed.port, parsed.path, parsed.default_port);
+        timing->upgrade_ns = discord_time_now_ns() - phase;
+    }
+    if (result != DISCORD_OK) {
+        uring_free_conn(conn);
+        return result;
+    }
+    timing->fastopen = discord_connect_syn_data(conn->fd);
+
+    uring_setup_ring(conn);
+    if (conn->mode == URING_MODE_SYNC) {
+        fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    discord_lock(&uring_shared.lock);
+    conn->next = uring_shared.connections;
+    if (uring_shared.connections) {
+        uring_shared.connections->prev = conn;
+    }
+    uring_shared.connections = conn;
+    uring_shared.connection_count++;
+    if (conn->ktls) {
+        uring_shared.ktls_count++;
+    }
+    discord_unlock(&uring_shared.lock);
+
+    gateway->uring = conn;
+    gateway->state = DISCORD_STATE_CONNECTED;
+    return DISCORD_OK;
+}
+
+discord_result_t discord_uring_send(struct discord_uring_conn* conn, const char* data, size_t length) {
+    DISCORD_TRACE_BEGIN(trace_send);
+    discord_lock(&conn->lock);
+
+    discord_result_t result = conn->error ? conn->error
+                                          : uring_append_frame(conn, DISCORD_WSFRAME_TEXT,
+                                                               (const uint8_t*)data, length);
+
+    // Batched with the receiver's next submission, unless it is asleep
+    if (result == DISCORD_OK && conn->waiting) {
+        uring_flush(conn);
+    }
+
+    discord_unlock(&conn->lock);
+    DISCORD_TRACE_END(trace_send, DISCORD_TRACE_WS_SEND, length);
+    return result;
+}
+
+discord_result_t discord_uring_receive(struct discord_uring_conn* conn, discord_ws_message_t* message,
+                                       int timeout_ms) {
+    uint64_t deadline = discord_time_now_ms() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+    discord_result_t result = DISCORD_ERROR_TIMEOUT;
+    int waited = 0;
+
+    discord_lock(&conn->lock);
+    uring_release_held(conn);
+
+    for (;;) {
+        int next = uring_next_frame(conn, message);
+        if (next == 1) {
+            result = DISCORD_OK;
+            break;
+        }
+        if (next < 0) {
+            uring_fail(conn, next);
+        }
+        if (conn->error) {
+            result = conn->error;
+            break;
+        }
+
+        uint64_t now = discord_time_now_ms();
+        int remaining = now < deadline ? (int)(deadline - now) : 0;
+        if (waited && remaining == 0) {
+            break;
+        }
+        waited = 1;
+
+        uring_queue_read(conn);
+        if (conn->mode == URING_MODE_RING) {
+            // Queued sends ride on the same io_uring_enter as the wait
+            uring_queue_write(conn);
+            DISCORD_TRACE_BEGIN(trace_service);
+            if (remaining > 0) {
+                uring_wait(conn, remaining);
+            } else {
+                uring_submit(conn);
+                uring_reap(conn);
+            }
+            DISCORD_TRACE_END(trace_service, DISCORD_TRACE_WS_SERVICE, conn->rend - conn->rstart);
+            continue;
+        }
+
+        uring_flush_sync(conn);
+        if (conn->rend >= conn->receive_size) {
+            uring_fail(conn, DISCORD_ERROR_NETWORK);
+            continue;
+        }
+
+        int n = uring_raw_read(conn, conn->receive + conn->rend, conn->receive_size - conn->rend);
+        if (n > 0) {
+            conn->rend += (size_t)n;
+            waited = 0;             // More may already be buffered
+            continue;
+        }
+
+        short events = POLLIN;
+        if (conn->ssl) {
+            int err = SSL_get_error(conn->ssl, n);
+            if (err == SSL_ERROR_WANT_WRITE) {
+                events = POLLOUT;
+            } else if (err != SSL_ERROR_WANT_READ) {
+                uring_fail(conn, DISCORD_ERROR_NETWORK);
+                continue;
+            }
+        } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            uring_fail(conn, DISCORD_ERROR_NETWORK);
+            continue;
+        }
+        if (remaining > 0) {
+            uring_poll(conn, events, remaining);
+        }
+    }
+
+    discord_unlock(&conn->lock);
+    return result;
+}
+
+void discord_uring_close(struct discord_uring_conn* conn) {
+    discord_lock(&uring_shared.lock);
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    } else if (uring_shared.connections == conn) {
+        uring_shared.connections = conn->next;
+    }
+    if (conn->next) {
+        conn->next->prev = conn->prev;
+    }
+    uring_shared.connection_count--;
+    if (conn->ktls) {
+        uring_shared.ktls_count--;
+    }
+    discord_unlock(&uring_shared.lock);
+
+    discord_lock(&conn->lock);
+    uring_release_held(conn);
+    if (!conn->error) {
+        static const uint8_t normal[2] = { 0x03, 0xE8 };   // 1000
+        conn->closing = 1;
+        uring_append_frame(conn, DISCORD_WSFRAME_CLOSE, normal, sizeof(normal));
+        uring_flush(conn);
+    }
+
+    // Let the final write drain, then end the socket so a pending read
+    // completes before its registered buffer is freed
+    if (conn->mode == URING_MODE_RING) {
+        for (int i = 0; i < 4 && conn->write_inflight && !conn->error; i++) {
+            uring_wait(conn, URING_CLOSE_TIMEOUT_MS / 4);
+        }
+        shutdown(conn->fd, SHUT_RDWR);
+        for (int i = 0; (conn->read_inflight || conn->write_inflight) && i < 4; i++) {
+            uring_wait(conn, URING_CLOSE_TIMEOUT_MS / 4);
+        }
+    } else if (conn->ssl && !conn->error) {
+        SSL_shutdown(conn->ssl);
+    }
+
+    // A request the kernel never completed still owns its buffer: leak
+    // it rather than free memory that may yet be written
+    if (conn->read_inflight || conn->write_inflight) {
+        conn->receive = NULL;
+        conn->send = NULL;
+    }
+    discord_unlock(&conn->lock);
+
+    pthread_mutex_destroy(&conn->lock);
+    if (conn->gateway) {
+        conn->gateway->state = DISCORD_STATE_DISCONNECTED;
+    }
+    uring_free_conn(conn);
+}
+
+void discord_uring_set_recorder(struct discord_uring_conn* conn, discord_recorder_t* recorder) {
+    discord_lock(&conn->lock);
+    conn->recorder = recorder;
+    discord_unlock(&conn->lock);
+}
+
+int discord_uring_release_message(discord_ws_message_t* message) {
+    const uint8_t* data = (const uint8_t*)message->data;
+    int found = 0;
+
+    discord_lock(&uring_shared.lock);
+    for (struct discord_uring_conn* c = uring_shared.connections; c && !found; c = c->next) {
+        if (data >= c->receive && data <= c->receive + c->receive_size) {
+            discord_lock(&c->lock);
+            if (c->held == data) {
+                uring_release_held(c);
+            }
+            discord_unlock(&c->lock);
+            found = 1;
+        }
+    }
+    discord_unlock(&uring_shared.lock);
+    return found;
+}
+
+void discord_uring_add_stats(discord_ws_stats_t* stats) {
+    discord_lock(&uring_shared.lock);
+    stats->connections += uring_shared.connection_count;
+    stats->uring_connections = uring_shared.connection_count;
+    stats->ktls_connections = uring_shared.ktls_count;
+    stats->tls_handshakes += uring_shared.tls_handshakes;
+    stats->tls_resumed += uring_shared.tls_resumed;
+    for (struct discord_uring_conn* c = uring_shared.connections; c; c = c->next) {
+        stats->connection_bytes += sizeof(discord_gateway_t) + sizeof(*c) +
+                                   c->receive_size + 1 + c->send_size + c->frag_capacity;
+    }
+    discord_unlock(&uring_shared.lock);
+
+    stats->frames_received += __atomic_load_n(&uring_shared.frames, __ATOMIC_RELAXED);
+    stats->bytes_copied += __atomic_load_n(&uring_shared.bytes_copied, __ATOMIC_RELAXED);
+    stats->syscalls += __atomic_load_n(&uring_shared.syscalls, __ATOMIC_RELAXED);
+}
+
+discord_result_t discord_uring_shutdown(void) {
+    discord_lock(&uring_shared.lock);
+    if (uring_shared.connection_count > 0) {
+        discord_unlock(&uring_shared.lock);
+        return DISCORD_ERROR_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (uring_shared.ssl_ctx[i]) {
+            SSL_CTX_free(uring_shared.ssl_ctx[i]);
+            uring_shared.ssl_ctx[i] = NULL;
+        }
+    }
+    if (uring_shared.session) {
+        SSL_SESSION_free(uring_shared.session);
+        uring_shared.session = NULL;
+    }
+    discord_unlock(&uring_shared.lock);
+    return DISCORD_OK;
+}
+
+#else // !__linux__
+
+discord_result_t discord_uring_connect(const char* url, const discord_ws_options_t* options,
+                                       discord_gateway_t* gateway) {
+    (void)url;
+    (void)options;
+    (void)gateway;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_uring_send(struct discord_uring_conn* conn, const char* data, size_t length) {
+    (void)conn;
+    (void)data;
+    (void)length;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+discord_result_t discord_uring_receive(struct discord_uring_conn* conn, discord_ws_message_t* message,
+                                       int timeout_ms) {
+    (void)conn;
+    (void)message;
+    (void)timeout_ms;
+    return DISCORD_ERROR_UNSUPPORTED;
+}
+
+void discord_uring_close(struct discord_uring_conn* conn) {
+    (void)conn;
+}
+
+void discord_uring_set_recorder(struct discord_uring_conn* conn, discord_recorder_t* recorder) {
+    (void)conn;
+    (void)recorder;
+}
+
+int discord_uring_release_message(discord_ws_message_t* message) {
+    (void)message;
+    return 0;
+}
+
+void discord_uring_add_stats(discord_ws_stats_t* stats) {
+    (void)stats;
+}
+
+discord_result_t discord_uring_shutdown(void) {
+    return DISCORD_OK;
+}
+
+#endif // __linux__
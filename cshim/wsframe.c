@@ -0,0 +1,183 @@
+#include "wsframe.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define WSFRAME_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define WSFRAME_NEON 1
+#endif
+
+int discord_wsframe_parse(const uint8_t* data, size_t length, discord_wsframe_t* frame) {
+    if (length < 2) {
+        return 0;
+    }
+
+    uint8_t b0 = data[0];
+    uint8_t b1 = data[1];
+    if (b0 & 0x70) {
+        return -1;                  // No extensions are negotiated
+    }
+
+    frame->fin = (b0 & 0x80) != 0;
+    frame->opcode = b0 & 0x0F;
+    frame->masked = (b1 & 0x80) != 0;
+
+    switch (frame->opcode) {
+        case DISCORD_WSFRAME_CONTINUATION:
+        case DISCORD_WSFRAME_TEXT:
+        case DISCORD_WSFRAME_BINARY:
+            break;
+        case DISCORD_WSFRAME_CLOSE:
+        case DISCORD_WSFRAME_PING:
+        case DISCORD_WSFRAME_PONG:
+            if (!frame->fin || (b1 & 0x7F) > DISCORD_WSFRAME_CONTROL_MAX) {
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+    }
+
+    size_t pos = 2;
+    uint64_t payload = b1 & 0x7F;
+    if (payload == 126) {
+        if (length < 4) {
+            return 0;
+        }
+        payload = ((uint64_t)data[2] << 8) | data[3];
+        pos = 4;
+    } else if (payload == 127) {
+        if (length < 10) {
+            return 0;
+        }
+        payload = 0;
+        for (int i = 0; i < 8; i++) {
+            payload = (payload << 8) | data[2 + i];
+        }
+        if (payload >> 63) {
+            return -1;
+        }
+        pos = 10;
+    }
+
+    if (frame->masked) {
+        if (length < pos + 4) {
+            return 0;
+        }
+        memcpy(frame->mask, data + pos, 4);
+        pos += 4;
+    }
+
+    frame->header_length = pos;
+    frame->payload_length = payload;
+    return 1;
+}
+
+size_t discord_wsframe_header(uint8_t* out, int opcode, int fin, uint64_t payload_length,
+                              const uint8_t* mask) {
+    uint8_t mask_bit = mask ? 0x80 : 0;
+    size_t pos;
+
+    out[0] = (uint8_t)((fin ? 0x80 : 0) | (opcode & 0x0F));
+    if (payload_length < 126) {
+        out[1] = (uint8_t)(mask_bit | payload_length);
+        pos = 2;
+    } else if (payload_length <= 0xFFFF) {
+        out[1] = (uint8_t)(mask_bit | 126);
+        out[2] = (uint8_t)(payload_length >> 8);
+        out[3] = (uint8_t)payload_length;
+        pos = 4;
+    } else {
+        out[1] = (uint8_t)(mask_bit | 127);
+        for (int i = 0; i < 8; i++) {
+            out[2 + i] = (uint8_t)(payload_length >> (56 - 8 * i));
+        }
+        pos = 10;
+    }
+
+    if (mask) {
+        memcpy(out + pos, mask, 4);
+        pos += 4;
+    }
+    return pos;
+}
+
+void discord_wsframe_mask_scalar(uint8_t* data, size_t length, const uint8_t mask[4], size_t offset) {
+    for (size_t i = 0; i < length; i++) {
+        data[i] ^= mask[(offset + i) & 3];
+    }
+}
+
+// The mask rotated to start at byte (offset & 3), repeated to 16 bytes
+static void wsframe_mask_pattern(uint8_t pattern[16], const uint8_t mask[4], size_t offset) {
+    for (int i = 0; i < 16; i++) {
+        pattern[i] = mask[(offset + (size_t)i) & 3];
+    }
+}
+
+void discord_wsframe_mask(uint8_t* data, size_t length, const uint8_t mask[4], size_t offset) {
+    size_t i = 0;
+
+#if defined(WSFRAME_SSE2) || defined(WSFRAME_NEON)
+    if (length >= 16) {
+        uint8_t pattern[16];
+        wsframe_mask_pattern(pattern, mask, offset);
+    #if defined(WSFRAME_SSE2)
+        const __m128i key = _mm_loadu_si128((const __m128i*)pattern);
+        for (; i + 64 <= length; i += 64) {
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(data + i + 16));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(data + i + 32));
+            __m128i v3 = _mm_loadu_si128((const __m128i*)(data + i + 48));
+            _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(v0, key));
+            _mm_storeu_si128((__m128i*)(data + i + 16), _mm_xor_si128(v1, key));
+            _mm_storeu_si128((__m128i*)(data + i + 32), _mm_xor_si128(v2, key));
+            _mm_storeu_si128((__m128i*)(data + i + 48), _mm_xor_si128(v3, key));
+        }
+        for (; i + 16 <= length; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(v, key));
+        }
+    #else
+        const uint8x16_t key = vld1q_u8(pattern);
+        for (; i + 16 <= length; i += 16) {
+            vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), key));
+        }
+    #endif
+    }
+#endif
+
+    // 16 is a multiple of 4, so the tail keeps the same phase
+    discord_wsframe_mask_scalar(data + i, length - i, mask, offset + i);
+}
+
+void discord_wsframe_mask_copy(uint8_t* out, const uint8_t* in, size_t length, const uint8_t mask[4]) {
+    size_t i = 0;
+
+#if defined(WSFRAME_SSE2)
+    if (length >= 16) {
+        uint8_t pattern[16];
+        wsframe_mask_pattern(pattern, mask, 0);
+        const __m128i key = _mm_loadu_si128((const __m128i*)pattern);
+        for (; i + 16 <= length; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(v, key));
+        }
+    }
+#elif defined(WSFRAME_NEON)
+    if (length >= 16) {
+        uint8_t pattern[16];
+        wsframe_mask_pattern(pattern, mask, 0);
+        const uint8x16_t key = vld1q_u8(pattern);
+        for (; i + 16 <= length; i += 16) {
+            vst1q_u8(out + i, veorq_u8(vld1q_u8(in + i), key));
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        out[i] = in[i] ^ mask[i & 3];
+    }
+}
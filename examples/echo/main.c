@@ -3,17 +3,21 @@
 #include <string.h>
 #include "abi.h"
 #include "opcodes.h"
+#include "module.h"
 
 // Assembly functions from gateway.asm
 extern discord_result_t discord_gateway_connect(const char* token);
 extern discord_result_t discord_gateway_run(const char* token);
 extern discord_result_t discord_gateway_disconnect(void);
+extern discord_result_t discord_gateway_set_session(discord_session_t* session);
 
 static void print_usage(const char* program_name) {
     printf("Usage: %s\n", program_name);
     printf("Environment variables:\n");
     printf("  DISCORD_BOT_TOKEN - Your Discord bot token (required)\n");
     printf("  DISCORD_INTENTS   - Intent bitfield (optional, defaults to basic intents)\n");
+    printf("  DISCORD_SESSION_FILE - Session snapshot path for RESUME after restart (optional)\n");
+    printf("  DISCORD_HANDLER_MODULE - Handler module, reloaded whenever the file is replaced (optional)\n");
 }
 
 int main(int argc, char* argv[]) {
@@ -36,12 +40,36 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Attach a session snapshot so a restarted process can RESUME
+    discord_session_t* session = NULL;
+    const char* session_path = getenv("DISCORD_SESSION_FILE");
+    if (session_path) {
+        if (discord_session_open(session_path, 0, 0, &session) == DISCORD_OK) {
+            discord_gateway_set_session(session);
+            printf("Using session snapshot: %s\n", session_path);
+        } else {
+            fprintf(stderr, "Warning: could not open session snapshot %s\n", session_path);
+        }
+    }
+    
+    // Handlers from a shared object; deploying a new build of it swaps them live
+    const char* module_path = getenv("DISCORD_HANDLER_MODULE");
+    if (module_path) {
+        if (discord_module_load(module_path) == DISCORD_OK) {
+            discord_module_watch(module_path, 1000);
+            printf("Using handler module: %s\n", module_path);
+        } else {
+            fprintf(stderr, "Warning: could not load handler module %s\n", module_path);
+        }
+    }
+    
     printf("Connecting to Discord Gateway...\n");
     
     // Connect to gateway
     discord_result_t result = discord_gateway_connect(token);
     if (result != DISCORD_OK) {
         fprintf(stderr, "Failed to connect to Discord Gateway: %d\n", result);
+        discord_session_close(session);
         return 1;
     }
     
@@ -60,6 +88,10 @@ int main(int argc, char* argv[]) {
     
     // Disconnect
     discord_gateway_disconnect();
+    discord_module_watch(NULL, 0);
+    discord_module_unload();
+    discord_session_close(session);
+    discord_ws_shutdown();
     
     printf("Disconnected. Goodbye!\n");
     return (result == DISCORD_OK) ? 0 : 1;
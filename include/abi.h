@@ -20,6 +20,9 @@ extern "C" {
 // Forward declarations
 typedef struct discord_gateway discord_gateway_t;
 typedef struct discord_ws_message discord_ws_message_t;
+typedef struct discord_session discord_session_t;
+typedef struct discord_recorder discord_recorder_t;
+typedef struct discord_replay discord_replay_t;
 
 // Result codes
 typedef enum {
@@ -29,7 +32,9 @@ typedef enum {
     DISCORD_ERROR_AUTH = -3,
     DISCORD_ERROR_JSON = -4,
     DISCORD_ERROR_MEMORY = -5,
-    DISCORD_ERROR_TIMEOUT = -6
+    DISCORD_ERROR_TIMEOUT = -6,
+    DISCORD_ERROR_UNSUPPORTED = -7,
+    DISCORD_ERROR_NOT_FOUND = -8
 } discord_result_t;
 
 // WebSocket message structure
@@ -39,10 +44,136 @@ struct discord_ws_message {
     int is_binary;
 };
 
+// Resume state restored from a session snapshot
+#define DISCORD_SESSION_ID_MAX   128
+#define DISCORD_RESUME_URL_MAX   256
+
+typedef struct {
+    uint64_t saved_at_ms;                               // Wall-clock time of last update
+    int sequence;                                       // Last sequence number seen
+    char session_id[DISCORD_SESSION_ID_MAX];            // Session ID from READY
+    char resume_gateway_url[DISCORD_RESUME_URL_MAX];    // Resume URL from READY
+} discord_session_state_t;
+
+// Replay pacing
+typedef enum {
+    DISCORD_REPLAY_MAX_SPEED = 0,   // Push frames back to back
+    DISCORD_REPLAY_PACED = 1        // Honour recorded inter-frame gaps
+} discord_replay_mode_t;
+
+// Replay statistics
+#define DISCORD_REPLAY_MAX_TYPES 64
+
+typedef struct {
+    char event_type[64];            // Event name ("" for non-dispatch opcodes)
+    uint64_t count;                 // Frames of this type
+    uint64_t total_ns;              // Parse + dispatch time
+    uint64_t max_ns;                // Slowest single frame
+} discord_replay_type_stats_t;
+
+typedef struct {
+    uint64_t frames;                // Frames pushed through dispatch
+    uint64_t bytes;                 // Payload bytes replayed
+    uint64_t errors;                // Frames that failed to parse
+    uint64_t elapsed_ns;            // Wall time for the whole run
+    double events_per_sec;          // frames / elapsed
+    size_t type_count;              // Entries used in types[]
+    discord_replay_type_stats_t types[DISCORD_REPLAY_MAX_TYPES];
+} discord_replay_stats_t;
+
+// Process-wide WebSocket statistics (see discord_ws_get_stats)
+typedef struct {
+    uint32_t connections;           // Live gateway connections
+    uint32_t contexts_created;      // lws contexts created (1 while shared)
+    uint64_t tls_handshakes;        // Client connections established
+    uint64_t tls_resumed;           // Of those, resumed from the TLS session cache
+    size_t connection_bytes;        // Memory owned by all live connections
+    size_t bytes_per_connection;    // connection_bytes / connections
+    size_t queued_frames;           // Completed frames not yet received
+    uint32_t uring_connections;     // Of connections, on the io_uring transport
+    uint32_t ktls_connections;      // Of those, with TLS records handled by the kernel
+    uint64_t frames_received;       // Data frames handed to discord_ws_receive callers
+    uint64_t bytes_copied;          // Payload bytes memcpy'd by the shim (receive and send)
+    uint64_t syscalls;              // io_uring transport only (lws does its own I/O)
+} discord_ws_stats_t;
+
+// WebSocket transports (see discord_ws_connect_ex)
+typedef enum {
+    DISCORD_WS_TRANSPORT_DEFAULT = 0,   // DISCORD_WS_TRANSPORT=uring|lws|sim, else lws
+    DISCORD_WS_TRANSPORT_LWS,           // libwebsockets on the shared context
+    DISCORD_WS_TRANSPORT_URING,         // io_uring + kTLS (Linux only)
+    DISCORD_WS_TRANSPORT_SIM            // In-memory gateway of the live discord_sim_t (sim.h)
+} discord_ws_transport_t;
+
+typedef struct {
+    discord_ws_transport_t transport;
+    int skip_verify;                // io_uring: accept any certificate (mock gateways)
+    uint32_t receive_buffer_size;   // io_uring: registered receive buffer, 0 = 256 KiB
+    int tcp_fastopen;               // io_uring: TCP_FASTOPEN_CONNECT (Linux 4.11+, net.ipv4.tcp_fastopen & 1)
+} discord_ws_options_t;
+
+// Memory accounting
+// Every shim allocation carries a subsystem tag; live and peak bytes are
+// kept per tag. A soft budget does not fail allocations: the callback runs
+// (on the allocating thread, at most one at a time per tag) each time an
+// allocation leaves the tag above budget, so it can evict cached data.
+typedef enum {
+    DISCORD_MEM_RECEIVE = 0,        // Frame reassembly buffers and queued frames
+    DISCORD_MEM_JSON,               // Parse scratch and built payloads
+    DISCORD_MEM_SEND,               // Outbound buffers and request queues
+    DISCORD_MEM_CACHE,              // Entity caches (bot code allocates these)
+    DISCORD_MEM_DISPATCH,           // Dispatch queues and routing tables
+    DISCORD_MEM_OTHER,              // Connection and bookkeeping structures
+    DISCORD_MEM_TAG_COUNT
+} discord_mem_tag_t;
+
+// Replacement for malloc/realloc/free (mimalloc, jemalloc, an arena...);
+// each function gets the user pointer back
+typedef struct {
+    void* (*allocate)(void* user, size_t size);
+    void* (*reallocate)(void* user, void* ptr, size_t size);
+    void (*release)(void* user, void* ptr);
+    void* user;
+} discord_allocator_t;
+
+typedef void (*discord_mem_budget_callback_t)(discord_mem_tag_t tag, size_t live_bytes,
+                                              size_t budget, void* user);
+
+typedef struct {
+    size_t live_bytes;              // Requested bytes currently allocated
+    size_t peak_bytes;              // Highest live_bytes seen
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t failures;              // Allocator returned NULL
+    size_t budget;                  // 0 = none
+    uint64_t over_budget;           // Budget callbacks run
+} discord_mem_stats_t;
+
+// Replacement for the clock behind discord_time_now_ms/ns and
+// discord_sleep_ms (the simulator's virtual clock, a test clock...).
+// now_ns must be monotonic; sleep_ms may be NULL (sleeps return at once).
+typedef struct {
+    uint64_t (*now_ns)(void* user);
+    void (*sleep_ms)(void* user, uint32_t milliseconds);
+    void* user;
+} discord_clock_t;
+
 // C Shim API - WebSocket Operations
+// All connections share one process-wide lws_context (one SSL_CTX and TLS
+// session cache). discord_ws_receive services that context and returns
+// the next frame queued for the given connection.
 DISCORD_EXPORT discord_result_t DISCORD_CALL 
 discord_ws_connect(const char* url, discord_gateway_t** gateway);
 
+// Connect on a chosen transport. The io_uring transport (Linux 5.11+)
+// does the TLS handshake with OpenSSL, leaves record encryption to kTLS
+// when the kernel has it, and frames RFC 6455 itself. Its messages point
+// into the registered receive buffer and stay valid until the next
+// discord_ws_receive on the connection; sends are queued and leave with
+// the next ring submission.
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_ws_connect_ex(const char* url, const discord_ws_options_t* options, discord_gateway_t** gateway);
+
 DISCORD_EXPORT discord_result_t DISCORD_CALL 
 discord_ws_send(discord_gateway_t* gateway, const char* data, size_t length);
 
@@ -55,6 +186,15 @@ discord_ws_close(discord_gateway_t* gateway);
 DISCORD_EXPORT void DISCORD_CALL 
 discord_ws_free_message(discord_ws_message_t* message);
 
+// Connection count, TLS resumption and per-connection memory
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_ws_get_stats(discord_ws_stats_t* stats);
+
+// Release the shared context once every connection is closed. It is kept
+// across reconnects otherwise, so cached TLS sessions stay usable.
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_ws_shutdown(void);
+
 // C Shim API - JSON Operations
 DISCORD_EXPORT discord_result_t DISCORD_CALL 
 discord_json_parse_opcode(const char* json, int* opcode);
@@ -65,19 +205,160 @@ discord_json_parse_hello(const char* json, int* heartbeat_interval);
 DISCORD_EXPORT discord_result_t DISCORD_CALL 
 discord_json_create_identify(const char* token, char** json_out);
 
+// IDENTIFY with "shard":[shard_id, shard_count]; shard_count 0 leaves it out
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_create_identify_sharded(const char* token, int shard_id, int shard_count, char** json_out);
+
 DISCORD_EXPORT discord_result_t DISCORD_CALL 
 discord_json_create_heartbeat(int sequence, char** json_out);
 
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_parse_sequence(const char* json, int* sequence);
+
+DISCORD_EXPORT int DISCORD_CALL 
+discord_json_match_event(const char* json, const char* event_type);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_parse_ready(const char* json, char** session_id, char** resume_gateway_url);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_parse_envelope(const char* json, int* opcode, int* sequence,
+                            char* event_type, size_t event_type_size,
+                            const char** data, size_t* data_length);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_create_resume(const char* token, const char* session_id, int sequence, char** json_out);
+
+// Integer value of a key of the outermost object (nested keys are ignored)
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_parse_root_int(const char* json, size_t length, const char* key, int* value);
+
+// Iterate the members of an object or the elements of an array without
+// copying: *cursor starts at the opening brace/bracket and advances past
+// each item returned; DISCORD_ERROR_NOT_FOUND marks the end. Values are raw
+// tokens (strings keep their quotes), keys are unquoted views.
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_object_next(const char** cursor, const char* end,
+                         const char** key, size_t* key_length,
+                         const char** value, size_t* value_length);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_json_array_next(const char** cursor, const char* end,
+                        const char** element, size_t* element_length);
+
 DISCORD_EXPORT void DISCORD_CALL 
 discord_json_free(char* json);
 
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_ws_set_recorder(discord_gateway_t* gateway, discord_recorder_t* recorder);
+
+// C Shim API - Frame Recording and Replay
+// Captures are append-only: a 16-byte file header followed by records of
+// { uint32 length, uint32 flags, uint64 ns since capture start, payload }.
+// Opening an existing capture appends to it, continuing from its last
+// timestamp; a torn last record is cut off first, and a file without a
+// capture header is refused (DISCORD_ERROR_INVALID_PARAM). Token values are redacted before they reach the file.
+// Replay hands each frame to discord_dispatch_frame, as a live connection
+// does.
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_record_open(const char* path, discord_recorder_t** recorder);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_record_frame(discord_recorder_t* recorder, const char* data, size_t length, int is_binary);
+
+DISCORD_EXPORT void DISCORD_CALL 
+discord_record_close(discord_recorder_t* recorder);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_replay_open(const char* path, discord_replay_t** replay);
+
+DISCORD_EXPORT size_t DISCORD_CALL 
+discord_replay_frame_count(const discord_replay_t* replay);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_replay_run(discord_replay_t* replay, discord_replay_mode_t mode, discord_replay_stats_t* stats);
+
+DISCORD_EXPORT void DISCORD_CALL 
+discord_replay_close(discord_replay_t* replay);
+
+// C Shim API - Memory
+// The allocator can only be replaced while no tagged memory is live
+// (before the first connection); NULL restores malloc/realloc/free.
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_set_allocator(const discord_allocator_t* allocator);
+
+DISCORD_EXPORT void* DISCORD_CALL 
+discord_mem_alloc(discord_mem_tag_t tag, size_t size);
+
+DISCORD_EXPORT void* DISCORD_CALL 
+discord_mem_calloc(discord_mem_tag_t tag, size_t count, size_t size);
+
+// ptr may be NULL; the block is accounted to tag afterwards
+DISCORD_EXPORT void* DISCORD_CALL 
+discord_mem_realloc(discord_mem_tag_t tag, void* ptr, size_t size);
+
+DISCORD_EXPORT void DISCORD_CALL 
+discord_mem_free(void* ptr);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_mem_set_budget(discord_mem_tag_t tag, size_t budget,
+                       discord_mem_budget_callback_t callback, void* user);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_mem_get_stats(discord_mem_tag_t tag, discord_mem_stats_t* stats);
+
 // C Shim API - Timing Operations
+// The clock is process-wide. Swap it before other threads read the time;
+// NULL restores the monotonic system clock.
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_set_clock(const discord_clock_t* clock);
+
 DISCORD_EXPORT uint64_t DISCORD_CALL 
 discord_time_now_ms(void);
 
+DISCORD_EXPORT uint64_t DISCORD_CALL 
+discord_time_now_ns(void);
+
 DISCORD_EXPORT void DISCORD_CALL 
 discord_sleep_ms(uint32_t milliseconds);
 
+// C Shim API - Session Snapshot Operations
+// A snapshot is a memory-mapped file per shard holding the resume state
+// (session_id, sequence, resume_gateway_url) plus optional entity-cache
+// pages. Sequence updates are plain atomic stores into the mapping; the
+// kernel page cache keeps them across a process crash without fsync.
+// POSIX only: on Windows discord_session_open returns
+// DISCORD_ERROR_UNSUPPORTED and connects use the fallback URL.
+#define DISCORD_SESSION_RESUME_WINDOW_MS  120000  // Max snapshot age we try to RESUME
+#define DISCORD_SESSION_PAGE_SIZE         4096    // Size of one entity-cache page
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_session_open(const char* path, int shard_id, uint32_t cache_pages, discord_session_t** session);
+
+DISCORD_EXPORT void DISCORD_CALL 
+discord_session_store_sequence(discord_session_t* session, int sequence);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_session_store_identity(discord_session_t* session, const char* session_id, const char* resume_gateway_url);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_session_load(discord_session_t* session, uint64_t max_age_ms, discord_session_state_t* state);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_session_connect_url(discord_session_t* session, const char* fallback_url, char* url_out, size_t url_size);
+
+DISCORD_EXPORT void DISCORD_CALL 
+discord_session_invalidate(discord_session_t* session);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_session_cache_page(discord_session_t* session, uint32_t index, void** page, size_t* size);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL 
+discord_session_flush(discord_session_t* session);
+
+DISCORD_EXPORT void DISCORD_CALL 
+discord_session_close(discord_session_t* session);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,151 @@
+#ifndef DISCORD_ASM_ARCHIVE_H
+#define DISCORD_ASM_ARCHIVE_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Message archive
+// MESSAGE_CREATE, MESSAGE_UPDATE, MESSAGE_DELETE and MESSAGE_DELETE_BULK
+// are written to a directory of immutable segment files. Inside a segment,
+// rows are stored by column in groups of DISCORD_ARCHIVE_GROUP_ROWS: the
+// snowflakes as zigzag varint deltas, the contents of a group compressed
+// as one block. Each segment ends with sparse indexes that map a channel
+// or an author to the groups containing it, plus the time range of every
+// group, so a query only decodes the groups that can match.
+//
+// Appending only pulls the ids out of the event and copies the content.
+// Encoding, compression and file writes run on a writer thread. When that
+// thread falls DISCORD_ARCHIVE_QUEUE_GROUPS groups behind, the dispatch
+// thread waits for it (counted in stalls) rather than dropping messages.
+// A segment appears in the directory (renamed from a .tmp file) once it is
+// complete; rows not yet in a sealed segment are lost on a crash.
+//
+// Content is stored as it appeared in the event: a JSON string body, with
+// its escapes intact. Times are those of the message id (the snowflake
+// timestamp), so an edit or delete is found alongside the message it
+// refers to; event_ms records when the archive saw it.
+//
+// POSIX only: on Windows every call returns DISCORD_ERROR_UNSUPPORTED and
+// nothing is archived.
+
+#define DISCORD_ARCHIVE_GROUP_ROWS      1024
+#define DISCORD_ARCHIVE_SEGMENT_ROWS    (1u << 20)  // Default rows per segment file
+#define DISCORD_ARCHIVE_QUEUE_GROUPS    16          // Filled groups the writer may lag behind
+#define DISCORD_SNOWFLAKE_EPOCH_MS      1420070400000ULL
+
+typedef struct discord_archive discord_archive_t;
+typedef struct discord_archive_reader discord_archive_reader_t;
+
+typedef enum {
+    DISCORD_ARCHIVE_CREATE = 0,
+    DISCORD_ARCHIVE_UPDATE,
+    DISCORD_ARCHIVE_DELETE
+} discord_archive_kind_t;
+
+typedef struct {
+    uint32_t segment_rows;          // Rounded up to whole groups; 0 = DISCORD_ARCHIVE_SEGMENT_ROWS
+    int sync;                       // fsync each segment before it is renamed into place
+} discord_archive_config_t;
+
+typedef struct {
+    discord_archive_kind_t kind;
+    uint64_t message_id;
+    uint64_t channel_id;
+    uint64_t guild_id;              // 0 = direct message
+    uint64_t author_id;             // 0 = not in the event (deletes, most updates)
+    uint64_t event_ms;              // Wall clock when archived
+    const char* content;            // JSON string body, not NUL-terminated; NULL = not in the event
+    uint32_t content_length;
+} discord_archive_row_t;
+
+typedef struct {
+    uint64_t rows;
+    uint64_t skipped;               // Events without the ids a row needs
+    uint64_t stalls;                // Appends that waited for the writer
+    uint64_t groups;                // Written to segments
+    uint64_t segments;
+    uint64_t content_bytes;         // Before compression
+    uint64_t content_packed;        // After
+    uint64_t file_bytes;
+    uint64_t write_errors;          // Segments that could not be written (the rows are lost)
+} discord_archive_stats_t;
+
+typedef struct {
+    uint64_t channel_id;            // 0 = any
+    uint64_t author_id;             // 0 = any
+    uint64_t since_ms;              // Message time (Unix ms), inclusive; 0 = unbounded
+    uint64_t until_ms;              // Exclusive; 0 = unbounded
+    uint32_t kinds;                 // Bit per discord_archive_kind_t; 0 = all
+} discord_archive_query_t;
+
+typedef struct {
+    uint64_t segments;              // Opened by the query
+    uint64_t segments_skipped;      // Ruled out by their time range or index
+    uint64_t groups_scanned;        // Id columns decoded
+    uint64_t groups_decoded;        // Had a match: content decompressed
+    uint64_t rows_scanned;
+    uint64_t rows_matched;
+} discord_archive_query_stats_t;
+
+// Return nonzero to stop the query. The row (content included) is only
+// valid during the call.
+typedef int (*discord_archive_row_callback_t)(void* user, const discord_archive_row_t* row);
+
+// Creates directory if needed. Segment numbers continue after the highest
+// one already there.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_open(const char* directory, const discord_archive_config_t* config, discord_archive_t** archive);
+
+// Archive a MESSAGE_* dispatch event; other event types are ignored
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_append(discord_archive_t* archive, const discord_event_t* event);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_append_row(discord_archive_t* archive, const discord_archive_row_t* row);
+
+// Archive every MESSAGE_* event discord_dispatch_frame decodes, including
+// those QoS sheds or automod blocks later, whatever handlers are
+// registered for them; handlers are left alone. NULL detaches. Returns once no dispatch can still be appending to the
+// previously attached archive.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_attach(discord_archive_t* archive);
+
+// Called by discord_dispatch_frame before the QoS offer and automod
+DISCORD_EXPORT void DISCORD_CALL
+discord_archive_sink(const discord_event_t* event);
+
+// Seal everything appended so far into a segment and wait until it is in
+// the directory
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_flush(discord_archive_t* archive);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_get_stats(discord_archive_t* archive, discord_archive_stats_t* stats);
+
+// Flushes, then stops the writer
+DISCORD_EXPORT void DISCORD_CALL
+discord_archive_close(discord_archive_t* archive);
+
+// Maps every sealed segment in directory. DISCORD_ERROR_INVALID_PARAM when
+// one of them is damaged.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_reader_open(const char* directory, discord_archive_reader_t** reader);
+
+// Rows in archive order. stats may be NULL.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_archive_query(discord_archive_reader_t* reader, const discord_archive_query_t* query,
+                      discord_archive_row_callback_t callback, void* user,
+                      discord_archive_query_stats_t* stats);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_archive_reader_close(discord_archive_reader_t* reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_ARCHIVE_H
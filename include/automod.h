@@ -0,0 +1,146 @@
+#ifndef DISCORD_ASM_AUTOMOD_H
+#define DISCORD_ASM_AUTOMOD_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Message automod
+// A rule set of keywords and link domains is compiled once into tables that
+// are only read while scanning, so one scan of a message costs about the
+// same for ten rules as for ten thousand:
+//   - keywords use Discord's AutoMod syntax: "word" matches the whole word,
+//     "word*" words starting with it, "*word" words ending with it and
+//     "*word*" anywhere. ASCII letters match in either case; a word is a run
+//     of ASCII letters, digits, '_' and non-ASCII bytes. All keywords go
+//     into one Aho-Corasick automaton, flattened to a table of next states
+//     over byte classes, so the content is read once, at most one table
+//     step per byte. When every keyword starts a word (no "*word" rules),
+//     the automaton only runs from words whose first bytes begin some
+//     keyword; a vectorised scan jumps over the others.
+//   - domains match the host of a scheme://host link and every subdomain of
+//     it ("example.com" matches https://cdn.example.com/x but not
+//     https://example.com.evil). Links are found with a vectorised scan for
+//     "://".
+// Content is scanned as it sits in the frame: JSON escapes (\n, \", \uXXXX)
+// are decoded on the fly, and match offsets point into the raw content.
+//
+// discord_automod_install makes a compiled rule set the filter stage of
+// discord_dispatch_event: MESSAGE_CREATE (and, with scan_updates,
+// MESSAGE_UPDATE) events are scanned before any handler runs, on_verdict
+// gets the messages that matched, and a match of a BLOCK rule keeps the
+// event from every handler. Installing another rule set swaps it in with
+// one pointer store and waits until no dispatch is still scanning with the
+// old one, so rule sets can be rebuilt and replaced at runtime from any
+// thread.
+
+#define DISCORD_AUTOMOD_KEYWORD_MAX     60      // Longest keyword, without the '*'
+#define DISCORD_AUTOMOD_DOMAIN_MAX      253
+#define DISCORD_AUTOMOD_MAX_MATCHES     8       // Scanning stops at this many
+
+typedef struct discord_automod discord_automod_t;
+
+typedef enum {
+    DISCORD_AUTOMOD_KEYWORD = 0,
+    DISCORD_AUTOMOD_DOMAIN
+} discord_automod_rule_type_t;
+
+typedef enum {
+    DISCORD_AUTOMOD_FLAG = 0,       // Report the message; handlers still get it
+    DISCORD_AUTOMOD_BLOCK           // Report the message; handlers do not get it
+} discord_automod_action_t;
+
+typedef struct {
+    discord_automod_rule_type_t type;
+    const char* pattern;            // Copied
+    discord_automod_action_t action;
+    uint32_t rule_id;               // Reported in matches
+} discord_automod_rule_t;
+
+typedef struct {
+    uint32_t rule_id;
+    discord_automod_action_t action;
+    uint32_t offset;                // Into the raw content
+    uint32_t length;                // Raw bytes, escapes included
+} discord_automod_match_t;
+
+typedef struct {
+    const discord_event_t* event;   // NULL from discord_automod_scan
+    const char* content;            // Raw JSON string body, not NUL terminated
+    size_t content_length;
+    discord_automod_action_t action; // Strongest action of the matches
+    uint32_t match_count;           // Keyword matches in content order, then domains
+    discord_automod_match_t matches[DISCORD_AUTOMOD_MAX_MATCHES];
+    void* user;                     // From the config
+} discord_automod_verdict_t;
+
+// Runs on the dispatching thread before any handler; the verdict and its
+// event are valid until it returns
+typedef void (*discord_automod_verdict_handler_t)(const discord_automod_verdict_t* verdict);
+
+typedef struct {
+    discord_automod_verdict_handler_t on_verdict; // Messages with at least one match (optional)
+    void* user;
+    int scan_updates;               // Also scan MESSAGE_UPDATE events that carry content
+    int scalar_only;                // Step through every byte (benchmarks)
+} discord_automod_config_t;
+
+typedef struct {
+    uint64_t messages;              // Contents scanned
+    uint64_t bytes;
+    uint64_t matched;               // Contents with at least one match
+    uint64_t blocked;               // Events kept from the handlers
+    uint64_t skipped_bytes;         // Jumped over between candidate words
+    uint32_t keywords;
+    uint32_t domains;
+    uint32_t states;                // Automaton states after compile
+    uint32_t classes;               // Byte classes in the transition table
+    size_t table_bytes;
+    int word_skip;                  // Every keyword starts a word, so words can be skipped
+} discord_automod_stats_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_automod_create(const discord_automod_config_t* config, discord_automod_t** automod);
+
+// Frees an uninstalled rule set; an installed one is uninstalled first
+DISCORD_EXPORT void DISCORD_CALL
+discord_automod_destroy(discord_automod_t* automod);
+
+// Add a rule; DISCORD_ERROR_INVALID_PARAM for a malformed pattern or an
+// installed rule set
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_automod_add(discord_automod_t* automod, const discord_automod_rule_t* rule);
+
+// Build the matching tables; required after the last add
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_automod_compile(discord_automod_t* automod);
+
+// Scan raw content (a JSON string body) into verdict; DISCORD_OK whether or
+// not anything matched
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_automod_scan(discord_automod_t* automod, const char* content, size_t length,
+                     discord_automod_verdict_t* verdict);
+
+// Make a compiled rule set the filter stage (NULL removes it) and wait up
+// to timeout_ms until no dispatch can still be scanning with the one it
+// replaced (*previous, NULL if none), including its on_verdict calls.
+// DISCORD_ERROR_TIMEOUT: *previous may still be in use and must be kept
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_automod_install(discord_automod_t* automod, uint32_t timeout_ms, discord_automod_t** previous);
+
+// Called by discord_dispatch_event: 1 if the installed rule set blocked
+// the event, 0 to run its handlers
+DISCORD_EXPORT int DISCORD_CALL
+discord_automod_filter(const discord_event_t* event);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_automod_get_stats(discord_automod_t* automod, discord_automod_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_AUTOMOD_H
@@ -0,0 +1,107 @@
+#ifndef DISCORD_ASM_CONNECT_H
+#define DISCORD_ASM_CONNECT_H
+
+#include "abi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Connect pipeline
+// Gateway connects resolve their host through a process-wide DNS cache.
+// Lookups run on a background thread, and callers asking for the same host
+// share one lookup, so a thousand shards reconnecting together cost one
+// query. getaddrinfo does not report record TTLs, so entries live for a
+// configured ttl_ms. Once that has passed the old addresses are still used
+// for up to stale_ms while a refresh runs in the background. They are also
+// kept if the refresh fails, because the resolver is often down too during
+// an outage.
+//
+// A standby is a connection opened ahead of time (TCP, TLS and the
+// WebSocket upgrade already done) and parked until it is taken. The shard
+// driver keeps one to its resume URL when discord_shard_config_t.prewarm
+// is set, so op 7 (RECONNECT) resumes without a handshake.
+//
+// Every connection records how long each phase took; the shard adds HELLO
+// and READY/RESUMED (discord_shard_stats_t.last_connect).
+//
+// The DNS cache is POSIX only. On Windows discord_dns_configure,
+// discord_dns_prefetch and the connect-time lookup return
+// DISCORD_ERROR_UNSUPPORTED, so lws resolves every connect itself inside
+// upgrade_ns. Standbys work there but open synchronously in
+// discord_ws_prewarm.
+
+#define DISCORD_DNS_TTL_MS              60000
+#define DISCORD_DNS_STALE_MS            600000
+#define DISCORD_DNS_CACHE_MAX           32      // Hosts
+#define DISCORD_WS_STANDBY_MAX_AGE_MS   30000   // Older standbys are closed instead of used
+
+typedef struct {
+    uint64_t dns_ns;                // Resolve; 0 when the cache answered
+    uint64_t tcp_ns;                // TCP connect (io_uring transport)
+    uint64_t tls_ns;                // TLS handshake (io_uring transport)
+    uint64_t upgrade_ns;            // WebSocket upgrade; with lws, TCP, TLS and upgrade together
+    uint64_t hello_ns;              // Connected to HELLO (shard)
+    uint64_t ready_ns;              // IDENTIFY or RESUME sent to READY or RESUMED (shard)
+    uint64_t total_ns;              // Connect called to READY or RESUMED (shard)
+    int dns_cached;
+    int tls_resumed;                // Abbreviated handshake from a cached session
+    int fastopen;                   // The SYN carried data (TCP Fast Open cookie accepted)
+    int prewarmed;                  // Taken from a standby; the transport phases ran earlier
+} discord_connect_timing_t;
+
+typedef struct {
+    uint64_t lookups;               // getaddrinfo calls
+    uint64_t hits;                  // Answered from a fresh entry
+    uint64_t stale_hits;            // Answered from an expired entry (refreshing or failed)
+    uint64_t joined;                // Waited for a lookup another caller started
+    uint64_t failures;              // Lookups that failed
+    uint64_t standbys_opened;
+    uint64_t standbys_used;
+    uint64_t standbys_expired;      // Closed unused
+    uint32_t entries;
+} discord_connect_stats_t;
+
+typedef struct discord_ws_standby discord_ws_standby_t;
+
+// ttl_ms and stale_ms for new lookups; 0 keeps the default
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dns_configure(uint32_t ttl_ms, uint32_t stale_ms);
+
+// Start resolving host in the background unless a fresh entry exists
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dns_prefetch(const char* host);
+
+// Forget every cached address
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dns_flush(void);
+
+// Open a connection to url now and park it. Connects that block (the
+// io_uring transport) run on a background thread; lws and the simulator
+// connect asynchronously anyway.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_ws_prewarm(const char* url, const discord_ws_options_t* options, discord_ws_standby_t** standby);
+
+// Hand over the parked connection, waiting for a connect still in
+// progress. DISCORD_ERROR_TIMEOUT when it is older than
+// DISCORD_WS_STANDBY_MAX_AGE_MS, or the connect's error. The standby is
+// released either way.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_ws_standby_take(discord_ws_standby_t* standby, discord_gateway_t** gateway);
+
+// Close without using it
+DISCORD_EXPORT void DISCORD_CALL
+discord_ws_standby_close(discord_ws_standby_t* standby);
+
+// Transport phases of gateway's connect (the shard fills in the rest)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_ws_get_connect_timing(discord_gateway_t* gateway, discord_connect_timing_t* timing);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_connect_get_stats(discord_connect_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_CONNECT_H
@@ -0,0 +1,148 @@
+#ifndef DISCORD_ASM_COORD_H
+#define DISCORD_ASM_COORD_H
+
+#include "abi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cross-process shard coordination
+// Processes running the shards of one bot on a host connect to one
+// coordinator (the discord-asm-coordinator daemon, or any process running
+// a discord_coord_server_t) over a Unix socket. The coordinator:
+//   - splits the bot's shards over the connected processes in contiguous
+//     ranges, once `processes` of them have connected;
+//   - grants IDENTIFY slots for the whole host: one per identify bucket
+//     (shard_id % max_concurrency) per window_ms, in request order;
+//   - moves shards when processes come and go. The shards of a process
+//     that disconnects (or dies) go to the processes holding the fewest.
+//     A process joining later takes shards from those holding the most,
+//     each one only after its old owner confirmed it has stopped it, so a
+//     shard never runs in two processes.
+//
+// A process polls its discord_coord_t for assignment changes, starts and
+// stops shards to match (discord_coord_owns) and confirms. Shards created
+// with discord_shard_config_t.coord take their IDENTIFY slots from the
+// coordinator and report READY to it. The assembly gateway loop takes a
+// slot through discord_coord_identify_slot once a coordinator is attached,
+// and keeps heartbeating until the slot comes round.
+//
+// POSIX only (Unix domain sockets): on Windows the server and client calls
+// return DISCORD_ERROR_UNSUPPORTED and the gateway loop identifies
+// without a coordinator.
+//
+// Coordinator time is its own discord_time_now_ms; a grant tells the
+// client how long to wait, not when. A client handle belongs to one thread
+// (the one polling its shards); a server is driven by one thread.
+
+#define DISCORD_COORD_TIMEOUT_MS    5000    // Longest wait for a reply to an acquire
+
+typedef struct discord_coord discord_coord_t;
+typedef struct discord_coord_server discord_coord_server_t;
+
+typedef struct {
+    const char* path;               // Unix socket; an existing file is replaced
+    uint32_t shard_count;
+    uint32_t max_concurrency;       // From GET /gateway/bot; 0 = 1
+    uint32_t processes;             // Connected processes before the first assignment; 0 = 1
+    uint32_t window_ms;             // Per bucket; 0 = DISCORD_IDENTIFY_WINDOW_MS (shard.h)
+} discord_coord_server_config_t;
+
+typedef struct {
+    uint32_t processes;             // Connected now
+    uint32_t shards_assigned;       // Owned by a process and not being moved
+    uint32_t shards_ready;          // READY reported since their last IDENTIFY slot
+    uint64_t joins;
+    uint64_t leaves;                // Disconnects, including processes that died
+    uint64_t assignments;           // Assignment messages sent
+    uint64_t shards_moved;          // Handed from one process to another
+    uint64_t grants;
+    uint64_t grants_delayed;        // Granted for a later time than requested
+    uint64_t denied;                // Acquires for shards the process does not own
+    uint64_t assigned_ms;           // discord_time_now_ms of the first assignment, 0 = none yet
+    uint64_t all_ready_ms;          // When every shard was last READY, 0 = some shard is not
+} discord_coord_server_stats_t;
+
+typedef struct {
+    uint32_t shard_count;
+    uint32_t max_concurrency;
+    uint32_t owned;                 // Shards this process should run
+    uint64_t version;               // Bumped by every assignment received
+} discord_coord_assignment_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_server_create(const discord_coord_server_config_t* config, discord_coord_server_t** server);
+
+// Accept connections and answer requests, waiting up to timeout_ms
+// (-1 = forever) for the first one
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_server_poll(discord_coord_server_t* server, int timeout_ms);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_server_get_stats(const discord_coord_server_t* server, discord_coord_server_stats_t* stats);
+
+// Disconnects every process and removes the socket file
+DISCORD_EXPORT void DISCORD_CALL
+discord_coord_server_destroy(discord_coord_server_t* server);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_connect(const char* path, discord_coord_t** coord);
+
+// Read what the coordinator sent, waiting up to timeout_ms (-1 = forever).
+// DISCORD_OK: the assignment changed; apply it, then discord_coord_confirm.
+// DISCORD_ERROR_TIMEOUT: no change. DISCORD_ERROR_NETWORK: the coordinator
+// is gone; keep running what is owned, or reconnect.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_poll(discord_coord_t* coord, int timeout_ms);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_get_assignment(const discord_coord_t* coord, discord_coord_assignment_t* assignment);
+
+// 1 if the current assignment gives shard_id to this process
+DISCORD_EXPORT int DISCORD_CALL
+discord_coord_owns(const discord_coord_t* coord, int shard_id);
+
+// Shards no longer owned have been stopped; the coordinator hands them on
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_confirm(discord_coord_t* coord);
+
+// Same contract as discord_identify_limiter_acquire, with the slot
+// reserved cluster-wide. Waits for the reply. DISCORD_ERROR_NOT_FOUND: the
+// shard is not (or no longer) owned; DISCORD_ERROR_NETWORK: no coordinator
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_acquire(discord_coord_t* coord, int shard_id, uint64_t now_ms, uint64_t* retry_at_ms);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_report_ready(discord_coord_t* coord, int shard_id);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_coord_close(discord_coord_t* coord);
+
+// Gate the assembly gateway loop's IDENTIFY on coord for shard_id (NULL
+// detaches). Attach once the first assignment is in: the shard count is
+// taken from it. The coordinator must not be used from another thread
+// while the loop runs.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_attach(discord_coord_t* coord, int shard_id);
+
+// Called before every IDENTIFY the assembly loop sends; does not block.
+// *at_ms is when IDENTIFY may go: now when no coordinator is attached,
+// otherwise the slot the attached coordinator granted (reserved, so send
+// then without asking again). DISCORD_ERROR_NOT_FOUND: the shard is no
+// longer owned, do not IDENTIFY. DISCORD_ERROR_NETWORK: the coordinator is
+// unreachable and *at_ms is now, so IDENTIFY is not held back.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_identify_slot(uint64_t* at_ms);
+
+// The "shard":[id,count] pair the assembly loop puts in IDENTIFY: the
+// attached shard and the assignment's shard count, or 0, 0 (unsharded)
+// when no coordinator is attached
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_coord_identify_shard(int* shard_id, int* shard_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_COORD_H
@@ -0,0 +1,103 @@
+#ifndef DISCORD_ASM_DISPATCH_H
+#define DISCORD_ASM_DISPATCH_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event dispatch
+// Every frame the gateway core receives goes through discord_dispatch_frame,
+// which decodes the envelope into a discord_event_t and calls the handler
+// registered for its event type, falling back to the catch-all handler.
+// event->data is a view into the frame (bounded by data_length, not NUL
+// terminated); event->event_type is NUL-terminated and empty for non-dispatch
+// opcodes. Both are only valid for the duration of the handler call.
+// With a QoS scheduler attached (qos.h) discord_dispatch_frame queues
+// DISPATCH events and the handlers run later, in deadline order.
+// An installed automod rule set (automod.h) scans MESSAGE_CREATE events
+// in discord_dispatch_event before any handler and may keep them from all
+// of them.
+//
+// A type registered with discord_dispatch_on_batch is collected instead:
+// its events are copied into a batch that goes to the handler as one
+// contiguous array once it holds max_events, once its first event has
+// waited window_us, or when the gateway loop has drained the socket
+// (discord_qos_poll), so a burst is batched as far as it has arrived and a
+// lone event is not held back. Per-guild order is kept: before any other
+// event runs or joins a batch, pending batches holding events of its guild
+// (guild_id, or id for GUILD_CREATE/UPDATE/DELETE; events without either
+// count as one guild) are delivered. Batches are collected on the thread
+// that registered them (the gateway thread); from other threads, such as
+// the interactions workers, a batch handler gets each event on its own.
+
+#define DISCORD_EVENT_TYPE_MAX      64   // Longest event name plus terminator
+#define DISCORD_DISPATCH_TABLE_SIZE 128  // Per-type handler slots (power of two)
+#define DISCORD_DISPATCH_BATCH_TYPES 16  // Types with a batch handler
+#define DISCORD_DISPATCH_BATCH_MAX  4096 // Largest max_events
+#define DISCORD_DISPATCH_BATCH_DEFAULT_EVENTS    64
+#define DISCORD_DISPATCH_BATCH_DEFAULT_WINDOW_US 1000
+
+// The events (data and event_type included) are valid until the handler
+// returns
+typedef void (*discord_batch_handler_t)(const discord_event_t* events, size_t count);
+
+typedef struct {
+    uint32_t max_events;            // 0 = DISCORD_DISPATCH_BATCH_DEFAULT_EVENTS
+    uint32_t window_us;             // 0 = DISCORD_DISPATCH_BATCH_DEFAULT_WINDOW_US
+} discord_batch_config_t;
+
+typedef struct {
+    uint64_t batches;               // Handler calls
+    uint64_t events;
+    uint64_t full;                  // Delivered at max_events
+    uint64_t expired;               // Delivered after window_us
+    uint64_t drained;               // Delivered because the socket was drained (or on flush)
+    uint64_t ordered;               // Delivered early for an event of the same guild
+    uint32_t pending;               // Events waiting now
+} discord_batch_stats_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dispatch_set_handler(discord_event_handler_t handler);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dispatch_on(const char* event_type, discord_event_handler_t handler);
+
+// Collect event_type into batches for handler (config may be NULL).
+// Replaces a handler from discord_dispatch_on, and is replaced by a later
+// one. A NULL handler delivers what is pending and unregisters the type,
+// which falls back to the catch-all.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dispatch_on_batch(const char* event_type, discord_batch_handler_t handler,
+                          const discord_batch_config_t* config);
+
+// Deliver every pending batch now
+DISCORD_EXPORT void DISCORD_CALL
+discord_dispatch_flush(void);
+
+// Gateway loop hook (called from discord_qos_poll): idle is non-zero when
+// no frame was ready. Delivers every batch when idle, else those whose
+// window has run out.
+DISCORD_EXPORT void DISCORD_CALL
+discord_dispatch_poll(int idle);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dispatch_get_batch_stats(discord_batch_stats_t* stats);
+
+// Delivers pending batches, then forgets every handler
+DISCORD_EXPORT void DISCORD_CALL
+discord_dispatch_clear(void);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dispatch_frame(const char* json);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_dispatch_event(const discord_event_t* event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_DISPATCH_H
@@ -0,0 +1,137 @@
+#ifndef DISCORD_ASM_FANOUT_H
+#define DISCORD_ASM_FANOUT_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared-memory event fan-out
+// The gateway process publishes each event once into a ring in shared
+// memory (a file, ideally under /dev/shm, or an anonymous memfd handed to
+// child processes); any number of worker processes map it and read the
+// events in place. Workers can crash, restart and redeploy without
+// touching the gateway connections.
+//
+// Each consumer owns a cursor in the ring header and picks a mode:
+//   BLOCK  the publisher never overwrites events this consumer has not
+//          released; when the ring is full it waits up to
+//          publish_timeout_ms and then drops the event (counted)
+//   DROP   the publisher never waits for it; a consumer that falls a ring
+//          behind skips to the oldest event still there and counts what
+//          it lost
+// Slots of consumers whose process died are reclaimed by the publisher.
+//
+// A received event points into the mapping (read-only for consumers) and
+// stays valid until discord_fanout_release or the next discord_fanout_next.
+// One publisher per ring; a consumer handle belongs to one thread.
+//
+// POSIX only: on Windows every call returns DISCORD_ERROR_UNSUPPORTED
+// (discord_fanout_fd returns -1) and nothing is published.
+
+#define DISCORD_FANOUT_CAPACITY_DEFAULT  (8u << 20)  // Ring bytes (power of two)
+#define DISCORD_FANOUT_CONSUMERS_DEFAULT 16
+#define DISCORD_FANOUT_CONSUMERS_MAX     64
+#define DISCORD_FANOUT_TIMEOUT_DEFAULT   1000        // ms a publish waits on BLOCK consumers
+
+typedef struct discord_fanout discord_fanout_t;
+typedef struct discord_fanout_consumer discord_fanout_consumer_t;
+
+typedef enum {
+    DISCORD_FANOUT_BLOCK = 0,       // Backpressure: the publisher waits for this consumer
+    DISCORD_FANOUT_DROP             // Lossy: this consumer skips what it was too slow for
+} discord_fanout_mode_t;
+
+typedef struct {
+    uint32_t capacity;              // 0 = DISCORD_FANOUT_CAPACITY_DEFAULT
+    uint32_t max_consumers;         // 0 = DISCORD_FANOUT_CONSUMERS_DEFAULT
+    uint32_t publish_timeout_ms;    // 0 = DISCORD_FANOUT_TIMEOUT_DEFAULT, UINT32_MAX = never drop
+} discord_fanout_config_t;
+
+typedef struct {
+    discord_event_t event;          // data and event_type are NUL-terminated views
+    uint64_t index;                 // Publish order, counting from 0
+    uint64_t published_ns;          // discord_time_now_ns of the publisher
+} discord_fanout_event_t;
+
+typedef struct {
+    uint64_t published;
+    uint64_t dropped;               // BLOCK consumers kept the ring full past the timeout
+    uint64_t bytes;                 // Ring bytes written, padding included
+    uint64_t waits;                 // Publishes that had to wait for a BLOCK consumer
+    uint64_t reclaimed;             // Slots freed after their consumer died
+    uint32_t consumers;             // Attached now
+} discord_fanout_stats_t;
+
+typedef struct {
+    uint64_t received;
+    uint64_t lost;                  // Overwritten before this consumer got to them
+    uint64_t lag_bytes;             // Published but not yet released
+} discord_fanout_consumer_stats_t;
+
+// path NULL creates an anonymous memfd (Linux) to pass to child processes
+// with discord_fanout_fd. A file at path is replaced, so consumers of a
+// previous publisher see it close and reopen.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_create(const char* path, const discord_fanout_config_t* config, discord_fanout_t** fanout);
+
+DISCORD_EXPORT int DISCORD_CALL
+discord_fanout_fd(const discord_fanout_t* fanout);
+
+// DISCORD_ERROR_TIMEOUT: dropped because a BLOCK consumer kept the ring
+// full; DISCORD_ERROR_MEMORY: larger than a quarter of the ring
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_publish(discord_fanout_t* fanout, const discord_event_t* event);
+
+// Publish every event discord_dispatch_event delivers, whatever handler
+// it goes to; handlers are left alone. Threads dispatching at once take
+// turns publishing. NULL detaches. Returns once no dispatch can still be
+// publishing to the previously attached ring.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_attach(discord_fanout_t* fanout);
+
+// Called by discord_dispatch_event after the automod filter
+DISCORD_EXPORT void DISCORD_CALL
+discord_fanout_sink(const discord_event_t* event);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_get_stats(const discord_fanout_t* fanout, discord_fanout_stats_t* stats);
+
+// Marks the ring closed and wakes consumers; the file stays
+DISCORD_EXPORT void DISCORD_CALL
+discord_fanout_destroy(discord_fanout_t* fanout);
+
+// A new consumer starts at the next event published
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_consumer_open(const char* path, discord_fanout_mode_t mode,
+                             discord_fanout_consumer_t** consumer);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_consumer_open_fd(int fd, discord_fanout_mode_t mode, discord_fanout_consumer_t** consumer);
+
+// Waits up to timeout_ms (-1 = forever) for the next event. Releases the
+// previous one. DISCORD_ERROR_TIMEOUT: nothing yet; DISCORD_ERROR_NETWORK:
+// the publisher closed the ring or died
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_next(discord_fanout_consumer_t* consumer, int timeout_ms, discord_fanout_event_t* event);
+
+// Done with the event from discord_fanout_next. DISCORD_ERROR_NOT_FOUND: a
+// DROP consumer was overrun while it held the event, which may have been
+// overwritten under it (copy what must be exact before relying on it)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_release(discord_fanout_consumer_t* consumer);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_fanout_consumer_get_stats(const discord_fanout_consumer_t* consumer,
+                                  discord_fanout_consumer_stats_t* stats);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_fanout_consumer_close(discord_fanout_consumer_t* consumer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_FANOUT_H
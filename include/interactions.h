@@ -0,0 +1,81 @@
+#ifndef DISCORD_ASM_INTERACTIONS_H
+#define DISCORD_ASM_INTERACTIONS_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// HTTP interactions endpoint
+// A stateless alternative to the gateway for slash commands: Discord POSTs
+// each interaction to an HTTPS endpoint signed with Ed25519 over
+// timestamp + body. The server checks X-Signature-Ed25519 on a pool of
+// worker threads (each worker takes pending requests in batches and reuses
+// its verification context), answers PING itself and passes every other
+// verified payload to the dispatcher as an INTERACTION_CREATE event, so the
+// handlers registered with discord_dispatch_on serve both ingress paths.
+//
+// Handlers run on a worker thread. They answer by writing the response
+// body into discord_interactions_response_buffer() and committing it with
+// discord_interactions_respond(); the buffer already has the libwebsockets
+// headroom, so the body goes to the socket without another copy.
+
+#define DISCORD_INTERACTIONS_KEY_HEX_LEN  64        // Application public key
+#define DISCORD_INTERACTIONS_SIG_HEX_LEN  128       // X-Signature-Ed25519
+#define DISCORD_INTERACTIONS_MAX_BODY     (1 << 20) // Larger requests get 413
+#define DISCORD_INTERACTIONS_BATCH        16        // Requests a worker takes per wakeup
+
+typedef struct discord_interactions discord_interactions_t;
+
+typedef struct {
+    int port;                       // Listen port
+    const char* public_key;         // Application public key (hex)
+    const char* path;               // Endpoint path (NULL = "/interactions")
+    int worker_threads;             // Verification/dispatch threads (0 = 4)
+    const char* tls_cert_path;      // Serve HTTPS when both are set;
+    const char* tls_key_path;       // otherwise plain HTTP behind a proxy
+} discord_interactions_config_t;
+
+typedef struct {
+    uint64_t requests;              // Requests with a complete body
+    uint64_t verified;              // Signatures that checked out
+    uint64_t rejected;              // 401 responses
+    uint64_t pings;                 // PINGs answered with PONG
+    uint64_t dispatched;            // INTERACTION_CREATE events dispatched
+    uint64_t batches;               // Worker wakeups that took requests
+} discord_interactions_stats_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_interactions_start(const discord_interactions_config_t* config, discord_interactions_t** server);
+
+// Service the listener for up to timeout_ms; call from one thread in a loop
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_interactions_service(discord_interactions_t* server, int timeout_ms);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_interactions_get_stats(discord_interactions_t* server, discord_interactions_stats_t* stats);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_interactions_stop(discord_interactions_t* server);
+
+// Inside an INTERACTION_CREATE handler: space for a response body of up
+// to capacity bytes (NULL outside a handler or on allocation failure)
+DISCORD_EXPORT char* DISCORD_CALL
+discord_interactions_response_buffer(size_t capacity);
+
+// Send the first length bytes of the response buffer as the JSON reply
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_interactions_respond(size_t length);
+
+// One-off signature check (hex key and signature as sent by Discord)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_interactions_verify(const char* public_key, const char* signature,
+                            const char* timestamp, const char* body, size_t body_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_INTERACTIONS_H
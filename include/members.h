@@ -0,0 +1,141 @@
+#ifndef DISCORD_ASM_MEMBERS_H
+#define DISCORD_ASM_MEMBERS_H
+
+#include "abi.h"
+#include "structs.h"
+#include "opcodes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Guild member requests (op 8 REQUEST_GUILD_MEMBERS)
+// Each request gets a nonce and is answered by chunk_count
+// GUILD_MEMBERS_CHUNK dispatches of up to 1000 members each. The tracker
+// matches chunks to requests by nonce and streams every member object to
+// the request's sink as its chunk arrives, so nothing proportional to the
+// guild size is held; the completion callback runs once all chunks are in.
+// Sends go out of a token bucket sized below the gateway send limit, which
+// leaves room for heartbeats and presence updates on the same connection.
+//
+// The tracker is not thread-safe: request, poll and chunk handling belong
+// on the thread that reads the gateway.
+
+#define DISCORD_MEMBERS_MAX_PENDING       64      // Requests queued or in flight
+#define DISCORD_MEMBERS_NONCE_MAX         33      // Discord caps nonces at 32 bytes
+#define DISCORD_MEMBERS_MAX_USER_IDS      100     // user_ids per request
+#define DISCORD_MEMBERS_SENDS_PER_MINUTE  100     // Default share of DISCORD_GATEWAY_SEND_LIMIT
+#define DISCORD_MEMBERS_BURST             5       // Requests sent back to back
+#define DISCORD_MEMBERS_TIMEOUT_MS        30000   // Give up without a chunk for this long
+
+typedef struct discord_members discord_members_t;
+
+// One member object from a chunk (a view valid only during the call)
+typedef void (*discord_members_sink_t)(void* user, const char* guild_id,
+                                       const char* member, size_t member_length);
+
+typedef struct {
+    const char* guild_id;
+    const char* nonce;
+    discord_result_t result;        // DISCORD_OK or DISCORD_ERROR_TIMEOUT
+    uint64_t members;               // Member objects passed to the sink
+    uint64_t not_found;             // user_ids Discord could not resolve
+    uint32_t chunks;                // Chunks received
+    uint32_t chunk_count;           // Chunks announced
+    uint64_t queued_ns;             // Time spent waiting for the send budget
+    uint64_t elapsed_ns;            // request() to last chunk
+    size_t largest_chunk;           // Biggest chunk payload handled, in bytes
+} discord_members_result_t;
+
+typedef void (*discord_members_done_t)(void* user, const discord_members_result_t* result);
+
+// Transport for the op 8 payload; defaults to discord_ws_send on gateway
+typedef discord_result_t (*discord_members_send_t)(void* user, const char* data, size_t length);
+
+typedef struct {
+    discord_gateway_t* gateway;     // Connection the requests go out on
+    discord_members_send_t send;    // Overrides gateway when set
+    void* send_user;
+    uint32_t sends_per_minute;      // 0 = DISCORD_MEMBERS_SENDS_PER_MINUTE
+    uint32_t burst;                 // 0 = DISCORD_MEMBERS_BURST
+    uint32_t timeout_ms;            // 0 = DISCORD_MEMBERS_TIMEOUT_MS
+} discord_members_config_t;
+
+typedef struct {
+    const char* guild_id;
+    const char* query;              // Username prefix; NULL or "" with limit 0 = everyone
+    uint32_t limit;                 // 0 = no limit (needs GUILD_MEMBERS intent)
+    int presences;                  // Ask for presences too
+    const char* const* user_ids;    // Specific users instead of a query
+    size_t user_id_count;
+    discord_members_sink_t sink;
+    discord_members_done_t done;
+    void* user;                     // Passed to sink and done
+} discord_members_request_t;
+
+typedef struct {
+    uint64_t requests;              // Requests accepted
+    uint64_t sent;                  // op 8 payloads sent
+    uint64_t completed;
+    uint64_t timed_out;
+    uint64_t chunks;                // Chunks matched to a request
+    uint64_t unmatched;             // Chunks with an unknown or missing nonce
+    uint64_t members;
+    uint32_t queued;                // Waiting for send budget now
+    uint32_t in_flight;             // Sent, still receiving chunks
+} discord_members_stats_t;
+
+// Session-cache sink: appends { uint32 length, member JSON } records to
+// the snapshot's cache pages in order. Records never straddle pages: a
+// zero length ends a page and an empty page ends the data. Members that
+// do not fit a page, or arrive once the pages run out, are counted in
+// dropped.
+typedef struct {
+    discord_session_t* session;
+    uint32_t page;                  // Page being filled
+    size_t offset;                  // Write position within that page
+    uint64_t records;
+    uint64_t dropped;
+} discord_members_cache_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_members_create(const discord_members_config_t* config, discord_members_t** members);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_members_destroy(discord_members_t* members);
+
+// Queue an op 8 request and send it if the budget allows; the generated
+// nonce is copied to nonce_out when it is not NULL
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_members_request(discord_members_t* members, const discord_members_request_t* request,
+                        char nonce_out[DISCORD_MEMBERS_NONCE_MAX]);
+
+// Send queued requests the budget now allows and expire stalled ones;
+// wait_ms (optional) receives how long until the next queued send
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_members_poll(discord_members_t* members, uint64_t now_ms, uint32_t* wait_ms);
+
+// Feed the d payload of a GUILD_MEMBERS_CHUNK dispatch
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_members_handle_chunk(discord_members_t* members, const char* data, size_t length);
+
+// Route GUILD_MEMBERS_CHUNK dispatches to this tracker (one per process;
+// NULL detaches)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_members_attach(discord_members_t* members);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_members_get_stats(discord_members_t* members, discord_members_stats_t* stats);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_members_cache_init(discord_members_cache_t* cache, discord_session_t* session);
+
+// discord_members_sink_t writing into a discord_members_cache_t
+DISCORD_EXPORT void DISCORD_CALL
+discord_members_cache_sink(void* cache, const char* guild_id, const char* member, size_t member_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_MEMBERS_H
@@ -0,0 +1,94 @@
+#ifndef DISCORD_ASM_MODULE_H
+#define DISCORD_ASM_MODULE_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hot-reloadable handler modules
+// Handlers can live in a shared object instead of the binary that owns
+// the gateway connection. The module exports DISCORD_MODULE_ENTRY, which
+// returns its registration table; discord_module_load builds a dispatch
+// table from it and swaps it in atomically. The previous module is unloaded
+// once every handler call that was already running in it has returned, so
+// the connection, heartbeats and session are never touched by a deploy.
+//
+// Lookup order while a module is loaded: the module's handler for the
+// event type, a handler from discord_dispatch_on, the module's catch-all,
+// then discord_dispatch_set_handler's.
+//
+// Modules resolve the shim from the host, so the host must export its
+// symbols (-rdynamic, ENABLE_EXPORTS in CMake) rather than the module
+// linking its own copy. Handlers a module registers anywhere else
+// (discord_dispatch_on, a router) and threads or timers it starts must be
+// removed in fini: the code is unmapped right after.
+
+#define DISCORD_MODULE_ABI_VERSION  1
+#define DISCORD_MODULE_ENTRY        "discord_module_entry"
+#define DISCORD_MODULE_NAME_MAX     64
+#define DISCORD_MODULE_ERROR_MAX    256
+#define DISCORD_MODULE_DRAIN_MS     5000    // Longest wait for the old module's handlers
+
+typedef struct {
+    const char* event_type;
+    discord_event_handler_t handler;
+} discord_module_handler_t;
+
+typedef struct {
+    uint32_t abi_version;                   // DISCORD_MODULE_ABI_VERSION
+    const char* name;
+    const discord_module_handler_t* handlers;
+    size_t handler_count;
+    discord_event_handler_t catch_all;      // NULL = fall through to the host's
+    // Called before the module goes live, while the previous generation
+    // still runs; *state persists across reloads (NULL on the first load).
+    // Non-zero keeps the previous module.
+    int (*init)(void** state);
+    // Called once the module is no longer reachable. state is NULL when a
+    // newer generation replaced it (which already owns the state); after
+    // discord_module_unload it points at the state to release.
+    void (*fini)(void** state);
+} discord_module_t;
+
+typedef const discord_module_t* (*discord_module_entry_t)(void);
+
+// In the module: DISCORD_MODULE_EXPORT(&my_module)
+#define DISCORD_MODULE_EXPORT(table) \
+    DISCORD_EXPORT const discord_module_t* DISCORD_CALL discord_module_entry(void) { return (table); }
+
+typedef struct {
+    uint64_t generation;                    // Loads so far; 0 = none yet
+    uint64_t loads;
+    uint64_t failures;                      // Rejected modules (the previous one stayed)
+    uint64_t stranded;                      // Old modules left mapped after a drain timeout
+    uint64_t last_swap_ns;                  // Swap to old module drained
+    int loaded;
+    char name[DISCORD_MODULE_NAME_MAX];
+    char last_error[DISCORD_MODULE_ERROR_MAX];  // Why the last rejected load failed (dlerror text...), "" if none
+} discord_module_stats_t;
+
+// Load path (replacing the current module). The file is copied first, so
+// a rebuilt module at the same path loads as a new object.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_module_load(const char* path);
+
+// Back to the handlers registered with discord_dispatch_on
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_module_unload(void);
+
+// Reload path whenever it is replaced (checked every interval_ms, 0 = 1000)
+// on a background thread; NULL stops watching
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_module_watch(const char* path, uint32_t interval_ms);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_module_get_stats(discord_module_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_MODULE_H
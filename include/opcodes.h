@@ -16,6 +16,21 @@
 #define DISCORD_OP_HELLO           10   // Receive: Hello
 #define DISCORD_OP_HEARTBEAT_ACK   11   // Receive: Heartbeat ACK
 
+// Voice Gateway Opcodes (voice WebSocket, version 8)
+#define DISCORD_VOICE_OP_IDENTIFY            0   // Send: Begin a voice session
+#define DISCORD_VOICE_OP_SELECT_PROTOCOL     1   // Send: UDP address and encryption mode
+#define DISCORD_VOICE_OP_READY               2   // Receive: SSRC, UDP endpoint, modes
+#define DISCORD_VOICE_OP_HEARTBEAT           3   // Send: Heartbeat
+#define DISCORD_VOICE_OP_SESSION_DESCRIPTION 4   // Receive: Secret key
+#define DISCORD_VOICE_OP_SPEAKING            5   // Send/Receive: Speaking flags
+#define DISCORD_VOICE_OP_HEARTBEAT_ACK       6   // Receive: Heartbeat ACK
+#define DISCORD_VOICE_OP_RESUME              7   // Send: Resume
+#define DISCORD_VOICE_OP_HELLO               8   // Receive: Heartbeat interval
+#define DISCORD_VOICE_OP_RESUMED             9   // Receive: Resume acknowledged
+#define DISCORD_VOICE_OP_CLIENT_DISCONNECT  13   // Receive: A user left
+
+#define DISCORD_VOICE_GATEWAY_VERSION        8
+
 // Close Codes
 #define DISCORD_CLOSE_NORMAL        1000  // Normal closure
 #define DISCORD_CLOSE_UNKNOWN_ERROR 4000  // Unknown error
@@ -36,6 +51,10 @@
 // Default Gateway version
 #define DISCORD_GATEWAY_VERSION     10
 
+// Gateway send limit (per connection; exceeding it closes with 4008)
+#define DISCORD_GATEWAY_SEND_LIMIT      120
+#define DISCORD_GATEWAY_SEND_WINDOW_MS  60000
+
 // Default intents for basic bot functionality
 #define DISCORD_INTENT_GUILDS                    (1 << 0)
 #define DISCORD_INTENT_GUILD_MEMBERS             (1 << 1)
@@ -0,0 +1,122 @@
+#ifndef DISCORD_ASM_QOS_H
+#define DISCORD_ASM_QOS_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Dispatch QoS
+// With a scheduler attached, discord_dispatch_frame no longer runs the
+// handler inline: each DISPATCH event is copied into the queue of its
+// priority class and the gateway loop drains frames the socket already
+// has before running handlers earliest-deadline-first. An event's deadline
+// is its arrival time plus its class budget, so an INTERACTION_CREATE
+// (3 s to ACK) overtakes a backlog of presence updates.
+//
+// Once a class holds high_water events its policy applies: shed the
+// oldest or the newest event, or coalesce (replace the queued event with
+// the same key, e.g. keep only the latest presence per user, shedding the
+// oldest when no such event is queued). Classes that shed also drop events
+// whose deadline passed before they were reached; KEEP classes dispatch
+// them late. Events without a type (HELLO, ACK, ...) are never queued.
+//
+// Single-threaded: offer, poll and run belong on the gateway thread.
+
+#define DISCORD_QOS_TYPE_TABLE_SIZE  64      // Classified event types (power of two)
+#define DISCORD_QOS_KEY_MAX          32      // Coalesce key path ("user.id")
+#define DISCORD_QOS_BATCH            32      // Events run per discord_qos_poll
+#define DISCORD_QOS_DRAIN_MAX        256     // Frames pulled before a batch must run
+
+typedef struct discord_qos discord_qos_t;
+
+typedef enum {
+    DISCORD_QOS_CRITICAL = 0,       // INTERACTION_CREATE
+    DISCORD_QOS_HIGH,               // User-visible traffic
+    DISCORD_QOS_NORMAL,             // Unclassified event types
+    DISCORD_QOS_LOW,                // PRESENCE_UPDATE, TYPING_START
+    DISCORD_QOS_CLASS_COUNT
+} discord_qos_class_t;
+
+typedef enum {
+    DISCORD_QOS_KEEP = 0,           // Never drop
+    DISCORD_QOS_SHED_OLDEST,
+    DISCORD_QOS_SHED_NEWEST,
+    DISCORD_QOS_COALESCE
+} discord_qos_policy_t;
+
+typedef struct {
+    uint32_t deadline_ms;           // Budget from arrival to handler
+    uint32_t high_water;            // Queue depth where the policy kicks in
+    discord_qos_policy_t policy;
+} discord_qos_class_config_t;
+
+typedef struct {
+    uint64_t enqueued;
+    uint64_t dispatched;
+    uint64_t shed;                  // Dropped by policy or expiry
+    uint64_t coalesced;             // Replaced by a newer event with the same key
+    uint64_t late;                  // Dispatched after their deadline
+    uint64_t max_wait_ns;           // Longest arrival-to-handler time
+    uint32_t depth;                 // Queued now
+    uint32_t max_depth;
+} discord_qos_class_stats_t;
+
+typedef struct {
+    discord_qos_class_stats_t classes[DISCORD_QOS_CLASS_COUNT];
+} discord_qos_stats_t;
+
+// Defaults: CRITICAL 250 ms, HIGH 1 s, NORMAL 5 s (all KEEP); LOW 10 s,
+// coalescing at 1024. INTERACTION_CREATE is CRITICAL, PRESENCE_UPDATE
+// (by user.id) and TYPING_START (by user_id) are LOW, the rest NORMAL.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_qos_create(discord_qos_t** qos);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_qos_destroy(discord_qos_t* qos);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_qos_set_class(discord_qos_t* qos, discord_qos_class_t cls, const discord_qos_class_config_t* config);
+
+// Put event_type in a class; coalesce_key is a top-level key of d or
+// "object.key" one level down (NULL = events are never merged)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_qos_classify(discord_qos_t* qos, const char* event_type, discord_qos_class_t cls,
+                     const char* coalesce_key);
+
+// Route dispatch through this scheduler (one per process; NULL detaches
+// and dispatches whatever is still queued)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_qos_attach(discord_qos_t* qos);
+
+// Called by discord_dispatch_frame: 1 if the attached scheduler took the
+// event, 0 to dispatch it inline
+DISCORD_EXPORT int DISCORD_CALL
+discord_qos_offer(const discord_event_t* event);
+
+// Events queued in the attached scheduler (0 when none is attached); the
+// gateway loop stops blocking in receive while this is non-zero
+DISCORD_EXPORT uint32_t DISCORD_CALL
+discord_qos_pending(void);
+
+// Gateway loop hook after each receive: idle is non-zero when no frame was
+// ready. Runs a batch when the socket is drained or DISCORD_QOS_DRAIN_MAX
+// frames came in since the last one.
+DISCORD_EXPORT void DISCORD_CALL
+discord_qos_poll(int idle);
+
+// Dispatch up to max_events queued events in deadline order; returns the
+// number of handlers run
+DISCORD_EXPORT uint32_t DISCORD_CALL
+discord_qos_run(discord_qos_t* qos, uint32_t max_events);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_qos_get_stats(discord_qos_t* qos, discord_qos_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_QOS_H
@@ -0,0 +1,132 @@
+#ifndef DISCORD_ASM_REST_H
+#define DISCORD_ASM_REST_H
+
+#include "abi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// REST attachment uploads
+// discord_rest_upload queues a message with files for
+// POST /channels/{channel_id}/messages and returns at once. A fixed set of
+// connection threads, each with one keep-alive connection and one pooled
+// buffer of chunk_size bytes, send the queued uploads. The multipart body
+// is never built in memory. Its boundaries and part headers are written
+// through the pooled buffer, and file contents go from the file descriptor
+// to the socket:
+//   - with sendfile (regular files) or splice (pipes) on http:// and on
+//     https:// connections whose TLS records are encrypted by the kernel
+//     (kTLS);
+//   - otherwise with pread/read into the pooled buffer and a write per
+//     chunk.
+// An upload therefore holds its pooled buffer while it is sent, plus a
+// copy of its payload_json and file table while it is queued, whatever
+// the size of its files.
+//
+// Uploads pass the REST rate limiter before they are sent. It keeps one
+// bucket per channel, filled from the X-RateLimit-* headers of each
+// response, and sends one request at a time to a channel whose limits
+// are not known yet. It also keeps a global budget of global_per_second
+// requests. A 429 response puts the upload back at the head of the queue
+// until its Retry-After has passed. A request sent again reads regular
+// files from their offset again, so files must stay open (and unchanged)
+// until the callback. Uploads with a pipe are sent only once.
+//
+// POSIX only: on Windows the calls return DISCORD_ERROR_UNSUPPORTED and
+// nothing is sent.
+
+#define DISCORD_REST_API_URL            "https://discord.com/api/v10"
+#define DISCORD_REST_CONNECTIONS        4
+#define DISCORD_REST_CHUNK_SIZE         (64 * 1024)
+#define DISCORD_REST_CHUNK_MIN          (16 * 1024)     // Also the longest response header block
+#define DISCORD_REST_GLOBAL_PER_SECOND  50
+#define DISCORD_REST_MAX_FILES          10
+#define DISCORD_REST_MAX_ATTEMPTS       5               // Requests per upload, 429s included
+#define DISCORD_REST_TIMEOUT_S          30              // Connect, send and receive
+
+typedef struct discord_rest discord_rest_t;
+
+typedef struct {
+    const char* token;              // Bot token, without "Bot "
+    const char* api_url;            // NULL = DISCORD_REST_API_URL
+    uint32_t connections;           // Uploads in flight; 0 = DISCORD_REST_CONNECTIONS
+    uint32_t chunk_size;            // Pooled buffer per connection; 0 = DISCORD_REST_CHUNK_SIZE
+    uint32_t global_per_second;     // 0 = DISCORD_REST_GLOBAL_PER_SECOND
+    int skip_verify;                // Skip TLS certificate verification (tests only)
+    int copy_only;                  // Never sendfile or splice
+} discord_rest_config_t;
+
+typedef struct {
+    const char* filename;           // Copied
+    const char* content_type;       // Copied; NULL = application/octet-stream
+    int fd;                         // Regular file or pipe; stays open until the callback
+    uint64_t offset;                // Regular files: where the contents start
+    uint64_t length;                // 0 = to the end of a regular file; required for pipes
+} discord_rest_file_t;
+
+typedef struct {
+    discord_result_t result;        // DISCORD_OK for any 2xx; DISCORD_ERROR_TIMEOUT when still rate limited
+    int status;                     // HTTP status of the last attempt, 0 = none
+    const char* body;               // Response body (truncated to chunk_size), valid during the callback
+    size_t body_length;
+    uint32_t attempts;
+    uint64_t bytes_sent;            // Last attempt, headers included
+    uint64_t zero_copy_bytes;       // Last attempt, file bytes sent by sendfile or splice
+    uint64_t queued_ns;             // From discord_rest_upload to the first attempt
+    uint64_t total_ns;              // From discord_rest_upload to the callback
+} discord_rest_response_t;
+
+// Runs on a connection thread
+typedef void (*discord_rest_callback_t)(const discord_rest_response_t* response, void* user);
+
+typedef struct {
+    uint64_t channel_id;
+    const char* payload_json;       // Copied; NULL = "{}"
+    const discord_rest_file_t* files;
+    uint32_t file_count;            // Up to DISCORD_REST_MAX_FILES
+    discord_rest_callback_t callback;
+    void* user;
+} discord_rest_upload_t;
+
+typedef struct {
+    uint64_t uploads;               // Accepted by discord_rest_upload
+    uint64_t completed;             // Callbacks with DISCORD_OK
+    uint64_t failed;
+    uint64_t requests;              // Attempts sent
+    uint64_t rate_limited;          // 429 responses
+    uint64_t limiter_waits;         // Times a connection waited for a bucket or the global budget
+    uint64_t bytes_sent;
+    uint64_t zero_copy_bytes;       // File bytes sent by sendfile or splice
+    uint64_t copied_bytes;          // File bytes read into pooled buffers
+    uint64_t connections_opened;
+    uint32_t ktls_connections;      // Open now, TLS records encrypted by the kernel
+    uint32_t queued;                // Waiting now
+    uint32_t in_flight;             // Being sent now
+    uint32_t buckets;
+} discord_rest_stats_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_rest_create(const discord_rest_config_t* config, discord_rest_t** rest);
+
+// Validate and queue an upload; lengths of 0 are resolved with fstat here
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_rest_upload(discord_rest_t* rest, const discord_rest_upload_t* upload);
+
+// Wait up to timeout_ms (-1 = forever) until nothing is queued or in flight
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_rest_flush(discord_rest_t* rest, int timeout_ms);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_rest_get_stats(discord_rest_t* rest, discord_rest_stats_t* stats);
+
+// Finish the uploads in flight; queued ones get DISCORD_ERROR_NETWORK
+// callbacks without being sent
+DISCORD_EXPORT void DISCORD_CALL
+discord_rest_destroy(discord_rest_t* rest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_REST_H
@@ -0,0 +1,106 @@
+#ifndef DISCORD_ASM_ROUTER_H
+#define DISCORD_ASM_ROUTER_H
+
+#include "abi.h"
+#include "structs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Command router for MESSAGE_CREATE content
+// Command names and aliases are registered at startup and compiled into a
+// trie flattened to a transition table over byte classes, so matching a
+// message costs one table step per byte of the command name no matter how
+// many commands exist. Content that does not start with a prefix byte is
+// rejected after one lookup.
+//
+// Arguments are views into the frame: whitespace separated, double quotes
+// group words (the quotes are not part of the view), JSON escapes are left
+// as they are. Everything is valid only for the duration of the handler.
+//
+// discord_command_t has a fixed layout so handlers can be written in
+// assembly as well as C (all fields are pointer or 32/64-bit sized).
+
+#define DISCORD_ROUTER_NAME_MAX      32      // Longest command name or alias
+#define DISCORD_ROUTER_PREFIX_MAX    16      // Longest prefix
+#define DISCORD_ROUTER_MAX_PREFIXES  4
+#define DISCORD_ROUTER_MAX_ARGS      16      // Further words stay in rest only
+
+typedef struct discord_router discord_router_t;
+
+typedef struct {
+    const char* data;
+    size_t length;
+} discord_arg_t;
+
+typedef struct {
+    const discord_event_t* event;   // MESSAGE_CREATE (NULL via discord_router_route without one)
+    const char* name;               // Canonical command name, NUL-terminated
+    uint32_t command_id;            // Order of registration
+    uint32_t argc;
+    const char* content;            // Whole message content (raw JSON string body)
+    size_t content_length;
+    const char* rest;               // Content after the command name, trimmed
+    size_t rest_length;
+    void* user;                     // From discord_router_add
+    discord_arg_t argv[DISCORD_ROUTER_MAX_ARGS];
+} discord_command_t;
+
+typedef void (*discord_command_handler_t)(const discord_command_t* command);
+
+typedef struct {
+    const char* const* prefixes;    // e.g. { "!", "<@1234567890> " }
+    size_t prefix_count;
+    int case_insensitive;           // Fold ASCII case in command names
+    discord_event_handler_t fallback; // MESSAGE_CREATE events that are not commands
+} discord_router_config_t;
+
+typedef struct {
+    uint64_t messages;              // Contents routed
+    uint64_t rejected;              // Failed the prefix check
+    uint64_t unknown;               // Prefix matched, no such command
+    uint64_t dispatched;            // Command handlers run
+    uint32_t commands;
+    uint32_t names;                 // Commands plus aliases
+    uint32_t states;                // Trie nodes after compile
+    uint32_t classes;               // Byte classes in the transition table
+    size_t table_bytes;
+} discord_router_stats_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_router_create(const discord_router_config_t* config, discord_router_t** router);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_router_destroy(discord_router_t* router);
+
+// Register a command; command_id (optional) receives its id
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_router_add(discord_router_t* router, const char* name, discord_command_handler_t handler,
+                   void* user, uint32_t* command_id);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_router_alias(discord_router_t* router, const char* alias, const char* name);
+
+// Build the matching tables; required after the last add/alias
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_router_compile(discord_router_t* router);
+
+// Match content and run the handler: DISCORD_OK when a command ran,
+// DISCORD_ERROR_NOT_FOUND when the content is not a command
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_router_route(discord_router_t* router, const char* content, size_t length,
+                     const discord_event_t* event);
+
+// Handle MESSAGE_CREATE through this router (one per process; NULL detaches)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_router_attach(discord_router_t* router);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_router_get_stats(discord_router_t* router, discord_router_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_ROUTER_H
@@ -0,0 +1,138 @@
+#ifndef DISCORD_ASM_SHARD_H
+#define DISCORD_ASM_SHARD_H
+
+#include "abi.h"
+#include "opcodes.h"
+#include "connect.h"
+#include "coord.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Gateway shards
+// A discord_shard_t is one gateway connection driven by discord_shard_poll:
+// HELLO, IDENTIFY (in a slot reserved from a shared identify limiter) or RESUME, heartbeats
+// with ACK tracking, and reconnects. A heartbeat falling due while the
+// previous one is unacknowledged marks the connection as a zombie; it is
+// closed and resumed. Lost connections reconnect after an exponential
+// backoff with jitter; op 7 (RECONNECT) resumes at once and op 9
+// (INVALID_SESSION) identifies again after 1-5 seconds.
+//
+// With a coordinator (coord.h), IDENTIFY slots are reserved host-wide
+// and READY is reported back; a shard the coordinator no longer gives
+// this process waits until it is destroyed, and one that cannot reach the
+// coordinator identifies without it.
+//
+// With prewarm set, a ready shard keeps a standby connection (connect.h)
+// to its resume URL, replaced every DISCORD_SHARD_STANDBY_REFRESH_MS, and
+// resumes on it after op 7 or a lost connection.
+//
+// Every timer reads discord_time_now_ms, so shards run unchanged on the
+// simulator's virtual clock (see sim.h). A shard belongs to one thread;
+// the identify limiter may be shared by shards on any thread.
+
+#define DISCORD_IDENTIFY_WINDOW_MS          5000    // One IDENTIFY per bucket per window
+#define DISCORD_SHARD_BACKOFF_BASE_MS       1000
+#define DISCORD_SHARD_BACKOFF_MAX_MS        60000
+#define DISCORD_SHARD_HELLO_TIMEOUT_MS      20000   // Reconnect when HELLO never comes
+#define DISCORD_SHARD_STANDBY_REFRESH_MS    25000   // Within DISCORD_WS_STANDBY_MAX_AGE_MS
+
+typedef struct discord_shard discord_shard_t;
+typedef struct discord_identify_limiter discord_identify_limiter_t;
+
+typedef enum {
+    DISCORD_SHARD_DISCONNECTED = 0, // Waiting out the reconnect backoff
+    DISCORD_SHARD_WAITING_HELLO,    // Connected, HELLO not seen yet
+    DISCORD_SHARD_IDENTIFY_QUEUED,  // Waiting for the identify bucket
+    DISCORD_SHARD_IDENTIFYING,      // IDENTIFY sent, waiting for READY
+    DISCORD_SHARD_RESUMING,         // RESUME sent, waiting for RESUMED
+    DISCORD_SHARD_READY
+} discord_shard_state_t;
+
+// Called for every gateway frame after the shard has handled it
+typedef void (*discord_shard_frame_callback_t)(void* user, discord_shard_t* shard,
+                                               const char* data, size_t length);
+
+typedef struct {
+    const char* token;
+    const char* url;                // wss://gateway.discord.gg/?v=10&encoding=json
+    int shard_id;
+    int shard_count;                // 0 = unsharded (no "shard" in IDENTIFY)
+    const discord_ws_options_t* ws; // Transport; NULL = default
+    discord_identify_limiter_t* limiter; // Shared by all shards of the bot; NULL = no limit
+    uint32_t backoff_base_ms;       // 0 = DISCORD_SHARD_BACKOFF_BASE_MS
+    uint32_t backoff_max_ms;        // 0 = DISCORD_SHARD_BACKOFF_MAX_MS
+    uint32_t seed;                  // Jitter; 0 = derived from shard_id
+    discord_shard_frame_callback_t on_frame;
+    void* user;
+    int prewarm;                    // Keep a standby connection to the resume URL
+    discord_coord_t* coord;         // Take IDENTIFY slots from a coordinator (coord.h) instead of limiter
+} discord_shard_config_t;
+
+typedef struct {
+    discord_shard_state_t state;
+    int sequence;                   // Last dispatch sequence, -1 = none
+    uint64_t connects;
+    uint64_t connect_failures;      // Connect or HELLO timeout
+    uint64_t disconnects;           // Connections lost or dropped by the shard
+    uint64_t identifies;
+    uint64_t identify_waits;        // IDENTIFY deferred to a later limiter slot
+    uint64_t resumes;
+    uint64_t readies;               // READY or RESUMED received
+    uint64_t heartbeats;
+    uint64_t heartbeat_acks;
+    uint64_t zombies;               // Heartbeat due with the previous one unacknowledged
+    uint64_t reconnects_requested;  // op 7
+    uint64_t invalid_sessions;      // op 9
+    uint64_t dispatches;
+    uint32_t latency_ms;            // Last heartbeat to ACK
+    uint64_t first_ready_ms;        // discord_time_now_ms at the first READY, 0 = never
+    uint64_t standbys_used;         // Connections that started from a standby
+    discord_connect_timing_t last_connect; // Phases of the last connect that reached READY or RESUMED
+} discord_shard_stats_t;
+
+// max_concurrency from GET /gateway/bot: shard_id % max_concurrency picks
+// the bucket, each bucket allows one IDENTIFY per DISCORD_IDENTIFY_WINDOW_MS
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_identify_limiter_create(uint32_t max_concurrency, discord_identify_limiter_t** limiter);
+
+// DISCORD_OK: IDENTIFY now. DISCORD_ERROR_TIMEOUT: the bucket's next free
+// slot, *retry_at_ms, is reserved for the caller; IDENTIFY then without
+// acquiring again
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_identify_limiter_acquire(discord_identify_limiter_t* limiter, int shard_id,
+                                 uint64_t now_ms, uint64_t* retry_at_ms);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_identify_limiter_destroy(discord_identify_limiter_t* limiter);
+
+// The shard copies the strings; the first poll connects
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_shard_create(const discord_shard_config_t* config, discord_shard_t** shard);
+
+// Run due timers and handle frames. Waits up to timeout_ms for the first
+// frame (never past the next timer), then drains what is queued. Network
+// errors are handled by reconnecting, not returned.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_shard_poll(discord_shard_t* shard, int timeout_ms);
+
+// discord_time_now_ms at which the next timer fires, UINT64_MAX if none
+DISCORD_EXPORT uint64_t DISCORD_CALL
+discord_shard_next_deadline(const discord_shard_t* shard);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_shard_send(discord_shard_t* shard, const char* data, size_t length);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_shard_get_stats(const discord_shard_t* shard, discord_shard_stats_t* stats);
+
+// Closes the connection
+DISCORD_EXPORT void DISCORD_CALL
+discord_shard_destroy(discord_shard_t* shard);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_SHARD_H
@@ -0,0 +1,92 @@
+#ifndef DISCORD_ASM_SIM_H
+#define DISCORD_ASM_SIM_H
+
+#include "abi.h"
+#include "shard.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Gateway simulation
+// A discord_sim_t is a virtual clock plus an in-memory gateway. Creating
+// one installs the clock (discord_set_clock) and makes it the peer of every
+// connection opened with DISCORD_WS_TRANSPORT_SIM (or DISCORD_WS_TRANSPORT=sim
+// for the assembly core); destroying it restores the system clock.
+//
+// The simulated gateway sends HELLO on connect, answers heartbeats with
+// ACKs (some dropped on purpose), checks each IDENTIFY against its
+// max_concurrency bucket (one per DISCORD_IDENTIFY_WINDOW_MS, op 9 when
+// exceeded) before sending READY, answers RESUME with RESUMED, and can
+// send op 7 and a steady stream of dispatches. Every frame takes
+// latency_ms each way, and a new connection handshake_ms before HELLO.
+//
+// Time only moves inside discord_sim_run, discord_sim_advance, a
+// discord_ws_receive with a timeout on a simulated connection, or
+// discord_sleep_ms, each of which jumps straight to the next event. One
+// simulation exists at a time and everything touching it runs on one
+// thread. Virtual time starts at 0.
+
+#define DISCORD_SIM_HEARTBEAT_INTERVAL_MS 41250
+
+typedef struct discord_sim discord_sim_t;
+
+typedef struct {
+    uint32_t heartbeat_interval_ms; // Sent in HELLO; 0 = DISCORD_SIM_HEARTBEAT_INTERVAL_MS
+    uint32_t latency_ms;            // One way
+    uint32_t max_concurrency;       // Identify buckets the gateway enforces; 0 = 1
+    uint32_t ack_loss_permille;     // Heartbeat ACKs dropped
+    uint32_t reconnect_permille;    // Heartbeats on a ready session answered with op 7 as well
+    uint32_t resume_reject_permille; // RESUMEs answered with op 9 (not resumable)
+    uint32_t dispatch_interval_ms;  // MESSAGE_CREATE to every ready session; 0 = none
+    uint32_t seed;                  // Gateway randomness; 0 = 1
+    uint32_t handshake_ms;          // TCP, TLS and upgrade: HELLO leaves this long after connect
+} discord_sim_config_t;
+
+typedef struct {
+    uint64_t now_ms;                // Virtual time
+    uint64_t events;                // Simulation events processed
+    uint32_t connections;           // Open simulated sockets
+    uint32_t sessions_ready;        // Of those, past READY or RESUMED
+    uint64_t connects;
+    uint64_t identifies;
+    uint64_t identify_rejected;     // IDENTIFY in a bucket used within the window
+    uint64_t resumes;
+    uint64_t resume_rejected;
+    uint64_t heartbeats;
+    uint64_t acks_dropped;
+    uint64_t reconnects_sent;       // op 7
+    uint64_t dispatches_sent;
+    uint64_t frames_delivered;      // Gateway to client
+} discord_sim_stats_t;
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_sim_create(const discord_sim_config_t* config, discord_sim_t** sim);
+
+// Connections still open are cut off: their next receive fails
+DISCORD_EXPORT void DISCORD_CALL
+discord_sim_destroy(discord_sim_t* sim);
+
+DISCORD_EXPORT uint64_t DISCORD_CALL
+discord_sim_now_ms(const discord_sim_t* sim);
+
+// Advance virtual time by duration_ms, polling each shard (with a zero
+// timeout) whenever a frame reaches it or its next timer is due. Shards
+// should use DISCORD_WS_TRANSPORT_SIM.
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_sim_run(discord_sim_t* sim, discord_shard_t** shards, uint32_t shard_count,
+                uint64_t duration_ms);
+
+// Advance virtual time by duration_ms running only the gateway side, for
+// code that drives its own connections
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_sim_advance(discord_sim_t* sim, uint64_t duration_ms);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_sim_get_stats(const discord_sim_t* sim, discord_sim_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_SIM_H
@@ -21,18 +21,8 @@ typedef enum {
     DISCORD_STATE_ERROR
 } discord_gateway_state_t;
 
-// Gateway context structure (opaque to Assembly)
-struct discord_gateway {
-    void* ws_context;               // WebSocket context (libwebsockets)
-    discord_gateway_state_t state;  // Current connection state
-    int heartbeat_interval;         // Heartbeat interval in ms
-    uint64_t last_heartbeat;        // Last heartbeat timestamp
-    uint64_t last_heartbeat_ack;    // Last heartbeat ACK timestamp
-    int sequence;                   // Last sequence number
-    char* session_id;               // Session ID for resume
-    char* resume_gateway_url;       // Gateway URL for resume
-    int should_reconnect;           // Flag to indicate reconnection needed
-};
+// Gateway context structure (discord_gateway_t) is opaque to Assembly;
+// the C shim defines it in cshim/include/internal.h.
 
 // Assembly-facing event structure
 typedef struct {
@@ -0,0 +1,98 @@
+#ifndef DISCORD_ASM_TRACE_H
+#define DISCORD_ASM_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "abi.h"
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event tracing
+// Spans are recorded into a per-thread ring (single writer, no locks) with
+// raw timestamp-counter values and exported as Chrome/Perfetto trace JSON.
+// Tracing is compiled in but off by default; while off, each trace point
+// costs one predictable branch on discord_trace_enabled.
+// Assembly uses the TRACE_BEGIN/TRACE_END macros from asm/x64/trace.inc.
+
+// Pipeline stages (must match trace.inc)
+typedef enum {
+    DISCORD_TRACE_WS_SERVICE = 0,       // lws_service() inside discord_ws_receive
+    DISCORD_TRACE_WS_COPY,              // Frame copies in the WebSocket layer
+    DISCORD_TRACE_JSON_PARSE,           // JSON field extraction in the shim
+    DISCORD_TRACE_PROCESS_MESSAGE,      // process_message in the gateway core
+    DISCORD_TRACE_HANDLER,              // User event handlers
+    DISCORD_TRACE_WS_SEND,              // discord_ws_send
+    DISCORD_TRACE_STAGE_COUNT
+} discord_trace_stage_t;
+
+#define DISCORD_TRACE_RING_SIZE 65536   // Spans kept per thread (power of two)
+
+// Runtime switch; read directly by the macros below and by trace.inc
+extern volatile int discord_trace_enabled;
+
+// The first enable calibrates the timestamp counter against the monotonic
+// clock (about 10ms), so later dumps convert spans without waiting
+DISCORD_EXPORT void DISCORD_CALL
+discord_trace_enable(int enabled);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_trace_record_since(uint32_t stage, uint64_t start_tsc, uint32_t arg);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_trace_dump(const char* path);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_trace_reset(void);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_trace_install_signal(int signum, const char* path);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_trace_poll(void);
+
+DISCORD_EXPORT uint64_t DISCORD_CALL
+discord_trace_span_count(void);
+
+// Raw timestamp counter (rdtsc on x86-64, cntvct_el0 on AArch64)
+static inline uint64_t discord_trace_tsc(void) {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return discord_time_now_ms() * 1000000ull;
+#endif
+}
+
+#if defined(__GNUC__)
+    #define DISCORD_TRACE_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+    #define DISCORD_TRACE_UNLIKELY(x) (x)
+#endif
+
+// Start a span: DISCORD_TRACE_BEGIN(t0); ... DISCORD_TRACE_END(t0, stage, arg);
+#define DISCORD_TRACE_BEGIN(var) \
+    uint64_t var = DISCORD_TRACE_UNLIKELY(discord_trace_enabled) ? discord_trace_tsc() : 0
+
+#define DISCORD_TRACE_END(var, stage, arg) \
+    do { \
+        if (DISCORD_TRACE_UNLIKELY(var)) { \
+            discord_trace_record_since((stage), (var), (uint32_t)(arg)); \
+        } \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_TRACE_H
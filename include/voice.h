@@ -0,0 +1,143 @@
+#ifndef DISCORD_ASM_VOICE_H
+#define DISCORD_ASM_VOICE_H
+
+#include "abi.h"
+#include "opcodes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Voice connections and the RTP sender
+// A discord_voice_t is one voice channel session: it runs the voice
+// WebSocket handshake (HELLO, IDENTIFY, READY, IP discovery,
+// SELECT_PROTOCOL, SESSION_DESCRIPTION) and holds a queue of pre-encoded
+// 20 ms Opus frames. A discord_voice_sender_t owns one UDP socket and one
+// pacing thread for any number of voice connections: every 20 ms it takes
+// the next frame of each stream, builds and encrypts the RTP packet
+// (aead_aes256_gcm_rtpsize) and sends the whole tick with sendmmsg.
+//
+// Frames are queued from any single producer thread per connection; the
+// handshake (discord_voice_handle/poll) belongs on the thread reading the
+// voice WebSocket.
+
+#define DISCORD_VOICE_FRAME_MS          20
+#define DISCORD_VOICE_FRAME_SAMPLES     960     // 48 kHz * 20 ms
+#define DISCORD_VOICE_FRAME_MAX         1275    // Largest Opus packet
+#define DISCORD_VOICE_QUEUE_FRAMES      32      // Default queue (640 ms)
+#define DISCORD_VOICE_MAX_STREAMS       256     // Connections per sender
+#define DISCORD_VOICE_BATCH             64      // Packets per sendmmsg
+#define DISCORD_VOICE_SILENCE_FRAMES    5       // Sent when a stream runs dry
+#define DISCORD_VOICE_DISCOVERY_TIMEOUT_MS 1000
+#define DISCORD_VOICE_MODE              "aead_aes256_gcm_rtpsize"
+
+typedef struct discord_voice discord_voice_t;
+typedef struct discord_voice_sender discord_voice_sender_t;
+
+typedef enum {
+    DISCORD_VOICE_CONNECTING = 0,   // Waiting for HELLO / READY
+    DISCORD_VOICE_SELECTING,        // SELECT_PROTOCOL sent, waiting for the key
+    DISCORD_VOICE_READY,            // Sending audio
+    DISCORD_VOICE_FAILED
+} discord_voice_state_t;
+
+// Transport for voice gateway payloads; defaults to discord_ws_send on gateway
+typedef discord_result_t (*discord_voice_send_t)(void* user, const char* data, size_t length);
+
+typedef struct {
+    discord_voice_sender_t* sender; // UDP socket and pacing (required)
+    discord_gateway_t* gateway;     // Voice WebSocket (wss://<endpoint>/?v=8)
+    discord_voice_send_t send;      // Overrides gateway when set
+    void* send_user;
+    const char* server_id;          // Guild id
+    const char* user_id;            // Bot user id
+    const char* session_id;         // From VOICE_STATE_UPDATE
+    const char* token;              // From VOICE_SERVER_UPDATE
+    uint32_t queue_frames;          // 0 = DISCORD_VOICE_QUEUE_FRAMES (rounded up to a power of two)
+} discord_voice_config_t;
+
+typedef struct {
+    discord_voice_state_t state;
+    uint32_t ssrc;
+    uint64_t frames_sent;
+    uint64_t silence_sent;          // Silence frames after the queue ran dry
+    uint64_t dropped;               // discord_voice_enqueue on a full queue
+    uint64_t underruns;             // Times the queue ran dry while speaking
+    uint64_t bytes_sent;            // UDP payload bytes
+    uint64_t heartbeats;
+    uint64_t heartbeat_acks;
+} discord_voice_stats_t;
+
+typedef struct {
+    uint32_t streams;               // Connections attached
+    uint64_t ticks;
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t syscalls;              // sendmmsg (or sendmsg) calls
+    uint64_t send_errors;
+    uint64_t late_ticks;            // Woke more than 1 ms after the deadline
+    uint64_t skipped_ticks;         // Deadlines dropped after a stall
+    uint64_t max_late_ns;
+} discord_voice_sender_stats_t;
+
+// Main gateway op 4 payload to join (channel_id) or leave (NULL) a channel;
+// free with discord_json_free
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_create_state_update(const char* guild_id, const char* channel_id,
+                                  int self_mute, int self_deaf, char** json_out);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_sender_create(discord_voice_sender_t** sender);
+
+// Destroy after every connection using the sender is destroyed
+DISCORD_EXPORT void DISCORD_CALL
+discord_voice_sender_destroy(discord_voice_sender_t* sender);
+
+// Start/stop the pacing thread (absolute-deadline sleep, then a short spin)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_sender_start(discord_voice_sender_t* sender);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_voice_sender_stop(discord_voice_sender_t* sender);
+
+// One 20 ms tick by hand (without the thread); returns packets sent
+DISCORD_EXPORT uint32_t DISCORD_CALL
+discord_voice_sender_tick(discord_voice_sender_t* sender);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_sender_get_stats(discord_voice_sender_t* sender, discord_voice_sender_stats_t* stats);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_create(const discord_voice_config_t* config, discord_voice_t** voice);
+
+// Connect to a VOICE_SERVER_UPDATE endpoint and run the handshake to READY
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_connect(const char* endpoint, const discord_voice_config_t* config,
+                      int timeout_ms, discord_voice_t** voice);
+
+// Feed a voice gateway frame (IP discovery runs inside, on READY)
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_handle(discord_voice_t* voice, const char* data, size_t length);
+
+// Heartbeats; call at least every few hundred milliseconds
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_poll(discord_voice_t* voice, uint64_t now_ms);
+
+// Copy one Opus frame into the queue; DISCORD_ERROR_MEMORY when full
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_enqueue(discord_voice_t* voice, const void* opus, size_t length);
+
+DISCORD_EXPORT uint32_t DISCORD_CALL
+discord_voice_queued(discord_voice_t* voice);
+
+DISCORD_EXPORT discord_result_t DISCORD_CALL
+discord_voice_get_stats(discord_voice_t* voice, discord_voice_stats_t* stats);
+
+DISCORD_EXPORT void DISCORD_CALL
+discord_voice_destroy(discord_voice_t* voice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISCORD_ASM_VOICE_H
@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include "abi.h"
+#include "module.h"
+
+// Handler module loaded by test_module.c, built once per MODULE_VERSION.
+// Everything it does is reported back through functions the test binary
+// exports, which also checks the module resolves symbols from its host.
+// Version 3 declares an ABI the loader does not know; version 4 fails init.
+
+extern void test_module_record(int version, const discord_event_t* event);
+extern void test_module_block(void);
+extern void test_module_loaded(int version, int loads);
+extern void test_module_finished(int version, int final);
+
+#define FIXTURE_NAME_(version) "fixture-v" #version
+#define FIXTURE_NAME(version) FIXTURE_NAME_(version)
+
+typedef struct {
+    int loads;
+} module_state_t;
+
+static void on_message(const discord_event_t* event) {
+    test_module_record(MODULE_VERSION, event);
+}
+
+static void on_slow(const discord_event_t* event) {
+    test_module_block();
+    test_module_record(MODULE_VERSION, event);
+}
+
+static void on_anything(const discord_event_t* event) {
+    test_module_record(-MODULE_VERSION, event);
+}
+
+static int module_init(void** state) {
+    if (MODULE_VERSION == 4) {
+        return -1;
+    }
+    if (!*state) {
+        *state = calloc(1, sizeof(module_state_t));
+    }
+    module_state_t* counts = *state;
+    counts->loads++;
+    test_module_loaded(MODULE_VERSION, counts->loads);
+    return 0;
+}
+
+static void module_fini(void** state) {
+    test_module_finished(MODULE_VERSION, state != NULL);
+    if (state) {
+        free(*state);
+        *state = NULL;
+    }
+}
+
+static const discord_module_handler_t handlers[] = {
+    { "MESSAGE_CREATE", on_message },
+    { "SLOW_EVENT", on_slow },
+};
+
+static const discord_module_t module = {
+    MODULE_VERSION == 3 ? DISCORD_MODULE_ABI_VERSION + 1 : DISCORD_MODULE_ABI_VERSION,
+    FIXTURE_NAME(MODULE_VERSION),
+    handlers,
+    sizeof(handlers) / sizeof(handlers[0]),
+    on_anything,
+    module_init,
+    module_fini
+};
+
+DISCORD_MODULE_EXPORT(&module)
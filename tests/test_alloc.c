@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+
+static int allocate_calls = 0;
+static int release_calls = 0;
+static int budget_calls = 0;
+static void* cache_blocks[64];
+static int cache_count = 0;
+
+static void* counting_allocate(void* user, size_t size) {
+    (*(int*)user)++;
+    allocate_calls++;
+    return malloc(size);
+}
+
+static void* counting_reallocate(void* user, void* ptr, size_t size) {
+    (void)user;
+    return realloc(ptr, size);
+}
+
+static void counting_release(void* user, void* ptr) {
+    (void)user;
+    release_calls++;
+    free(ptr);
+}
+
+// Evict the oldest half of the cache, as an entity cache would
+static void on_cache_budget(discord_mem_tag_t tag, size_t live_bytes, size_t budget, void* user) {
+    assert(tag == DISCORD_MEM_CACHE && live_bytes > budget && user == cache_blocks);
+    budget_calls++;
+    int evict = cache_count / 2;
+    for (int i = 0; i < evict; i++) {
+        discord_mem_free(cache_blocks[i]);
+    }
+    memmove(cache_blocks, cache_blocks + evict, (size_t)(cache_count - evict) * sizeof(void*));
+    cache_count -= evict;
+}
+
+void test_accounting() {
+    printf("Testing per-tag accounting...\n");
+
+    discord_mem_stats_t before, stats;
+    assert(discord_mem_get_stats(DISCORD_MEM_JSON, &before) == DISCORD_OK);
+
+    char* json = NULL;
+    assert(discord_json_create_heartbeat(42, &json) == DISCORD_OK);
+    assert(discord_mem_get_stats(DISCORD_MEM_JSON, &stats) == DISCORD_OK);
+    assert(stats.live_bytes == before.live_bytes + 64);
+    assert(stats.allocations == before.allocations + 1);
+    discord_json_free(json);
+
+    discord_mem_get_stats(DISCORD_MEM_JSON, &stats);
+    assert(stats.live_bytes == before.live_bytes && stats.frees == before.frees + 1);
+    printf("  ✓ JSON payloads counted and released\n");
+
+    char* block = discord_mem_alloc(DISCORD_MEM_RECEIVE, 1000);
+    assert(block != NULL);
+    block = discord_mem_realloc(DISCORD_MEM_RECEIVE, block, 5000);
+    memset(block, 'x', 5000);
+    discord_mem_get_stats(DISCORD_MEM_RECEIVE, &stats);
+    assert(stats.live_bytes == 5000 && stats.peak_bytes >= 5000);
+
+    // Reallocating under another tag moves the bytes
+    block = discord_mem_realloc(DISCORD_MEM_SEND, block, 200);
+    discord_mem_get_stats(DISCORD_MEM_RECEIVE, &stats);
+    assert(stats.live_bytes == 0 && stats.peak_bytes >= 5000);
+    discord_mem_get_stats(DISCORD_MEM_SEND, &stats);
+    assert(stats.live_bytes == 200);
+    discord_mem_free(block);
+    printf("  ✓ Live and peak bytes follow realloc\n");
+
+    int* zeroed = discord_mem_calloc(DISCORD_MEM_OTHER, 16, sizeof(int));
+    for (int i = 0; i < 16; i++) {
+        assert(zeroed[i] == 0);
+    }
+    discord_mem_free(zeroed);
+    discord_mem_free(NULL);
+
+    assert(discord_mem_alloc(DISCORD_MEM_TAG_COUNT, 16) == NULL);
+    assert(discord_mem_calloc(DISCORD_MEM_OTHER, SIZE_MAX / 2, 4) == NULL);
+    assert(discord_mem_get_stats(DISCORD_MEM_TAG_COUNT, &stats) == DISCORD_ERROR_INVALID_PARAM);
+    printf("  ✓ Invalid tags and overflowing sizes rejected\n");
+}
+
+void test_custom_allocator() {
+    printf("Testing allocator replacement...\n");
+
+    int count = 0;
+    discord_allocator_t allocator = { counting_allocate, counting_reallocate, counting_release, &count };
+    discord_allocator_t incomplete = { counting_allocate, NULL, counting_release, NULL };
+    assert(discord_set_allocator(&incomplete) == DISCORD_ERROR_INVALID_PARAM);
+
+    // Not while shim memory is live
+    char* held = discord_mem_alloc(DISCORD_MEM_OTHER, 8);
+    assert(discord_set_allocator(&allocator) == DISCORD_ERROR_INVALID_PARAM);
+    discord_mem_free(held);
+    assert(discord_set_allocator(&allocator) == DISCORD_OK);
+
+    char* json = NULL;
+    assert(discord_json_create_identify("token", &json) == DISCORD_OK);
+    assert(strstr(json, "\"token\":\"token\"") != NULL);
+    discord_json_free(json);
+    assert(count == 1 && allocate_calls == 1 && release_calls == 1);
+    printf("  ✓ Shim allocations go through the installed allocator\n");
+
+    assert(discord_set_allocator(NULL) == DISCORD_OK);
+    json = NULL;
+    assert(discord_json_create_heartbeat(-1, &json) == DISCORD_OK);
+    discord_json_free(json);
+    assert(allocate_calls == 1);
+    printf("  ✓ NULL restores malloc/free\n");
+}
+
+void test_budget() {
+    printf("Testing soft budgets...\n");
+
+    assert(discord_mem_set_budget(DISCORD_MEM_CACHE, 16 * 1024, on_cache_budget, cache_blocks) == DISCORD_OK);
+
+    // 64 x 1 KiB entries against a 16 KiB budget
+    for (int i = 0; i < 64; i++) {
+        void* entry = discord_mem_alloc(DISCORD_MEM_CACHE, 1024);
+        assert(entry != NULL);
+        cache_blocks[cache_count++] = entry;
+    }
+
+    discord_mem_stats_t stats;
+    discord_mem_get_stats(DISCORD_MEM_CACHE, &stats);
+    assert(budget_calls > 0 && stats.over_budget == (uint64_t)budget_calls);
+    assert(stats.budget == 16 * 1024);
+    assert(stats.live_bytes <= 17 * 1024 && stats.peak_bytes <= 17 * 1024);
+    printf("  ✓ %d evictions kept the cache at %zu bytes (peak %zu)\n",
+           budget_calls, stats.live_bytes, stats.peak_bytes);
+
+    // Budgets are soft: without a callback allocations still succeed
+    discord_mem_set_budget(DISCORD_MEM_CACHE, 1024, NULL, NULL);
+    void* extra = discord_mem_alloc(DISCORD_MEM_CACHE, 4096);
+    assert(extra != NULL);
+    discord_mem_free(extra);
+
+    for (int i = 0; i < cache_count; i++) {
+        discord_mem_free(cache_blocks[i]);
+    }
+    discord_mem_get_stats(DISCORD_MEM_CACHE, &stats);
+    assert(stats.live_bytes == 0);
+    discord_mem_set_budget(DISCORD_MEM_CACHE, 0, NULL, NULL);
+    printf("  ✓ Over-budget allocations still succeed\n");
+}
+
+int main() {
+    printf("Discord ASM Bot - Memory Accounting Tests\n");
+    printf("=========================================\n\n");
+
+    test_accounting();
+    printf("\n");
+
+    test_custom_allocator();
+    printf("\n");
+
+    test_budget();
+    printf("\n");
+
+    printf("All memory accounting tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,465 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "abi.h"
+#include "archive.h"
+#include "automod.h"
+#include "dispatch.h"
+#include "qos.h"
+
+// Archives are written to a directory in /tmp. Synthetic rows derive every
+// column from their number, which is also the low bits of the message id,
+// so query results can be checked against a brute-force filter.
+
+#define ROWS        20000
+#define BASE_MS     1700000000000ULL
+#define SEGMENT     3000            // Rounded up to 3072: several segments
+
+static char archive_dir[64];
+
+static void make_dir(void) {
+    snprintf(archive_dir, sizeof(archive_dir), "/tmp/discord-archive-test-%d", (int)getpid());
+}
+
+static void remove_dir(void) {
+    DIR* dir = opendir(archive_dir);
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            char path[384];
+            snprintf(path, sizeof(path), "%s/%s", archive_dir, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(dir);
+    rmdir(archive_dir);
+}
+
+static uint64_t row_id(uint32_t n) {
+    return ((BASE_MS + n * 10ULL - DISCORD_SNOWFLAKE_EPOCH_MS) << 22) | n;
+}
+
+static uint64_t row_time(uint32_t n) {
+    return BASE_MS + n * 10ULL;
+}
+
+// Even rows chat, odd rows are noise that does not compress; every tenth
+// row has no content at all
+static size_t row_content(uint32_t n, char* buffer) {
+    if (n % 10 == 5) {
+        return 0;
+    }
+    if (n % 2 == 0) {
+        return (size_t)snprintf(buffer, 256, "message %u in channel %u: the quick brown fox jumps over the lazy dog",
+                                n, 100 + n % 13);
+    }
+    uint32_t state = n * 2654435761u + 1;
+    size_t length = 20 + n % 90;
+    for (size_t i = 0; i < length; i++) {
+        state = state * 1103515245u + 12345u;
+        buffer[i] = (char)(33 + (state >> 16) % 90);
+    }
+    return length;
+}
+
+static void make_row(uint32_t n, discord_archive_row_t* row, char* buffer) {
+    memset(row, 0, sizeof(*row));
+    row->kind = (discord_archive_kind_t)(n % 3);
+    row->message_id = row_id(n);
+    row->channel_id = 100 + n % 13;
+    row->guild_id = n % 4 ? 7 : 0;
+    row->author_id = 1000 + (n * 7) % 97;
+    row->event_ms = row_time(n) + 5;
+    size_t length = row_content(n, buffer);
+    row->content = n % 10 == 5 ? NULL : buffer;
+    row->content_length = (uint32_t)length;
+}
+
+static int row_wanted(uint32_t n, const discord_archive_query_t* query) {
+    discord_archive_row_t row;
+    char buffer[256];
+    make_row(n, &row, buffer);
+    return (!query->channel_id || row.channel_id == query->channel_id) &&
+           (!query->author_id || row.author_id == query->author_id) &&
+           (!query->since_ms || row_time(n) >= query->since_ms) &&
+           (!query->until_ms || row_time(n) < query->until_ms) &&
+           (!query->kinds || (query->kinds & (1u << row.kind)));
+}
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t last_id;
+    uint64_t stop_after;
+} collect_t;
+
+// Checks each row against the one it was made from
+static int collect(void* user, const discord_archive_row_t* row) {
+    collect_t* c = user;
+    uint32_t n = (uint32_t)(row->message_id & 0x3fffff);
+    discord_archive_row_t expected;
+    char buffer[256];
+    make_row(n, &expected, buffer);
+    assert(row->message_id == expected.message_id);
+    assert(row->message_id > c->last_id);
+    assert(row->kind == expected.kind);
+    assert(row->channel_id == expected.channel_id);
+    assert(row->guild_id == expected.guild_id);
+    assert(row->author_id == expected.author_id);
+    assert(row->event_ms == expected.event_ms);
+    assert((row->content == NULL) == (expected.content == NULL));
+    assert(row->content_length == expected.content_length);
+    assert(memcmp(row->content ? row->content : "", buffer, row->content_length) == 0);
+    c->last_id = row->message_id;
+    c->count++;
+    c->sum += n;
+    return c->stop_after && c->count == c->stop_after;
+}
+
+static void check_query(discord_archive_reader_t* reader, const discord_archive_query_t* query,
+                        uint32_t rows, discord_archive_query_stats_t* stats) {
+    collect_t expected = {0};
+    for (uint32_t n = 0; n < rows; n++) {
+        if (row_wanted(n, query)) {
+            expected.count++;
+            expected.sum += n;
+        }
+    }
+    collect_t got = {0};
+    assert(discord_archive_query(reader, query, collect, &got, stats) == DISCORD_OK);
+    assert(got.count == expected.count);
+    assert(got.sum == expected.sum);
+    assert(stats->rows_matched == expected.count);
+}
+
+static discord_archive_row_t copied[8];
+static char copied_content[8][32];
+
+static int copy(void* user, const discord_archive_row_t* row) {
+    int* count = user;
+    assert(*count < 8);
+    copied[*count] = *row;
+    memcpy(copied_content[*count], row->content ? row->content : "", row->content_length);
+    copied_content[*count][row->content_length] = '\0';
+    (*count)++;
+    return 0;
+}
+
+static int copy_none(void* user, const discord_archive_row_t* row) {
+    (void)row;
+    (*(int*)user)++;
+    return 0;
+}
+
+void test_events() {
+    printf("Testing event parsing...\n");
+
+    discord_archive_t* archive = NULL;
+    assert(discord_archive_open(NULL, NULL, &archive) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_archive_open(archive_dir, NULL, &archive) == DISCORD_OK);
+
+    static const struct { const char* type; const char* data; discord_result_t result; } events[] = {
+        { "MESSAGE_CREATE", "{\"id\":\"5000000000000000001\",\"channel_id\":\"20\",\"guild_id\":\"30\","
+                            "\"author\":{\"username\":\"a\",\"id\":\"40\"},\"content\":\"hi \\\"there\\\"\","
+                            "\"embeds\":[{\"id\":\"9\"}]}", DISCORD_OK },
+        { "MESSAGE_UPDATE", "{\"id\":\"5000000000000000001\",\"channel_id\":\"20\",\"guild_id\":\"30\","
+                            "\"content\":\"edited\"}", DISCORD_OK },
+        { "MESSAGE_DELETE", "{\"id\":\"5000000000000000001\",\"channel_id\":\"20\"}", DISCORD_OK },
+        { "MESSAGE_DELETE_BULK", "{\"ids\":[\"5000000000000000002\",\"5000000000000000003\"],"
+                                 "\"channel_id\":\"21\",\"guild_id\":\"30\"}", DISCORD_OK },
+        { "MESSAGE_REACTION_ADD", "{\"message_id\":\"1\",\"channel_id\":\"20\"}", DISCORD_OK },
+        { "GUILD_CREATE", "{\"id\":\"30\"}", DISCORD_OK },
+        { "MESSAGE_CREATE", "{\"id\":\"5000000000000000004\",\"content\":\"no channel\"}", DISCORD_ERROR_JSON },
+        { "MESSAGE_DELETE", "{\"channel_id\":\"20\"}", DISCORD_ERROR_JSON },
+    };
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+        discord_event_t event = { 0, (char*)events[i].data, strlen(events[i].data), (int)i, (char*)events[i].type };
+        assert(discord_archive_append(archive, &event) == events[i].result);
+    }
+    printf("  ✓ MESSAGE_* events are archived, others ignored, incomplete ones rejected\n");
+
+    assert(discord_archive_flush(archive) == DISCORD_OK);
+    discord_archive_stats_t stats;
+    assert(discord_archive_get_stats(archive, &stats) == DISCORD_OK);
+    assert(stats.rows == 5 && stats.skipped == 2);
+    assert(stats.groups == 1 && stats.segments == 1 && stats.write_errors == 0);
+    discord_archive_close(archive);
+
+    discord_archive_reader_t* reader = NULL;
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_OK);
+    discord_archive_query_t query = {0};
+    query.channel_id = 20;
+    int count = 0;
+    assert(discord_archive_query(reader, &query, copy, &count, NULL) == DISCORD_OK);
+    assert(count == 3);
+    assert(copied[0].kind == DISCORD_ARCHIVE_CREATE && copied[0].message_id == 5000000000000000001ULL);
+    assert(copied[0].guild_id == 30 && copied[0].author_id == 40);
+    assert(strcmp(copied_content[0], "hi \\\"there\\\"") == 0);
+    assert(copied[1].kind == DISCORD_ARCHIVE_UPDATE && copied[1].author_id == 0);
+    assert(strcmp(copied_content[1], "edited") == 0);
+    assert(copied[2].kind == DISCORD_ARCHIVE_DELETE && copied[2].content == NULL);
+    assert(copied[2].event_ms >= copied[0].event_ms && copied[0].event_ms > BASE_MS);
+
+    query.channel_id = 21;
+    count = 0;
+    assert(discord_archive_query(reader, &query, copy, &count, NULL) == DISCORD_OK);
+    assert(count == 2);
+    assert(copied[0].message_id == 5000000000000000002ULL && copied[1].message_id == 5000000000000000003ULL);
+    assert(copied[1].kind == DISCORD_ARCHIVE_DELETE && copied[1].guild_id == 30);
+    discord_archive_reader_close(reader);
+    printf("  ✓ Ids, author and escaped content read back; bulk deletes become a row per id\n");
+    remove_dir();
+}
+
+static void append_rows(discord_archive_t* archive, uint32_t first, uint32_t count) {
+    for (uint32_t n = first; n < first + count; n++) {
+        discord_archive_row_t row;
+        char buffer[256];
+        make_row(n, &row, buffer);
+        assert(discord_archive_append_row(archive, &row) == DISCORD_OK);
+    }
+}
+
+void test_queries() {
+    printf("Testing queries...\n");
+
+    discord_archive_config_t config = { SEGMENT, 0 };
+    discord_archive_t* archive = NULL;
+    assert(discord_archive_open(archive_dir, &config, &archive) == DISCORD_OK);
+    append_rows(archive, 0, ROWS);
+    assert(discord_archive_flush(archive) == DISCORD_OK);
+
+    discord_archive_stats_t stats;
+    assert(discord_archive_get_stats(archive, &stats) == DISCORD_OK);
+    assert(stats.rows == ROWS && stats.skipped == 0 && stats.write_errors == 0);
+    assert(stats.groups == (ROWS + DISCORD_ARCHIVE_GROUP_ROWS - 1) / DISCORD_ARCHIVE_GROUP_ROWS);
+    assert(stats.segments == (ROWS + 3071) / 3072);
+    assert(stats.content_packed < stats.content_bytes);
+    assert(stats.content_packed > stats.content_bytes / 3);     // The noise stays
+    discord_archive_close(archive);
+    printf("  ✓ %u rows in %u segments, content packed to %u%%\n", ROWS, (unsigned)stats.segments,
+           (unsigned)(stats.content_packed * 100 / stats.content_bytes));
+
+    discord_archive_reader_t* reader = NULL;
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_OK);
+    discord_archive_query_t query = {0};
+    discord_archive_query_stats_t query_stats;
+    check_query(reader, &query, ROWS, &query_stats);
+    assert(query_stats.segments == stats.segments && query_stats.segments_skipped == 0);
+    assert(query_stats.groups_decoded == stats.groups && query_stats.rows_scanned == ROWS);
+    printf("  ✓ Full scan returns every row intact and in order\n");
+
+    query.channel_id = 105;
+    check_query(reader, &query, ROWS, &query_stats);
+    query.channel_id = 0;
+    query.author_id = 1042;
+    check_query(reader, &query, ROWS, &query_stats);
+    query.channel_id = 105;
+    check_query(reader, &query, ROWS, &query_stats);
+    query.kinds = 1u << DISCORD_ARCHIVE_UPDATE;
+    check_query(reader, &query, ROWS, &query_stats);
+    printf("  ✓ Channel, author and kind filters\n");
+
+    // A channel that never occurs rules out every segment through the index
+    query.kinds = 0;
+    query.channel_id = 999;
+    check_query(reader, &query, ROWS, &query_stats);
+    assert(query_stats.segments_skipped == stats.segments && query_stats.groups_scanned == 0);
+
+    memset(&query, 0, sizeof(query));
+    query.since_ms = row_time(9300);     // Rows 9216-10239 are the first group of the fourth segment
+    query.until_ms = row_time(9800);
+    check_query(reader, &query, ROWS, &query_stats);
+    assert(query_stats.rows_matched == 500);
+    assert(query_stats.segments_skipped == stats.segments - 1);
+    assert(query_stats.groups_scanned == 1);
+    query.since_ms = row_time(ROWS);
+    query.until_ms = 0;
+    check_query(reader, &query, ROWS, &query_stats);
+    assert(query_stats.rows_matched == 0 && query_stats.groups_scanned == 0);
+    printf("  ✓ Time ranges skip segments and groups outside them\n");
+
+    memset(&query, 0, sizeof(query));
+    collect_t first = {0};
+    first.stop_after = 10;
+    assert(discord_archive_query(reader, &query, collect, &first, NULL) == DISCORD_OK);
+    assert(first.count == 10 && first.sum == 45);
+    printf("  ✓ A nonzero callback return stops the query\n");
+    discord_archive_reader_close(reader);
+
+    // Reopening continues the numbering; the reader sees old and new rows
+    assert(discord_archive_open(archive_dir, &config, &archive) == DISCORD_OK);
+    append_rows(archive, ROWS, 100);
+    discord_archive_close(archive);
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_OK);
+    check_query(reader, &query, ROWS + 100, &query_stats);
+    assert(query_stats.segments == stats.segments + 1);
+    discord_archive_reader_close(reader);
+    printf("  ✓ A reopened archive appends new segments\n");
+    remove_dir();
+}
+
+static void rewrite_byte(const char* name, long offset, int value) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s/%s", archive_dir, name);
+    int fd = open(path, O_RDWR);
+    assert(fd >= 0);
+    unsigned char byte = (unsigned char)value;
+    assert(pwrite(fd, &byte, 1, offset) == 1);
+    close(fd);
+}
+
+void test_damaged() {
+    printf("Testing damaged segments...\n");
+
+    discord_archive_reader_t* reader = NULL;
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_ERROR_NOT_FOUND);
+
+    discord_archive_t* archive = NULL;
+    assert(discord_archive_open(archive_dir, NULL, &archive) == DISCORD_OK);
+    append_rows(archive, 0, 3000);
+    discord_archive_close(archive);
+
+    // Unfinished segments are ignored
+    char path[160];
+    snprintf(path, sizeof(path), "%s/segment-00000001.darc.tmp", archive_dir);
+    FILE* file = fopen(path, "w");
+    assert(file);
+    fputs("partial", file);
+    fclose(file);
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_OK);
+    discord_archive_query_t query = {0};
+    discord_archive_query_stats_t query_stats;
+    check_query(reader, &query, 3000, &query_stats);
+    discord_archive_reader_close(reader);
+    printf("  ✓ .tmp files are not read\n");
+
+    // A bad header is refused when opening
+    rewrite_byte("segment-00000000.darc", 0, 'X');
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_ERROR_INVALID_PARAM);
+    rewrite_byte("segment-00000000.darc", 0, 'D');
+    snprintf(path, sizeof(path), "%s/segment-00000000.darc", archive_dir);
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    assert(truncate(path, st.st_size - 1) == 0);
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_ERROR_INVALID_PARAM);
+    assert(truncate(path, st.st_size) == 0);
+
+    // Damaged content is caught by the query that decodes it
+    rewrite_byte("segment-00000000.darc", 200, 0xff);
+    rewrite_byte("segment-00000000.darc", 201, 0xff);
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_OK);
+    int count = 0;
+    discord_result_t result = discord_archive_query(reader, &query, copy_none, &count, NULL);
+    assert(result == DISCORD_ERROR_INVALID_PARAM);
+    discord_archive_reader_close(reader);
+    printf("  ✓ Damaged segments are refused rather than misread\n");
+    remove_dir();
+}
+
+static discord_archive_t* dispatch_archive;
+static int handled_creates = 0;
+
+static void on_message_create(const discord_event_t* event) {
+    (void)event;
+    handled_creates++;
+}
+
+void test_attach() {
+    printf("Testing dispatch attach...\n");
+
+    assert(discord_dispatch_on("MESSAGE_CREATE", on_message_create) == DISCORD_OK);
+    assert(discord_archive_open(archive_dir, NULL, &dispatch_archive) == DISCORD_OK);
+    assert(discord_archive_attach(dispatch_archive) == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":1,\"t\":\"MESSAGE_CREATE\",\"d\":{\"id\":\"7\",\"channel_id\":\"8\","
+                                  "\"author\":{\"id\":\"9\"},\"content\":\"from the gateway\"}}") == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":2,\"t\":\"TYPING_START\",\"d\":{\"channel_id\":\"8\"}}") == DISCORD_OK);
+    assert(handled_creates == 1);
+
+    // Blocked by automod: no handler runs, but the message is archived
+    discord_automod_t* automod = NULL;
+    discord_automod_t* previous = NULL;
+    discord_automod_rule_t rule = { DISCORD_AUTOMOD_KEYWORD, "forbidden", DISCORD_AUTOMOD_BLOCK, 1 };
+    assert(discord_automod_create(NULL, &automod) == DISCORD_OK);
+    assert(discord_automod_add(automod, &rule) == DISCORD_OK);
+    assert(discord_automod_compile(automod) == DISCORD_OK);
+    assert(discord_automod_install(automod, 1000, &previous) == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":5,\"t\":\"MESSAGE_CREATE\",\"d\":{\"id\":\"11\",\"channel_id\":\"8\","
+                                  "\"author\":{\"id\":\"9\"},\"content\":\"a forbidden word\"}}") == DISCORD_OK);
+    assert(handled_creates == 1);
+    assert(discord_automod_install(NULL, 1000, &previous) == DISCORD_OK && previous == automod);
+    discord_automod_destroy(automod);
+
+    // Shed by QoS before it was dispatched: archived all the same
+    discord_qos_t* qos = NULL;
+    discord_qos_class_config_t shed = { 5000, 1, DISCORD_QOS_SHED_NEWEST };
+    assert(discord_qos_create(&qos) == DISCORD_OK);
+    assert(discord_qos_set_class(qos, DISCORD_QOS_NORMAL, &shed) == DISCORD_OK);
+    assert(discord_qos_attach(qos) == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":6,\"t\":\"MESSAGE_CREATE\",\"d\":{\"id\":\"12\",\"channel_id\":\"8\"}}") == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":7,\"t\":\"MESSAGE_CREATE\",\"d\":{\"id\":\"13\",\"channel_id\":\"8\"}}") == DISCORD_OK);
+    assert(discord_qos_run(qos, 10) == 1 && handled_creates == 2);
+    discord_qos_attach(NULL);
+    discord_qos_destroy(qos);
+
+    discord_archive_close(dispatch_archive);
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":3,\"t\":\"MESSAGE_DELETE\",\"d\":{\"id\":\"7\",\"channel_id\":\"8\"}}") == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":4,\"t\":\"MESSAGE_CREATE\",\"d\":{\"id\":\"10\",\"channel_id\":\"8\"}}") == DISCORD_OK);
+    assert(handled_creates == 3);
+
+    discord_archive_reader_t* reader = NULL;
+    assert(discord_archive_reader_open(archive_dir, &reader) == DISCORD_OK);
+    discord_archive_query_t query = {0};
+    int count = 0;
+    assert(discord_archive_query(reader, &query, copy, &count, NULL) == DISCORD_OK);
+    assert(count == 4);
+    assert(copied[0].message_id == 7 && copied[0].channel_id == 8 && copied[0].author_id == 9);
+    assert(strcmp(copied_content[0], "from the gateway") == 0);
+    assert(copied[1].message_id == 11 && strcmp(copied_content[1], "a forbidden word") == 0);
+    assert(copied[2].message_id == 12 && copied[3].message_id == 13);
+    discord_archive_reader_close(reader);
+    printf("  ✓ Decoded frames are archived until the archive is closed\n");
+    printf("  ✓ Messages blocked by automod or shed by QoS are archived\n");
+    printf("  ✓ The application's MESSAGE_CREATE handler ran throughout\n");
+    discord_dispatch_clear();
+    remove_dir();
+}
+
+int main() {
+    printf("Discord ASM Bot - Archive Tests\n");
+    printf("===============================\n\n");
+
+    make_dir();
+    remove_dir();
+
+    test_events();
+    printf("\n");
+
+    test_queries();
+    printf("\n");
+
+    test_damaged();
+    printf("\n");
+
+    test_attach();
+    printf("\n");
+
+    size_t live = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        live += stats.live_bytes;
+    }
+    assert(live == 0);
+
+    printf("All archive tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "qos.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// Handlers log the sequence number of every event in the order they get
+// them, plus the size of each batch. Time is a test clock.
+
+static uint64_t now_ns = 1000000000ULL;
+static int delivered[64];
+static int delivered_count = 0;
+static size_t batch_sizes[32];
+static int batch_count = 0;
+
+static uint64_t test_now_ns(void* user) {
+    (void)user;
+    return now_ns;
+}
+
+static void log_event(const discord_event_t* event) {
+    assert(delivered_count < 64);
+    delivered[delivered_count++] = event->sequence;
+}
+
+static void on_batch(const discord_event_t* events, size_t count) {
+    assert(batch_count < 32);
+    batch_sizes[batch_count++] = count;
+    for (size_t i = 0; i < count; i++) {
+        log_event(&events[i]);
+    }
+}
+
+static void on_reactions(const discord_event_t* events, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        assert(strcmp(events[i].event_type, "MESSAGE_REACTION_ADD") == 0);
+        assert(events[i].opcode == 0);
+        // d = {"guild_id":"<g>","n":<sequence>}
+        char expected[64];
+        int length = snprintf(expected, sizeof(expected), "\"n\":%d}", events[i].sequence);
+        assert(events[i].data_length > (size_t)length);
+        assert(memcmp(events[i].data + events[i].data_length - length, expected, (size_t)length) == 0);
+    }
+    on_batch(events, count);
+}
+
+static void reset_log(void) {
+    delivered_count = 0;
+    batch_count = 0;
+}
+
+// guild < 0: no guild_id
+static void send(const char* type, int guild, int sequence) {
+    char frame[160];
+    if (guild >= 0) {
+        snprintf(frame, sizeof(frame), "{\"op\":0,\"s\":%d,\"t\":\"%s\",\"d\":{\"guild_id\":\"%d\",\"n\":%d}}",
+                 sequence, type, guild, sequence);
+    } else {
+        snprintf(frame, sizeof(frame), "{\"op\":0,\"s\":%d,\"t\":\"%s\",\"d\":{\"n\":%d}}", sequence, type, sequence);
+    }
+    assert(discord_dispatch_frame(frame) == DISCORD_OK);
+}
+
+static void check_log(const int* expected, int count) {
+    assert(delivered_count == count);
+    for (int i = 0; i < count; i++) {
+        assert(delivered[i] == expected[i]);
+    }
+}
+
+void test_collect() {
+    printf("Testing batch collection...\n");
+
+    discord_batch_config_t config = { DISCORD_DISPATCH_BATCH_MAX + 1, 0 };
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, &config) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_dispatch_on_batch(NULL, on_reactions, NULL) == DISCORD_ERROR_INVALID_PARAM);
+    config.max_events = 4;
+    config.window_us = 2000;
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, &config) == DISCORD_OK);
+    discord_dispatch_set_handler(log_event);
+
+    reset_log();
+    for (int i = 1; i <= 10; i++) {
+        send("MESSAGE_REACTION_ADD", 1, i);
+    }
+    assert(batch_count == 2 && batch_sizes[0] == 4 && batch_sizes[1] == 4);
+    discord_batch_stats_t stats;
+    assert(discord_dispatch_get_batch_stats(&stats) == DISCORD_OK);
+    assert(stats.pending == 2 && stats.full == 2);
+    printf("  ✓ A batch is delivered when it reaches max_events\n");
+
+    // Not idle and within the window: the batch waits
+    discord_qos_poll(0);
+    assert(batch_count == 2);
+    now_ns += 2000000;
+    discord_qos_poll(0);
+    assert(batch_count == 3 && batch_sizes[2] == 2);
+    send("MESSAGE_REACTION_ADD", 1, 11);
+    now_ns += 1000000;
+    send("MESSAGE_REACTION_ADD", 1, 12);
+    now_ns += 1000000;
+    send("MESSAGE_REACTION_ADD", 1, 13);
+    assert(batch_count == 4 && batch_sizes[3] == 3);
+    printf("  ✓ A batch is delivered once its first event has waited window_us\n");
+
+    send("MESSAGE_REACTION_ADD", 1, 14);
+    discord_qos_poll(1);
+    assert(batch_count == 5 && batch_sizes[4] == 1);
+    const int expected[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+    check_log(expected, 14);
+    assert(discord_dispatch_get_batch_stats(&stats) == DISCORD_OK);
+    assert(stats.batches == 5 && stats.events == 14 && stats.pending == 0);
+    assert(stats.full == 2 && stats.expired == 2 && stats.drained == 1);
+    printf("  ✓ The gateway loop hook delivers everything once the socket is drained\n");
+
+    // Other types keep going to the catch-all straight away
+    reset_log();
+    send("TYPING_START", 1, 20);
+    assert(delivered_count == 1 && batch_count == 0);
+    discord_dispatch_clear();
+}
+
+void test_guild_order() {
+    printf("Testing per-guild order...\n");
+
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, NULL) == DISCORD_OK);
+    assert(discord_dispatch_on_batch("GUILD_MEMBER_ADD", on_batch, NULL) == DISCORD_OK);
+    discord_dispatch_on("MESSAGE_CREATE", log_event);
+    discord_dispatch_set_handler(log_event);
+    discord_batch_stats_t before;
+    discord_dispatch_get_batch_stats(&before);
+
+    reset_log();
+    send("MESSAGE_REACTION_ADD", 7, 1);
+    send("MESSAGE_REACTION_ADD", 8, 2);
+    send("GUILD_MEMBER_ADD", 7, 3);         // Reactions of 7 (and 8 with them) go first
+    send("MESSAGE_CREATE", 8, 4);           // Nothing of 8 pending
+    send("MESSAGE_REACTION_ADD", 7, 5);     // The member add of 7 goes first
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":6,\"t\":\"GUILD_DELETE\",\"d\":{\"id\":\"7\"}}") == DISCORD_OK);
+    const int expected[] = { 1, 2, 4, 3, 5, 6 };
+    check_log(expected, 6);
+
+    discord_batch_stats_t stats;
+    discord_dispatch_get_batch_stats(&stats);
+    assert(stats.ordered - before.ordered == 3 && stats.pending == 0);
+    printf("  ✓ Pending events of a guild are delivered before its next event\n");
+
+    // Events without a guild (DMs) are ordered among themselves
+    reset_log();
+    send("MESSAGE_REACTION_ADD", -1, 10);
+    send("MESSAGE_REACTION_ADD", 9, 11);
+    send("MESSAGE_CREATE", -1, 12);
+    discord_dispatch_flush();
+    const int dm[] = { 10, 11, 12 };
+    check_log(dm, 3);
+    assert(discord_dispatch_frame("{\"op\":11,\"d\":null}") == DISCORD_OK);
+    printf("  ✓ Events without a guild count as one guild\n");
+    discord_dispatch_clear();
+}
+
+#ifndef _WIN32
+static void* send_from_thread(void* arg) {
+    (void)arg;
+    send("MESSAGE_REACTION_ADD", 1, 31);
+    return NULL;
+}
+#endif
+
+void test_replace() {
+    printf("Testing registration changes...\n");
+
+    discord_batch_config_t config = { 16, 1000000 };
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, &config) == DISCORD_OK);
+    discord_dispatch_set_handler(log_event);
+
+    reset_log();
+    send("MESSAGE_REACTION_ADD", 1, 1);
+    send("MESSAGE_REACTION_ADD", 1, 2);
+    discord_dispatch_on("MESSAGE_REACTION_ADD", log_event);
+    assert(batch_count == 1 && batch_sizes[0] == 2);
+    send("MESSAGE_REACTION_ADD", 1, 3);
+    assert(batch_count == 1 && delivered_count == 3);
+    printf("  ✓ A plain handler takes over after the pending batch\n");
+
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, &config) == DISCORD_OK);
+    send("MESSAGE_REACTION_ADD", 1, 4);
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", NULL, NULL) == DISCORD_OK);
+    assert(batch_count == 2 && delivered_count == 4);
+    send("MESSAGE_REACTION_ADD", 1, 5);     // Catch-all now
+    assert(batch_count == 2 && delivered_count == 5);
+    printf("  ✓ Unregistering delivers what is pending and falls back to the catch-all\n");
+
+#ifndef _WIN32
+    // Registered on this thread: another thread's events are not collected
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, &config) == DISCORD_OK);
+    send("MESSAGE_REACTION_ADD", 1, 30);
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, send_from_thread, NULL) == 0);
+    pthread_join(thread, NULL);
+    assert(batch_count == 3 && batch_sizes[2] == 1 && delivered[delivered_count - 1] == 31);
+    discord_dispatch_flush();
+    assert(batch_count == 4 && delivered[delivered_count - 1] == 30);
+    printf("  ✓ Events from other threads reach the batch handler one at a time\n");
+#endif
+    discord_dispatch_clear();
+}
+
+static void on_other_batch(const discord_event_t* events, size_t count) {
+    (void)events;
+    (void)count;
+}
+
+void test_no_free_batch() {
+    printf("Testing registration without a free batch...\n");
+
+    char types[DISCORD_DISPATCH_BATCH_TYPES][32];
+    for (int i = 0; i < DISCORD_DISPATCH_BATCH_TYPES; i++) {
+        snprintf(types[i], sizeof(types[i]), "BATCHED_%d", i);
+        assert(discord_dispatch_on_batch(types[i], on_other_batch, NULL) == DISCORD_OK);
+    }
+
+    // Every batch is taken: the plain handler must survive the failure
+    assert(discord_dispatch_on("MESSAGE_REACTION_ADD", log_event) == DISCORD_OK);
+    assert(discord_dispatch_on_batch("MESSAGE_REACTION_ADD", on_reactions, NULL) == DISCORD_ERROR_MEMORY);
+    reset_log();
+    send("MESSAGE_REACTION_ADD", 1, 1);
+    assert(delivered_count == 1 && batch_count == 0);
+    printf("  ✓ A failed batch registration keeps the plain handler\n");
+
+    // Replacing a type's own batch needs no free one
+    assert(discord_dispatch_on_batch(types[0], on_reactions, NULL) == DISCORD_OK);
+    discord_dispatch_clear();
+    printf("  ✓ A batched type can be registered again when all batches are taken\n");
+}
+
+int main() {
+    printf("Discord ASM Bot - Batch Dispatch Tests\n");
+    printf("======================================\n\n");
+
+    discord_clock_t clock = { test_now_ns, NULL, NULL };
+    assert(discord_set_clock(&clock) == DISCORD_OK);
+
+    test_collect();
+    printf("\n");
+
+    test_guild_order();
+    printf("\n");
+
+    test_replace();
+    printf("\n");
+
+    test_no_free_batch();
+    printf("\n");
+
+    discord_set_clock(NULL);
+
+    size_t live = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        live += stats.live_bytes;
+    }
+    assert(live == 0);
+
+    printf("All batch dispatch tests passed! ✓\n");
+    return 0;
+}
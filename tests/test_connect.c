@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/evp.h>
+#include "abi.h"
+#include "connect.h"
+#include "shard.h"
+#include "sim.h"
+#include "wsframe.h"
+
+// DNS cache, io_uring connects with timing and standbys against a local
+// upgrade server, then prewarmed shards on the simulated gateway.
+
+#define MAX_CLIENTS 16
+#define HELLO "{\"op\":10,\"d\":{\"heartbeat_interval\":41250}}"
+
+// Real monotonic time plus an offset the test moves forward, so cache
+// entries and standbys can be aged without sleeping
+static uint64_t clock_offset_ns = 0;
+
+static uint64_t test_now_ns(void* user) {
+    (void)user;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec +
+           __atomic_load_n(&clock_offset_ns, __ATOMIC_ACQUIRE);
+}
+
+static void test_sleep_ms(void* user, uint32_t milliseconds) {
+    (void)user;
+    usleep(milliseconds * 1000);
+}
+
+static void advance_ms(uint64_t milliseconds) {
+    __atomic_add_fetch(&clock_offset_ns, milliseconds * 1000000ULL, __ATOMIC_ACQ_REL);
+}
+
+// Answers every upgrade with 101 and HELLO, then leaves the connection open
+typedef struct {
+    int listener;
+    int port;
+    int fds[MAX_CLIENTS];
+    int accepted;
+} server_t;
+
+static void* server_thread(void* arg) {
+    server_t* s = arg;
+    while (s->accepted < MAX_CLIENTS) {
+        int fd = accept(s->listener, NULL, NULL);
+        if (fd < 0) {
+            break;
+        }
+
+        char request[2048] = "";
+        size_t used = 0;
+        while (!strstr(request, "\r\n\r\n") && used < sizeof(request) - 1) {
+            if (read(fd, request + used, 1) != 1) {
+                break;
+            }
+            request[++used] = '\0';
+        }
+        const char* key = strstr(request, "Sec-WebSocket-Key: ");
+        assert(key && strstr(request, "GET /?v=10&encoding=json HTTP/1.1\r\n") == request);
+        key += 19;
+        char concatenated[128], accept_key[64];
+        uint8_t digest[EVP_MAX_MD_SIZE];
+        unsigned digest_length = 0;
+        int key_length = (int)(strstr(key, "\r\n") - key);
+        snprintf(concatenated, sizeof(concatenated), "%.*s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key_length, key);
+        EVP_Digest(concatenated, strlen(concatenated), digest, &digest_length, EVP_sha1(), NULL);
+        EVP_EncodeBlock((unsigned char*)accept_key, digest, (int)digest_length);
+
+        uint8_t out[512];
+        size_t n = (size_t)sprintf((char*)out, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                                   "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept_key);
+        n += discord_wsframe_header(out + n, DISCORD_WSFRAME_TEXT, 1, strlen(HELLO), NULL);
+        memcpy(out + n, HELLO, strlen(HELLO));
+        n += strlen(HELLO);
+        assert(write(fd, out, n) == (ssize_t)n);
+        s->fds[s->accepted++] = fd;
+    }
+    return NULL;
+}
+
+static void start_server(server_t* s, pthread_t* thread) {
+    memset(s, 0, sizeof(*s));
+    s->listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(s->listener, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    assert(listen(s->listener, MAX_CLIENTS) == 0);
+    socklen_t length = sizeof(addr);
+    getsockname(s->listener, (struct sockaddr*)&addr, &length);
+    s->port = ntohs(addr.sin_port);
+    pthread_create(thread, NULL, server_thread, s);
+}
+
+static void stop_server(server_t* s, pthread_t thread) {
+    shutdown(s->listener, SHUT_RDWR);
+    pthread_join(thread, NULL);
+    close(s->listener);
+    for (int i = 0; i < s->accepted; i++) {
+        close(s->fds[i]);
+    }
+}
+
+static void expect_hello(discord_gateway_t* gateway) {
+    discord_ws_message_t message;
+    assert(discord_ws_receive(gateway, &message, 2000) == DISCORD_OK);
+    assert(message.length == strlen(HELLO) && strcmp(message.data, HELLO) == 0);
+    discord_ws_free_message(&message);
+}
+
+static void wait_for_lookups(uint64_t lookups) {
+    discord_connect_stats_t stats;
+    for (int i = 0; i < 5000; i++) {
+        discord_connect_get_stats(&stats);
+        if (stats.lookups >= lookups) {
+            // The resolver publishes the entry right after counting
+            usleep(10000);
+            return;
+        }
+        usleep(1000);
+    }
+    assert(!"lookup never finished");
+}
+
+void test_dns_cache() {
+    printf("Testing DNS cache...\n");
+
+    discord_dns_flush();
+    discord_connect_stats_t before, stats;
+    discord_connect_get_stats(&before);
+
+    assert(discord_dns_prefetch(NULL) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_dns_prefetch("localhost") == DISCORD_OK);
+    wait_for_lookups(before.lookups + 1);
+    assert(discord_dns_prefetch("localhost") == DISCORD_OK);
+    assert(discord_dns_prefetch("127.0.0.1") == DISCORD_OK);
+    discord_connect_get_stats(&stats);
+    assert(stats.lookups == before.lookups + 1 && stats.entries == 1);
+    printf("  ✓ Prefetch resolved once in the background; numeric hosts skip the cache\n");
+
+    // Past the TTL a prefetch refreshes
+    assert(discord_dns_configure(1000, 5000) == DISCORD_OK);
+    advance_ms(2000);
+    assert(discord_dns_prefetch("localhost") == DISCORD_OK);
+    wait_for_lookups(before.lookups + 2);
+    printf("  ✓ Expired entries refreshed\n");
+
+    assert(discord_dns_flush() == DISCORD_OK);
+    discord_connect_get_stats(&stats);
+    assert(stats.entries == 0);
+    printf("  ✓ Flush empties the cache\n");
+}
+
+void test_invalid_urls() {
+    printf("Testing URL validation...\n");
+
+    static const char* bad[] = {
+        "http://gateway.discord.gg/",
+        "wss://gateway.discord.gg:99999/",
+        "wss://gateway.discord.gg:0/",
+        "wss://gateway.discord.gg:/",
+        "wss://gateway.discord.gg:44x/",
+        "wss://:443/",
+        "wss://[::1/",
+        "wss://",
+    };
+    discord_ws_options_t options = { DISCORD_WS_TRANSPORT_URING, 1, 0, 0 };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        discord_ws_standby_t* standby = NULL;
+        assert(discord_ws_prewarm(bad[i], &options, &standby) == DISCORD_ERROR_INVALID_PARAM);
+        assert(standby == NULL);
+    }
+    printf("  ✓ %zu malformed URLs rejected before connecting\n", sizeof(bad) / sizeof(bad[0]));
+}
+
+static int connect_port = 0;
+
+static void* connect_one(void* arg) {
+    discord_gateway_t** gateway = arg;
+    char url[128];
+    snprintf(url, sizeof(url), "ws://localhost:%d/?v=10&encoding=json", connect_port);
+    discord_ws_options_t options = { DISCORD_WS_TRANSPORT_URING, 1, 0, 1 };
+    assert(discord_ws_connect_ex(url, &options, gateway) == DISCORD_OK);
+    return NULL;
+}
+
+void test_connect_timing() {
+    printf("Testing connects through the cache...\n");
+
+    server_t server;
+    pthread_t thread;
+    start_server(&server, &thread);
+    connect_port = server.port;
+    discord_dns_flush();
+
+    discord_connect_stats_t before, stats;
+    discord_connect_get_stats(&before);
+
+    // A burst of connects to one host shares a single lookup
+    enum { CLIENTS = 8 };
+    discord_gateway_t* gateways[CLIENTS];
+    pthread_t clients[CLIENTS];
+    for (int i = 0; i < CLIENTS; i++) {
+        pthread_create(&clients[i], NULL, connect_one, &gateways[i]);
+    }
+    for (int i = 0; i < CLIENTS; i++) {
+        pthread_join(clients[i], NULL);
+    }
+    discord_connect_get_stats(&stats);
+    assert(stats.lookups == before.lookups + 1);
+    assert(stats.hits + stats.joined - before.hits - before.joined == CLIENTS - 1);
+    printf("  ✓ %d concurrent connects, 1 lookup (%llu joined it, %llu cache hits)\n", CLIENTS,
+           (unsigned long long)(stats.joined - before.joined), (unsigned long long)(stats.hits - before.hits));
+
+    int cached = 0;
+    for (int i = 0; i < CLIENTS; i++) {
+        expect_hello(gateways[i]);
+        discord_connect_timing_t timing;
+        assert(discord_ws_get_connect_timing(gateways[i], &timing) == DISCORD_OK);
+        assert(timing.tcp_ns > 0 && timing.upgrade_ns > 0 && timing.tls_ns == 0);
+        assert(!timing.prewarmed && !timing.tls_resumed);
+        assert(timing.dns_cached || timing.dns_ns > 0);
+        cached += timing.dns_cached;
+        // The loopback listener has no Fast Open cookie to hand out
+        assert(timing.fastopen == 0);
+        discord_ws_close(gateways[i]);
+    }
+    assert(cached == CLIENTS - 1 - (int)(stats.joined - before.joined));
+    printf("  ✓ TCP and upgrade timed on every connect, Fast Open requested\n");
+
+    // Past the TTL but inside the stale window: answered at once, refreshed behind
+    assert(discord_dns_configure(1000, 60000) == DISCORD_OK);
+    advance_ms(5000);
+    discord_gateway_t* gateway = NULL;
+    connect_one(&gateway);
+    discord_connect_timing_t timing;
+    discord_ws_get_connect_timing(gateway, &timing);
+    assert(timing.dns_cached && timing.dns_ns == 0);
+    discord_connect_get_stats(&stats);
+    assert(stats.stale_hits == before.stale_hits + 1);
+    wait_for_lookups(before.lookups + 2);
+    expect_hello(gateway);
+    discord_ws_close(gateway);
+    printf("  ✓ Stale entry served while it was refreshed\n");
+
+    discord_dns_configure(DISCORD_DNS_TTL_MS, DISCORD_DNS_STALE_MS);
+    stop_server(&server, thread);
+}
+
+void test_standby() {
+    printf("Testing standby connections...\n");
+
+    server_t server;
+    pthread_t thread;
+    start_server(&server, &thread);
+    char url[128];
+    snprintf(url, sizeof(url), "ws://localhost:%d/?v=10&encoding=json", server.port);
+    discord_ws_options_t options = { DISCORD_WS_TRANSPORT_URING, 1, 0, 0 };
+
+    discord_connect_stats_t before, stats;
+    discord_connect_get_stats(&before);
+
+    discord_ws_standby_t* standby = NULL;
+    assert(discord_ws_prewarm(url, &options, &standby) == DISCORD_OK);
+    discord_gateway_t* gateway = NULL;
+    assert(discord_ws_standby_take(standby, &gateway) == DISCORD_OK);
+    expect_hello(gateway);
+    discord_connect_timing_t timing;
+    discord_ws_get_connect_timing(gateway, &timing);
+    assert(timing.prewarmed && timing.upgrade_ns > 0);
+    discord_ws_close(gateway);
+    printf("  ✓ Taken standby already upgraded, HELLO waiting\n");
+
+    assert(discord_ws_prewarm(url, &options, &standby) == DISCORD_OK);
+    advance_ms(DISCORD_WS_STANDBY_MAX_AGE_MS + 1000);
+    gateway = NULL;
+    assert(discord_ws_standby_take(standby, &gateway) == DISCORD_ERROR_TIMEOUT);
+    assert(gateway == NULL);
+
+    assert(discord_ws_prewarm(url, &options, &standby) == DISCORD_OK);
+    discord_ws_standby_close(standby);
+
+    discord_connect_get_stats(&stats);
+    assert(stats.standbys_opened - before.standbys_opened == 3);
+    assert(stats.standbys_used - before.standbys_used == 1);
+    assert(stats.standbys_expired - before.standbys_expired == 2);
+    printf("  ✓ Old standbys closed instead of used; unused ones counted\n");
+
+    stop_server(&server, thread);
+}
+
+static discord_shard_t* create_shard(int shard_id, int prewarm) {
+    static const discord_ws_options_t sim_transport = { DISCORD_WS_TRANSPORT_SIM, 0, 0, 0 };
+    discord_shard_config_t config = {0};
+    config.token = "sim-token";
+    config.url = "wss://gateway.discord.gg/?v=10&encoding=json";
+    config.shard_id = shard_id;
+    config.shard_count = 2;
+    config.ws = &sim_transport;
+    config.prewarm = prewarm;
+    discord_shard_t* shard = NULL;
+    assert(discord_shard_create(&config, &shard) == DISCORD_OK);
+    return shard;
+}
+
+void test_prewarmed_shards() {
+    printf("Testing prewarmed shards on the simulated gateway...\n");
+
+    discord_sim_config_t config = {0};
+    config.latency_ms = 20;
+    config.handshake_ms = 150;
+    config.heartbeat_interval_ms = 1000;
+    config.reconnect_permille = 50;
+    discord_sim_t* sim;
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+
+    discord_shard_t* shards[2] = { create_shard(0, 0), create_shard(1, 1) };
+    assert(discord_sim_run(sim, shards, 2, 600000) == DISCORD_OK);
+
+    discord_shard_stats_t cold, warm;
+    discord_shard_get_stats(shards[0], &cold);
+    discord_shard_get_stats(shards[1], &warm);
+    assert(cold.reconnects_requested > 0 && warm.reconnects_requested > 0);
+    assert(cold.standbys_used == 0 && cold.state == DISCORD_SHARD_READY);
+    assert(warm.standbys_used > 0 && warm.state == DISCORD_SHARD_READY);
+
+    // Both last went through a RESUME after op 7
+    assert(!cold.last_connect.prewarmed && warm.last_connect.prewarmed);
+    assert(cold.last_connect.hello_ns == (150 + 20) * 1000000ULL);
+    assert(warm.last_connect.hello_ns == 0);
+    assert(cold.last_connect.ready_ns == 40 * 1000000ULL && warm.last_connect.ready_ns == 40 * 1000000ULL);
+    assert(warm.last_connect.total_ns < cold.last_connect.total_ns);
+    printf("  ✓ op 7 resumed over a standby: %.0f ms to RESUMED instead of %.0f ms (%llu of %llu reconnects)\n",
+           (double)warm.last_connect.total_ns / 1e6, (double)cold.last_connect.total_ns / 1e6,
+           (unsigned long long)warm.standbys_used, (unsigned long long)warm.reconnects_requested);
+
+    discord_shard_destroy(shards[0]);
+    discord_shard_destroy(shards[1]);
+    discord_sim_destroy(sim);
+}
+
+int main() {
+    printf("Discord ASM Bot - Connect Pipeline Tests\n");
+    printf("========================================\n\n");
+
+    discord_clock_t clock = { test_now_ns, test_sleep_ms, NULL };
+
+    test_invalid_urls();
+    printf("\n");
+
+    assert(discord_set_clock(&clock) == DISCORD_OK);
+
+    test_dns_cache();
+    printf("\n");
+
+    test_connect_timing();
+    printf("\n");
+
+    test_standby();
+    printf("\n");
+
+    // The simulator brings its own clock
+    discord_dns_flush();
+    discord_set_clock(NULL);
+
+    test_prewarmed_shards();
+    printf("\n");
+
+    size_t live = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        live += stats.live_bytes;
+    }
+    assert(live == 0);
+
+    printf("All connect pipeline tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "abi.h"
+#include "coord.h"
+#include "shard.h"
+
+// The coordinator runs on a thread of the test process, clients on the
+// main thread; a forked child stands in for a process that dies. Time is
+// a test clock, so the slots granted are exact.
+
+static char socket_path[64];
+static uint64_t now_ns = 1000000000ULL;
+static uint64_t slept_ms = 0;
+
+static discord_coord_server_t* server = NULL;
+static pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t server_thread;
+static volatile int server_stop = 0;
+
+static uint64_t test_now_ns(void* user) {
+    (void)user;
+    return __atomic_load_n(&now_ns, __ATOMIC_ACQUIRE);
+}
+
+static void test_sleep_ms(void* user, uint32_t milliseconds) {
+    (void)user;
+    slept_ms += milliseconds;
+    __atomic_add_fetch(&now_ns, (uint64_t)milliseconds * 1000000, __ATOMIC_ACQ_REL);
+}
+
+static void* serve(void* arg) {
+    (void)arg;
+    while (!server_stop) {
+        pthread_mutex_lock(&server_lock);
+        discord_coord_server_poll(server, 5);
+        pthread_mutex_unlock(&server_lock);
+    }
+    return NULL;
+}
+
+static void start_server(uint32_t shard_count, uint32_t max_concurrency, uint32_t processes) {
+    discord_coord_server_config_t config = { socket_path, shard_count, max_concurrency, processes, 0 };
+    assert(discord_coord_server_create(&config, &server) == DISCORD_OK);
+    server_stop = 0;
+    assert(pthread_create(&server_thread, NULL, serve, NULL) == 0);
+}
+
+static void stop_server(void) {
+    server_stop = 1;
+    pthread_join(server_thread, NULL);
+    discord_coord_server_destroy(server);
+    server = NULL;
+}
+
+static discord_coord_server_stats_t server_stats(void) {
+    discord_coord_server_stats_t stats;
+    pthread_mutex_lock(&server_lock);
+    assert(discord_coord_server_get_stats(server, &stats) == DISCORD_OK);
+    pthread_mutex_unlock(&server_lock);
+    return stats;
+}
+
+// Wait for the next assignment and check it against a mask of shards;
+// the coordinator answers within milliseconds
+static void expect_assignment(discord_coord_t* coord, uint32_t mask) {
+    assert(discord_coord_poll(coord, 2000) == DISCORD_OK);
+    discord_coord_assignment_t assignment;
+    assert(discord_coord_get_assignment(coord, &assignment) == DISCORD_OK);
+    uint32_t owned = 0;
+    for (int shard = 0; shard < (int)assignment.shard_count; shard++) {
+        if (discord_coord_owns(coord, shard)) {
+            owned |= 1u << shard;
+        }
+    }
+    assert(owned == mask && assignment.owned == (uint32_t)__builtin_popcount(mask));
+}
+
+// Shards first..first+count-1
+static uint32_t range(int first, int count) {
+    return ((1u << count) - 1) << first;
+}
+
+void test_assignment() {
+    printf("Testing shard assignment...\n");
+
+    discord_coord_server_config_t bad = { socket_path, 0, 1, 1, 0 };
+    discord_coord_server_t* unused = NULL;
+    assert(discord_coord_server_create(&bad, &unused) == DISCORD_ERROR_INVALID_PARAM);
+    discord_coord_t* coord = NULL;
+    assert(discord_coord_connect(socket_path, &coord) == DISCORD_ERROR_NETWORK);
+
+    start_server(10, 2, 2);
+    discord_coord_t* a = NULL;
+    discord_coord_t* b = NULL;
+    assert(discord_coord_connect(socket_path, &a) == DISCORD_OK);
+    assert(discord_coord_poll(a, 50) == DISCORD_ERROR_TIMEOUT);
+    discord_coord_assignment_t assignment;
+    assert(discord_coord_get_assignment(a, &assignment) == DISCORD_OK);
+    assert(assignment.shard_count == 10 && assignment.max_concurrency == 2 && assignment.owned == 0);
+    printf("  ✓ Nothing is assigned before the expected processes have connected\n");
+
+    assert(discord_coord_connect(socket_path, &b) == DISCORD_OK);
+    expect_assignment(a, range(0, 5));
+    expect_assignment(b, range(5, 5));
+    discord_coord_server_stats_t stats = server_stats();
+    assert(stats.processes == 2 && stats.shards_assigned == 10 && stats.joins == 2);
+    assert(stats.assigned_ms == discord_time_now_ms());
+    printf("  ✓ Shards are split in contiguous ranges\n");
+
+    discord_coord_close(a);
+    discord_coord_close(b);
+    stop_server();
+}
+
+void test_identify_slots() {
+    printf("Testing identify slots...\n");
+
+    start_server(10, 2, 2);
+    discord_coord_t* a = NULL;
+    discord_coord_t* b = NULL;
+    assert(discord_coord_connect(socket_path, &a) == DISCORD_OK);
+    assert(discord_coord_connect(socket_path, &b) == DISCORD_OK);
+    expect_assignment(a, range(0, 5));
+    expect_assignment(b, range(5, 5));
+
+    uint64_t now = discord_time_now_ms();
+    uint64_t at = 0;
+    assert(discord_coord_acquire(a, 0, now, &at) == DISCORD_OK && at == now);
+    assert(discord_coord_acquire(a, 2, now, &at) == DISCORD_ERROR_TIMEOUT);
+    assert(at == now + DISCORD_IDENTIFY_WINDOW_MS);
+    assert(discord_coord_acquire(b, 5, now, &at) == DISCORD_OK);
+    assert(discord_coord_acquire(b, 6, now, &at) == DISCORD_ERROR_TIMEOUT);
+    assert(at == now + 2 * DISCORD_IDENTIFY_WINDOW_MS);
+    printf("  ✓ One IDENTIFY per bucket per window across processes\n");
+
+    assert(discord_coord_acquire(a, 5, now, &at) == DISCORD_ERROR_NOT_FOUND);
+    assert(discord_coord_acquire(a, 10, now, &at) == DISCORD_ERROR_NOT_FOUND);
+    discord_coord_server_stats_t stats = server_stats();
+    assert(stats.grants == 4 && stats.grants_delayed == 2 && stats.denied == 2);
+    printf("  ✓ Shards owned by another process are refused\n");
+
+    for (int shard = 0; shard < 10; shard++) {
+        assert(discord_coord_report_ready(shard < 5 ? a : b, shard) == DISCORD_OK);
+    }
+    // A reply comes after everything sent before it was handled
+    discord_coord_acquire(a, 9, now, &at);
+    stats = server_stats();
+    assert(stats.shards_ready == 10 && stats.all_ready_ms == discord_time_now_ms());
+    __atomic_add_fetch(&now_ns, 1000000, __ATOMIC_ACQ_REL);
+    assert(discord_coord_acquire(a, 4, now, &at) == DISCORD_ERROR_TIMEOUT);
+    stats = server_stats();
+    assert(stats.shards_ready == 9 && stats.all_ready_ms == 0);
+    printf("  ✓ READY reports count until the shard identifies again\n");
+
+    discord_coord_close(a);
+    discord_coord_close(b);
+    stop_server();
+}
+
+void test_rebalance() {
+    printf("Testing rebalancing...\n");
+
+    start_server(12, 1, 3);
+    discord_coord_t* a = NULL;
+    discord_coord_t* b = NULL;
+    assert(discord_coord_connect(socket_path, &a) == DISCORD_OK);
+    assert(discord_coord_connect(socket_path, &b) == DISCORD_OK);
+
+    // The third process dies after getting its shards
+    int ready_pipe[2];
+    assert(pipe(ready_pipe) == 0);
+    pid_t child = fork();
+    if (child == 0) {
+        discord_coord_t* c = NULL;
+        if (discord_coord_connect(socket_path, &c) != DISCORD_OK || discord_coord_poll(c, 2000) != DISCORD_OK ||
+            !discord_coord_owns(c, 8) || discord_coord_report_ready(c, 8) != DISCORD_OK) {
+            _exit(1);
+        }
+        char done = 1;
+        if (write(ready_pipe[1], &done, 1) != 1) {
+            _exit(1);
+        }
+        pause();
+        _exit(0);
+    }
+    char done = 0;
+    assert(read(ready_pipe[0], &done, 1) == 1 && done == 1);
+    expect_assignment(a, range(0, 4));
+    expect_assignment(b, range(4, 4));
+    kill(child, SIGKILL);
+    int status;
+    assert(waitpid(child, &status, 0) == child);
+    close(ready_pipe[0]);
+    close(ready_pipe[1]);
+
+    expect_assignment(a, range(0, 4) | range(8, 2));
+    expect_assignment(b, range(4, 4) | range(10, 2));
+    discord_coord_server_stats_t stats = server_stats();
+    assert(stats.processes == 2 && stats.leaves == 1 && stats.shards_moved == 4 && stats.shards_ready == 0);
+    printf("  ✓ The shards of a process that died go to the others\n");
+
+    // A late joiner takes shards only after their owner let go of them
+    discord_coord_t* d = NULL;
+    assert(discord_coord_connect(socket_path, &d) == DISCORD_OK);
+    expect_assignment(a, range(0, 4));
+    expect_assignment(b, range(4, 4));
+    assert(discord_coord_poll(d, 50) == DISCORD_ERROR_TIMEOUT);
+    uint64_t at;
+    assert(discord_coord_acquire(d, 8, discord_time_now_ms(), &at) == DISCORD_ERROR_NOT_FOUND);
+    assert(discord_coord_acquire(a, 8, discord_time_now_ms(), &at) == DISCORD_ERROR_NOT_FOUND);
+
+    assert(discord_coord_confirm(a) == DISCORD_OK);
+    expect_assignment(d, range(8, 2));
+    assert(discord_coord_confirm(b) == DISCORD_OK);
+    expect_assignment(d, range(8, 4));
+    stats = server_stats();
+    assert(stats.shards_moved == 8 && stats.shards_assigned == 12);
+    printf("  ✓ A process joining later takes shards once their owners confirm\n");
+
+    discord_coord_close(a);
+    discord_coord_close(b);
+    discord_coord_close(d);
+    stop_server();
+}
+
+void test_identify_slot() {
+    printf("Testing the gateway loop hook...\n");
+
+    uint64_t at = 0;
+    int shard_id = -1, shard_count = -1;
+    assert(discord_coord_identify_slot(&at) == DISCORD_OK && at == discord_time_now_ms());
+    assert(discord_coord_identify_slot(NULL) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_coord_identify_shard(&shard_id, &shard_count) == DISCORD_OK);
+    assert(shard_id == 0 && shard_count == 0);
+    assert(discord_coord_identify_shard(NULL, &shard_count) == DISCORD_ERROR_INVALID_PARAM);
+    start_server(2, 1, 1);
+    discord_coord_t* coord = NULL;
+    assert(discord_coord_connect(socket_path, &coord) == DISCORD_OK);
+    expect_assignment(coord, range(0, 2));
+
+    // The loop builds IDENTIFY from the attached pair
+    assert(discord_coord_attach(coord, 1) == DISCORD_OK);
+    assert(discord_coord_identify_shard(&shard_id, &shard_count) == DISCORD_OK);
+    assert(shard_id == 1 && shard_count == 2);
+    char* identify = NULL;
+    assert(discord_json_create_identify_sharded("token", shard_id, shard_count, &identify) == DISCORD_OK);
+    assert(strstr(identify, "\"shard\":[1,2]") != NULL);
+    discord_json_free(identify);
+    printf("  ✓ IDENTIFY carries the attached shard and the assignment's shard count\n");
+
+    assert(discord_coord_attach(coord, 0) == DISCORD_OK);
+
+    slept_ms = 0;
+    uint64_t now = discord_time_now_ms();
+    assert(discord_coord_identify_slot(&at) == DISCORD_OK && at == now);
+    assert(discord_coord_identify_slot(&at) == DISCORD_OK && at == now + DISCORD_IDENTIFY_WINDOW_MS);
+    assert(slept_ms == 0);
+    printf("  ✓ The second IDENTIFY is scheduled a window later without blocking\n");
+
+    // A shard this process does not own must not IDENTIFY
+    assert(discord_coord_attach(coord, 5) == DISCORD_OK);
+    assert(discord_coord_identify_slot(&at) == DISCORD_ERROR_NOT_FOUND);
+    assert(discord_coord_attach(coord, 0) == DISCORD_OK);
+    printf("  ✓ Shards not owned are refused\n");
+
+    // Closing detaches; the coordinator going away does not block IDENTIFY
+    discord_coord_close(coord);
+    assert(discord_coord_identify_slot(&at) == DISCORD_OK && at == discord_time_now_ms());
+    assert(discord_coord_identify_shard(&shard_id, &shard_count) == DISCORD_OK && shard_count == 0);
+    assert(discord_coord_connect(socket_path, &coord) == DISCORD_OK);
+    expect_assignment(coord, range(0, 2));
+    discord_coord_attach(coord, 0);
+    stop_server();
+    assert(discord_coord_poll(coord, 100) == DISCORD_ERROR_NETWORK);
+    assert(discord_coord_identify_slot(&at) == DISCORD_ERROR_NETWORK && at == discord_time_now_ms());
+    discord_coord_close(coord);
+    printf("  ✓ Detached or unreachable coordinators do not hold IDENTIFY back\n");
+}
+
+int main() {
+    printf("Discord ASM Bot - Shard Coordinator Tests\n");
+    printf("=========================================\n\n");
+
+    snprintf(socket_path, sizeof(socket_path), "/tmp/discord-coord-test-%d.sock", (int)getpid());
+    discord_clock_t clock = { test_now_ns, test_sleep_ms, NULL };
+    assert(discord_set_clock(&clock) == DISCORD_OK);
+
+    test_assignment();
+    printf("\n");
+
+    test_identify_slots();
+    printf("\n");
+
+    test_rebalance();
+    printf("\n");
+
+    test_identify_slot();
+    printf("\n");
+
+    discord_set_clock(NULL);
+    assert(access(socket_path, F_OK) != 0);
+
+    size_t live = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        live += stats.live_bytes;
+    }
+    assert(live == 0);
+
+    printf("All shard coordinator tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,457 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "fanout.h"
+
+// Publisher and consumers share the ring through a file in /tmp (or a
+// memfd on Linux); forked children stand in for worker processes.
+
+#define SMALL_RING  (64u << 10)
+
+static char ring_path[64];
+
+static void make_path(void) {
+    snprintf(ring_path, sizeof(ring_path), "/tmp/discord-fanout-test-%d", (int)getpid());
+}
+
+// Payload n: its length and bytes are derived from n, so a consumer can
+// check every event it gets
+static size_t payload(uint64_t n, char* buffer) {
+    size_t length = 16 + (size_t)(n * 37 % 700);
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = (char)('a' + (n + i) % 26);
+    }
+    return length;
+}
+
+static void publish_payload(discord_fanout_t* fanout, uint64_t n, discord_result_t expected) {
+    char buffer[1024];
+    discord_event_t event = { 0, buffer, payload(n, buffer), (int)n, "MESSAGE_CREATE" };
+    assert(discord_fanout_publish(fanout, &event) == expected);
+}
+
+static void check_payload(const discord_fanout_event_t* event) {
+    char buffer[1024];
+    size_t length = payload((uint64_t)event->event.sequence, buffer);
+    assert(event->event.data_length == length);
+    assert(memcmp(event->event.data, buffer, length) == 0);
+    assert(event->event.data[length] == '\0');
+    assert(strcmp(event->event.event_type, "MESSAGE_CREATE") == 0);
+}
+
+void test_publish_and_receive() {
+    printf("Testing publish and receive...\n");
+
+    discord_fanout_t* fanout = NULL;
+    assert(discord_fanout_create(ring_path, NULL, &fanout) == DISCORD_OK);
+
+    discord_fanout_consumer_t* consumer = NULL;
+    assert(discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_BLOCK, &consumer) == DISCORD_OK);
+
+    discord_fanout_event_t event;
+    assert(discord_fanout_next(consumer, 0, &event) == DISCORD_ERROR_TIMEOUT);
+    assert(discord_fanout_next(consumer, 20, &event) == DISCORD_ERROR_TIMEOUT);
+
+    discord_event_t hello = { 10, "{\"heartbeat_interval\":41250}", 28, -1, NULL };
+    discord_event_t ready = { 0, "{\"v\":10}", 8, 1, "READY" };
+    assert(discord_fanout_publish(fanout, &hello) == DISCORD_OK);
+    assert(discord_fanout_publish(fanout, &ready) == DISCORD_OK);
+
+    assert(discord_fanout_next(consumer, 0, &event) == DISCORD_OK);
+    assert(event.index == 0 && event.event.opcode == 10 && event.event.sequence == -1);
+    assert(strcmp(event.event.event_type, "") == 0);
+    assert(strcmp(event.event.data, "{\"heartbeat_interval\":41250}") == 0);
+    assert(event.published_ns > 0 && event.published_ns <= discord_time_now_ns());
+
+    assert(discord_fanout_next(consumer, 0, &event) == DISCORD_OK);
+    assert(event.index == 1 && event.event.opcode == 0 && event.event.sequence == 1);
+    assert(strcmp(event.event.event_type, "READY") == 0);
+    assert(event.event.data_length == 8 && strcmp(event.event.data, "{\"v\":10}") == 0);
+    assert(discord_fanout_release(consumer) == DISCORD_OK);
+    assert(discord_fanout_next(consumer, 0, &event) == DISCORD_ERROR_TIMEOUT);
+    printf("  ✓ Events arrive in order as views with type, sequence and timestamp\n");
+
+    discord_fanout_stats_t stats;
+    assert(discord_fanout_get_stats(fanout, &stats) == DISCORD_OK);
+    assert(stats.published == 2 && stats.consumers == 1 && stats.dropped == 0);
+
+    discord_fanout_consumer_stats_t consumer_stats;
+    assert(discord_fanout_consumer_get_stats(consumer, &consumer_stats) == DISCORD_OK);
+    assert(consumer_stats.received == 2 && consumer_stats.lost == 0 && consumer_stats.lag_bytes == 0);
+
+    discord_fanout_consumer_close(consumer);
+    assert(discord_fanout_get_stats(fanout, &stats) == DISCORD_OK);
+    assert(stats.consumers == 0);
+    printf("  ✓ Publisher and consumer counters\n");
+
+    // Bad input
+    discord_fanout_config_t bad = { 100000, 0, 0 };
+    discord_fanout_t* other = NULL;
+    assert(discord_fanout_create(ring_path, &bad, &other) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_fanout_consumer_open("/tmp/discord-fanout-missing", DISCORD_FANOUT_BLOCK,
+                                        &consumer) == DISCORD_ERROR_NOT_FOUND);
+    discord_event_t huge = { 0, NULL, DISCORD_FANOUT_CAPACITY_DEFAULT / 2, 0, "X" };
+    huge.data = calloc(1, huge.data_length);
+    assert(discord_fanout_publish(fanout, &huge) == DISCORD_ERROR_MEMORY);
+    free(huge.data);
+    printf("  ✓ Invalid capacity, missing ring and oversized events rejected\n");
+
+    discord_fanout_destroy(fanout);
+    unlink(ring_path);
+}
+
+void test_wraparound() {
+    printf("Testing wraparound...\n");
+
+    discord_fanout_config_t config = { SMALL_RING, 0, 0 };
+    discord_fanout_t* fanout = NULL;
+    assert(discord_fanout_create(ring_path, &config, &fanout) == DISCORD_OK);
+    discord_fanout_consumer_t* consumer = NULL;
+    assert(discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_BLOCK, &consumer) == DISCORD_OK);
+
+    // Bursts of varying sizes keep the ring wrapping at odd offsets
+    uint64_t published = 0, received = 0;
+    discord_fanout_event_t event;
+    for (int round = 0; round < 400; round++) {
+        int burst = 1 + round % 40;
+        for (int i = 0; i < burst; i++) {
+            publish_payload(fanout, published++, DISCORD_OK);
+        }
+        while (discord_fanout_next(consumer, 0, &event) == DISCORD_OK) {
+            assert(event.index == received);
+            check_payload(&event);
+            received++;
+        }
+    }
+    assert(received == published);
+
+    discord_fanout_stats_t stats;
+    discord_fanout_get_stats(fanout, &stats);
+    assert(stats.bytes > 10 * SMALL_RING && stats.dropped == 0);
+    printf("  ✓ %llu events through a 64 KiB ring (%llu bytes) intact and in order\n",
+           (unsigned long long)received, (unsigned long long)stats.bytes);
+
+    discord_fanout_consumer_close(consumer);
+    discord_fanout_destroy(fanout);
+    unlink(ring_path);
+}
+
+void test_backpressure_and_drop() {
+    printf("Testing backpressure and drop consumers...\n");
+
+    discord_fanout_config_t config = { SMALL_RING, 0, 10 };
+    discord_fanout_t* fanout = NULL;
+    assert(discord_fanout_create(ring_path, &config, &fanout) == DISCORD_OK);
+    discord_fanout_consumer_t* slow = NULL;
+    discord_fanout_consumer_t* lossy = NULL;
+    assert(discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_BLOCK, &slow) == DISCORD_OK);
+    assert(discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_DROP, &lossy) == DISCORD_OK);
+
+    // The BLOCK consumer reads nothing: the ring fills, then publishes time out
+    uint64_t n = 0;
+    char buffer[1024];
+    for (;;) {
+        discord_event_t event = { 0, buffer, payload(n, buffer), (int)n, "MESSAGE_CREATE" };
+        discord_result_t result = discord_fanout_publish(fanout, &event);
+        if (result == DISCORD_ERROR_TIMEOUT) {
+            break;
+        }
+        assert(result == DISCORD_OK);
+        n++;
+    }
+    discord_fanout_stats_t stats;
+    discord_fanout_get_stats(fanout, &stats);
+    assert(stats.dropped == 1 && stats.waits == 1 && stats.published == n);
+
+    discord_fanout_event_t event;
+    uint64_t drained = 0;
+    while (discord_fanout_next(slow, 0, &event) == DISCORD_OK) {
+        assert(event.index == drained);
+        check_payload(&event);
+        drained++;
+    }
+    assert(drained == n);
+    printf("  ✓ A full ring held %llu events for the BLOCK consumer, then dropped after the timeout\n",
+           (unsigned long long)n);
+
+    // With the BLOCK consumer gone the publisher laps the DROP consumer
+    discord_fanout_consumer_close(slow);
+    for (int i = 0; i < 2000; i++) {
+        publish_payload(fanout, n++, DISCORD_OK);
+    }
+    discord_fanout_get_stats(fanout, &stats);
+    assert(stats.dropped == 1 && stats.waits == 1);
+
+    uint64_t received = 0, last = 0;
+    while (discord_fanout_next(lossy, 0, &event) == DISCORD_OK) {
+        assert(received == 0 || event.index == last + 1);
+        check_payload(&event);
+        last = event.index;
+        received++;
+    }
+    discord_fanout_consumer_stats_t consumer_stats;
+    discord_fanout_consumer_get_stats(lossy, &consumer_stats);
+    assert(last == n - 1);
+    assert(consumer_stats.lost > 0 && consumer_stats.received + consumer_stats.lost == n);
+    printf("  ✓ The DROP consumer skipped %llu overwritten events and read the last %llu\n",
+           (unsigned long long)consumer_stats.lost, (unsigned long long)received);
+
+    // Holding an event while being lapped is reported at release
+    publish_payload(fanout, n++, DISCORD_OK);
+    assert(discord_fanout_next(lossy, 0, &event) == DISCORD_OK);
+    for (int i = 0; i < 500; i++) {
+        publish_payload(fanout, n++, DISCORD_OK);
+    }
+    assert(discord_fanout_release(lossy) == DISCORD_ERROR_NOT_FOUND);
+    assert(discord_fanout_next(lossy, 0, &event) == DISCORD_OK);
+    check_payload(&event);
+    printf("  ✓ An overrun while holding an event is reported at release\n");
+
+    discord_fanout_consumer_close(lossy);
+    discord_fanout_destroy(fanout);
+    unlink(ring_path);
+}
+
+// Child: read count events, verify each, exit 0 on success
+static int consume_in_child(discord_fanout_consumer_t* consumer, uint64_t count) {
+    discord_fanout_event_t event;
+    for (uint64_t i = 0; i < count; i++) {
+        if (discord_fanout_next(consumer, 5000, &event) != DISCORD_OK || event.index != i) {
+            return 1;
+        }
+        char buffer[1024];
+        size_t length = payload((uint64_t)event.event.sequence, buffer);
+        if (event.event.data_length != length || memcmp(event.event.data, buffer, length) != 0) {
+            return 2;
+        }
+    }
+    return discord_fanout_next(consumer, -1, &event) == DISCORD_ERROR_NETWORK ? 0 : 3;
+}
+
+void test_processes() {
+    printf("Testing worker processes...\n");
+
+    // An anonymous memfd inherited over fork on Linux, the file elsewhere
+    discord_fanout_config_t config = { SMALL_RING, 0, 5000 };
+    discord_fanout_t* fanout = NULL;
+#ifdef __linux__
+    assert(discord_fanout_create(NULL, &config, &fanout) == DISCORD_OK);
+    int fd = discord_fanout_fd(fanout);
+#else
+    assert(discord_fanout_create(ring_path, &config, &fanout) == DISCORD_OK);
+    int fd = -1;
+#endif
+
+    // A worker that dies holding a BLOCK slot must not stall the publisher
+    pid_t crashed = fork();
+    assert(crashed >= 0);
+    if (crashed == 0) {
+        discord_fanout_consumer_t* consumer = NULL;
+        if (fd >= 0) {
+            discord_fanout_consumer_open_fd(fd, DISCORD_FANOUT_BLOCK, &consumer);
+        } else {
+            discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_BLOCK, &consumer);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    assert(waitpid(crashed, &status, 0) == crashed);
+
+    // Workers attach before the publisher starts, so they see every event
+    enum { WORKERS = 4, EVENTS = 20000 };
+    pid_t workers[WORKERS];
+    int pipes[WORKERS][2];
+    for (int w = 0; w < WORKERS; w++) {
+        assert(pipe(pipes[w]) == 0);
+        workers[w] = fork();
+        assert(workers[w] >= 0);
+        if (workers[w] == 0) {
+            discord_fanout_consumer_t* consumer = NULL;
+            discord_result_t result = fd >= 0
+                ? discord_fanout_consumer_open_fd(fd, DISCORD_FANOUT_BLOCK, &consumer)
+                : discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_BLOCK, &consumer);
+            char ready = result == DISCORD_OK ? 1 : 0;
+            (void)!write(pipes[w][1], &ready, 1);
+            _exit(ready ? consume_in_child(consumer, EVENTS) : 4);
+        }
+        char ready = 0;
+        assert(read(pipes[w][0], &ready, 1) == 1 && ready == 1);
+        close(pipes[w][0]);
+        close(pipes[w][1]);
+    }
+
+    for (uint64_t i = 0; i < EVENTS; i++) {
+        publish_payload(fanout, i, DISCORD_OK);
+    }
+    discord_fanout_stats_t stats;
+    discord_fanout_get_stats(fanout, &stats);
+    assert(stats.published == EVENTS && stats.dropped == 0);
+    assert(stats.reclaimed == 1 && stats.consumers == WORKERS);
+    printf("  ✓ The slot of a worker that died without closing was reclaimed\n");
+
+    // Workers see the close once they are through
+    discord_fanout_destroy(fanout);
+    for (int w = 0; w < WORKERS; w++) {
+        assert(waitpid(workers[w], &status, 0) == workers[w]);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    printf("  ✓ %d worker processes each read %d events intact, then saw the ring close\n", WORKERS, EVENTS);
+    unlink(ring_path);
+}
+
+static discord_fanout_consumer_t* attached_consumer = NULL;
+static int typed_calls = 0;
+static int catch_all_calls = 0;
+
+static void on_guild_create(const discord_event_t* event) {
+    (void)event;
+    typed_calls++;
+}
+
+static void on_any(const discord_event_t* event) {
+    (void)event;
+    catch_all_calls++;
+}
+
+void test_attach() {
+    printf("Testing dispatch attach...\n");
+
+    discord_fanout_t* fanout = NULL;
+    assert(discord_fanout_create(ring_path, NULL, &fanout) == DISCORD_OK);
+    assert(discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_DROP, &attached_consumer) == DISCORD_OK);
+    assert(discord_dispatch_on("GUILD_CREATE", on_guild_create) == DISCORD_OK);
+    assert(discord_dispatch_set_handler(on_any) == DISCORD_OK);
+    assert(discord_fanout_attach(fanout) == DISCORD_OK);
+
+    assert(discord_dispatch_frame("{\"op\":0,\"s\":42,\"t\":\"GUILD_CREATE\",\"d\":{\"id\":\"1\"}}") == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":11}") == DISCORD_OK);
+    assert(typed_calls == 1 && catch_all_calls == 1);
+
+    discord_fanout_event_t event;
+    assert(discord_fanout_next(attached_consumer, 0, &event) == DISCORD_OK);
+    assert(event.event.opcode == 0 && event.event.sequence == 42);
+    assert(strcmp(event.event.event_type, "GUILD_CREATE") == 0);
+    assert(strcmp(event.event.data, "{\"id\":\"1\"}") == 0);
+    assert(discord_fanout_next(attached_consumer, 0, &event) == DISCORD_OK);
+    assert(event.event.opcode == 11);
+    printf("  ✓ Frames decoded by discord_dispatch_frame are published\n");
+    printf("  ✓ Events with their own handler are published and handlers still run\n");
+
+    // Detaching leaves the application's handlers in place
+    assert(discord_fanout_attach(NULL) == DISCORD_OK);
+    assert(discord_dispatch_frame("{\"op\":11}") == DISCORD_OK);
+    assert(catch_all_calls == 2);
+    assert(discord_fanout_next(attached_consumer, 0, &event) == DISCORD_ERROR_TIMEOUT);
+    assert(discord_fanout_attach(fanout) == DISCORD_OK);
+    printf("  ✓ Detach keeps the catch-all handler and stops publishing\n");
+
+    // Destroying the ring detaches it and closes it for consumers
+    discord_fanout_destroy(fanout);
+    assert(discord_dispatch_frame("{\"op\":11}") == DISCORD_OK);
+    assert(discord_fanout_next(attached_consumer, 0, &event) == DISCORD_ERROR_NETWORK);
+    discord_fanout_consumer_close(attached_consumer);
+    assert(discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_DROP, &attached_consumer) == DISCORD_ERROR_NETWORK);
+    printf("  ✓ Destroy detaches and consumers see the ring closed\n");
+    discord_dispatch_clear();
+    unlink(ring_path);
+}
+
+#define DISPATCHERS          4
+#define DISPATCHER_EVENTS    2000
+
+static void* dispatch_thread(void* arg) {
+    uint64_t first = (uint64_t)(uintptr_t)arg * DISPATCHER_EVENTS;
+    char buffer[1024];
+    for (uint64_t n = first; n < first + DISPATCHER_EVENTS; n++) {
+        discord_event_t event = { 0, buffer, payload(n, buffer), (int)n, "MESSAGE_CREATE" };
+        assert(discord_dispatch_event(&event) == DISCORD_OK);
+    }
+    return NULL;
+}
+
+void test_concurrent_dispatch() {
+    printf("Testing dispatch from several threads...\n");
+
+    // A small ring, never dropping: publishes from different threads that
+    // overlapped would show up as torn or missing events
+    discord_fanout_config_t config = { SMALL_RING, 0, UINT32_MAX };
+    discord_fanout_t* fanout = NULL;
+    assert(discord_fanout_create(ring_path, &config, &fanout) == DISCORD_OK);
+    discord_fanout_consumer_t* consumer = NULL;
+    assert(discord_fanout_consumer_open(ring_path, DISCORD_FANOUT_BLOCK, &consumer) == DISCORD_OK);
+    assert(discord_fanout_attach(fanout) == DISCORD_OK);
+
+    pthread_t threads[DISPATCHERS];
+    for (int t = 0; t < DISPATCHERS; t++) {
+        assert(pthread_create(&threads[t], NULL, dispatch_thread, (void*)(uintptr_t)t) == 0);
+    }
+
+    static uint8_t seen[DISPATCHERS * DISPATCHER_EVENTS];
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < DISPATCHERS * DISPATCHER_EVENTS; i++) {
+        discord_fanout_event_t event;
+        assert(discord_fanout_next(consumer, 5000, &event) == DISCORD_OK);
+        check_payload(&event);
+        assert(event.event.sequence >= 0 && event.event.sequence < DISPATCHERS * DISPATCHER_EVENTS);
+        assert(!seen[event.event.sequence]);
+        seen[event.event.sequence] = 1;
+    }
+    for (int t = 0; t < DISPATCHERS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    discord_fanout_event_t event;
+    assert(discord_fanout_next(consumer, 0, &event) == DISCORD_ERROR_TIMEOUT);
+    discord_fanout_stats_t stats;
+    assert(discord_fanout_get_stats(fanout, &stats) == DISCORD_OK);
+    assert(stats.published == DISPATCHERS * DISPATCHER_EVENTS && stats.dropped == 0);
+    printf("  ✓ %d threads dispatched %d events each, all published intact and once\n",
+           DISPATCHERS, DISPATCHER_EVENTS);
+
+    discord_fanout_attach(NULL);
+    discord_fanout_consumer_close(consumer);
+    discord_fanout_destroy(fanout);
+    unlink(ring_path);
+}
+
+int main() {
+    printf("Discord ASM Bot - Fan-out Tests\n");
+    printf("===============================\n\n");
+
+    make_path();
+
+    test_publish_and_receive();
+    printf("\n");
+
+    test_wraparound();
+    printf("\n");
+
+    test_backpressure_and_drop();
+    printf("\n");
+
+    test_processes();
+    printf("\n");
+
+    test_attach();
+    printf("\n");
+
+    test_concurrent_dispatch();
+    printf("\n");
+
+    size_t live = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        live += stats.live_bytes;
+    }
+    assert(live == 0);
+
+    printf("All fan-out tests passed! ✓\n");
+    return 0;
+}
@@ -77,6 +77,47 @@ void test_time_monotonic() {
     printf("  ✓ Time measurements are monotonic\n");
 }
 
+// Test clock: time only moves when something sleeps
+static uint64_t virtual_now_ns = 0;
+
+static uint64_t virtual_clock_now(void* user) {
+    (void)user;
+    return virtual_now_ns;
+}
+
+static void virtual_clock_sleep(void* user, uint32_t milliseconds) {
+    (void)user;
+    virtual_now_ns += (uint64_t)milliseconds * 1000000ull;
+}
+
+void test_virtual_clock() {
+    printf("Testing replaceable clock...\n");
+    
+    discord_clock_t invalid = { NULL, NULL, NULL };
+    assert(discord_set_clock(&invalid) == DISCORD_ERROR_INVALID_PARAM);
+    
+    discord_clock_t clock = { virtual_clock_now, virtual_clock_sleep, NULL };
+    assert(discord_set_clock(&clock) == DISCORD_OK);
+    assert(discord_time_now_ms() == 0 && discord_time_now_ns() == 0);
+    
+    // A full Discord heartbeat interval passes without waiting for it
+    const uint32_t heartbeat_interval = 41250;
+    uint64_t last_heartbeat = discord_time_now_ms();
+    discord_sleep_ms(heartbeat_interval - 1);
+    assert(discord_time_now_ms() < last_heartbeat + heartbeat_interval);
+    discord_sleep_ms(1);
+    assert(discord_time_now_ms() == last_heartbeat + heartbeat_interval);
+    printf("  ✓ Heartbeat falls due after %u virtual ms\n", heartbeat_interval);
+    
+    // The test clock is no longer consulted
+    assert(discord_set_clock(NULL) == DISCORD_OK);
+    uint64_t real_start = discord_time_now_ms();
+    discord_sleep_ms(5);
+    assert(discord_time_now_ms() >= real_start + 4);
+    assert(virtual_now_ns == (uint64_t)heartbeat_interval * 1000000ull);
+    printf("  ✓ NULL restores the system clock\n");
+}
+
 int main() {
     printf("Discord ASM Heartbeat Timing Tests\n");
     printf("==================================\n\n");
@@ -90,6 +131,9 @@ int main() {
     test_time_monotonic();
     printf("\n");
     
+    test_virtual_clock();
+    printf("\n");
+    
     printf("All timing tests passed! ✓\n");
     return 0;
 }
\ No newline at end of file
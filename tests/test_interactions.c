@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <openssl/evp.h>
+#include "abi.h"
+#include "interactions.h"
+
+static char public_key_hex[DISCORD_INTERACTIONS_KEY_HEX_LEN + 1];
+static EVP_PKEY* signing_key = NULL;
+
+static void to_hex(const unsigned char* in, size_t len, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0xF];
+    }
+    out[2 * len] = '\0';
+}
+
+// Sign timestamp || body the way Discord does
+static void sign(const char* timestamp, const char* body, char* signature_hex) {
+    char message[512];
+    size_t len = (size_t)snprintf(message, sizeof(message), "%s%s", timestamp, body);
+
+    unsigned char signature[64];
+    size_t signature_len = sizeof(signature);
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+    assert(EVP_DigestSignInit(md, NULL, NULL, NULL, signing_key) == 1);
+    assert(EVP_DigestSign(md, signature, &signature_len, (const unsigned char*)message, len) == 1);
+    EVP_MD_CTX_free(md);
+
+    to_hex(signature, signature_len, signature_hex);
+}
+
+static void generate_key(void) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, NULL);
+    assert(ctx != NULL);
+    assert(EVP_PKEY_keygen_init(ctx) == 1);
+    assert(EVP_PKEY_keygen(ctx, &signing_key) == 1);
+    EVP_PKEY_CTX_free(ctx);
+
+    unsigned char raw[32];
+    size_t raw_len = sizeof(raw);
+    assert(EVP_PKEY_get_raw_public_key(signing_key, raw, &raw_len) == 1);
+    to_hex(raw, raw_len, public_key_hex);
+}
+
+void test_verify_signature() {
+    printf("Testing Ed25519 request verification...\n");
+
+    const char* timestamp = "1700000000";
+    const char* body = "{\"type\":2,\"data\":{\"name\":\"ping\"}}";
+    char signature[DISCORD_INTERACTIONS_SIG_HEX_LEN + 1];
+    sign(timestamp, body, signature);
+
+    assert(discord_interactions_verify(public_key_hex, signature, timestamp, body, strlen(body)) == DISCORD_OK);
+    printf("  ✓ Valid signature accepted\n");
+
+    // Changed body, changed timestamp, flipped signature bit
+    const char* tampered = "{\"type\":2,\"data\":{\"name\":\"pong\"}}";
+    assert(discord_interactions_verify(public_key_hex, signature, timestamp, tampered, strlen(tampered)) == DISCORD_ERROR_AUTH);
+    assert(discord_interactions_verify(public_key_hex, signature, "1700000001", body, strlen(body)) == DISCORD_ERROR_AUTH);
+    signature[0] = signature[0] == '0' ? '1' : '0';
+    assert(discord_interactions_verify(public_key_hex, signature, timestamp, body, strlen(body)) == DISCORD_ERROR_AUTH);
+    printf("  ✓ Tampered body, timestamp and signature rejected\n");
+
+    assert(discord_interactions_verify(public_key_hex, "abcd", timestamp, body, strlen(body)) == DISCORD_ERROR_AUTH);
+    assert(discord_interactions_verify("not-a-key", signature, timestamp, body, strlen(body)) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_interactions_verify(public_key_hex, signature, NULL, body, strlen(body)) == DISCORD_ERROR_INVALID_PARAM);
+    printf("  ✓ Malformed input rejected\n");
+}
+
+void test_respond_outside_handler() {
+    printf("Testing response API outside a handler...\n");
+
+    assert(discord_interactions_response_buffer(64) == NULL);
+    assert(discord_interactions_respond(0) == DISCORD_ERROR_INVALID_PARAM);
+    printf("  ✓ No request bound to this thread\n");
+}
+
+int main() {
+    printf("Discord ASM Interactions Tests\n");
+    printf("==============================\n\n");
+
+    generate_key();
+
+    test_verify_signature();
+    printf("\n");
+
+    test_respond_outside_handler();
+    printf("\n");
+
+    EVP_PKEY_free(signing_key);
+    printf("All interactions tests passed! ✓\n");
+    return 0;
+}
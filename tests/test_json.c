@@ -109,11 +109,21 @@ void test_create_identify() {
     assert(strstr(json, "\"op\":2") != NULL);
     assert(strstr(json, test_token) != NULL);
     assert(strstr(json, "\"intents\"") != NULL);
+    assert(strstr(json, "\"shard\"") == NULL);
     
     printf("  ✓ IDENTIFY message created: %.100s...\n", json);
     
     discord_json_free(json);
     
+    // Sharded IDENTIFY carries [shard_id, shard_count]
+    result = discord_json_create_identify_sharded(test_token, 3, 16, &json);
+    assert(result == DISCORD_OK);
+    assert(strstr(json, "\"shard\":[3,16]") != NULL);
+    discord_json_free(json);
+    assert(discord_json_create_identify_sharded(test_token, 16, 16, &json) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_json_create_identify_sharded(test_token, -1, 16, &json) == DISCORD_ERROR_INVALID_PARAM);
+    printf("  ✓ Sharded IDENTIFY includes the shard pair\n");
+    
     // Test NULL token
     result = discord_json_create_identify(NULL, &json);
     assert(result == DISCORD_ERROR_INVALID_PARAM);
@@ -157,6 +167,28 @@ void test_create_heartbeat() {
     printf("  ✓ NULL parameters rejected correctly\n");
 }
 
+void test_parse_root_int() {
+    printf("Testing top-level integer lookup...\n");
+    
+    // A DM channel's "type":1 comes first but is nested
+    const char* json = "{\"channel\":{\"id\":\"1\",\"type\":1},\"data\":{\"name\":\"type\"},\"type\":2}";
+    int value = 0;
+    discord_result_t result = discord_json_parse_root_int(json, strlen(json), "type", &value);
+    assert(result == DISCORD_OK);
+    assert(value == 2);
+    
+    printf("  ✓ Nested keys and string values skipped\n");
+    
+    const char* ping = "{ \"type\" : 1, \"version\":1}";
+    assert(discord_json_parse_root_int(ping, strlen(ping), "type", &value) == DISCORD_OK);
+    assert(value == 1);
+    assert(discord_json_parse_root_int(ping, strlen(ping), "missing", &value) == DISCORD_ERROR_NOT_FOUND);
+    assert(discord_json_parse_root_int("{\"type\":\"x\"}", 12, "type", &value) == DISCORD_ERROR_JSON);
+    assert(discord_json_parse_root_int(NULL, 0, "type", &value) == DISCORD_ERROR_INVALID_PARAM);
+    
+    printf("  ✓ Missing, non-numeric and NULL input handled\n");
+}
+
 int main() {
     printf("Discord ASM JSON Parsing Tests\n");
     printf("==============================\n\n");
@@ -173,6 +205,9 @@ int main() {
     test_create_heartbeat();
     printf("\n");
     
+    test_parse_root_int();
+    printf("\n");
+    
     printf("All JSON tests passed! ✓\n");
     return 0;
 }
\ No newline at end of file
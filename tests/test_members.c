@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "members.h"
+
+static const char* snapshot_path = "test_members.snap";
+
+static char sent_payloads[8][512];
+static int send_count = 0;
+static int sink_count = 0;
+static int done_count = 0;
+static discord_members_result_t last_result;
+
+static discord_result_t fake_send(void* user, const char* data, size_t length) {
+    (void)user;
+    assert(length < sizeof(sent_payloads[0]));
+    memcpy(sent_payloads[send_count % 8], data, length);
+    sent_payloads[send_count % 8][length] = '\0';
+    send_count++;
+    return DISCORD_OK;
+}
+
+static void count_sink(void* user, const char* guild_id, const char* member, size_t member_length) {
+    (void)user;
+    assert(strcmp(guild_id, "81384788765712384") == 0);
+    assert(member[0] == '{' && member[member_length - 1] == '}');
+    sink_count++;
+}
+
+static void record_done(void* user, const discord_members_result_t* result) {
+    (void)user;
+    last_result = *result;
+    done_count++;
+}
+
+static int build_chunk(char* out, size_t capacity, const char* nonce, int index, int count, int members) {
+    int pos = snprintf(out, capacity, "{\"guild_id\":\"81384788765712384\",\"members\":[");
+    for (int i = 0; i < members; i++) {
+        pos += snprintf(out + pos, capacity - (size_t)pos,
+                        "%s{\"user\":{\"id\":\"%d\",\"username\":\"u\\\"%d\"},\"roles\":[],\"nick\":null}",
+                        i ? "," : "", index * 1000 + i, i);
+    }
+    pos += snprintf(out + pos, capacity - (size_t)pos,
+                    "],\"chunk_index\":%d,\"chunk_count\":%d,\"nonce\":\"%s\"}", index, count, nonce);
+    return pos;
+}
+
+void test_json_iterators() {
+    printf("Testing JSON iterators...\n");
+
+    const char* json = "{ \"a\" : 1, \"b\":\"x,}\\\"\", \"c\":[1,{\"d\":[2]}, \"e\"], \"f\":{} }";
+    const char* end = json + strlen(json);
+    const char* cursor = json;
+    const char* key;
+    const char* value;
+    size_t key_length;
+    size_t value_length;
+
+    assert(discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK);
+    assert(key_length == 1 && key[0] == 'a' && value_length == 1 && value[0] == '1');
+    assert(discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK);
+    assert(key[0] == 'b' && value_length == 7);
+    assert(discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK);
+    assert(key[0] == 'c' && value[0] == '[' && value[value_length - 1] == ']');
+
+    const char* array_end = value + value_length;
+    const char* element;
+    size_t element_length;
+    const char* array_cursor = value;
+    int elements = 0;
+    while (discord_json_array_next(&array_cursor, array_end, &element, &element_length) == DISCORD_OK) {
+        elements++;
+    }
+    assert(elements == 3);
+
+    assert(discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_OK);
+    assert(key[0] == 'f' && value_length == 2);
+    assert(discord_json_object_next(&cursor, end, &key, &key_length, &value, &value_length) == DISCORD_ERROR_NOT_FOUND);
+    printf("  ✓ Objects and arrays walked without copying\n");
+}
+
+void test_request_and_chunks() {
+    printf("Testing request and chunk aggregation...\n");
+
+    discord_members_config_t config = {0};
+    config.send = fake_send;
+    discord_members_t* members = NULL;
+    assert(discord_members_create(&config, &members) == DISCORD_OK);
+
+    discord_members_request_t request = {0};
+    request.guild_id = "81384788765712384";
+    request.sink = count_sink;
+    request.done = record_done;
+
+    char nonce[DISCORD_MEMBERS_NONCE_MAX];
+    assert(discord_members_request(members, &request, nonce) == DISCORD_OK);
+    assert(send_count == 1);
+    assert(strstr(sent_payloads[0], "\"op\":8") != NULL);
+    assert(strstr(sent_payloads[0], "\"guild_id\":\"81384788765712384\"") != NULL);
+    assert(strstr(sent_payloads[0], "\"query\":\"\",\"limit\":0") != NULL);
+    assert(strstr(sent_payloads[0], nonce) != NULL);
+    printf("  ✓ op 8 sent: %s\n", sent_payloads[0]);
+
+    char* chunk = malloc(1 << 20);
+    for (int i = 0; i < 3; i++) {
+        int len = build_chunk(chunk, 1 << 20, nonce, i, 3, i == 2 ? 10 : 1000);
+        assert(discord_members_handle_chunk(members, chunk, (size_t)len) == DISCORD_OK);
+        assert(done_count == (i == 2));
+    }
+    assert(sink_count == 2010);
+    assert(last_result.result == DISCORD_OK);
+    assert(last_result.members == 2010 && last_result.chunks == 3 && last_result.chunk_count == 3);
+    assert(strcmp(last_result.nonce, nonce) == 0);
+    printf("  ✓ 3 chunks streamed 2010 members to the sink\n");
+
+    // A chunk for a finished or unknown nonce is counted, not delivered
+    int len = build_chunk(chunk, 1 << 20, nonce, 0, 1, 5);
+    assert(discord_members_handle_chunk(members, chunk, (size_t)len) == DISCORD_ERROR_NOT_FOUND);
+    assert(sink_count == 2010);
+
+    discord_members_stats_t stats;
+    assert(discord_members_get_stats(members, &stats) == DISCORD_OK);
+    assert(stats.completed == 1 && stats.unmatched == 1 && stats.in_flight == 0);
+    printf("  ✓ Stale chunk ignored\n");
+
+    // user_ids requests and not_found accounting
+    const char* ids[] = { "1", "2" };
+    request.user_ids = ids;
+    request.user_id_count = 2;
+    assert(discord_members_request(members, &request, nonce) == DISCORD_OK);
+    assert(strstr(sent_payloads[1], "\"user_ids\":[\"1\",\"2\"]") != NULL);
+    len = snprintf(chunk, 1 << 20,
+                   "{\"guild_id\":\"81384788765712384\",\"members\":[{\"user\":{\"id\":\"1\"}}],"
+                   "\"chunk_index\":0,\"chunk_count\":1,\"not_found\":[\"2\"],\"nonce\":\"%s\"}", nonce);
+    assert(discord_members_handle_chunk(members, chunk, (size_t)len) == DISCORD_OK);
+    assert(last_result.members == 1 && last_result.not_found == 1);
+    printf("  ✓ user_ids request resolved with not_found\n");
+
+    const char* bad_ids[] = { "12a" };
+    request.user_ids = bad_ids;
+    request.user_id_count = 1;
+    assert(discord_members_request(members, &request, NULL) == DISCORD_ERROR_INVALID_PARAM);
+    request.guild_id = NULL;
+    assert(discord_members_request(members, &request, NULL) == DISCORD_ERROR_INVALID_PARAM);
+    printf("  ✓ Invalid snowflakes rejected\n");
+
+    free(chunk);
+    discord_members_destroy(members);
+}
+
+void test_pacing_and_timeout() {
+    printf("Testing send pacing...\n");
+
+    send_count = 0;
+    done_count = 0;
+
+    discord_members_config_t config = {0};
+    config.send = fake_send;
+    config.sends_per_minute = 4;
+    config.burst = 2;
+    config.timeout_ms = 1000;
+    discord_members_t* members = NULL;
+    assert(discord_members_create(&config, &members) == DISCORD_OK);
+
+    discord_members_request_t request = {0};
+    request.guild_id = "81384788765712384";
+    request.done = record_done;
+
+    uint64_t base = discord_time_now_ms();
+    for (int i = 0; i < 4; i++) {
+        assert(discord_members_request(members, &request, NULL) == DISCORD_OK);
+    }
+    assert(send_count == 2);
+
+    // Two sends refill per minute on top of the burst: one every 30 s
+    uint32_t wait_ms = 0;
+    assert(discord_members_poll(members, base, &wait_ms) == DISCORD_OK);
+    assert(send_count == 2 && wait_ms > 29000 && wait_ms <= 30000);
+    assert(discord_members_poll(members, base + 30001, &wait_ms) == DISCORD_OK);
+    assert(send_count == 3);
+    printf("  ✓ Burst of 2, then one send per 30 s\n");
+
+    // Nothing answered: all three sent requests stall and time out
+    assert(discord_members_poll(members, base + 31500, NULL) == DISCORD_OK);
+    assert(done_count == 3 && last_result.result == DISCORD_ERROR_TIMEOUT);
+
+    discord_members_stats_t stats;
+    discord_members_get_stats(members, &stats);
+    assert(stats.timed_out == 3 && stats.queued == 1);
+    printf("  ✓ Stalled requests timed out\n");
+
+    config.sends_per_minute = DISCORD_GATEWAY_SEND_LIMIT + 1;
+    discord_members_t* rejected = NULL;
+    assert(discord_members_create(&config, &rejected) == DISCORD_ERROR_INVALID_PARAM);
+    printf("  ✓ Budget above the gateway limit rejected\n");
+
+    discord_members_destroy(members);
+}
+
+void test_dispatch_and_cache() {
+    printf("Testing dispatch routing into the session cache...\n");
+
+    remove(snapshot_path);
+    discord_session_t* session = NULL;
+    assert(discord_session_open(snapshot_path, 0, 4, &session) == DISCORD_OK);
+
+    discord_members_cache_t cache;
+    assert(discord_members_cache_init(&cache, session) == DISCORD_OK);
+
+    discord_members_config_t config = {0};
+    config.send = fake_send;
+    discord_members_t* members = NULL;
+    assert(discord_members_create(&config, &members) == DISCORD_OK);
+
+    discord_dispatch_clear();
+    assert(discord_members_attach(members) == DISCORD_OK);
+
+    discord_members_request_t request = {0};
+    request.guild_id = "81384788765712384";
+    request.sink = discord_members_cache_sink;
+    request.user = &cache;
+    char nonce[DISCORD_MEMBERS_NONCE_MAX];
+    assert(discord_members_request(members, &request, nonce) == DISCORD_OK);
+
+    char* frame = malloc(1 << 20);
+    int pos = snprintf(frame, 1 << 20, "{\"t\":\"GUILD_MEMBERS_CHUNK\",\"s\":5,\"op\":0,\"d\":");
+    pos += build_chunk(frame + pos, (1 << 20) - (size_t)pos, nonce, 0, 1, 200);
+    snprintf(frame + pos, (1 << 20) - (size_t)pos, "}");
+    assert(discord_dispatch_frame(frame) == DISCORD_OK);
+    assert(cache.records == 200 && cache.dropped == 0 && cache.page > 0);
+
+    // Read the records back
+    uint64_t read = 0;
+    for (uint32_t index = 0; ; index++) {
+        void* page;
+        size_t size;
+        if (discord_session_cache_page(session, index, &page, &size) != DISCORD_OK) {
+            break;
+        }
+        size_t offset = 0;
+        uint32_t length;
+        memcpy(&length, page, sizeof(length));
+        if (length == 0) {
+            break;
+        }
+        while (offset + sizeof(length) <= size) {
+            memcpy(&length, (char*)page + offset, sizeof(length));
+            if (length == 0) {
+                break;
+            }
+            assert(((char*)page)[offset + sizeof(length)] == '{');
+            offset += sizeof(length) + length;
+            read++;
+        }
+    }
+    assert(read == 200);
+    printf("  ✓ 200 members written across %u cache pages\n", cache.page + 1);
+
+    assert(discord_members_attach(NULL) == DISCORD_OK);
+    free(frame);
+    discord_members_destroy(members);
+    discord_session_close(session);
+    remove(snapshot_path);
+}
+
+int main() {
+    printf("Discord ASM Bot - Member Request Tests\n");
+    printf("======================================\n\n");
+
+    test_json_iterators();
+    printf("\n");
+
+    test_request_and_chunks();
+    printf("\n");
+
+    test_pacing_and_timeout();
+    printf("\n");
+
+    test_dispatch_and_cache();
+    printf("\n");
+
+    printf("All member request tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "module.h"
+
+// The fixture modules (module_fixture.c built per version) call back into
+// the functions below, exported from this binary. MODULE_V1..V4 are their
+// paths; each load goes through MODULE_PATH, which the test overwrites
+// the way a deploy does.
+
+#ifndef MODULE_V1
+    #define MODULE_V1 "./libtest-module-v1.so"
+    #define MODULE_V2 "./libtest-module-v2.so"
+    #define MODULE_V3 "./libtest-module-v3.so"
+    #define MODULE_V4 "./libtest-module-v4.so"
+#endif
+
+static char module_path[64];
+
+static volatile int last_version = 0;
+static volatile int records[5];             // By version, catch-all calls negative
+static volatile int catch_all_records[5];
+static volatile int loads_seen[5];
+static volatile int finished[5];
+static volatile int final_finish = 0;
+static volatile int host_records = 0;
+
+static volatile int slow_entered = 0;
+static volatile int slow_release = 0;
+static volatile int slow_version = 0;
+
+void test_module_record(int version, const discord_event_t* event) {
+    if (strcmp(event->event_type, "SLOW_EVENT") == 0) {
+        slow_version = version;
+    }
+    if (version < 0) {
+        __atomic_add_fetch(&catch_all_records[-version], 1, __ATOMIC_SEQ_CST);
+    } else {
+        __atomic_add_fetch(&records[version], 1, __ATOMIC_SEQ_CST);
+    }
+    last_version = version;
+}
+
+void test_module_block(void) {
+    __atomic_store_n(&slow_entered, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&slow_release, __ATOMIC_SEQ_CST)) {
+        usleep(1000);
+    }
+}
+
+void test_module_loaded(int version, int loads) {
+    loads_seen[version] = loads;
+}
+
+void test_module_finished(int version, int final) {
+    finished[version]++;
+    final_finish = final;
+}
+
+static void host_handler(const discord_event_t* event) {
+    (void)event;
+    host_records++;
+}
+
+static void install(const char* source) {
+    // Write a new file and rename it over the old one, as deploys do
+    char staging[80];
+    snprintf(staging, sizeof(staging), "%s.new", module_path);
+    FILE* in = fopen(source, "rb");
+    FILE* out = fopen(staging, "wb");
+    assert(in && out);
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        assert(fwrite(buffer, 1, n, out) == n);
+    }
+    fclose(in);
+    fclose(out);
+    assert(rename(staging, module_path) == 0);
+}
+
+static void dispatch(const char* event_type) {
+    discord_event_t event = { 0, "{}", 2, 1, (char*)event_type };
+    assert(discord_dispatch_event(&event) == DISCORD_OK);
+}
+
+void test_load_and_reload() {
+    printf("Testing load and reload...\n");
+
+    discord_dispatch_clear();
+    discord_dispatch_on("GUILD_CREATE", host_handler);
+    discord_dispatch_on("MESSAGE_CREATE", host_handler);
+
+    install(MODULE_V1);
+    assert(discord_module_load(module_path) == DISCORD_OK);
+    dispatch("MESSAGE_CREATE");
+    assert(records[1] == 1 && host_records == 0);
+    dispatch("GUILD_CREATE");
+    assert(host_records == 1);
+    dispatch("TYPING_START");
+    assert(catch_all_records[1] == 1);
+    printf("  ✓ Module handlers first, then host handlers, then the module's catch-all\n");
+
+    // Same path, new contents
+    install(MODULE_V2);
+    assert(discord_module_load(module_path) == DISCORD_OK);
+    assert(finished[1] == 1 && final_finish == 0);
+    assert(loads_seen[2] == 2);
+    dispatch("MESSAGE_CREATE");
+    assert(records[2] == 1 && records[1] == 1);
+
+    discord_module_stats_t stats;
+    assert(discord_module_get_stats(&stats) == DISCORD_OK);
+    assert(stats.generation == 2 && stats.loads == 2 && stats.loaded && strcmp(stats.name, "fixture-v2") == 0);
+    printf("  ✓ A rebuilt module at the same path replaced the old one, state carried over\n");
+
+    // Rejected modules leave the current one in place
+    install(MODULE_V3);
+    assert(discord_module_load(module_path) == DISCORD_ERROR_UNSUPPORTED);
+    discord_module_get_stats(&stats);
+    assert(strcmp(stats.last_error, "unsupported module ABI version") == 0);
+    install(MODULE_V4);
+    assert(discord_module_load(module_path) == DISCORD_ERROR_INVALID_PARAM);
+    discord_module_get_stats(&stats);
+    assert(strcmp(stats.last_error, "init failed") == 0);
+    assert(discord_module_load("/tmp/discord-module-missing.so") == DISCORD_ERROR_NOT_FOUND);
+    dispatch("MESSAGE_CREATE");
+    assert(records[2] == 2);
+    discord_module_get_stats(&stats);
+    assert(stats.failures == 3 && stats.generation == 2 && finished[2] == 0);
+    printf("  ✓ Unknown ABI, failed init and missing files keep the loaded module\n");
+
+    // What dlopen said about a file that is not a shared object
+    FILE* junk = fopen(module_path, "wb");
+    assert(junk && fputs("not a shared object\n", junk) >= 0);
+    fclose(junk);
+    assert(discord_module_load(module_path) == DISCORD_ERROR_INVALID_PARAM);
+    discord_module_get_stats(&stats);
+    assert(stats.failures == 4 && stats.generation == 2 && stats.last_error[0] != '\0');
+    printf("  ✓ dlopen errors are reported in the stats: %s\n", stats.last_error);
+
+    assert(discord_module_unload() == DISCORD_OK);
+    assert(finished[2] == 1 && final_finish == 1);
+    dispatch("MESSAGE_CREATE");
+    assert(host_records == 2);
+    discord_module_get_stats(&stats);
+    assert(!stats.loaded);
+    printf("  ✓ Unload falls back to the host's handlers and releases the state\n");
+}
+
+static void* slow_dispatch(void* arg) {
+    (void)arg;
+    dispatch("SLOW_EVENT");
+    return NULL;
+}
+
+static void* load_v2(void* arg) {
+    install(MODULE_V2);
+    *(discord_result_t*)arg = discord_module_load(module_path);
+    return NULL;
+}
+
+void test_drain() {
+    printf("Testing in-flight handlers across a reload...\n");
+
+    memset((void*)finished, 0, sizeof(finished));
+    memset((void*)records, 0, sizeof(records));
+    install(MODULE_V1);
+    assert(discord_module_load(module_path) == DISCORD_OK);
+
+    // A v1 handler is still running when v2 is loaded
+    pthread_t slow, loader;
+    pthread_create(&slow, NULL, slow_dispatch, NULL);
+    while (!__atomic_load_n(&slow_entered, __ATOMIC_SEQ_CST)) {
+        usleep(1000);
+    }
+    discord_result_t loaded = DISCORD_ERROR_TIMEOUT;
+    pthread_create(&loader, NULL, load_v2, &loaded);
+
+    // New events reach v2 while v1 cannot be unloaded yet
+    while (records[2] == 0) {
+        dispatch("MESSAGE_CREATE");
+        usleep(1000);
+    }
+    usleep(20000);
+    assert(finished[1] == 0);
+
+    __atomic_store_n(&slow_release, 1, __ATOMIC_SEQ_CST);
+    pthread_join(slow, NULL);
+    pthread_join(loader, NULL);
+    assert(loaded == DISCORD_OK);
+    assert(slow_version == 1 && finished[1] == 1);
+    printf("  ✓ v2 took new events at once; v1 was unloaded only after its handler returned\n");
+
+    discord_module_unload();
+}
+
+typedef struct {
+    volatile int stop;
+    uint64_t dispatched;
+    uint64_t max_gap_ns;
+} gateway_loop_t;
+
+// Stands in for the gateway thread: dispatch, and note the longest stall
+static void* gateway_loop(void* arg) {
+    gateway_loop_t* loop = arg;
+    uint64_t last = discord_time_now_ns();
+    while (!loop->stop) {
+        dispatch("MESSAGE_CREATE");
+        loop->dispatched++;
+        uint64_t now = discord_time_now_ns();
+        if (now - last > loop->max_gap_ns) {
+            loop->max_gap_ns = now - last;
+        }
+        last = now;
+    }
+    return NULL;
+}
+
+void test_reload_under_load() {
+    printf("Testing reloads while dispatching...\n");
+
+    memset((void*)records, 0, sizeof(records));
+    install(MODULE_V1);
+    assert(discord_module_load(module_path) == DISCORD_OK);
+
+    gateway_loop_t loop = {0};
+    pthread_t thread;
+    pthread_create(&thread, NULL, gateway_loop, &loop);
+
+    // Watch the path the way a deployed bot would and ship 20 versions
+    assert(discord_module_watch(module_path, 5) == DISCORD_OK);
+    discord_module_stats_t stats;
+    discord_module_get_stats(&stats);
+    uint64_t generation = stats.generation;
+    for (int deploy = 0; deploy < 20; deploy++) {
+        install(deploy % 2 ? MODULE_V1 : MODULE_V2);
+        do {
+            usleep(1000);
+            discord_module_get_stats(&stats);
+        } while (stats.generation == generation);
+        generation = stats.generation;
+    }
+    assert(discord_module_watch(NULL, 0) == DISCORD_OK);
+
+    loop.stop = 1;
+    pthread_join(thread, NULL);
+    assert((uint64_t)(records[1] + records[2]) == loop.dispatched);
+    assert(stats.stranded == 0);
+    printf("  ✓ 20 deploys picked up by the watcher, %llu events all handled, longest stall %.2f ms\n",
+           (unsigned long long)loop.dispatched, (double)loop.max_gap_ns / 1e6);
+
+    discord_module_unload();
+}
+
+int main() {
+    printf("Discord ASM Bot - Handler Module Tests\n");
+    printf("======================================\n\n");
+
+    snprintf(module_path, sizeof(module_path), "/tmp/discord-handlers-test-%d.so", (int)getpid());
+
+    test_load_and_reload();
+    printf("\n");
+
+    test_drain();
+    printf("\n");
+
+    test_reload_under_load();
+    printf("\n");
+
+    unlink(module_path);
+    discord_dispatch_clear();
+
+    size_t live = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        live += stats.live_bytes;
+    }
+    assert(live == 0);
+
+    printf("All handler module tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "qos.h"
+
+static char order[64][DISCORD_EVENT_TYPE_MAX];
+static int order_count = 0;
+static int presence_count = 0;
+static int latest_status[8];
+
+static void on_any(const discord_event_t* event) {
+    if (order_count < 64) {
+        snprintf(order[order_count], sizeof(order[0]), "%s", event->event_type);
+    }
+    order_count++;
+}
+
+static void on_presence(const discord_event_t* event) {
+    // d = {"user":{"id":"<u>"},"status":"<n>"}
+    char buffer[128];
+    assert(event->data_length < sizeof(buffer));
+    memcpy(buffer, event->data, event->data_length);
+    buffer[event->data_length] = '\0';
+    int user = atoi(strstr(buffer, "\"id\":\"") + 6);
+    int status = atoi(strstr(buffer, "\"status\":\"") + 10);
+    assert(status > latest_status[user]);
+    latest_status[user] = status;
+    presence_count++;
+}
+
+static void send_presence(int user, int status) {
+    char frame[160];
+    snprintf(frame, sizeof(frame),
+             "{\"t\":\"PRESENCE_UPDATE\",\"s\":1,\"op\":0,\"d\":{\"user\":{\"id\":\"%d\"},\"status\":\"%d\"}}",
+             user, status);
+    assert(discord_dispatch_frame(frame) == DISCORD_OK);
+}
+
+static void send_event(const char* type) {
+    char frame[160];
+    snprintf(frame, sizeof(frame), "{\"t\":\"%s\",\"s\":2,\"op\":0,\"d\":{\"id\":\"1\"}}", type);
+    assert(discord_dispatch_frame(frame) == DISCORD_OK);
+}
+
+void test_priority_order() {
+    printf("Testing deadline ordering...\n");
+
+    discord_dispatch_clear();
+    discord_dispatch_set_handler(on_any);
+
+    discord_qos_t* qos = NULL;
+    assert(discord_qos_create(&qos) == DISCORD_OK);
+    assert(discord_qos_pending() == 0);
+    assert(discord_qos_attach(qos) == DISCORD_OK);
+
+    for (int i = 0; i < 20; i++) {
+        send_event("TYPING_START");
+    }
+    send_event("MESSAGE_CREATE");
+    send_event("INTERACTION_CREATE");
+    assert(order_count == 0 && discord_qos_pending() == 22);
+    printf("  ✓ Dispatches queued instead of run inline\n");
+
+    // Frames without an event type still run immediately
+    assert(discord_dispatch_frame("{\"t\":null,\"s\":null,\"op\":11,\"d\":null}") == DISCORD_OK);
+    assert(order_count == 1 && order[0][0] == '\0');
+
+    assert(discord_qos_run(qos, 2) == 2);
+    assert(strcmp(order[1], "INTERACTION_CREATE") == 0);
+    assert(strcmp(order[2], "MESSAGE_CREATE") == 0);
+    assert(discord_qos_run(qos, 100) == 20);
+    assert(strcmp(order[3], "TYPING_START") == 0 && discord_qos_pending() == 0);
+    printf("  ✓ INTERACTION_CREATE overtook 20 queued TYPING_START\n");
+
+    discord_qos_stats_t stats;
+    assert(discord_qos_get_stats(qos, &stats) == DISCORD_OK);
+    assert(stats.classes[DISCORD_QOS_CRITICAL].dispatched == 1);
+    assert(stats.classes[DISCORD_QOS_NORMAL].dispatched == 1);
+    assert(stats.classes[DISCORD_QOS_LOW].dispatched == 20);
+
+    discord_qos_attach(NULL);
+    discord_qos_destroy(qos);
+    order_count = 0;
+}
+
+void test_coalesce_presence() {
+    printf("Testing presence coalescing...\n");
+
+    discord_dispatch_clear();
+    discord_dispatch_on("PRESENCE_UPDATE", on_presence);
+
+    discord_qos_t* qos = NULL;
+    assert(discord_qos_create(&qos) == DISCORD_OK);
+    discord_qos_class_config_t low = { 10000, 16, DISCORD_QOS_COALESCE };
+    assert(discord_qos_set_class(qos, DISCORD_QOS_LOW, &low) == DISCORD_OK);
+    assert(discord_qos_attach(qos) == DISCORD_OK);
+
+    // A storm: 2000 updates for 8 users
+    for (int i = 1; i <= 2000; i++) {
+        send_presence(i % 8, i);
+    }
+    assert(discord_qos_pending() <= 16);
+
+    discord_qos_stats_t stats;
+    discord_qos_get_stats(qos, &stats);
+    assert(stats.classes[DISCORD_QOS_LOW].enqueued == 2000);
+    assert(stats.classes[DISCORD_QOS_LOW].coalesced > 1900);
+    printf("  ✓ 2000 updates held as %u events (%llu merged, %llu shed)\n",
+           stats.classes[DISCORD_QOS_LOW].depth,
+           (unsigned long long)stats.classes[DISCORD_QOS_LOW].coalesced,
+           (unsigned long long)stats.classes[DISCORD_QOS_LOW].shed);
+
+    // Detaching flushes the queue; each user ends on its last status
+    discord_qos_attach(NULL);
+    for (int user = 0; user < 8; user++) {
+        assert(latest_status[user] > 2000 - 8);
+    }
+    printf("  ✓ Latest presence per user delivered\n");
+
+    discord_qos_destroy(qos);
+}
+
+void test_shedding_and_deadlines() {
+    printf("Testing shedding policies...\n");
+
+    discord_dispatch_clear();
+    discord_dispatch_set_handler(on_any);
+    order_count = 0;
+
+    discord_qos_t* qos = NULL;
+    assert(discord_qos_create(&qos) == DISCORD_OK);
+    assert(discord_qos_classify(qos, "GUILD_AUDIT_LOG_ENTRY_CREATE", DISCORD_QOS_HIGH, NULL) == DISCORD_OK);
+    assert(discord_qos_classify(qos, "", DISCORD_QOS_HIGH, NULL) == DISCORD_ERROR_INVALID_PARAM);
+    discord_qos_class_config_t high = { 60000, 4, DISCORD_QOS_SHED_NEWEST };
+    assert(discord_qos_set_class(qos, DISCORD_QOS_HIGH, &high) == DISCORD_OK);
+    discord_qos_class_config_t normal = { 60000, 4, DISCORD_QOS_SHED_OLDEST };
+    assert(discord_qos_set_class(qos, DISCORD_QOS_NORMAL, &normal) == DISCORD_OK);
+    assert(discord_qos_attach(qos) == DISCORD_OK);
+
+    for (int i = 0; i < 10; i++) {
+        send_event("GUILD_AUDIT_LOG_ENTRY_CREATE");
+        send_event("MESSAGE_UPDATE");
+    }
+
+    discord_qos_stats_t stats;
+    discord_qos_get_stats(qos, &stats);
+    assert(stats.classes[DISCORD_QOS_HIGH].depth == 4 && stats.classes[DISCORD_QOS_HIGH].shed == 6);
+    assert(stats.classes[DISCORD_QOS_NORMAL].depth == 4 && stats.classes[DISCORD_QOS_NORMAL].shed == 6);
+    printf("  ✓ High-water mark enforced (shed newest / oldest)\n");
+
+    // Policy changes need an empty lane
+    discord_qos_class_config_t keep = { 0, 0, DISCORD_QOS_KEEP };
+    assert(discord_qos_set_class(qos, DISCORD_QOS_HIGH, &keep) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_qos_run(qos, 100) == 8);
+
+    // A zero budget: shedding classes drop expired events, KEEP runs them late
+    discord_qos_class_config_t expired = { 0, 4, DISCORD_QOS_SHED_OLDEST };
+    assert(discord_qos_set_class(qos, DISCORD_QOS_NORMAL, &expired) == DISCORD_OK);
+    assert(discord_qos_set_class(qos, DISCORD_QOS_HIGH, &keep) == DISCORD_OK);
+    send_event("MESSAGE_UPDATE");
+    send_event("GUILD_AUDIT_LOG_ENTRY_CREATE");
+    discord_sleep_ms(2);
+    assert(discord_qos_run(qos, 100) == 1);
+
+    discord_qos_get_stats(qos, &stats);
+    assert(stats.classes[DISCORD_QOS_NORMAL].shed == 7);
+    assert(stats.classes[DISCORD_QOS_HIGH].late == 1);
+    printf("  ✓ Expired events shed or counted late\n");
+
+    discord_qos_attach(NULL);
+    discord_qos_destroy(qos);
+}
+
+void test_gateway_poll() {
+    printf("Testing gateway loop hooks...\n");
+
+    discord_dispatch_clear();
+    discord_dispatch_set_handler(on_any);
+    order_count = 0;
+
+    discord_qos_t* qos = NULL;
+    assert(discord_qos_create(&qos) == DISCORD_OK);
+    assert(discord_qos_attach(qos) == DISCORD_OK);
+
+    // Frames keep arriving: nothing runs until DISCORD_QOS_DRAIN_MAX
+    for (int i = 0; i < DISCORD_QOS_DRAIN_MAX - 1; i++) {
+        send_event("MESSAGE_CREATE");
+        discord_qos_poll(0);
+    }
+    assert(order_count == 0);
+    send_event("MESSAGE_CREATE");
+    discord_qos_poll(0);
+    assert(order_count == DISCORD_QOS_BATCH);
+
+    // Socket drained: one batch per idle poll
+    discord_qos_poll(1);
+    assert(order_count == 2 * DISCORD_QOS_BATCH);
+    printf("  ✓ Batches of %d after %d frames or an idle receive\n",
+           DISCORD_QOS_BATCH, DISCORD_QOS_DRAIN_MAX);
+
+    discord_qos_attach(NULL);
+    assert(order_count == DISCORD_QOS_DRAIN_MAX);
+    discord_qos_poll(1);
+    discord_qos_destroy(qos);
+}
+
+int main() {
+    printf("Discord ASM Bot - Dispatch QoS Tests\n");
+    printf("====================================\n\n");
+
+    test_priority_order();
+    printf("\n");
+
+    test_coalesce_presence();
+    printf("\n");
+
+    test_shedding_and_deadlines();
+    printf("\n");
+
+    test_gateway_poll();
+    printf("\n");
+
+    printf("All QoS tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "abi.h"
+#include "dispatch.h"
+
+static const char* capture_path = "test_record.bin";
+static const char* fixture_path = "fixtures/sample_capture.bin";
+
+static const char* secret = "MTk4NjIyNDgzNDcxOTI1MjQ4.Cl2FMQ.ZnCjm1XVW7vRze4b7Cq4se7kKWs";
+
+static int message_count = 0;
+static int other_count = 0;
+static int last_sequence = -1;
+
+static void on_message_create(const discord_event_t* event) {
+    assert(event->opcode == 0);
+    assert(strcmp(event->event_type, "MESSAGE_CREATE") == 0);
+    assert(event->data[0] == '{' && event->data[event->data_length - 1] == '}');
+    last_sequence = event->sequence;
+    message_count++;
+}
+
+static void on_other(const discord_event_t* event) {
+    (void)event;
+    other_count++;
+}
+
+void test_dispatch_frame() {
+    printf("Testing frame dispatch...\n");
+
+    discord_dispatch_clear();
+    assert(discord_dispatch_on("MESSAGE_CREATE", on_message_create) == DISCORD_OK);
+    assert(discord_dispatch_set_handler(on_other) == DISCORD_OK);
+
+    assert(discord_dispatch_frame("{\"t\":\"MESSAGE_CREATE\",\"s\":7,\"op\":0,\"d\":{\"content\":\"hi\"}}") == DISCORD_OK);
+    assert(message_count == 1 && last_sequence == 7);
+    assert(discord_dispatch_frame("{\"t\":null,\"s\":null,\"op\":11,\"d\":null}") == DISCORD_OK);
+    assert(other_count == 1);
+    printf("  ✓ Typed and catch-all handlers invoked\n");
+
+    assert(discord_dispatch_on("", on_other) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_dispatch_frame(NULL) == DISCORD_ERROR_INVALID_PARAM);
+    printf("  ✓ Invalid parameters rejected\n");
+}
+
+void test_record_and_replay() {
+    printf("Testing capture round trip...\n");
+
+    char identify[256];
+    snprintf(identify, sizeof(identify),
+             "{\"op\":2,\"d\":{\"token\":\"%s\",\"intents\":513}}", secret);
+
+    remove(capture_path);
+    discord_recorder_t* recorder = NULL;
+    assert(discord_record_open(capture_path, &recorder) == DISCORD_OK);
+    assert(discord_record_frame(recorder, identify, strlen(identify), 0) == DISCORD_OK);
+    for (int i = 0; i < 10; i++) {
+        char frame[128];
+        int len = snprintf(frame, sizeof(frame),
+                           "{\"t\":\"MESSAGE_CREATE\",\"s\":%d,\"op\":0,\"d\":{\"content\":\"m%d\"}}", i + 1, i);
+        assert(discord_record_frame(recorder, frame, (size_t)len, 0) == DISCORD_OK);
+    }
+    discord_record_close(recorder);
+
+    // The token must not reach the file
+    FILE* f = fopen(capture_path, "rb");
+    assert(f != NULL);
+    char raw[4096];
+    size_t raw_len = fread(raw, 1, sizeof(raw), f);
+    fclose(f);
+    int found = 0;
+    for (size_t i = 0; i + strlen(secret) <= raw_len; i++) {
+        if (memcmp(raw + i, secret, strlen(secret)) == 0) {
+            found = 1;
+        }
+    }
+    assert(!found);
+    printf("  ✓ Token redacted in capture\n");
+
+    discord_replay_t* replay = NULL;
+    assert(discord_replay_open(capture_path, &replay) == DISCORD_OK);
+    assert(discord_replay_frame_count(replay) == 11);
+
+    message_count = 0;
+    other_count = 0;
+    discord_replay_stats_t stats;
+    assert(discord_replay_run(replay, DISCORD_REPLAY_MAX_SPEED, &stats) == DISCORD_OK);
+    assert(stats.frames == 11 && stats.errors == 0);
+    assert(message_count == 10 && other_count == 1);
+    assert(last_sequence == 10);
+    assert(stats.type_count == 2);
+    printf("  ✓ Replayed %llu frames at %.0f events/sec\n",
+           (unsigned long long)stats.frames, stats.events_per_sec);
+
+    discord_replay_close(replay);
+
+    // Appending continues the timeline instead of starting again at 0
+    discord_sleep_ms(5);
+    assert(discord_record_open(capture_path, &recorder) == DISCORD_OK);
+    assert(discord_record_frame(recorder, "{\"op\":11,\"d\":null}", 19, 0) == DISCORD_OK);
+    discord_record_close(recorder);
+
+    f = fopen(capture_path, "rb");
+    assert(f != NULL);
+    raw_len = fread(raw, 1, sizeof(raw), f);
+    fclose(f);
+    size_t offset = 16;
+    uint64_t previous_ns = 0;
+    int records = 0;
+    while (offset + 16 <= raw_len) {
+        uint32_t length;
+        uint64_t at_ns;
+        memcpy(&length, raw + offset, sizeof(length));
+        memcpy(&at_ns, raw + offset + 8, sizeof(at_ns));
+        assert(at_ns >= previous_ns);
+        previous_ns = at_ns;
+        offset += 16 + length;
+        records++;
+    }
+    assert(records == 12 && offset == raw_len);
+    printf("  ✓ Appended capture keeps timestamps increasing\n");
+
+    // A recorder that crashed mid-write leaves a torn record; appending cuts
+    // it off so the frames after it still replay
+    f = fopen(capture_path, "ab");
+    assert(f != NULL);
+    unsigned char torn[26] = { 100 };   // Claims 100 bytes, has 10
+    assert(fwrite(torn, sizeof(torn), 1, f) == 1);
+    fclose(f);
+    assert(discord_record_open(capture_path, &recorder) == DISCORD_OK);
+    assert(discord_record_frame(recorder, "{\"t\":\"MESSAGE_CREATE\",\"s\":11,\"op\":0,\"d\":{}}", 43, 0) == DISCORD_OK);
+    discord_record_close(recorder);
+
+    assert(discord_replay_open(capture_path, &replay) == DISCORD_OK);
+    assert(discord_replay_frame_count(replay) == 13);
+    message_count = 0;
+    other_count = 0;
+    assert(discord_replay_run(replay, DISCORD_REPLAY_MAX_SPEED, &stats) == DISCORD_OK);
+    assert(stats.frames == 13 && stats.errors == 0);
+    assert(message_count == 11 && other_count == 2 && last_sequence == 11);
+    discord_replay_close(replay);
+    printf("  ✓ A torn last record is cut off before appending\n");
+
+    // Files that are not captures are left alone
+    f = fopen(capture_path, "wb");
+    assert(f != NULL);
+    assert(fwrite("not a capture file", 18, 1, f) == 1);
+    fclose(f);
+    recorder = NULL;
+    assert(discord_record_open(capture_path, &recorder) == DISCORD_ERROR_INVALID_PARAM && recorder == NULL);
+    f = fopen(capture_path, "rb");
+    assert(f != NULL);
+    raw_len = fread(raw, 1, sizeof(raw), f);
+    fclose(f);
+    assert(raw_len == 18);
+    printf("  ✓ Appending to a file without a capture header is refused\n");
+
+    remove(capture_path);
+}
+
+void test_replay_fixture() {
+    printf("Testing sample capture fixture...\n");
+
+    discord_replay_t* replay = NULL;
+    assert(discord_replay_open(fixture_path, &replay) == DISCORD_OK);
+    assert(discord_replay_frame_count(replay) == 12);
+
+    message_count = 0;
+    other_count = 0;
+    discord_replay_stats_t stats;
+    assert(discord_replay_run(replay, DISCORD_REPLAY_MAX_SPEED, &stats) == DISCORD_OK);
+    assert(stats.errors == 0);
+    assert(message_count == 2);
+    assert(message_count + other_count == 12);
+
+    for (size_t i = 0; i < stats.type_count; i++) {
+        printf("  %-24s %llu\n", stats.types[i].event_type[0] ? stats.types[i].event_type : "(non-dispatch)",
+               (unsigned long long)stats.types[i].count);
+    }
+    printf("  ✓ Fixture replayed through dispatch\n");
+
+    discord_replay_close(replay);
+}
+
+int main() {
+    printf("Discord ASM Record/Replay Tests\n");
+    printf("===============================\n\n");
+
+    test_dispatch_frame();
+    printf("\n");
+
+    test_record_and_replay();
+    printf("\n");
+
+    test_replay_fixture();
+    printf("\n");
+
+    printf("All record/replay tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "abi.h"
+#include "rest.h"
+
+// Uploads against a local HTTP sink that records every request and
+// answers as the test scripts it: a chunked JSON body, rate limit
+// headers, or a 429 first.
+
+#define MAX_REQUESTS    32
+#define MAX_CONNS       8
+#define CAPTURE_MAX     (256 * 1024)
+
+typedef enum {
+    SINK_OK = 0,                    // 200, chunked body
+    SINK_LIMITED,                   // 200, one request per channel per 200 ms
+    SINK_429_FIRST                  // 429 (Retry-After 0.1) for the first request
+} sink_mode_t;
+
+typedef struct {
+    uint64_t channel_id;
+    uint64_t at_ms;
+    char headers[2048];
+    char* body;                     // First CAPTURE_MAX bytes
+    size_t body_length;
+} sink_request_t;
+
+static struct {
+    int listener;
+    int port;
+    sink_mode_t mode;
+    pthread_mutex_t lock;
+    sink_request_t requests[MAX_REQUESTS];
+    int request_count;
+    pthread_t threads[MAX_CONNS];
+    int conns[MAX_CONNS];
+    int conn_count;
+    pthread_t acceptor;
+} sink = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static void sink_send(int fd, const char* text) {
+    size_t length = strlen(text);
+    assert(send(fd, text, length, MSG_NOSIGNAL) == (ssize_t)length);
+}
+
+static void* sink_conn_thread(void* arg) {
+    int fd = (int)(intptr_t)arg;
+    char* data = malloc(CAPTURE_MAX + 4096);
+    size_t used = 0;
+
+    for (;;) {
+        // Header block
+        char* end = NULL;
+        while (!(end = strstr(data, "\r\n\r\n"))) {
+            ssize_t n = recv(fd, data + used, 4095, 0);
+            if (n <= 0) {
+                free(data);
+                close(fd);
+                return NULL;
+            }
+            used += (size_t)n;
+            data[used] = '\0';
+        }
+        size_t header_length = (size_t)(end + 4 - data);
+        const char* content_length = strstr(data, "Content-Length: ");
+        assert(content_length && content_length < end);
+        uint64_t left = strtoull(content_length + 16, NULL, 10);
+
+        pthread_mutex_lock(&sink.lock);
+        assert(sink.request_count < MAX_REQUESTS);
+        sink_request_t* request = &sink.requests[sink.request_count++];
+        int index = sink.request_count;
+        pthread_mutex_unlock(&sink.lock);
+        request->at_ms = now_ms();
+        request->channel_id = strtoull(strstr(data, "/channels/") + 10, NULL, 10);
+        snprintf(request->headers, sizeof(request->headers), "%.*s", (int)header_length, data);
+        request->body = malloc(CAPTURE_MAX);
+
+        // Body: what came with the headers, then the rest
+        size_t have = used - header_length;
+        size_t take = have < left ? have : (size_t)left;
+        memcpy(request->body, data + header_length, take);
+        request->body_length = take;
+        left -= take;
+        memmove(data, data + header_length + take, used - header_length - take);
+        used -= header_length + take;
+        data[used] = '\0';
+        while (left > 0) {
+            char scratch[65536];
+            ssize_t n = recv(fd, scratch, left < sizeof(scratch) ? (size_t)left : sizeof(scratch), 0);
+            assert(n > 0);
+            size_t keep = request->body_length + (size_t)n <= CAPTURE_MAX ? (size_t)n
+                        : CAPTURE_MAX - (request->body_length < CAPTURE_MAX ? request->body_length : CAPTURE_MAX);
+            memcpy(request->body + request->body_length, scratch, keep);
+            request->body_length += keep;
+            left -= (uint64_t)n;
+        }
+
+        if (sink.mode == SINK_429_FIRST && index == 1) {
+            sink_send(fd, "HTTP/1.1 429 Too Many Requests\r\nContent-Type: application/json\r\n"
+                          "Retry-After: 0.1\r\nX-RateLimit-Scope: user\r\nContent-Length: 20\r\n\r\n"
+                          "{\"retry_after\":0.1}\n");
+        } else if (sink.mode == SINK_LIMITED) {
+            sink_send(fd, "HTTP/1.1 200 OK\r\nX-RateLimit-Limit: 1\r\nX-RateLimit-Remaining: 0\r\n"
+                          "X-RateLimit-Reset-After: 0.2\r\nContent-Length: 2\r\n\r\n{}");
+        } else {
+            char response[256];
+            snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                     "6\r\n{\"id\":\r\n%x\r\n\"%d\"}\r\n0\r\n\r\n", index < 10 ? 4 : 5, index);
+            sink_send(fd, response);
+        }
+    }
+}
+
+static void* sink_accept_thread(void* arg) {
+    (void)arg;
+    for (;;) {
+        int fd = accept(sink.listener, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        pthread_mutex_lock(&sink.lock);
+        assert(sink.conn_count < MAX_CONNS);
+        sink.conns[sink.conn_count] = fd;
+        pthread_create(&sink.threads[sink.conn_count], NULL, sink_conn_thread, (void*)(intptr_t)fd);
+        sink.conn_count++;
+        pthread_mutex_unlock(&sink.lock);
+    }
+}
+
+static void sink_start(sink_mode_t mode) {
+    sink.mode = mode;
+    sink.request_count = 0;
+    sink.conn_count = 0;
+    sink.listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    assert(bind(sink.listener, (struct sockaddr*)&address, sizeof(address)) == 0);
+    assert(listen(sink.listener, 16) == 0);
+    assert(getsockname(sink.listener, (struct sockaddr*)&address, &length) == 0);
+    sink.port = ntohs(address.sin_port);
+    pthread_create(&sink.acceptor, NULL, sink_accept_thread, NULL);
+}
+
+// After the client is destroyed (its connections closed)
+static void sink_stop(void) {
+    shutdown(sink.listener, SHUT_RDWR);
+    close(sink.listener);
+    pthread_join(sink.acceptor, NULL);
+    for (int i = 0; i < sink.conn_count; i++) {
+        pthread_join(sink.threads[i], NULL);
+    }
+    for (int i = 0; i < sink.request_count; i++) {
+        free(sink.requests[i].body);
+    }
+}
+
+static discord_rest_t* client(uint32_t connections, int copy_only) {
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/api/v10/", sink.port);
+    discord_rest_config_t config = {0};
+    config.token = "test-token";
+    config.api_url = url;
+    config.connections = connections;
+    config.chunk_size = DISCORD_REST_CHUNK_MIN;
+    config.copy_only = copy_only;
+    discord_rest_t* rest = NULL;
+    assert(discord_rest_create(&config, &rest) == DISCORD_OK);
+    return rest;
+}
+
+static int temp_file(const char* data, size_t length) {
+    char path[] = "/tmp/discord-rest-test-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(fd, data + written, length - written);
+        assert(n > 0);
+        written += (size_t)n;
+    }
+    return fd;
+}
+
+typedef struct {
+    discord_rest_response_t response;
+    char body[256];
+    uint64_t done_ms;
+    int calls;
+} result_t;
+
+static void on_response(const discord_rest_response_t* response, void* user) {
+    result_t* result = user;
+    result->response = *response;
+    snprintf(result->body, sizeof(result->body), "%.*s", (int)response->body_length, response->body);
+    result->response.body = NULL;
+    result->done_ms = now_ms();
+    result->calls++;
+}
+
+static void check_multipart(int copy_only) {
+    sink_start(SINK_OK);
+    discord_rest_t* rest = client(1, copy_only);
+
+    const char* contents = "0123456789abcdefghij";
+    int fd = temp_file(contents, strlen(contents));
+    int pipe_fds[2];
+    assert(pipe(pipe_fds) == 0);
+    assert(write(pipe_fds[1], "piped", 5) == 5);
+
+    discord_rest_file_t files[2] = {
+        { "log.txt", "text/plain", fd, 10, 0 },
+        { "stream.bin", NULL, pipe_fds[0], 0, 5 }
+    };
+    result_t result = {0};
+    discord_rest_upload_t upload = { 1234, "{\"content\":\"logs\"}", files, 2, on_response, &result };
+    assert(discord_rest_upload(rest, &upload) == DISCORD_OK);
+    assert(discord_rest_flush(rest, 5000) == DISCORD_OK);
+    assert(result.calls == 1 && result.response.result == DISCORD_OK && result.response.status == 200);
+    assert(strcmp(result.body, "{\"id\":\"1\"}") == 0 && result.response.attempts == 1);
+
+    sink_request_t* request = &sink.requests[0];
+    assert(sink.request_count == 1 && request->channel_id == 1234);
+    assert(strncmp(request->headers, "POST /api/v10/channels/1234/messages HTTP/1.1\r\n", 47) == 0);
+    assert(strstr(request->headers, "\r\nAuthorization: Bot test-token\r\n"));
+    const char* boundary = strstr(request->headers, "multipart/form-data; boundary=");
+    assert(boundary);
+    boundary += 30;
+    char b[64];
+    snprintf(b, sizeof(b), "%.*s", (int)strcspn(boundary, "\r"), boundary);
+
+    char expected[1024];
+    int length = snprintf(expected, sizeof(expected),
+        "--%s\r\nContent-Disposition: form-data; name=\"payload_json\"\r\nContent-Type: application/json\r\n\r\n"
+        "{\"content\":\"logs\"}"
+        "\r\n--%s\r\nContent-Disposition: form-data; name=\"files[0]\"; filename=\"log.txt\"\r\n"
+        "Content-Type: text/plain\r\n\r\nabcdefghij"
+        "\r\n--%s\r\nContent-Disposition: form-data; name=\"files[1]\"; filename=\"stream.bin\"\r\n"
+        "Content-Type: application/octet-stream\r\n\r\npiped"
+        "\r\n--%s--\r\n", b, b, b, b);
+    assert(request->body_length == (size_t)length && memcmp(request->body, expected, (size_t)length) == 0);
+
+    discord_rest_stats_t stats;
+    assert(discord_rest_get_stats(rest, &stats) == DISCORD_OK);
+    assert(stats.uploads == 1 && stats.completed == 1 && stats.requests == 1 && stats.connections_opened == 1);
+    if (copy_only) {
+        assert(stats.copied_bytes == 15 && stats.zero_copy_bytes == 0);
+    } else {
+        assert(stats.zero_copy_bytes == 15 && stats.copied_bytes == 0);
+    }
+    assert(stats.bytes_sent == result.response.bytes_sent && stats.queued == 0 && stats.in_flight == 0);
+
+    discord_rest_destroy(rest);
+    close(fd);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    sink_stop();
+}
+
+void test_multipart() {
+    printf("Testing multipart uploads...\n");
+
+    discord_rest_config_t config = {0};
+    discord_rest_t* rest = NULL;
+    assert(discord_rest_create(&config, &rest) == DISCORD_ERROR_INVALID_PARAM);
+    config.token = "token";
+    config.api_url = "ftp://example.com";
+    assert(discord_rest_create(&config, &rest) == DISCORD_ERROR_INVALID_PARAM);
+    config.api_url = "http://127.0.0.1:1/api";
+    config.chunk_size = 1024;
+    assert(discord_rest_create(&config, &rest) == DISCORD_ERROR_INVALID_PARAM);
+    config.chunk_size = 0;
+    assert(discord_rest_create(&config, &rest) == DISCORD_OK);
+    discord_rest_file_t bad = { "a\"b", NULL, 0, 0, 0 };
+    discord_rest_upload_t upload = { 1, NULL, &bad, 1, NULL, NULL };
+    assert(discord_rest_upload(rest, &upload) == DISCORD_ERROR_INVALID_PARAM);
+    int pipe_fds[2];
+    assert(pipe(pipe_fds) == 0);
+    discord_rest_file_t unsized = { "x", NULL, pipe_fds[0], 0, 0 };
+    upload.files = &unsized;
+    assert(discord_rest_upload(rest, &upload) == DISCORD_ERROR_INVALID_PARAM);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    discord_rest_destroy(rest);
+    printf("  ✓ Bad configs, file names and unsized pipes are refused\n");
+
+    check_multipart(0);
+    printf("  ✓ Body streamed with sendfile and splice, byte for byte\n");
+    check_multipart(1);
+    printf("  ✓ Same body through the pooled buffer\n");
+}
+
+void test_rate_limits() {
+    printf("Testing rate limits...\n");
+
+    // Three uploads to one channel and one to another over four connections
+    sink_start(SINK_LIMITED);
+    discord_rest_t* rest = client(4, 0);
+    int fd = temp_file("data", 4);
+    discord_rest_file_t file = { "a.txt", NULL, fd, 0, 0 };
+    result_t results[4];
+    memset(results, 0, sizeof(results));
+    uint64_t start = now_ms();
+    for (int i = 0; i < 4; i++) {
+        discord_rest_upload_t upload = { i < 3 ? 100 : 200, NULL, &file, 1, on_response, &results[i] };
+        assert(discord_rest_upload(rest, &upload) == DISCORD_OK);
+    }
+    assert(discord_rest_flush(rest, 5000) == DISCORD_OK);
+    for (int i = 0; i < 4; i++) {
+        assert(results[i].calls == 1 && results[i].response.result == DISCORD_OK);
+    }
+    assert(results[3].done_ms - start < 150);
+    uint64_t last = 0;
+    int seen = 0;
+    for (int i = 0; i < sink.request_count; i++) {
+        if (sink.requests[i].channel_id == 100) {
+            assert(seen == 0 || sink.requests[i].at_ms - last >= 190);
+            last = sink.requests[i].at_ms;
+            seen++;
+        }
+    }
+    assert(seen == 3);
+    discord_rest_stats_t stats;
+    discord_rest_get_stats(rest, &stats);
+    assert(stats.buckets == 2 && stats.rate_limited == 0 && stats.limiter_waits > 0);
+    discord_rest_destroy(rest);
+    sink_stop();
+    printf("  ✓ A channel's bucket spaces its uploads; other channels go at once\n");
+
+    sink_start(SINK_429_FIRST);
+    rest = client(2, 0);
+    result_t result = {0};
+    discord_rest_upload_t upload = { 300, NULL, &file, 1, on_response, &result };
+    start = now_ms();
+    assert(discord_rest_upload(rest, &upload) == DISCORD_OK);
+    assert(discord_rest_flush(rest, 5000) == DISCORD_OK);
+    assert(result.response.result == DISCORD_OK && result.response.attempts == 2);
+    assert(sink.request_count == 2 && sink.requests[1].at_ms - sink.requests[0].at_ms >= 95);
+    assert(sink.requests[1].body_length == sink.requests[0].body_length);
+    discord_rest_get_stats(rest, &stats);
+    assert(stats.rate_limited == 1 && stats.requests == 2 && stats.completed == 1);
+    discord_rest_destroy(rest);
+    sink_stop();
+    printf("  ✓ A 429 is sent again after Retry-After, file from its offset\n");
+    close(fd);
+}
+
+static void over_budget(discord_mem_tag_t tag, size_t live_bytes, size_t budget, void* user) {
+    (void)tag; (void)live_bytes; (void)budget; (void)user;
+}
+
+void test_bounded_memory() {
+    printf("Testing memory per upload...\n");
+
+    size_t size = 8 << 20;
+    char* contents = malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        contents[i] = (char)('a' + i % 26);
+    }
+    int fd = temp_file(contents, size);
+    free(contents);
+
+    for (int copy_only = 0; copy_only <= 1; copy_only++) {
+        sink_start(SINK_OK);
+        discord_rest_t* rest = client(2, copy_only);
+        discord_mem_set_budget(DISCORD_MEM_SEND, 2 * (DISCORD_REST_CHUNK_MIN + 1) + 16 * 1024, over_budget, NULL);
+
+        discord_rest_file_t file = { "big.bin", NULL, fd, 0, 0 };
+        result_t results[4];
+        memset(results, 0, sizeof(results));
+        for (int i = 0; i < 4; i++) {
+            discord_rest_upload_t upload = { 400 + (uint64_t)i, NULL, &file, 1, on_response, &results[i] };
+            assert(discord_rest_upload(rest, &upload) == DISCORD_OK);
+        }
+        assert(discord_rest_flush(rest, 10000) == DISCORD_OK);
+        for (int i = 0; i < 4; i++) {
+            assert(results[i].response.result == DISCORD_OK);
+            assert(results[i].response.bytes_sent > size);
+        }
+        // Pooled buffers and queued jobs only, against 32 MiB of files
+        discord_mem_stats_t stats;
+        discord_mem_get_stats(DISCORD_MEM_SEND, &stats);
+        assert(stats.over_budget == 0);
+        discord_mem_set_budget(DISCORD_MEM_SEND, 0, NULL, NULL);
+        const char* data = strstr(sink.requests[3].body, "filename=\"big.bin\"");
+        assert(data && memcmp(strstr(data, "\r\n\r\n") + 4, "abcdefghijklmnopqrstuvwxyzabc", 29) == 0);
+        discord_rest_destroy(rest);
+        sink_stop();
+    }
+    close(fd);
+    printf("  ✓ Four 8 MiB uploads stay within the pooled buffers\n");
+}
+
+int main() {
+    printf("Discord ASM Bot - REST Upload Tests\n");
+    printf("===================================\n\n");
+
+    test_multipart();
+    printf("\n");
+
+    test_rate_limits();
+    printf("\n");
+
+    test_bounded_memory();
+    printf("\n");
+
+    size_t live = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        live += stats.live_bytes;
+    }
+    assert(live == 0);
+
+    printf("All REST upload tests passed! ✓\n");
+    return 0;
+}
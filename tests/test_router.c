@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+#include "dispatch.h"
+#include "router.h"
+
+static discord_command_t last_command;
+static char last_args[DISCORD_ROUTER_MAX_ARGS][64];
+static char last_rest[128];
+static int ping_count = 0;
+static int ban_count = 0;
+static int fallback_count = 0;
+
+static void copy_command(const discord_command_t* command) {
+    last_command = *command;
+    for (uint32_t i = 0; i < command->argc; i++) {
+        snprintf(last_args[i], sizeof(last_args[i]), "%.*s", (int)command->argv[i].length, command->argv[i].data);
+    }
+    snprintf(last_rest, sizeof(last_rest), "%.*s", (int)command->rest_length, command->rest);
+}
+
+static void on_ping(const discord_command_t* command) {
+    copy_command(command);
+    ping_count++;
+}
+
+static void on_ban(const discord_command_t* command) {
+    copy_command(command);
+    ban_count++;
+}
+
+static void on_fallback(const discord_event_t* event) {
+    (void)event;
+    fallback_count++;
+}
+
+static discord_result_t route(discord_router_t* router, const char* content) {
+    return discord_router_route(router, content, strlen(content), NULL);
+}
+
+void test_matching() {
+    printf("Testing command matching...\n");
+
+    const char* prefixes[] = { "!", "<@42> " };
+    discord_router_config_t config = { prefixes, 2, 1, NULL };
+    discord_router_t* router = NULL;
+    assert(discord_router_create(&config, &router) == DISCORD_OK);
+
+    uint32_t id = 99;
+    assert(discord_router_add(router, "ping", on_ping, &ping_count, &id) == DISCORD_OK && id == 0);
+    assert(discord_router_add(router, "ban", on_ban, NULL, &id) == DISCORD_OK && id == 1);
+    assert(discord_router_add(router, "banner", on_ping, NULL, NULL) == DISCORD_OK);
+    assert(discord_router_alias(router, "p", "ping") == DISCORD_OK);
+    assert(discord_router_alias(router, "PING", "ban") == DISCORD_ERROR_INVALID_PARAM); // Case-folded duplicate
+    assert(discord_router_alias(router, "x", "nope") == DISCORD_ERROR_NOT_FOUND);
+    assert(discord_router_add(router, "bad name", on_ping, NULL, NULL) == DISCORD_ERROR_INVALID_PARAM);
+
+    // Routing before compile is refused
+    assert(route(router, "!ping") == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_router_compile(router) == DISCORD_OK);
+
+    assert(route(router, "!ping") == DISCORD_OK && ping_count == 1);
+    assert(strcmp(last_command.name, "ping") == 0 && last_command.argc == 0);
+    assert(last_command.user == &ping_count);
+    assert(route(router, "!P") == DISCORD_OK && ping_count == 2);
+    assert(strcmp(last_command.name, "ping") == 0);
+    assert(route(router, "<@42> Ping") == DISCORD_OK && ping_count == 3);
+    printf("  ✓ Names, aliases, case folding and mention prefix\n");
+
+    assert(route(router, "!ban") == DISCORD_OK && ban_count == 1 && last_command.command_id == 1);
+    assert(route(router, "!banner") == DISCORD_OK && ping_count == 4);
+    assert(route(router, "!bann") == DISCORD_ERROR_NOT_FOUND);
+    assert(route(router, "!bans") == DISCORD_ERROR_NOT_FOUND);
+    assert(route(router, "!pingx") == DISCORD_ERROR_NOT_FOUND);
+    assert(route(router, "!") == DISCORD_ERROR_NOT_FOUND);
+    assert(route(router, "hello !ping") == DISCORD_ERROR_NOT_FOUND);
+    assert(route(router, "<@43> ping") == DISCORD_ERROR_NOT_FOUND);
+    assert(route(router, "") == DISCORD_ERROR_NOT_FOUND);
+    printf("  ✓ Prefixes of names and non-commands rejected\n");
+
+    discord_router_stats_t stats;
+    assert(discord_router_get_stats(router, &stats) == DISCORD_OK);
+    assert(stats.commands == 3 && stats.names == 4);
+    assert(stats.rejected == 3 && stats.unknown == 4 && stats.dispatched == 5);
+    printf("  ✓ %u states x %u classes, %zu table bytes\n", stats.states, stats.classes, stats.table_bytes);
+
+    discord_router_destroy(router);
+}
+
+void test_arguments() {
+    printf("Testing argument views...\n");
+
+    const char* prefixes[] = { "!" };
+    discord_router_config_t config = { prefixes, 1, 0, NULL };
+    discord_router_t* router = NULL;
+    assert(discord_router_create(&config, &router) == DISCORD_OK);
+    assert(discord_router_add(router, "ban", on_ban, NULL, NULL) == DISCORD_OK);
+    assert(discord_router_compile(router) == DISCORD_OK);
+
+    // Content as it appears inside the JSON string
+    const char* content = "!ban  <@123>\\n7d \\\"spam and \\\\ raids\\\" tail  ";
+    assert(route(router, content) == DISCORD_OK);
+    assert(last_command.argc == 4);
+    assert(strcmp(last_args[0], "<@123>") == 0);
+    assert(strcmp(last_args[1], "7d") == 0);
+    assert(strcmp(last_args[2], "spam and \\\\ raids") == 0);
+    assert(strcmp(last_args[3], "tail") == 0);
+    assert(strcmp(last_rest, "<@123>\\n7d \\\"spam and \\\\ raids\\\" tail") == 0);
+    printf("  ✓ Words, escaped separators and quoted groups\n");
+
+    // Views point into the content, nothing is copied
+    assert(last_command.argv[0].data == content + 6);
+    assert(last_command.content == content);
+
+    assert(route(router, "!BAN x") == DISCORD_ERROR_NOT_FOUND); // Case-sensitive router
+    assert(route(router, "!ban\\tx") == DISCORD_OK && last_command.argc == 1 && strcmp(last_args[0], "x") == 0);
+    printf("  ✓ Zero-copy views\n");
+
+    discord_router_destroy(router);
+}
+
+void test_message_create() {
+    printf("Testing MESSAGE_CREATE routing...\n");
+
+    const char* prefixes[] = { "!" };
+    discord_router_config_t config = { prefixes, 1, 0, on_fallback };
+    discord_router_t* router = NULL;
+    assert(discord_router_create(&config, &router) == DISCORD_OK);
+    assert(discord_router_add(router, "ping", on_ping, NULL, NULL) == DISCORD_OK);
+    assert(discord_router_compile(router) == DISCORD_OK);
+
+    discord_dispatch_clear();
+    assert(discord_router_attach(router) == DISCORD_OK);
+
+    int before = ping_count;
+    assert(discord_dispatch_frame(
+        "{\"t\":\"MESSAGE_CREATE\",\"s\":3,\"op\":0,\"d\":{\"id\":\"1\",\"author\":{\"id\":\"2\","
+        "\"username\":\"content\"},\"content\":\"!ping now\",\"channel_id\":\"3\"}}") == DISCORD_OK);
+    assert(ping_count == before + 1 && last_command.event != NULL);
+    assert(last_command.event->sequence == 3);
+    assert(last_command.argc == 1 && strcmp(last_args[0], "now") == 0);
+
+    assert(discord_dispatch_frame(
+        "{\"t\":\"MESSAGE_CREATE\",\"s\":4,\"op\":0,\"d\":{\"id\":\"1\",\"content\":\"hello\"}}") == DISCORD_OK);
+    assert(fallback_count == 1 && ping_count == before + 1);
+    printf("  ✓ Commands routed, other messages reach the fallback\n");
+
+    discord_router_destroy(router);
+}
+
+int main() {
+    printf("Discord ASM Bot - Command Router Tests\n");
+    printf("======================================\n\n");
+
+    test_matching();
+    printf("\n");
+
+    test_arguments();
+    printf("\n");
+
+    test_message_create();
+    printf("\n");
+
+    printf("All command router tests passed! ✓\n");
+    return 0;
+}
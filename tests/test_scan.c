@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "scan.h"
+
+// Small deterministic PRNG so failures reproduce across platforms
+static uint32_t rng_state = 12345;
+
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 16;
+}
+
+static void fill_json_like(char* buf, size_t len) {
+    static const char alphabet[] = "abcdefop:{}[],0123456789 \"\\";
+    for (size_t i = 0; i < len; i++) {
+        // Mostly plain text so matches land at varied offsets
+        buf[i] = (next_random() % 8 == 0) ? alphabet[next_random() % (sizeof(alphabet) - 1)] : 'x';
+    }
+}
+
+void test_quote_or_escape() {
+    printf("Testing quote/escape scan (%s)...\n", discord_scan_backend());
+
+    char buf[300];
+    for (int round = 0; round < 20000; round++) {
+        size_t len = next_random() % 200;
+        size_t offset = next_random() % 64;
+        fill_json_like(buf + offset, len);
+
+        size_t expected = discord_scan_quote_or_escape_scalar(buf + offset, len);
+        size_t actual = discord_scan_quote_or_escape(buf + offset, len);
+        assert(expected == actual);
+    }
+
+    // Long runs with no match and a match in the last byte
+    memset(buf, 'a', sizeof(buf));
+    assert(discord_scan_quote_or_escape(buf, sizeof(buf)) == sizeof(buf));
+    buf[sizeof(buf) - 1] = '"';
+    assert(discord_scan_quote_or_escape(buf, sizeof(buf)) == sizeof(buf) - 1);
+    assert(discord_scan_quote_or_escape(buf, 0) == 0);
+
+    printf("  ✓ Vector and scalar scans agree\n");
+}
+
+void test_find_pair() {
+    printf("Testing pair scan (%s)...\n", discord_scan_backend());
+
+    char buf[300];
+    for (int round = 0; round < 20000; round++) {
+        size_t len = next_random() % 200;
+        size_t offset = next_random() % 64;
+        fill_json_like(buf + offset, len);
+
+        size_t expected = discord_scan_find_pair_scalar(buf + offset, len, '"', 'o');
+        size_t actual = discord_scan_find_pair(buf + offset, len, '"', 'o');
+        assert(expected == actual);
+    }
+
+    // A pair straddling the 16-byte block boundary
+    memset(buf, 'a', sizeof(buf));
+    buf[15] = '"';
+    buf[16] = 'o';
+    assert(discord_scan_find_pair(buf, sizeof(buf), '"', 'o') == 15);
+
+    // The first byte of a pair in the last position is not a match
+    memset(buf, 'a', sizeof(buf));
+    buf[sizeof(buf) - 1] = '"';
+    assert(discord_scan_find_pair(buf, sizeof(buf), '"', 'o') == sizeof(buf));
+
+    printf("  ✓ Vector and scalar scans agree\n");
+}
+
+void test_word_starts() {
+    printf("Testing word start scan (%s)...\n", discord_scan_backend());
+
+    // Letters of both cases, digits, '_', UTF-8 bytes and the bytes just
+    // outside each range ('/', ':', '@', '[', '`', '{', 0x7F)
+    static const char alphabet[] = "aZz09_/:@[`{ \x7f\xc3\xa9\\";
+    char buf[300];
+    for (int round = 0; round < 20000; round++) {
+        size_t len = next_random() % 100;
+        size_t offset = next_random() % 64;
+        for (size_t i = 0; i < len; i++) {
+            buf[offset + i] = (next_random() % 3 == 0)
+                ? alphabet[next_random() % (sizeof(alphabet) - 1)] : "word_Ab9"[next_random() % 8];
+        }
+
+        uint64_t expected = discord_scan_word_starts_scalar(buf + offset, len);
+        uint64_t actual = discord_scan_word_starts(buf + offset, len);
+        assert(expected == actual);
+    }
+
+    // Every byte value before a word, against the scalar version
+    for (int c = 0; c < 256; c++) {
+        memset(buf, 'a', 64);
+        buf[20] = (char)c;
+        buf[47] = (char)c;
+        assert(discord_scan_word_starts(buf, 64) == discord_scan_word_starts_scalar(buf, 64));
+    }
+
+    // s[0] is never a start; starts at block boundaries and the window end
+    memset(buf, ' ', sizeof(buf));
+    buf[0] = 'a';
+    assert(discord_scan_word_starts(buf, sizeof(buf)) == 0);
+    buf[16] = 'b';
+    buf[63] = 'c';
+    buf[64] = 'd';
+    assert(discord_scan_word_starts(buf, sizeof(buf)) == ((1ull << 16) | (1ull << 63)));
+    assert(discord_scan_word_starts(buf, 63) == (1ull << 16));
+    assert(discord_scan_word_starts(buf + 63, 2) == 0);
+
+    printf("  ✓ Vector and scalar scans agree\n");
+}
+
+int main() {
+    printf("Discord ASM Scan Kernel Tests\n");
+    printf("=============================\n\n");
+
+    test_quote_or_escape();
+    printf("\n");
+
+    test_find_pair();
+    printf("\n");
+
+    test_word_starts();
+    printf("\n");
+
+    printf("All scan tests passed! ✓\n");
+    return 0;
+}
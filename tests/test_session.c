@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+
+static const char* snapshot_path = "test_session.snap";
+
+static const char* ready_json =
+    "{"
+    "\"t\":\"READY\","
+    "\"s\":1,"
+    "\"op\":0,"
+    "\"d\":{"
+        "\"v\":10,"
+        "\"user\":{\"id\":\"123456789012345678\",\"username\":\"TestBot\"},"
+        "\"guilds\":[],"
+        "\"session_id\":\"abc123def456\","
+        "\"resume_gateway_url\":\"wss://gateway.discord.gg\","
+        "\"shard\":[0,1]"
+    "}"
+    "}";
+
+void test_parse_ready() {
+    printf("Testing READY parsing...\n");
+
+    int sequence;
+    assert(discord_json_parse_sequence(ready_json, &sequence) == DISCORD_OK);
+    assert(sequence == 1);
+    assert(discord_json_parse_sequence("{\"t\":null,\"s\":null,\"op\":11}", &sequence) == DISCORD_OK);
+    assert(sequence == -1);
+    printf("  ✓ Sequence parsed correctly\n");
+
+    assert(discord_json_match_event(ready_json, "READY"));
+    assert(!discord_json_match_event(ready_json, "RESUMED"));
+    assert(!discord_json_match_event("{\"t\":null,\"op\":11}", "READY"));
+    printf("  ✓ Event type matched correctly\n");
+
+    char* session_id = NULL;
+    char* resume_url = NULL;
+    assert(discord_json_parse_ready(ready_json, &session_id, &resume_url) == DISCORD_OK);
+    assert(strcmp(session_id, "abc123def456") == 0);
+    assert(strcmp(resume_url, "wss://gateway.discord.gg") == 0);
+    printf("  ✓ READY session fields: %s %s\n", session_id, resume_url);
+
+    char* json = NULL;
+    assert(discord_json_create_resume("token", session_id, 42, &json) == DISCORD_OK);
+    assert(strstr(json, "\"op\":6") != NULL);
+    assert(strstr(json, "\"seq\":42") != NULL);
+    printf("  ✓ RESUME message created: %s\n", json);
+
+    discord_json_free(json);
+    discord_json_free(session_id);
+    discord_json_free(resume_url);
+}
+
+void test_snapshot_roundtrip() {
+    printf("Testing session snapshot round trip...\n");
+
+    discord_session_t* session = NULL;
+    discord_session_state_t state;
+
+    remove(snapshot_path);
+    assert(discord_session_open(snapshot_path, 3, 2, &session) == DISCORD_OK);
+    assert(discord_session_load(session, DISCORD_SESSION_RESUME_WINDOW_MS, &state) == DISCORD_ERROR_NOT_FOUND);
+    printf("  ✓ Fresh snapshot has nothing to resume\n");
+
+    assert(discord_session_store_identity(session, "abc123def456", "wss://gateway.discord.gg") == DISCORD_OK);
+    for (int seq = 1; seq <= 1000; seq++) {
+        discord_session_store_sequence(session, seq);
+    }
+
+    void* page = NULL;
+    size_t page_size = 0;
+    assert(discord_session_cache_page(session, 1, &page, &page_size) == DISCORD_OK);
+    assert(page_size == DISCORD_SESSION_PAGE_SIZE);
+    strcpy((char*)page, "guild:42");
+    assert(discord_session_cache_page(session, 2, &page, &page_size) == DISCORD_ERROR_INVALID_PARAM);
+
+    // Simulate a restart: unmap without flushing and reopen
+    discord_session_close(session);
+    assert(discord_session_open(snapshot_path, 3, 2, &session) == DISCORD_OK);
+
+    assert(discord_session_load(session, DISCORD_SESSION_RESUME_WINDOW_MS, &state) == DISCORD_OK);
+    assert(state.sequence == 1000);
+    assert(strcmp(state.session_id, "abc123def456") == 0);
+    assert(strcmp(state.resume_gateway_url, "wss://gateway.discord.gg") == 0);
+    printf("  ✓ Resume state restored: seq=%d session=%s\n", state.sequence, state.session_id);
+
+    assert(discord_session_cache_page(session, 1, &page, &page_size) == DISCORD_OK);
+    assert(strcmp((const char*)page, "guild:42") == 0);
+    printf("  ✓ Cache pages survive reopen\n");
+
+    discord_session_invalidate(session);
+    assert(discord_session_load(session, DISCORD_SESSION_RESUME_WINDOW_MS, &state) == DISCORD_ERROR_NOT_FOUND);
+    printf("  ✓ Invalidated session is not resumed\n");
+    discord_session_close(session);
+
+    // A different shard must not pick up this snapshot
+    assert(discord_session_open(snapshot_path, 4, 2, &session) == DISCORD_OK);
+    assert(discord_session_load(session, DISCORD_SESSION_RESUME_WINDOW_MS, &state) == DISCORD_ERROR_NOT_FOUND);
+    discord_session_close(session);
+    printf("  ✓ Snapshot from another shard is discarded\n");
+
+    remove(snapshot_path);
+}
+
+int main() {
+    printf("Discord ASM Session Snapshot Tests\n");
+    printf("==================================\n\n");
+
+    test_parse_ready();
+    printf("\n");
+
+#ifndef _WIN32
+    test_snapshot_roundtrip();
+    printf("\n");
+#endif
+
+    printf("All session tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+#include "shard.h"
+#include "sim.h"
+
+// Shards and the simulated gateway on the virtual clock. Every run below
+// covers minutes to hours of gateway time; none of it is slept through.
+
+static const discord_ws_options_t sim_transport = { DISCORD_WS_TRANSPORT_SIM, 0, 0, 0 };
+
+static size_t live_bytes(void) {
+    size_t total = 0;
+    for (int tag = 0; tag < DISCORD_MEM_TAG_COUNT; tag++) {
+        discord_mem_stats_t stats;
+        discord_mem_get_stats((discord_mem_tag_t)tag, &stats);
+        total += stats.live_bytes;
+    }
+    return total;
+}
+
+static discord_shard_t** create_shards(int count, discord_identify_limiter_t* limiter) {
+    discord_shard_t** shards = calloc((size_t)count, sizeof(discord_shard_t*));
+    assert(shards);
+    for (int i = 0; i < count; i++) {
+        discord_shard_config_t config = {0};
+        config.token = "sim-token";
+        config.url = "wss://gateway.discord.gg/?v=10&encoding=json";
+        config.shard_id = i;
+        config.shard_count = count;
+        config.ws = &sim_transport;
+        config.limiter = limiter;
+        assert(discord_shard_create(&config, &shards[i]) == DISCORD_OK);
+    }
+    return shards;
+}
+
+static void destroy_shards(discord_shard_t** shards, int count) {
+    for (int i = 0; i < count; i++) {
+        discord_shard_destroy(shards[i]);
+    }
+    free(shards);
+}
+
+void test_identify_limiter() {
+    printf("Testing identify limiter...\n");
+
+    discord_identify_limiter_t* limiter;
+    assert(discord_identify_limiter_create(0, &limiter) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_identify_limiter_create(2, &limiter) == DISCORD_OK);
+
+    uint64_t retry_at = 0;
+    assert(discord_identify_limiter_acquire(limiter, 0, 1000, &retry_at) == DISCORD_OK);
+    assert(discord_identify_limiter_acquire(limiter, 1, 1000, &retry_at) == DISCORD_OK);
+    assert(discord_identify_limiter_acquire(limiter, 3, 2000, &retry_at) == DISCORD_ERROR_TIMEOUT);
+    assert(retry_at == 1000 + DISCORD_IDENTIFY_WINDOW_MS);
+    printf("  ✓ shard_id %% max_concurrency buckets, one IDENTIFY per window\n");
+
+    // Waiters get consecutive slots instead of racing for the next one
+    assert(discord_identify_limiter_acquire(limiter, 2, 1000, &retry_at) == DISCORD_ERROR_TIMEOUT);
+    assert(retry_at == 1000 + DISCORD_IDENTIFY_WINDOW_MS);
+    assert(discord_identify_limiter_acquire(limiter, 4, 1000, &retry_at) == DISCORD_ERROR_TIMEOUT);
+    assert(retry_at == 1000 + 2 * DISCORD_IDENTIFY_WINDOW_MS);
+    assert(discord_identify_limiter_acquire(limiter, 6, 30000, &retry_at) == DISCORD_OK);
+    assert(retry_at == 30000);
+    printf("  ✓ Deferred callers hold reserved slots in order\n");
+
+    discord_identify_limiter_destroy(limiter);
+}
+
+void test_virtual_transport() {
+    printf("Testing simulated transport on the virtual clock...\n");
+
+    discord_sim_config_t config = {0};
+    config.latency_ms = 50;
+    discord_sim_t* sim;
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+    discord_sim_t* second;
+    assert(discord_sim_create(&config, &second) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_time_now_ms() == 0);
+
+    // What the assembly core does: connect, then block in receive
+    discord_gateway_t* gateway;
+    assert(discord_ws_connect_ex("wss://gateway.discord.gg/?v=10&encoding=json", &sim_transport,
+                                 &gateway) == DISCORD_OK);
+    discord_ws_message_t message = {0};
+    assert(discord_ws_receive(gateway, &message, 1000) == DISCORD_OK);
+    int interval = 0;
+    assert(discord_json_parse_hello(message.data, &interval) == DISCORD_OK);
+    assert(interval == DISCORD_SIM_HEARTBEAT_INTERVAL_MS);
+    assert(discord_time_now_ms() == 50);
+    discord_ws_free_message(&message);
+    printf("  ✓ HELLO arrives after the one-way latency\n");
+
+    char* identify;
+    assert(discord_json_create_identify("token", &identify) == DISCORD_OK);
+    assert(discord_ws_send(gateway, identify, strlen(identify)) == DISCORD_OK);
+    discord_json_free(identify);
+    assert(discord_ws_receive(gateway, &message, 1000) == DISCORD_OK);
+    assert(discord_json_match_event(message.data, "READY"));
+    assert(discord_time_now_ms() == 150);
+    discord_ws_free_message(&message);
+
+    // Nothing else is coming: the timeout passes in virtual time
+    assert(discord_ws_receive(gateway, &message, 60000) == DISCORD_ERROR_TIMEOUT);
+    assert(discord_time_now_ms() == 60150);
+    discord_sleep_ms(DISCORD_SIM_HEARTBEAT_INTERVAL_MS);
+    assert(discord_time_now_ms() == 60150 + DISCORD_SIM_HEARTBEAT_INTERVAL_MS);
+    printf("  ✓ Receive timeouts and discord_sleep_ms advance the virtual clock\n");
+
+    char* heartbeat;
+    assert(discord_json_create_heartbeat(1, &heartbeat) == DISCORD_OK);
+    assert(discord_ws_send(gateway, heartbeat, strlen(heartbeat)) == DISCORD_OK);
+    discord_json_free(heartbeat);
+    assert(discord_sim_advance(sim, 100) == DISCORD_OK);
+    assert(discord_ws_receive(gateway, &message, 0) == DISCORD_OK);
+    int opcode = -1;
+    assert(discord_json_parse_opcode(message.data, &opcode) == DISCORD_OK && opcode == DISCORD_OP_HEARTBEAT_ACK);
+    discord_ws_free_message(&message);
+
+    discord_sim_stats_t stats;
+    assert(discord_sim_get_stats(sim, &stats) == DISCORD_OK);
+    assert(stats.connections == 1 && stats.sessions_ready == 1);
+    assert(stats.identifies == 1 && stats.heartbeats == 1 && stats.frames_delivered == 3);
+
+    // A destroyed simulation cuts the connection off
+    discord_sim_destroy(sim);
+    assert(discord_ws_receive(gateway, &message, 0) == DISCORD_ERROR_NETWORK);
+    assert(discord_ws_send(gateway, "{}", 2) == DISCORD_ERROR_NETWORK);
+    discord_ws_close(gateway);
+    assert(discord_time_now_ms() > 60150 + DISCORD_SIM_HEARTBEAT_INTERVAL_MS);
+    printf("  ✓ Destroy restores the system clock and fails open connections\n");
+}
+
+void test_single_shard() {
+    printf("Testing one shard through heartbeats...\n");
+
+    discord_sim_config_t config = {0};
+    config.latency_ms = 20;
+    config.heartbeat_interval_ms = 1000;
+    config.dispatch_interval_ms = 250;
+    discord_sim_t* sim;
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+
+    discord_shard_t** shards = create_shards(1, NULL);
+    assert(discord_sim_run(sim, shards, 1, 60000) == DISCORD_OK);
+
+    discord_shard_stats_t stats;
+    assert(discord_shard_get_stats(shards[0], &stats) == DISCORD_OK);
+    assert(stats.state == DISCORD_SHARD_READY);
+    assert(stats.connects == 1 && stats.identifies == 1 && stats.readies == 1);
+    assert(stats.first_ready_ms == 60);         // HELLO, IDENTIFY, READY
+    assert(stats.heartbeats >= 59 && stats.heartbeats <= 60);
+    assert(stats.heartbeat_acks + 1 >= stats.heartbeats);
+    assert(stats.latency_ms == 40 && stats.zombies == 0);
+    assert(stats.dispatches >= 235 && stats.sequence == (int)stats.dispatches);
+    printf("  ✓ %llu heartbeats in 60 s, %u ms round trip, sequence %d\n",
+           (unsigned long long)stats.heartbeats, stats.latency_ms, stats.sequence);
+
+    destroy_shards(shards, 1);
+    discord_sim_destroy(sim);
+}
+
+void test_ack_loss_and_reconnects() {
+    printf("Testing ACK loss, RECONNECT and INVALID_SESSION...\n");
+
+    // Every ACK lost: each heartbeat after the first finds a zombie
+    discord_sim_config_t config = {0};
+    config.latency_ms = 10;
+    config.heartbeat_interval_ms = 1000;
+    config.ack_loss_permille = 1000;
+    discord_sim_t* sim;
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+    discord_shard_t** shards = create_shards(1, NULL);
+    assert(discord_sim_run(sim, shards, 1, 120000) == DISCORD_OK);
+
+    discord_shard_stats_t stats;
+    discord_shard_get_stats(shards[0], &stats);
+    assert(stats.zombies > 5 && stats.heartbeat_acks == 0);
+    assert(stats.identifies == 1 && stats.resumes >= stats.zombies - 1);
+    assert(stats.disconnects == stats.zombies);
+    printf("  ✓ %llu zombie connections resumed, never re-identified\n", (unsigned long long)stats.zombies);
+    destroy_shards(shards, 1);
+    discord_sim_destroy(sim);
+
+    // op 7 after every heartbeat: resume at once on a new connection
+    memset(&config, 0, sizeof(config));
+    config.heartbeat_interval_ms = 1000;
+    config.reconnect_permille = 1000;
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+    shards = create_shards(1, NULL);
+    assert(discord_sim_run(sim, shards, 1, 30000) == DISCORD_OK);
+    discord_shard_get_stats(shards[0], &stats);
+    assert(stats.reconnects_requested >= 10 && stats.identifies == 1);
+    assert(stats.resumes == stats.reconnects_requested || stats.resumes + 1 == stats.reconnects_requested);
+    assert(stats.connects == stats.resumes + 1);
+    printf("  ✓ %llu RECONNECTs answered with RESUME\n", (unsigned long long)stats.reconnects_requested);
+    destroy_shards(shards, 1);
+    discord_sim_destroy(sim);
+
+    // RESUME always rejected: op 9, then IDENTIFY again once the bucket allows
+    config.resume_reject_permille = 1000;
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+    discord_identify_limiter_t* limiter;
+    assert(discord_identify_limiter_create(1, &limiter) == DISCORD_OK);
+    shards = create_shards(1, limiter);
+    assert(discord_sim_run(sim, shards, 1, 60000) == DISCORD_OK);
+    discord_shard_get_stats(shards[0], &stats);
+    discord_sim_stats_t sim_stats;
+    discord_sim_get_stats(sim, &sim_stats);
+    assert(stats.invalid_sessions > 2 && sim_stats.identify_rejected == 0);
+    assert(sim_stats.resume_rejected == stats.invalid_sessions);
+    assert(stats.identifies == stats.invalid_sessions || stats.identifies == stats.invalid_sessions + 1);
+    printf("  ✓ %llu rejected RESUMEs fell back to IDENTIFY\n", (unsigned long long)stats.invalid_sessions);
+    destroy_shards(shards, 1);
+    discord_identify_limiter_destroy(limiter);
+    discord_sim_destroy(sim);
+}
+
+void test_identify_concurrency_at_scale() {
+    printf("Testing identify concurrency with 2000 shards...\n");
+
+    const int shard_count = 2000;
+    const uint32_t max_concurrency = 16;
+
+    discord_sim_config_t config = {0};
+    config.latency_ms = 40;
+    config.max_concurrency = max_concurrency;
+    config.ack_loss_permille = 2;
+    config.reconnect_permille = 2;
+    config.dispatch_interval_ms = 60000;
+    config.seed = 99;
+    discord_sim_t* sim;
+
+    uint64_t wall_start = discord_time_now_ns();
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+
+    discord_identify_limiter_t* limiter;
+    assert(discord_identify_limiter_create(max_concurrency, &limiter) == DISCORD_OK);
+    discord_shard_t** shards = create_shards(shard_count, limiter);
+
+    // Two hours of gateway time
+    assert(discord_sim_run(sim, shards, (uint32_t)shard_count, 2 * 3600 * 1000ull) == DISCORD_OK);
+
+    uint64_t last_ready = 0, zombies = 0, reconnects = 0, identifies = 0, heartbeats = 0, waits = 0;
+    for (int i = 0; i < shard_count; i++) {
+        discord_shard_stats_t stats;
+        discord_shard_get_stats(shards[i], &stats);
+        assert(stats.readies >= 1);
+        if (stats.first_ready_ms > last_ready) {
+            last_ready = stats.first_ready_ms;
+        }
+        zombies += stats.zombies;
+        reconnects += stats.reconnects_requested;
+        identifies += stats.identifies;
+        heartbeats += stats.heartbeats;
+        waits += stats.identify_waits;
+    }
+
+    discord_sim_stats_t sim_stats;
+    discord_sim_get_stats(sim, &sim_stats);
+    assert(sim_stats.identify_rejected == 0);
+    assert(identifies == (uint64_t)shard_count);
+    assert(waits <= (uint64_t)shard_count);     // At most one reservation per shard
+    assert(zombies > 0 && reconnects > 0);
+    assert(sim_stats.sessions_ready + 20 >= (uint32_t)shard_count);
+
+    // 125 rounds of 16 identifies, one round per window
+    uint64_t rounds = (shard_count + max_concurrency - 1) / max_concurrency;
+    assert(last_ready >= (rounds - 1) * DISCORD_IDENTIFY_WINDOW_MS);
+    assert(last_ready <= rounds * DISCORD_IDENTIFY_WINDOW_MS + 1000);
+
+    destroy_shards(shards, shard_count);
+    discord_identify_limiter_destroy(limiter);
+    discord_sim_destroy(sim);
+    uint64_t wall_ms = (discord_time_now_ns() - wall_start) / 1000000;
+
+    printf("  ✓ All shards READY by %.1f s of virtual time, no identify over its bucket\n",
+           (double)last_ready / 1000.0);
+    printf("  ✓ %llu heartbeats, %llu zombies, %llu RECONNECTs, %llu events in %llu ms wall time\n",
+           (unsigned long long)heartbeats, (unsigned long long)zombies, (unsigned long long)reconnects,
+           (unsigned long long)sim_stats.events, (unsigned long long)wall_ms);
+}
+
+void test_without_limiter() {
+    printf("Testing shards without an identify limiter...\n");
+
+    discord_sim_config_t config = {0};
+    config.latency_ms = 30;
+    config.max_concurrency = 1;
+    discord_sim_t* sim;
+    assert(discord_sim_create(&config, &sim) == DISCORD_OK);
+
+    const int shard_count = 32;
+    discord_shard_t** shards = create_shards(shard_count, NULL);
+    assert(discord_sim_run(sim, shards, (uint32_t)shard_count, 3600 * 1000ull) == DISCORD_OK);
+
+    discord_sim_stats_t sim_stats;
+    discord_sim_get_stats(sim, &sim_stats);
+    assert(sim_stats.identify_rejected > 0);
+    assert(sim_stats.sessions_ready == (uint32_t)shard_count);
+    printf("  ✓ The gateway rejected %llu IDENTIFYs; op 9 retries still got all %d shards READY\n",
+           (unsigned long long)sim_stats.identify_rejected, shard_count);
+
+    destroy_shards(shards, shard_count);
+    discord_sim_destroy(sim);
+}
+
+int main() {
+    printf("Discord ASM Bot - Gateway Simulation Tests\n");
+    printf("==========================================\n\n");
+
+    size_t baseline = live_bytes();
+
+    test_identify_limiter();
+    printf("\n");
+
+    test_virtual_transport();
+    printf("\n");
+
+    test_single_shard();
+    printf("\n");
+
+    test_ack_loss_and_reconnects();
+    printf("\n");
+
+    test_identify_concurrency_at_scale();
+    printf("\n");
+
+    test_without_limiter();
+    printf("\n");
+
+    assert(live_bytes() == baseline);
+    printf("All gateway simulation tests passed! ✓\n");
+    return 0;
+}
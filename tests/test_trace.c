@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "abi.h"
+#include "trace.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+static const char* trace_path = "test_trace.json";
+
+static void traced_work(int iterations) {
+    volatile uint64_t sink = 0;
+    for (int i = 0; i < iterations; i++) {
+        DISCORD_TRACE_BEGIN(t0);
+        for (int j = 0; j < 100; j++) {
+            sink += (uint64_t)j;
+        }
+        DISCORD_TRACE_END(t0, DISCORD_TRACE_HANDLER, i);
+    }
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    assert(f != NULL);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = malloc((size_t)size + 1);
+    assert(data != NULL);
+    assert(fread(data, 1, (size_t)size, f) == (size_t)size);
+    data[size] = '\0';
+    fclose(f);
+    return data;
+}
+
+void test_disabled_records_nothing() {
+    printf("Testing disabled tracing...\n");
+
+    discord_trace_enable(0);
+    traced_work(1000);
+
+    int opcode;
+    assert(discord_json_parse_opcode("{\"op\":10}", &opcode) == DISCORD_OK);
+    assert(discord_trace_span_count() == 0);
+    printf("  ✓ No spans recorded while disabled\n");
+}
+
+#ifndef _WIN32
+static void* worker_thread(void* arg) {
+    traced_work(*(int*)arg);
+    return NULL;
+}
+#endif
+
+void test_enabled_records_spans() {
+    printf("Testing enabled tracing...\n");
+
+    discord_trace_enable(1);
+    traced_work(100);
+
+    int opcode;
+    assert(discord_json_parse_opcode("{\"op\":11}", &opcode) == DISCORD_OK);
+    assert(discord_trace_span_count() == 101);
+    printf("  ✓ Handler and JSON spans recorded: %llu\n",
+           (unsigned long long)discord_trace_span_count());
+
+#ifndef _WIN32
+    // Each thread gets its own ring
+    pthread_t threads[4];
+    int iterations = 50;
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_create(&threads[i], NULL, worker_thread, &iterations) == 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(discord_trace_span_count() == 301);
+    printf("  ✓ Per-thread rings recorded concurrently\n");
+#endif
+
+    // Ring keeps only the newest spans
+    discord_trace_reset();
+    traced_work(DISCORD_TRACE_RING_SIZE + 10);
+    assert(discord_trace_span_count() == DISCORD_TRACE_RING_SIZE);
+    printf("  ✓ Ring wraps at %d spans\n", DISCORD_TRACE_RING_SIZE);
+
+    discord_trace_enable(0);
+}
+
+void test_chrome_export() {
+    printf("Testing Chrome trace export...\n");
+
+    discord_trace_reset();
+    discord_trace_enable(1);
+    traced_work(10);
+    int opcode;
+    assert(discord_json_parse_opcode("{\"op\":0}", &opcode) == DISCORD_OK);
+    discord_trace_enable(0);
+
+    assert(discord_trace_dump(trace_path) == DISCORD_OK);
+
+    char* json = read_file(trace_path);
+    assert(strncmp(json, "{\"displayTimeUnit\"", 18) == 0);
+    assert(strstr(json, "\"traceEvents\":[") != NULL);
+    assert(strstr(json, "\"name\":\"handler\",\"ph\":\"X\"") != NULL);
+    assert(strstr(json, "\"name\":\"json_parse\",\"ph\":\"X\"") != NULL);
+    assert(strstr(json, "\"thread_name\"") != NULL);
+    printf("  ✓ Trace JSON written (%zu bytes)\n", strlen(json));
+
+    free(json);
+    remove(trace_path);
+}
+
+int main() {
+    printf("Discord ASM Trace Tests\n");
+    printf("=======================\n\n");
+
+    test_disabled_records_nothing();
+    printf("\n");
+
+    test_enabled_records_spans();
+    printf("\n");
+
+    test_chrome_export();
+    printf("\n");
+
+    printf("All trace tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include "abi.h"
+#include "wsframe.h"
+
+#define LARGE_FRAME (100 * 1024)
+#define BURST_FRAMES 1000
+
+// Local stand-in for the gateway: one connection, optionally over TLS
+// with a throwaway self-signed certificate, running a fixed script
+typedef struct {
+    int listener;
+    int port;
+    int tls;
+    SSL_CTX* ctx;
+    SSL* ssl;
+    int fd;
+    int got_pong;
+    int got_text;
+    int got_close;
+} server_t;
+
+static int server_write(server_t* s, const void* data, size_t length) {
+    const char* p = data;
+    while (length > 0) {
+        int n = s->ssl ? SSL_write(s->ssl, p, (int)length) : (int)send(s->fd, p, length, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static int server_read(server_t* s, void* data, size_t length) {
+    char* p = data;
+    while (length > 0) {
+        int n = s->ssl ? SSL_read(s->ssl, p, (int)length) : (int)recv(s->fd, p, length, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+// Append an unmasked server frame to out
+static size_t frame(uint8_t* out, int opcode, int fin, const void* payload, size_t length) {
+    size_t header = discord_wsframe_header(out, opcode, fin, length, NULL);
+    memcpy(out + header, payload, length);
+    return header + length;
+}
+
+static int read_client_frame(server_t* s, discord_wsframe_t* f, uint8_t* payload) {
+    uint8_t header[DISCORD_WSFRAME_HEADER_MAX];
+    size_t have = 2;
+    if (server_read(s, header, 2) != 0) {
+        return -1;
+    }
+    int parsed;
+    while ((parsed = discord_wsframe_parse(header, have, f)) == 0) {
+        if (server_read(s, header + have, 1) != 0) {
+            return -1;
+        }
+        have++;
+    }
+    assert(parsed == 1 && f->masked);
+    if (server_read(s, payload, (size_t)f->payload_length) != 0) {
+        return -1;
+    }
+    discord_wsframe_mask_scalar(payload, (size_t)f->payload_length, f->mask, 0);
+    return 0;
+}
+
+static void* server_thread(void* arg) {
+    server_t* s = arg;
+    s->fd = accept(s->listener, NULL, NULL);
+    assert(s->fd >= 0);
+
+    if (s->tls) {
+        s->ssl = SSL_new(s->ctx);
+        SSL_set_fd(s->ssl, s->fd);
+        assert(SSL_accept(s->ssl) == 1);
+    }
+
+    // Upgrade request
+    char request[2048] = "";
+    size_t used = 0;
+    while (!strstr(request, "\r\n\r\n")) {
+        assert(server_read(s, request + used, 1) == 0);
+        request[++used] = '\0';
+    }
+    assert(strstr(request, "GET /?v=10&encoding=json HTTP/1.1\r\n") == request);
+    const char* key = strstr(request, "Sec-WebSocket-Key: ") + 19;
+    char concatenated[128], accept[64];
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned digest_length = 0;
+    int key_length = (int)(strstr(key, "\r\n") - key);
+    snprintf(concatenated, sizeof(concatenated), "%.*s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key_length, key);
+    EVP_Digest(concatenated, strlen(concatenated), digest, &digest_length, EVP_sha1(), NULL);
+    EVP_EncodeBlock((unsigned char*)accept, digest, (int)digest_length);
+
+    // The response and the first frame arrive in one write
+    uint8_t* out = malloc(LARGE_FRAME + BURST_FRAMES * 32 + 4096);
+    size_t n = (size_t)sprintf((char*)out, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                               "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+    n += frame(out + n, DISCORD_WSFRAME_TEXT, 1, "welcome", 7);
+    assert(server_write(s, out, n) == 0);
+
+    // Ping, then a message in three fragments with a ping between them
+    n = frame(out, DISCORD_WSFRAME_PING, 1, "p", 1);
+    n += frame(out + n, DISCORD_WSFRAME_TEXT, 0, "frag", 4);
+    n += frame(out + n, DISCORD_WSFRAME_CONTINUATION, 0, "ment", 4);
+    n += frame(out + n, DISCORD_WSFRAME_PING, 1, "", 0);
+    n += frame(out + n, DISCORD_WSFRAME_CONTINUATION, 1, "ed", 2);
+    assert(server_write(s, out, n) == 0);
+
+    // One frame larger than the client's receive buffer
+    char* large = malloc(LARGE_FRAME);
+    for (size_t i = 0; i < LARGE_FRAME; i++) {
+        large[i] = (char)('a' + i % 26);
+    }
+    n = frame(out, DISCORD_WSFRAME_TEXT, 1, large, LARGE_FRAME);
+    assert(server_write(s, out, n) == 0);
+    free(large);
+
+    // A burst of small frames in one write
+    n = 0;
+    for (int i = 0; i < BURST_FRAMES; i++) {
+        char body[32];
+        int length = snprintf(body, sizeof(body), "{\"op\":0,\"s\":%d}", i);
+        n += frame(out + n, DISCORD_WSFRAME_TEXT, 1, body, (size_t)length);
+    }
+    assert(server_write(s, out, n) == 0);
+
+    // Collect the client's pongs and its text frame, then close
+    discord_wsframe_t f;
+    uint8_t payload[256];
+    while (!s->got_text || s->got_pong < 2) {
+        assert(read_client_frame(s, &f, payload) == 0);
+        if (f.opcode == DISCORD_WSFRAME_PONG) {
+            s->got_pong++;
+        } else if (f.opcode == DISCORD_WSFRAME_TEXT) {
+            assert(f.payload_length == 11 && memcmp(payload, "from client", 11) == 0);
+            s->got_text = 1;
+        }
+    }
+
+    static const uint8_t going_away[2] = { 0x03, 0xE9 };
+    n = frame(out, DISCORD_WSFRAME_CLOSE, 1, going_away, 2);
+    assert(server_write(s, out, n) == 0);
+    if (read_client_frame(s, &f, payload) == 0 && f.opcode == DISCORD_WSFRAME_CLOSE) {
+        s->got_close = f.payload_length == 2 && payload[0] == 0x03 && payload[1] == 0xE9;
+    }
+
+    free(out);
+    if (s->ssl) {
+        SSL_free(s->ssl);
+    }
+    close(s->fd);
+    return NULL;
+}
+
+static SSL_CTX* self_signed_ctx(void) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(ctx, cert);
+    SSL_CTX_use_PrivateKey(ctx, key);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+}
+
+static void start_server(server_t* s, int tls, pthread_t* thread) {
+    memset(s, 0, sizeof(*s));
+    s->tls = tls;
+    s->ctx = tls ? self_signed_ctx() : NULL;
+    s->listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(s->listener, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    assert(listen(s->listener, 1) == 0);
+    socklen_t length = sizeof(addr);
+    getsockname(s->listener, (struct sockaddr*)&addr, &length);
+    s->port = ntohs(addr.sin_port);
+    pthread_create(thread, NULL, server_thread, s);
+}
+
+static void run_script(int tls) {
+    server_t server;
+    pthread_t thread;
+    start_server(&server, tls, &thread);
+
+    char url[128];
+    snprintf(url, sizeof(url), "%s://localhost:%d/?v=10&encoding=json", tls ? "wss" : "ws", server.port);
+    discord_ws_options_t options = { DISCORD_WS_TRANSPORT_URING, 1, 16 * 1024, 0 };
+
+    discord_ws_stats_t before, stats;
+    discord_ws_get_stats(&before);
+
+    discord_gateway_t* gateway = NULL;
+    assert(discord_ws_connect_ex(url, &options, &gateway) == DISCORD_OK);
+    discord_ws_get_stats(&stats);
+    assert(stats.uring_connections == 1);
+
+    discord_ws_message_t message;
+    assert(discord_ws_receive(gateway, &message, 2000) == DISCORD_OK);
+    assert(message.length == 7 && strcmp(message.data, "welcome") == 0);
+    discord_ws_free_message(&message);
+    printf("  ✓ Upgrade verified; frame behind the 101 response delivered\n");
+
+    assert(discord_ws_send(gateway, "from client", 11) == DISCORD_OK);
+
+    assert(discord_ws_receive(gateway, &message, 2000) == DISCORD_OK);
+    assert(message.length == 10 && strcmp(message.data, "fragmented") == 0);
+    discord_ws_free_message(&message);
+    printf("  ✓ Fragments reassembled around a ping\n");
+
+    assert(discord_ws_receive(gateway, &message, 2000) == DISCORD_OK);
+    assert(message.length == LARGE_FRAME && message.data[LARGE_FRAME] == '\0');
+    for (size_t i = 0; i < LARGE_FRAME; i++) {
+        assert(message.data[i] == (char)('a' + i % 26));
+    }
+    discord_ws_free_message(&message);
+    printf("  ✓ Frame larger than the receive buffer streamed in\n");
+
+    for (int i = 0; i < BURST_FRAMES; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "{\"op\":0,\"s\":%d}", i);
+        assert(discord_ws_receive(gateway, &message, 2000) == DISCORD_OK);
+        assert(strcmp(message.data, expected) == 0 && message.length == strlen(expected));
+        int sequence = 0;
+        assert(discord_json_parse_root_int(message.data, message.length, "s", &sequence) == DISCORD_OK);
+        assert(sequence == i);
+        discord_ws_free_message(&message);
+    }
+    printf("  ✓ %d back-to-back frames handed out in place\n", BURST_FRAMES);
+
+    // Server closes with 1001 once it has both pongs and our text
+    assert(discord_ws_receive(gateway, &message, 2000) == DISCORD_ERROR_NETWORK);
+
+    discord_ws_get_stats(&stats);
+    assert(stats.frames_received - before.frames_received == BURST_FRAMES + 3);
+    assert(stats.syscalls > before.syscalls);
+    // Only the large frame, the fragments and the send were copied
+    uint64_t copied = stats.bytes_copied - before.bytes_copied;
+    assert(copied >= LARGE_FRAME + 10 + 11 && copied < LARGE_FRAME + 16 * 1024);
+    printf("  ✓ %llu syscalls, %llu bytes copied, kTLS %s\n",
+           (unsigned long long)(stats.syscalls - before.syscalls), (unsigned long long)copied,
+           stats.ktls_connections ? "on" : "off");
+
+    assert(discord_ws_close(gateway) == DISCORD_OK);
+    pthread_join(thread, NULL);
+    assert(server.got_pong == 2 && server.got_text && server.got_close);
+    printf("  ✓ Pongs, masked text and close echo seen by the server\n");
+
+    close(server.listener);
+    if (server.ctx) {
+        SSL_CTX_free(server.ctx);
+    }
+}
+
+void test_plain() {
+    printf("Testing io_uring transport over ws://...\n");
+    run_script(0);
+}
+
+void test_tls() {
+    printf("Testing io_uring transport over wss://...\n");
+    run_script(1);
+}
+
+void test_errors() {
+    printf("Testing connect errors...\n");
+
+    discord_ws_options_t options = { DISCORD_WS_TRANSPORT_URING, 0, 0, 0 };
+    discord_gateway_t* gateway = NULL;
+    assert(discord_ws_connect_ex("http://localhost/", &options, &gateway) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_ws_connect_ex("ws://localhost:0/", &options, &gateway) == DISCORD_ERROR_INVALID_PARAM);
+
+    // Nothing listening on a port that was just free
+    int probe = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    bind(probe, (struct sockaddr*)&addr, sizeof(addr));
+    getsockname(probe, (struct sockaddr*)&addr, &length);
+    close(probe);
+    char url[64];
+    snprintf(url, sizeof(url), "ws://127.0.0.1:%d/", ntohs(addr.sin_port));
+    assert(discord_ws_connect_ex(url, &options, &gateway) == DISCORD_ERROR_NETWORK);
+    printf("  ✓ Bad URLs and refused connections reported\n");
+
+    discord_mem_stats_t memory;
+    discord_mem_get_stats(DISCORD_MEM_RECEIVE, &memory);
+    assert(memory.live_bytes == 0);
+    discord_mem_get_stats(DISCORD_MEM_SEND, &memory);
+    assert(memory.live_bytes == 0);
+    assert(discord_ws_shutdown() == DISCORD_OK);
+    printf("  ✓ Connection buffers released\n");
+}
+
+int main() {
+    printf("Discord ASM Bot - io_uring Transport Tests\n");
+    printf("==========================================\n\n");
+
+    test_plain();
+    printf("\n");
+
+    test_tls();
+    printf("\n");
+
+    test_errors();
+    printf("\n");
+
+    printf("All io_uring transport tests passed! ✓\n");
+    return 0;
+}
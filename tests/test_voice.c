@@ -0,0 +1,448 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include "abi.h"
+#include "voice.h"
+
+// Local stand-ins: a UDP voice server that answers IP discovery and
+// decrypts every RTP packet it receives, and a voice WebSocket played
+// through the send callback (replies are queued and fed back with
+// discord_voice_handle).
+
+#define STREAMS         8
+#define FRAMES          50
+#define MAX_PACKETS     128
+#define SSRC_BASE       1000
+
+typedef struct {
+    uint64_t arrival_ns;
+    uint16_t sequence;
+    uint32_t timestamp;
+    size_t length;
+    unsigned char first;
+} received_t;
+
+typedef struct {
+    int index;
+    char outbox[4][512];
+    int outbox_count;
+    int identified;
+    int selected;
+    int speaking;
+    int heartbeats;
+    char last_heartbeat[512];
+    const char* modes;
+} ws_standin_t;
+
+static int udp_fd = -1;
+static uint16_t udp_port = 0;
+static volatile int udp_stop = 0;
+static int discovery_requests = 0;
+static int decrypt_failures = 0;
+static received_t received[STREAMS][MAX_PACKETS];
+static volatile int received_count[STREAMS];
+
+static void stream_key(int index, unsigned char key[32]) {
+    for (int i = 0; i < 32; i++) {
+        key[i] = (unsigned char)(index * 7 + i);
+    }
+}
+
+static void handle_rtp(const unsigned char* packet, size_t n, uint64_t now) {
+    assert(n >= 12 + 16 + 4 && packet[0] == 0x80 && packet[1] == 0x78);
+    uint32_t ssrc = ((uint32_t)packet[8] << 24) | ((uint32_t)packet[9] << 16) | (packet[10] << 8) | packet[11];
+    int index = (int)(ssrc - SSRC_BASE);
+    assert(index >= 0 && index < STREAMS);
+
+    unsigned char key[32];
+    unsigned char iv[12] = {0};
+    unsigned char plain[1500];
+    size_t length = n - 12 - 16 - 4;
+    stream_key(index, key);
+    memcpy(iv, packet + n - 4, 4);
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int out = 0;
+    int ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, iv) == 1 &&
+             EVP_DecryptUpdate(ctx, NULL, &out, packet, 12) == 1 &&
+             EVP_DecryptUpdate(ctx, plain, &out, packet + 12, (int)length) == 1 &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, 16, (void*)(packet + 12 + length)) == 1 &&
+             EVP_DecryptFinal_ex(ctx, plain + out, &out) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) {
+        decrypt_failures++;
+        return;
+    }
+
+    int slot = received_count[index];
+    if (slot < MAX_PACKETS) {
+        received[index][slot].arrival_ns = now;
+        received[index][slot].sequence = (uint16_t)((packet[2] << 8) | packet[3]);
+        received[index][slot].timestamp = ((uint32_t)packet[4] << 24) | ((uint32_t)packet[5] << 16) |
+                                          (packet[6] << 8) | packet[7];
+        received[index][slot].length = length;
+        received[index][slot].first = plain[0];
+        received_count[index] = slot + 1;
+    }
+}
+
+static void* udp_standin(void* arg) {
+    (void)arg;
+    while (!udp_stop) {
+        struct pollfd pfd = { udp_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+
+        unsigned char packet[2048];
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(udp_fd, packet, sizeof(packet), 0, (struct sockaddr*)&from, &from_len);
+        uint64_t now = discord_time_now_ns();
+        if (n <= 0) {
+            continue;
+        }
+
+        if (n == 74 && packet[0] == 0 && packet[1] == 1) {
+            // IP discovery: echo the address and port the request came from
+            discovery_requests++;
+            unsigned char reply[74] = {0};
+            reply[1] = 2;
+            reply[3] = 70;
+            memcpy(reply + 4, packet + 4, 4);
+            inet_ntop(AF_INET, &from.sin_addr, (char*)reply + 8, 64);
+            memcpy(reply + 72, &from.sin_port, 2);
+            sendto(udp_fd, reply, sizeof(reply), 0, (struct sockaddr*)&from, from_len);
+            continue;
+        }
+
+        handle_rtp(packet, (size_t)n, now);
+    }
+    return NULL;
+}
+
+static void start_udp_standin(pthread_t* thread) {
+    udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(udp_fd >= 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(udp_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    getsockname(udp_fd, (struct sockaddr*)&addr, &len);
+    udp_port = ntohs(addr.sin_port);
+
+    int size = 4 << 20;
+    setsockopt(udp_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    udp_stop = 0;
+    assert(pthread_create(thread, NULL, udp_standin, NULL) == 0);
+}
+
+static void stop_udp_standin(pthread_t thread) {
+    udp_stop = 1;
+    pthread_join(thread, NULL);
+    close(udp_fd);
+}
+
+static discord_result_t ws_standin_send(void* user, const char* data, size_t length) {
+    ws_standin_t* ws = (ws_standin_t*)user;
+    char json[512];
+    assert(length < sizeof(json));
+    memcpy(json, data, length);
+    json[length] = '\0';
+
+    if (strncmp(json, "{\"op\":0,", 8) == 0) {
+        assert(strstr(json, "\"server_id\":\"41771983423143937\"") != NULL);
+        assert(strstr(json, "\"session_id\":\"my_session_id\"") != NULL);
+        assert(strstr(json, "\"token\":\"my_token\"") != NULL);
+        ws->identified++;
+        snprintf(ws->outbox[ws->outbox_count++], sizeof(ws->outbox[0]),
+                 "{\"op\":2,\"seq\":1,\"d\":{\"ssrc\":%d,\"ip\":\"127.0.0.1\",\"port\":%u,\"modes\":[%s]}}",
+                 SSRC_BASE + ws->index, udp_port, ws->modes);
+    } else if (strncmp(json, "{\"op\":1,", 8) == 0) {
+        assert(strstr(json, "\"address\":\"127.0.0.1\"") != NULL);
+        assert(strstr(json, "\"mode\":\"aead_aes256_gcm_rtpsize\"") != NULL);
+        ws->selected++;
+
+        unsigned char key[32];
+        stream_key(ws->index, key);
+        char* out = ws->outbox[ws->outbox_count++];
+        int pos = sprintf(out, "{\"op\":4,\"seq\":2,\"d\":{\"mode\":\"aead_aes256_gcm_rtpsize\",\"secret_key\":[");
+        for (int i = 0; i < 32; i++) {
+            pos += sprintf(out + pos, "%s%u", i ? "," : "", key[i]);
+        }
+        sprintf(out + pos, "]}}");
+    } else if (strncmp(json, "{\"op\":5,", 8) == 0) {
+        ws->speaking++;
+    } else if (strncmp(json, "{\"op\":3,", 8) == 0) {
+        ws->heartbeats++;
+        snprintf(ws->last_heartbeat, sizeof(ws->last_heartbeat), "%s", json);
+    }
+    return DISCORD_OK;
+}
+
+static discord_result_t handshake(discord_voice_t* voice, ws_standin_t* ws) {
+    const char* hello = "{\"op\":8,\"d\":{\"heartbeat_interval\":41250.0}}";
+    discord_result_t result = discord_voice_handle(voice, hello, strlen(hello));
+    while (result == DISCORD_OK && ws->outbox_count > 0) {
+        char frame[512];
+        memcpy(frame, ws->outbox[0], sizeof(frame));
+        memmove(ws->outbox[0], ws->outbox[1], sizeof(ws->outbox[0]) * 3);
+        ws->outbox_count--;
+        result = discord_voice_handle(voice, frame, strlen(frame));
+    }
+    return result;
+}
+
+static discord_voice_t* open_stream(discord_voice_sender_t* sender, ws_standin_t* ws, int index) {
+    memset(ws, 0, sizeof(*ws));
+    ws->index = index;
+    ws->modes = "\"aead_xchacha20_poly1305_rtpsize\",\"aead_aes256_gcm_rtpsize\"";
+
+    discord_voice_config_t config = {0};
+    config.sender = sender;
+    config.send = ws_standin_send;
+    config.send_user = ws;
+    config.server_id = "41771983423143937";
+    config.user_id = "104694319306248192";
+    config.session_id = "my_session_id";
+    config.token = "my_token";
+    config.queue_frames = 64;
+
+    discord_voice_t* voice = NULL;
+    assert(discord_voice_create(&config, &voice) == DISCORD_OK);
+    return voice;
+}
+
+static void make_frame(unsigned char* frame, size_t length, int index, int n) {
+    frame[0] = (unsigned char)(index * 16 + (n & 0xF));
+    for (size_t i = 1; i < length; i++) {
+        frame[i] = (unsigned char)(i + (size_t)n);
+    }
+}
+
+void test_state_update() {
+    printf("Testing voice state update payload...\n");
+
+    char* json = NULL;
+    assert(discord_voice_create_state_update("41771983423143937", "127121515262115840", 0, 1, &json) == DISCORD_OK);
+    assert(strcmp(json, "{\"op\":4,\"d\":{\"guild_id\":\"41771983423143937\","
+                        "\"channel_id\":\"127121515262115840\",\"self_mute\":false,\"self_deaf\":true}}") == 0);
+    discord_json_free(json);
+
+    assert(discord_voice_create_state_update("41771983423143937", NULL, 0, 0, &json) == DISCORD_OK);
+    assert(strstr(json, "\"channel_id\":null") != NULL);
+    discord_json_free(json);
+    printf("  ✓ Join and leave payloads\n");
+}
+
+void test_handshake() {
+    printf("Testing voice handshake...\n");
+
+    pthread_t thread;
+    start_udp_standin(&thread);
+
+    discord_voice_sender_t* sender = NULL;
+    assert(discord_voice_sender_create(&sender) == DISCORD_OK);
+
+    ws_standin_t ws;
+    discord_voice_t* voice = open_stream(sender, &ws, 0);
+    assert(handshake(voice, &ws) == DISCORD_OK);
+    assert(ws.identified == 1 && ws.selected == 1 && ws.speaking == 1);
+    assert(discovery_requests >= 1);
+
+    discord_voice_stats_t stats;
+    assert(discord_voice_get_stats(voice, &stats) == DISCORD_OK);
+    assert(stats.state == DISCORD_VOICE_READY && stats.ssrc == SSRC_BASE);
+    printf("  ✓ HELLO -> IDENTIFY -> READY -> IP discovery -> SELECT_PROTOCOL -> key\n");
+
+    // Heartbeats acknowledge the last sequence seen
+    assert(discord_voice_poll(voice, discord_time_now_ms()) == DISCORD_OK && ws.heartbeats == 0);
+    assert(discord_voice_poll(voice, discord_time_now_ms() + 41250) == DISCORD_OK && ws.heartbeats == 1);
+    assert(strstr(ws.last_heartbeat, "\"seq_ack\":2") != NULL);
+    printf("  ✓ Heartbeat with seq_ack\n");
+
+    // A server without the AES-GCM mode is refused
+    ws_standin_t ws2;
+    discord_voice_t* other = open_stream(sender, &ws2, 1);
+    ws2.modes = "\"aead_xchacha20_poly1305_rtpsize\"";
+    assert(handshake(other, &ws2) == DISCORD_ERROR_UNSUPPORTED);
+    discord_voice_get_stats(other, &stats);
+    assert(stats.state == DISCORD_VOICE_FAILED && ws2.selected == 0);
+    discord_voice_destroy(other);
+    printf("  ✓ Unsupported encryption modes rejected\n");
+
+    discord_voice_destroy(voice);
+    discord_voice_sender_destroy(sender);
+    stop_udp_standin(thread);
+}
+
+void test_packets() {
+    printf("Testing RTP packets...\n");
+
+    memset((void*)received_count, 0, sizeof(received_count));
+    pthread_t thread;
+    start_udp_standin(&thread);
+
+    discord_voice_sender_t* sender = NULL;
+    assert(discord_voice_sender_create(&sender) == DISCORD_OK);
+    ws_standin_t ws;
+    discord_voice_t* voice = open_stream(sender, &ws, 0);
+
+    unsigned char frame[200];
+    make_frame(frame, sizeof(frame), 0, 0);
+    assert(discord_voice_enqueue(voice, frame, sizeof(frame)) == DISCORD_OK);
+    assert(discord_voice_sender_tick(sender) == 0); // Not READY yet: frame stays queued
+    assert(discord_voice_queued(voice) == 1);
+
+    assert(handshake(voice, &ws) == DISCORD_OK);
+    for (int i = 1; i < 3; i++) {
+        make_frame(frame, sizeof(frame), 0, i);
+        assert(discord_voice_enqueue(voice, frame, sizeof(frame)) == DISCORD_OK);
+    }
+
+    // Three frames, five silence frames, then nothing
+    uint32_t total = 0;
+    for (int i = 0; i < 10; i++) {
+        total += discord_voice_sender_tick(sender);
+    }
+    assert(total == 3 + DISCORD_VOICE_SILENCE_FRAMES);
+
+    for (int wait = 0; wait < 100 && received_count[0] < (int)total; wait++) {
+        discord_sleep_ms(5);
+    }
+    assert(received_count[0] == (int)total && decrypt_failures == 0);
+    for (int i = 0; i < (int)total; i++) {
+        assert(received[0][i].sequence == (uint16_t)(received[0][0].sequence + i));
+        assert(received[0][i].timestamp == received[0][0].timestamp + (uint32_t)i * DISCORD_VOICE_FRAME_SAMPLES);
+        if (i < 3) {
+            assert(received[0][i].length == sizeof(frame) && received[0][i].first == i);
+        } else {
+            assert(received[0][i].length == 3 && received[0][i].first == 0xF8);
+        }
+    }
+    printf("  ✓ Sequence, timestamp and AES-GCM payloads verified by the stand-in\n");
+
+    discord_voice_stats_t stats;
+    discord_voice_get_stats(voice, &stats);
+    assert(stats.frames_sent == 3 && stats.silence_sent == DISCORD_VOICE_SILENCE_FRAMES && stats.underruns == 1);
+
+    // Queue bounds
+    for (int i = 0; i < 64; i++) {
+        assert(discord_voice_enqueue(voice, frame, sizeof(frame)) == DISCORD_OK);
+    }
+    assert(discord_voice_enqueue(voice, frame, sizeof(frame)) == DISCORD_ERROR_MEMORY);
+    assert(discord_voice_enqueue(voice, frame, DISCORD_VOICE_FRAME_MAX + 1) == DISCORD_ERROR_INVALID_PARAM);
+    discord_voice_get_stats(voice, &stats);
+    assert(stats.dropped == 1);
+    printf("  ✓ Silence after the queue runs dry, full queue reported\n");
+
+    discord_voice_destroy(voice);
+    discord_voice_sender_destroy(sender);
+    stop_udp_standin(thread);
+}
+
+void test_paced_streams() {
+    printf("Testing paced sending across %d streams...\n", STREAMS);
+
+    memset((void*)received_count, 0, sizeof(received_count));
+    pthread_t thread;
+    start_udp_standin(&thread);
+
+    discord_voice_sender_t* sender = NULL;
+    assert(discord_voice_sender_create(&sender) == DISCORD_OK);
+
+    ws_standin_t ws[STREAMS];
+    discord_voice_t* voices[STREAMS];
+    for (int s = 0; s < STREAMS; s++) {
+        voices[s] = open_stream(sender, &ws[s], s);
+        assert(handshake(voices[s], &ws[s]) == DISCORD_OK);
+        unsigned char frame[160];
+        for (int i = 0; i < FRAMES; i++) {
+            make_frame(frame, sizeof(frame), s, i);
+            assert(discord_voice_enqueue(voices[s], frame, sizeof(frame)) == DISCORD_OK);
+        }
+    }
+
+    int expected = FRAMES + DISCORD_VOICE_SILENCE_FRAMES;
+    assert(discord_voice_sender_start(sender) == DISCORD_OK);
+    for (int wait = 0; wait < 400; wait++) {
+        int done = 1;
+        for (int s = 0; s < STREAMS; s++) {
+            done &= received_count[s] >= expected;
+        }
+        if (done) {
+            break;
+        }
+        discord_sleep_ms(10);
+    }
+    discord_voice_sender_stop(sender);
+
+    // Inter-arrival times against the 20 ms frame clock
+    double sum_deviation = 0.0;
+    double max_deviation = 0.0;
+    int intervals = 0;
+    for (int s = 0; s < STREAMS; s++) {
+        assert(received_count[s] == expected);
+        for (int i = 1; i < expected; i++) {
+            double gap_ms = (double)(received[s][i].arrival_ns - received[s][i - 1].arrival_ns) / 1e6;
+            double deviation = gap_ms > DISCORD_VOICE_FRAME_MS ? gap_ms - DISCORD_VOICE_FRAME_MS
+                                                               : DISCORD_VOICE_FRAME_MS - gap_ms;
+            sum_deviation += deviation;
+            max_deviation = deviation > max_deviation ? deviation : max_deviation;
+            intervals++;
+        }
+    }
+    assert(decrypt_failures == 0);
+
+    discord_voice_sender_stats_t stats;
+    assert(discord_voice_sender_get_stats(sender, &stats) == DISCORD_OK);
+    assert(stats.streams == STREAMS && stats.packets == (uint64_t)(STREAMS * expected));
+    assert(stats.send_errors == 0);
+#ifdef __linux__
+    assert(stats.syscalls <= stats.ticks); // One sendmmsg per tick
+#endif
+
+    double mean = sum_deviation / intervals;
+    printf("  ✓ %llu packets in %llu syscalls over %llu ticks\n",
+           (unsigned long long)stats.packets, (unsigned long long)stats.syscalls,
+           (unsigned long long)stats.ticks);
+    printf("  ✓ Jitter: mean %.3f ms, max %.3f ms (timer late %llu times, worst %.3f ms)\n",
+           mean, max_deviation, (unsigned long long)stats.late_ticks, (double)stats.max_late_ns / 1e6);
+    assert(mean < 2.0);
+
+    for (int s = 0; s < STREAMS; s++) {
+        discord_voice_destroy(voices[s]);
+    }
+    discord_voice_sender_destroy(sender);
+    stop_udp_standin(thread);
+}
+
+int main() {
+    printf("Discord ASM Bot - Voice Tests\n");
+    printf("=============================\n\n");
+
+    test_state_update();
+    printf("\n");
+
+    test_handshake();
+    printf("\n");
+
+    test_packets();
+    printf("\n");
+
+    test_paced_streams();
+    printf("\n");
+
+    printf("All voice tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#endif
+#include "abi.h"
+#include "dispatch.h"
+#include "qos.h"
+
+// Nothing listens here, so connections fail without leaving the host
+static const char* unreachable_url = "wss://127.0.0.1:1/?v=10&encoding=json";
+
+void test_stats_without_connections() {
+    printf("Testing stats with no connections...\n");
+
+    discord_ws_stats_t stats;
+    assert(discord_ws_get_stats(&stats) == DISCORD_OK);
+    assert(stats.connections == 0);
+    assert(stats.connection_bytes == 0 && stats.bytes_per_connection == 0);
+    assert(discord_ws_get_stats(NULL) == DISCORD_ERROR_INVALID_PARAM);
+    assert(discord_ws_shutdown() == DISCORD_OK);
+    printf("  ✓ Empty stats and shutdown\n");
+}
+
+void test_shared_context() {
+    printf("Testing shared context across connections...\n");
+
+    discord_gateway_t* gateways[4] = {0};
+    int connected = 0;
+    for (int i = 0; i < 4; i++) {
+        if (discord_ws_connect(unreachable_url, &gateways[i]) == DISCORD_OK) {
+            connected++;
+        }
+    }
+
+    discord_ws_stats_t stats;
+    assert(discord_ws_get_stats(&stats) == DISCORD_OK);
+    assert(stats.connections == (uint32_t)connected);
+    assert(stats.contexts_created <= 1);
+    if (connected > 0) {
+        assert(stats.contexts_created == 1);
+        assert(stats.bytes_per_connection > 0);
+        printf("  %d connections, %zu bytes per connection\n", connected, stats.bytes_per_connection);
+    }
+    printf("  ✓ One lws_context for all connections\n");
+
+    // Each connection sees its own failure instead of hanging
+    for (int i = 0; i < 4; i++) {
+        if (!gateways[i]) {
+            continue;
+        }
+        discord_ws_message_t message = {0};
+        discord_result_t result = discord_ws_receive(gateways[i], &message, 2000);
+        assert(result == DISCORD_ERROR_NETWORK || result == DISCORD_ERROR_TIMEOUT);
+        assert(message.data == NULL);
+    }
+    printf("  ✓ Connection errors reported per connection\n");
+
+    // Shutdown is refused while connections are open
+    if (connected > 0) {
+        assert(discord_ws_shutdown() == DISCORD_ERROR_INVALID_PARAM);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (gateways[i]) {
+            assert(discord_ws_close(gateways[i]) == DISCORD_OK);
+        }
+    }
+
+    // The context survives the last close so reconnects keep the TLS cache
+    uint32_t created = stats.contexts_created;
+    discord_gateway_t* again = NULL;
+    if (discord_ws_connect(unreachable_url, &again) == DISCORD_OK) {
+        assert(discord_ws_get_stats(&stats) == DISCORD_OK);
+        assert(stats.contexts_created == (created ? created : 1));
+        assert(discord_ws_close(again) == DISCORD_OK);
+    }
+
+    assert(discord_ws_get_stats(&stats) == DISCORD_OK);
+    assert(stats.connections == 0 && stats.queued_frames == 0);
+    assert(discord_ws_shutdown() == DISCORD_OK);
+    printf("  ✓ Context kept across reconnect and released by shutdown\n");
+}
+
+#ifndef _WIN32
+// Loopback TLS gateway: a throwaway self-signed certificate, a server
+// side session cache, and one thread per connection that answers the
+// upgrade with 101 and HELLO, then answers whatever the client sends
+// with a HEARTBEAT_ACK until it closes the connection
+#define HELLO "{\"op\":10,\"d\":{\"heartbeat_interval\":41250}}"
+#define HEARTBEAT_ACK "{\"op\":11}"
+
+static struct {
+    SSL_CTX* ssl_ctx;
+    int listener;
+    int port;
+    pthread_t acceptor;
+} tls_server;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static void* tls_conn_thread(void* arg) {
+    SSL* ssl = arg;
+    if (SSL_accept(ssl) != 1) {
+        SSL_free(ssl);
+        return NULL;
+    }
+
+    char request[2048] = "";
+    size_t used = 0;
+    while (!strstr(request, "\r\n\r\n") && used < sizeof(request) - 1) {
+        int n = SSL_read(ssl, request + used, (int)(sizeof(request) - 1 - used));
+        if (n <= 0) {
+            break;
+        }
+        used += (size_t)n;
+        request[used] = '\0';
+    }
+
+    const char* key = strstr(request, "Sec-WebSocket-Key: ");
+    assert(key);
+    key += 19;
+    char concatenated[128], accept_key[64];
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned digest_length = 0;
+    int key_length = (int)(strstr(key, "\r\n") - key);
+    snprintf(concatenated, sizeof(concatenated), "%.*s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key_length, key);
+    EVP_Digest(concatenated, strlen(concatenated), digest, &digest_length, EVP_sha1(), NULL);
+    EVP_EncodeBlock((unsigned char*)accept_key, digest, (int)digest_length);
+
+    char out[512];
+    int n = snprintf(out, sizeof(out), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                     "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept_key);
+    out[n++] = (char)0x81;                      // FIN, text
+    out[n++] = (char)strlen(HELLO);
+    memcpy(out + n, HELLO, strlen(HELLO));
+    n += (int)strlen(HELLO);
+    assert(SSL_write(ssl, out, n) == n);
+
+    // One ACK per read until the client goes away
+    char sink[4096];
+    char ack[2 + sizeof(HEARTBEAT_ACK)] = { (char)0x81, (char)strlen(HEARTBEAT_ACK) };
+    memcpy(ack + 2, HEARTBEAT_ACK, strlen(HEARTBEAT_ACK));
+    while (SSL_read(ssl, sink, sizeof(sink)) > 0) {
+        SSL_write(ssl, ack, 2 + (int)strlen(HEARTBEAT_ACK));
+    }
+
+    close(SSL_get_fd(ssl));
+    SSL_free(ssl);
+    return NULL;
+}
+
+static void* tls_accept_thread(void* arg) {
+    (void)arg;
+    for (;;) {
+        int fd = accept(tls_server.listener, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        SSL* ssl = SSL_new(tls_server.ssl_ctx);
+        SSL_set_fd(ssl, fd);
+        pthread_t thread;
+        assert(pthread_create(&thread, NULL, tls_conn_thread, ssl) == 0);
+        pthread_detach(thread);
+    }
+}
+
+static void tls_server_start(void) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    assert(key && cert);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"127.0.0.1", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    assert(X509_sign(cert, key, EVP_sha256()) > 0);
+
+    tls_server.ssl_ctx = SSL_CTX_new(TLS_server_method());
+    assert(SSL_CTX_use_certificate(tls_server.ssl_ctx, cert) == 1);
+    assert(SSL_CTX_use_PrivateKey(tls_server.ssl_ctx, key) == 1);
+    SSL_CTX_set_session_cache_mode(tls_server.ssl_ctx, SSL_SESS_CACHE_SERVER);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+
+    tls_server.listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(tls_server.listener, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    assert(listen(tls_server.listener, 16) == 0);
+    socklen_t length = sizeof(addr);
+    getsockname(tls_server.listener, (struct sockaddr*)&addr, &length);
+    tls_server.port = ntohs(addr.sin_port);
+    assert(pthread_create(&tls_server.acceptor, NULL, tls_accept_thread, NULL) == 0);
+}
+
+static void tls_server_stop(void) {
+    shutdown(tls_server.listener, SHUT_RDWR);
+    pthread_join(tls_server.acceptor, NULL);
+    close(tls_server.listener);
+    SSL_CTX_free(tls_server.ssl_ctx);
+}
+
+static discord_gateway_t* tls_connect(const char* url) {
+    discord_gateway_t* gateway = NULL;
+    assert(discord_ws_connect(url, &gateway) == DISCORD_OK);
+    discord_ws_message_t message = {0};
+    assert(discord_ws_receive(gateway, &message, 5000) == DISCORD_OK);
+    assert(message.length == strlen(HELLO) && strcmp(message.data, HELLO) == 0);
+    discord_ws_free_message(&message);
+    return gateway;
+}
+
+typedef struct {
+    discord_gateway_t* gateway;
+    int timeout_ms;
+    discord_result_t result;
+} idle_receive_t;
+
+static void* idle_receive(void* arg) {
+    idle_receive_t* idle = arg;
+    discord_ws_message_t message = {0};
+    idle->result = discord_ws_receive(idle->gateway, &message, idle->timeout_ms);
+    return NULL;
+}
+
+void test_tls_resumption() {
+    printf("Testing TLS session resumption against a loopback server...\n");
+
+    tls_server_start();
+    char url[128];
+    snprintf(url, sizeof(url), "wss://127.0.0.1:%d/?v=10&encoding=json", tls_server.port);
+
+    discord_ws_stats_t before;
+    assert(discord_ws_get_stats(&before) == DISCORD_OK);
+
+    // The first handshake is full; reconnects reuse its cached session
+    for (int i = 0; i < 3; i++) {
+        discord_gateway_t* gateway = tls_connect(url);
+        assert(discord_ws_close(gateway) == DISCORD_OK);
+    }
+
+    discord_ws_stats_t stats;
+    assert(discord_ws_get_stats(&stats) == DISCORD_OK);
+    assert(stats.tls_handshakes - before.tls_handshakes == 3);
+    assert(stats.tls_resumed - before.tls_resumed > 0);
+    printf("  %llu of 3 handshakes resumed\n", (unsigned long long)(stats.tls_resumed - before.tls_resumed));
+    printf("  ✓ Reconnects resume the TLS session\n");
+
+    // A receiver waiting on an idle connection services in slices, so
+    // other connections are not held up for its whole timeout
+    discord_gateway_t* idle_gateway = tls_connect(url);
+    discord_gateway_t* busy_gateway = tls_connect(url);
+    idle_receive_t idle = { idle_gateway, 3000, DISCORD_OK };
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, idle_receive, &idle) == 0);
+    usleep(100000);
+
+    uint64_t started = now_ms();
+    const char* heartbeat = "{\"op\":1,\"d\":null}";
+    assert(discord_ws_send(busy_gateway, heartbeat, strlen(heartbeat)) == DISCORD_OK);
+    discord_ws_message_t message = {0};
+    assert(discord_ws_receive(busy_gateway, &message, 1000) == DISCORD_OK);
+    assert(strcmp(message.data, HEARTBEAT_ACK) == 0);
+    discord_ws_free_message(&message);
+    uint64_t elapsed = now_ms() - started;
+    assert(elapsed < 1000);
+    printf("  ✓ Heartbeat and ACK on another connection took %llu ms during a 3 s receive\n",
+           (unsigned long long)elapsed);
+
+    pthread_join(thread, NULL);
+    assert(idle.result == DISCORD_ERROR_TIMEOUT);
+    assert(discord_ws_close(busy_gateway) == DISCORD_OK);
+    assert(discord_ws_close(idle_gateway) == DISCORD_OK);
+    assert(discord_ws_shutdown() == DISCORD_OK);
+    tls_server_stop();
+}
+
+#define BACKLOG_EVENTS 1024
+
+static int backlog_handled = 0;
+
+static void on_backlog_event(const discord_event_t* event) {
+    (void)event;
+    backlog_handled++;
+    usleep(200);                    // Handlers take time
+}
+
+void test_receive_during_qos_backlog() {
+    printf("Testing receives while QoS holds events...\n");
+
+    tls_server_start();
+    char url[128];
+    snprintf(url, sizeof(url), "wss://127.0.0.1:%d/?v=10&encoding=json", tls_server.port);
+    discord_gateway_t* gateway = tls_connect(url);
+
+    discord_dispatch_clear();
+    discord_dispatch_set_handler(on_backlog_event);
+    discord_qos_t* qos = NULL;
+    assert(discord_qos_create(&qos) == DISCORD_OK);
+    assert(discord_qos_attach(qos) == DISCORD_OK);
+    for (int i = 0; i < BACKLOG_EVENTS; i++) {
+        assert(discord_dispatch_frame("{\"t\":\"MESSAGE_CREATE\",\"s\":2,\"op\":0,\"d\":{\"id\":\"1\"}}") == DISCORD_OK);
+    }
+    assert(discord_qos_pending() == BACKLOG_EVENTS);
+
+    // The gateway loop receives without blocking while events are queued
+    // and runs a batch after each empty receive; the ACK must not wait for
+    // the whole backlog
+    const char* heartbeat = "{\"op\":1,\"d\":null}";
+    assert(discord_ws_send(gateway, heartbeat, strlen(heartbeat)) == DISCORD_OK);
+    int received = 0;
+    while (discord_qos_pending() > 0) {
+        discord_ws_message_t message = {0};
+        discord_result_t result = discord_ws_receive(gateway, &message, 0);
+        if (result == DISCORD_OK) {
+            assert(strcmp(message.data, HEARTBEAT_ACK) == 0);
+            discord_ws_free_message(&message);
+            received = 1;
+            break;
+        }
+        assert(result == DISCORD_ERROR_TIMEOUT);
+        discord_qos_poll(1);
+    }
+    assert(received && discord_qos_pending() > 0);
+    printf("  ✓ ACK read with %u of %d events still queued\n", discord_qos_pending(), BACKLOG_EVENTS);
+
+    discord_qos_run(qos, BACKLOG_EVENTS);
+    assert(backlog_handled == BACKLOG_EVENTS);  // Normal lane keeps late events
+    discord_qos_attach(NULL);
+    discord_qos_destroy(qos);
+    discord_dispatch_clear();
+    assert(discord_ws_close(gateway) == DISCORD_OK);
+    assert(discord_ws_shutdown() == DISCORD_OK);
+    tls_server_stop();
+}
+#endif
+
+int main() {
+    printf("Discord ASM WebSocket Tests\n");
+    printf("===========================\n\n");
+
+    test_stats_without_connections();
+    printf("\n");
+
+    test_shared_context();
+    printf("\n");
+
+#ifndef _WIN32
+    test_tls_resumption();
+    printf("\n");
+
+    test_receive_during_qos_backlog();
+    printf("\n");
+#endif
+
+    printf("All WebSocket tests passed! ✓\n");
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "wsframe.h"
+
+// Small deterministic PRNG so failures reproduce across platforms
+static uint32_t rng_state = 4242;
+
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 16;
+}
+
+void test_header_roundtrip() {
+    printf("Testing header encode/decode...\n");
+
+    static const uint64_t lengths[] = { 0, 1, 125, 126, 127, 65535, 65536, 1u << 20, 0x7FFFFFFFFFFFFFFFull };
+    static const uint8_t mask[4] = { 0x11, 0x22, 0x33, 0x44 };
+    uint8_t header[DISCORD_WSFRAME_HEADER_MAX];
+
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        for (int masked = 0; masked < 2; masked++) {
+            size_t length = discord_wsframe_header(header, DISCORD_WSFRAME_BINARY, 1, lengths[i],
+                                                   masked ? mask : NULL);
+            size_t expected = (lengths[i] < 126 ? 2 : lengths[i] <= 0xFFFF ? 4 : 10) + (masked ? 4 : 0);
+            assert(length == expected);
+
+            // Every prefix is incomplete, the whole header is not
+            discord_wsframe_t frame;
+            for (size_t cut = 0; cut < length; cut++) {
+                assert(discord_wsframe_parse(header, cut, &frame) == 0);
+            }
+            assert(discord_wsframe_parse(header, length, &frame) == 1);
+            assert(frame.fin == 1 && frame.opcode == DISCORD_WSFRAME_BINARY);
+            assert(frame.payload_length == lengths[i] && frame.header_length == length);
+            assert(frame.masked == masked);
+            if (masked) {
+                assert(memcmp(frame.mask, mask, 4) == 0);
+            }
+        }
+    }
+    printf("  ✓ 7-, 16- and 64-bit lengths, masked and unmasked\n");
+
+    discord_wsframe_t frame;
+    size_t length = discord_wsframe_header(header, DISCORD_WSFRAME_TEXT, 0, 10, NULL);
+    assert(discord_wsframe_parse(header, length, &frame) == 1 && frame.fin == 0);
+    printf("  ✓ FIN bit kept for fragments\n");
+}
+
+void test_protocol_errors() {
+    printf("Testing protocol errors...\n");
+
+    discord_wsframe_t frame;
+    uint8_t reserved[2] = { 0x80 | 0x40 | DISCORD_WSFRAME_TEXT, 0 };
+    assert(discord_wsframe_parse(reserved, 2, &frame) == -1);
+
+    uint8_t opcode[2] = { 0x80 | 0x3, 0 };
+    assert(discord_wsframe_parse(opcode, 2, &frame) == -1);
+
+    uint8_t fragmented_ping[2] = { DISCORD_WSFRAME_PING, 0 };
+    assert(discord_wsframe_parse(fragmented_ping, 2, &frame) == -1);
+
+    uint8_t long_ping[4] = { 0x80 | DISCORD_WSFRAME_PING, 126, 0, 200 };
+    assert(discord_wsframe_parse(long_ping, 4, &frame) == -1);
+
+    uint8_t huge[10] = { 0x80 | DISCORD_WSFRAME_BINARY, 127, 0x80, 0, 0, 0, 0, 0, 0, 1 };
+    assert(discord_wsframe_parse(huge, 10, &frame) == -1);
+
+    uint8_t close[4] = { 0x80 | DISCORD_WSFRAME_CLOSE, 2, 0x03, 0xE8 };
+    assert(discord_wsframe_parse(close, 4, &frame) == 1 && frame.opcode == DISCORD_WSFRAME_CLOSE);
+    printf("  ✓ Reserved bits, unknown opcodes and bad control frames rejected\n");
+}
+
+void test_masking() {
+    printf("Testing masking kernel...\n");
+
+    uint8_t original[600], data[600 + 64], expected[600 + 64], copy[600];
+    for (int round = 0; round < 20000; round++) {
+        size_t length = next_random() % 560;
+        size_t align = next_random() % 32;
+        size_t phase = next_random() % 8;
+        uint8_t mask[4] = { (uint8_t)next_random(), (uint8_t)next_random(),
+                            (uint8_t)next_random(), (uint8_t)next_random() };
+
+        for (size_t i = 0; i < length; i++) {
+            original[i] = (uint8_t)next_random();
+        }
+        memcpy(data + align, original, length);
+        memcpy(expected + align, original, length);
+
+        discord_wsframe_mask(data + align, length, mask, phase);
+        discord_wsframe_mask_scalar(expected + align, length, mask, phase);
+        assert(memcmp(data + align, expected + align, length) == 0);
+
+        // Masking twice restores the payload
+        discord_wsframe_mask(data + align, length, mask, phase);
+        assert(memcmp(data + align, original, length) == 0);
+
+        discord_wsframe_mask_copy(copy, original, length, mask);
+        memcpy(expected, original, length);
+        discord_wsframe_mask_scalar(expected, length, mask, 0);
+        assert(memcmp(copy, expected, length) == 0);
+    }
+    printf("  ✓ Vector and scalar masking agree at every alignment and phase\n");
+
+    // A payload unmasked in two pieces matches one pass
+    uint8_t mask[4] = { 1, 2, 3, 4 };
+    memcpy(data, original, 300);
+    memcpy(expected, original, 300);
+    discord_wsframe_mask(data, 123, mask, 0);
+    discord_wsframe_mask(data + 123, 177, mask, 123);
+    discord_wsframe_mask_scalar(expected, 300, mask, 0);
+    assert(memcmp(data, expected, 300) == 0);
+    printf("  ✓ Split payloads keep the mask phase\n");
+}
+
+int main() {
+    printf("Discord ASM Bot - WebSocket Framing Tests\n");
+    printf("=========================================\n\n");
+
+    test_header_roundtrip();
+    printf("\n");
+
+    test_protocol_errors();
+    printf("\n");
+
+    test_masking();
+    printf("\n");
+
+    printf("All WebSocket framing tests passed! ✓\n");
+    return 0;
+}
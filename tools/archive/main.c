@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "abi.h"
+#include "archive.h"
+
+// Queries a message archive offline. Rows are printed as JSON lines; the
+// archive keeps content JSON-escaped, so it is written out as stored.
+
+typedef struct {
+    int count_only;
+    uint64_t limit;
+    uint64_t printed;
+} output_t;
+
+static const char* kind_names[] = { "create", "update", "delete" };
+
+static int print_row(void* user, const discord_archive_row_t* row) {
+    output_t* output = user;
+    output->printed++;
+    if (!output->count_only) {
+        printf("{\"kind\":\"%s\",\"id\":\"%llu\",\"channel_id\":\"%llu\"", kind_names[row->kind],
+               (unsigned long long)row->message_id, (unsigned long long)row->channel_id);
+        if (row->guild_id) {
+            printf(",\"guild_id\":\"%llu\"", (unsigned long long)row->guild_id);
+        }
+        if (row->author_id) {
+            printf(",\"author_id\":\"%llu\"", (unsigned long long)row->author_id);
+        }
+        printf(",\"time_ms\":%llu,\"event_ms\":%llu",
+               (unsigned long long)((row->message_id >> 22) + DISCORD_SNOWFLAKE_EPOCH_MS),
+               (unsigned long long)row->event_ms);
+        if (row->content) {
+            printf(",\"content\":\"%.*s\"", (int)row->content_length, row->content);
+        }
+        printf("}\n");
+    }
+    return output->limit && output->printed == output->limit;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s <directory> [options]\n", program_name);
+    printf("  --channel ID   Only messages in this channel\n");
+    printf("  --author ID    Only messages by this author (creates; most edits omit it)\n");
+    printf("  --since MS     Message time (Unix ms) at or after\n");
+    printf("  --until MS     Message time before\n");
+    printf("  --kind K       create, update or delete (repeatable)\n");
+    printf("  --limit N      Stop after N rows\n");
+    printf("  --count        Print the number of rows instead of the rows\n");
+    printf("  --stats        Report what the query read on stderr\n");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    discord_archive_query_t query = {0};
+    output_t output = {0};
+    int show_stats = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--channel") == 0 && i + 1 < argc) {
+            query.channel_id = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--author") == 0 && i + 1 < argc) {
+            query.author_id = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--since") == 0 && i + 1 < argc) {
+            query.since_ms = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+            query.until_ms = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            output.limit = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--kind") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            int kind = -1;
+            for (int k = 0; k < 3; k++) {
+                if (strcmp(name, kind_names[k]) == 0) {
+                    kind = k;
+                }
+            }
+            if (kind < 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            query.kinds |= 1u << kind;
+        } else if (strcmp(argv[i], "--count") == 0) {
+            output.count_only = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    discord_archive_reader_t* reader = NULL;
+    discord_result_t result = discord_archive_reader_open(argv[1], &reader);
+    if (result != DISCORD_OK) {
+        fprintf(stderr, "Error: cannot open archive %s: %d\n", argv[1], result);
+        return 1;
+    }
+
+    discord_archive_query_stats_t stats;
+    result = discord_archive_query(reader, &query, print_row, &output, &stats);
+    discord_archive_reader_close(reader);
+    if (result != DISCORD_OK) {
+        fprintf(stderr, "Error: query failed: %d\n", result);
+        return 1;
+    }
+
+    if (output.count_only) {
+        printf("%llu\n", (unsigned long long)output.printed);
+    }
+    if (show_stats) {
+        fprintf(stderr, "segments %llu (%llu skipped), groups %llu scanned, %llu decoded, rows %llu scanned, %llu matched\n",
+                (unsigned long long)stats.segments, (unsigned long long)stats.segments_skipped,
+                (unsigned long long)stats.groups_scanned, (unsigned long long)stats.groups_decoded,
+                (unsigned long long)stats.rows_scanned, (unsigned long long)stats.rows_matched);
+    }
+    return 0;
+}
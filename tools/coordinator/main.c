@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "abi.h"
+#include "coord.h"
+#include "shard.h"
+
+// Shard coordinator daemon. Serves one bot's shards to the processes that
+// connect to the socket and logs a line whenever the fleet changes: who is
+// connected, how many shards are assigned and READY, and how long the
+// fleet took from its first assignment to all shards READY.
+
+static volatile sig_atomic_t stopping = 0;
+
+static void on_signal(int signal_number) {
+    (void)signal_number;
+    stopping = 1;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s --socket PATH --shards N [options]\n", program_name);
+    printf("  --socket PATH      Unix socket to listen on (replaced if it exists)\n");
+    printf("  --shards N         Shard count of the bot\n");
+    printf("  --concurrency N    max_concurrency from GET /gateway/bot (default 1)\n");
+    printf("  --processes N      Processes to wait for before assigning (default 1)\n");
+    printf("  --window-ms MS     IDENTIFY window per bucket (default %d)\n", DISCORD_IDENTIFY_WINDOW_MS);
+}
+
+int main(int argc, char* argv[]) {
+    discord_coord_server_config_t config = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            config.path = argv[++i];
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            config.shard_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            config.max_concurrency = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--processes") == 0 && i + 1 < argc) {
+            config.processes = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--window-ms") == 0 && i + 1 < argc) {
+            config.window_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!config.path || config.shard_count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    discord_coord_server_t* server = NULL;
+    discord_result_t result = discord_coord_server_create(&config, &server);
+    if (result != DISCORD_OK) {
+        fprintf(stderr, "Error: cannot listen on %s: %d\n", config.path, result);
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("Coordinating %u shards on %s\n", config.shard_count, config.path);
+    fflush(stdout);
+
+    discord_coord_server_stats_t last = {0};
+    while (!stopping) {
+        if (discord_coord_server_poll(server, 1000) != DISCORD_OK) {
+            fprintf(stderr, "Error: poll failed\n");
+            break;
+        }
+
+        discord_coord_server_stats_t stats;
+        discord_coord_server_get_stats(server, &stats);
+        if (stats.processes == last.processes && stats.shards_assigned == last.shards_assigned &&
+            stats.shards_ready == last.shards_ready) {
+            continue;
+        }
+        printf("processes %u, shards %u assigned, %u ready; %llu joins, %llu leaves, %llu moved, "
+               "%llu grants (%llu delayed, %llu denied)",
+               stats.processes, stats.shards_assigned, stats.shards_ready, (unsigned long long)stats.joins,
+               (unsigned long long)stats.leaves, (unsigned long long)stats.shards_moved,
+               (unsigned long long)stats.grants, (unsigned long long)stats.grants_delayed,
+               (unsigned long long)stats.denied);
+        if (stats.all_ready_ms && !last.all_ready_ms) {
+            printf("; all READY %llu ms after the first assignment",
+                   (unsigned long long)(stats.all_ready_ms - stats.assigned_ms));
+        }
+        printf("\n");
+        fflush(stdout);
+        last = stats;
+    }
+
+    discord_coord_server_destroy(server);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "abi.h"
+#include "dispatch.h"
+
+// Replays a frame capture through the dispatch path with no network.
+// Frames go through the same envelope decode and handler lookup that the
+// gateway core uses, so the numbers reflect the shim's per-event cost.
+
+static uint64_t handled_events = 0;
+
+static void count_event(const discord_event_t* event) {
+    (void)event;
+    handled_events++;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s <capture.bin> [--paced] [--loops N]\n", program_name);
+    printf("  --paced    Replay with the recorded inter-frame timing\n");
+    printf("  --loops N  Replay the capture N times (default 1)\n");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    discord_replay_mode_t mode = DISCORD_REPLAY_MAX_SPEED;
+    int loops = 1;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--paced") == 0) {
+            mode = DISCORD_REPLAY_PACED;
+        } else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (loops < 1) {
+        loops = 1;
+    }
+
+    discord_replay_t* replay = NULL;
+    discord_result_t result = discord_replay_open(argv[1], &replay);
+    if (result != DISCORD_OK) {
+        fprintf(stderr, "Error: cannot open capture %s: %d\n", argv[1], result);
+        return 1;
+    }
+
+    discord_dispatch_set_handler(count_event);
+
+    printf("Discord ASM Replay\n");
+    printf("==================\n\n");
+    printf("Capture: %s (%zu frames, %s, %d loop%s)\n\n", argv[1],
+           discord_replay_frame_count(replay),
+           mode == DISCORD_REPLAY_PACED ? "paced" : "max speed",
+           loops, loops == 1 ? "" : "s");
+
+    discord_replay_stats_t stats;
+    uint64_t total_frames = 0;
+    uint64_t total_ns = 0;
+    uint64_t total_errors = 0;
+
+    for (int loop = 0; loop < loops; loop++) {
+        result = discord_replay_run(replay, mode, &stats);
+        if (result != DISCORD_OK) {
+            fprintf(stderr, "Error: replay failed: %d\n", result);
+            discord_replay_close(replay);
+            return 1;
+        }
+        total_frames += stats.frames;
+        total_ns += stats.elapsed_ns;
+        total_errors += stats.errors;
+    }
+
+    // Per-type latency from the last loop (warm caches)
+    printf("%-28s %10s %12s %12s\n", "event", "count", "avg (ns)", "max (ns)");
+    for (size_t i = 0; i < stats.type_count; i++) {
+        const discord_replay_type_stats_t* type = &stats.types[i];
+        printf("%-28s %10llu %12llu %12llu\n",
+               type->event_type[0] ? type->event_type : "(non-dispatch)",
+               (unsigned long long)type->count,
+               (unsigned long long)(type->count ? type->total_ns / type->count : 0),
+               (unsigned long long)type->max_ns);
+    }
+
+    double events_per_sec = total_ns ? (double)total_frames * 1e9 / (double)total_ns : 0.0;
+    printf("\nFrames: %llu  Handled: %llu  Errors: %llu\n",
+           (unsigned long long)total_frames,
+           (unsigned long long)handled_events,
+           (unsigned long long)total_errors);
+    printf("Throughput: %.0f events/sec\n", events_per_sec);
+
+    discord_replay_close(replay);
+    return total_errors == 0 ? 0 : 1;
+}